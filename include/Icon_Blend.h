@@ -0,0 +1,102 @@
+#pragma once
+/****************************************************** Icon blend ******************************************************/
+// A8 masks into RGB565 for LVGL's software renderer: A8 icons (tools/image_compress.py --icon, src/Icon_Image.h),
+// glyphs and anti-aliased edges are all blended as a fill colour through an alpha mask. Results are the same to the
+// bit as LVGL's loops: lv_color_16_16_mix() with the colour spread out once per blend instead of once per pixel, and
+// the mask read four bytes at a time so that the clear parts of an icon cost one test per four pixels.
+// Only the blend under a layer opacity replaces LVGL's loop: sim/bench/icon_bench.cpp has it at 1.02-1.30x of
+// LVGL's. At full opacity LVGL's loop is faster (the kernel runs at 0.79-0.88x of it), so Icon_Blend_Mask_To_RGB565()
+// is not hooked; Icon_Image_Bench() and the bench keep timing it against LVGL's.
+// LVGL includes this file itself, from lib/lvgl/src/draw/sw/blend, hence include/ rather than src/. lv_conf.h hooks
+// it in:
+//   #define LV_USE_DRAW_SW_ASM            LV_DRAW_SW_ASM_CUSTOM
+//   #define LV_DRAW_SW_ASM_CUSTOM_INCLUDE "Icon_Blend.h"
+// Icon_Image_Bench() times them against RGB565A8 and ARGB8888 icons, and says whether the hook is on.
+
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB565_MIX_MASK_OPA(dsc)  Icon_Blend_Mask_Opa_To_RGB565(dsc)
+
+#define ICON_BLEND_SPREAD(c)  (((uint32_t)(c) | ((uint32_t)(c) << 16)) & 0x07E0F81F) // G high, R and B low
+
+// lv_color_16_16_mix() by its 5-bit weight, (mix + 4) >> 3, Fg spread by ICON_BLEND_SPREAD(): 0 leaves Bg and 32
+// gives Fg, as LVGL's arithmetic does
+static inline void Icon_Blend_Pixel(uint16_t *Dest, uint16_t Color, uint32_t Fg, uint32_t Weight)
+{
+  if (Weight == 32) {
+    *Dest = Color;
+  } else if (Weight != 0) {
+    uint32_t bg = ICON_BLEND_SPREAD(*Dest);
+    uint32_t res = ((((Fg - bg) * Weight) >> 5) + bg) & 0x07E0F81F;
+    *Dest = (uint16_t)((res >> 16) | res);
+  }
+}
+
+static inline lv_result_t Icon_Blend_Mask_To_RGB565(_lv_draw_sw_blend_fill_dsc_t *dsc)
+{
+  uint16_t color = lv_color_to_u16(dsc->color);
+  uint32_t fg = ICON_BLEND_SPREAD(color);
+  uint32_t color2 = color | ((uint32_t)color << 16);
+  uint8_t *dest_row = (uint8_t *)dsc->dest_buf;
+  const uint8_t *mask_row = dsc->mask_buf;
+  for (int32_t y = 0; y < dsc->dest_h; y++) {
+    uint16_t *dest = (uint16_t *)dest_row;
+    const uint8_t *mask = mask_row;
+    int32_t x = 0;
+    for (; x < dsc->dest_w && ((uintptr_t)(mask + x) & 3); x++)
+      Icon_Blend_Pixel(&dest[x], color, fg, (mask[x] + 4) >> 3);
+    for (; x + 4 <= dsc->dest_w; x += 4) {
+      uint32_t m4 = *(const uint32_t *)(mask + x);
+      if (m4 == 0)
+        continue;
+      if (m4 == 0xFFFFFFFF) {
+        if ((uintptr_t)(dest + x) & 3) {
+          dest[x] = dest[x + 1] = dest[x + 2] = dest[x + 3] = color;
+        } else {
+          ((uint32_t *)(dest + x))[0] = color2;                 // Two pixels a store
+          ((uint32_t *)(dest + x))[1] = color2;
+        }
+        continue;
+      }
+      Icon_Blend_Pixel(&dest[x], color, fg, (mask[x] + 4) >> 3);
+      Icon_Blend_Pixel(&dest[x + 1], color, fg, (mask[x + 1] + 4) >> 3);
+      Icon_Blend_Pixel(&dest[x + 2], color, fg, (mask[x + 2] + 4) >> 3);
+      Icon_Blend_Pixel(&dest[x + 3], color, fg, (mask[x + 3] + 4) >> 3);
+    }
+    for (; x < dsc->dest_w; x++)
+      Icon_Blend_Pixel(&dest[x], color, fg, (mask[x] + 4) >> 3);
+    dest_row += dsc->dest_stride;
+    mask_row += dsc->mask_stride;
+  }
+  return LV_RESULT_OK;
+}
+
+// With the layer's opacity as well: LV_OPA_MIX2(mask, opa) as LVGL's loop, looked up by mask value
+static inline lv_result_t Icon_Blend_Mask_Opa_To_RGB565(_lv_draw_sw_blend_fill_dsc_t *dsc)
+{
+  uint16_t color = lv_color_to_u16(dsc->color);
+  uint32_t fg = ICON_BLEND_SPREAD(color);
+  uint8_t weight[256];
+  for (uint32_t m = 0; m < 256; m++)
+    weight[m] = (uint8_t)((((m * dsc->opa) >> 8) + 4) >> 3);
+  uint8_t *dest_row = (uint8_t *)dsc->dest_buf;
+  const uint8_t *mask_row = dsc->mask_buf;
+  for (int32_t y = 0; y < dsc->dest_h; y++) {
+    uint16_t *dest = (uint16_t *)dest_row;
+    const uint8_t *mask = mask_row;
+    int32_t x = 0;
+    for (; x < dsc->dest_w && ((uintptr_t)(mask + x) & 3); x++)
+      Icon_Blend_Pixel(&dest[x], color, fg, weight[mask[x]]);
+    for (; x + 4 <= dsc->dest_w; x += 4) {
+      if (*(const uint32_t *)(mask + x) == 0)
+        continue;
+      Icon_Blend_Pixel(&dest[x], color, fg, weight[mask[x]]);
+      Icon_Blend_Pixel(&dest[x + 1], color, fg, weight[mask[x + 1]]);
+      Icon_Blend_Pixel(&dest[x + 2], color, fg, weight[mask[x + 2]]);
+      Icon_Blend_Pixel(&dest[x + 3], color, fg, weight[mask[x + 3]]);
+    }
+    for (; x < dsc->dest_w; x++)
+      Icon_Blend_Pixel(&dest[x], color, fg, weight[mask[x]]);
+    dest_row += dsc->dest_stride;
+    mask_row += dsc->mask_stride;
+  }
+  return LV_RESULT_OK;
+}
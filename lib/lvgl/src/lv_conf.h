@@ -88,6 +88,15 @@
 /** Default number of draw buffers per display */
 #define LV_DRAW_BUF_COUNT 2
 
+/** Decoded images kept for the next draw, in bytes: JPEG photos (src/JPEG_Decoder.h, JPEG_DECODER_CACHE_SIZE) and
+ * compressed or indexed icons (src/Compressed_Image.h, src/Icon_Image.h). 0 would decode them at every draw. */
+#define LV_CACHE_DEF_SIZE (3 * 1024 * 1024)
+
+/** Software renderer blend kernel: A8 masks into RGB565 under a layer opacity (icons, glyphs, anti-aliasing), from
+ * include/Icon_Blend.h */
+#define LV_USE_DRAW_SW_ASM LV_DRAW_SW_ASM_CUSTOM
+#define LV_DRAW_SW_ASM_CUSTOM_INCLUDE "Icon_Blend.h"
+
 /*=================
    WIDGET SETTINGS
  *================*/
@@ -149,7 +158,8 @@
 /** File system interfaces for common APIs */
 
 /*API for fopen, fread, etc*/
-#define LV_USE_FS_STDIO 1
+/*Off: the card is drive S: (src/LVGL_FS.h), read through the PSRAM block cache of SD_Cache*/
+#define LV_USE_FS_STDIO 0
 #if LV_USE_FS_STDIO
     #define LV_FS_STDIO_LETTER 'A'     /*Set an upper cased letter on which the drive will accessible (e.g. 'A')*/
     #define LV_FS_STDIO_PATH ""         /*Set the working directory. File/directory paths will be appended to it. Use "/" if not required.*/
@@ -197,6 +207,12 @@
 /*Barcode code library*/
 #define LV_USE_BARCODE 0
 
+/*RLE decompress library, for images packed by tools/image_compress.py --rle (src/Compressed_Image.h)*/
+#define LV_USE_RLE 1
+
+/*LVGL's built-in LZ4 library, for images and asset packs packed with --lz4 (src/Compressed_Image.h, src/Asset_Pack.h)*/
+#define LV_USE_LZ4_INTERNAL 1
+
 /*==================
  * EXAMPLES
  *==================*/
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include "Sim_Bus.h"
+#include "Sim_Time.h"
+#include "I2C_Driver.h"
+
+#define SIM_BUS_MAX_DEVICES  8
+
+typedef struct {
+  Sim_Device *Dev;
+  uint32_t    Speed_hz;
+  Sim_Fault_t Fault;
+  uint32_t    Count;                                            // Transfers seen, drives the Nth-transfer faults
+} Sim_Slot_t;
+
+static Sim_Slot_t      Sim_Slots[SIM_BUS_MAX_DEVICES];
+static Sim_Fault_t     Sim_Bus_Fault;
+static uint32_t        Sim_Bus_Count = 0;
+static Sim_Bus_Stats_t Sim_Stats;
+static uint32_t        Sim_Rand_State = 0x12345678;
+
+static float Sim_Rand(void)                                     // xorshift32, seeded so runs are reproducible
+{
+  Sim_Rand_State ^= Sim_Rand_State << 13;
+  Sim_Rand_State ^= Sim_Rand_State >> 17;
+  Sim_Rand_State ^= Sim_Rand_State << 5;
+  return (Sim_Rand_State >> 8) * (1.0f / 16777216.0f);
+}
+
+static Sim_Slot_t *Sim_Find(uint8_t Driver_addr)
+{
+  for (int i = 0; i < SIM_BUS_MAX_DEVICES; i++) {
+    if (Sim_Slots[i].Dev && Sim_Slots[i].Dev->Addr == Driver_addr)
+      return &Sim_Slots[i];
+  }
+  return NULL;
+}
+
+void Sim_Bus_Attach(Sim_Device *dev)
+{
+  for (int i = 0; i < SIM_BUS_MAX_DEVICES; i++) {
+    if (Sim_Slots[i].Dev == NULL) {
+      Sim_Slots[i].Dev = dev;
+      Sim_Slots[i].Speed_hz = I2C_Frequency;
+      return;
+    }
+  }
+  printf("sim: bus full, %s not attached\n", dev->Name);
+}
+void Sim_Bus_Set_Fault(uint8_t Driver_addr, const Sim_Fault_t *fault)
+{
+  Sim_Fault_t none = {};
+  Sim_Fault_t *dst = &Sim_Bus_Fault;
+  if (Driver_addr) {
+    Sim_Slot_t *slot = Sim_Find(Driver_addr);
+    if (slot == NULL)
+      return;
+    dst = &slot->Fault;
+    slot->Count = 0;
+  } else {
+    Sim_Bus_Count = 0;
+  }
+  *dst = fault ? *fault : none;
+}
+void Sim_Bus_Clear_Faults(void)
+{
+  Sim_Bus_Set_Fault(0, NULL);
+  for (int i = 0; i < SIM_BUS_MAX_DEVICES; i++)
+    if (Sim_Slots[i].Dev)
+      Sim_Bus_Set_Fault(Sim_Slots[i].Dev->Addr, NULL);
+}
+void Sim_Bus_Seed(uint32_t seed)
+{
+  Sim_Rand_State = seed ? seed : 1;
+}
+void Sim_Bus_Get_Stats(Sim_Bus_Stats_t *stats)
+{
+  *stats = Sim_Stats;
+}
+void Sim_Bus_Reset_Stats(void)
+{
+  memset(&Sim_Stats, 0, sizeof(Sim_Stats));
+}
+uint32_t Sim_Bus_Speed(uint8_t Driver_addr)
+{
+  Sim_Slot_t *slot = Sim_Find(Driver_addr);
+  return slot ? slot->Speed_hz : 0;
+}
+
+/********************************************************** Timing and faults **********************************************************/
+// Each byte is 8 data bits + ACK. A read is address+register, repeated start, address+data; a write is address+register+data.
+static int64_t Sim_Wire_us(const Sim_Slot_t *slot, size_t Reg_len, size_t Length, bool Read)
+{
+  uint64_t bits = 9 * (1 + Reg_len + Length) + 2;               // + start and stop
+  if (Read)
+    bits += 9 + 1;                                              // Second address byte and repeated start
+  return (int64_t)(bits * 1000000ULL / slot->Speed_hz);
+}
+
+static bool Sim_Hit(uint32_t count, uint32_t every)
+{
+  return every && (count % every) == 0;
+}
+
+// Returns ESP_OK when the transfer should go through, otherwise the error and the bus time already spent
+static esp_err_t Sim_Begin(Sim_Slot_t *slot, size_t Reg_len, size_t Length, bool Read)
+{
+  uint32_t n_dev = ++slot->Count;
+  uint32_t n_bus = ++Sim_Bus_Count;
+  const Sim_Fault_t *df = &slot->Fault, *bf = &Sim_Bus_Fault;
+  int64_t  start = Sim_Time_Now();
+  Sim_Time_Advance(SIM_BUS_OVERHEAD_US + df->Latency_us + bf->Latency_us);
+  Sim_Stats.Transfers++;
+
+  esp_err_t ret = ESP_OK;
+  if (Sim_Hit(n_dev, df->Timeout_every) || Sim_Hit(n_bus, bf->Timeout_every)) {
+    Sim_Time_Advance((int64_t)I2C_TIMEOUT_MS * 1000);
+    Sim_Stats.Timeouts++;
+    ret = ESP_ERR_TIMEOUT;
+  } else if (!slot->Dev->Ack() || Sim_Hit(n_dev, df->Nack_every) || Sim_Hit(n_bus, bf->Nack_every) ||
+             (df->Nack_rate > 0 && Sim_Rand() < df->Nack_rate) || (bf->Nack_rate > 0 && Sim_Rand() < bf->Nack_rate)) {
+    Sim_Time_Advance(Sim_Wire_us(slot, 0, 0, false));           // Address byte, NACK, stop
+    Sim_Stats.Nacks++;
+    ret = ESP_FAIL;                                             // What i2c_master reports for a NACK
+  } else {
+    Sim_Time_Advance(Sim_Wire_us(slot, Reg_len, Length, Read));
+    Sim_Stats.Bytes += Length;
+  }
+  Sim_Stats.Bus_us += Sim_Time_Now() - start;
+  return ret;
+}
+
+/********************************************************** Transport **********************************************************/
+static esp_err_t Sim_Init(void)
+{
+  return ESP_OK;
+}
+static void Sim_Set_Speed(uint8_t Driver_addr, uint32_t Speed_hz)
+{
+  Sim_Slot_t *slot = Sim_Find(Driver_addr);
+  if (slot)
+    slot->Speed_hz = Speed_hz;
+}
+static esp_err_t Sim_Read(uint8_t Driver_addr, const uint8_t *Reg, size_t Reg_len, uint8_t *Data, size_t Length)
+{
+  Sim_Slot_t *slot = Sim_Find(Driver_addr);
+  if (slot == NULL) {
+    Sim_Time_Advance(SIM_BUS_OVERHEAD_US + 12);                 // Nobody answers the address
+    return ESP_FAIL;
+  }
+  esp_err_t ret = Sim_Begin(slot, Reg_len, Length, true);
+  if (ret != ESP_OK)
+    return ret;
+  return slot->Dev->Read(Reg, Reg_len, Data, Length);
+}
+static esp_err_t Sim_Write(uint8_t Driver_addr, const uint8_t *Reg, size_t Reg_len, const uint8_t *Data, size_t Length)
+{
+  Sim_Slot_t *slot = Sim_Find(Driver_addr);
+  if (slot == NULL) {
+    Sim_Time_Advance(SIM_BUS_OVERHEAD_US + 12);
+    return ESP_FAIL;
+  }
+  esp_err_t ret = Sim_Begin(slot, Reg_len, Length, false);
+  if (ret != ESP_OK)
+    return ret;
+  return slot->Dev->Write(Reg, Reg_len, Data, Length);
+}
+
+static const I2C_Transport_t Sim_Transport = {
+  "sim",
+  Sim_Init,
+  Sim_Set_Speed,
+  Sim_Read,
+  Sim_Write,
+};
+
+const I2C_Transport_t *Sim_Bus_Transport(void)
+{
+  return &Sim_Transport;
+}
+
+const I2C_Transport_t *I2C_Default_Transport(void)              // Replaces I2C_Master_Transport.cpp in the host build
+{
+  return &Sim_Transport;
+}
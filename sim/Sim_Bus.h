@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "I2C_Transport.h"
+
+// Register-level I2C slave. Reg holds the register address bytes the master sent before the data phase
+// (one byte for most devices, two for the GT911), reads are issued as write-register + repeated start + read.
+class Sim_Device {
+public:
+  Sim_Device(uint8_t Addr, const char *Name) : Addr(Addr), Name(Name) {}
+  virtual ~Sim_Device() {}
+  virtual bool Ack(void) { return true; }                       // false NACKs the address byte (device held in reset...)
+  virtual esp_err_t Read(const uint8_t *Reg, size_t Reg_len, uint8_t *Data, size_t Length) = 0;
+  virtual esp_err_t Write(const uint8_t *Reg, size_t Reg_len, const uint8_t *Data, size_t Length) = 0;
+
+  const uint8_t Addr;
+  const char   *Name;
+};
+
+// Fault injection, per device or for the whole bus (Driver_addr 0)
+typedef struct {
+  uint32_t Latency_us;                                          // Added to every transfer (slow ACKs, clock stretching)
+  uint32_t Nack_every;                                          // Every Nth transfer is NACKed, 0 = never
+  uint32_t Timeout_every;                                       // Every Nth transfer holds the bus until I2C_TIMEOUT_MS, 0 = never
+  float    Nack_rate;                                           // Random NACK probability per transfer
+} Sim_Fault_t;
+
+typedef struct {
+  uint32_t Transfers;
+  uint32_t Nacks;
+  uint32_t Timeouts;
+  uint64_t Bytes;
+  uint64_t Bus_us;                                              // Virtual time the bus was occupied
+} Sim_Bus_Stats_t;
+
+#define SIM_BUS_OVERHEAD_US   20                                // Per-transfer driver cost measured on the S3 with i2c_master (ISR, queueing, start/stop)
+
+void Sim_Bus_Attach(Sim_Device *dev);
+void Sim_Bus_Set_Fault(uint8_t Driver_addr, const Sim_Fault_t *fault);  // NULL clears
+void Sim_Bus_Clear_Faults(void);
+void Sim_Bus_Seed(uint32_t seed);
+void Sim_Bus_Get_Stats(Sim_Bus_Stats_t *stats);
+void Sim_Bus_Reset_Stats(void);
+uint32_t Sim_Bus_Speed(uint8_t Driver_addr);
+const I2C_Transport_t *Sim_Bus_Transport(void);
@@ -0,0 +1,656 @@
+#include <math.h>
+#include <string.h>
+#include "Arduino.h"
+#include "Sim_Devices.h"
+#include "Sim_Time.h"
+
+/********************************************************** 8-bit register file **********************************************************/
+esp_err_t Sim_Reg8_Device::Read(const uint8_t *Reg, size_t Reg_len, uint8_t *Data, size_t Length)
+{
+  uint8_t reg = Reg[Reg_len - 1];
+  Before_Access();
+  for (size_t i = 0; i < Length; i++) {
+    Data[i] = On_Read(reg);
+    Reads[reg]++;
+    reg = Next_Reg(reg);
+  }
+  return ESP_OK;
+}
+esp_err_t Sim_Reg8_Device::Write(const uint8_t *Reg, size_t Reg_len, const uint8_t *Data, size_t Length)
+{
+  uint8_t reg = Reg[Reg_len - 1];
+  Before_Access();
+  for (size_t i = 0; i < Length; i++) {
+    On_Write(reg, Data[i]);
+    Writes[reg]++;
+    reg = Next_Reg(reg);
+  }
+  return ESP_OK;
+}
+
+/********************************************************** TCA9554 **********************************************************/
+// 0x00 input, 0x01 output, 0x02 polarity inversion, 0x03 configuration (1 = input)
+Sim_TCA9554::Sim_TCA9554(uint8_t Addr) : Sim_Reg8_Device(Addr, "TCA9554"), External(0xFF)
+{
+  Regs[0x01] = 0xFF;
+  Regs[0x02] = 0x00;
+  Regs[0x03] = 0xFF;
+}
+uint8_t Sim_TCA9554::Pins(void)
+{
+  return (Regs[0x01] & ~Regs[0x03]) | (External & Regs[0x03]);
+}
+uint8_t Sim_TCA9554::On_Read(uint8_t reg)
+{
+  reg &= 0x03;
+  return reg == 0x00 ? (uint8_t)(Pins() ^ Regs[0x02]) : Regs[reg];
+}
+void Sim_TCA9554::On_Write(uint8_t reg, uint8_t value)
+{
+  reg &= 0x03;
+  if (reg != 0x00)                                              // Input port is read-only
+    Regs[reg] = value;
+}
+
+/********************************************************** GT911 **********************************************************/
+#define GT911_CONFIG_BASE   0x8040
+#define GT911_INFO_BASE     0x8140
+#define GT911_STATUS        0x0E                                // 0x814E relative to GT911_INFO_BASE
+#define GT911_POINTS        0x0F
+
+Sim_GT911::Sim_GT911(uint8_t Addr, uint16_t X_res, uint16_t Y_res) : Sim_Device(Addr, "GT911")
+{
+  memset(Config, 0, sizeof(Config));
+  memset(Info, 0, sizeof(Info));
+  memcpy(Info, "911", 4);                                       // Product ID, ASCII
+  Info[0x04] = 0x60;                                            // Firmware version
+  Info[0x05] = 0x10;
+  Info[0x06] = X_res & 0xFF;
+  Info[0x07] = X_res >> 8;
+  Info[0x08] = Y_res & 0xFF;
+  Info[0x09] = Y_res >> 8;
+  Info[0x0A] = 0x02;                                            // Vendor ID
+}
+
+uint8_t *Sim_GT911::Reg_Ptr(uint16_t reg)
+{
+  if (reg >= GT911_CONFIG_BASE && reg < GT911_CONFIG_BASE + sizeof(Config))
+    return &Config[reg - GT911_CONFIG_BASE];
+  if (reg >= GT911_INFO_BASE && reg < GT911_INFO_BASE + sizeof(Info))
+    return &Info[reg - GT911_INFO_BASE];
+  return NULL;
+}
+
+bool Sim_GT911::Ack(void)
+{
+  return Reset_expander == NULL || Reset_expander->Pin(Reset_pin);
+}
+
+// Latches the held points into the report buffer once the host has cleared the previous report
+// and the report period has elapsed. Returns through Reports so the INT timer can tell.
+void Sim_GT911::Update(void)
+{
+  int64_t now = Sim_Time_Now();
+  if ((Info[GT911_STATUS] & 0x80) || now < Next_report_us)
+    return;
+  if (Held_count == 0 && !Release_pending)
+    return;
+  Info[GT911_STATUS] = 0x80 | Held_count;
+  for (uint8_t i = 0; i < Held_count; i++) {
+    uint8_t *p = &Info[GT911_POINTS + i * 8];
+    p[0] = i;                                                   // Track ID
+    p[1] = Held[i].X & 0xFF;
+    p[2] = Held[i].X >> 8;
+    p[3] = Held[i].Y & 0xFF;
+    p[4] = Held[i].Y >> 8;
+    p[5] = Held[i].Size & 0xFF;
+    p[6] = Held[i].Size >> 8;
+    p[7] = 0;
+  }
+  Release_pending = false;
+  Next_report_us = now + Report_period_us;
+  Reports++;
+}
+
+esp_err_t Sim_GT911::Read(const uint8_t *Reg, size_t Reg_len, uint8_t *Data, size_t Length)
+{
+  if (Reg_len != 2)
+    return ESP_ERR_INVALID_ARG;
+  uint16_t reg = (Reg[0] << 8) | Reg[1];
+  Update();
+  for (size_t i = 0; i < Length; i++, reg++) {
+    uint8_t *p = Reg_Ptr(reg);
+    Data[i] = p ? *p : 0x00;
+  }
+  return ESP_OK;
+}
+
+esp_err_t Sim_GT911::Write(const uint8_t *Reg, size_t Reg_len, const uint8_t *Data, size_t Length)
+{
+  if (Reg_len != 2)
+    return ESP_ERR_INVALID_ARG;
+  uint16_t reg = (Reg[0] << 8) | Reg[1];
+  for (size_t i = 0; i < Length; i++, reg++) {
+    if (reg == GT911_INFO_BASE + GT911_STATUS) {
+      if ((Info[GT911_STATUS] & 0x80) && !(Data[i] & 0x80))
+        Reports_read++;
+      Info[GT911_STATUS] = Data[i];
+      continue;
+    }
+    if (reg < GT911_INFO_BASE) {                                // ID and point registers are read-only
+      uint8_t *p = Reg_Ptr(reg);
+      if (p)
+        *p = Data[i];
+    }
+  }
+  return ESP_OK;
+}
+
+void Sim_GT911::Touch(const Sim_Touch_Point_t *points, uint8_t count)
+{
+  if (count > SIM_GT911_MAX_POINTS)
+    count = SIM_GT911_MAX_POINTS;
+  memcpy(Held, points, count * sizeof(Sim_Touch_Point_t));
+  Held_count = count;
+}
+void Sim_GT911::Release(void)
+{
+  if (Held_count)
+    Release_pending = true;                                     // One empty report tells the host the finger lifted
+  Held_count = 0;
+}
+void Sim_GT911::Wire_Reset(Sim_TCA9554 *expander, uint8_t Pin)
+{
+  Reset_expander = expander;
+  Reset_pin = Pin;
+}
+
+void Sim_GT911::Report_Timer(void *arg)
+{
+  Sim_GT911 *self = (Sim_GT911 *)arg;
+  uint32_t before = self->Reports;
+  self->Update();
+  if (self->Reports != before) {                                // Falling edge on INT, like the real part in its default mode
+    Sim_Gpio_Trigger(self->Int_gpio, LOW);
+    Sim_Gpio_Trigger(self->Int_gpio, HIGH);
+  }
+}
+void Sim_GT911::Wire_Int(int Gpio)
+{
+  Int_gpio = Gpio;
+  if (Timer == NULL) {
+    esp_timer_create_args_t args = {};
+    args.callback = Report_Timer;
+    args.arg = this;
+    args.name = "sim gt911";
+    esp_timer_create(&args, &Timer);
+  }
+  esp_timer_stop(Timer);
+  if (Gpio >= 0) {
+    Sim_Gpio_Trigger(Gpio, HIGH);
+    esp_timer_start_periodic(Timer, Report_period_us);
+  }
+}
+
+/********************************************************** QMI8658 **********************************************************/
+#define QMI_CTRL1        0x02
+#define QMI_CTRL2        0x03
+#define QMI_CTRL3        0x04
+#define QMI_CTRL7        0x08
+#define QMI_CTRL8        0x09
+#define QMI_CTRL9        0x0A
+#define QMI_CAL1_L       0x0B
+#define QMI_CAL1_H       0x0C
+#define QMI_FIFO_WTM_TH  0x13
+#define QMI_FIFO_CTRL    0x14
+#define QMI_FIFO_SMPL    0x15
+#define QMI_FIFO_STATUS  0x16
+#define QMI_STATUSINT    0x2D
+#define QMI_STATUS0      0x2E
+#define QMI_STATUS1      0x2F
+#define QMI_TIMESTAMP    0x30
+#define QMI_TEMP         0x33
+#define QMI_AX           0x35
+#define QMI_GX           0x3B
+#define QMI_FIFO_DATA    0x49
+#define QMI_RESET        0x60
+
+#define QMI_CMD_ACK      0x00
+#define QMI_CMD_RST_FIFO 0x04
+#define QMI_CMD_REQ_FIFO 0x05
+#define QMI_CMD_WOM      0x08
+
+static const float Qmi_Odr_table[16] = {                         // Accelerometer only
+  8000, 4000, 2000, 1000, 500, 250, 125, 62.5f, 31.25f, 0, 0, 0, 128, 21, 11, 3,
+};
+static const float Qmi_Odr_6dof[9] = {                          // Gyro enabled: derived from the gyro's drive frequency
+  7174.4f, 3587.2f, 1793.6f, 896.8f, 448.4f, 224.2f, 112.1f, 56.05f, 28.025f,
+};
+
+Sim_QMI8658::Sim_QMI8658(uint8_t Addr) : Sim_Reg8_Device(Addr, "QMI8658")
+{
+  Regs[0x00] = 0x05;                                            // WHO_AM_I
+  Regs[0x01] = 0x7C;                                            // Revision
+  Regs[QMI_CTRL1] = 0x20;
+}
+
+float Sim_QMI8658::Odr_hz(void)
+{
+  uint8_t en = Regs[QMI_CTRL7] & 0x03;
+  if (en & 0x02)                                                // Gyro sets the pace in 6-axis mode
+    return (Regs[QMI_CTRL3] & 0x0F) < 9 ? Qmi_Odr_6dof[Regs[QMI_CTRL3] & 0x0F] : 0;
+  if (en & 0x01)
+    return Qmi_Odr_table[Regs[QMI_CTRL2] & 0x0F];
+  return 0;
+}
+
+uint8_t Sim_QMI8658::Frame_bytes(void)
+{
+  return ((Regs[QMI_CTRL7] & 0x01) ? 6 : 0) + ((Regs[QMI_CTRL7] & 0x02) ? 6 : 0);
+}
+
+uint32_t Sim_QMI8658::Fifo_capacity(void)
+{
+  return (16u << ((Regs[QMI_FIFO_CTRL] >> 2) & 0x03)) * Frame_bytes();
+}
+
+static void Qmi_Put16(uint8_t *p, float v)
+{
+  int32_t raw = (int32_t)lroundf(v);
+  raw = raw > 32767 ? 32767 : (raw < -32768 ? -32768 : raw);
+  p[0] = raw & 0xFF;
+  p[1] = (raw >> 8) & 0xFF;
+}
+
+void Sim_QMI8658::Generate(int64_t t_us)
+{
+  float t = t_us * 1e-6f;
+  float acc_lsb = 32768.0f / (2 << ((Regs[QMI_CTRL2] >> 4) & 0x07));
+  float gyr_lsb = 32768.0f / (16 << ((Regs[QMI_CTRL3] >> 4) & 0x07));
+  float vib = Vibration_g * sinf(2.0f * (float)M_PI * Vibration_hz * t);
+  uint8_t frame[12];
+  uint8_t n = 0;
+
+  if (Regs[QMI_CTRL7] & 0x01) {
+    for (int i = 0; i < 3; i++)
+      Qmi_Put16(&Regs[QMI_AX + i * 2], (Gravity_g[i] + vib) * acc_lsb);
+    memcpy(&frame[n], &Regs[QMI_AX], 6);
+    n += 6;
+    if (Wom_threshold_mg && !(Regs[QMI_CTRL7] & 0x02))
+      Wom_Sample(vib);
+  }
+  if (Regs[QMI_CTRL7] & 0x02) {
+    for (int i = 0; i < 3; i++)
+      Qmi_Put16(&Regs[QMI_GX + i * 2], Rate_dps[i] * gyr_lsb);
+    memcpy(&frame[n], &Regs[QMI_GX], 6);
+    n += 6;
+  }
+  Samples++;
+  Regs[QMI_TIMESTAMP]     = Samples & 0xFF;
+  Regs[QMI_TIMESTAMP + 1] = (Samples >> 8) & 0xFF;
+  Regs[QMI_TIMESTAMP + 2] = (Samples >> 16) & 0xFF;
+  Qmi_Put16(&Regs[QMI_TEMP], Temperature_c * 256.0f);
+  Regs[QMI_STATUS0] |= Regs[QMI_CTRL7] & 0x03;                  // aDA / gDA
+  Regs[QMI_STATUSINT] |= 0x01;                                  // Avail
+
+  uint8_t mode = Regs[QMI_FIFO_CTRL] & 0x03;
+  if (mode == 0 || n == 0)
+    return;
+  uint32_t cap = Fifo_capacity();
+  if (Fifo_count + n > cap) {
+    Fifo_lost = true;
+    if (mode == 1) {                                            // FIFO mode stops when full
+      Fifo_overflows++;
+      return;
+    }
+    Fifo_head = (Fifo_head + n) % cap;                          // Stream mode drops the oldest frame
+    Fifo_count -= n;
+    Fifo_overflows++;
+  }
+  for (uint8_t i = 0; i < n; i++)
+    Fifo[(Fifo_head + Fifo_count + i) % cap] = frame[i];
+  Fifo_count += n;
+}
+
+// Samples are produced lazily: every access catches up with the virtual clock at the configured ODR
+void Sim_QMI8658::Before_Access(void)
+{
+  int64_t now = Sim_Time_Now();
+  if (Cmd_done_us >= 0 && now >= Cmd_done_us) {
+    Regs[QMI_STATUSINT] |= 0x80;                                // CmdDone, cleared by CTRL_CMD_ACK
+    Cmd_done_us = -1;
+  }
+  float odr = Odr_hz();
+  if (odr <= 0) {
+    Last_sample_us = now;
+    return;
+  }
+  double period = 1e6 / odr;
+  int64_t due = (int64_t)((now - Last_sample_us) / period);
+  uint32_t keep = Fifo_capacity() / (Frame_bytes() ? Frame_bytes() : 1) + 1;
+  if (due > keep) {                                             // Long idle: only the last FIFO's worth can be observed
+    Samples += due - keep;
+    if (Regs[QMI_FIFO_CTRL] & 0x03) {
+      Fifo_overflows += due - keep;
+      Fifo_lost = true;
+    }
+    Last_sample_us += (int64_t)((due - keep) * period);
+    due = keep;
+  }
+  for (int64_t i = 1; i <= due; i++)
+    Generate(Last_sample_us + (int64_t)(i * period));
+  Last_sample_us += (int64_t)(due * period);
+}
+
+// Wake on Motion: a change above the threshold on any axis between two accel-only samples, after the blanking count
+void Sim_QMI8658::Wom_Sample(float vib)
+{
+  bool moved = false;
+  for (int i = 0; i < 3; i++) {
+    float a = Gravity_g[i] + vib;
+    moved |= Wom_primed && fabsf(a - Wom_prev_g[i]) * 1000.0f > Wom_threshold_mg;
+    Wom_prev_g[i] = a;
+  }
+  Wom_primed = true;
+  if (Wom_blanking) {
+    Wom_blanking--;
+    return;
+  }
+  if (!moved)
+    return;
+  Wom_events++;
+  Regs[QMI_STATUS1] |= 0x04;
+  Wom_level = !Wom_level;                                       // The pin toggles on every event
+  Sim_Gpio_Trigger((Wom_config & 0x80) ? Int2_gpio : Int1_gpio, Wom_level ? HIGH : LOW);
+}
+
+void Sim_QMI8658::Command(uint8_t cmd)
+{
+  if (cmd == QMI_CMD_ACK) {
+    Regs[QMI_STATUSINT] &= ~0x80;
+    Sim_Gpio_Trigger(Int1_gpio, LOW);
+    return;
+  }
+  if (cmd == QMI_CMD_RST_FIFO) {
+    Fifo_head = Fifo_count = 0;
+    Fifo_lost = false;
+    Regs[QMI_FIFO_CTRL] &= 0x7F;
+  } else if (cmd == QMI_CMD_REQ_FIFO) {
+    Regs[QMI_FIFO_CTRL] |= 0x80;                                // FIFO read mode until FIFO_CTRL is written
+  } else if (cmd == QMI_CMD_WOM) {
+    Wom_threshold_mg = Regs[QMI_CAL1_L];                        // 0 turns the engine off
+    Wom_config = Regs[QMI_CAL1_H];
+    Wom_blanking = Wom_config & 0x3F;
+    Wom_level = (Wom_config & 0x40) != 0;
+    Wom_primed = false;
+    Sim_Gpio_Trigger((Wom_config & 0x80) ? Int2_gpio : Int1_gpio, Wom_level ? HIGH : LOW);
+  }
+  Cmd_done_us = Sim_Time_Now() + Cmd_delay_us;
+  if (Cmd_timer)
+    esp_timer_start_once(Cmd_timer, Cmd_delay_us);
+}
+
+uint8_t Sim_QMI8658::On_Read(uint8_t reg)
+{
+  uint32_t words = Fifo_count / 2;
+  switch (reg) {
+    case QMI_FIFO_SMPL:
+      return words & 0xFF;
+    case QMI_FIFO_STATUS: {
+      uint8_t status = (words >> 8) & 0x03;
+      uint8_t frame = Frame_bytes();
+      if (Fifo_count)
+        status |= 0x10;                                         // Not empty
+      if (Fifo_lost)
+        status |= 0x20;                                         // Cleared by this read
+      Fifo_lost = false;
+      if (Regs[QMI_FIFO_WTM_TH] && frame && Fifo_count / frame >= Regs[QMI_FIFO_WTM_TH])
+        status |= 0x40;
+      if (frame && Fifo_count + frame > Fifo_capacity())
+        status |= 0x80;
+      return status;
+    }
+    case QMI_FIFO_DATA: {
+      if (!(Regs[QMI_FIFO_CTRL] & 0x80) || Fifo_count == 0)
+        return 0x00;
+      uint8_t b = Fifo[Fifo_head];
+      Fifo_head = (Fifo_head + 1) % Fifo_capacity();
+      Fifo_count--;
+      return b;
+    }
+    case QMI_STATUS0:
+    case QMI_STATUS1: {
+      uint8_t status = Regs[reg];
+      Regs[reg] = 0;                                            // Cleared on read
+      return status;
+    }
+    default:
+      return Regs[reg];
+  }
+}
+
+void Sim_QMI8658::On_Write(uint8_t reg, uint8_t value)
+{
+  if (reg == QMI_CTRL9) {
+    Regs[reg] = value;
+    Command(value);
+  } else if (reg == QMI_FIFO_CTRL) {
+    if ((value & 0x0F) != (Regs[reg] & 0x0F))                   // New mode or size starts empty
+      Fifo_head = Fifo_count = 0;
+    Regs[reg] = value & 0x0F;                                   // Also leaves FIFO read mode
+  } else if (reg == QMI_RESET && value == 0xB0) {
+    memset(Regs, 0, sizeof(Regs));
+    Regs[0x00] = 0x05;
+    Regs[0x01] = 0x7C;
+    Regs[QMI_CTRL1] = 0x20;
+    Fifo_head = Fifo_count = 0;
+    Fifo_lost = false;
+    Wom_threshold_mg = 0;
+  } else if (reg <= 0x01 || (reg >= QMI_FIFO_SMPL && reg <= QMI_FIFO_STATUS) || (reg >= QMI_STATUSINT && reg <= QMI_GX + 5)) {
+    // Read-only
+  } else {
+    Regs[reg] = value;
+  }
+}
+
+// Polls the watermark every 500 us of virtual time, that is the timestamp resolution the driver sees
+void Sim_QMI8658::Int_Timer(void *arg)
+{
+  Sim_QMI8658 *self = (Sim_QMI8658 *)arg;
+  self->Before_Access();
+  if (self->Wom_threshold_mg && (self->Wom_config & 0x80))     // INT2 belongs to the Wake on Motion engine
+    return;
+  uint8_t frame = self->Frame_bytes();
+  bool level = (self->Regs[QMI_CTRL1] & 0x10) && self->Regs[QMI_FIFO_WTM_TH] && frame &&
+               self->Fifo_count / frame >= self->Regs[QMI_FIFO_WTM_TH];
+  Sim_Gpio_Trigger(self->Int2_gpio, level ? HIGH : LOW);
+}
+// CmdDone as seen on INT1, at the moment the command finishes rather than on the next register access
+void Sim_QMI8658::Cmd_Timer(void *arg)
+{
+  Sim_QMI8658 *self = (Sim_QMI8658 *)arg;
+  self->Before_Access();
+  if ((self->Regs[QMI_STATUSINT] & 0x80) && (self->Regs[QMI_CTRL1] & 0x08) && !(self->Regs[QMI_CTRL8] & 0x80))
+    Sim_Gpio_Trigger(self->Int1_gpio, HIGH);
+}
+void Sim_QMI8658::Wire_Int1(int Gpio)
+{
+  Int1_gpio = Gpio;
+  if (Cmd_timer == NULL && Gpio >= 0) {
+    esp_timer_create_args_t args = {};
+    args.callback = Cmd_Timer;
+    args.arg = this;
+    args.name = "sim qmi8658 cmd";
+    esp_timer_create(&args, &Cmd_timer);
+  }
+  if (Gpio >= 0)
+    Sim_Gpio_Trigger(Gpio, LOW);
+}
+void Sim_QMI8658::Wire_Int2(int Gpio)
+{
+  Int2_gpio = Gpio;
+  if (Timer == NULL) {
+    esp_timer_create_args_t args = {};
+    args.callback = Int_Timer;
+    args.arg = this;
+    args.name = "sim qmi8658";
+    esp_timer_create(&args, &Timer);
+  }
+  esp_timer_stop(Timer);
+  if (Gpio >= 0) {
+    Sim_Gpio_Trigger(Gpio, LOW);
+    esp_timer_start_periodic(Timer, 500);
+  }
+}
+
+uint8_t Sim_QMI8658::Next_Reg(uint8_t reg)
+{
+  if (reg == QMI_FIFO_DATA || !(Regs[QMI_CTRL1] & 0x40))        // FIFO data port never increments, nor anything without ADDR_AI
+    return reg;
+  return reg + 1;
+}
+
+/********************************************************** PCF85063 **********************************************************/
+#define PCF_CTRL1        0x00
+#define PCF_CTRL2        0x01
+#define PCF_SECONDS      0x04
+#define PCF_YEARS        0x0A
+
+static uint8_t Pcf_To_Bcd(int v)
+{
+  return (uint8_t)(((v / 10) << 4) | (v % 10));
+}
+static int Pcf_From_Bcd(uint8_t v)
+{
+  return (v >> 4) * 10 + (v & 0x0F);
+}
+
+Sim_PCF85063::Sim_PCF85063(uint8_t Addr) : Sim_Reg8_Device(Addr, "PCF85063")
+{
+  for (uint8_t r = 0x0B; r <= 0x0F; r++)
+    Regs[r] = 0x80;                                             // Alarms disabled
+  Set(757382400);                                               // 2024-01-01 00:00:00, year register 24
+}
+
+void Sim_PCF85063::Set(time_t t)
+{
+  Base_s = t;
+  Base_us = Sim_Time_Now();
+  Wday_offset = 0;
+  Arm_Int();
+}
+
+int64_t Sim_PCF85063::Now_us(void)
+{
+  if (Regs[PCF_CTRL1] & 0x20)
+    return (int64_t)Base_s * 1000000;
+  double elapsed = (Sim_Time_Now() - Base_us) * (1.0 + Drift_ppm * 1e-6);
+  return (int64_t)Base_s * 1000000 + (int64_t)elapsed;
+}
+
+// The minute and half-minute interrupts in pulse mode: INT low for 1/64 s from the rollover. The falling edge is what
+// the driver uses, so the pulse is modelled as both edges at once.
+void Sim_PCF85063::Int_Timer(void *arg)
+{
+  Sim_PCF85063 *self = (Sim_PCF85063 *)arg;
+  time_t now = self->Now();
+  uint8_t ctrl2 = self->Regs[PCF_CTRL2];
+  if (((ctrl2 & 0x20) && now % 60 == 0) || ((ctrl2 & 0x10) && now % 30 == 0)) {
+    Sim_Gpio_Trigger(self->Int_gpio, LOW);
+    Sim_Gpio_Trigger(self->Int_gpio, HIGH);
+  }
+  self->Arm_Int();
+}
+void Sim_PCF85063::Arm_Int(void)
+{
+  if (Timer == NULL)
+    return;
+  esp_timer_stop(Timer);
+  if (Int_gpio < 0 || (Regs[PCF_CTRL1] & 0x20))
+    return;
+  double rate = 1.0 + Drift_ppm * 1e-6;
+  double elapsed = (Sim_Time_Now() - Base_us) * rate;
+  double next = (floor(elapsed / 1e6) + 1) * 1e6 / rate;       // esp time of the next rollover, from Base_us
+  esp_timer_start_once(Timer, (uint64_t)(Base_us + (int64_t)ceil(next) + 1 - Sim_Time_Now()));
+}
+void Sim_PCF85063::Wire_Int(int Gpio)
+{
+  Int_gpio = Gpio;
+  if (Timer == NULL && Gpio >= 0) {
+    esp_timer_create_args_t args = {};
+    args.callback = Int_Timer;
+    args.arg = this;
+    args.name = "sim pcf85063";
+    esp_timer_create(&args, &Timer);
+  }
+  if (Gpio >= 0)
+    Sim_Gpio_Trigger(Gpio, HIGH);                               // Open drain, pulled up
+  Arm_Int();
+}
+
+time_t Sim_PCF85063::Now(void)
+{
+  if (Regs[PCF_CTRL1] & 0x20)                                   // STOP
+    return Base_s;
+  double elapsed = (Sim_Time_Now() - Base_us) * (1.0 + Drift_ppm * 1e-6);
+  return Base_s + (time_t)(elapsed / 1e6);
+}
+
+uint8_t Sim_PCF85063::On_Read(uint8_t reg)
+{
+  if (reg < PCF_SECONDS || reg > PCF_YEARS)
+    return Regs[reg];
+  time_t now = Now();
+  struct tm tm;
+  gmtime_r(&now, &tm);
+  switch (reg) {
+    case 0x04: return Pcf_To_Bcd(tm.tm_sec);
+    case 0x05: return Pcf_To_Bcd(tm.tm_min);
+    case 0x06: return Pcf_To_Bcd(tm.tm_hour);
+    case 0x07: return Pcf_To_Bcd(tm.tm_mday);
+    case 0x08: return (uint8_t)(((tm.tm_wday + Wday_offset) % 7 + 7) % 7);
+    case 0x09: return Pcf_To_Bcd(tm.tm_mon + 1);
+    default:   return Pcf_To_Bcd((tm.tm_year + 1900 - 2000) % 100);
+  }
+}
+
+// Time registers are applied one at a time, each write restarts the prescaler like on the chip
+void Sim_PCF85063::On_Write(uint8_t reg, uint8_t value)
+{
+  if (reg == PCF_CTRL1) {
+    if (value & 0x10) {                                         // Software reset
+      memset(Regs, 0, 0x12);
+      for (uint8_t r = 0x0B; r <= 0x0F; r++)
+        Regs[r] = 0x80;
+      Set(946684800);                                           // 2000-01-01 00:00:00
+      return;
+    }
+    Base_s = Now();                                             // Freezes on STOP, restarts from the frozen time on release
+    Base_us = Sim_Time_Now();
+    Regs[PCF_CTRL1] = value;
+    Arm_Int();
+    return;
+  }
+  if (reg < PCF_SECONDS || reg > PCF_YEARS) {
+    Regs[reg] = value;
+    return;
+  }
+  time_t now = Now();
+  struct tm tm;
+  gmtime_r(&now, &tm);
+  int wday = ((tm.tm_wday + Wday_offset) % 7 + 7) % 7;
+  switch (reg) {
+    case 0x04: tm.tm_sec  = Pcf_From_Bcd(value & 0x7F); break;
+    case 0x05: tm.tm_min  = Pcf_From_Bcd(value & 0x7F); break;
+    case 0x06: tm.tm_hour = Pcf_From_Bcd(value & 0x3F); break;
+    case 0x07: tm.tm_mday = Pcf_From_Bcd(value & 0x3F); break;
+    case 0x08: wday = value & 0x07; break;
+    case 0x09: tm.tm_mon  = Pcf_From_Bcd(value & 0x1F) - 1; break;
+    default:   tm.tm_year = Pcf_From_Bcd(value) + 2000 - 1900; break;
+  }
+  Base_s = timegm(&tm);
+  Base_us = Sim_Time_Now();
+  gmtime_r(&Base_s, &tm);
+  Wday_offset = wday - tm.tm_wday;
+  Arm_Int();
+}
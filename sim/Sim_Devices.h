@@ -0,0 +1,163 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "Sim_Bus.h"
+#include "esp_timer.h"
+
+// Register-level models of the four I2C devices on the board. They implement what the drivers touch,
+// not full datasheets: anything unmodelled reads back as the last value written.
+
+/********************************************************** 8-bit register file **********************************************************/
+class Sim_Reg8_Device : public Sim_Device {
+public:
+  Sim_Reg8_Device(uint8_t Addr, const char *Name) : Sim_Device(Addr, Name) { memset(Regs, 0, sizeof(Regs)); }
+  esp_err_t Read(const uint8_t *Reg, size_t Reg_len, uint8_t *Data, size_t Length) override;
+  esp_err_t Write(const uint8_t *Reg, size_t Reg_len, const uint8_t *Data, size_t Length) override;
+
+  uint8_t  Regs[256];
+  uint32_t Reads[256];                                          // Per-register access counters
+  uint32_t Writes[256];
+
+protected:
+  virtual void    Before_Access(void) {}                        // Bring time-dependent registers up to date
+  virtual uint8_t On_Read(uint8_t reg) { return Regs[reg]; }
+  virtual void    On_Write(uint8_t reg, uint8_t value) { Regs[reg] = value; }
+  virtual uint8_t Next_Reg(uint8_t reg) { return reg + 1; }     // Address auto-increment inside a burst
+};
+
+/********************************************************** TCA9554 **********************************************************/
+class Sim_TCA9554 : public Sim_Reg8_Device {
+public:
+  Sim_TCA9554(uint8_t Addr = 0x20);
+  uint8_t Pins(void);                                           // Levels seen on the pins (outputs driven, inputs from External)
+  bool    Pin(uint8_t Pin) { return (Pins() >> (Pin - 1)) & 0x01; }   // EXIO_PIN1..8
+  uint8_t External;                                             // Levels applied to pins configured as inputs
+protected:
+  uint8_t On_Read(uint8_t reg) override;
+  void    On_Write(uint8_t reg, uint8_t value) override;
+};
+
+/********************************************************** GT911 **********************************************************/
+#define SIM_GT911_MAX_POINTS  5
+
+typedef struct {
+  uint16_t X;
+  uint16_t Y;
+  uint16_t Size;
+} Sim_Touch_Point_t;
+
+class Sim_GT911 : public Sim_Device {
+public:
+  Sim_GT911(uint8_t Addr = 0x5D, uint16_t X_res = 480, uint16_t Y_res = 640);
+  bool      Ack(void) override;
+  esp_err_t Read(const uint8_t *Reg, size_t Reg_len, uint8_t *Data, size_t Length) override;
+  esp_err_t Write(const uint8_t *Reg, size_t Reg_len, const uint8_t *Data, size_t Length) override;
+
+  void Touch(const Sim_Touch_Point_t *points, uint8_t count);   // Held until Release(), reported every Report_period_us
+  void Release(void);
+  void Wire_Reset(Sim_TCA9554 *expander, uint8_t Pin);          // Device NACKs while that expander pin is low
+  void Wire_Int(int Gpio);                                      // Pulse Gpio low when a report becomes ready
+
+  uint32_t Report_period_us = 10000;                            // 100 Hz, the GT911 default
+  uint32_t Reports = 0;                                         // Reports made available
+  uint32_t Reports_read = 0;                                    // Reports acknowledged by the host (status cleared)
+
+private:
+  static void Report_Timer(void *arg);
+  void     Update(void);
+  uint8_t *Reg_Ptr(uint16_t reg);
+
+  uint8_t  Config[0x100];                                       // 0x8040..0x813F
+  uint8_t  Info[0x40];                                          // 0x8140..0x817F: ID, resolution, status and points
+  Sim_Touch_Point_t Held[SIM_GT911_MAX_POINTS];
+  uint8_t  Held_count = 0;
+  bool     Release_pending = false;
+  int64_t  Next_report_us = 0;
+  Sim_TCA9554 *Reset_expander = NULL;
+  uint8_t  Reset_pin = 0;
+  int      Int_gpio = -1;
+  esp_timer_handle_t Timer = NULL;
+};
+
+/********************************************************** QMI8658 **********************************************************/
+class Sim_QMI8658 : public Sim_Reg8_Device {
+public:
+  Sim_QMI8658(uint8_t Addr = 0x6B);
+
+  // Motion fed to both the data registers and the FIFO: constant gravity vector and rotation rate,
+  // plus an optional sinusoidal vibration on every accel axis
+  float Gravity_g[3] = {0.0f, 0.0f, 1.0f};
+  float Rate_dps[3]  = {0.0f, 0.0f, 0.0f};
+  float Vibration_hz = 0.0f;
+  float Vibration_g  = 0.0f;
+  float Temperature_c = 25.0f;
+  uint32_t Cmd_delay_us = 200;                                  // CTRL9 execution time before CmdDone is raised
+
+  void     Wire_Int1(int Gpio);                                 // Raise Gpio on CmdDone until the ack (CTRL1.INT1_EN, CTRL8.7 clear)
+  void     Wire_Int2(int Gpio);                                 // Raise Gpio while the FIFO is at/above the watermark (CTRL1.INT2_EN),
+                                                                // or toggle it per Wake on Motion event when armed on INT2
+  float    Odr_hz(void);                                        // Current output data rate, 0 when sensors are off
+  uint32_t Samples = 0;                                         // Samples generated since power-up
+  uint32_t Fifo_overflows = 0;                                  // Samples the FIFO had to drop
+  uint32_t Wom_events = 0;                                      // Wake on Motion events raised
+  uint32_t Fifo_level_bytes(void) { return Fifo_count; }
+
+protected:
+  void    Before_Access(void) override;
+  uint8_t On_Read(uint8_t reg) override;
+  void    On_Write(uint8_t reg, uint8_t value) override;
+  uint8_t Next_Reg(uint8_t reg) override;
+
+private:
+  static void Int_Timer(void *arg);
+  static void Cmd_Timer(void *arg);
+  void     Generate(int64_t t_us);
+  void     Command(uint8_t cmd);
+  void     Wom_Sample(float vib);
+  uint8_t  Frame_bytes(void);
+  uint32_t Fifo_capacity(void);                                 // In bytes, from FIFO_CTRL size and enabled sensors
+  void     Fifo_Status_Update(void);
+
+  int64_t  Last_sample_us = 0;
+  int64_t  Cmd_done_us = -1;                                    // Pending CTRL9 completion time, -1 when idle
+  uint8_t  Fifo[128 * 12];
+  uint32_t Fifo_head = 0;
+  uint32_t Fifo_count = 0;
+  bool     Fifo_lost = false;                                   // FIFO_STATUS overflow flag
+  uint8_t  Wom_threshold_mg = 0;                                // Latched by CTRL_CMD_WRITE_WOM_SETTING, 0: off
+  uint8_t  Wom_config = 0;                                      // CAL1_H: pin, initial level, blanking
+  uint8_t  Wom_blanking = 0;
+  bool     Wom_level = false;
+  bool     Wom_primed = false;
+  float    Wom_prev_g[3] = {};
+  int      Int1_gpio = -1;
+  int      Int2_gpio = -1;
+  esp_timer_handle_t Timer = NULL;
+  esp_timer_handle_t Cmd_timer = NULL;
+};
+
+/********************************************************** PCF85063 **********************************************************/
+class Sim_PCF85063 : public Sim_Reg8_Device {
+public:
+  Sim_PCF85063(uint8_t Addr = 0x51);
+  void    Set(time_t t);                                        // Calendar years are 2000 + year register, like the chip's leap rule
+  time_t  Now(void);
+  int64_t Now_us(void);                                         // Including how far the prescaler is into the second
+  void    Wire_Int(int Gpio);                                   // Pulse Gpio low as the seconds roll over to 00 / 30 (CTRL2 MI / HMI)
+  double  Drift_ppm = 0.0;                                      // Crystal error applied to elapsed time
+
+protected:
+  uint8_t On_Read(uint8_t reg) override;
+  void    On_Write(uint8_t reg, uint8_t value) override;
+  uint8_t Next_Reg(uint8_t reg) override { return reg >= 0x11 ? 0x00 : reg + 1; }
+
+private:
+  static void Int_Timer(void *arg);
+  void    Arm_Int(void);
+  time_t  Base_s = 0;                                           // Time at Base_us
+  int64_t Base_us = 0;
+  int     Wday_offset = 0;                                      // Weekday register runs independently of the date
+  int     Int_gpio = -1;
+  esp_timer_handle_t Timer = NULL;                              // Next seconds rollover
+};
@@ -0,0 +1,687 @@
+// FreeRTOS, Arduino and esp_timer stand-ins for the host build. Single-threaded: no task is ever created,
+// a blocking take on an empty semaphore advances the virtual clock by the timeout and fails.
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include "Arduino.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "ff.h"
+#include "esp_partition.h"
+#include "Sim_Time.h"
+
+/********************************************************** Virtual clock **********************************************************/
+#define SIM_MAX_TIMERS 8
+struct Sim_Timer {
+  esp_timer_create_args_t Args;
+  int64_t  Due_us;
+  uint64_t Period_us;
+  bool     Armed;
+};
+static Sim_Timer Sim_Timers[SIM_MAX_TIMERS];
+static bool      Sim_Timers_Running = false;
+static int64_t   Sim_Now_us = 0;
+
+int64_t Sim_Time_Now(void)
+{
+  return Sim_Now_us;
+}
+
+// Steps the clock through every timer expiry on the way, so callbacks see their own due time.
+// Time spent inside a callback (a nested advance) just moves the clock, it does not fire timers.
+void Sim_Time_Advance(int64_t us)
+{
+  if (us <= 0)
+    return;
+  int64_t target = Sim_Now_us + us;
+  if (!Sim_Timers_Running) {
+    Sim_Timers_Running = true;
+    while (1) {
+      Sim_Timer *next = NULL;
+      for (int i = 0; i < SIM_MAX_TIMERS; i++)
+        if (Sim_Timers[i].Armed && Sim_Timers[i].Due_us <= target && (next == NULL || Sim_Timers[i].Due_us < next->Due_us))
+          next = &Sim_Timers[i];
+      if (next == NULL)
+        break;
+      if (next->Due_us > Sim_Now_us)
+        Sim_Now_us = next->Due_us;
+      if (next->Period_us)
+        next->Due_us += next->Period_us;
+      else
+        next->Armed = false;
+      next->Args.callback(next->Args.arg);
+    }
+    Sim_Timers_Running = false;
+  }
+  if (target > Sim_Now_us)
+    Sim_Now_us = target;
+}
+// Time until the next timer expiry, the only thing that can happen while everything waits
+static int64_t Sim_Time_To_Next_Timer(void)
+{
+  int64_t next = INT64_MAX;
+  for (int i = 0; i < SIM_MAX_TIMERS; i++)
+    if (Sim_Timers[i].Armed)
+      next = std::min<int64_t>(next, Sim_Timers[i].Due_us - Sim_Now_us);
+  return std::max<int64_t>(next, 1);
+}
+void Sim_Time_Reset(void)
+{
+  Sim_Now_us = 0;
+}
+
+/********************************************************** esp_timer **********************************************************/
+static bool    Sim_Follow_Host = false;
+static int64_t Sim_Host_Last_us = 0;
+
+static int64_t Sim_Host_Us(void)
+{
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (int64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+void Sim_Time_Follow_Host(bool On)
+{
+  Sim_Follow_Host = On;
+  Sim_Host_Last_us = Sim_Host_Us();
+}
+extern "C" int64_t esp_timer_get_time(void)
+{
+  if (Sim_Follow_Host) {
+    int64_t now = Sim_Host_Us();
+    Sim_Time_Advance(now - Sim_Host_Last_us);
+    Sim_Host_Last_us = now;
+  }
+  return Sim_Now_us;
+}
+extern "C" esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *timer)
+{
+  for (int i = 0; i < SIM_MAX_TIMERS; i++) {
+    if (Sim_Timers[i].Args.callback == NULL) {
+      Sim_Timers[i].Args = *args;
+      *timer = &Sim_Timers[i];
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NO_MEM;
+}
+extern "C" esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+  timer->Period_us = period_us;
+  timer->Due_us = Sim_Now_us + period_us;
+  timer->Armed = true;
+  return ESP_OK;
+}
+extern "C" esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+  timer->Period_us = 0;
+  timer->Due_us = Sim_Now_us + timeout_us;
+  timer->Armed = true;
+  return ESP_OK;
+}
+extern "C" esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+  if (!timer->Armed)
+    return ESP_ERR_INVALID_STATE;
+  timer->Armed = false;
+  return ESP_OK;
+}
+extern "C" esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+  memset(timer, 0, sizeof(*timer));
+  return ESP_OK;
+}
+
+extern "C" const char *esp_err_to_name(esp_err_t code)
+{
+  switch (code) {
+    case ESP_OK:                   return "ESP_OK";
+    case ESP_FAIL:                 return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:           return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:      return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:    return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:     return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:    return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:          return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC:      return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_INVALID_VERSION:  return "ESP_ERR_INVALID_VERSION";
+    case ESP_ERR_NOT_FINISHED:     return "ESP_ERR_NOT_FINISHED";
+    default:                       return "UNKNOWN ERROR";
+  }
+}
+
+/********************************************************** Tasks **********************************************************/
+extern "C" BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                              UBaseType_t prio, TaskHandle_t *handle, BaseType_t core)
+{
+  if (handle)
+    *handle = NULL;                                             // Callers fall back to running work inline
+  return pdFAIL;
+}
+extern "C" BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio, TaskHandle_t *handle)
+{
+  return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, handle, tskNO_AFFINITY);
+}
+extern "C" TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+  return NULL;
+}
+extern "C" void vTaskDelay(TickType_t ticks)
+{
+  Sim_Time_Advance((int64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+extern "C" void vTaskDelete(TaskHandle_t task)
+{
+}
+extern "C" TickType_t xTaskGetTickCount(void)
+{
+  return (TickType_t)(Sim_Now_us / 1000 / portTICK_PERIOD_MS);
+}
+static uint32_t Sim_Notify_Count = 0;
+extern "C" uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+  if (Sim_Notify_Count == 0 && ticks != portMAX_DELAY)
+    vTaskDelay(ticks);
+  uint32_t count = Sim_Notify_Count;
+  Sim_Notify_Count = clear ? 0 : (count ? count - 1 : 0);
+  return count;
+}
+extern "C" BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+  Sim_Notify_Count++;
+  return pdPASS;
+}
+extern "C" void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+  Sim_Notify_Count++;
+}
+
+/********************************************************** Queues **********************************************************/
+struct Sim_Queue {
+  uint8_t    *Items;
+  UBaseType_t Length;
+  UBaseType_t Item_size;
+  UBaseType_t Head;
+  UBaseType_t Count;
+};
+
+extern "C" QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+  Sim_Queue *q = (Sim_Queue *)calloc(1, sizeof(Sim_Queue));
+  q->Items = (uint8_t *)calloc(length, item_size);
+  q->Length = length;
+  q->Item_size = item_size;
+  return q;
+}
+extern "C" BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+  if (q->Count == q->Length) {
+    if (ticks != portMAX_DELAY)
+      vTaskDelay(ticks);
+    return pdFALSE;                                             // Nobody else can drain it while we wait
+  }
+  memcpy(q->Items + ((q->Head + q->Count) % q->Length) * q->Item_size, item, q->Item_size);
+  q->Count++;
+  return pdTRUE;
+}
+extern "C" BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item, BaseType_t *woken)
+{
+  return xQueueSend(q, item, 0);
+}
+extern "C" BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+  if (q->Count == 0) {
+    if (ticks != portMAX_DELAY)
+      vTaskDelay(ticks);
+    return pdFALSE;
+  }
+  memcpy(item, q->Items + q->Head * q->Item_size, q->Item_size);
+  q->Head = (q->Head + 1) % q->Length;
+  q->Count--;
+  return pdTRUE;
+}
+extern "C" BaseType_t xQueuePeek(QueueHandle_t q, void *item, TickType_t ticks)
+{
+  if (q->Count == 0) {
+    if (ticks != portMAX_DELAY)
+      vTaskDelay(ticks);
+    return pdFALSE;
+  }
+  memcpy(item, q->Items + q->Head * q->Item_size, q->Item_size);
+  return pdTRUE;
+}
+extern "C" BaseType_t xQueueReset(QueueHandle_t q)
+{
+  q->Head = 0;
+  q->Count = 0;
+  return pdTRUE;
+}
+extern "C" UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+  return q->Count;
+}
+extern "C" void vQueueDelete(QueueHandle_t q)
+{
+  free(q->Items);
+  free(q);
+}
+
+/********************************************************** Semaphores **********************************************************/
+struct Sim_Semaphore {
+  UBaseType_t Count;
+  UBaseType_t Max;
+  UBaseType_t Depth;                                            // Recursive mutex nesting
+  bool        Static;
+};
+static_assert(sizeof(Sim_Semaphore) <= sizeof(StaticSemaphore_t), "StaticSemaphore_t too small");
+
+static SemaphoreHandle_t Sim_Semaphore_New(UBaseType_t max, UBaseType_t initial)
+{
+  Sim_Semaphore *s = (Sim_Semaphore *)calloc(1, sizeof(Sim_Semaphore));
+  s->Max = max;
+  s->Count = initial;
+  return s;
+}
+extern "C" SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+  return Sim_Semaphore_New(1, 0);
+}
+extern "C" SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer)
+{
+  Sim_Semaphore *s = (Sim_Semaphore *)buffer;
+  memset(s, 0, sizeof(*s));
+  s->Max = 1;
+  s->Static = true;
+  return s;
+}
+extern "C" SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+  return Sim_Semaphore_New(max, initial);
+}
+extern "C" SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+  return Sim_Semaphore_New(1, 1);
+}
+extern "C" SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+  return Sim_Semaphore_New(1, 1);
+}
+extern "C" BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks)
+{
+  if (s->Count == 0) {
+    if (ticks == portMAX_DELAY) {
+      printf("sim: blocking forever on an empty semaphore, nothing can give it\n");
+      abort();
+    }
+    // Only an interrupt, i.e. a timer callback, can give it while we wait: advance from one expiry to the next
+    int64_t deadline = Sim_Time_Now() + (int64_t)ticks * portTICK_PERIOD_MS * 1000;
+    while (s->Count == 0 && Sim_Time_Now() < deadline)
+      Sim_Time_Advance(std::min<int64_t>(Sim_Time_To_Next_Timer(), deadline - Sim_Time_Now()));
+    if (s->Count == 0)
+      return pdFALSE;
+  }
+  s->Count--;
+  return pdTRUE;
+}
+extern "C" BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{
+  if (s->Count >= s->Max)
+    return pdFALSE;
+  s->Count++;
+  return pdTRUE;
+}
+extern "C" BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t s, BaseType_t *woken)
+{
+  return xSemaphoreGive(s);
+}
+extern "C" BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t s, TickType_t ticks)
+{
+  s->Depth++;                                                   // Single thread: the caller always owns it
+  return pdTRUE;
+}
+extern "C" BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t s)
+{
+  if (s->Depth == 0)
+    return pdFALSE;
+  s->Depth--;
+  return pdTRUE;
+}
+extern "C" void vSemaphoreDelete(SemaphoreHandle_t s)
+{
+  if (!s->Static)
+    free(s);
+}
+
+/********************************************************** Arduino **********************************************************/
+#define SIM_GPIO_COUNT 49
+static uint8_t Sim_Gpio_Mode[SIM_GPIO_COUNT];
+static uint8_t Sim_Gpio_Level[SIM_GPIO_COUNT];
+static void  (*Sim_Gpio_Isr[SIM_GPIO_COUNT])(void);
+static int     Sim_Gpio_Edge[SIM_GPIO_COUNT];
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if (pin < SIM_GPIO_COUNT)
+    Sim_Gpio_Mode[pin] = mode;
+}
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  if (pin < SIM_GPIO_COUNT)
+    Sim_Gpio_Level[pin] = val ? HIGH : LOW;
+}
+int digitalRead(uint8_t pin)
+{
+  return pin < SIM_GPIO_COUNT ? Sim_Gpio_Level[pin] : LOW;
+}
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode)
+{
+  if (pin < SIM_GPIO_COUNT) {
+    Sim_Gpio_Isr[pin] = isr;
+    Sim_Gpio_Edge[pin] = mode;
+  }
+}
+void detachInterrupt(uint8_t pin)
+{
+  if (pin < SIM_GPIO_COUNT)
+    Sim_Gpio_Isr[pin] = NULL;
+}
+void Sim_Gpio_Trigger(uint8_t pin, uint8_t level)
+{
+  if (pin >= SIM_GPIO_COUNT)
+    return;
+  uint8_t old = Sim_Gpio_Level[pin];
+  Sim_Gpio_Level[pin] = level ? HIGH : LOW;
+  if (Sim_Gpio_Isr[pin] == NULL || old == Sim_Gpio_Level[pin])
+    return;
+  int edge = Sim_Gpio_Level[pin] ? RISING : FALLING;
+  if (Sim_Gpio_Edge[pin] == CHANGE || Sim_Gpio_Edge[pin] == edge)
+    Sim_Gpio_Isr[pin]();
+}
+void noInterrupts(void)
+{
+}
+void interrupts(void)
+{
+}
+void delay(uint32_t ms)
+{
+  Sim_Time_Advance((int64_t)ms * 1000);
+}
+void delayMicroseconds(uint32_t us)
+{
+  Sim_Time_Advance(us);
+}
+uint32_t millis(void)
+{
+  return (uint32_t)(Sim_Now_us / 1000);
+}
+uint32_t micros(void)
+{
+  return (uint32_t)Sim_Now_us;
+}
+void analogReadResolution(uint8_t bits)
+{
+}
+uint32_t analogReadMilliVolts(uint8_t pin)                      // No ADC on the host
+{
+  return 0;
+}
+
+Sim_Serial_t Serial;
+void (*Sim_Serial_Write)(const uint8_t *buf, size_t size) = NULL;
+
+size_t Sim_Serial_t::write(const uint8_t *buf, size_t size)
+{
+  if (Sim_Serial_Write)
+    Sim_Serial_Write(buf, size);
+  return size;
+}
+
+/********************************************************** FATFS **********************************************************/
+#define SIM_FATFS_CLUSTER  32768
+#define SIM_FATFS_CLUSTERS 1000000                              // A 32 GB card
+
+const char *Sim_Fatfs_Root = "sim/build/sdcard";
+
+static void Sim_Fatfs_Path(char *host, size_t size, const TCHAR *path)
+{
+  if (path[0] >= '0' && path[0] <= '9' && path[1] == ':')
+    path += 2;
+  snprintf(host, size, "%s/%s", Sim_Fatfs_Root, path[0] == '/' ? path + 1 : path);
+}
+
+static void Sim_Fatfs_Info(const struct stat *st, const char *name, FILINFO *fno)
+{
+  struct tm t;
+  localtime_r(&st->st_mtime, &t);
+  memset(fno, 0, sizeof(*fno));
+  fno->fsize = S_ISDIR(st->st_mode) ? 0 : (FSIZE_t)st->st_size;
+  fno->fdate = (WORD)((t.tm_year - 80) << 9 | (t.tm_mon + 1) << 5 | t.tm_mday);
+  fno->ftime = (WORD)(t.tm_hour << 11 | t.tm_min << 5 | t.tm_sec / 2);
+  fno->fattrib = S_ISDIR(st->st_mode) ? AM_DIR : AM_ARC;
+  snprintf(fno->fname, sizeof(fno->fname), "%s", name);
+}
+
+extern "C" FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode)
+{
+  char host[512];
+  Sim_Fatfs_Path(host, sizeof(host), path);
+  const char *how = !(mode & FA_WRITE) ? "rb" : (mode & FA_CREATE_ALWAYS) ? "w+b" : "r+b";
+  fp->File = fopen(host, how);
+  if (fp->File == NULL)
+    return FR_NO_FILE;
+  fseek(fp->File, 0, SEEK_END);
+  fp->Size = (FSIZE_t)ftell(fp->File);
+  fseek(fp->File, 0, SEEK_SET);
+  return FR_OK;
+}
+
+extern "C" FRESULT f_close(FIL *fp)
+{
+  return fclose(fp->File) == 0 ? FR_OK : FR_DISK_ERR;
+}
+
+extern "C" FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br)
+{
+  *br = (UINT)fread(buff, 1, btr, fp->File);
+  return ferror(fp->File) ? FR_DISK_ERR : FR_OK;
+}
+
+extern "C" FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw)
+{
+  *bw = (UINT)fwrite(buff, 1, btw, fp->File);
+  return *bw == btw ? FR_OK : FR_DISK_ERR;
+}
+
+extern "C" FRESULT f_lseek(FIL *fp, FSIZE_t ofs)
+{
+  return fseek(fp->File, ofs, SEEK_SET) == 0 ? FR_OK : FR_DISK_ERR;
+}
+
+extern "C" FRESULT f_opendir(FF_DIR *dp, const TCHAR *path)
+{
+  Sim_Fatfs_Path(dp->Path, sizeof(dp->Path), path);
+  dp->Dir = opendir(dp->Path);
+  return dp->Dir ? FR_OK : FR_NO_PATH;
+}
+
+extern "C" FRESULT f_closedir(FF_DIR *dp)
+{
+  closedir((DIR *)dp->Dir);
+  return FR_OK;
+}
+
+extern "C" FRESULT f_readdir(FF_DIR *dp, FILINFO *fno)
+{
+  struct dirent *e;
+  do {
+    e = readdir((DIR *)dp->Dir);
+  } while (e && (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0));
+  if (e == NULL) {
+    fno->fname[0] = '\0';
+    return FR_OK;
+  }
+  char host[1024];
+  struct stat st;
+  snprintf(host, sizeof(host), "%s/%s", dp->Path, e->d_name);
+  if (stat(host, &st) != 0)
+    return FR_DISK_ERR;
+  Sim_Fatfs_Info(&st, e->d_name, fno);
+  return FR_OK;
+}
+
+extern "C" FRESULT f_stat(const TCHAR *path, FILINFO *fno)
+{
+  char host[512];
+  struct stat st;
+  Sim_Fatfs_Path(host, sizeof(host), path);
+  if (stat(host, &st) != 0)
+    return FR_NO_FILE;
+  const char *name = strrchr(host, '/');
+  Sim_Fatfs_Info(&st, name ? name + 1 : host, fno);
+  return FR_OK;
+}
+
+static uint64_t Sim_Fatfs_Used(const char *dir)
+{
+  uint64_t clusters = 0;
+  DIR *d = opendir(dir);
+  struct dirent *e;
+  while (d && (e = readdir(d)) != NULL) {
+    if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0)
+      continue;
+    char path[1024];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+    if (stat(path, &st) != 0)
+      continue;
+    clusters += S_ISDIR(st.st_mode) ? 1 + Sim_Fatfs_Used(path)
+                                    : (st.st_size + SIM_FATFS_CLUSTER - 1) / SIM_FATFS_CLUSTER;
+  }
+  if (d)
+    closedir(d);
+  return clusters;
+}
+
+extern "C" FRESULT f_getfree(const TCHAR *path, DWORD *nclst, FATFS **fatfs)
+{
+  static FATFS fs = {SIM_FATFS_CLUSTERS + 2, SIM_FATFS_CLUSTER / 512};
+  *nclst = (DWORD)(SIM_FATFS_CLUSTERS - Sim_Fatfs_Used(Sim_Fatfs_Root));
+  *fatfs = &fs;
+  return FR_OK;
+}
+
+/********************************************************** Flash partitions **********************************************************/
+#define SIM_FLASH_SIZE       (16u << 20)
+#define SIM_FLASH_PARTITIONS 16
+
+const char       *Sim_Flash_Table = "partitions_assets.csv";
+Sim_Flash_Stats_t Sim_Flash_Stats;
+static uint8_t        *Sim_Flash = NULL;
+static esp_partition_t Sim_Partitions[SIM_FLASH_PARTITIONS];
+static int             Sim_Partition_Count = -1;
+
+// "name, type, subtype, offset, size" lines of the CSV; subtypes by number or by the names the table uses
+static void Sim_Flash_Load_Table(void)
+{
+  Sim_Partition_Count = 0;
+  Sim_Flash = (uint8_t *)malloc(SIM_FLASH_SIZE);
+  memset(Sim_Flash, 0xFF, SIM_FLASH_SIZE);
+  FILE *f = fopen(Sim_Flash_Table, "r");
+  if (f == NULL) {
+    printf("Sim flash: no partition table %s\n", Sim_Flash_Table);
+    return;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), f) && Sim_Partition_Count < SIM_FLASH_PARTITIONS) {
+    char name[32], type[16], subtype[16];
+    int offset, size;
+    if (line[0] == '#' || sscanf(line, " %31[^, ] , %15[^, ] , %15[^, ] , %i , %i", name, type, subtype, &offset,
+                                 &size) != 5)
+      continue;
+    esp_partition_t *p = &Sim_Partitions[Sim_Partition_Count++];
+    memset(p, 0, sizeof(*p));
+    snprintf(p->label, sizeof(p->label), "%s", name);
+    p->type = strcmp(type, "app") == 0 ? ESP_PARTITION_TYPE_APP : ESP_PARTITION_TYPE_DATA;
+    static const struct { const char *Name; int Value; } Subtypes[] = {
+      {"ota_0", 0x10}, {"ota_1", 0x11}, {"factory", 0x00}, {"ota", 0x00}, {"phy", 0x01}, {"nvs", 0x02},
+      {"coredump", 0x03}, {"spiffs", 0x82}, {"fat", 0x81},
+    };
+    int sub = (int)strtol(subtype, NULL, 0);
+    for (const auto &st : Subtypes)
+      sub = strcmp(subtype, st.Name) == 0 ? st.Value : sub;
+    p->subtype = (esp_partition_subtype_t)sub;
+    p->address = (uint32_t)offset;
+    p->size = offset >= 0 && size >= 0 && (uint32_t)offset + (uint32_t)size <= SIM_FLASH_SIZE ? (uint32_t)size : 0;
+    p->erase_size = SPI_FLASH_SEC_SIZE;
+  }
+  fclose(f);
+}
+
+extern "C" const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                           const char *label)
+{
+  if (Sim_Partition_Count < 0)
+    Sim_Flash_Load_Table();
+  for (int i = 0; i < Sim_Partition_Count; i++) {
+    const esp_partition_t *p = &Sim_Partitions[i];
+    if ((type == ESP_PARTITION_TYPE_ANY || p->type == type) &&
+        (subtype == ESP_PARTITION_SUBTYPE_ANY || p->subtype == subtype) && (label == NULL || strcmp(p->label, label) == 0))
+      return p;
+  }
+  return NULL;
+}
+
+extern "C" esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+  if (src_offset > partition->size || size > partition->size - src_offset)
+    return ESP_ERR_INVALID_SIZE;
+  memcpy(dst, Sim_Flash + partition->address + src_offset, size);
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src,
+                                         size_t size)
+{
+  if (dst_offset > partition->size || size > partition->size - dst_offset)
+    return ESP_ERR_INVALID_SIZE;
+  uint8_t *d = Sim_Flash + partition->address + dst_offset;
+  for (size_t i = 0; i < size; i++)
+    d[i] &= ((const uint8_t *)src)[i];                          // Programming clears bits, only an erase sets them
+  Sim_Flash_Stats.Written += size;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+  if (offset % SPI_FLASH_SEC_SIZE || size % SPI_FLASH_SEC_SIZE)
+    return ESP_ERR_INVALID_ARG;
+  if (offset > partition->size || size > partition->size - offset)
+    return ESP_ERR_INVALID_SIZE;
+  memset(Sim_Flash + partition->address + offset, 0xFF, size);
+  Sim_Flash_Stats.Erased += size;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+                                        esp_partition_mmap_memory_t memory, const void **out_ptr,
+                                        esp_partition_mmap_handle_t *out_handle)
+{
+  if (offset > partition->size || size > partition->size - offset)
+    return ESP_ERR_INVALID_ARG;
+  *out_ptr = Sim_Flash + partition->address + offset;
+  *out_handle = ++Sim_Flash_Stats.Maps;
+  Sim_Flash_Stats.Mapped++;
+  return ESP_OK;
+}
+
+extern "C" void esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+  Sim_Flash_Stats.Mapped--;
+}
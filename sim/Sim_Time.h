@@ -0,0 +1,12 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Virtual time in microseconds. It only moves when something waits: delays, blocked semaphores and bus transfers,
+// which makes runs deterministic and independent of how fast the host is.
+int64_t Sim_Time_Now(void);
+void    Sim_Time_Advance(int64_t us);
+void    Sim_Time_Reset(void);
+// While on, esp_timer_get_time() also counts the host time that passed since its last call, so benches of code that
+// computes rather than waits can time it with the firmware's own measurements
+void    Sim_Time_Follow_Host(bool On);
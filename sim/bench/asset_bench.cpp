@@ -0,0 +1,246 @@
+// Host bench for the asset pack loader (src/Asset_Pack.cpp) and its builder (tools/asset_pack.py).
+//
+// Writes a set of LVGL images (RGB565A8 icons with flat areas and anti-aliased edges, the kind SquareLine exports,
+// and a few noisy photos that LZ4 cannot shrink) as .bin files into a directory, packs the directory with the
+// Python tool, then:
+//   - checks that every asset the loader returns, LZ4 or stored, is byte for byte the file it was packed from;
+//   - reads every entry as an lv_fs file in odd pieces: the photos, packed with --store, must stream from the card
+//     without being loaded;
+//   - holds some images while loading all of them twice over, which must evict only unheld ones and never exceed
+//     ASSET_PACK_CACHE_SIZE;
+//   - compares the card time of loading every asset from the pack with opening each file in the directory.
+// Card time is modelled with the constants of sim/bench/sdcache_bench.cpp, plus FATFS looking the file up in its
+// directory on open: LFN entries take ~96 bytes per file, scanned from the start of the directory.
+//
+// Build from the repository root:
+//   mkdir -p sim/build
+//   g++ -std=gnu++17 -O2 -Wno-format -Isim -Isim/include -Isrc -Ilib/lvgl -DLV_CONF_SKIP -DLV_USE_LZ4_INTERNAL=1
+//       sim/bench/asset_bench.cpp src/Asset_Pack.cpp src/SD_Cache.cpp sim/Sim_Runtime.cpp lib/lvgl/src/libs/lz4/lz4.c
+//       -o sim/build/asset_bench
+// (one command line)
+// Run:
+//   sim/build/asset_bench [icons] [photos]          default: 120 64x64 icons, 12 200x200 photos
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "SD_Cache.h"
+#include "Asset_Pack.h"
+
+#define BENCH_CMD_US        200.0                               // One SDMMC read command
+#define BENCH_BYTES_PER_US  5.0                                 // 1-bit bus at 40 MHz
+#define BENCH_COPY_PER_US   40.0                                // Bytes/us of memcpy to or from PSRAM
+#define BENCH_OPEN_US       150.0                               // open() through VFS and FATFS, card time apart
+#define BENCH_SECTOR        512
+#define BENCH_DIR_ENTRY     96                                  // Short entry and two LFN entries
+#define BENCH_DIR           "sim/build/bench_assets"
+#define BENCH_PACK          "sim/build/bench_assets.pak"
+
+static uint32_t Card_reads = 0;
+static double   Card_us = 0;
+
+extern "C" ssize_t pread(int fd, void *buf, size_t count, off_t offset)
+{
+  Card_reads++;
+  Card_us += BENCH_CMD_US + count / BENCH_BYTES_PER_US + count / BENCH_COPY_PER_US;
+  return syscall(SYS_pread64, fd, buf, count, offset);
+}
+
+// The parts of LVGL the loader and lz4.c call; the bench drives the loader through its own API, and its files
+void *lv_memcpy(void *dst, const void *src, size_t len) { return memcpy(dst, src, len); }
+void *lv_memmove(void *dst, const void *src, size_t len) { return memmove(dst, src, len); }
+void lv_memset(void *dst, uint8_t v, size_t len) { memset(dst, v, len); }
+void lv_fs_drv_init(lv_fs_drv_t *drv) { memset(drv, 0, sizeof(*drv)); }
+static lv_fs_drv_t *Pack_Drv = NULL;
+void lv_fs_drv_register(lv_fs_drv_t *drv) { Pack_Drv = drv; }
+void lv_image_cache_drop(const void *src) {}
+lv_font_t *lv_binfont_create(const char *path) { return NULL; }
+
+typedef struct {
+  std::string          Name;
+  std::vector<uint8_t> Blob;
+} Bench_Asset_t;
+
+static std::mt19937 Rng(11);
+
+static std::vector<uint8_t> Image(uint32_t w, uint32_t h, bool photo)
+{
+  std::vector<uint8_t> blob(12 + w * h * 3, 0);
+  lv_image_header_t header = {};
+  header.magic = LV_IMAGE_HEADER_MAGIC;
+  header.cf = LV_COLOR_FORMAT_RGB565A8;
+  header.w = w;
+  header.h = h;
+  header.stride = w * 2;
+  memcpy(blob.data(), &header, sizeof(header));
+  uint8_t *color = blob.data() + 12, *alpha = color + w * h * 2;
+  uint16_t fg = (uint16_t)Rng();
+  float r = w * (0.25f + (Rng() % 20) / 100.0f);
+  for (uint32_t y = 0; y < h; y++) {
+    for (uint32_t x = 0; x < w; x++) {
+      uint32_t i = y * w + x;
+      if (photo) {
+        uint16_t c = (uint16_t)Rng();
+        color[i * 2] = c;
+        color[i * 2 + 1] = c >> 8;
+        alpha[i] = 255;
+        continue;
+      }
+      float d = sqrtf((x - w / 2.0f) * (x - w / 2.0f) + (y - h / 2.0f) * (y - h / 2.0f)) - r;
+      uint8_t a = d <= -1 ? 255 : d >= 1 ? 0 : (uint8_t)(255 * (1 - d) / 2);
+      color[i * 2] = a ? fg : 0;
+      color[i * 2 + 1] = a ? fg >> 8 : 0;
+      alpha[i] = a;
+    }
+  }
+  return blob;
+}
+
+static double Card_Time(double before_us, uint32_t before_reads, uint32_t *reads)
+{
+  *reads = Card_reads - before_reads;
+  return Card_us - before_us;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t icons = argc > 1 ? atoi(argv[1]) : 120, photos = argc > 2 ? atoi(argv[2]) : 12;
+  std::vector<Bench_Asset_t> assets;
+  if (system("rm -rf " BENCH_DIR) != 0 || mkdir(BENCH_DIR, 0755) != 0 || mkdir(BENCH_DIR "/photo", 0755) != 0)
+    return 1;
+  for (uint32_t i = 0; i < icons + photos; i++) {
+    char name[48];
+    bool photo = i >= icons;
+    snprintf(name, sizeof(name), photo ? "photo/p%03u" : "icon_%03u", i);
+    assets.push_back({name, photo ? Image(200, 200, true) : Image(64, 64, false)});
+    FILE *f = fopen((std::string(BENCH_DIR "/") + name + ".bin").c_str(), "wb");
+    fwrite(assets.back().Blob.data(), 1, assets.back().Blob.size(), f);
+    fclose(f);
+  }
+  if (system("python3 tools/asset_pack.py build --lz4 --store 'photo/*' -o " BENCH_PACK " " BENCH_DIR) != 0)
+    return 1;
+  if (system("python3 tools/asset_pack.py verify " BENCH_PACK) != 0)
+    return 1;
+  if (SD_Cache_Init() != ESP_OK || Asset_Pack_Open(BENCH_PACK) != ESP_OK)
+    return 1;
+
+  // Every asset read as a file, as fonts are, in odd pieces: stored ones stream from the card and load nothing
+  bool ok = Asset_Pack_Count() == assets.size() && Pack_Drv != NULL;
+  for (const Bench_Asset_t &a : assets) {
+    void *f = Pack_Drv->open_cb(Pack_Drv, a.Name.c_str(), LV_FS_MODE_RD);
+    std::vector<uint8_t> got(a.Blob.size() + 8);
+    uint32_t pos = 0, br = 1, size = 0;
+    while (f && br) {                                           // Asks past the end: the last read comes back short
+      uint32_t n = std::min<uint32_t>(1 + Rng() % 3000, got.size() - pos);
+      Pack_Drv->read_cb(Pack_Drv, f, got.data() + pos, n, &br);
+      pos += br;
+    }
+    if (f) {
+      Pack_Drv->seek_cb(Pack_Drv, f, 0, LV_FS_SEEK_END);
+      Pack_Drv->tell_cb(Pack_Drv, f, &size);
+      Pack_Drv->close_cb(Pack_Drv, f);
+    }
+    bool same = f && pos == a.Blob.size() && size == pos && memcmp(got.data(), a.Blob.data(), pos) == 0;
+    if (!same)
+      printf("%s: %s\n", a.Name.c_str(), f ? "read as a file, differs from its file" : "cannot be opened");
+    ok &= same;
+  }
+  Asset_Pack_Stats_t fs;
+  Asset_Pack_Get_Stats(&fs);
+  ok &= fs.Loads == fs.Unpacked && fs.Failures == 0;            // Only LZ4 entries were loaded to be read
+
+  // Every asset, compared with its file
+  uint64_t bytes = 0;
+  SD_Cache_Drop();
+  uint32_t reads_pack;
+  double t0 = Card_us;
+  uint32_t r0 = Card_reads;
+  auto l0 = std::chrono::steady_clock::now();
+  for (const Bench_Asset_t &a : assets) {
+    const lv_image_dsc_t *img = Asset_Pack_Image(a.Name.c_str());
+    bool same = img && img->data_size + 12 == a.Blob.size() && memcmp(&img->header, a.Blob.data(), 12) == 0 &&
+                memcmp(img->data, a.Blob.data() + 12, img->data_size) == 0;
+    if (!same)
+      printf("%s: %s\n", a.Name.c_str(), img ? "differs from its file" : "not loaded");
+    ok &= same;
+    bytes += a.Blob.size();
+    Asset_Pack_Release(img);
+  }
+  double load_host_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - l0).count();
+  double pack_us = Card_Time(t0, r0, &reads_pack);
+
+  // The same assets one file each: open (a directory scan) and read through the block cache
+  SD_Cache_Drop();
+  t0 = Card_us;
+  r0 = Card_reads;
+  double open_us = 0;
+  std::vector<uint8_t> buf;
+  for (uint32_t i = 0; i < assets.size(); i++) {
+    std::string path = std::string(BENCH_DIR "/") + assets[i].Name + ".bin";
+    uint32_t dir_pos = (assets[i].Name.rfind("photo/", 0) == 0 ? i - icons : i) * BENCH_DIR_ENTRY;
+    open_us += BENCH_OPEN_US + (dir_pos / BENCH_SECTOR + 1) * (BENCH_CMD_US + BENCH_SECTOR / BENCH_BYTES_PER_US);
+    SD_Cache_File_t *f = SD_Cache_Open(path.c_str());
+    buf.resize(SD_Cache_Size(f));
+    SD_Cache_Read(f, buf.data(), buf.size());
+    SD_Cache_Close(f);
+  }
+  uint32_t reads_files;
+  double files_us = Card_Time(t0, r0, &reads_files) + open_us;
+
+  // Lookups of resident assets: the binary search alone
+  const uint32_t rounds = 200000;
+  auto s0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < rounds; i++)
+    Asset_Pack_Release(Asset_Pack_Image(assets[i % icons].Name.c_str()));
+  double lookup_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - s0).count() / rounds;
+
+  // Hold every tenth icon, load everything twice over: the held ones stay, the cache stays bounded
+  std::vector<const lv_image_dsc_t *> held;
+  for (uint32_t i = 0; i < icons; i += 10)
+    held.push_back(Asset_Pack_Image(assets[i].Name.c_str()));
+  uint32_t peak = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    for (const Bench_Asset_t &a : assets) {
+      Asset_Pack_Release(Asset_Pack_Image(a.Name.c_str()));
+      Asset_Pack_Stats_t st;
+      Asset_Pack_Get_Stats(&st);
+      peak = st.Resident > peak ? st.Resident : peak;
+    }
+  }
+  for (uint32_t k = 0; k < held.size(); k++) {
+    const Bench_Asset_t &a = assets[k * 10];
+    bool same = held[k] && memcmp(held[k]->data, a.Blob.data() + 12, held[k]->data_size) == 0;
+    if (!same)
+      printf("%s: held image changed under eviction\n", a.Name.c_str());
+    ok &= same;
+    Asset_Pack_Release(held[k]);
+  }
+  Asset_Pack_Stats_t st;
+  Asset_Pack_Get_Stats(&st);
+  ok &= peak <= ASSET_PACK_CACHE_SIZE && st.Evictions > 0 && st.Failures == 0;
+  struct stat ps;
+  stat(BENCH_PACK, &ps);
+
+  printf("\nasset bench: %u icons 64x64 + %u photos 200x200 RGB565A8, %llu KB unpacked, pack %ld KB\n", icons, photos,
+         bytes / 1024, (long)ps.st_size / 1024);
+  printf("  one file per asset: %8.1f ms card, %5u reads, %u opens\n", files_us / 1000, reads_files,
+         (uint32_t)assets.size());
+  printf("  asset pack:         %8.1f ms card, %5u reads, 1 open (%.1fx), %.1f ms on the host to unpack\n",
+         pack_us / 1000, reads_pack, files_us / pack_us, load_host_ms);
+  printf("  read as files: %u stored entries streamed from the card, %u LZ4 ones unpacked\n", fs.Lookups - fs.Loads,
+         fs.Unpacked);
+  printf("  lookup of a resident asset: %.0f ns, %u entries\n", lookup_ns, Asset_Pack_Count());
+  printf("  eviction: peak %u KB of %d KB, %u evictions, %u failures, %u held images intact\n", peak / 1024,
+         ASSET_PACK_CACHE_SIZE / 1024, st.Evictions, st.Failures, (uint32_t)held.size());
+  Asset_Pack_Close();
+  printf("%s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
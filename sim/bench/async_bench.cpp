@@ -0,0 +1,306 @@
+// Host bench for asynchronous file I/O (src/SD_Async.cpp) over the block cache and the asset pack.
+//
+// A screen's assets (a background and icons, as LVGL image files and as asset pack entries) are loaded three ways:
+//   - synchronously, as a screen init function does today: the LVGL thread waits for every card read;
+//   - with SD_Async_Image(): the callbacks run from the completion timer, and the LVGL thread only runs those;
+//   - after prefetch hints, then synchronously: every read must be a cache hit.
+// Checks: images handed to callbacks are byte for byte their files, callbacks run only from the timer, cancelled
+// requests never call back, loads overtake queued hints, duplicate and resident hints are skipped, running out of
+// request slots refuses the request, and unknown paths report SD_ASYNC_NOT_FOUND.
+// On the host no task is created, so the timer serves one request per run itself; the bench times the completion
+// part separately (SD_Async_Stats_t.Max_dispatch_us), which is what the LVGL thread is left with on the device.
+// SD_Cache's read-ahead runs inline on the host as well, so when a pack entry is unpacked in the timer, the blocks
+// it fetches ahead count against that run here.
+// Card time is modelled by advancing the virtual clock in pread(), constants as in sim/bench/sdcache_bench.cpp.
+//
+// Build from the repository root:
+//   mkdir -p sim/build
+//   g++ -std=gnu++17 -O2 -Wno-format -Isim -Isim/include -Isrc -Ilib/lvgl -DLV_CONF_SKIP -DLV_USE_LZ4_INTERNAL=1
+//       sim/bench/async_bench.cpp src/SD_Async.cpp src/Asset_Pack.cpp src/SD_Cache.cpp sim/Sim_Runtime.cpp
+//       lib/lvgl/src/libs/lz4/lz4.c -o sim/build/async_bench
+// (one command line)
+// Run:
+//   sim/build/async_bench [icons]                    default: 6 64x64 icons and one 240x240 background
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "SD_Cache.h"
+#include "Asset_Pack.h"
+#include "SD_Async.h"
+#include "Sim_Time.h"
+
+#define BENCH_CMD_US        200.0                               // One SDMMC read command
+#define BENCH_BYTES_PER_US  5.0                                 // 1-bit bus at 40 MHz
+#define BENCH_COPY_PER_US   40.0                                // Bytes/us of memcpy to or from PSRAM
+#define BENCH_DIR           "sim/build/async"
+#define BENCH_PACK          "sim/build/async.pak"
+
+static uint32_t Card_reads = 0;
+
+extern "C" ssize_t pread(int fd, void *buf, size_t count, off_t offset)
+{
+  Card_reads++;
+  Sim_Time_Advance((int64_t)(BENCH_CMD_US + count / BENCH_BYTES_PER_US + count / BENCH_COPY_PER_US));
+  return syscall(SYS_pread64, fd, buf, count, offset);
+}
+
+// LVGL: the completion timer and the press event are captured and run by the bench
+static lv_timer_cb_t Timer_Cb = NULL;
+static lv_event_cb_t Press_Cb = NULL;
+static void         *Press_Data = NULL;
+static bool          In_Timer = false;
+void *lv_memcpy(void *dst, const void *src, size_t len) { return memcpy(dst, src, len); }
+void *lv_memmove(void *dst, const void *src, size_t len) { return memmove(dst, src, len); }
+void lv_memset(void *dst, uint8_t v, size_t len) { memset(dst, v, len); }
+void lv_fs_drv_init(lv_fs_drv_t *drv) { memset(drv, 0, sizeof(*drv)); }
+void lv_fs_drv_register(lv_fs_drv_t *drv) {}
+void lv_image_cache_drop(const void *src) {}
+lv_font_t *lv_binfont_create(const char *path) { return NULL; }
+lv_timer_t *lv_timer_create(lv_timer_cb_t cb, uint32_t period, void *user_data)
+{
+  Timer_Cb = cb;
+  return (lv_timer_t *)&Timer_Cb;
+}
+lv_event_dsc_t *lv_obj_add_event_cb(lv_obj_t *obj, lv_event_cb_t cb, lv_event_code_t filter, void *user_data)
+{
+  Press_Cb = cb;
+  Press_Data = user_data;
+  return NULL;
+}
+void *lv_event_get_user_data(lv_event_t *e) { return Press_Data; }
+
+typedef struct {
+  std::string          Name;                                    // Pack entry; the file is Name.bin
+  std::string          Path;                                    // Absolute, as SD_Async takes VFS paths
+  std::vector<uint8_t> Blob;
+} Bench_Asset_t;
+
+static std::mt19937 Rng(3);
+static bool Ok = true;
+static std::vector<Bench_Asset_t> Assets;
+static uint32_t Callbacks = 0;
+
+static void Check(bool Cond, const char *What)
+{
+  if (!Cond)
+    printf("FAILED: %s\n", What);
+  Ok &= Cond;
+}
+
+static std::vector<uint8_t> Image(uint32_t w, uint32_t h)
+{
+  std::vector<uint8_t> blob(12 + w * h * 2);
+  lv_image_header_t header = {};
+  header.magic = LV_IMAGE_HEADER_MAGIC;
+  header.cf = LV_COLOR_FORMAT_RGB565;
+  header.w = w;
+  header.h = h;
+  header.stride = w * 2;
+  memcpy(blob.data(), &header, sizeof(header));
+  uint16_t c = (uint16_t)Rng();
+  for (uint32_t i = 12; i < blob.size(); i += 2) {              // Short runs of one color: LZ4 saves a little
+    if (Rng() % 3 == 0)
+      c = (uint16_t)Rng();
+    blob[i] = (uint8_t)c;
+    blob[i + 1] = (uint8_t)(c >> 8);
+  }
+  return blob;
+}
+
+static void Tick(void)
+{
+  In_Timer = true;
+  Timer_Cb(NULL);
+  In_Timer = false;
+  Sim_Time_Advance(SD_ASYNC_POLL_MS * 1000);
+}
+
+static void Run(uint32_t Ticks)
+{
+  for (uint32_t i = 0; i < Ticks; i++)
+    Tick();
+}
+
+static void Image_Cb(const SD_Async_Result_t *r)
+{
+  const Bench_Asset_t *a = (const Bench_Asset_t *)r->User;
+  Callbacks++;
+  Check(In_Timer, "callback from the completion timer");
+  bool same = r->Status == SD_ASYNC_OK && r->Image && r->Image->data_size + 12 == a->Blob.size() &&
+              memcmp(&r->Image->header, a->Blob.data(), 12) == 0 &&
+              memcmp(r->Image->data, a->Blob.data() + 12, r->Image->data_size) == 0;
+  if (!same)
+    printf("%s: status %d, %s\n", a->Name.c_str(), r->Status, r->Image ? "differs from its file" : "no image");
+  Ok &= same;
+  SD_Async_Release(r->Image);
+}
+
+static void Read_Cb(const SD_Async_Result_t *r)
+{
+  Callbacks++;
+  *(SD_Async_Status_t *)r->User = r->Status;
+  SD_Async_Free(r->Data);
+}
+
+// The screen's assets read in the caller, as lv_image_set_src() of a file does: virtual microseconds
+static int64_t Load_Sync(bool Pack, uint32_t *Misses)
+{
+  SD_Cache_Stats_t before, after;
+  SD_Cache_Get_Stats(&before);
+  int64_t t0 = Sim_Time_Now();
+  std::vector<uint8_t> buf;
+  for (const Bench_Asset_t &a : Assets) {
+    if (Pack) {
+      Asset_Pack_Release(Asset_Pack_Image(a.Name.c_str()));
+      continue;
+    }
+    SD_Cache_File_t *f = SD_Cache_Open(a.Path.c_str());
+    buf.resize(SD_Cache_Size(f));
+    SD_Cache_Read(f, buf.data(), buf.size());
+    SD_Cache_Close(f);
+  }
+  SD_Cache_Get_Stats(&after);
+  *Misses = after.Misses - before.Misses;
+  return Sim_Time_Now() - t0;
+}
+
+// Empties the pack's PSRAM copies: everything must come from the card or the block cache again
+static void Reopen_Pack(void)
+{
+  Asset_Pack_Close();
+  Check(Asset_Pack_Open(BENCH_PACK) == ESP_OK, "pack reopened");
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t icons = argc > 1 ? atoi(argv[1]) : 6;
+  if (2 * (icons + 1) > SD_ASYNC_REQUESTS - 1)                  // Every asset twice in flight, and a duplicate hint
+    icons = (SD_ASYNC_REQUESTS - 1) / 2 - 1;
+  if (system("rm -rf " BENCH_DIR) != 0 || mkdir(BENCH_DIR, 0755) != 0)
+    return 1;
+  char cwd[256];
+  if (getcwd(cwd, sizeof(cwd)) == NULL)
+    return 1;
+  for (uint32_t i = 0; i <= icons; i++) {
+    char name[32];
+    snprintf(name, sizeof(name), i == icons ? "background" : "icon_%02u", i);
+    Assets.push_back({name, std::string(cwd) + "/" BENCH_DIR "/" + name + ".bin",
+                      i == icons ? Image(240, 240) : Image(64, 64)});
+    FILE *f = fopen(Assets.back().Path.c_str(), "wb");
+    fwrite(Assets.back().Blob.data(), 1, Assets.back().Blob.size(), f);
+    fclose(f);
+  }
+  if (system("python3 tools/asset_pack.py build --lz4 -o " BENCH_PACK " " BENCH_DIR " > /dev/null") != 0)
+    return 1;
+  if (SD_Cache_Init() != ESP_OK || Asset_Pack_Open(BENCH_PACK) != ESP_OK || SD_Async_Init() != ESP_OK ||
+      Timer_Cb == NULL)
+    return 1;
+
+  // Synchronous: the LVGL thread waits for the card
+  uint32_t misses;
+  SD_Cache_Drop();
+  int64_t sync_files = Load_Sync(false, &misses);
+  SD_Cache_Drop();
+  Reopen_Pack();
+  int64_t sync_pack = Load_Sync(true, &misses);
+
+  // Asynchronous, files then pack entries
+  SD_Cache_Drop();
+  Reopen_Pack();
+  for (Bench_Asset_t &a : Assets)
+    Check(SD_Async_Image(a.Path.c_str(), Image_Cb, &a) != 0, "file image queued");
+  for (Bench_Asset_t &a : Assets)
+    Check(SD_Async_Image(("P:" + a.Name).c_str(), Image_Cb, &a) != 0, "pack image queued");
+  int64_t t0 = Sim_Time_Now();
+  Run(2 * Assets.size() + 2);
+  int64_t async_done = Sim_Time_Now() - t0;
+  Check(Callbacks == 2 * Assets.size(), "one callback per image");
+  SD_Async_Stats_t st;
+  SD_Async_Get_Stats(&st);
+  uint32_t dispatch_us = st.Max_dispatch_us;
+
+  // Hints, then the synchronous loads: all hits
+  SD_Cache_Drop();
+  Reopen_Pack();
+  std::vector<std::string> paths;
+  for (const Bench_Asset_t &a : Assets)
+    paths.push_back(a.Path), paths.push_back("P:" + a.Name);
+  std::vector<const char *> list;
+  for (const std::string &p : paths)
+    list.push_back(p.c_str());
+  list.push_back(NULL);
+  SD_Async_Hint_On_Press((lv_obj_t *)&Press_Cb, list.data());
+  Check(Press_Cb != NULL, "press hint registered");
+  Press_Cb(NULL);                                               // The button goes down
+  SD_Async_Prefetch(list[0]);                                   // Queued already
+  SD_Async_Get_Stats(&st);
+  Check(st.Hints == list.size() - 1 && st.Hints_skipped == 1, "hints queued once");
+  Run(list.size() + 2);
+  uint32_t hinted_misses, pack_misses;
+  int64_t hinted_files = Load_Sync(false, &hinted_misses);
+  int64_t hinted_pack = Load_Sync(true, &pack_misses);
+  Check(hinted_misses == 0 && pack_misses == 0, "hinted loads hit the cache");
+  SD_Async_Prefetch(("P:" + Assets[0].Name).c_str());           // Resident in the pack now
+  SD_Async_Get_Stats(&st);
+  Check(st.Hints_skipped == 2, "resident pack entry not hinted");
+
+  // Loads overtake hints queued before them
+  SD_Cache_Drop();
+  Reopen_Pack();
+  for (uint32_t i = 0; i < 3; i++)
+    SD_Async_Prefetch(Assets[i].Path.c_str());
+  Callbacks = 0;
+  SD_Async_Image(Assets.back().Path.c_str(), Image_Cb, &Assets.back());
+  Tick();
+  Check(Callbacks == 1, "load served before the hints");
+  Run(5);
+
+  // Cancellation
+  SD_Async_Status_t status[4];
+  SD_Async_Id_t ids[4];
+  Callbacks = 0;
+  for (int i = 0; i < 4; i++)
+    ids[i] = SD_Async_Read(Assets[i].Path.c_str(), Read_Cb, &status[i]);
+  Check(SD_Async_Cancel(ids[1]) && SD_Async_Cancel(ids[3]), "queued requests cancelled");
+  Check(!SD_Async_Cancel(ids[1]), "cancelled twice");
+  Tick();                                                       // Serves ids[0]
+  Check(SD_Async_Cancel(ids[2]), "request cancelled while its neighbour completed");
+  Run(6);
+  Check(Callbacks == 1 && status[0] == SD_ASYNC_OK, "cancelled requests never call back");
+  Check(!SD_Async_Cancel(ids[0]) && !SD_Async_Cancel(0), "completed and unknown ids");
+
+  // Out of request slots, unknown paths
+  std::vector<SD_Async_Id_t> many;
+  SD_Async_Status_t s = SD_ASYNC_OK;
+  for (int i = 0; i < SD_ASYNC_REQUESTS + 1; i++)
+    many.push_back(SD_Async_Read(Assets[0].Path.c_str(), Read_Cb, &s));
+  Check(many.back() == 0 && many[0] != 0, "request refused when all slots are in use");
+  Run(SD_ASYNC_REQUESTS + 2);
+  SD_Async_Status_t missing = SD_ASYNC_OK, missing_pack = SD_ASYNC_OK;
+  SD_Async_Read("/nothere.bin", Read_Cb, &missing);
+  SD_Async_Read("P:nothere", Read_Cb, &missing_pack);
+  Run(3);
+  Check(missing == SD_ASYNC_NOT_FOUND && missing_pack == SD_ASYNC_NOT_FOUND, "unknown paths not found");
+
+  uint64_t bytes = 0;
+  for (const Bench_Asset_t &a : Assets)
+    bytes += a.Blob.size();
+  printf("\nasync bench: %u icons and a background, %llu KB, %u card reads; LVGL thread blocked for\n", icons,
+         (unsigned long long)bytes / 1024, Card_reads);
+  printf("  synchronous, image files:          %8.1f ms\n", sync_files / 1000.0);
+  printf("  synchronous, asset pack:           %8.1f ms\n", sync_pack / 1000.0);
+  printf("  asynchronous, longest timer run:   %8.1f ms   (all %u images ready after %.1f ms)\n",
+         dispatch_us / 1000.0, (unsigned)(2 * Assets.size()), async_done / 1000.0);
+  printf("  hinted, then synchronous files:    %8.1f ms\n", hinted_files / 1000.0);
+  printf("  hinted, then synchronous pack:     %8.1f ms\n", hinted_pack / 1000.0);
+  SD_Async_Print_Stats();
+  SD_Cache_Print_Stats();
+  printf("%s\n", Ok ? "ok" : "FAILED");
+  return Ok ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+// Host bench for the battery monitor's filter (src/BAT_Driver.cpp).
+//
+// Discharges a modelled cell through the device's active/dim/sleep load cycle and samples its divider the way the
+// ADC would: 12-bit codes with Gaussian noise and occasional spikes. The old driver's single read every 100 ms is
+// compared with the DMA frames through BAT_Filter_Push(). For each, the bench reports how often the indicator
+// would change, how often the state of charge goes backwards during the discharge, and the open-circuit voltage
+// error. The model's cell resistance and load currents are deliberately a little off from the firmware's estimates.
+//
+// Build from the repository root:
+//   mkdir -p sim/build
+//   g++ -std=gnu++17 -O2 -Wno-format -Isim -Isim/include -Isrc sim/bench/battery_bench.cpp src/BAT_Driver.cpp
+//       sim/Sim_Runtime.cpp -o sim/build/battery_bench
+// (one command line)
+// Run:
+//   sim/build/battery_bench [hours]                  default: 4
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "BAT_Driver.h"
+
+#define BENCH_OCV_START_MV   4100.0                            // Discharge, linear in time
+#define BENCH_OCV_END_MV     3550.0
+#define BENCH_RESISTANCE_MOHM 200.0                            // The firmware assumes BAT_RESISTANCE_MOHM
+#define BENCH_LOAD_ERROR     1.1                               // True current / the firmware's per-state estimate
+#define BENCH_NOISE_MV       15.0                              // At the pin, per conversion
+#define BENCH_SPIKE_RATE     0.005                             // Conversions hit by a +-100 mV spike
+#define BENCH_FULL_SCALE_MV  3100.0
+#define BENCH_OLD_PERIOD_MS  100                               // BAT_Get_Volts() from Driver_Loop before
+#define BENCH_ACTIVE_MA      250                               // POWER_LOAD_*_MA of src/Power_Manager.h
+#define BENCH_DIM_MA         140
+#define BENCH_SLEEP_MA       70
+
+// The bench runs the filter alone, the ADC driver is never started
+esp_err_t adc_continuous_io_to_channel(int io, adc_unit_t *unit, adc_channel_t *channel) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t adc_continuous_new_handle(const adc_continuous_handle_cfg_t *cfg, adc_continuous_handle_t *handle)
+{
+  return ESP_ERR_NOT_SUPPORTED;
+}
+esp_err_t adc_continuous_config(adc_continuous_handle_t handle, const adc_continuous_config_t *cfg)
+{
+  return ESP_ERR_NOT_SUPPORTED;
+}
+esp_err_t adc_continuous_register_event_callbacks(adc_continuous_handle_t handle, const adc_continuous_evt_cbs_t *cbs,
+                                                  void *arg)
+{
+  return ESP_ERR_NOT_SUPPORTED;
+}
+esp_err_t adc_continuous_start(adc_continuous_handle_t handle) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t adc_continuous_read(adc_continuous_handle_t handle, uint8_t *buf, uint32_t max, uint32_t *out, uint32_t ms)
+{
+  return ESP_ERR_NOT_SUPPORTED;
+}
+esp_err_t adc_continuous_deinit(adc_continuous_handle_t handle) { return ESP_OK; }
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int *mv) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t adc_cali_create_scheme_curve_fitting(const adc_cali_curve_fitting_config_t *cfg, adc_cali_handle_t *handle)
+{
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+static std::mt19937 Rng(12345);
+
+// The firmware's estimate: active 3 min, dim 30 s, asleep 5 min, repeated
+static uint16_t Load_Estimate_mA(double t_s)
+{
+  double c = fmod(t_s, 510.0);
+  return c < 180.0 ? BENCH_ACTIVE_MA : c < 210.0 ? BENCH_DIM_MA : BENCH_SLEEP_MA;
+}
+
+static double True_Ocv_mv(double t_s, double total_s)
+{
+  return BENCH_OCV_START_MV + (BENCH_OCV_END_MV - BENCH_OCV_START_MV) * t_s / total_s;
+}
+
+// One conversion of the divider, as a 12-bit code
+static int Convert(double t_s, double total_s)
+{
+  static std::normal_distribution<double> noise(0.0, BENCH_NOISE_MV);
+  static std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  double load = Load_Estimate_mA(t_s) * BENCH_LOAD_ERROR;
+  double terminal = True_Ocv_mv(t_s, total_s) - load * BENCH_RESISTANCE_MOHM / 1000.0;
+  double pin = terminal * Measurement_offset / BAT_DIVIDER + noise(Rng);
+  if (uniform(Rng) < BENCH_SPIKE_RATE)
+    pin += uniform(Rng) < 0.5 ? -100.0 : 100.0;
+  int code = (int)lround(pin * 4095.0 / BENCH_FULL_SCALE_MV);
+  return code < 0 ? 0 : code > 4095 ? 4095 : code;
+}
+
+static double Code_To_Battery_mv(double code)
+{
+  return code * BENCH_FULL_SCALE_MV / 4095.0 * BAT_DIVIDER / Measurement_offset;
+}
+
+typedef struct {
+  const char *Name;
+  uint32_t Updates;                                             // Indicator changes: volts to 10 mV or percent
+  uint32_t Soc_changes;
+  uint32_t Soc_reversals;                                       // Percent going up while discharging
+  double   Err2;
+  double   Max_err;
+  uint32_t N;
+  int      Soc;
+  int      Centivolts;
+} Bench_Result_t;
+
+static void Observe(Bench_Result_t *r, double volts_mv, double ocv_mv, double true_ocv_mv)
+{
+  int soc = BAT_Soc_From_Mv((float)ocv_mv);
+  int cv = (int)lround(volts_mv / 10.0);
+  if (r->N > 0) {
+    r->Updates += soc != r->Soc || cv != r->Centivolts;
+    r->Soc_changes += soc != r->Soc;
+    r->Soc_reversals += soc > r->Soc;
+  }
+  r->Soc = soc;
+  r->Centivolts = cv;
+  double err = ocv_mv - true_ocv_mv;
+  r->Err2 += err * err;
+  r->Max_err = fmax(r->Max_err, fabs(err));
+  r->N++;
+}
+
+static void Print(const Bench_Result_t *r, double hours, uint32_t wakeups)
+{
+  printf("%-24s %8.1f %9u %9u %8.1f %8.1f %10.2f\n", r->Name, r->Updates / hours, r->Soc_changes, r->Soc_reversals,
+         sqrt(r->Err2 / r->N), r->Max_err, wakeups / (hours * 3600.0));
+}
+
+int main(int argc, char **argv)
+{
+  double hours = argc > 1 ? atof(argv[1]) : 4.0;
+  double total_s = hours * 3600.0;
+  printf("battery bench: %.1f h, OCV %.0f -> %.0f mV, cell %.0f mOhm (firmware assumes %d), load x%.1f, "
+         "noise %.0f mV rms at the pin\n", hours, BENCH_OCV_START_MV, BENCH_OCV_END_MV, BENCH_RESISTANCE_MOHM,
+         BAT_RESISTANCE_MOHM, BENCH_LOAD_ERROR, BENCH_NOISE_MV);
+
+  // Before: one conversion every 100 ms, straight to the indicator, no load compensation
+  Bench_Result_t old_r = {"100 ms one-shot"};
+  uint32_t old_reads = 0;
+  for (double t = 0; t < total_s; t += BENCH_OLD_PERIOD_MS / 1000.0, old_reads++) {
+    double mv = Code_To_Battery_mv(Convert(t, total_s));
+    Observe(&old_r, mv, mv, True_Ocv_mv(t, total_s));
+  }
+
+  // After: DMA frames, decimated and filtered, state only as published
+  Bench_Result_t new_r = {"DMA frames + filter"};
+  BAT_Filter_t f;
+  BAT_Filter_Reset(&f);
+  const double frame_s = (double)BAT_FRAME_SAMPLES / BAT_SAMPLE_HZ;
+  double pub_volts = 0, pub_ocv = 0;
+  uint32_t frames = 0, publishes = 0;
+  for (double t = 0; t < total_s; t += frame_s, frames++) {
+    double sum = 0;
+    for (int i = 0; i < BAT_FRAME_SAMPLES; i++)
+      sum += Convert(t + i / (double)BAT_SAMPLE_HZ, total_s);
+    double mv = Code_To_Battery_mv(sum / BAT_FRAME_SAMPLES);
+    if (BAT_Filter_Push(&f, (float)mv, (float)frame_s, Load_Estimate_mA(t))) {
+      pub_volts = f.Volts_mv;
+      pub_ocv = f.Ocv_mv;
+      publishes++;
+    }
+    if (t >= 5 * BAT_FILTER_TAU_S)                              // After the filter has settled
+      Observe(&new_r, pub_volts, pub_ocv, True_Ocv_mv(t, total_s));
+  }
+
+  printf("\n%-24s %8s %9s %9s %8s %8s %10s\n", "", "upd/h", "soc chg", "soc back", "rms mV", "max mV", "wakeups/s");
+  Print(&old_r, hours, old_reads);
+  Print(&new_r, hours, frames);
+  printf("\n%u publishes (%.1f/h), %d%% -> %d%%\n", publishes, publishes / hours,
+         BAT_Soc_From_Mv(BENCH_OCV_START_MV), BAT_Soc_From_Mv(BENCH_OCV_END_MV));
+  bool ok = new_r.Soc_reversals == 0 && new_r.Max_err < 2 * BAT_PUBLISH_MV + 20;
+  printf("%s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,309 @@
+// Host bench for the asset partitions (src/Asset_Flash.cpp), the mapped side of the asset pack loader
+// (src/Asset_Pack.cpp) and tools/asset_pack.py partition.
+//
+// Writes a set of LVGL images into a directory (64x64 icons and 200x200 photos, as sim/bench/asset_bench.cpp), packs
+// it with the Python tool, wraps the pack into an image of slot assets0 and writes that where partitions_assets.csv
+// puts it in the simulated flash, as esptool would. Then:
+//   - every image of the mounted pack must be its file byte for byte, and a stored one must point into the mapped
+//     partition: nothing copied, no PSRAM used;
+//   - the same pack opened from the card, for the PSRAM and card time the mapping saves;
+//   - an update from a file (packed with --lz4 this time) goes to assets1 while assets0 stays mapped, is refused a
+//     remount while an image is held, and is mapped after;
+//   - an update cut off half way, a pack that is not one, and a committed slot whose index is damaged afterwards all
+//     leave the last good pack mapped.
+// Card time is modelled with the constants of sim/bench/asset_bench.cpp; flash erase and program times are typical
+// datasheet figures of the board's 16 MB QIO flash.
+//
+// Build from the repository root:
+//   mkdir -p sim/build
+//   g++ -std=gnu++17 -O2 -Wno-format -Isim -Isim/include -Isrc -Ilib/lvgl -DLV_CONF_SKIP -DLV_USE_LZ4_INTERNAL=1
+//       sim/bench/flash_bench.cpp src/Asset_Flash.cpp src/Asset_Pack.cpp src/SD_Cache.cpp sim/Sim_Runtime.cpp
+//       lib/lvgl/src/libs/lz4/lz4.c -o sim/build/flash_bench
+// (one command line)
+// Run:
+//   sim/build/flash_bench [icons] [photos]          default: 120 64x64 icons, 12 200x200 photos
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "esp_partition.h"
+#include "SD_Cache.h"
+#include "Asset_Pack.h"
+#include "Asset_Flash.h"
+
+#define BENCH_CMD_US          200.0                             // One SDMMC read command
+#define BENCH_BYTES_PER_US    5.0                               // 1-bit bus at 40 MHz
+#define BENCH_COPY_PER_US     40.0                              // Bytes/us of memcpy to or from PSRAM
+#define BENCH_ERASE_PER_US    (65536 / 150000.0)                // 64 KB block erase, 150 ms
+#define BENCH_PROGRAM_PER_US  (256 / 400.0)                     // 256 byte page program, 0.4 ms
+#define BENCH_DIR             "sim/build/flash_assets"
+#define BENCH_PACK            "sim/build/flash_assets.pak"
+#define BENCH_SLOT            "sim/build/flash_assets0.bin"
+#define BENCH_UPDATE          "sim/build/flash_update.pak"
+#define BENCH_BAD             "sim/build/flash_bad.pak"
+
+static uint32_t Card_reads = 0;
+static double   Card_us = 0;
+
+extern "C" ssize_t pread(int fd, void *buf, size_t count, off_t offset)
+{
+  Card_reads++;
+  Card_us += BENCH_CMD_US + count / BENCH_BYTES_PER_US + count / BENCH_COPY_PER_US;
+  return syscall(SYS_pread64, fd, buf, count, offset);
+}
+
+// The parts of LVGL the loader and lz4.c call; the bench drives the loader through its own API only
+void *lv_memcpy(void *dst, const void *src, size_t len) { return memcpy(dst, src, len); }
+void *lv_memmove(void *dst, const void *src, size_t len) { return memmove(dst, src, len); }
+void lv_memset(void *dst, uint8_t v, size_t len) { memset(dst, v, len); }
+void lv_fs_drv_init(lv_fs_drv_t *drv) { memset(drv, 0, sizeof(*drv)); }
+void lv_fs_drv_register(lv_fs_drv_t *drv) {}
+void lv_image_cache_drop(const void *src) {}
+lv_font_t *lv_binfont_create(const char *path) { return NULL; }
+
+typedef struct {
+  std::string          Name;
+  std::vector<uint8_t> Blob;
+} Bench_Asset_t;
+
+static std::mt19937 Rng(17);
+static bool         All_ok = true;
+
+static void Check(bool Ok, const char *What)
+{
+  printf("  %-68s %s\n", What, Ok ? "ok" : "FAILED");
+  All_ok &= Ok;
+}
+
+static std::vector<uint8_t> Image(uint32_t w, uint32_t h, bool photo)
+{
+  std::vector<uint8_t> blob(12 + w * h * 3, 0);
+  lv_image_header_t header = {};
+  header.magic = LV_IMAGE_HEADER_MAGIC;
+  header.cf = LV_COLOR_FORMAT_RGB565A8;
+  header.w = w;
+  header.h = h;
+  header.stride = w * 2;
+  memcpy(blob.data(), &header, sizeof(header));
+  uint8_t *color = blob.data() + 12, *alpha = color + w * h * 2;
+  uint16_t fg = (uint16_t)Rng();
+  float r = w * (0.25f + (Rng() % 20) / 100.0f);
+  for (uint32_t y = 0; y < h; y++) {
+    for (uint32_t x = 0; x < w; x++) {
+      uint32_t i = y * w + x;
+      uint16_t c = photo ? (uint16_t)Rng() : fg;
+      float d = sqrtf((x - w / 2.0f) * (x - w / 2.0f) + (y - h / 2.0f) * (y - h / 2.0f)) - r;
+      uint8_t a = photo || d <= -1 ? 255 : d >= 1 ? 0 : (uint8_t)(255 * (1 - d) / 2);
+      color[i * 2] = a ? c : 0;
+      color[i * 2 + 1] = a ? c >> 8 : 0;
+      alpha[i] = a;
+    }
+  }
+  return blob;
+}
+
+static void Write_Assets(const std::vector<Bench_Asset_t> &Assets)
+{
+  if (system("rm -rf " BENCH_DIR) != 0 || mkdir(BENCH_DIR, 0755) != 0 || mkdir(BENCH_DIR "/photo", 0755) != 0)
+    exit(1);
+  for (const Bench_Asset_t &a : Assets) {
+    FILE *f = fopen((std::string(BENCH_DIR "/") + a.Name + ".bin").c_str(), "wb");
+    fwrite(a.Blob.data(), 1, a.Blob.size(), f);
+    fclose(f);
+  }
+}
+
+static std::vector<uint8_t> Read_File(const char *Path)
+{
+  std::vector<uint8_t> data;
+  FILE *f = fopen(Path, "rb");
+  if (f == NULL)
+    return data;
+  fseek(f, 0, SEEK_END);
+  data.resize(ftell(f));
+  fseek(f, 0, SEEK_SET);
+  if (fread(data.data(), 1, data.size(), f) != data.size())
+    data.clear();
+  fclose(f);
+  return data;
+}
+
+// Every asset against its file; In_place: stored ones must point into Part's mapping
+static bool Same_Assets(const std::vector<Bench_Asset_t> &Assets, const esp_partition_t *Part)
+{
+  const uint8_t *lo = NULL, *hi = NULL;
+  if (Part) {
+    const void *p;
+    esp_partition_mmap_handle_t h;
+    esp_partition_mmap(Part, 0, Part->size, ESP_PARTITION_MMAP_DATA, &p, &h);
+    esp_partition_munmap(h);
+    lo = (const uint8_t *)p;
+    hi = lo + Part->size;
+  }
+  bool ok = Asset_Pack_Count() == Assets.size();
+  for (const Bench_Asset_t &a : Assets) {
+    const lv_image_dsc_t *img = Asset_Pack_Image(a.Name.c_str());
+    bool same = img && img->data_size + 12 == a.Blob.size() && memcmp(&img->header, a.Blob.data(), 12) == 0 &&
+                memcmp(img->data, a.Blob.data() + 12, img->data_size) == 0 &&
+                (!Part || (img->data >= lo && img->data < hi));
+    if (!same)
+      printf("  %s: %s\n", a.Name.c_str(), img ? "differs from its file, or copied" : "not loaded");
+    ok &= same;
+    Asset_Pack_Release(img);
+  }
+  return ok;
+}
+
+static double Host_Ms(std::chrono::steady_clock::time_point t0)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t icons = argc > 1 ? atoi(argv[1]) : 120, photos = argc > 2 ? atoi(argv[2]) : 12;
+  std::vector<Bench_Asset_t> assets;
+  for (uint32_t i = 0; i < icons + photos; i++) {
+    char name[48];
+    bool photo = i >= icons;
+    snprintf(name, sizeof(name), photo ? "photo/p%03u" : "icon_%03u", i);
+    assets.push_back({name, photo ? Image(200, 200, true) : Image(64, 64, false)});
+  }
+  Write_Assets(assets);
+  if (system("python3 tools/asset_pack.py build -o " BENCH_PACK " " BENCH_DIR) != 0 ||
+      system("python3 tools/asset_pack.py partition " BENCH_PACK " -o " BENCH_SLOT " --table partitions_assets.csv") != 0 ||
+      system("python3 tools/asset_pack.py verify " BENCH_SLOT " > /dev/null") != 0)
+    return 1;
+  uint64_t bytes = 0;
+  for (const Bench_Asset_t &a : assets)
+    bytes += a.Blob.size();
+
+  // Flashed as esptool would: erase, write the slot image
+  printf("\nflash bench: %u icons 64x64 + %u photos 200x200 RGB565A8, %llu KB\n", icons, photos, bytes / 1024);
+  const esp_partition_t *part_a = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           (esp_partition_subtype_t)ASSET_FLASH_SUBTYPE,
+                                                           ASSET_FLASH_LABEL_A);
+  const esp_partition_t *part_b = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           (esp_partition_subtype_t)ASSET_FLASH_SUBTYPE,
+                                                           ASSET_FLASH_LABEL_B);
+  std::vector<uint8_t> slot = Read_File(BENCH_SLOT);
+  Check(part_a && part_b && part_a->address % 65536 == 0 && part_b->address % 65536 == 0,
+        "partitions_assets.csv: two slots on 64 KB pages");
+  if (!part_a || !part_b)
+    return 1;
+  esp_partition_erase_range(part_a, 0, (slot.size() + 4095) / 4096 * 4096);
+  esp_partition_write(part_a, 0, slot.data(), slot.size());
+  Check(Asset_Flash_Mount() == ESP_OK, "assets0 mounted");
+
+  // Every image in place
+  Asset_Pack_Stats_t st0, st;
+  Asset_Pack_Get_Stats(&st0);
+  auto h0 = std::chrono::steady_clock::now();
+  bool same = Same_Assets(assets, part_a);
+  double mapped_ms = Host_Ms(h0);
+  Asset_Pack_Get_Stats(&st);
+  Check(same, "every image equals its file and points into assets0");
+  Check(st.Resident == 0 && st.Loads == st0.Loads && st.In_place - st0.In_place == assets.size(),
+        "no PSRAM used, nothing read or copied");
+  const char *path;
+  uint32_t offset, length;
+  Check(Asset_Pack_Locate(assets[0].Name.c_str(), &path, &offset, &length) && path == NULL && length == 0,
+        "SD_Async is told there is nothing to read");
+
+  // The same pack from the card
+  Asset_Pack_Close();
+  Check(Sim_Flash_Stats.Mapped == 0, "closing the pack unmaps the slot");
+  if (SD_Cache_Init() != ESP_OK || Asset_Pack_Open(BENCH_PACK) != ESP_OK)
+    return 1;
+  SD_Cache_Drop();
+  double t0 = Card_us;
+  uint32_t r0 = Card_reads;
+  h0 = std::chrono::steady_clock::now();
+  same = Same_Assets(assets, NULL);
+  double card_ms = Host_Ms(h0);
+  Asset_Pack_Get_Stats(&st);
+  double card_us = Card_us - t0;
+  uint32_t card_reads = Card_reads - r0, peak = st.Peak;
+  Check(same, "the card's copy of the pack loads the same");
+  Asset_Pack_Close();
+
+  // An update while assets0 is mapped goes to assets1
+  Check(Asset_Flash_Mount() == ESP_OK, "assets0 mounted again");
+  for (uint32_t i = 0; i < assets.size(); i += 7)
+    assets[i].Blob = Image(64, 64, false);
+  assets.push_back({"icon_new", Image(48, 48, false)});
+  Write_Assets(assets);
+  if (system("python3 tools/asset_pack.py build --lz4 -o " BENCH_UPDATE " " BENCH_DIR " > /dev/null") != 0)
+    return 1;
+  Sim_Flash_Stats_t f0 = Sim_Flash_Stats;
+  h0 = std::chrono::steady_clock::now();
+  Check(Asset_Flash_Update_From_File(BENCH_UPDATE) == ESP_OK, "update from a file committed");
+  double update_ms = Host_Ms(h0);
+  double erased = (double)(Sim_Flash_Stats.Erased - f0.Erased), written = (double)(Sim_Flash_Stats.Written - f0.Written);
+  Asset_Flash_Slot_t ha, hb;
+  Check(Asset_Flash_Read_Slot(0, &ha) && Asset_Flash_Read_Slot(1, &hb) && ha.Generation == 1 && hb.Generation == 2,
+        "assets1 holds generation 2, assets0 still generation 1");
+  Asset_Flash_Stats_t fs;
+  Asset_Flash_Get_Stats(&fs);
+  Check(fs.Mapped == 0 && Asset_Pack_Count() == assets.size() - 1, "assets0 stays mapped until the next mount");
+  const lv_image_dsc_t *held = Asset_Pack_Image(assets[1].Name.c_str());
+  Check(Asset_Flash_Mount() == ESP_ERR_INVALID_STATE && Asset_Pack_Image(assets[1].Name.c_str()) == held,
+        "no remount while an image is held, the image stays valid");
+  Asset_Pack_Release(held);
+  Asset_Pack_Release(held);
+  Asset_Pack_Get_Stats(&st0);
+  Check(Asset_Flash_Mount() == ESP_OK && Same_Assets(assets, NULL), "remounted: assets1, the new images");
+  Asset_Pack_Get_Stats(&st);
+  Check(st.Unpacked - st0.Unpacked == assets.size() && st.Failures == st0.Failures,
+        "its LZ4 blobs unpacked straight from the map");
+
+  // Cut off half way: assets0 is erased and uncommitted, assets1 stays
+  std::vector<uint8_t> update = Read_File(BENCH_UPDATE);
+  Check(Asset_Flash_Update_Begin(update.size()) == ESP_OK &&
+        Asset_Flash_Update_Write(update.data(), update.size() / 2) == ESP_OK, "second update started into assets0");
+  Asset_Flash_Update_Abort();
+  Asset_Pack_Close();
+  Check(!Asset_Flash_Read_Slot(0, &ha) && Asset_Flash_Mount() == ESP_OK && Same_Assets(assets, NULL),
+        "cut off half way: assets0 uncommitted, assets1 mounted after a restart");
+
+  // Not a pack: refused at End, nothing committed
+  update[0] ^= 0xFF;
+  FILE *f = fopen(BENCH_BAD, "wb");
+  fwrite(update.data(), 1, update.size(), f);
+  fclose(f);
+  update[0] ^= 0xFF;
+  Check(Asset_Flash_Update_From_File(BENCH_BAD) == ESP_ERR_INVALID_VERSION && !Asset_Flash_Read_Slot(0, &ha),
+        "a file that is not a pack is refused and not committed");
+  Check(Asset_Flash_Update_Begin(part_a->size) == ESP_ERR_INVALID_SIZE, "a pack larger than the slot is refused");
+
+  // Committed, then its index damaged in flash: the other slot is mapped instead
+  Check(Asset_Flash_Update_From_File(BENCH_UPDATE) == ESP_OK && Asset_Flash_Read_Slot(0, &ha) && ha.Generation == 3,
+        "third update committed to assets0, generation 3");
+  Asset_Pack_Close();
+  Asset_Pack_Header_t pack;
+  esp_partition_read(part_a, ASSET_FLASH_PACK_OFFSET, &pack, sizeof(pack));
+  uint32_t zero = 0;                                            // The first blob's offset cleared: into the header
+  esp_partition_write(part_a, ASSET_FLASH_PACK_OFFSET + sizeof(pack) + offsetof(Asset_Pack_Entry_t, Offset), &zero,
+                      sizeof(zero));
+  Check(Asset_Flash_Mount() == ESP_OK && Same_Assets(assets, NULL),
+        "assets0's index damaged: assets1 is mapped instead");
+  Asset_Flash_Print();
+  Asset_Pack_Close();
+  Check(Sim_Flash_Stats.Mapped == 0, "every mapping undone");
+
+  double erase_s = erased / BENCH_ERASE_PER_US / 1e6, program_s = written / BENCH_PROGRAM_PER_US / 1e6;
+  printf("\n  card pack:   %8.1f ms card, %5u reads, %6u KB PSRAM peak, %.1f ms on the host\n", card_us / 1000,
+         card_reads, peak / 1024, card_ms);
+  printf("  mapped pack: %8.1f ms card, %5u reads, %6u KB PSRAM,      %.1f ms on the host\n", 0.0, 0u, 0u, mapped_ms);
+  printf("  update of %.0f KB: %.0f KB erased, ~%.1f s erasing + ~%.1f s programming on the board, "
+         "%.0f ms on the host\n", update.size() / 1024.0, erased / 1024, erase_s, program_s, update_ms);
+  printf("%s\n", All_ok ? "ok" : "FAILED");
+  return All_ok ? 0 : 1;
+}
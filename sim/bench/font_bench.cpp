@@ -0,0 +1,652 @@
+// Host bench for paged binary fonts (src/Paged_Font.cpp) against LVGL's own loader, lib/lvgl/src/font/
+// lv_binfont_loader.c, which is built in together with lv_font_fmt_txt.c that draws for both.
+//
+// Writes binary fonts in lv_font_conv's format: a 16 px 4 bpp CJK set (ASCII, Latin-1, Cyrillic and 6000
+// ideographs, in all four character map formats, kerning pairs, 32-bit offsets, glyph headers of 29 bits so bitmaps
+// start mid-byte) and a 24 px 2 bpp Latin one (class kerning, 16-bit offsets, 32-bit headers). Then:
+//   - every character, and some the fonts do not have, must get the same descriptor and A8 bitmap from both, read
+//     from the card, from a mapped pack, and from a mapped pack at an odd address whose tables cannot be used in
+//     place;
+//   - all of the CJK set drawn twice over must stay within PAGED_FONT_CACHE_SIZE, evicting, and glyphs read again
+//     must be the same; destroying the fonts must empty the cache;
+//   - truncated and damaged files must be refused;
+//   - prints RAM and load time for both, and the hit rate of a UI redrawing pages of text. Card time is modelled
+//     with the constants of sim/bench/sdcache_bench.cpp behind SD_Cache's blocks: every lv_fs_read() costs a cache
+//     call, every block read the first time a command and the transfer; host time is added on top.
+//
+// Build from the repository root:
+//   mkdir -p sim/build
+//   g++ -std=gnu++17 -O2 -Wno-format -Isim -Isim/include -Isrc -Ilib/lvgl -DLV_CONF_SKIP -DLV_USE_FONT_COMPRESSED=1
+//       sim/bench/font_bench.cpp src/Paged_Font.cpp sim/Sim_Runtime.cpp -x c lib/lvgl/src/font/lv_binfont_loader.c
+//       -x c lib/lvgl/src/font/lv_font_fmt_txt.c -x c lib/lvgl/src/font/lv_font.c -x c lib/lvgl/src/misc/lv_utils.c
+//       -x none -o sim/build/font_bench
+// (one command line)
+// Run:
+//   sim/build/font_bench [ideographs]               default: 6000
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "lvgl.h"
+#include "SD_Cache.h"
+#include "Asset_Pack.h"
+#include "Paged_Font.h"
+#include "Sim_Time.h"
+
+#define BENCH_CMD_US        200.0                               // sdcache_bench.cpp: one SDMMC read command
+#define BENCH_BYTES_PER_US  5.0                                 // 1-bit bus at 40 MHz
+#define BENCH_HIT_US        2.0                                 // SD_Cache_Read() call overhead
+
+static int Failures = 0;
+#define CHECK(cond, ...) do { if (!(cond)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); \
+                              printf("\n"); Failures++; } } while (0)
+
+/********************************************************** LVGL stand-ins **********************************************************/
+// lv_fs over files in memory: "S:..." are on the card, behind the block model; "P:..." are pack entries, mapped when
+// Bench_Mapped has them
+static std::map<std::string, std::vector<uint8_t>> Bench_Files;
+static std::map<std::string, const uint8_t *>      Bench_Mapped;
+static std::set<std::pair<const void *, uint32_t>> Bench_Blocks;   // Blocks SD_Cache holds
+static uint32_t Bench_Calls = 0, Bench_Card_blocks = 0;
+
+struct Bench_File {
+  const uint8_t *Data;
+  uint32_t       Size;
+  uint32_t       Pos;
+  bool           Card;
+};
+
+extern "C" {
+lv_global_t lv_global;
+uint32_t (*_lv_text_encoded_next)(const char *, uint32_t *) = NULL;
+
+void *lv_malloc(size_t size) { return malloc(size); }
+void *lv_malloc_zeroed(size_t size) { return calloc(1, size); }
+void lv_free(void *p) { free(p); }
+void lv_image_cache_drop(const void *src) {}
+
+uint32_t lv_draw_buf_width_to_stride(uint32_t w, lv_color_format_t cf) { return w; }   // A8, LV_DRAW_BUF_STRIDE_ALIGN 1
+
+lv_draw_buf_t *lv_draw_buf_create(uint32_t w, uint32_t h, lv_color_format_t cf, uint32_t stride)
+{
+  lv_draw_buf_t *b = (lv_draw_buf_t *)calloc(1, sizeof(lv_draw_buf_t));
+  b->header.w = w;
+  b->header.h = h;
+  b->header.cf = cf;
+  b->header.stride = w;
+  b->data_size = w * h;
+  b->data = (uint8_t *)calloc(1, b->data_size);
+  return b;
+}
+
+void lv_draw_buf_destroy(lv_draw_buf_t *b)
+{
+  free(b->data);
+  free(b);
+}
+
+lv_fs_res_t lv_fs_open(lv_fs_file_t *f, const char *path, lv_fs_mode_t mode)
+{
+  auto it = Bench_Files.find(path);
+  if (it == Bench_Files.end())
+    return LV_FS_RES_NOT_EX;
+  Bench_File *b = new Bench_File{it->second.data(), (uint32_t)it->second.size(), 0, path[0] == 'S'};
+  auto m = Bench_Mapped.find(path + 2);
+  if (path[0] == 'P' && m != Bench_Mapped.end())
+    b->Data = m->second;
+  memset(f, 0, sizeof(*f));
+  f->file_d = b;
+  return LV_FS_RES_OK;
+}
+
+lv_fs_res_t lv_fs_close(lv_fs_file_t *f)
+{
+  delete (Bench_File *)f->file_d;
+  f->file_d = NULL;
+  return LV_FS_RES_OK;
+}
+
+lv_fs_res_t lv_fs_read(lv_fs_file_t *f, void *buf, uint32_t btr, uint32_t *br)
+{
+  Bench_File *b = (Bench_File *)f->file_d;
+  uint32_t n = b->Pos >= b->Size ? 0 : std::min(btr, b->Size - b->Pos);
+  if (b->Card) {
+    Bench_Calls++;
+    double us = BENCH_HIT_US;
+    for (uint32_t blk = b->Pos / SD_CACHE_BLOCK_SIZE; n && blk <= (b->Pos + n - 1) / SD_CACHE_BLOCK_SIZE; blk++) {
+      if (Bench_Blocks.insert({b->Data, blk}).second) {
+        us += BENCH_CMD_US + SD_CACHE_BLOCK_SIZE / BENCH_BYTES_PER_US;
+        Bench_Card_blocks++;
+      }
+    }
+    Sim_Time_Advance((int64_t)us);
+  }
+  memcpy(buf, b->Data + b->Pos, n);
+  b->Pos += n;
+  if (br)
+    *br = n;
+  return n == btr || br ? LV_FS_RES_OK : LV_FS_RES_UNKNOWN;
+}
+
+lv_fs_res_t lv_fs_write(lv_fs_file_t *f, const void *buf, uint32_t btw, uint32_t *bw) { return LV_FS_RES_NOT_IMP; }
+
+lv_fs_res_t lv_fs_seek(lv_fs_file_t *f, uint32_t pos, lv_fs_whence_t whence)
+{
+  Bench_File *b = (Bench_File *)f->file_d;
+  b->Pos = whence == LV_FS_SEEK_END ? b->Size + pos : whence == LV_FS_SEEK_CUR ? b->Pos + pos : pos;
+  return LV_FS_RES_OK;
+}
+
+lv_fs_res_t lv_fs_tell(lv_fs_file_t *f, uint32_t *pos)
+{
+  *pos = ((Bench_File *)f->file_d)->Pos;
+  return LV_FS_RES_OK;
+}
+}
+
+void SD_Cache_Drop(void) { Bench_Blocks.clear(); }
+
+const void *Asset_Pack_Mapped(const char *Name, uint32_t *Size)
+{
+  auto m = Bench_Mapped.find(Name);
+  if (m == Bench_Mapped.end())
+    return NULL;
+  *Size = (uint32_t)Bench_Files["P:" + std::string(Name)].size();
+  return m->second;
+}
+
+static uint32_t Bench_Utf8_Next(const char *txt, uint32_t *i)
+{
+  const uint8_t *s = (const uint8_t *)txt + *i;
+  if (s[0] == 0)
+    return 0;
+  int n = s[0] < 0x80 ? 1 : s[0] < 0xE0 ? 2 : s[0] < 0xF0 ? 3 : 4;
+  uint32_t c = n == 1 ? s[0] : s[0] & (0x3F >> (n - 1));
+  for (int k = 1; k < n; k++)
+    c = (c << 6) | (s[k] & 0x3F);
+  *i += n;
+  return c;
+}
+
+static std::string Bench_Utf8(uint32_t c)
+{
+  std::string s;
+  if (c < 0x80) {
+    s += (char)c;
+  } else if (c < 0x800) {
+    s += (char)(0xC0 | c >> 6);
+    s += (char)(0x80 | (c & 0x3F));
+  } else {
+    s += (char)(0xE0 | c >> 12);
+    s += (char)(0x80 | ((c >> 6) & 0x3F));
+    s += (char)(0x80 | (c & 0x3F));
+  }
+  return s;
+}
+
+/********************************************************** Font writer **********************************************************/
+// font_header_bin_t and cmap_table_bin_t of lv_binfont_loader.c
+#pragma pack(push, 1)
+typedef struct {
+  uint32_t version;
+  uint16_t tables_count, font_size, ascent;
+  int16_t  descent;
+  uint16_t typo_ascent;
+  int16_t  typo_descent;
+  uint16_t typo_line_gap;
+  int16_t  min_y, max_y;
+  uint16_t default_advance_width, kerning_scale;
+  uint8_t  index_to_loc_format, glyph_id_format, advance_width_format, bits_per_pixel, xy_bits, wh_bits;
+  uint8_t  advance_width_bits, compression_id, subpixels_mode, padding;
+  int16_t  underline_position;
+  uint16_t underline_thickness;
+} Bench_Head_t;
+
+typedef struct {
+  uint32_t data_offset, range_start;
+  uint16_t range_length, glyph_id_start, data_entries_count;
+  uint8_t  format_type, padding;
+} Bench_Cmap_t;
+#pragma pack(pop)
+
+struct Bench_Range {
+  uint8_t               Type;                                   // LV_FONT_FMT_TXT_CMAP_*
+  std::vector<uint32_t> Letters;                                // Ascending
+};
+
+struct Bench_Spec {
+  const char              *Name;
+  int                      Size, Bpp, Adv_bits, Xy_bits, Wh_bits;
+  bool                     Loca32;
+  int                      Kern;                                // 0 none, 1 pairs, 3 classes
+  std::vector<Bench_Range> Ranges;
+};
+
+struct Bench_Font {
+  std::vector<uint8_t>  File;
+  std::vector<uint32_t> Letters;                                // Every character it has
+};
+
+struct Bench_Bits {
+  std::vector<uint8_t> Out;
+  uint32_t             Bit = 0;
+  void Put(uint32_t v, int n)
+  {
+    while (n--) {
+      if (Bit % 8 == 0)
+        Out.push_back(0);
+      if ((v >> n) & 1)
+        Out.back() |= 0x80 >> (Bit % 8);
+      Bit++;
+    }
+  }
+};
+
+static void Bench_Table(std::vector<uint8_t> &f, const char *Label, const std::vector<uint8_t> &Body)
+{
+  uint32_t length = 8 + (uint32_t)Body.size();
+  f.insert(f.end(), (uint8_t *)&length, (uint8_t *)&length + 4);
+  f.insert(f.end(), Label, Label + 4);
+  f.insert(f.end(), Body.begin(), Body.end());
+}
+
+template <typename T> static void Bench_Put(std::vector<uint8_t> &v, T x)
+{
+  v.insert(v.end(), (uint8_t *)&x, (uint8_t *)&x + sizeof(x));
+}
+
+static Bench_Font Bench_Make_Font(const Bench_Spec &s, std::mt19937 &rng)
+{
+  Bench_Font font;
+  Bench_Head_t h = {};
+  h.version = 1;
+  h.tables_count = s.Kern ? 4 : 3;
+  h.font_size = (uint16_t)s.Size;
+  h.ascent = (uint16_t)(s.Size * 4 / 5);
+  h.descent = (int16_t)-(s.Size / 5);
+  h.default_advance_width = (uint16_t)s.Size;
+  h.kerning_scale = 20;
+  h.index_to_loc_format = s.Loca32;
+  h.glyph_id_format = 1;
+  h.bits_per_pixel = (uint8_t)s.Bpp;
+  h.xy_bits = (uint8_t)s.Xy_bits;
+  h.wh_bits = (uint8_t)s.Wh_bits;
+  h.advance_width_bits = (uint8_t)s.Adv_bits;
+  h.underline_position = -2;
+  h.underline_thickness = 1;
+
+  // Character maps, glyph ids in their order
+  std::vector<uint8_t> cmap;
+  Bench_Put(cmap, (uint32_t)s.Ranges.size());
+  std::vector<uint8_t> data;
+  uint32_t data_start = 8 + 4 + (uint32_t)(s.Ranges.size() * sizeof(Bench_Cmap_t));
+  uint32_t gid = 1;
+  for (const Bench_Range &r : s.Ranges) {
+    Bench_Cmap_t t = {};
+    uint32_t n = (uint32_t)r.Letters.size();
+    t.data_offset = data_start + (uint32_t)data.size();
+    t.range_start = r.Letters.front();
+    t.range_length = (uint16_t)(r.Letters.back() - r.Letters.front() + 1);
+    t.glyph_id_start = (uint16_t)gid;
+    t.format_type = r.Type;
+    if (r.Type == LV_FONT_FMT_TXT_CMAP_FORMAT0_FULL) {
+      t.data_entries_count = t.range_length;
+      for (uint32_t k = 0; k < n; k++)
+        data.push_back((uint8_t)k);                             // Dense: each letter its own id
+    } else if (r.Type != LV_FONT_FMT_TXT_CMAP_FORMAT0_TINY) {
+      t.data_entries_count = (uint16_t)n;
+      for (uint32_t c : r.Letters)
+        Bench_Put(data, (uint16_t)(c - t.range_start));
+      if (r.Type == LV_FONT_FMT_TXT_CMAP_SPARSE_FULL) {
+        for (uint32_t k = 0; k < n; k++)
+          Bench_Put(data, (uint16_t)(n - 1 - k));               // Ids in reverse order
+      }
+    }
+    while (data.size() % 4)
+      data.push_back(0);
+    cmap.insert(cmap.end(), (uint8_t *)&t, (uint8_t *)&t + sizeof(t));
+    font.Letters.insert(font.Letters.end(), r.Letters.begin(), r.Letters.end());
+    gid += n;
+  }
+  cmap.insert(cmap.end(), data.begin(), data.end());
+  uint32_t glyphs = gid;
+
+  // Glyphs: a header of Adv_bits + 2 Xy_bits + 2 Wh_bits, the bitmap right after, each glyph from a whole byte
+  std::vector<uint8_t> glyf;
+  std::vector<uint32_t> loca;
+  int max_wh = std::min((1 << s.Wh_bits) - 1, s.Size), max_xy = (1 << (s.Xy_bits - 1)) - 1;
+  for (uint32_t g = 0; g < glyphs; g++) {
+    Bench_Bits b;
+    int w = g == 0 || rng() % 40 == 0 ? 0 : 1 + (int)(rng() % max_wh);   // A few blank ones, like the space
+    int hh = w ? 1 + (int)(rng() % max_wh) : 0;
+    if (s.Adv_bits)
+      b.Put(w + rng() % 4, s.Adv_bits);
+    b.Put((uint32_t)((int)(rng() % (2 * max_xy + 1)) - max_xy), s.Xy_bits);
+    b.Put((uint32_t)((int)(rng() % (2 * max_xy + 1)) - max_xy), s.Xy_bits);
+    b.Put(w, s.Wh_bits);
+    b.Put(hh, s.Wh_bits);
+    for (int p = 0; p < w * hh; p++)
+      b.Put(rng() % 3 ? rng() & ((1 << s.Bpp) - 1) : 0, s.Bpp);
+    loca.push_back(8 + (uint32_t)glyf.size());
+    glyf.insert(glyf.end(), b.Out.begin(), b.Out.end());
+  }
+
+  std::vector<uint8_t> loca_body;
+  Bench_Put(loca_body, glyphs);
+  for (uint32_t o : loca) {
+    if (s.Loca32)
+      Bench_Put(loca_body, o);
+    else
+      Bench_Put(loca_body, (uint16_t)o);
+  }
+  while (loca_body.size() % 4)
+    loca_body.push_back(0);
+
+  std::vector<uint8_t> kern;
+  if (s.Kern == 1) {                                            // Sorted pairs of 16-bit ids
+    std::set<std::pair<uint16_t, uint16_t>> pairs;
+    while (pairs.size() < 2000)
+      pairs.insert({(uint16_t)(1 + rng() % 300), (uint16_t)(1 + rng() % 300)});
+    kern = {0, 0, 0, 0};
+    Bench_Put(kern, (uint32_t)pairs.size());
+    for (auto &p : pairs) {
+      Bench_Put(kern, p.first);
+      Bench_Put(kern, p.second);
+    }
+    for (size_t k = 0; k < pairs.size(); k++)
+      kern.push_back((uint8_t)(int8_t)((int)(rng() % 31) - 15));
+  } else if (s.Kern == 3) {                                     // Classes
+    uint8_t rows = 6, cols = 5;
+    kern = {3, 0, 0, 0};
+    Bench_Put(kern, (uint16_t)glyphs);
+    kern.push_back(rows);
+    kern.push_back(cols);
+    for (uint32_t g = 0; g < glyphs; g++)
+      kern.push_back((uint8_t)(rng() % (rows + 1)));
+    for (uint32_t g = 0; g < glyphs; g++)
+      kern.push_back((uint8_t)(rng() % (cols + 1)));
+    for (int k = 0; k < rows * cols; k++)
+      kern.push_back((uint8_t)(int8_t)((int)(rng() % 31) - 15));
+  }
+
+  std::vector<uint8_t> head((uint8_t *)&h, (uint8_t *)&h + sizeof(h));
+  Bench_Table(font.File, "head", head);
+  Bench_Table(font.File, "cmap", cmap);
+  Bench_Table(font.File, "loca", loca_body);
+  Bench_Table(font.File, "glyf", glyf);
+  if (s.Kern)
+    Bench_Table(font.File, "kern", kern);
+  return font;
+}
+
+/********************************************************** Checks **********************************************************/
+// Descriptors and bitmaps of every letter, each followed by a random one for kerning, and of letters not in the font
+static void Bench_Compare(const char *What, const lv_font_t *Full, const lv_font_t *Paged,
+                          const std::vector<uint32_t> &Letters, std::mt19937 &rng)
+{
+  lv_draw_buf_t *a = lv_draw_buf_create(255, 255, LV_COLOR_FORMAT_A8, 0);
+  lv_draw_buf_t *b = lv_draw_buf_create(255, 255, LV_COLOR_FORMAT_A8, 0);
+  std::vector<uint32_t> asked = Letters;
+  for (uint32_t c : {0x1Fu, 0x7Fu, 0x3000u, 0x4DFFu, 0xA000u, 0x1F600u})
+    asked.push_back(c);
+  int bad = 0;
+  for (uint32_t c : asked) {
+    uint32_t next = Letters[rng() % Letters.size()];
+    lv_font_glyph_dsc_t ga, gb;
+    bool fa = lv_font_get_glyph_dsc(Full, &ga, c, next);
+    bool fb = lv_font_get_glyph_dsc(Paged, &gb, c, next);
+    bool same = fa == fb && ga.adv_w == gb.adv_w && ga.box_w == gb.box_w && ga.box_h == gb.box_h &&
+                ga.ofs_x == gb.ofs_x && ga.ofs_y == gb.ofs_y && ga.format == gb.format;
+    if (same && fa && ga.box_w * ga.box_h != 0) {
+      memset(a->data, 0x5A, a->data_size);
+      memset(b->data, 0xA5, b->data_size);
+      const void *pa = lv_font_get_glyph_bitmap(&ga, c, a);
+      const void *pb = lv_font_get_glyph_bitmap(&gb, c, b);
+      same = pa && pb && memcmp(a->data, b->data, (size_t)ga.box_w * ga.box_h) == 0;
+    }
+    if (!same && bad++ < 3)
+      printf("  %s: U+%04X differs (adv %u/%u box %ux%u/%ux%u)\n", What, c, ga.adv_w, gb.adv_w, ga.box_w, ga.box_h,
+             gb.box_w, gb.box_h);
+  }
+  CHECK(bad == 0, "%s: %d of %zu characters differ from lv_binfont_create()", What, bad, asked.size());
+  lv_draw_buf_destroy(a);
+  lv_draw_buf_destroy(b);
+}
+
+static Paged_Font_Stats_t Bench_Stats(void)
+{
+  Paged_Font_Stats_t st;
+  Paged_Font_Get_Stats(&st);
+  return st;
+}
+
+static void Bench_Check_Font(const char *Name, const Bench_Font &f, bool Whole_bytes, std::mt19937 &rng)
+{
+  std::string card = std::string("S:/fonts/") + Name + ".bin", pack = std::string("P:fonts/") + Name;
+  Bench_Files[card] = f.File;
+  Bench_Files[pack] = f.File;
+  lv_font_t *full = lv_binfont_create(card.c_str());
+  CHECK(full != NULL, "%s: lv_binfont_create() refused the bench's font", Name);
+  if (full == NULL)
+    return;
+
+  lv_font_t *paged = Paged_Font_Create(card.c_str());
+  CHECK(paged && Paged_Font_Is(paged) && !Paged_Font_Is(full), "%s: not created from the card", Name);
+  if (paged) {
+    CHECK(paged->line_height == full->line_height && paged->base_line == full->base_line &&
+          paged->underline_position == full->underline_position, "%s: font metrics differ", Name);
+    Bench_Compare((std::string(Name) + " card").c_str(), full, paged, f.Letters, rng);
+    Paged_Font_Destroy(paged);
+  }
+
+  // Mapped: tables and, with whole-byte headers, bitmaps used in place
+  std::vector<uint8_t> mapped(f.File.size() + 8);
+  memcpy(mapped.data(), f.File.data(), f.File.size());
+  Bench_Mapped["fonts/" + std::string(Name)] = mapped.data();
+  Paged_Font_Stats_t before = Bench_Stats();
+  paged = Paged_Font_Create(pack.c_str());
+  CHECK(paged != NULL, "%s: not created from a mapped pack", Name);
+  if (paged) {
+    Bench_Compare((std::string(Name) + " mapped").c_str(), full, paged, f.Letters, rng);
+    Paged_Font_Stats_t st = Bench_Stats();
+    uint32_t in_place = st.In_place - before.In_place, misses = st.Misses - before.Misses;
+    if (Whole_bytes)
+      CHECK(in_place > 0 && misses == 0, "%s: mapped bitmaps copied (%u in place, %u copied)", Name, in_place, misses);
+    else
+      CHECK(in_place == 0 && misses > 0, "%s: mid-byte bitmaps used in place", Name);
+    Paged_Font_Destroy(paged);
+  }
+
+  // Mapped at an odd address: nothing 16 or 32 bits wide may be used in place
+  memmove(mapped.data() + 1, mapped.data(), f.File.size());
+  Bench_Mapped["fonts/" + std::string(Name)] = mapped.data() + 1;
+  paged = Paged_Font_Create(pack.c_str());
+  CHECK(paged != NULL, "%s: not created from an odd address", Name);
+  if (paged) {
+    Bench_Compare((std::string(Name) + " odd").c_str(), full, paged, f.Letters, rng);
+    Paged_Font_Destroy(paged);
+  }
+  Bench_Mapped.erase("fonts/" + std::string(Name));
+  lv_binfont_destroy(full);
+}
+
+// Every CJK glyph drawn, twice over: far more than the cache holds
+static void Bench_Check_Cache(const Bench_Font &f, std::mt19937 &rng)
+{
+  lv_font_t *full = lv_binfont_create("S:/fonts/cjk_16.bin");
+  lv_font_t *paged = Paged_Font_Create("S:/fonts/cjk_16.bin");
+  lv_draw_buf_t *buf = lv_draw_buf_create(255, 255, LV_COLOR_FORMAT_A8, 0);
+  Paged_Font_Stats_t before = Bench_Stats();
+  uint32_t over = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    for (uint32_t c : f.Letters) {
+      lv_font_glyph_dsc_t g;
+      if (lv_font_get_glyph_dsc(paged, &g, c, 0) && g.box_w * g.box_h != 0)
+        lv_font_get_glyph_bitmap(&g, c, buf);
+      over += Bench_Stats().Resident > PAGED_FONT_CACHE_SIZE;
+    }
+  }
+  Paged_Font_Stats_t st = Bench_Stats();
+  CHECK(over == 0, "cache over PAGED_FONT_CACHE_SIZE after %u glyphs", over);
+  CHECK(st.Evictions > before.Evictions && st.Peak <= PAGED_FONT_CACHE_SIZE, "no evictions, or peak %u over budget",
+        st.Peak);
+  CHECK(st.Misses - before.Misses > f.Letters.size(), "glyphs evicted were not read again");
+  Bench_Compare("cjk_16 after eviction", full, paged, f.Letters, rng);      // Some cached, most read again
+  lv_draw_buf_destroy(buf);
+  Paged_Font_Destroy(paged);
+  lv_binfont_destroy(full);
+  st = Bench_Stats();
+  CHECK(st.Resident == 0 && st.Fonts == 0 && st.Index_bytes == 0, "fonts destroyed, %u bytes cached, %u fonts open",
+        st.Resident, st.Fonts);
+}
+
+static void Bench_Check_Damaged(const Bench_Font &f)
+{
+  struct {
+    const char *What;
+    uint32_t    Offset;                                         // Byte to change, or the length to cut to
+    int         Value;                                          // -1: cut
+  } cases[] = {
+    {"empty", 0, -1}, {"head only", 48, -1}, {"truncated glyphs", (uint32_t)f.File.size() * 3 / 4, -1},
+    {"bad head label", 4, 'x'}, {"cmap length", 48, 0xFF}, {"no kern table", (uint32_t)f.File.size() - 4, -1},
+  };
+  for (auto &c : cases) {
+    std::vector<uint8_t> bad = f.File;
+    if (c.Value < 0)
+      bad.resize(c.Offset);
+    else
+      bad[c.Offset] = (uint8_t)c.Value;
+    Bench_Files["S:/bad.bin"] = bad;
+    lv_font_t *font = Paged_Font_Create("S:/bad.bin");
+    CHECK(font == NULL, "%s: accepted", c.What);
+    Paged_Font_Destroy(font);
+  }
+
+  // Glyph offsets out of order: the sizes taken from them would wrap
+  std::vector<uint8_t> bad = f.File;
+  uint32_t head, cmap;
+  memcpy(&head, &bad[0], 4);
+  memcpy(&cmap, &bad[head], 4);
+  uint32_t first = head + cmap + 12 + 4 * 10;                   // 32-bit offset of glyph 10
+  memset(&bad[first], 0xFF, 4);
+  Bench_Files["S:/bad.bin"] = bad;
+  lv_font_t *font = Paged_Font_Create("S:/bad.bin");
+  CHECK(font == NULL, "glyph offsets out of order: accepted");
+  Paged_Font_Destroy(font);
+  CHECK(lv_binfont_create("S:/missing.bin") == NULL && Paged_Font_Create("S:/missing.bin") == NULL,
+        "missing file opened");
+  Bench_Files.erase("S:/bad.bin");
+}
+
+/********************************************************** Report **********************************************************/
+// Load both ways and draw a line of text, as the board's Paged_Font_Bench() does, with the card modelled
+static void Bench_Report(const char *Path)
+{
+  Paged_Font_Report_t r;
+  uint32_t calls = Bench_Calls, blocks = Bench_Card_blocks;
+  esp_err_t err = Paged_Font_Measure(Path, PAGED_FONT_BENCH_TEXT, &r);
+  CHECK(err == ESP_OK && r.Mismatches == 0 && r.Characters > 20, "%s: measure %d, %u mismatches", Path, err,
+        r.Mismatches);
+  printf("  %-22s %5u glyphs %5u KB file: full %5u KB %6.1f ms, paged %4u KB (%2u%%) %5.1f ms; %u characters "
+         "full %u us, paged cold %u us, warm %u us\n", Path, r.Glyphs, r.File_bytes / 1024, r.Full_bytes / 1024,
+         r.Full_load_us / 1000.0, r.Index_bytes / 1024, r.Index_bytes * 100 / r.Full_bytes, r.Paged_load_us / 1000.0,
+         r.Characters, r.Full_text_us, r.Cold_text_us, r.Warm_text_us);
+  printf("  %-22s %u lv_fs reads, %u card blocks over both loads and the text\n", "", Bench_Calls - calls,
+         Bench_Card_blocks - blocks);
+}
+
+// Pages of text, each redrawn a few times and revisited: the hit rate the cache gives a UI
+static void Bench_Session(const Bench_Font &f, std::mt19937 &rng)
+{
+  lv_font_t *paged = Paged_Font_Create("S:/fonts/cjk_16.bin");
+  lv_draw_buf_t *buf = lv_draw_buf_create(255, 255, LV_COLOR_FORMAT_A8, 0);
+  std::vector<uint32_t> cjk(f.Letters.end() - 3000, f.Letters.end());   // The common ones, most frequent first
+  std::vector<std::string> pages;
+  for (int p = 0; p < 40; p++) {
+    std::string text;
+    for (int k = 0; k < 300; k++) {                              // Zipf-like: a few hundred characters do most
+      double u = std::uniform_real_distribution<double>(0, 1)(rng);
+      text += Bench_Utf8(cjk[(size_t)(cjk.size() * u * u * u)]);
+    }
+    pages.push_back(text);
+  }
+  Paged_Font_Stats_t before = Bench_Stats();
+  for (int view = 0; view < 400; view++) {
+    const std::string &text = pages[rng() % 4 ? rng() % 8 : rng() % pages.size()];   // Mostly the same few screens
+    uint32_t i = 0, c;
+    while ((c = Bench_Utf8_Next(text.c_str(), &i)) != 0) {
+      lv_font_glyph_dsc_t g;
+      if (lv_font_get_glyph_dsc(paged, &g, c, 0) && g.box_w * g.box_h != 0)
+        lv_font_get_glyph_bitmap(&g, c, buf);
+    }
+  }
+  Paged_Font_Stats_t st = Bench_Stats();
+  uint32_t hits = st.Hits - before.Hits, misses = st.Misses - before.Misses;
+  printf("  session: 400 views of 40 pages, 300 characters each: %u hits, %u misses (%.1f%% hit), %u evictions, "
+         "%u KB cached of %u\n", hits, misses, 100.0 * hits / (hits + misses), st.Evictions - before.Evictions,
+         st.Resident / 1024, PAGED_FONT_CACHE_SIZE / 1024);
+  lv_draw_buf_destroy(buf);
+  Paged_Font_Destroy(paged);
+}
+
+int main(int argc, char **argv)
+{
+  int ideographs = argc > 1 ? atoi(argv[1]) : 6000;
+  std::mt19937 rng(1234);
+  _lv_text_encoded_next = Bench_Utf8_Next;
+  Sim_Time_Follow_Host(true);
+
+  Bench_Spec cjk = {"cjk_16", 16, 4, 9, 5, 5, true, 1, {}};
+  Bench_Spec latin = {"latin_24", 24, 2, 8, 4, 8, false, 3, {}};
+  Bench_Range ascii = {LV_FONT_FMT_TXT_CMAP_FORMAT0_TINY, {}};
+  for (uint32_t c = 0x20; c < 0x7F; c++)
+    ascii.Letters.push_back(c);
+  Bench_Range latin1 = {LV_FONT_FMT_TXT_CMAP_FORMAT0_FULL, {}};
+  for (uint32_t c = 0xA0; c <= 0xFF; c++)
+    latin1.Letters.push_back(c);
+  Bench_Range cyrillic = {LV_FONT_FMT_TXT_CMAP_SPARSE_FULL, {}};
+  for (uint32_t c = 0x410; c < 0x450; c++)
+    cyrillic.Letters.push_back(c);
+  std::set<uint32_t> han;
+  uint32_t i = 0, c;
+  while ((c = Bench_Utf8_Next(PAGED_FONT_BENCH_TEXT, &i)) != 0) {   // The board's bench text is all in the font
+    if (c >= 0x4E00)
+      han.insert(c);
+  }
+  while ((int)han.size() < ideographs)
+    han.insert(0x4E00 + rng() % (0xA000 - 0x4E00));
+  Bench_Range ideo = {LV_FONT_FMT_TXT_CMAP_SPARSE_TINY, std::vector<uint32_t>(han.begin(), han.end())};
+  cjk.Ranges = {ascii, latin1, cyrillic, ideo};
+  latin.Ranges = {ascii, latin1};
+  Bench_Font cjk_font = Bench_Make_Font(cjk, rng);
+  Bench_Font latin_font = Bench_Make_Font(latin, rng);
+  printf("font_bench: cjk_16 %zu glyphs %zu KB, latin_24 %zu glyphs %zu KB, cache %u KB\n", cjk_font.Letters.size(),
+         cjk_font.File.size() / 1024, latin_font.Letters.size(), latin_font.File.size() / 1024,
+         PAGED_FONT_CACHE_SIZE / 1024);
+
+  Bench_Check_Font("cjk_16", cjk_font, false, rng);
+  Bench_Check_Font("latin_24", latin_font, true, rng);
+  Bench_Check_Cache(cjk_font, rng);
+  Bench_Check_Damaged(cjk_font);
+
+  printf("Load and draw, card modelled (%.0f us a command, %.0f bytes/us, %.0f us a cache call):\n", BENCH_CMD_US,
+         BENCH_BYTES_PER_US, BENCH_HIT_US);
+  Bench_Report("S:/fonts/cjk_16.bin");
+  Bench_Report("S:/fonts/latin_24.bin");
+  Bench_Session(cjk_font, rng);
+  printf("\nAs Paged_Font_Bench() prints it on the board:\n");
+  const char *paths[] = {"S:/fonts/cjk_16.bin"};
+  Paged_Font_Bench(paths, 1, PAGED_FONT_BENCH_TEXT);
+
+  if (Failures) {
+    printf("%d checks failed\n", Failures);
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
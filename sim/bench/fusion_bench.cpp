@@ -0,0 +1,342 @@
+// Host accuracy and throughput bench for the IMU fusion filters (src/IMU_Fusion.cpp).
+//
+// Replays an IMU recording through Madgwick and Mahony, compares the tilt against the reference attitude and
+// times the update. Without a recording it synthesizes one: a tilted rest, 12 s of motion on all axes and a
+// vibrating rest, quantized with the driver's default scales and with gyro bias and sensor noise added.
+// It also hammers the seqlock the attitude is published through (src/Seqlock.h) from two threads: no copy a reader
+// keeps may be torn.
+//
+// Build from the repository root:
+//   mkdir -p sim/build
+//   g++ -std=gnu++17 -O2 -pthread -Isim -Isim/include -Isrc sim/bench/fusion_bench.cpp src/IMU_Fusion.cpp src/IMU_Stream.cpp
+//       sim/Sim_Runtime.cpp -o sim/build/fusion_bench
+// (one command line)
+// Run:
+//   sim/build/fusion_bench                      synthetic recording
+//   sim/build/fusion_bench --record out.csv     also write the synthetic recording
+//   sim/build/fusion_bench --replay in.csv      use a recording instead
+//
+// Recording format, one sample per line: time_us,ax,ay,az,gx,gy,gz[,qw,qx,qy,qz] with g and dps. The reference
+// quaternion (sensor to earth, like IMU_Fusion_t) is optional; without it only throughput and jitter are reported.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <random>
+#include <thread>
+#include <vector>
+#include "IMU_Fusion.h"
+#include "Seqlock.h"
+
+#define BENCH_ODR_HZ        896.8f                      // QMI8658 "1000 Hz" in 6-axis mode, the FIFO default
+#define BENCH_ACC_SCALE     (4.0f / 32768.0f)           // ACC_RANGE_4G
+#define BENCH_GYR_SCALE     (64.0f / 32768.0f)          // GYR_RANGE_64DPS
+#define BENCH_SETTLE_S      2.0f                        // Excluded from the error statistics
+#define BENCH_DISPLAY_MS    100                         // The UI refresh the tilt is sampled at
+#define BENCH_MAX_TILT_RMS  2.0f                        // Degrees, pass/fail limits
+#define BENCH_MAX_TILT_ERR  6.0f
+
+typedef struct {
+  uint32_t Time_us;
+  float    Acc[3];
+  float    Gyr[3];
+  float    Q[4];
+  bool     Has_ref;
+} Bench_Sample_t;
+
+/********************************************************** Synthetic recording **********************************************************/
+static void Quat_Integrate(double q[4], const double w[3], double dt)   // q' = q * (0, w) / 2
+{
+  double d0 = 0.5 * (-q[1] * w[0] - q[2] * w[1] - q[3] * w[2]);
+  double d1 = 0.5 * (q[0] * w[0] + q[2] * w[2] - q[3] * w[1]);
+  double d2 = 0.5 * (q[0] * w[1] - q[1] * w[2] + q[3] * w[0]);
+  double d3 = 0.5 * (q[0] * w[2] + q[1] * w[1] - q[2] * w[0]);
+  q[0] += d0 * dt; q[1] += d1 * dt; q[2] += d2 * dt; q[3] += d3 * dt;
+  double n = 1.0 / sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  for (int i = 0; i < 4; i++)
+    q[i] *= n;
+}
+
+static void Gravity_Body(const double q[4], double g[3])   // Earth z axis seen from the sensor
+{
+  g[0] = 2.0 * (q[1] * q[3] - q[0] * q[2]);
+  g[1] = 2.0 * (q[0] * q[1] + q[2] * q[3]);
+  g[2] = q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3];
+}
+
+static float Quantize(double v, float scale)
+{
+  double raw = round(v / scale);
+  raw = raw > 32767 ? 32767 : (raw < -32768 ? -32768 : raw);
+  return (float)(raw * scale);
+}
+
+static std::vector<Bench_Sample_t> Synthesize(void)
+{
+  std::vector<Bench_Sample_t> rec;
+  std::mt19937 rng(8658);
+  std::normal_distribution<double> acc_noise(0.0, 0.01), gyr_noise(0.0, 0.08);
+  const double bias[3] = {0.6, -0.4, 0.3};              // dps, typical zero-rate offset
+  const double d2r = M_PI / 180.0, period = 1.0 / BENCH_ODR_HZ;
+  const int substeps = 8;
+  double q[4] = {cos(10 * d2r / 2), sin(10 * d2r / 2), 0, 0};   // 10 degrees of roll
+
+  for (int k = 0; k < (int)(20.0 * BENCH_ODR_HZ); k++) {
+    double t = k * period;
+    double w[3] = {0, 0, 0}, lin[3] = {0, 0, 0};
+    if (t >= 3.0 && t < 15.0) {                         // Wrist-like motion, within the 64 dps range
+      double u = t - 3.0;
+      w[0] = 45 * sin(2 * M_PI * 0.35 * u);
+      w[1] = 35 * sin(2 * M_PI * 0.23 * u + 1.0);
+      w[2] = 50 * sin(2 * M_PI * 0.11 * u + 2.0);
+      lin[0] = 0.05 * sin(2 * M_PI * 1.3 * u);           // Some linear acceleration the filter has to reject
+      lin[1] = 0.04 * sin(2 * M_PI * 0.9 * u + 0.5);
+    } else if (t >= 15.0) {                             // Resting on a running fan: 30 Hz vibration
+      lin[2] = 0.08 * sin(2 * M_PI * 30 * t);
+      lin[0] = 0.05 * sin(2 * M_PI * 30 * t + 0.7);
+    }
+    for (int s = 0; s < substeps; s++) {
+      double wr[3] = {w[0] * d2r, w[1] * d2r, w[2] * d2r};
+      Quat_Integrate(q, wr, period / substeps);
+    }
+    double g[3];
+    Gravity_Body(q, g);
+
+    Bench_Sample_t b;
+    b.Time_us = (uint32_t)llround(t * 1e6);
+    for (int i = 0; i < 3; i++) {
+      b.Acc[i] = Quantize(g[i] + lin[i] + acc_noise(rng), BENCH_ACC_SCALE);
+      b.Gyr[i] = Quantize(w[i] + bias[i] + gyr_noise(rng), BENCH_GYR_SCALE);
+    }
+    for (int i = 0; i < 4; i++)
+      b.Q[i] = (float)q[i];
+    b.Has_ref = true;
+    rec.push_back(b);
+  }
+  return rec;
+}
+
+/********************************************************** Recording files **********************************************************/
+static bool Load(const char *path, std::vector<Bench_Sample_t> &rec)
+{
+  FILE *f = fopen(path, "r");
+  if (f == NULL)
+    return false;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    Bench_Sample_t b = {};
+    unsigned long t;
+    int n = sscanf(line, "%lu,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f", &t, &b.Acc[0], &b.Acc[1], &b.Acc[2],
+                   &b.Gyr[0], &b.Gyr[1], &b.Gyr[2], &b.Q[0], &b.Q[1], &b.Q[2], &b.Q[3]);
+    if (n < 7)
+      continue;                                         // Header or comment
+    b.Time_us = (uint32_t)t;
+    b.Has_ref = n == 11;
+    rec.push_back(b);
+  }
+  fclose(f);
+  return !rec.empty();
+}
+
+static void Save(const char *path, const std::vector<Bench_Sample_t> &rec)
+{
+  FILE *f = fopen(path, "w");
+  if (f == NULL) {
+    printf("cannot write %s\n", path);
+    return;
+  }
+  fprintf(f, "time_us,ax,ay,az,gx,gy,gz,qw,qx,qy,qz\n");
+  for (const Bench_Sample_t &b : rec)
+    fprintf(f, "%u,%.6f,%.6f,%.6f,%.5f,%.5f,%.5f,%.7f,%.7f,%.7f,%.7f\n", b.Time_us, b.Acc[0], b.Acc[1], b.Acc[2],
+            b.Gyr[0], b.Gyr[1], b.Gyr[2], b.Q[0], b.Q[1], b.Q[2], b.Q[3]);
+  fclose(f);
+}
+
+/********************************************************** Evaluation **********************************************************/
+typedef void (*Bench_Update_t)(IMU_Fusion_t *f, const float Gyr_dps[3], const float Acc_g[3], float Dt_s);
+
+typedef struct {
+  double Tilt_rms;
+  double Tilt_max;
+  double Jitter;                                        // Std of the displayed tilt over the final rest, degrees
+  double Ns_per_update;
+} Bench_Result_t;
+
+static double Tilt_Error(const float q[4], const float ref[4])   // Angle between the two gravity directions, degrees
+{
+  double a[3], b[3], qa[4] = {q[0], q[1], q[2], q[3]}, qb[4] = {ref[0], ref[1], ref[2], ref[3]};
+  Gravity_Body(qa, a);
+  Gravity_Body(qb, b);
+  double c = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+  c = c > 1 ? 1 : (c < -1 ? -1 : c);
+  return acos(c) * 180.0 / M_PI;
+}
+
+static double Tilt_Of(const float g[3])                  // Tilt from vertical as a display would show it, degrees
+{
+  return atan2(sqrt(g[0] * g[0] + g[1] * g[1]), g[2]) * 180.0 / M_PI;
+}
+
+static double Std(const std::vector<double> &v)
+{
+  double m = 0, s = 0;
+  for (double x : v)
+    m += x;
+  m /= v.size();
+  for (double x : v)
+    s += (x - m) * (x - m);
+  return sqrt(s / v.size());
+}
+
+static Bench_Result_t Evaluate(const std::vector<Bench_Sample_t> &rec, Bench_Update_t update)
+{
+  Bench_Result_t r = {};
+  IMU_Fusion_t f;
+  IMU_Fusion_Reset(&f);
+  IMU_Fusion_Align(&f, rec[0].Acc);
+
+  double sum2 = 0;
+  uint32_t counted = 0, next_display_us = 0;
+  uint32_t rest_us = rec.back().Time_us > 5000000 ? rec.back().Time_us - 4000000 : 0;
+  std::vector<double> shown;
+  for (size_t k = 1; k < rec.size(); k++) {
+    const Bench_Sample_t &b = rec[k];
+    update(&f, b.Gyr, b.Acc, (b.Time_us - rec[k - 1].Time_us) * 1e-6f);
+    if (b.Has_ref && b.Time_us >= BENCH_SETTLE_S * 1e6f) {
+      double e = Tilt_Error(f.Q, b.Q);
+      sum2 += e * e;
+      counted++;
+      if (e > r.Tilt_max)
+        r.Tilt_max = e;
+    }
+    if (b.Time_us >= next_display_us) {
+      next_display_us += BENCH_DISPLAY_MS * 1000;
+      if (b.Time_us >= rest_us) {
+        double qd[4] = {f.Q[0], f.Q[1], f.Q[2], f.Q[3]}, g[3];
+        Gravity_Body(qd, g);
+        float gf[3] = {(float)g[0], (float)g[1], (float)g[2]};
+        shown.push_back(Tilt_Of(gf));
+      }
+    }
+  }
+  r.Tilt_rms = counted ? sqrt(sum2 / counted) : 0;
+  r.Jitter = shown.size() > 1 ? Std(shown) : 0;
+
+  // Throughput: the whole recording several times over, without the bookkeeping above
+  const int loops = 20;
+  volatile float sink = 0;
+  timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int l = 0; l < loops; l++) {
+    IMU_Fusion_Align(&f, rec[0].Acc);
+    for (size_t k = 1; k < rec.size(); k++)
+      update(&f, rec[k].Gyr, rec[k].Acc, 1.0f / BENCH_ODR_HZ);
+    sink += f.Q[0];
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  r.Ns_per_update = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / ((double)loops * (rec.size() - 1));
+  return r;
+}
+
+// What the firmware would show without fusion: tilt straight from one accelerometer sample every display period
+static double Raw_Jitter(const std::vector<Bench_Sample_t> &rec)
+{
+  std::vector<double> shown;
+  uint32_t next_display_us = 0, rest_us = rec.back().Time_us > 5000000 ? rec.back().Time_us - 4000000 : 0;
+  for (const Bench_Sample_t &b : rec) {
+    if (b.Time_us < next_display_us)
+      continue;
+    next_display_us += BENCH_DISPLAY_MS * 1000;
+    if (b.Time_us >= rest_us)
+      shown.push_back(Tilt_Of(b.Acc));
+  }
+  return shown.size() > 1 ? Std(shown) : 0;
+}
+
+// A writer publishing as fast as it can, a reader copying as fast as it can: every field of a copy it keeps must come
+// from the same publish
+static bool Seqlock_Stress(void)
+{
+  typedef struct {
+    uint32_t Words[64];                                         // Larger than an attitude, so copies often overlap
+  } Value_t;
+  static Value_t slots[2];
+  static Seqlock_t lock = {0};
+  const uint32_t publishes = 2000000;
+  volatile bool done = false;
+  std::thread writer([&] {
+    for (uint32_t n = 1; n <= publishes; n++) {
+      Value_t *v = &slots[Seqlock_Write_Slot(&lock)];
+      for (uint32_t &w : v->Words)
+        __atomic_store_n(&w, n, __ATOMIC_RELAXED);
+      Seqlock_Publish(&lock);
+    }
+    done = true;
+  });
+  uint32_t kept = 0, given_up = 0, torn = 0;
+  while (!done) {
+    Value_t v;
+    if (!Seqlock_Read(&lock, slots, sizeof(Value_t), &v)) {
+      given_up += __atomic_load_n(&lock.Seq, __ATOMIC_RELAXED) != 0;
+      continue;
+    }
+    kept++;
+    for (uint32_t w : v.Words)
+      torn += w != v.Words[0];
+  }
+  writer.join();
+  printf("seqlock: %u publishes, %u copies kept, %u given up after %d tries, %u torn\n", publishes, kept, given_up,
+         SEQLOCK_TRIES, torn);
+  return torn == 0 && kept > 0;
+}
+
+int main(int argc, char **argv)
+{
+  const char *replay = NULL, *record = NULL;
+  for (int i = 1; i + 1 < argc; i++) {
+    if (strcmp(argv[i], "--replay") == 0)
+      replay = argv[++i];
+    else if (strcmp(argv[i], "--record") == 0)
+      record = argv[++i];
+  }
+
+  std::vector<Bench_Sample_t> rec;
+  if (replay) {
+    if (!Load(replay, rec)) {
+      printf("cannot read %s\n", replay);
+      return 2;
+    }
+  } else {
+    rec = Synthesize();
+  }
+  if (record)
+    Save(record, rec);
+  bool has_ref = rec.back().Has_ref;
+  printf("fusion bench: %zu samples, %.1f s, %s\n", rec.size(), (rec.back().Time_us - rec[0].Time_us) * 1e-6,
+         replay ? replay : "synthetic");
+
+  struct { const char *Name; Bench_Update_t Update; } filters[] = {
+    { "madgwick", IMU_Fusion_Update_Madgwick },
+    { "mahony",   IMU_Fusion_Update_Mahony },
+  };
+  bool fail = false;
+  printf("\n%-10s %10s %10s %12s %10s\n", "filter", "tilt rms", "tilt max", "jitter 1sd", "ns/update");
+  printf("%-10s %10s %10s %12.3f %10s\n", "raw accel", "-", "-", Raw_Jitter(rec), "-");
+  for (auto &flt : filters) {
+    Bench_Result_t r = Evaluate(rec, flt.Update);
+    if (has_ref)
+      printf("%-10s %10.3f %10.3f %12.3f %10.1f\n", flt.Name, r.Tilt_rms, r.Tilt_max, r.Jitter, r.Ns_per_update);
+    else
+      printf("%-10s %10s %10s %12.3f %10.1f\n", flt.Name, "-", "-", r.Jitter, r.Ns_per_update);
+    if (has_ref && (r.Tilt_rms > BENCH_MAX_TILT_RMS || r.Tilt_max > BENCH_MAX_TILT_ERR)) {
+      printf("fusion bench: %s exceeds %.1f deg rms / %.1f deg max\n", flt.Name, BENCH_MAX_TILT_RMS, BENCH_MAX_TILT_ERR);
+      fail = true;
+    }
+  }
+  printf("\nDegrees; jitter is the spread of the tilt a %d ms display refresh would show during the last 4 s.\n",
+         BENCH_DISPLAY_MS);
+  if (!Seqlock_Stress())
+    fail = true;
+  return fail ? 1 : 0;
+}
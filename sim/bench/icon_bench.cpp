@@ -0,0 +1,366 @@
+// Host bench for single-colour icons: the A8 blend kernels of include/Icon_Blend.h, the indexed icon decoder of
+// src/Icon_Image.cpp and what tools/image_compress.py --icon wrote into src/ui.
+//
+//   - the UI's icons, A8 and LZ4 compressed in src/ui, must unpack to the alpha plane of the RGB565A8 images SquareLine
+//     exported (sim/bench/image_bench_ui.c);
+//   - the kernels must blend to the bit what LVGL's own loops blend (sim/bench/icon_bench_generic.c), over random
+//     masks, widths, alignments, strides, colours and opacities, called directly and through LVGL's blend with the
+//     hook in as lv_conf.h sets it;
+//   - I1, I2, I4 and I8 icons must expand to their palette's alpha, be decoded as A8 and cached, and pictures (more
+//     than one colour) and compressed images must be left to other decoders;
+//   - prints the bytes and blend times per format for the UI's icons and a 320x240 mask of text, the kernels against
+//     LVGL's loops, then Icon_Image_Bench() as the board prints it. Times are the host's, for comparison.
+//
+// Build from the repository root:
+//   mkdir -p sim/build
+//   g++ -std=gnu++17 -O2 -Wno-format -Isim -Isim/include -Iinclude -Isrc -Isrc/ui -Ilib/lvgl -Ilib/lvgl/src
+//       -DLV_CONF_INCLUDE_SIMPLE
+//       sim/bench/icon_bench.cpp src/Icon_Image.cpp src/Compressed_Image.cpp sim/Sim_Runtime.cpp
+//       -x c sim/bench/image_bench_ui.c -x c sim/bench/icon_bench_generic.c
+//       -x c lib/lvgl/src/draw/sw/blend/lv_draw_sw_blend_to_rgb565.c -x c lib/lvgl/src/libs/rle/lv_rle.c
+//       -x c lib/lvgl/src/libs/lz4/lz4.c -x none -o sim/build/icon_bench
+// (one command line)
+// Run:
+//   sim/build/icon_bench
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "lvgl.h"
+#include "ui.h"
+#include "src/draw/sw/blend/lv_draw_sw_blend_to_rgb565.h"
+#include "Icon_Blend.h"
+#include "Icon_Image.h"
+#include "Compressed_Image.h"
+#include "Sim_Time.h"
+
+#define BENCH_TEXT_W   320
+#define BENCH_TEXT_H   240
+#define BENCH_REPEATS  200
+
+extern "C" const lv_image_dsc_t Raw_home, Raw_settings;
+extern "C" void Generic_blend_color_to_rgb565(_lv_draw_sw_blend_fill_dsc_t *dsc);
+
+/********************************************************** LVGL stand-ins **********************************************************/
+static lv_image_decoder_t        Decoder;
+static lv_image_decoder_info_f_t Info_cb;
+static lv_image_decoder_open_f_t Open_cb;
+static lv_image_decoder_close_f_t Close_cb;
+static lv_cache_free_cb_t        Free_cb;
+static std::vector<lv_draw_buf_t *> Cached;
+static int Buffers = 0;                                         // Draw buffers alive
+static int Releases = 0;
+static lv_color_t Recolor;
+static lv_opa_t Recolor_opa;
+
+lv_image_decoder_t *lv_image_decoder_create(void) { return &Decoder; }
+void lv_image_decoder_set_info_cb(lv_image_decoder_t *d, lv_image_decoder_info_f_t cb) { Info_cb = cb; }
+void lv_image_decoder_set_open_cb(lv_image_decoder_t *d, lv_image_decoder_open_f_t cb) { Open_cb = cb; }
+void lv_image_decoder_set_get_area_cb(lv_image_decoder_t *d, lv_image_decoder_get_area_cb_t cb) {}
+void lv_image_decoder_set_close_cb(lv_image_decoder_t *d, lv_image_decoder_close_f_t cb) { Close_cb = cb; }
+void lv_image_decoder_set_cache_free_cb(lv_image_decoder_t *d, lv_cache_free_cb_t cb) { Free_cb = cb; }
+lv_draw_buf_t *lv_image_decoder_post_process(lv_image_decoder_dsc_t *dsc, lv_draw_buf_t *decoded) { return decoded; }
+lv_image_src_t lv_image_src_get_type(const void *src) { return LV_IMAGE_SRC_VARIABLE; }
+uint8_t lv_color_format_get_bpp(lv_color_format_t cf) { return LV_COLOR_FORMAT_GET_BPP(cf); }
+void *lv_memcpy(void *dst, const void *src, size_t len) { return memcpy(dst, src, len); }
+void *lv_memmove(void *dst, const void *src, size_t len) { return memmove(dst, src, len); }
+void lv_memset(void *dst, uint8_t v, size_t len) { memset(dst, v, len); }
+uint16_t lv_color_to_u16(lv_color_t c) { return ((c.red & 0xF8) << 8) | ((c.green & 0xFC) << 3) | (c.blue >> 3); }
+
+const lv_obj_class_t lv_image_class = {};
+bool lv_obj_check_type(const lv_obj_t *obj, const lv_obj_class_t *class_p) { return false; }
+void lv_obj_set_style_bg_image_recolor(lv_obj_t *obj, lv_color_t value, lv_style_selector_t selector) { Recolor = value; }
+void lv_obj_set_style_bg_image_recolor_opa(lv_obj_t *obj, lv_opa_t value, lv_style_selector_t selector)
+{
+  Recolor_opa = value;
+}
+void lv_obj_set_style_image_recolor(lv_obj_t *obj, lv_color_t value, lv_style_selector_t selector) {}
+void lv_obj_set_style_image_recolor_opa(lv_obj_t *obj, lv_opa_t value, lv_style_selector_t selector) {}
+
+lv_draw_buf_t *lv_draw_buf_create(uint32_t w, uint32_t h, lv_color_format_t cf, uint32_t stride)
+{
+  lv_draw_buf_t *buf = (lv_draw_buf_t *)calloc(1, sizeof(lv_draw_buf_t));
+  buf->header.magic = LV_IMAGE_HEADER_MAGIC;
+  buf->header.cf = cf;
+  buf->header.w = w;
+  buf->header.h = h;
+  buf->header.stride = stride;
+  buf->data_size = stride * h + (cf == LV_COLOR_FORMAT_RGB565A8 ? stride / 2 * h : 0);
+  buf->unaligned_data = malloc(buf->data_size);
+  buf->data = (uint8_t *)buf->unaligned_data;
+  Buffers++;
+  return buf;
+}
+
+void lv_draw_buf_destroy(lv_draw_buf_t *buf)
+{
+  if (buf == NULL)
+    return;
+  free(buf->unaligned_data);
+  free(buf);
+  Buffers--;
+}
+
+lv_cache_entry_t *lv_image_decoder_add_to_cache(lv_image_decoder_t *decoder, lv_image_cache_data_t *search_key,
+                                                const lv_draw_buf_t *decoded, void *user_data)
+{
+  Cached.push_back((lv_draw_buf_t *)decoded);
+  return (lv_cache_entry_t *)decoded;
+}
+
+void lv_cache_release(lv_cache_t *cache, lv_cache_entry_t *entry, void *user_data) { Releases++; }
+
+/********************************************************** Checks **********************************************************/
+static bool Ok = true;
+static std::mt19937 Rng(48);
+
+static void Check(bool Cond, const char *What, const std::string &Name)
+{
+  if (!Cond)
+    printf("FAILED: %s, %s\n", What, Name.c_str());
+  Ok &= Cond;
+}
+
+// Clear and solid runs with anti-aliased edges between them, as icons and glyphs have
+static std::vector<uint8_t> Mask(uint32_t Size)
+{
+  std::vector<uint8_t> m(Size);
+  uint8_t level = 0;
+  for (uint32_t i = 0; i < Size; i++) {
+    uint32_t r = Rng() % 16;
+    if (r == 0)
+      level = level ? 0 : 255;
+    m[i] = r == 1 ? Rng() % 256 : level;
+  }
+  return m;
+}
+
+static void Check_kernels(void)
+{
+  int cases = 0, same = 0;
+  for (int c = 0; c < 3000; c++) {
+    int32_t w = 1 + Rng() % 70, h = 1 + Rng() % 6;
+    int32_t dest_stride = (w + Rng() % 8) * 2, mask_stride = w + Rng() % 9;
+    uint32_t offset = Rng() % 4;                                // Mask alignment
+    std::vector<uint8_t> mask = Mask(offset + mask_stride * h);
+    std::vector<uint16_t> bg(dest_stride / 2 * h);
+    for (auto &p : bg)
+      p = Rng();
+    _lv_draw_sw_blend_fill_dsc_t dsc = {};
+    dsc.dest_w = w;
+    dsc.dest_h = h;
+    dsc.dest_stride = dest_stride;
+    dsc.mask_buf = mask.data() + offset;
+    dsc.mask_stride = mask_stride;
+    dsc.color = lv_color_make(Rng(), Rng(), Rng());
+    static const lv_opa_t opas[] = {LV_OPA_COVER, LV_OPA_COVER, 254, 128, 1};
+    dsc.opa = opas[c % 5];
+    std::vector<uint16_t> ref = bg, kernel = bg, hooked = bg;
+    dsc.dest_buf = ref.data();
+    Generic_blend_color_to_rgb565(&dsc);
+    dsc.dest_buf = kernel.data();
+    if (dsc.opa >= LV_OPA_MAX)
+      Icon_Blend_Mask_To_RGB565(&dsc);
+    else
+      Icon_Blend_Mask_Opa_To_RGB565(&dsc);
+    dsc.dest_buf = hooked.data();
+    lv_draw_sw_blend_color_to_rgb565(&dsc);
+    cases++;
+    same += ref == kernel && ref == hooked;
+  }
+  Check(same == cases, "kernels blend as LVGL does", std::to_string(cases - same) + " of " + std::to_string(cases));
+}
+
+// An indexed copy of an A8 mask, palette in Color at 2^bpp alpha levels, odd widths included
+static std::vector<uint8_t> Indexed(const uint8_t *A8, uint32_t W, uint32_t H, uint32_t Bpp, uint32_t Stride,
+                                    lv_color_t Color, std::vector<uint8_t> *Levels)
+{
+  uint32_t colors = 1 << Bpp, top = colors - 1;
+  std::vector<uint8_t> data(colors * 4 + Stride * H, 0);
+  for (uint32_t i = 0; i < colors; i++) {
+    data[i * 4] = Color.blue;
+    data[i * 4 + 1] = Color.green;
+    data[i * 4 + 2] = Color.red;
+    data[i * 4 + 3] = (i * 255 + top / 2) / top;
+  }
+  Levels->resize(W * H);
+  for (uint32_t y = 0; y < H; y++)
+    for (uint32_t x = 0; x < W; x++) {
+      uint32_t index = (A8[y * W + x] * top + 127) / 255;
+      data[colors * 4 + y * Stride + x * Bpp / 8] |= index << (8 - Bpp - x * Bpp % 8);
+      (*Levels)[y * W + x] = data[index * 4 + 3];
+    }
+  return data;
+}
+
+static void Check_indexed(void)
+{
+  static const lv_color_format_t formats[] = {LV_COLOR_FORMAT_I1, LV_COLOR_FORMAT_I2, LV_COLOR_FORMAT_I4,
+                                              LV_COLOR_FORMAT_I8};
+  for (lv_color_format_t cf : formats) {
+    uint32_t bpp = LV_COLOR_FORMAT_GET_BPP(cf);
+    std::string name = "I" + std::to_string(bpp);
+    uint32_t w = 33, h = 7, stride = (w * bpp + 7) / 8 + (bpp == 4);      // A padded stride for I4
+    std::vector<uint8_t> a8 = Mask(w * h), levels;
+    std::vector<uint8_t> data = Indexed(a8.data(), w, h, bpp, stride, lv_color_make(0xE3, 0xE3, 0xE3), &levels);
+    lv_image_dsc_t img = {};
+    img.header.magic = LV_IMAGE_HEADER_MAGIC;
+    img.header.cf = cf;
+    img.header.w = w;
+    img.header.h = h;
+    img.header.stride = stride;
+    img.data = data.data();
+    img.data_size = data.size();
+    Check(Icon_Image_Is(&img), "one-colour palette taken", name);
+    std::vector<uint8_t> out(w * h);
+    Check(Icon_Image_Expand(&img, out.data(), w) == ESP_OK && out == levels, "expands to the palette's alpha", name);
+
+    // As lv_image_decoder_open() and the draw would call the decoder: cached, then a one-shot no_cache draw
+    lv_image_header_t header;
+    Check(Info_cb(&Decoder, &img, &header) == LV_RESULT_OK && header.cf == LV_COLOR_FORMAT_A8 && header.stride == w,
+          "drawn as A8", name);
+    int cached = Cached.size(), buffers = Buffers;
+    for (bool no_cache : {false, true}) {
+      lv_image_decoder_dsc_t dsc = {};
+      dsc.src = &img;
+      dsc.src_type = LV_IMAGE_SRC_VARIABLE;
+      dsc.header = header;
+      dsc.args.no_cache = no_cache;
+      bool opened = Open_cb(&Decoder, &dsc) == LV_RESULT_OK;
+      Check(opened && dsc.decoded && !memcmp(dsc.decoded->data, levels.data(), w * h), "decoded", name);
+      if (opened)
+        Close_cb(&Decoder, &dsc);
+    }
+    Check((int)Cached.size() == cached + 1 && Buffers == buffers + 1, "cached once, one-shot draw freed", name);
+
+    data[0] ^= 0x40;                                            // A second colour, visible: a picture
+    data[3] = 0x80;
+    Check(!Icon_Image_Is(&img) && Info_cb(&Decoder, &img, &header) != LV_RESULT_OK, "pictures left alone", name);
+    data[0] ^= 0x40;
+    data[3] = 0;
+    img.header.flags = LV_IMAGE_FLAGS_COMPRESSED;
+    Check(!Icon_Image_Is(&img), "compressed left alone", name);
+    img.header.flags = 0;
+    img.data_size--;
+    Check(!Icon_Image_Is(&img), "short data refused", name);
+  }
+}
+
+/********************************************************** Timing **********************************************************/
+static double Best_us(void (*Blend)(_lv_draw_sw_blend_fill_dsc_t *), _lv_draw_sw_blend_fill_dsc_t *Dsc,
+                      const std::vector<uint16_t> &Bg)
+{
+  double best = 1e9;
+  for (int r = 0; r < BENCH_REPEATS; r++) {
+    memcpy(Dsc->dest_buf, Bg.data(), Bg.size() * 2);
+    auto t0 = std::chrono::steady_clock::now();
+    Blend(Dsc);
+    auto t1 = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::micro>(t1 - t0).count());
+  }
+  return best;
+}
+
+static void Kernel(_lv_draw_sw_blend_fill_dsc_t *dsc)
+{
+  if (dsc->opa >= LV_OPA_MAX)
+    Icon_Blend_Mask_To_RGB565(dsc);
+  else
+    Icon_Blend_Mask_Opa_To_RGB565(dsc);
+}
+
+static void Time_mask(const char *Name, const uint8_t *A8, uint32_t W, uint32_t H)
+{
+  std::vector<uint16_t> bg(W * H, lv_color_to_u16(lv_color_hex(0x5D5D5D))), dest(W * H);
+  _lv_draw_sw_blend_fill_dsc_t dsc = {};
+  dsc.dest_buf = dest.data();
+  dsc.dest_w = W;
+  dsc.dest_h = H;
+  dsc.dest_stride = W * 2;
+  dsc.mask_buf = A8;
+  dsc.mask_stride = W;
+  dsc.color = lv_color_hex(ICON_IMAGE_UI_COLOR);
+  for (lv_opa_t opa : {LV_OPA_COVER, LV_OPA_50}) {
+    dsc.opa = opa;
+    double lvgl = Best_us(Generic_blend_color_to_rgb565, &dsc, bg), kernel = Best_us(Kernel, &dsc, bg);
+    printf("%-10s %3lux%-3lu opa %3u  LVGL %8.2f us  kernel %8.2f us  %5.2fx\n", Name, (unsigned long)W,
+           (unsigned long)H, opa, lvgl, kernel, lvgl / kernel);
+  }
+}
+
+// A screenful of 16-pixel text: glyph-sized blobs of coverage on rows with gaps between words and lines
+static std::vector<uint8_t> Text_mask(void)
+{
+  std::vector<uint8_t> m(BENCH_TEXT_W * BENCH_TEXT_H, 0);
+  for (uint32_t y = 0; y < BENCH_TEXT_H; y++) {
+    if (y % 20 >= 16)
+      continue;
+    for (uint32_t x = 0; x < BENCH_TEXT_W; x++) {
+      uint32_t col = x % 10;
+      if (x % 70 >= 60 || col >= 8)
+        continue;
+      bool edge = col == 0 || col == 7 || y % 20 == 0 || y % 20 == 15;
+      m[y * BENCH_TEXT_W + x] = edge ? (uint8_t)(64 + Rng() % 128) : (x / 10 + y / 20) % 3 ? 255 : 0;
+    }
+  }
+  return m;
+}
+
+int main(int argc, char **argv)
+{
+  Icon_Image_Init();
+  Check_kernels();
+  Check_indexed();
+
+  struct {
+    const char           *Name;
+    const lv_image_dsc_t *Exported;                             // RGB565A8, as SquareLine wrote it
+    const lv_image_dsc_t *Tool;                                 // As tools/image_compress.py --icon left it
+  } icons[] = {
+    {"home", &Raw_home, &ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png},
+    {"settings", &Raw_settings, &ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png},
+  };
+  std::vector<std::vector<uint8_t>> masks;
+  for (auto &i : icons) {
+    uint32_t n = i.Exported->header.w * i.Exported->header.h;
+    std::vector<uint8_t> a8(n);
+    Check(i.Tool->header.cf == LV_COLOR_FORMAT_A8 && Compressed_Image_Size(i.Tool) == n &&
+          Compressed_Image_Unpack(i.Tool, a8.data(), n) == ESP_OK &&
+          !memcmp(a8.data(), i.Exported->data + n * 2, n), "src/ui icon is the exported alpha plane", i.Name);
+    masks.push_back(a8);
+  }
+  for (auto *buf : Cached) {                                    // What lv_image_cache does on eviction
+    lv_image_cache_data_t entry = {};
+    entry.decoded = buf;
+    Free_cb(&entry, NULL);
+  }
+  Check(Buffers == 0, "every buffer freed", "cache");
+  Icon_Image_Set_Color(NULL, lv_color_hex(ICON_IMAGE_UI_COLOR));
+  Check(Recolor.red == 0xE3 && Recolor_opa == LV_OPA_COVER, "recolour set", "Icon_Image_Set_Color");
+
+  printf("%-10s %7s %8s %8s %6s %6s\n", "icon", "pixels", "RGB565A8", "ARGB8888", "A8", "I4");
+  for (size_t i = 0; i < masks.size(); i++) {
+    uint32_t w = icons[i].Exported->header.w, h = icons[i].Exported->header.h;
+    printf("%-10s %7lu %8lu %8lu %6lu %6lu   flash as compressed in src/ui: %lu\n", icons[i].Name,
+           (unsigned long)(w * h), (unsigned long)(w * h * 3), (unsigned long)(w * h * 4), (unsigned long)(w * h),
+           (unsigned long)((w + 1) / 2 * h + 64), (unsigned long)icons[i].Tool->data_size);
+  }
+  for (size_t i = 0; i < masks.size(); i++)
+    Time_mask(icons[i].Name, masks[i].data(), icons[i].Exported->header.w, icons[i].Exported->header.h);
+  std::vector<uint8_t> text = Text_mask();
+  Time_mask("text", text.data(), BENCH_TEXT_W, BENCH_TEXT_H);
+
+  Sim_Time_Follow_Host(true);
+  const lv_image_dsc_t *const tool[] = {icons[0].Tool, icons[1].Tool};
+  const char *const names[] = {icons[0].Name, icons[1].Name};
+  Icon_Image_Bench(tool, names, 2);
+  Sim_Time_Follow_Host(false);
+  Icon_Image_Report_t r;
+  Check(Icon_Image_Measure(tool[0], &r) == ESP_OK, "measured, kernels agree with LVGL's blend", "home");
+  Icon_Image_Print_Stats();
+  printf("%s\n", Ok ? "ok" : "FAILED");
+  return Ok ? 0 : 1;
+}
@@ -0,0 +1,8 @@
+// LVGL's RGB565 blend without include/Icon_Blend.h, under other names, for sim/bench/icon_bench.cpp to check the
+// kernels against and time them by. The bench builds lv_draw_sw_blend_to_rgb565.c itself with them hooked in.
+#undef LV_USE_DRAW_SW_ASM
+#define LV_USE_DRAW_SW_ASM LV_DRAW_SW_ASM_NONE
+
+#define lv_draw_sw_blend_color_to_rgb565 Generic_blend_color_to_rgb565
+#define lv_draw_sw_blend_image_to_rgb565 Generic_blend_image_to_rgb565
+#include "src/draw/sw/blend/lv_draw_sw_blend_to_rgb565.c"
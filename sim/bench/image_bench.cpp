@@ -0,0 +1,409 @@
+// Host bench for the compressed image decoder (src/Compressed_Image.cpp) and what tools/image_compress.py writes.
+//
+// Images: the UI's icons as src/ui has them, compressed by the tool, with the uncompressed copies the tool keeps
+// (sim/bench/image_bench_ui.c) to check them against, their alpha plane for icons the tool made A8; and a 320x240 RGB565A8 panel drawn like a settings screen,
+// larger than COMPRESSED_IMAGE_CACHE_MAX. Each is compressed here as well, in LVGL's RLE and as an LZ4 block. Then:
+//   - checks that every image unpacks to its pixels, and that RLE images read row by row give the same rows in
+//     order, after a jump back and in random order;
+//   - runs the decoder's callbacks the way lv_draw_image and lv_image_cache do: small images are unpacked once and
+//     cached, large RLE ones and no_cache opens go line by line over a clipped area, large LZ4 ones are unpacked for
+//     the draw and freed after it;
+//   - checks that damaged streams are refused;
+//   - prints flash saved against decode time per image. Times are the host's, for comparison between the methods;
+//     reading the stored bytes from flash is modelled at the 40 bytes/us of quad SPI at 80 MHz with a cold cache.
+//     Compressed_Image_Bench() prints the measured numbers on the board.
+//
+// Build from the repository root:
+//   mkdir -p sim/build
+//   g++ -std=gnu++17 -O2 -Wno-format -Isim -Isim/include -Isrc -Isrc/ui -Ilib/lvgl -Ilib/lvgl/src
+//       -DLV_CONF_INCLUDE_SIMPLE sim/bench/image_bench.cpp src/Compressed_Image.cpp
+//       sim/Sim_Runtime.cpp -x c sim/bench/image_bench_ui.c -x c lib/lvgl/src/libs/rle/lv_rle.c
+//       -x c lib/lvgl/src/libs/lz4/lz4.c -x none -o sim/build/image_bench
+// (one command line)
+// Run:
+//   sim/build/image_bench
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "lvgl.h"
+#include "ui.h"
+#include "src/libs/lz4/lz4.h"
+#include "Compressed_Image.h"
+#include "Sim_Time.h"
+
+#define BENCH_FLASH_BYTES_PER_US 40.0                           // Quad SPI at 80 MHz, cache misses
+#define BENCH_PANEL_W            320
+#define BENCH_PANEL_H            240
+
+extern "C" const lv_image_dsc_t Raw_home, Raw_settings;
+
+/********************************************************** LVGL stand-ins **********************************************************/
+// The decoder's callbacks, called here as lv_image_decoder_open() and the draw would
+static lv_image_decoder_t        Decoder;
+static lv_image_decoder_info_f_t Info_cb;
+static lv_image_decoder_open_f_t Open_cb;
+static lv_image_decoder_get_area_cb_t Area_cb;
+static lv_image_decoder_close_f_t Close_cb;
+static lv_cache_free_cb_t        Free_cb;
+static std::vector<lv_draw_buf_t *> Cached;
+static int Buffers = 0;                                         // Draw buffers alive
+static int Releases = 0;
+
+lv_image_decoder_t *lv_image_decoder_create(void) { return &Decoder; }
+void lv_image_decoder_set_info_cb(lv_image_decoder_t *d, lv_image_decoder_info_f_t cb) { Info_cb = cb; }
+void lv_image_decoder_set_open_cb(lv_image_decoder_t *d, lv_image_decoder_open_f_t cb) { Open_cb = cb; }
+void lv_image_decoder_set_get_area_cb(lv_image_decoder_t *d, lv_image_decoder_get_area_cb_t cb) { Area_cb = cb; }
+void lv_image_decoder_set_close_cb(lv_image_decoder_t *d, lv_image_decoder_close_f_t cb) { Close_cb = cb; }
+void lv_image_decoder_set_cache_free_cb(lv_image_decoder_t *d, lv_cache_free_cb_t cb) { Free_cb = cb; }
+lv_draw_buf_t *lv_image_decoder_post_process(lv_image_decoder_dsc_t *dsc, lv_draw_buf_t *decoded) { return decoded; }
+lv_image_src_t lv_image_src_get_type(const void *src) { return LV_IMAGE_SRC_VARIABLE; }
+uint8_t lv_color_format_get_bpp(lv_color_format_t cf) { return LV_COLOR_FORMAT_GET_BPP(cf); }
+void *lv_memcpy(void *dst, const void *src, size_t len) { return memcpy(dst, src, len); }
+void *lv_memmove(void *dst, const void *src, size_t len) { return memmove(dst, src, len); }
+void lv_memset(void *dst, uint8_t v, size_t len) { memset(dst, v, len); }
+
+lv_draw_buf_t *lv_draw_buf_create(uint32_t w, uint32_t h, lv_color_format_t cf, uint32_t stride)
+{
+  lv_draw_buf_t *buf = (lv_draw_buf_t *)calloc(1, sizeof(lv_draw_buf_t));
+  buf->header.magic = LV_IMAGE_HEADER_MAGIC;
+  buf->header.cf = cf;
+  buf->header.w = w;
+  buf->header.h = h;
+  buf->header.stride = stride;
+  buf->data_size = stride * h + (cf == LV_COLOR_FORMAT_RGB565A8 ? stride / 2 * h : 0);
+  buf->unaligned_data = malloc(buf->data_size);
+  buf->data = (uint8_t *)buf->unaligned_data;
+  Buffers++;
+  return buf;
+}
+
+void lv_draw_buf_destroy(lv_draw_buf_t *buf)
+{
+  if (buf == NULL)
+    return;
+  free(buf->unaligned_data);
+  free(buf);
+  Buffers--;
+}
+
+lv_cache_entry_t *lv_image_decoder_add_to_cache(lv_image_decoder_t *decoder, lv_image_cache_data_t *search_key,
+                                                const lv_draw_buf_t *decoded, void *user_data)
+{
+  Cached.push_back((lv_draw_buf_t *)decoded);
+  return (lv_cache_entry_t *)decoded;
+}
+
+void lv_cache_release(lv_cache_t *cache, lv_cache_entry_t *entry, void *user_data) { Releases++; }
+
+/********************************************************** Images **********************************************************/
+typedef struct {
+  std::string          Name;
+  const lv_image_dsc_t *Raw;
+  lv_image_dsc_t        Image;
+  std::vector<uint8_t>  Data;
+} Bench_Image_t;
+
+// The alpha plane of an RGB565A8 image as an A8 one: what tools/image_compress.py --icon a8 keeps
+static const lv_image_dsc_t *Alpha_plane(const lv_image_dsc_t *Raw)
+{
+  static lv_image_dsc_t planes[4];
+  static int used = 0;
+  uint32_t n = Raw->header.w * Raw->header.h;
+  lv_image_dsc_t *a8 = &planes[used++ % 4];
+  *a8 = *Raw;
+  a8->header.cf = LV_COLOR_FORMAT_A8;
+  a8->header.stride = Raw->header.w;
+  a8->data = Raw->data + n * 2;
+  a8->data_size = n;
+  return a8;
+}
+
+static std::vector<uint8_t> Rle(const uint8_t *Src, uint32_t Size, uint32_t Block)
+{
+  // As tools/image_compress.py: repeats of 2 pixels and more (3 bytes when a pixel is one), a partial last pixel
+  // always copied
+  uint32_t blocks = (Size + Block - 1) / Block, last = Size % Block ? blocks - 1 : blocks;
+  std::vector<uint8_t> padded(Src, Src + Size), out;
+  padded.resize(blocks * Block, 0);
+  auto same = [&](uint32_t a, uint32_t b) { return !memcmp(&padded[a * Block], &padded[b * Block], Block); };
+  auto copy = [&](uint32_t from, uint32_t to) {
+    while (from < to) {
+      uint32_t n = std::min<uint32_t>(to - from, 127);
+      out.push_back(0x80 | n);
+      out.insert(out.end(), &padded[from * Block], &padded[(from + n) * Block]);
+      from += n;
+    }
+  };
+  uint32_t i = 0, start = 0;
+  while (i < blocks) {
+    uint32_t run = 1;
+    while (i + run < last && run < 127 && same(i, i + run))
+      run++;
+    if (i < last && run >= (Block == 1 ? 3u : 2u)) {
+      copy(start, i);
+      out.push_back(run);
+      out.insert(out.end(), &padded[i * Block], &padded[(i + 1) * Block]);
+      i += run;
+      start = i;
+    } else {
+      i++;
+    }
+  }
+  copy(start, blocks);
+  return out;
+}
+
+static void Compress(Bench_Image_t *b, const std::string &Name, const lv_image_dsc_t *Raw, uint8_t Method)
+{
+  b->Name = Name;
+  b->Raw = Raw;
+  uint32_t block = Raw->header.cf == LV_COLOR_FORMAT_RGB565A8 ? 2 : lv_color_format_get_bpp(
+                                                                      (lv_color_format_t)Raw->header.cf) / 8;
+  std::vector<uint8_t> packed;
+  if (Method == LV_IMAGE_COMPRESS_RLE) {
+    packed = Rle(Raw->data, Raw->data_size, block);
+  } else {
+    packed.resize(LZ4_compressBound(Raw->data_size));
+    packed.resize(LZ4_compress_default((const char *)Raw->data, (char *)packed.data(), Raw->data_size,
+                                       packed.size()));
+  }
+  uint32_t head[3] = {Method, (uint32_t)packed.size(), Raw->data_size};
+  b->Data.assign((uint8_t *)head, (uint8_t *)head + sizeof(head));
+  b->Data.insert(b->Data.end(), packed.begin(), packed.end());
+  b->Image = *Raw;
+  b->Image.header.flags = LV_IMAGE_FLAGS_COMPRESSED;
+  b->Image.header.stride = 0;
+  b->Image.data = b->Data.data();
+  b->Image.data_size = b->Data.size();
+}
+
+// A settings screen's panel: a rounded card with a border, rows of text-like strokes with soft edges, a toggle and
+// a slider, transparent around the card
+static lv_image_dsc_t Panel;
+static std::vector<uint8_t> Panel_data;
+
+static void Make_panel(void)
+{
+  const int w = BENCH_PANEL_W, h = BENCH_PANEL_H, r = 16;
+  Panel_data.assign(w * h * 3, 0);
+  uint16_t *px = (uint16_t *)Panel_data.data();
+  uint8_t *a = Panel_data.data() + w * h * 2;
+  std::mt19937 rng(7);
+  for (int y = 0; y < h; y++)
+    for (int x = 0; x < w; x++) {
+      int dx = std::max(0, std::max(r - x, x - (w - 1 - r))), dy = std::max(0, std::max(r - y, y - (h - 1 - r)));
+      int d2 = dx * dx + dy * dy;
+      if (d2 > r * r)
+        continue;
+      a[y * w + x] = d2 > (r - 1) * (r - 1) ? 0x80 : 0xFF;
+      px[y * w + x] = d2 > (r - 2) * (r - 2) ? 0x4A69 : 0x2104;
+    }
+  for (int row = 0; row < 6; row++) {                           // Labels
+    int y0 = 24 + row * 34, x = 20;
+    while (x < 200) {
+      int glyph = 5 + rng() % 6;
+      for (int gx = 0; gx < glyph - 1; gx++)
+        for (int gy = 0; gy < 14; gy++)
+          if ((rng() & 3) != 0)
+            px[(y0 + gy) * w + x + gx] = (rng() & 1) ? 0xE73C : 0x8C71;
+      x += glyph + ((rng() % 7) == 0 ? 6 : 0);
+    }
+    for (int y = y0 + 2; y < y0 + 14; y++)                      // Toggle
+      for (int x2 = 250; x2 < 290; x2++)
+        px[y * w + x2] = row & 1 ? 0x05FF : 0x632C;
+  }
+  for (int y = 222; y < 226; y++)                               // Slider
+    for (int x2 = 20; x2 < 300; x2++)
+      px[y * w + x2] = x2 < 180 ? 0x05FF : 0x632C;
+  Panel.header.magic = LV_IMAGE_HEADER_MAGIC;
+  Panel.header.cf = LV_COLOR_FORMAT_RGB565A8;
+  Panel.header.w = w;
+  Panel.header.h = h;
+  Panel.data = Panel_data.data();
+  Panel.data_size = Panel_data.size();
+}
+
+/********************************************************** Bench **********************************************************/
+static bool Ok = true;
+
+static void Check(bool Cond, const char *What, const std::string &Name)
+{
+  if (!Cond)
+    printf("FAILED: %s, %s\n", What, Name.c_str());
+  Ok &= Cond;
+}
+
+static const uint8_t *Raw_row(const lv_image_dsc_t *Raw, uint16_t y, std::vector<uint8_t> *Row)
+{
+  uint32_t w = Raw->header.w, bytes = w * lv_color_format_get_bpp((lv_color_format_t)Raw->header.cf) / 8;
+  Row->assign(Raw->data + y * bytes, Raw->data + (y + 1) * bytes);
+  if (Raw->header.cf == LV_COLOR_FORMAT_RGB565A8)
+    Row->insert(Row->end(), Raw->data + bytes * Raw->header.h + y * w, Raw->data + bytes * Raw->header.h + (y + 1) * w);
+  return Row->data();
+}
+
+static void Check_unpack(const Bench_Image_t *b)
+{
+  const lv_image_dsc_t *img = &b->Image;
+  Check(Compressed_Image_Is(img) && Compressed_Image_Size(img) == b->Raw->data_size, "recognised", b->Name);
+  std::vector<uint8_t> out(b->Raw->data_size + 1, 0xA5);
+  Check(Compressed_Image_Unpack(img, out.data(), out.size()) == ESP_OK &&
+        !memcmp(out.data(), b->Raw->data, b->Raw->data_size) && out.back() == 0xA5, "unpacks", b->Name);
+
+  Compressed_Image_Rows_t rows;
+  esp_err_t err = Compressed_Image_Rows_Open(&rows, img);
+  uint8_t method = *(const uint32_t *)img->data & 0x0F;
+  if (method != LV_IMAGE_COMPRESS_RLE) {
+    Check(err == ESP_ERR_NOT_SUPPORTED, "LZ4 has no rows", b->Name);
+    return;
+  }
+  std::vector<uint8_t> row(rows.Row_bytes + img->header.w), ref;
+  std::vector<uint16_t> order;
+  for (uint16_t y = 0; y < img->header.h; y++)                  // In order
+    order.push_back(y);
+  order.push_back(img->header.h / 2);                           // Back: restarts
+  order.push_back(img->header.h / 2 + 1);
+  std::mt19937 rng(11);
+  for (int i = 0; i < 40; i++)
+    order.push_back(rng() % img->header.h);
+  bool same = err == ESP_OK;
+  for (uint16_t y : order) {
+    if (!same)
+      break;
+    same = Compressed_Image_Row(&rows, y, row.data()) == ESP_OK && !memcmp(row.data(), Raw_row(b->Raw, y, &ref),
+                                                                            ref.size());
+  }
+  Check(same, "rows", b->Name);
+}
+
+// lv_draw_image's loop over a clipped area, rows compared as they come
+static bool Draw(const Bench_Image_t *b, bool No_cache, int32_t Y1, int32_t Y2, bool *Lines)
+{
+  lv_image_decoder_dsc_t dsc;
+  memset(&dsc, 0, sizeof(dsc));
+  dsc.decoder = &Decoder;
+  dsc.src = &b->Image;
+  dsc.src_type = LV_IMAGE_SRC_VARIABLE;
+  dsc.args.no_cache = No_cache;
+  if (Info_cb(&Decoder, dsc.src, &dsc.header) != LV_RESULT_OK || (dsc.header.flags & LV_IMAGE_FLAGS_COMPRESSED) ||
+      Open_cb(&Decoder, &dsc) != LV_RESULT_OK)
+    return false;
+  std::vector<uint8_t> ref;
+  bool ok = true;
+  *Lines = dsc.decoded == NULL;
+  if (*Lines) {
+    lv_area_t full = {0, Y1, b->Image.header.w - 1, Y2}, area = {LV_COORD_MIN, LV_COORD_MIN, LV_COORD_MIN, LV_COORD_MIN};
+    int32_t y = Y1;
+    while (Area_cb(&Decoder, &dsc, &full, &area) == LV_RESULT_OK) {
+      const lv_draw_buf_t *d = dsc.decoded;
+      ok &= area.y1 == y && area.x1 == 0 && area.x2 == b->Image.header.w - 1 && d->header.h == 1 &&
+            !memcmp(d->data, Raw_row(b->Raw, y, &ref), ref.size());
+      y++;
+    }
+    ok &= y == Y2 + 1;
+  } else {
+    ok = !memcmp(dsc.decoded->data, b->Raw->data, b->Raw->data_size);
+  }
+  Close_cb(&Decoder, &dsc);
+  return ok;
+}
+
+static void Check_decoder(const Bench_Image_t *b, uint8_t Method)
+{
+  bool large = b->Raw->data_size > COMPRESSED_IMAGE_CACHE_MAX, lines;
+  int cached = Cached.size(), releases = Releases, buffers = Buffers;
+  uint16_t h = b->Image.header.h;
+  Check(Draw(b, false, 0, h - 1, &lines), "drawn", b->Name);
+  Check(lines == (large && Method == LV_IMAGE_COMPRESS_RLE), "line by line when large and RLE", b->Name);
+  Check((int)Cached.size() == cached + !large && Releases == releases + !large, "cached when small", b->Name);
+  Check(Buffers == buffers + !large, "nothing kept but the cached image", b->Name);
+  Check(Draw(b, true, h / 3, h / 2, &lines), "one-shot draw of a clipped area", b->Name);
+  Check(lines == (Method == LV_IMAGE_COMPRESS_RLE), "no_cache goes line by line for RLE", b->Name);
+  Check(Buffers == buffers + !large, "one-shot draw frees everything", b->Name);
+}
+
+static void Check_damage(const Bench_Image_t *b)
+{
+  std::vector<uint8_t> data = b->Data, out(b->Raw->data_size);
+  lv_image_dsc_t img = b->Image;
+  img.data = data.data();
+  img.data_size = data.size() - 1;                              // Header and size disagree
+  Check(!Compressed_Image_Is(&img), "short data refused", b->Name);
+  uint32_t *head = (uint32_t *)data.data();
+  head[1] -= data.size() / 2;                                   // A consistent header over a cut stream
+  img.data_size = data.size() - data.size() / 2;
+  Check(Compressed_Image_Unpack(&img, out.data(), out.size()) == ESP_ERR_INVALID_CRC, "cut stream refused",
+        b->Name);
+  Compressed_Image_Rows_t rows;
+  if ((head[0] & 0x0F) == LV_IMAGE_COMPRESS_RLE && Compressed_Image_Rows_Open(&rows, &img) == ESP_OK) {
+    esp_err_t err = ESP_OK;
+    for (uint16_t y = 0; y < img.header.h && err == ESP_OK; y++)
+      err = Compressed_Image_Row(&rows, y, out.data());
+    Check(err == ESP_ERR_INVALID_CRC, "cut stream refused by rows", b->Name);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  Compressed_Image_Init();
+  Make_panel();
+  struct {
+    const char           *Name;
+    const lv_image_dsc_t *Raw;
+    const lv_image_dsc_t *Tool;                                 // As tools/image_compress.py left it, or NULL
+  } sources[] = {
+    {"home", &Raw_home, &ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png},
+    {"settings", &Raw_settings, &ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png},
+    {"panel", &Panel, NULL},
+  };
+  std::vector<Bench_Image_t> images;
+  for (auto &s : sources) {
+    for (uint8_t method : {LV_IMAGE_COMPRESS_RLE, LV_IMAGE_COMPRESS_LZ4}) {
+      Bench_Image_t b;
+      Compress(&b, std::string(s.Name) + (method == LV_IMAGE_COMPRESS_RLE ? " rle" : " lz4"), s.Raw, method);
+      images.push_back(b);
+    }
+    if (s.Tool) {
+      Bench_Image_t b;
+      b.Name = std::string(s.Name) + " (src/ui)";
+      b.Raw = s.Tool->header.cf == LV_COLOR_FORMAT_A8 && s.Raw->header.cf != LV_COLOR_FORMAT_A8 ? Alpha_plane(s.Raw)
+                                                                                                 : s.Raw;
+      b.Image = *s.Tool;
+      images.push_back(b);
+      Check(Compressed_Image_Is(s.Tool), "compressed by tools/image_compress.py", s.Name);
+    }
+  }
+  for (auto &b : images) {
+    if (!b.Data.empty())
+      b.Image.data = b.Data.data();
+    uint8_t method = *(const uint32_t *)b.Image.data & 0x0F;
+    Check_unpack(&b);
+    Check_decoder(&b, method);
+    if (!b.Data.empty())
+      Check_damage(&b);
+  }
+  for (auto *buf : Cached) {                                    // What lv_image_cache does on eviction
+    lv_image_cache_data_t entry = {};
+    entry.decoded = buf;
+    Free_cb(&entry, NULL);
+  }
+  Check(Buffers == 0, "every buffer freed", "cache");
+
+  printf("%-18s %-4s %7s %7s %7s %8s %8s %8s %9s %9s\n", "image", "", "raw", "flash", "saved", "unpack", "rows",
+         "copy", "flash raw", "flash now");
+  Sim_Time_Follow_Host(true);
+  for (auto &b : images) {
+    Compressed_Image_Report_t r;
+    Check(Compressed_Image_Measure(&b.Image, &r) == ESP_OK, "measured", b.Name);
+    printf("%-18s %-4s %7lu %7lu %7lu %6lu us %6lu us %6lu us %6.1f us %6.1f us\n", b.Name.c_str(),
+           r.Method == LV_IMAGE_COMPRESS_RLE ? "RLE" : "LZ4", r.Raw, r.Stored, r.Raw - r.Stored, r.Unpack_us,
+           r.Rows_us, r.Copy_us, r.Raw / BENCH_FLASH_BYTES_PER_US, r.Stored / BENCH_FLASH_BYTES_PER_US);
+  }
+  Sim_Time_Follow_Host(false);
+  Compressed_Image_Print_Stats();
+  printf("%s\n", Ok ? "ok" : "FAILED");
+  return Ok ? 0 : 1;
+}
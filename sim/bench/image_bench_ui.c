@@ -0,0 +1,19 @@
+// The UI's icons for sim/bench/image_bench.cpp and icon_bench.cpp: as tools/image_compress.py left them in src/ui,
+// then under other names as SquareLine exported them, from the #else branch the tool keeps in each file, to check the
+// first against.
+#include "ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png.c"
+#include "ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png.c"
+
+#undef LV_USE_RLE
+#define LV_USE_RLE 0
+#undef LV_USE_LZ4
+#define LV_USE_LZ4 0
+#undef LV_USE_DRAW_SW
+#define LV_USE_DRAW_SW 0                                        // Past the A8 branch of --icon images
+
+#define ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png          Raw_home
+#define ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data     Raw_home_data
+#define ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png      Raw_settings
+#define ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data Raw_settings_data
+#include "ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png.c"
+#include "ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png.c"
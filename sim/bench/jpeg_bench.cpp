@@ -0,0 +1,296 @@
+// Host bench for the JPEG decoder (src/JPEG_Decoder.cpp).
+//
+// Writes synthetic photos with the host's libjpeg: 480x640 camera-style snapshots with and without restart markers,
+// a 4:4:4 landscape one, odd sizes whose restart intervals do not line up with MCU rows, a grayscale one, a strip a
+// single MCU row high and a progressive one. Then:
+//   - checks that each decodes to the same pixels on one core and split between two, restart or pipelined as the
+//     photo allows, and that those pixels match libjpeg's own decode within TJpgDec's rounding;
+//   - checks that the progressive photo is refused;
+//   - times the 480x640 photos. The host has one thread here, so the task's share runs after the caller's and the
+//     two-core time is estimated as the longer of the two shares; card time is modelled with the constants of
+//     sim/bench/sdcache_bench.cpp and reported apart. JPEG_Decoder_Bench() prints the measured numbers on the board.
+//
+// Needs libjpeg (libjpeg-dev or libjpeg-turbo). Build from the repository root:
+//   mkdir -p sim/build
+//   g++ -std=gnu++17 -O2 -Wno-format -Isim -Isim/include -Isrc -Ilib/lvgl -Ilib/lvgl/src
+//       -DLV_CONF_INCLUDE_SIMPLE sim/bench/jpeg_bench.cpp src/JPEG_Decoder.cpp src/SD_Cache.cpp sim/Sim_Runtime.cpp
+//       -x c lib/lvgl/src/libs/tjpgd/tjpgd.c -x none -ljpeg -o sim/build/jpeg_bench
+// (one command line)
+// Run:
+//   sim/build/jpeg_bench [repeats]                  default: 5 timed decodes per photo, the fastest kept
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <random>
+#include <string>
+#include <vector>
+#include <jpeglib.h>
+#include "esp_heap_caps.h"
+#include "SD_Cache.h"
+#include "JPEG_Decoder.h"
+#include "Sim_Time.h"
+
+#define BENCH_CMD_US        200.0                               // One SDMMC read command
+#define BENCH_BYTES_PER_US  5.0                                 // 1-bit bus at 40 MHz
+#define BENCH_DIR           "sim/build/bench_jpeg"
+#define BENCH_MEAN_ERROR    3.0                                 // Mean and largest difference from libjpeg in 8-bit
+#define BENCH_MAX_ERROR     16                                  // levels; RGB565 alone accounts for 2 and 7
+
+static double Card_us = 0;
+
+extern "C" ssize_t pread(int fd, void *buf, size_t count, off_t offset)
+{
+  Card_us += BENCH_CMD_US + count / BENCH_BYTES_PER_US;        // Kept off the clock, which times the CPU here
+  return syscall(SYS_pread64, fd, buf, count, offset);
+}
+
+// The parts of LVGL the decoder calls; the bench drives it through JPEG_Decoder_Decode() only
+lv_image_decoder_t *lv_image_decoder_create(void) { static lv_image_decoder_t d; return &d; }
+void lv_image_decoder_set_info_cb(lv_image_decoder_t *d, lv_image_decoder_info_f_t cb) {}
+void lv_image_decoder_set_open_cb(lv_image_decoder_t *d, lv_image_decoder_open_f_t cb) {}
+void lv_image_decoder_set_close_cb(lv_image_decoder_t *d, lv_image_decoder_close_f_t cb) {}
+void lv_image_decoder_set_cache_free_cb(lv_image_decoder_t *d, lv_cache_free_cb_t cb) {}
+lv_result_t lv_image_decoder_open(lv_image_decoder_dsc_t *dsc, const void *src, const lv_image_decoder_args_t *args)
+{
+  return LV_RESULT_INVALID;
+}
+void lv_image_decoder_close(lv_image_decoder_dsc_t *dsc) {}
+lv_draw_buf_t *lv_image_decoder_post_process(lv_image_decoder_dsc_t *dsc, lv_draw_buf_t *decoded) { return decoded; }
+lv_result_t lv_draw_buf_init(lv_draw_buf_t *buf, uint32_t w, uint32_t h, lv_color_format_t cf, uint32_t stride,
+                             void *data, uint32_t size)
+{
+  return LV_RESULT_INVALID;
+}
+void lv_draw_buf_destroy(lv_draw_buf_t *buf) {}
+void lv_image_cache_drop(const void *src) {}
+lv_cache_entry_t *lv_image_decoder_add_to_cache(lv_image_decoder_t *decoder, lv_image_cache_data_t *search_key,
+                                                const lv_draw_buf_t *decoded, void *user_data)
+{
+  return NULL;
+}
+void lv_cache_release(lv_cache_t *cache, lv_cache_entry_t *entry, void *user_data) {}
+lv_image_src_t lv_image_src_get_type(const void *src) { return LV_IMAGE_SRC_FILE; }
+const char *lv_fs_get_ext(const char *fn) { return ""; }
+void lv_free(void *p) { free(p); }
+
+/********************************************************** Photos **********************************************************/
+typedef struct {
+  const char *Name;
+  uint16_t    Width;
+  uint16_t    Height;
+  int         Components;                                       // 3 or 1
+  bool        Subsample;                                        // 4:2:0, else 4:4:4
+  int         Restart_rows;                                     // libjpeg's restart_in_rows
+  int         Restart_mcus;                                     // Or restart_interval
+  bool        Progressive;
+  uint8_t     Split;                                            // Expected two-core split
+  bool        Timed;
+} Bench_Photo_t;
+
+static const Bench_Photo_t Photos[] = {
+  {"snapshot.jpg",      480, 640, 3, true,  0, 0,  false, JPEG_DECODER_PIPELINE, true},
+  {"snapshot_rst.jpg",  480, 640, 3, true,  1, 0,  false, JPEG_DECODER_RESTART,  true},
+  {"landscape_444.jpg", 640, 480, 3, false, 0, 0,  false, JPEG_DECODER_PIPELINE, true},
+  {"odd_rst7.jpg",      333, 251, 3, true,  0, 7,  false, JPEG_DECODER_RESTART,  false},
+  {"odd.jpg",           333, 251, 3, true,  0, 0,  false, JPEG_DECODER_PIPELINE, false},
+  {"gray.jpeg",         200, 120, 1, false, 0, 0,  false, JPEG_DECODER_PIPELINE, false},
+  {"strip.jpg",         96,  16,  3, true,  0, 0,  false, JPEG_DECODER_SINGLE,   false},
+  {"progressive.jpg",   480, 640, 3, true,  0, 0,  true,  0,                     false},
+};
+
+static std::mt19937 Rng(5);
+
+// Gradients, texture, a few hard edges and sensor noise: compresses like a camera snapshot, ~1.5 bits per pixel
+static std::vector<uint8_t> Scene(uint16_t w, uint16_t h, int comps)
+{
+  std::vector<uint8_t> px((size_t)w * h * comps);
+  std::normal_distribution<float> noise(0, 4);
+  for (uint32_t y = 0; y < h; y++) {
+    for (uint32_t x = 0; x < w; x++) {
+      float u = (float)x / w, v = (float)y / h;
+      bool box = (x / 64 + y / 80) % 5 == 0;
+      float tex = 24 * sinf(x * 0.21f) * sinf(y * 0.17f) + 16 * sinf((x + y) * 0.05f);
+      float rgb[3] = {60 + 140 * v + tex, 90 + 100 * u + tex * 0.6f, 170 - 120 * v + (box ? 60 : 0)};
+      for (int c = 0; c < comps; c++) {
+        float val = (comps == 1 ? (rgb[0] + rgb[1] + rgb[2]) / 3 : rgb[c]) + noise(Rng);
+        px[((size_t)y * w + x) * comps + c] = (uint8_t)(val < 0 ? 0 : val > 255 ? 255 : val);
+      }
+    }
+  }
+  return px;
+}
+
+static bool Write_Jpeg(const std::string &Path, const Bench_Photo_t *p, const std::vector<uint8_t> &Px)
+{
+  FILE *f = fopen(Path.c_str(), "wb");
+  if (f == NULL)
+    return false;
+  jpeg_compress_struct c;
+  jpeg_error_mgr err;
+  c.err = jpeg_std_error(&err);
+  jpeg_create_compress(&c);
+  jpeg_stdio_dest(&c, f);
+  c.image_width = p->Width;
+  c.image_height = p->Height;
+  c.input_components = p->Components;
+  c.in_color_space = p->Components == 3 ? JCS_RGB : JCS_GRAYSCALE;
+  jpeg_set_defaults(&c);
+  jpeg_set_quality(&c, 85, TRUE);
+  if (p->Components == 3 && !p->Subsample)
+    c.comp_info[0].h_samp_factor = c.comp_info[0].v_samp_factor = 1;
+  c.restart_in_rows = p->Restart_rows;
+  c.restart_interval = p->Restart_mcus;
+  if (p->Progressive)
+    jpeg_simple_progression(&c);
+  jpeg_start_compress(&c, TRUE);
+  while (c.next_scanline < c.image_height) {
+    JSAMPROW row = (JSAMPROW)&Px[(size_t)c.next_scanline * p->Width * p->Components];
+    jpeg_write_scanlines(&c, &row, 1);
+  }
+  jpeg_finish_compress(&c);
+  jpeg_destroy_compress(&c);
+  fclose(f);
+  return true;
+}
+
+// libjpeg's decode as RGB, chroma replicated like TJpgDec rather than interpolated
+static std::vector<uint8_t> Reference(const std::string &Path)
+{
+  FILE *f = fopen(Path.c_str(), "rb");
+  jpeg_decompress_struct d;
+  jpeg_error_mgr err;
+  d.err = jpeg_std_error(&err);
+  jpeg_create_decompress(&d);
+  jpeg_stdio_src(&d, f);
+  jpeg_read_header(&d, TRUE);
+  d.out_color_space = JCS_RGB;
+  d.do_fancy_upsampling = FALSE;
+  jpeg_start_decompress(&d);
+  std::vector<uint8_t> px((size_t)d.output_width * d.output_height * 3);
+  while (d.output_scanline < d.output_height) {
+    JSAMPROW row = &px[(size_t)d.output_scanline * d.output_width * 3];
+    jpeg_read_scanlines(&d, &row, 1);
+  }
+  jpeg_finish_decompress(&d);
+  jpeg_destroy_decompress(&d);
+  fclose(f);
+  return px;
+}
+
+// Mean and largest channel difference, in 8-bit levels, between an RGB565 decode and an RGB reference
+static void Compare(const uint16_t *Px, const std::vector<uint8_t> &Ref, uint32_t n, double *Mean, int *Max)
+{
+  double sum = 0;
+  *Max = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    int rgb[3] = {(Px[i] >> 11) << 3 | Px[i] >> 13, (Px[i] >> 5 & 0x3F) << 2 | (Px[i] >> 9 & 3),
+                  (Px[i] & 0x1F) << 3 | (Px[i] >> 2 & 7)};
+    for (int c = 0; c < 3; c++) {
+      int e = abs(rgb[c] - Ref[i * 3 + c]);
+      sum += e;
+      *Max = e > *Max ? e : *Max;
+    }
+  }
+  *Mean = sum / (n * 3.0);
+}
+
+/********************************************************** Bench **********************************************************/
+static bool Ok = true;
+
+static void Check(bool Cond, const char *What, const char *Name)
+{
+  if (!Cond)
+    printf("FAILED: %s: %s\n", Name, What);
+  Ok &= Cond;
+}
+
+static const char *Split_Name(uint8_t Split)
+{
+  static const char *Names[] = {"single", "restart", "pipeline"};
+  return Split <= JPEG_DECODER_PIPELINE ? Names[Split] : "?";
+}
+
+// Fastest of Repeats decodes, each with the card's blocks dropped; the card time of the model apart
+static void Time(const std::string &Path, bool Two_cores, int Repeats, JPEG_Decoder_Image_t *Best, double *Card)
+{
+  Best->Decode_us = UINT32_MAX;
+  for (int i = 0; i < Repeats; i++) {
+    JPEG_Decoder_Image_t image;
+    SD_Cache_Drop();
+    Card_us = 0;
+    Sim_Time_Follow_Host(true);
+    JPEG_Decoder_Decode(Path.c_str(), Two_cores, &image);
+    Sim_Time_Follow_Host(false);
+    heap_caps_free(image.Pixels);
+    if (image.Decode_us < Best->Decode_us) {
+      *Best = image;
+      *Card = Card_us;
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  int repeats = argc > 1 ? atoi(argv[1]) : 5;
+  mkdir("sim/build", 0755);
+  mkdir(BENCH_DIR, 0755);
+  if (JPEG_Decoder_Init() != ESP_OK)
+    return 1;
+
+  for (const Bench_Photo_t &p : Photos) {
+    std::string path = std::string(BENCH_DIR "/") + p.Name;
+    if (!Write_Jpeg(path, &p, Scene(p.Width, p.Height, p.Components))) {
+      printf("cannot write %s\n", path.c_str());
+      return 1;
+    }
+    struct stat st;
+    stat(path.c_str(), &st);
+    JPEG_Decoder_Image_t one, two;
+    esp_err_t err = JPEG_Decoder_Decode(path.c_str(), false, &one);
+    if (p.Progressive) {
+      Check(err == ESP_ERR_NOT_SUPPORTED, "progressive refused", p.Name);
+      printf("%-18s %4ux%-4u %6ld bytes  refused: %s\n", p.Name, p.Width, p.Height, (long)st.st_size,
+             esp_err_to_name(err));
+      continue;
+    }
+    Check(err == ESP_OK && one.Width == p.Width && one.Height == p.Height && one.Split == JPEG_DECODER_SINGLE,
+          "one-core decode", p.Name);
+    if (err != ESP_OK)
+      continue;
+    err = JPEG_Decoder_Decode(path.c_str(), true, &two);
+    uint32_t n = (uint32_t)p.Width * p.Height;
+    Check(err == ESP_OK && two.Split == p.Split, "two-core split", p.Name);
+    Check(err == ESP_OK && memcmp(one.Pixels, two.Pixels, n * 2) == 0, "same pixels on one and two cores", p.Name);
+    double mean;
+    int max;
+    Compare(one.Pixels, Reference(path), n, &mean, &max);
+    Check(mean < BENCH_MEAN_ERROR && max <= BENCH_MAX_ERROR, "close to libjpeg", p.Name);
+    printf("%-18s %4ux%-4u %6ld bytes  two cores: %-8s  against libjpeg: mean %.2f, max %d levels\n", p.Name, p.Width,
+           p.Height, (long)st.st_size, err == ESP_OK ? Split_Name(two.Split) : "failed", mean, max);
+    heap_caps_free(one.Pixels);
+    heap_caps_free(two.Pixels);
+  }
+
+  printf("\nHost CPU time, fastest of %d; two cores estimated as the longer share\n", repeats);
+  for (const Bench_Photo_t &p : Photos) {
+    if (!p.Timed)
+      continue;
+    std::string path = std::string(BENCH_DIR "/") + p.Name;
+    JPEG_Decoder_Image_t one, two;
+    double card_one, card_two;
+    Time(path, false, repeats, &one, &card_one);
+    Time(path, true, repeats, &two, &card_two);
+    uint32_t est = two.Caller_us > two.Worker_us ? two.Caller_us : two.Worker_us;
+    printf("%-18s one core %6.2f ms  two cores %6.2f ms (caller %.2f, task %.2f, %-8s) x%.2f  card %.1f ms\n", p.Name,
+           one.Decode_us / 1000.0, est / 1000.0, two.Caller_us / 1000.0, two.Worker_us / 1000.0,
+           Split_Name(two.Split), (double)one.Decode_us / est, card_two / 1000);
+    Check(est < one.Decode_us, "two cores faster", p.Name);
+  }
+  JPEG_Decoder_Print_Stats();
+  printf("%s\n", Ok ? "ok" : "FAILED");
+  return Ok ? 0 : 1;
+}
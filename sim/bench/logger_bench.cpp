@@ -0,0 +1,170 @@
+// Host bench for the data logger's block format (src/Data_Logger.cpp).
+//
+// Packs a synthetic capture the way the pack task does: IMU at the FIFO rate, battery and RTC once a second, a LOSS
+// chunk now and then. It reports the packing cost per sample and the card bandwidth and space a capture needs, then
+// reads the file back and checks every block and sample. The file it leaves behind is valid input for
+// tools/imu_log_decode.py.
+//
+// Build from the repository root:
+//   mkdir -p sim/build
+//   g++ -std=gnu++17 -O2 -Wno-format -Isim -Isim/include -Isrc sim/bench/logger_bench.cpp src/Data_Logger.cpp
+//       src/IMU_Stream.cpp src/SD_Index.cpp sim/Sim_Runtime.cpp -o sim/build/logger_bench
+// (one command line)
+// Run:
+//   sim/build/logger_bench [minutes] [file]          defaults: 60 minutes, sim/build/cap_bench.bin
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "Data_Logger.h"
+#include "Gyro_QMI8658.h"
+
+#define BENCH_RATE_HZ   896.8f
+#define BENCH_LOSS_EVERY 600                                    // Seconds between injected LOSS chunks
+
+// The pack task asks the FIFO for its measured rate; the bench has no QMI8658
+void QMI8658_FIFO_Get_Stats(QMI8658_FIFO_Stats_t *stats)
+{
+  memset(stats, 0, sizeof(*stats));
+  stats->Odr_hz = BENCH_RATE_HZ;
+}
+
+// A capture keeps the device awake; the bench packs without starting one
+void Power_Manager_Hold(void) {}
+void Power_Manager_Release(void) {}
+
+static double Now_s(void)
+{
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static IMU_Sample_t Sample(uint64_t n)
+{
+  IMU_Sample_t s;
+  uint64_t t = (uint64_t)(n * 1e6 / BENCH_RATE_HZ);
+  s.Time_us = (uint32_t)(t + 123456789);                        // Wraps during long captures, like esp_timer's low bits
+  for (int a = 0; a < 3; a++) {
+    s.Acc[a] = (int16_t)(a == 2 ? 8192 : 0) + (int16_t)(200 * sinf(n * 0.07f + a));
+    s.Gyr[a] = (int16_t)(n * (a + 1));
+  }
+  return s;
+}
+
+static uint8_t         Block[LOGGER_BLOCK_SIZE];
+static Logger_Packer_t Packer;
+static uint32_t        Seq = 0;
+static FILE           *File;
+
+static void Bench_Flush(void)
+{
+  Logger_Pack_End(&Packer, Seq++);
+  fwrite(Block, LOGGER_BLOCK_SIZE, 1, File);
+  Logger_Pack_Begin(&Packer, Block);
+}
+
+static void Bench_Chunk(uint8_t type, const void *payload, uint16_t length)
+{
+  if (!Logger_Pack_Chunk(&Packer, type, payload, length)) {  // Same as the pack task: finish the block, retry in the next
+    Bench_Flush();
+    Logger_Pack_Chunk(&Packer, type, payload, length);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t minutes = argc > 1 ? (uint32_t)atoi(argv[1]) : 60;
+  const char *path = argc > 2 ? argv[2] : "sim/build/cap_bench.bin";
+  uint64_t samples = (uint64_t)(minutes * 60.0 * BENCH_RATE_HZ);
+  File = fopen(path, "wb");
+  if (File == NULL) {
+    printf("logger bench: cannot create %s\n", path);
+    return 1;
+  }
+
+  Logger_Pack_Begin(&Packer, Block);
+  Logger_Info_t info = {};
+  info.Version = LOGGER_VERSION;
+  info.Time_us = 123456789;
+  info.Imu_hz = BENCH_RATE_HZ;
+  info.Acc_scale = 4.0f / 32768;
+  info.Gyr_scale = 64.0f / 32768;
+  info.Rtc = {2026, 10, 19, 12, 0, 0, 0};
+  Bench_Chunk(LOGGER_CHUNK_INFO, &info, sizeof(info));
+
+  uint32_t second = 0;
+  double start = Now_s();
+  for (uint64_t n = 0; n < samples; n++) {
+    IMU_Sample_t s = Sample(n);
+    if ((uint32_t)(n / BENCH_RATE_HZ) != second) {              // Once a second, like Driver_Loop
+      second = (uint32_t)(n / BENCH_RATE_HZ);
+      Logger_Battery_t bat = {s.Time_us, (uint16_t)(4100 - second / 10), 0};
+      Logger_Rtc_t rtc = {s.Time_us, {2026, 10, 19, (uint8_t)(12 + second / 3600), (uint8_t)(second / 60 % 60),
+                                      (uint8_t)(second % 60), 0}};
+      Logger_Loss_t loss = {s.Time_us, 7, 0, 0};
+      Bench_Chunk(LOGGER_CHUNK_BATTERY, &bat, sizeof(bat));
+      Bench_Chunk(LOGGER_CHUNK_RTC, &rtc, sizeof(rtc));
+      if (second % BENCH_LOSS_EVERY == 0)
+        Bench_Chunk(LOGGER_CHUNK_LOSS, &loss, sizeof(loss));
+    }
+    if (!Logger_Pack_Imu(&Packer, &s)) {
+      Bench_Flush();
+      Logger_Pack_Imu(&Packer, &s);
+    }
+  }
+  Bench_Flush();
+  double pack_s = Now_s() - start;                              // Includes the generator and the buffered fwrite
+  fclose(File);
+
+  // Read back: magic, sequence and CRC of every block, then every IMU sample against the generator
+  File = fopen(path, "rb");
+  uint64_t n = 0;
+  uint32_t blocks = 0, bad = 0, chunks[8] = {};
+  while (fread(Block, LOGGER_BLOCK_SIZE, 1, File) == 1) {
+    Logger_Block_Header_t h;
+    memcpy(&h, Block, sizeof(h));
+    if (h.Magic != LOGGER_MAGIC || h.Seq != blocks++ || h.Used < sizeof(h) || h.Used > LOGGER_BLOCK_SIZE ||
+        h.Crc != Logger_Crc32(0, Block + sizeof(h), h.Used - sizeof(h))) {
+      bad++;
+      continue;
+    }
+    for (uint32_t off = sizeof(h); off < h.Used;) {
+      Logger_Chunk_Header_t ch;
+      memcpy(&ch, Block + off, sizeof(ch));
+      off += sizeof(ch);
+      chunks[ch.Type & 7]++;
+      if (ch.Type == LOGGER_CHUNK_IMU) {
+        Logger_Imu_Header_t ih;
+        memcpy(&ih, Block + off, sizeof(ih));
+        uint32_t t = ih.Time_us;
+        for (uint16_t k = 0; k < ih.Count; k++, n++) {
+          Logger_Imu_Record_t r;
+          memcpy(&r, Block + off + sizeof(ih) + k * sizeof(r), sizeof(r));
+          t += r.Dt_us;
+          IMU_Sample_t s = Sample(n);
+          if (t != s.Time_us || memcmp(r.Acc, s.Acc, sizeof(r.Acc)) || memcmp(r.Gyr, s.Gyr, sizeof(r.Gyr)))
+            bad++;
+        }
+      }
+      off += ch.Length;
+    }
+  }
+  fclose(File);
+
+  double bytes = (double)blocks * LOGGER_BLOCK_SIZE, secs = samples / BENCH_RATE_HZ;
+  printf("logger bench: %u min at %.1f Hz, %llu samples in %u blocks of %d B\n", minutes, BENCH_RATE_HZ,
+         (unsigned long long)samples, blocks, LOGGER_BLOCK_SIZE);
+  printf("  packing     %.1f ns/sample on the host (%.3f%% of one core at the FIFO rate)\n", pack_s / samples * 1e9,
+         pack_s / secs * 100);
+  printf("  card        %.2f KB/s sustained, %.1f MB/hour, a block every %.2f s\n", bytes / secs / 1024,
+         bytes / secs * 3600 / 1048576, secs / blocks);
+  printf("  overhead    %.2f%% over the 14-byte samples alone\n",
+         (bytes / (samples * sizeof(Logger_Imu_Record_t)) - 1) * 100);
+  printf("  chunks      info %u, imu %u, battery %u, rtc %u, loss %u\n", chunks[LOGGER_CHUNK_INFO],
+         chunks[LOGGER_CHUNK_IMU], chunks[LOGGER_CHUNK_BATTERY], chunks[LOGGER_CHUNK_RTC], chunks[LOGGER_CHUNK_LOSS]);
+  printf("  read back   %llu samples, %u bad\n", (unsigned long long)n, bad);
+  return (bad || n != samples) ? 1 : 0;
+}
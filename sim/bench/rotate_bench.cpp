@@ -0,0 +1,122 @@
+// Host bench for the auto-rotation switch (src/Auto_Rotate.cpp), on the vendored LVGL with a 480x640 RGB565 display
+// set up as Lvgl_Init() does: two full-screen draw buffers, partial rendering, the flush a no-op, the C library's
+// malloc as lv_conf.h has it.
+//
+// A switch is lv_display_set_rotation(), which marks every layout of the display dirty, then the relayout of the
+// active screen and one full frame. For the SquareLine UI (src/ui) and for a denser screen of 120 buttons with labels
+// in a wrapping flex container, it times the relayout apart from the frame, and checks that the screen and a
+// centre-aligned object end up where the new orientation puts them.
+//
+// Build from the repository root (LVGL is compiled with it, about a minute):
+//   mkdir -p sim/build
+//   g++ -std=gnu++17 -O2 -w -Isrc/ui -Ilib/lvgl -DLV_CONF_SKIP -DLV_USE_STDLIB_MALLOC=LV_STDLIB_CLIB
+//       -DLV_USE_STDLIB_STRING=LV_STDLIB_CLIB sim/bench/rotate_bench.cpp $(find src/ui lib/lvgl/src -name '*.c'
+//       ! -path '*/thorvg/*' ! -path '*/drivers/*' ! -path '*/vg_lite*' ! -path '*/draw/nxp/*' ! -path
+//       '*/draw/renesas/*' ! -path '*/draw/sdl/*' ! -path '*/draw/opengles/*' ! -path '*/draw/dma2d/*'
+//       -printf '-x c %p ') -x none -o sim/build/rotate_bench
+// (one command line)
+// Run:
+//   sim/build/rotate_bench [switches]                default: 50 per screen, the fastest kept
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "lvgl.h"
+#include "ui.h"
+
+#define BENCH_WIDTH     480                                     // LVGL_WIDTH, LVGL_HEIGHT
+#define BENCH_HEIGHT    640
+#define BENCH_BUTTONS   120
+
+static int Failures = 0;
+
+static double Now_us(void)
+{
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e6 + t.tv_nsec * 1e-3;
+}
+
+static uint32_t Tick_ms(void)
+{
+  return (uint32_t)(Now_us() / 1000);
+}
+
+static void Flush_Cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+  lv_display_flush_ready(disp);
+}
+
+static lv_obj_t *Dense_Screen(void)
+{
+  lv_obj_t *scr = lv_obj_create(NULL);
+  lv_obj_t *box = lv_obj_create(scr);
+  lv_obj_set_size(box, lv_pct(100), lv_pct(100));
+  lv_obj_set_flex_flow(box, LV_FLEX_FLOW_ROW_WRAP);
+  for (int i = 0; i < BENCH_BUTTONS; i++) {
+    lv_obj_t *btn = lv_button_create(box);
+    lv_obj_set_size(btn, 90, 40);
+    lv_obj_t *label = lv_label_create(btn);
+    lv_label_set_text_fmt(label, "Item %d", i);
+    lv_obj_center(label);
+  }
+  return scr;
+}
+
+// Rotations 90 and 270 in turn, as Auto_Rotate allows them
+static void Bench_Screen(lv_display_t *disp, const char *Name, lv_obj_t *Screen, lv_obj_t *Centred, int Switches)
+{
+  lv_screen_load(Screen);
+  lv_refr_now(disp);
+  double best_layout = 1e9, best_total = 1e9;
+  for (int i = 0; i < Switches; i++) {
+    lv_display_rotation_t rotation = lv_display_get_rotation(disp) == LV_DISPLAY_ROTATION_90
+                                         ? LV_DISPLAY_ROTATION_270 : LV_DISPLAY_ROTATION_90;
+    double t0 = Now_us();
+    lv_display_set_rotation(disp, rotation);
+    lv_obj_update_layout(lv_display_get_screen_active(disp));   // As Rotate_Apply() does
+    double t1 = Now_us();
+    lv_refr_now(disp);
+    double t2 = Now_us();
+    if (t1 - t0 < best_layout)
+      best_layout = t1 - t0;
+    if (t2 - t0 < best_total)
+      best_total = t2 - t0;
+  }
+
+  // Landscape either way: the screen is 640x480 and the aligned object sits where its alignment puts it
+  lv_area_t a;
+  lv_obj_get_coords(Centred, &a);
+  int32_t w = lv_obj_get_width(Screen), h = lv_obj_get_height(Screen);
+  int32_t cx = (a.x1 + a.x2 + 1) / 2 - lv_obj_get_x_aligned(Centred);
+  int32_t cy = (a.y1 + a.y2 + 1) / 2 - lv_obj_get_y_aligned(Centred);
+  if (w != BENCH_HEIGHT || h != BENCH_WIDTH || cx != w / 2 || cy != h / 2) {
+    printf("FAILED: %s is %dx%d with its centre at %d,%d after the switch\n", Name, (int)w, (int)h, (int)cx, (int)cy);
+    Failures++;
+  }
+  printf("  %-10s relayout %8.1f us, with the frame %8.1f us (%4.1f%% relayout)\n", Name, best_layout, best_total,
+         100.0 * best_layout / best_total);
+}
+
+int main(int argc, char **argv)
+{
+  int switches = argc > 1 ? atoi(argv[1]) : 50;
+  lv_init();
+  lv_tick_set_cb(Tick_ms);
+  size_t size = BENCH_WIDTH * BENCH_HEIGHT * 2;
+  lv_display_t *disp = lv_display_create(BENCH_WIDTH, BENCH_HEIGHT);
+  lv_display_set_flush_cb(disp, Flush_Cb);
+  lv_display_set_buffers(disp, malloc(size), malloc(size), size, LV_DISPLAY_RENDER_MODE_PARTIAL);
+  lv_display_set_rotation(disp, LV_DISPLAY_ROTATION_90);
+  ui_init();
+
+  printf("rotate bench: %d switches per screen, host times\n", switches);
+  Bench_Screen(disp, "ui", ui_Screen1, ui_Spinner1, switches);
+  lv_obj_t *dense = Dense_Screen();
+  Bench_Screen(disp, "dense", dense, lv_obj_get_child(dense, 0), switches);
+  if (Failures) {
+    printf("%d checks failed\n", Failures);
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,207 @@
+// Host bench for the SD block cache (src/SD_Cache.cpp).
+//
+// Replays the reads that LVGL's loaders issue against files on the host:
+//   - lv_binfont_create(): small section reads, then every glyph twice, its header and usually its bitmap a byte at
+//     a time (read_bits());
+//   - the bin image decoder: the 12-byte header, then the whole pixel array in one read.
+// Each load runs through SD_Cache and through a model of the uncached path, where every call is a VFS read() and
+// FATFS touches the card whenever the call leaves its one-sector window. Large reads into PSRAM go to the card one
+// sector per command, because the SDMMC host cannot DMA there. Card time is modelled; the constants below are for
+// the board's 1-bit bus at 40 MHz. Read-ahead runs inline on the host, so its card time counts against the cached
+// path here, while on the device the read-ahead task does it alongside the loader.
+//
+// Build from the repository root:
+//   mkdir -p sim/build
+//   g++ -std=gnu++17 -O2 -Wno-format -Isim -Isim/include -Isrc sim/bench/sdcache_bench.cpp src/SD_Cache.cpp
+//       sim/Sim_Runtime.cpp -o sim/build/sdcache_bench
+// (one command line)
+// Run:
+//   sim/build/sdcache_bench [glyphs]                 default: 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <random>
+#include <vector>
+#include "SD_Cache.h"
+
+#define BENCH_CMD_US        200.0                               // One SDMMC read command, FATFS lookups included
+#define BENCH_BYTES_PER_US  5.0                                 // 1-bit bus at 40 MHz
+#define BENCH_CALL_US       12.0                                // read()/lseek() through VFS and FATFS, no card access
+#define BENCH_HIT_US        2.0                                 // SD_Cache_Read() call overhead
+#define BENCH_COPY_PER_US   40.0                                // Bytes/us of memcpy to or from PSRAM
+#define BENCH_SECTOR        512
+#define BENCH_IMAGE_W       480
+#define BENCH_IMAGE_H       480
+
+// The cache reads the card with pread(); the bench stands in for it to count and time the accesses
+static uint32_t Card_reads = 0;
+static double   Card_us = 0;
+
+extern "C" ssize_t pread(int fd, void *buf, size_t count, off_t offset)
+{
+  Card_reads++;
+  Card_us += BENCH_CMD_US + count / BENCH_BYTES_PER_US + count / BENCH_COPY_PER_US;   // Staging to the block
+  return syscall(SYS_pread64, fd, buf, count, offset);
+}
+
+typedef struct {
+  uint32_t Seek;                                                // UINT32_MAX: read from where the last one ended
+  uint32_t Length;
+} Bench_Op_t;
+
+static std::mt19937 Rng(7);
+
+static void Write_File(const char *path, uint32_t size)
+{
+  std::vector<uint8_t> data(size);
+  for (uint32_t i = 0; i < size; i++)
+    data[i] = (uint8_t)Rng();
+  FILE *f = fopen(path, "wb");
+  fwrite(data.data(), 1, size, f);
+  fclose(f);
+}
+
+// lv_binfont_loader.c: sections, loca, then load_glyph()'s two passes over the glyphs
+static std::vector<Bench_Op_t> Font_Ops(uint32_t glyphs, uint32_t *size)
+{
+  std::vector<Bench_Op_t> ops;
+  std::uniform_int_distribution<uint32_t> bitmap(40, 260);
+  uint32_t at = 0;
+  auto section = [&](uint32_t body) {
+    ops.push_back({at, 4});                                     // read_label(): length and tag
+    ops.push_back({UINT32_MAX, 4});
+    ops.push_back({UINT32_MAX, body});
+    at += 8 + body;
+  };
+  section(40);                                                  // head
+  section(16);                                                  // cmap count and subtable
+  ops.push_back({UINT32_MAX, glyphs * 2});                      // cmap ids
+  at += glyphs * 2;
+  section(4 + glyphs * 4);                                      // loca
+  uint32_t glyf = at + 8;
+  std::vector<uint32_t> offset(glyphs), length(glyphs);
+  uint32_t pos = 0;
+  for (uint32_t i = 0; i < glyphs; i++) {
+    offset[i] = pos;
+    length[i] = 5 + bitmap(Rng);
+    pos += length[i];
+  }
+  for (uint32_t i = 0; i < glyphs; i++) {                       // Pass 1: glyph headers, bit by bit
+    ops.push_back({glyf + offset[i], 1});
+    for (int b = 1; b < 5; b++)
+      ops.push_back({UINT32_MAX, 1});
+  }
+  for (uint32_t i = 0; i < glyphs; i++) {                       // Pass 2: header again, then the bitmap bytes
+    ops.push_back({glyf + offset[i], 1});
+    for (uint32_t b = 1; b < length[i]; b++)
+      ops.push_back({UINT32_MAX, 1});
+  }
+  *size = glyf + pos;
+  return ops;
+}
+
+static std::vector<Bench_Op_t> Image_Ops(uint32_t *size)
+{
+  uint32_t data = BENCH_IMAGE_W * BENCH_IMAGE_H * 2;
+  *size = 12 + data;
+  return {{0, 12}, {UINT32_MAX, data}};
+}
+
+// The uncached path: every call costs a VFS round trip; FATFS keeps one sector per file, reads under a sector go
+// through it, larger ones go to the destination sector by sector
+static double Model_Uncached(const std::vector<Bench_Op_t> &ops, uint32_t *reads)
+{
+  double us = 0;
+  uint32_t pos = 0, window = UINT32_MAX, n = 0;
+  for (const Bench_Op_t &op : ops) {
+    if (op.Seek != UINT32_MAX) {
+      pos = op.Seek;
+      us += BENCH_CALL_US;
+    }
+    us += BENCH_CALL_US;
+    if (op.Length < BENCH_SECTOR) {
+      for (uint32_t s = pos / BENCH_SECTOR; s <= (pos + op.Length - 1) / BENCH_SECTOR; s++) {
+        if (s != window) {
+          us += BENCH_CMD_US + BENCH_SECTOR / BENCH_BYTES_PER_US;
+          window = s;
+          n++;
+        }
+      }
+    } else {
+      uint32_t sectors = (op.Length + BENCH_SECTOR - 1) / BENCH_SECTOR;
+      us += sectors * (BENCH_CMD_US + BENCH_SECTOR / BENCH_BYTES_PER_US);
+      n += sectors;
+    }
+    pos += op.Length;
+  }
+  *reads = n;
+  return us;
+}
+
+static double Run_Cached(const char *path, const std::vector<Bench_Op_t> &ops, uint32_t *reads, bool *ok)
+{
+  std::vector<uint8_t> buf(BENCH_IMAGE_W * BENCH_IMAGE_H * 2), ref(buf.size());
+  int fd = open(path, O_RDONLY);
+  uint32_t before = Card_reads;
+  double card_before = Card_us, calls_us = 0;
+  SD_Cache_File_t *f = SD_Cache_Open(path);
+  *ok = f != NULL;
+  uint32_t pos = 0;
+  for (const Bench_Op_t &op : ops) {
+    if (op.Seek != UINT32_MAX) {
+      pos = op.Seek;
+      SD_Cache_Seek(f, pos);
+    }
+    calls_us += BENCH_HIT_US + op.Length / BENCH_COPY_PER_US;
+    bool read = SD_Cache_Read(f, buf.data(), op.Length) == (int32_t)op.Length;
+    if (!read || syscall(SYS_pread64, fd, ref.data(), op.Length, pos) != op.Length ||
+        memcmp(buf.data(), ref.data(), op.Length) != 0)
+      *ok = false;
+    pos += op.Length;
+  }
+  SD_Cache_Close(f);
+  close(fd);
+  *reads = Card_reads - before;
+  return calls_us + (Card_us - card_before);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t glyphs = argc > 1 ? atoi(argv[1]) : 600;
+  const char *font_path = "sim/build/bench_font.bin", *image_path = "sim/build/bench_image.bin";
+  uint32_t font_size, image_size;
+  std::vector<Bench_Op_t> font = Font_Ops(glyphs, &font_size), image = Image_Ops(&image_size);
+  Write_File(font_path, font_size);
+  Write_File(image_path, image_size);
+  if (SD_Cache_Init() != ESP_OK)
+    return 1;
+  printf("sd cache bench: %d x %d KB blocks, read-ahead %d; font %u glyphs %u KB, image %dx%d RGB565 %u KB\n",
+         SD_CACHE_BLOCKS, SD_CACHE_BLOCK_SIZE / 1024, SD_CACHE_READAHEAD, glyphs, font_size / 1024, BENCH_IMAGE_W,
+         BENCH_IMAGE_H, image_size / 1024);
+  printf("\n%-8s %8s %10s %12s %10s %12s %10s %12s %7s\n", "", "calls", "uncached", "card reads", "cold", "card reads",
+         "warm", "card reads", "cold x");
+
+  bool all_ok = true;
+  struct { const char *Name, *Path; std::vector<Bench_Op_t> *Ops; } loads[] = {
+    {"font", font_path, &font}, {"image", image_path, &image},
+  };
+  for (auto &l : loads) {
+    uint32_t raw_reads, cold_reads, warm_reads;
+    bool ok_cold, ok_warm;
+    double raw = Model_Uncached(*l.Ops, &raw_reads);
+    SD_Cache_Drop();
+    double cold = Run_Cached(l.Path, *l.Ops, &cold_reads, &ok_cold);
+    double warm = Run_Cached(l.Path, *l.Ops, &warm_reads, &ok_warm);
+    printf("%-8s %8zu %8.1f ms %12u %7.1f ms %12u %7.1f ms %12u %6.1fx%s\n", l.Name, l.Ops->size(), raw / 1000,
+           raw_reads, cold / 1000, cold_reads, warm / 1000, warm_reads, raw / cold,
+           ok_cold && ok_warm ? "" : "  DATA MISMATCH");
+    all_ok &= ok_cold && ok_warm;
+  }
+  printf("\n");
+  SD_Cache_Print_Stats();
+  printf("%s\n", all_ok ? "ok" : "FAILED");
+  return all_ok ? 0 : 1;
+}
@@ -0,0 +1,209 @@
+// Host run of the SD card benchmark (src/SD_Bench.cpp) over a file-backed stand-in for the card.
+//
+// The benchmark's POSIX calls reach host files, and each one advances the virtual clock by what the card model of
+// the other benches says it costs on the board:
+//   - reads of a sector or more go to the card in one command; smaller ones through FATFS's one-sector window;
+//   - writes likewise, each command followed by the card's programming time; fsync() writes the FAT and the
+//     directory entry;
+//   - open(), fopen() and stat() look the name up from the start of its directory, ~96 bytes per entry, and a
+//     listing reads the directory once.
+// The results are what that model predicts; the same benchmark on the device (SD_Bench_Start()) prints measured
+// numbers in the same JSON lines, to correct the model's constants. Nothing competes for the bus on the host, so the
+// loaded latency run repeats the idle one. Checks that the run reports no errors, that its numbers are consistent
+// (throughput grows with the block size, percentiles are ordered, a late directory entry opens slower than an early
+// one) and that it removes what it wrote.
+//
+// Build from the repository root:
+//   mkdir -p sim/build
+//   g++ -std=gnu++17 -O2 -Wno-format -Isim -Isim/include -Isrc -Ilib/lvgl -DLV_CONF_SKIP sim/bench/sdcard_bench.cpp
+//       src/SD_Bench.cpp sim/Sim_Runtime.cpp -o sim/build/sdcard_bench
+// (one command line)
+// Run:
+//   sim/build/sdcard_bench
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "lvgl.h"
+#include "SD_Bench.h"
+#include "Sim_Time.h"
+
+#define BENCH_CMD_US        200.0                               // One SDMMC command
+#define BENCH_BYTES_PER_US  5.0                                 // 1-bit bus at 40 MHz
+#define BENCH_CALL_US       12.0                                // A VFS and FATFS call, card time apart
+#define BENCH_BUSY_US       400.0                               // Card programming after a write command
+#define BENCH_SECTOR        512
+#define BENCH_DIR_ENTRY     96
+#define BENCH_DIR           "sim/build/sdbench"
+
+// lv_timer, the redraw and the power hold of SD_Bench_Start(), unused on the host
+void Power_Manager_Hold(void) {}
+void Power_Manager_Release(void) {}
+lv_timer_t *lv_timer_create(lv_timer_cb_t cb, uint32_t period, void *user_data) { return NULL; }
+void lv_timer_delete(lv_timer_t *timer) {}
+lv_display_t *lv_display_get_default(void) { return NULL; }
+lv_obj_t *lv_display_get_screen_active(lv_display_t *disp) { return NULL; }
+void lv_obj_invalidate(const lv_obj_t *obj) {}
+
+/********************************************************** Stand-in **********************************************************/
+static std::map<std::string, std::vector<std::string>> Dirs;   // Entries in creation order, for lookups
+static std::map<int, int64_t> Window;                           // Sector in each file's FATFS window
+
+static void Card(double Us)
+{
+  Sim_Time_Advance((int64_t)Us);
+}
+
+static double Sectors_Us(double Sectors)
+{
+  return Sectors * (BENCH_CMD_US + BENCH_SECTOR / BENCH_BYTES_PER_US);
+}
+
+static void Lookup(const char *Path, bool Create)
+{
+  std::string p(Path), dir = p.substr(0, p.rfind('/')), name = p.substr(p.rfind('/') + 1);
+  std::vector<std::string> &names = Dirs[dir];
+  auto it = std::find(names.begin(), names.end(), name);
+  size_t at = it - names.begin();
+  if (it == names.end() && Create)
+    names.push_back(name);
+  Card(BENCH_CALL_US + Sectors_Us(at * BENCH_DIR_ENTRY / BENCH_SECTOR + 1));
+}
+
+static void Transfer(int fd, size_t Count, off_t Pos, bool Write)
+{
+  double busy = Write ? BENCH_BUSY_US : 0;
+  Card(BENCH_CALL_US);
+  if (Count >= BENCH_SECTOR) {
+    Card(BENCH_CMD_US + busy + Count / BENCH_BYTES_PER_US);
+    Window[fd] = -1;
+    return;
+  }
+  for (int64_t s = Pos / BENCH_SECTOR; s <= (int64_t)(Pos + Count - 1) / BENCH_SECTOR; s++) {
+    if (Window.count(fd) && Window[fd] == s)
+      continue;
+    Card(Sectors_Us(1) + busy);                                 // A write flushes the window it leaves
+    Window[fd] = s;
+  }
+}
+
+extern "C" int open(const char *path, int flags, ...)
+{
+  va_list ap;
+  va_start(ap, flags);
+  int mode = (flags & O_CREAT) ? va_arg(ap, int) : 0;
+  va_end(ap);
+  Lookup(path, flags & O_CREAT);
+  int fd = (int)syscall(SYS_openat, AT_FDCWD, path, flags, mode);
+  Window.erase(fd);
+  return fd;
+}
+
+extern "C" FILE *fopen(const char *path, const char *mode)
+{
+  int fd = open(path, strchr(mode, 'w') ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY, 0644);
+  return fd < 0 ? NULL : fdopen(fd, mode);
+}
+
+extern "C" int stat(const char *path, struct stat *st)
+{
+  Lookup(path, false);
+  return fstatat(AT_FDCWD, path, st, 0);
+}
+
+// readdir() walks the directory's sectors in order; charged here, once per listing
+extern "C" DIR *opendir(const char *path)
+{
+  Card(BENCH_CALL_US + Sectors_Us(Dirs[path].size() * BENCH_DIR_ENTRY / BENCH_SECTOR + 1));
+  int fd = (int)syscall(SYS_openat, AT_FDCWD, path, O_RDONLY | O_DIRECTORY, 0);
+  return fd < 0 ? NULL : fdopendir(fd);
+}
+
+extern "C" ssize_t read(int fd, void *buf, size_t count)
+{
+  off_t pos = lseek(fd, 0, SEEK_CUR);
+  Transfer(fd, count, pos, false);
+  return syscall(SYS_read, fd, buf, count);
+}
+
+extern "C" ssize_t pread(int fd, void *buf, size_t count, off_t offset)
+{
+  Transfer(fd, count, offset, false);
+  return syscall(SYS_pread64, fd, buf, count, offset);
+}
+
+extern "C" ssize_t write(int fd, const void *buf, size_t count)
+{
+  if (fd <= 2)                                                  // The console
+    return syscall(SYS_write, fd, buf, count);
+  off_t pos = lseek(fd, 0, SEEK_CUR);
+  Transfer(fd, count, pos, true);
+  return syscall(SYS_write, fd, buf, count);
+}
+
+extern "C" int fsync(int fd)
+{
+  Card(BENCH_CALL_US + 2 * (Sectors_Us(1) + BENCH_BUSY_US));     // FAT sector and directory entry
+  return 0;
+}
+
+extern "C" int unlink(const char *path)
+{
+  std::string p(path);
+  std::vector<std::string> &names = Dirs[p.substr(0, p.rfind('/'))];
+  names.erase(std::remove(names.begin(), names.end(), p.substr(p.rfind('/') + 1)), names.end());
+  Card(BENCH_CALL_US + Sectors_Us(2));
+  return (int)syscall(SYS_unlinkat, AT_FDCWD, path, 0);
+}
+
+/********************************************************** Bench **********************************************************/
+static bool Ok = true;
+static uint32_t Load_switches = 0;
+
+static void Check(bool Cond, const char *What)
+{
+  if (!Cond)
+    printf("FAILED: %s\n", What);
+  Ok &= Cond;
+}
+
+static void Load(bool On)
+{
+  Load_switches++;
+}
+
+static bool Ordered(const SD_Bench_Latency_t *l)
+{
+  return l->Count == SD_BENCH_RANDOM_OPS && l->Min_us <= l->P50_us && l->P50_us <= l->P90_us &&
+         l->P90_us <= l->P99_us && l->P99_us <= l->Max_us && l->Min_us <= l->Mean_us && l->Mean_us <= l->Max_us;
+}
+
+int main(int argc, char **argv)
+{
+  if (system("rm -rf " BENCH_DIR) != 0)
+    return 1;
+  SD_Bench_Results_t r;
+  esp_err_t err = SD_Bench_Run(BENCH_DIR, Load, &r);
+  Check(err == ESP_OK && r.Errors == 0, "no errors");
+  bool grows = true;
+  for (int i = 1; i < SD_BENCH_SIZES; i++)
+    grows &= r.Read_kbps[i] > r.Read_kbps[i - 1] && r.Write_kbps[i] > r.Write_kbps[i - 1];
+  Check(grows, "throughput grows with the block size");
+  Check(r.Block[0] == SD_BENCH_MIN_BLOCK && r.Block[SD_BENCH_SIZES - 1] == SD_BENCH_MAX_BLOCK, "block sizes");
+  Check(Ordered(&r.Random) && Ordered(&r.Loaded) && r.Random_iops > 0 && Load_switches == 2, "latency runs");
+  Check(r.Open_us[0] < r.Open_us[1] && r.Open_us[1] < r.Open_us[2], "later entries open slower");
+  Check(r.List_next_file_us > 10 * r.List_readdir_us, "openNextFile() pattern against readdir()");
+  struct stat st;
+  Check(stat(BENCH_DIR, &st) != 0, "everything removed");
+  printf("%s\n", Ok ? "ok" : "FAILED");
+  return Ok ? 0 : 1;
+}
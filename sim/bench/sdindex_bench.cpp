@@ -0,0 +1,196 @@
+// Host bench for the SD directory index (src/SD_Index.cpp), on the FATFS stand-in of sim/Sim_Runtime.cpp.
+//
+// Fills a log directory with capture files and a few others, then checks the index through its API:
+//   - the first use scans the directory and saves the index; every file is found with its size, case-insensitively,
+//     and the extension listings hold exactly the files of that extension, in name order;
+//   - after a remount (SD_Index_Drop()) the saved index is taken as it is, without a scan;
+//   - a file written by something else changes the free cluster count, and the saved index is found stale;
+//   - SD_Index_Note() keeps the RAM copy right for files this firmware writes and removes;
+//   - a damaged saved index is scanned over.
+// Card time is modelled for the old openNextFile() loops and the index. openNextFile() costs a VFS stat() and an
+// fopen(), and FATFS looks the name up for each by reading the directory from its first sector; a directory entry
+// with its long name takes ~96 bytes. The index reads the directory once, sector by sector, or the saved file in
+// one multi-sector read. Constants as in sim/bench/sdcache_bench.cpp.
+//
+// Build from the repository root:
+//   mkdir -p sim/build
+//   g++ -std=gnu++17 -O2 -Wno-format -Isim -Isim/include -Isrc sim/bench/sdindex_bench.cpp src/SD_Index.cpp
+//       sim/Sim_Runtime.cpp -o sim/build/sdindex_bench
+// (one command line)
+// Run:
+//   sim/build/sdindex_bench [files]                  default: 1000
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "ff.h"
+#include "SD_Index.h"
+
+#define BENCH_CMD_US        200.0                               // One SDMMC read command
+#define BENCH_BYTES_PER_US  5.0                                 // 1-bit bus at 40 MHz
+#define BENCH_CALL_US       150.0                               // stat() or fopen() through VFS, card time apart
+#define BENCH_SECTOR        512
+#define BENCH_DIR_ENTRY     96
+#define BENCH_CARD          "sim/build/sdcard"
+#define BENCH_DIR           BENCH_CARD "/log"
+
+typedef struct {
+  std::string Name;
+  uint32_t    Size;
+} Bench_File_t;
+
+static std::mt19937 Rng(5);
+static bool Ok = true;
+
+static void Check(bool Cond, const char *What)
+{
+  if (!Cond)
+    printf("FAILED: %s\n", What);
+  Ok &= Cond;
+}
+
+static void Write_File(const std::string &Path, uint32_t Size)
+{
+  FILE *f = fopen(Path.c_str(), "wb");
+  if (Size)
+    fseek(f, Size - 1, SEEK_SET), fputc(0, f);
+  fclose(f);
+}
+
+static double Sector_Us(double Sectors)
+{
+  return Sectors * (BENCH_CMD_US + BENCH_SECTOR / BENCH_BYTES_PER_US);
+}
+
+// openNextFile() on entry j: the readdir() step, then stat() and fopen() each scanning sectors 0..j
+static double Old_Entry_Us(uint32_t j)
+{
+  double scan = (double)j * BENCH_DIR_ENTRY / BENCH_SECTOR + 1;
+  return 2 * (BENCH_CALL_US + Sector_Us(scan)) + Sector_Us((double)BENCH_DIR_ENTRY / BENCH_SECTOR);
+}
+
+static SD_Index_Stats_t Stats(void)
+{
+  SD_Index_Stats_t st;
+  SD_Index_Get_Stats(&st);
+  return st;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t n = argc > 1 ? atoi(argv[1]) : 1000;
+  Sim_Fatfs_Root = BENCH_CARD;
+  if (system("rm -rf " BENCH_CARD) != 0 || mkdir(BENCH_CARD, 0755) != 0 || mkdir(BENCH_DIR, 0755) != 0)
+    return 1;
+  std::vector<Bench_File_t> files;
+  for (uint32_t i = 0; i < n; i++) {
+    char name[32];
+    const char *ext = i % 10 == 9 ? "csv" : i % 50 == 7 ? "TXT" : "bin";
+    snprintf(name, sizeof(name), "cap%04u_%03u.%s", i / 8, i % 8, ext);
+    files.push_back({name, (uint32_t)(Rng() % 200000)});
+    Write_File(std::string(BENCH_DIR "/") + name, files.back().Size);
+  }
+  mkdir(BENCH_DIR "/old.bin", 0755);                            // A directory with an extension, not a file
+  SD_Index_Init();
+
+  // First use: scan and save
+  Check(SD_Index_Count("/log", NULL) == (int32_t)n + 1, "entry count after the scan");
+  Check(Stats().Scans == 1 && Stats().Saves == 1, "one scan, one save");
+  Check(SD_Index_Count("/nothere", NULL) == -1, "missing directory");
+  SD_Index_File_t f;
+  bool all = true;
+  for (const Bench_File_t &b : files)
+    all &= SD_Index_Stat("/sdcard/log/", b.Name.c_str(), &f) && f.Size == b.Size && strcmp(f.Name, b.Name.c_str()) == 0;
+  Check(all, "every file found with its size");
+  Check(SD_Index_Stat("/log", "CAP0000_000.BIN", NULL) && !SD_Index_Stat("/log", "cap9999_000.bin", NULL),
+        "case-insensitive hit, miss");
+  Check(!SD_Index_Stat("/log", SD_INDEX_FILE, NULL), "the saved index is not listed");
+  const char *exts[] = {".bin", "csv", ".txt"};
+  for (const char *ext : exts) {
+    std::vector<std::string> want;
+    for (const Bench_File_t &b : files) {
+      if (strcasecmp(b.Name.c_str() + b.Name.size() - 3, ext[0] == '.' ? ext + 1 : ext) == 0)
+        want.push_back(b.Name);
+    }
+    std::sort(want.begin(), want.end(), [](const std::string &a, const std::string &b) {
+      return strcasecmp(a.c_str(), b.c_str()) < 0;
+    });
+    std::vector<std::string> got;
+    SD_Index_File_t page[37];
+    uint32_t k;
+    for (uint32_t first = 0; (k = SD_Index_List("/log", ext, first, page, 37)) > 0; first += k) {
+      for (uint32_t i = 0; i < k; i++) {
+        if (!page[i].Is_dir)
+          got.push_back(page[i].Name);
+      }
+    }
+    Check(got == want, ext);
+  }
+
+  // Remount: the saved index, no scan
+  SD_Index_Drop();
+  Check(SD_Index_Count("/log", "bin") > 0 && Stats().Loads == 1 && Stats().Scans == 1, "saved index taken");
+
+  // Another machine adds a file: free clusters change, the saved index is stale
+  Write_File(BENCH_DIR "/added.bin", 70000);
+  SD_Index_Drop();
+  Check(SD_Index_Stat("/log", "added.bin", &f) && f.Size == 70000, "file added elsewhere found");
+  Check(Stats().Stale == 1 && Stats().Scans == 2, "stale index scanned again");
+
+  // This firmware writes and removes files
+  Write_File(BENCH_DIR "/noted.csv", 1234);
+  SD_Index_Note("/sdcard/log/noted.csv");
+  Check(SD_Index_Stat("/log", "noted.csv", &f) && f.Size == 1234 && Stats().Scans == 2, "noted file, no scan");
+  unlink(BENCH_DIR "/noted.csv");
+  SD_Index_Note("/sdcard/log/noted.csv");
+  Check(!SD_Index_Stat("/log", "noted.csv", NULL), "removed file gone");
+
+  // A damaged saved index
+  SD_Index_Rebuild("/log");
+  FILE *idx = fopen(BENCH_DIR "/" SD_INDEX_FILE, "r+b");
+  fseek(idx, sizeof(SD_Index_Header_t) + 1, SEEK_SET);
+  fputc(0xFF, idx);                                             // Name offset of the first entry out of range
+  fputc(0xFF, idx);
+  fputc(0xFF, idx);
+  fclose(idx);
+  uint32_t scans = Stats().Scans;
+  SD_Index_Drop();
+  Check(SD_Index_Count("/log", NULL) == (int32_t)n + 2 && Stats().Scans == scans + 1, "damaged index scanned over");
+
+  // Lookup time of the RAM index
+  const uint32_t rounds = 200000;
+  auto t0 = std::chrono::steady_clock::now();
+  uint32_t hits = 0;
+  for (uint32_t i = 0; i < rounds; i++)
+    hits += SD_Index_Stat("/log", files[i % n].Name.c_str(), NULL);
+  double lookup_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / rounds;
+  Check(hits == rounds, "timed lookups hit");
+
+  // Modelled card time
+  double old_list = 0, old_search = 0;
+  for (uint32_t j = 0; j <= n; j++)
+    old_list += Old_Entry_Us(j);
+  for (uint32_t j = 0; j < n; j++)                              // File_Search() of a random file: half the directory
+    old_search += Old_Entry_Us(j) / 2;
+  double scan = Sector_Us((double)(n + 1) * BENCH_DIR_ENTRY / BENCH_SECTOR + 1);
+  struct stat st;
+  stat(BENCH_DIR "/" SD_INDEX_FILE, &st);
+  double load = BENCH_CALL_US + BENCH_CMD_US + st.st_size / BENCH_BYTES_PER_US;
+
+  printf("\nsd index bench: %u files in /log, saved index %ld KB\n", n, (long)st.st_size / 1024);
+  printf("  openNextFile() loop, Folder_retrieval(): %9.1f ms\n", old_list / 1000);
+  printf("  openNextFile() loop, File_Search():      %9.1f ms on average\n", old_search / 1000);
+  printf("  index, first mount (scan and save):      %9.1f ms + the save\n", scan / 1000);
+  printf("  index, later mounts (saved index):       %9.1f ms\n", load / 1000);
+  printf("  index lookup or listing step:            %9.0f ns, no card access\n", lookup_ns);
+  SD_Index_Print_Stats();
+  printf("%s\n", Ok ? "ok" : "FAILED");
+  return Ok ? 0 : 1;
+}
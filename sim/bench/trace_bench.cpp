@@ -0,0 +1,194 @@
+// Host bench for the I2C transaction tracer (src/I2C_Trace.cpp), built with I2C_TRACE_ENABLE=1 on the real bus
+// manager over a stand-in transport that takes 50 us a transfer and fails a few on purpose.
+//
+// Runs more transactions than the ring holds, then checks:
+//   - a file dump holds the last I2C_TRACE_DEPTH records in order, with the overwritten ones counted as dropped;
+//   - a serial dump is the same bytes, and transactions the bus runs while it pauses the tracer are counted as
+//     dropped in the next dump;
+//   - a clear empties the trace, and tools/i2c_trace_decode.py reads what was written.
+// It prints the host cost of recording one transaction.
+//
+// Build from the repository root:
+//   mkdir -p sim/build
+//   g++ -std=gnu++17 -O2 -Wno-format -Isim -Isim/include -Isrc -DI2C_TRACE_ENABLE=1 sim/bench/trace_bench.cpp
+//       src/I2C_Trace.cpp src/I2C_Driver.cpp sim/Sim_Runtime.cpp -o sim/build/trace_bench
+// (one command line)
+// Run:
+//   sim/build/trace_bench [transactions]            default: 1500
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "Arduino.h"
+#include "Sim_Time.h"
+#include "I2C_Driver.h"
+#include "I2C_Trace.h"
+
+#define BENCH_ADDR       0x6B
+#define BENCH_FAIL_EVERY 250                                    // Every so many transactions is NACKed
+#define BENCH_TRANSFER_US 50
+#define BENCH_FILE       "sim/build/trace_bench.trc"
+
+static int      Failures = 0;
+static uint32_t Issued = 0;                                     // Transactions the bus has run
+
+#define CHECK(cond, ...)                                                                                              \
+  do {                                                                                                                \
+    if (!(cond)) {                                                                                                    \
+      printf("FAILED: " __VA_ARGS__);                                                                                 \
+      printf("\n");                                                                                                   \
+      Failures++;                                                                                                     \
+    }                                                                                                                 \
+  } while (0)
+
+/********************************************************** Transport **********************************************************/
+static esp_err_t Bench_Init(void) { return ESP_OK; }
+static void Bench_Set_Speed(uint8_t Driver_addr, uint32_t Speed_hz) {}
+static esp_err_t Bench_Read(uint8_t Driver_addr, const uint8_t *Reg, size_t Reg_len, uint8_t *Data, size_t Length)
+{
+  Sim_Time_Advance(BENCH_TRANSFER_US);
+  memset(Data, 0, Length);
+  return Issued++ % BENCH_FAIL_EVERY == BENCH_FAIL_EVERY - 1 ? ESP_FAIL : ESP_OK;
+}
+static esp_err_t Bench_Write(uint8_t Driver_addr, const uint8_t *Reg, size_t Reg_len, const uint8_t *Data,
+                             size_t Length)
+{
+  return ESP_ERR_NOT_SUPPORTED;
+}
+static const I2C_Transport_t Bench_Transport = {"bench", Bench_Init, Bench_Set_Speed, Bench_Read, Bench_Write};
+
+const I2C_Transport_t *I2C_Default_Transport(void)
+{
+  return &Bench_Transport;
+}
+
+// Register = low byte of the transaction number, so every record says which transaction it is
+static void Bench_Transactions(uint32_t Count)
+{
+  uint8_t data[6];
+  for (uint32_t i = 0; i < Count; i++)
+    I2C_Read(BENCH_ADDR, (uint8_t)Issued, data, sizeof(data));
+}
+
+/********************************************************** Dumps **********************************************************/
+static std::vector<uint8_t> Serial_bytes;
+static uint32_t             Serial_interleaved = 0;             // Transactions run while the serial dump was going
+
+// The bus task keeps going while a dump copies: a transaction every few records written
+static void Bench_Serial_Write(const uint8_t *buf, size_t size)
+{
+  Serial_bytes.insert(Serial_bytes.end(), buf, buf + size);
+  if (Serial_bytes.size() % (64 * sizeof(I2C_Trace_Record_t)) == 0) {
+    Bench_Transactions(1);
+    Serial_interleaved++;
+  }
+}
+
+static std::vector<uint8_t> Bench_Read_File(const char *Path)
+{
+  std::vector<uint8_t> bytes;
+  FILE *f = fopen(Path, "rb");
+  if (f == NULL)
+    return bytes;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    bytes.insert(bytes.end(), buf, buf + n);
+  fclose(f);
+  return bytes;
+}
+
+// Transaction numbers First .. Last - 1
+static std::vector<uint32_t> Bench_Numbers(uint32_t First, uint32_t Last, std::vector<uint32_t> Before = {})
+{
+  for (uint32_t n = First; n < Last; n++)
+    Before.push_back(n);
+  return Before;
+}
+
+// The dump must be the Expected transactions, in order, and say how many were dropped
+static void Bench_Check_Dump(const char *What, const std::vector<uint8_t> &Dump,
+                             const std::vector<uint32_t> &Expected, uint32_t Dropped)
+{
+  uint32_t Count = Expected.size();
+  I2C_Trace_Header_t h;
+  if (Dump.size() < sizeof(h)) {
+    CHECK(false, "%s: %zu bytes, no header", What, Dump.size());
+    return;
+  }
+  memcpy(&h, Dump.data(), sizeof(h));
+  CHECK(h.Magic == I2C_TRACE_MAGIC && h.Version == I2C_TRACE_VERSION && h.Record_size == sizeof(I2C_Trace_Record_t),
+        "%s: bad header", What);
+  CHECK(h.Count == Count && h.Dropped == Dropped, "%s: %u records %u dropped, expected %u and %u", What, h.Count,
+        h.Dropped, Count, Dropped);
+  CHECK(Dump.size() == sizeof(h) + h.Count * sizeof(I2C_Trace_Record_t), "%s: %zu bytes for %u records", What,
+        Dump.size(), h.Count);
+  uint32_t bad = 0, failed = 0;
+  uint32_t whole = (Dump.size() - sizeof(h)) / sizeof(I2C_Trace_Record_t);
+  for (uint32_t k = 0; k < h.Count && k < Count && k < whole; k++) {
+    I2C_Trace_Record_t r;
+    memcpy(&r, Dump.data() + sizeof(h) + k * sizeof(r), sizeof(r));
+    uint32_t n = Expected[k];
+    bool fail = n % BENCH_FAIL_EVERY == BENCH_FAIL_EVERY - 1;
+    bad += r.Reg_addr != (n & 0xFF) || r.Driver_addr != (BENCH_ADDR | 0x80) || r.Length != 6 ||
+           r.Duration_us != BENCH_TRANSFER_US || r.Result != (fail ? I2C_TRACE_RESULT_FAIL : I2C_TRACE_RESULT_OK);
+    failed += fail;
+  }
+  CHECK(bad == 0, "%s: %u records out of order or wrong", What, bad);
+  printf("  %-28s %4u records, %4u dropped, %2u failed transfers\n", What, h.Count, h.Dropped, failed);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t transactions = argc > 1 ? atoi(argv[1]) : 1500;
+  if (transactions <= I2C_TRACE_DEPTH)
+    transactions = I2C_TRACE_DEPTH + 1;
+  I2C_Init();
+  printf("trace bench: %u transactions, ring of %u\n", transactions, I2C_TRACE_DEPTH);
+
+  timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  Bench_Transactions(transactions);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  CHECK(I2C_Trace_Count() == I2C_TRACE_DEPTH, "%u records after %u transactions", I2C_Trace_Count(), transactions);
+
+  CHECK(I2C_Trace_Dump_File(BENCH_FILE) == ESP_OK, "file dump failed");
+  std::vector<uint8_t> file = Bench_Read_File(BENCH_FILE);
+  std::vector<uint32_t> ring = Bench_Numbers(Issued - I2C_TRACE_DEPTH, Issued);
+  Bench_Check_Dump("file", file, ring, transactions - I2C_TRACE_DEPTH);
+
+  // Serial, with the bus running meanwhile: same bytes, and what ran during it is lost
+  uint32_t before = Issued;
+  Sim_Serial_Write = Bench_Serial_Write;
+  I2C_Trace_Dump_Serial();
+  Sim_Serial_Write = NULL;
+  CHECK(Serial_interleaved > 0 && Issued == before + Serial_interleaved, "no transactions during the serial dump");
+  CHECK(Serial_bytes == file, "serial dump differs from the file dump");
+  CHECK(I2C_Trace_Count() == I2C_TRACE_DEPTH, "transactions during the dump were recorded");
+  CHECK(I2C_Trace_Dump_File(BENCH_FILE) == ESP_OK, "file dump failed");
+  Bench_Check_Dump("after the serial dump", Bench_Read_File(BENCH_FILE), ring,
+                   transactions - I2C_TRACE_DEPTH + Serial_interleaved);
+
+  // Recording resumes after the dump; a clear empties the trace and the count of losses
+  Bench_Transactions(100);
+  CHECK(I2C_Trace_Dump_File(BENCH_FILE) == ESP_OK, "file dump failed");
+  ring.erase(ring.begin(), ring.begin() + 100);
+  Bench_Check_Dump("100 more", Bench_Read_File(BENCH_FILE), Bench_Numbers(Issued - 100, Issued, ring),
+                   transactions - I2C_TRACE_DEPTH + Serial_interleaved + 100);
+  I2C_Trace_Clear();
+  CHECK(I2C_Trace_Count() == 0, "%u records after a clear", I2C_Trace_Count());
+  Bench_Transactions(10);
+  CHECK(I2C_Trace_Dump_File(BENCH_FILE) == ESP_OK, "file dump failed");
+  Bench_Check_Dump("cleared, 10 more", Bench_Read_File(BENCH_FILE), Bench_Numbers(Issued - 10, Issued), 0);
+  CHECK(system("python3 tools/i2c_trace_decode.py " BENCH_FILE " > /dev/null") == 0, "decoder rejected the dump");
+
+  double ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / transactions;
+  printf("  host cost of a traced transaction through the bus manager: %.0f ns\n", ns);
+  if (Failures) {
+    printf("%d checks failed\n", Failures);
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
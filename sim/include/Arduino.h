@@ -0,0 +1,46 @@
+#pragma once
+// Host stand-in for the Arduino core calls the drivers make. GPIO is recorded, not driven,
+// interrupts attached here are fired by the device models through Sim_Gpio_Trigger().
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_attr.h"
+
+#define LOW       0
+#define HIGH      1
+#define INPUT     0x01
+#define OUTPUT    0x03
+#define INPUT_PULLUP 0x05
+#define RISING    0x01
+#define FALLING   0x02
+#define CHANGE    0x03
+
+void     pinMode(uint8_t pin, uint8_t mode);
+void     digitalWrite(uint8_t pin, uint8_t val);
+int      digitalRead(uint8_t pin);
+void     attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void     detachInterrupt(uint8_t pin);
+void     noInterrupts(void);
+void     interrupts(void);
+void     delay(uint32_t ms);
+void     delayMicroseconds(uint32_t us);
+uint32_t millis(void);
+uint32_t micros(void);
+void     analogReadResolution(uint8_t bits);
+uint32_t analogReadMilliVolts(uint8_t pin);
+
+void     Sim_Gpio_Trigger(uint8_t pin, uint8_t level);          // Drives an input pin from a device model
+
+// Serial output goes to Sim_Serial_Write when a harness sets it (to capture a binary dump), otherwise nowhere
+struct Sim_Serial_t {
+  size_t write(const uint8_t *buf, size_t size);
+  void   flush(void) {}
+};
+extern Sim_Serial_t Serial;
+extern void (*Sim_Serial_Write)(const uint8_t *buf, size_t size);
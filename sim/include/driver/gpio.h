@@ -0,0 +1,4 @@
+#pragma once
+#include "esp_err.h"
+typedef int gpio_num_t;
+#define GPIO_NUM_NC  (-1)
@@ -0,0 +1,3 @@
+#pragma once
+#include "esp_err.h"
+typedef struct Sim_Spi_Device *spi_device_handle_t;
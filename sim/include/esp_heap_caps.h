@@ -0,0 +1,16 @@
+#pragma once
+#include <stdlib.h>
+#include <stddef.h>
+
+#define MALLOC_CAP_DEFAULT   (1 << 0)
+#define MALLOC_CAP_INTERNAL  (1 << 1)
+#define MALLOC_CAP_SPIRAM    (1 << 2)
+#define MALLOC_CAP_DMA       (1 << 3)
+#define MALLOC_CAP_8BIT      (1 << 4)
+
+static inline void *heap_caps_malloc(size_t size, unsigned caps)                { (void)caps; return malloc(size); }
+static inline void *heap_caps_calloc(size_t n, size_t size, unsigned caps)      { (void)caps; return calloc(n, size); }
+static inline void *heap_caps_realloc(void *ptr, size_t size, unsigned caps)    { (void)caps; return realloc(ptr, size); }
+static inline void *heap_caps_aligned_alloc(size_t align, size_t size, unsigned caps) { (void)caps; return aligned_alloc(align, (size + align - 1) / align * align); }
+static inline void  heap_caps_free(void *ptr)                                   { free(ptr); }
+static inline size_t heap_caps_get_free_size(unsigned caps)                     { (void)caps; return 8u << 20; }
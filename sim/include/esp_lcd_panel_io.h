@@ -0,0 +1,3 @@
+#pragma once
+#include "esp_err.h"
+typedef struct Sim_Lcd_Panel_Io *esp_lcd_panel_io_handle_t;
@@ -0,0 +1,3 @@
+#pragma once
+#include "esp_err.h"
+typedef struct Sim_Lcd_Panel *esp_lcd_panel_handle_t;
@@ -0,0 +1,3 @@
+#pragma once
+#include "esp_lcd_panel_ops.h"
+typedef struct { int Unused; } esp_lcd_rgb_panel_event_data_t;
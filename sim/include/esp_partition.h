@@ -0,0 +1,60 @@
+#pragma once
+// esp_partition stand-in for the host build: the partitions of the project's table (Sim_Flash_Table, read on first
+// use) in one 16 MB buffer of erased flash. Writes only clear bits, as NOR flash does, so a missing erase shows up
+// as wrong data; a mapping is a pointer into the buffer. Sim_Flash_Stats counts the work for timing models.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef enum {
+  ESP_PARTITION_TYPE_APP = 0x00, ESP_PARTITION_TYPE_DATA = 0x01, ESP_PARTITION_TYPE_ANY = 0xff,
+} esp_partition_type_t;
+
+typedef enum {
+  ESP_PARTITION_SUBTYPE_APP_OTA_0 = 0x10, ESP_PARTITION_SUBTYPE_DATA_OTA = 0x00, ESP_PARTITION_SUBTYPE_DATA_NVS = 0x02,
+  ESP_PARTITION_SUBTYPE_DATA_COREDUMP = 0x03, ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef enum { ESP_PARTITION_MMAP_DATA, ESP_PARTITION_MMAP_INST } esp_partition_mmap_memory_t;
+typedef uint32_t esp_partition_mmap_handle_t;
+
+typedef struct {
+  void                   *flash_chip;
+  esp_partition_type_t    type;
+  esp_partition_subtype_t subtype;
+  uint32_t                address;
+  uint32_t                size;
+  uint32_t                erase_size;
+  char                    label[17];
+  bool                    encrypted;
+  bool                    readonly;
+} esp_partition_t;
+
+typedef struct {
+  uint64_t Erased;                                              // Bytes
+  uint64_t Written;
+  uint32_t Maps;
+  uint32_t Mapped;                                              // Mappings not yet unmapped
+} Sim_Flash_Stats_t;
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern const char       *Sim_Flash_Table;                       // Default partitions_assets.csv
+extern Sim_Flash_Stats_t Sim_Flash_Stats;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size);
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t memory, const void **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle);
+void      esp_partition_munmap(esp_partition_mmap_handle_t handle);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+// The ROM's CRC-32 for the host build: the IEEE polynomial, reflected, as zlib.crc32(); Crc is the value so far, 0 to
+// start
+#include <stdint.h>
+
+static inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+  crc = ~crc;
+  while (len--) {
+    crc ^= *buf++;
+    for (int k = 0; k < 8; k++)
+      crc = (crc & 1) ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+  }
+  return ~crc;
+}
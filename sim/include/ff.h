@@ -0,0 +1,74 @@
+#pragma once
+// FATFS stand-in for the host build: the calls the firmware makes, on a host directory (Sim_Fatfs_Root) that plays
+// the card. Drive "0:" is that directory. One cluster per started 32 KB of file data, for f_getfree().
+#include <stdint.h>
+#include <stdio.h>
+
+typedef unsigned int UINT;
+typedef uint8_t      BYTE;
+typedef uint16_t     WORD;
+typedef uint32_t     DWORD;
+typedef uint32_t     FSIZE_t;
+typedef char         TCHAR;
+
+typedef enum {
+  FR_OK = 0, FR_DISK_ERR, FR_INT_ERR, FR_NOT_READY, FR_NO_FILE, FR_NO_PATH, FR_INVALID_NAME, FR_DENIED, FR_EXIST,
+} FRESULT;
+
+#define FF_LFN_BUF         255
+#define AM_RDO             0x01
+#define AM_HID             0x02
+#define AM_SYS             0x04
+#define AM_DIR             0x10
+#define AM_ARC             0x20
+#define FA_READ            0x01
+#define FA_WRITE           0x02
+#define FA_OPEN_EXISTING   0x00
+#define FA_CREATE_NEW      0x04
+#define FA_CREATE_ALWAYS   0x08
+#define FA_OPEN_ALWAYS     0x10
+
+typedef struct {
+  DWORD n_fatent;                                               // Clusters + 2
+  WORD  csize;                                                  // Sectors per cluster
+} FATFS;
+
+typedef struct {
+  FILE   *File;
+  FSIZE_t Size;
+} FIL;
+
+typedef struct {
+  void *Dir;                                                    // Host DIR *
+  char  Path[512];
+} FF_DIR;
+
+typedef struct {
+  FSIZE_t fsize;
+  WORD    fdate;
+  WORD    ftime;
+  BYTE    fattrib;
+  TCHAR   altname[13];
+  TCHAR   fname[FF_LFN_BUF + 1];
+} FILINFO;
+
+#define f_size(fp) ((fp)->Size)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern const char *Sim_Fatfs_Root;                              // Default sim/build/sdcard
+
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode);
+FRESULT f_close(FIL *fp);
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br);
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw);
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs);
+FRESULT f_opendir(FF_DIR *dp, const TCHAR *path);
+FRESULT f_closedir(FF_DIR *dp);
+FRESULT f_readdir(FF_DIR *dp, FILINFO *fno);
+FRESULT f_stat(const TCHAR *path, FILINFO *fno);
+FRESULT f_getfree(const TCHAR *path, DWORD *nclst, FATFS **fatfs);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+// Host stand-in for the FreeRTOS subset the drivers use. Everything runs on one thread: task creation
+// fails so the I2C bus manager executes transfers inline, and blocking calls advance the virtual clock.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+typedef int          BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t     TickType_t;
+
+#define pdTRUE                1
+#define pdFALSE               0
+#define pdPASS                pdTRUE
+#define pdFAIL                pdFALSE
+#define portMAX_DELAY         ((TickType_t)0xFFFFFFFFu)
+#define configTICK_RATE_HZ    1000
+#define portTICK_PERIOD_MS    (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)     ((TickType_t)(ms))
+#define pdTICKS_TO_MS(ticks)  ((uint32_t)(ticks))
+#define tskNO_AFFINITY        0x7FFFFFFF
+
+typedef struct { int Owner; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED  {0}
+#define portENTER_CRITICAL(mux)       ((void)(mux))
+#define portEXIT_CRITICAL(mux)        ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux)   ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux)    ((void)(mux))
+#define portYIELD_FROM_ISR(...)       ((void)0)
+#define taskENTER_CRITICAL(mux)       ((void)(mux))
+#define taskEXIT_CRITICAL(mux)        ((void)(mux))
+
+typedef struct Sim_Task      *TaskHandle_t;
+typedef struct Sim_Queue     *QueueHandle_t;
+typedef struct Sim_Semaphore *SemaphoreHandle_t;
+typedef struct { uint64_t Storage[4]; } StaticSemaphore_t;
+typedef void (*TaskFunction_t)(void *);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+BaseType_t   xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                     UBaseType_t prio, TaskHandle_t *handle, BaseType_t core);
+BaseType_t   xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio, TaskHandle_t *handle);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+void         vTaskDelay(TickType_t ticks);
+void         vTaskDelete(TaskHandle_t task);
+TickType_t   xTaskGetTickCount(void);
+uint32_t     ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+BaseType_t   xTaskNotifyGive(TaskHandle_t task);
+void         vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+BaseType_t    xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t    xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken);
+BaseType_t    xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+BaseType_t    xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks);
+BaseType_t    xQueueReset(QueueHandle_t queue);
+UBaseType_t   uxQueueMessagesWaiting(QueueHandle_t queue);
+void          vQueueDelete(QueueHandle_t queue);
+#ifdef __cplusplus
+}
+#endif
+#define xQueueSendToBack xQueueSend
@@ -0,0 +1,2 @@
+#pragma once
+#include "freertos/semphr.h"
@@ -0,0 +1,420 @@
+// Host-side I2C simulator: runs the real touch, IMU, RTC and IO expander drivers against register-level
+// device models and reports per-operation latency under injected bus latency and errors.
+//
+// Build from the repository root (no toolchain or board needed):
+//   mkdir -p sim/build
+//   g++ -std=gnu++17 -O2 -Wno-format -Isim -Isim/include -Isrc -Ilib/lvgl -Ilib/lvgl/src -DLV_CONF_INCLUDE_SIMPLE
+//       sim/*.cpp src/I2C_Driver.cpp src/I2C_Benchmark.cpp src/Touch_GT911.cpp src/Gyro_QMI8658.cpp src/IMU_Stream.cpp
+//       src/RTC_PCF85063.cpp src/System_Time.cpp src/TCA9554PWR.cpp -o sim/build/i2c_sim
+// (one command line; -Wno-format because the drivers print uint32_t with %lu, which is right on Xtensa only.
+//  Add -DQMI8658_INT2_PIN=13 to drain the IMU FIFO on the modelled watermark interrupt instead of by polling,
+//  -DQMI8658_INT1_PIN=14 to take CTRL9 completion from the modelled INT1, and -DPCF85063_INT_PIN=12 to
+//  discipline the system time from the RTC's half-minute interrupt instead of by hunting for the rollover.
+//  Add -DI2C_TRACE_ENABLE=1 src/I2C_Trace.cpp to trace the bus; sim/bench/trace_bench.cpp checks the tracer.)
+// Run:
+//   sim/build/i2c_sim [iterations] [scenario]
+//
+// Times are virtual (bus time as the board would see it), except "host ns" which is the CPU cost of the
+// driver code on the build machine. Everything runs on one thread, so the bus manager executes inline.
+#include <algorithm>
+#include <vector>
+#include <time.h>
+#include "Sim_Bus.h"
+#include "Sim_Devices.h"
+#include "Sim_Time.h"
+#include "I2C_Driver.h"
+#include "I2C_Benchmark.h"
+#include "TCA9554PWR.h"
+#include "Touch_GT911.h"
+#include "Gyro_QMI8658.h"
+#include "IMU_Stream.h"
+#include "RTC_PCF85063.h"
+#include "System_Time.h"
+
+static Sim_TCA9554  Sim_Exio;
+static Sim_GT911    Sim_Touch;
+static Sim_QMI8658  Sim_Imu;
+static Sim_PCF85063 Sim_Rtc;
+
+typedef struct {
+  const char *Name;
+  Sim_Fault_t Fault;                                            // Applied to the whole bus
+} Sim_Scenario_t;
+
+static const Sim_Scenario_t Scenarios[] = {
+  { "clean",        {} },
+  { "latency_50us", { 50, 0, 0, 0.0f } },
+  { "nack_2pct",    { 0, 0, 0, 0.02f } },
+  { "nack_every_25",{ 0, 25, 0, 0.0f } },
+  { "timeout_1pct", { 0, 0, 100, 0.0f } },
+};
+
+typedef struct {
+  const char *Name;
+  void (*Setup)(void);                                          // Optional, before the first iteration
+  void (*Teardown)(void);                                       // Optional, after the last
+  void (*Prepare)(uint32_t i);                                  // Not timed: moves the models to the next state
+  void (*Run)(uint32_t i);                                      // Timed
+  bool (*Check)(uint32_t i);                                    // Not timed: did the driver see what the model holds?
+} Sim_Workload_t;
+
+/********************************************************** Workloads **********************************************************/
+static uint16_t Touch_X(uint32_t i) { return 40 + (i * 7) % 400; }
+static uint16_t Touch_Y(uint32_t i) { return 60 + (i * 13) % 520; }
+
+static void Touch_Prepare(uint32_t i)
+{
+  Sim_Touch_Point_t p = { Touch_X(i), Touch_Y(i), 30 };
+  Sim_Touch.Touch(&p, 1);
+  Sim_Time_Advance(Sim_Touch.Report_period_us);
+}
+static void Touch_Run(uint32_t i)
+{
+  Touch_Read_Data();
+}
+static bool Touch_Check(uint32_t i)
+{
+  uint16_t x[GT911_LCD_TOUCH_MAX_POINTS], y[GT911_LCD_TOUCH_MAX_POINTS];
+  uint8_t n = 0;
+  Touch_Get_XY(x, y, NULL, &n, GT911_LCD_TOUCH_MAX_POINTS);
+  return n == 1 && x[0] == Touch_X(i) && y[0] == Touch_Y(i);
+}
+
+static void Touch_Idle_Prepare(uint32_t i)
+{
+  Sim_Touch.Release();
+  Sim_Time_Advance(Sim_Touch.Report_period_us);
+}
+static bool Touch_Idle_Check(uint32_t i)
+{
+  uint16_t x[GT911_LCD_TOUCH_MAX_POINTS], y[GT911_LCD_TOUCH_MAX_POINTS];
+  uint8_t n = 0;
+  Touch_Get_XY(x, y, NULL, &n, GT911_LCD_TOUCH_MAX_POINTS);
+  return n == 0;
+}
+
+static void Imu_Prepare(uint32_t i)
+{
+  Sim_Imu.Gravity_g[0] = 0.001f * (i % 100);
+  Sim_Time_Advance(QMI8658_REFRESH_DELAY);                      // Old enough for the getters to re-read the block
+}
+static void Imu_Run(uint32_t i)
+{
+  getAccelerometer();
+  getGyroscope();
+}
+static bool Imu_Check(uint32_t i)
+{
+  return fabsf(Accel.x - Sim_Imu.Gravity_g[0]) < 0.002f && fabsf(Accel.z - Sim_Imu.Gravity_g[2]) < 0.002f &&
+         fabsf(Gyro.x - Sim_Imu.Rate_dps[0]) < 0.01f && fabsf(getTemperature() - Sim_Imu.Temperature_c) < 0.01f;
+}
+
+static IMU_Reader_t Fifo_reader;
+static uint16_t     Fifo_drained = 0;
+
+static float Fifo_Gravity_Y(uint32_t i) { return 0.004f * (i % 50); }
+
+static void Fifo_Setup(void)
+{
+  Sim_Imu.Gravity_g[1] = Fifo_Gravity_Y(0);               // Samples taken while the FIFO starts up belong to iteration 0
+  QMI8658_FIFO_Init();
+  IMU_Reader_Attach(&Fifo_reader);
+}
+static void Fifo_Teardown(void)
+{
+  QMI8658_FIFO_Stop();
+}
+
+static void Fifo_Prepare(uint32_t i)
+{
+  Sim_Imu.Gravity_g[1] = Fifo_Gravity_Y(i);
+  Sim_Time_Advance((int64_t)(QMI8658_FIFO_WATERMARK * 1e6 / Sim_Imu.Odr_hz()));
+}
+static void Fifo_Run(uint32_t i)
+{
+  Fifo_drained = QMI8658_FIFO_Drain();
+}
+// Every drained sample must reach the reader, in order, with the model's values and sane spacing.
+// Samples that landed during the previous burst still carry the previous iteration's gravity.
+// The polled getters and the Accel/Gyro globals follow the newest sample, with the chip's counter and temperature.
+static bool Fifo_Check(uint32_t i)
+{
+  static IMU_Sample_t out[QMI8658_FIFO_SAMPLES];
+  uint32_t n = IMU_Reader_Read(&Fifo_reader, out, QMI8658_FIFO_SAMPLES);
+  if (n != Fifo_drained || n == 0 || Fifo_reader.Dropped)
+    return false;
+  float period = 1e6f / Sim_Imu.Odr_hz();
+  float scale = IMU_Stream_Acc_Scale();
+  QMI8658_Raw_t raw;
+  QMI8658_Get_Raw(&raw);
+  if (fabsf(Accel.y - out[n - 1].Acc[1] * scale) > 1e-4f || fabsf(Gyro.x - Sim_Imu.Rate_dps[0]) > 0.01f ||
+      fabsf(getTemperature() - Sim_Imu.Temperature_c) > 0.01f || (raw.Timestamp[0] | raw.Timestamp[1] | raw.Timestamp[2]) == 0)
+    return false;
+  for (uint32_t k = 0; k < n; k++) {
+    float y = out[k].Acc[1] * scale;
+    if ((fabsf(y - Fifo_Gravity_Y(i)) > 0.001f && (i == 0 || fabsf(y - Fifo_Gravity_Y(i - 1)) > 0.001f)) ||
+        fabsf(out[k].Acc[2] * scale - 1.0f) > 0.001f)
+      return false;
+    if (k && fabsf((float)(int32_t)(out[k].Time_us - out[k - 1].Time_us) - period) > 2.0f)
+      return false;
+  }
+  return true;
+}
+
+// Asleep: the accelerometer alone in Wake on Motion, the board tilts on every odd iteration and holds still otherwise
+static bool Wom_seen = false;
+
+static void Wom_Setup(void)
+{
+  QMI8658_WoM_Enable();
+  Sim_Time_Advance(500000);                                     // Past the blanking samples
+  QMI8658_WoM_Poll();
+}
+static void Wom_Teardown(void)
+{
+  QMI8658_WoM_Disable();
+  Sim_Imu.Gravity_g[0] = 0.0f;
+}
+static void Wom_Prepare(uint32_t i)
+{
+  if (i & 1)
+    Sim_Imu.Gravity_g[0] = Sim_Imu.Gravity_g[0] == 0.0f ? 0.2f : 0.0f;
+  Sim_Time_Advance(100000);
+}
+static void Wom_Run(uint32_t i)
+{
+  Wom_seen = QMI8658_WoM_Poll();
+}
+static bool Wom_Check(uint32_t i)
+{
+  return Wom_seen == ((i & 1) != 0);
+}
+
+static void Rtc_Prepare(uint32_t i)
+{
+  Sim_Time_Advance(250000);
+}
+static void Rtc_Run(uint32_t i)
+{
+  PCF85063_Read_Time(&datetime);
+}
+static bool Rtc_Check(uint32_t i)
+{
+  time_t now = Sim_Rtc.Now();
+  struct tm tm;
+  gmtime_r(&now, &tm);
+  return datetime.second == tm.tm_sec && datetime.minute == tm.tm_min && datetime.hour == tm.tm_hour;
+}
+
+// The software clock against a drifting RTC: every Run is one rollover measurement (waiting for it included), the
+// check is that the clock agreed with the RTC to within 1 ms when it was measured
+#define CLOCK_DRIFT_PPM   40.0
+#define CLOCK_TOLERANCE_US 1000
+static int64_t Clock_error_us;
+
+static int64_t Clock_Error(void)
+{
+  const int64_t day = 86400LL * 1000000;                        // The driver's year base is not the model's: compare time of day
+  int64_t d = (System_Time_us() - Sim_Rtc.Now_us()) % day;
+  return d > day / 2 ? d - day : d < -day / 2 ? d + day : d;
+}
+static void Clock_Setup(void)
+{
+  System_Time_Stats_t st;
+  if (Sim_Rtc.Drift_ppm != CLOCK_DRIFT_PPM) {                   // First scenario: start the crystal drifting
+    Sim_Rtc.Drift_ppm = CLOCK_DRIFT_PPM;
+    Sim_Rtc.Set(Sim_Rtc.Now());
+    Sim_Rtc.Wire_Int(PCF85063_INT_PIN);
+    System_Time_Init();
+  }
+  System_Time_Get_Stats(&st);
+  while (st.Edges < 3) {                                        // Boot: a coarse rollover, two fine ones for the frequency
+    System_Time_Discipline();
+    System_Time_Get_Stats(&st);
+  }
+}
+static void Clock_Prepare(uint32_t i)
+{
+}
+static void Clock_Run(uint32_t i)
+{
+  System_Time_Discipline();
+  Clock_error_us = Clock_Error();
+}
+static bool Clock_Check(uint32_t i)
+{
+  return llabs(Clock_error_us) < CLOCK_TOLERANCE_US;
+}
+
+static void Exio_Prepare(uint32_t i)
+{
+  Sim_Time_Advance(1000);
+}
+static void Exio_Run(uint32_t i)
+{
+  Set_EXIO(EXIO_PIN3, i & 0x01);
+}
+static bool Exio_Check(uint32_t i)
+{
+  return Sim_Exio.Pin(EXIO_PIN3) == (i & 0x01);
+}
+
+static void Exio_Batch_Run(uint32_t i)
+{
+  EXIO_Batch_Begin();
+  for (uint8_t pin = EXIO_PIN3; pin <= EXIO_PIN6; pin++)
+    Set_EXIO(pin, (i >> (pin - EXIO_PIN3)) & 0x01);
+  EXIO_Batch_Commit();
+}
+static bool Exio_Batch_Check(uint32_t i)
+{
+  for (uint8_t pin = EXIO_PIN3; pin <= EXIO_PIN6; pin++)
+    if (Sim_Exio.Pin(pin) != ((i >> (pin - EXIO_PIN3)) & 0x01))
+      return false;
+  return true;
+}
+
+static const Sim_Workload_t Workloads[] = {
+  { "touch report",  NULL, NULL,                 Touch_Prepare,      Touch_Run,      Touch_Check },
+  { "touch idle",    NULL, NULL,                 Touch_Idle_Prepare, Touch_Run,      Touch_Idle_Check },
+  { "imu acc+gyro",  NULL, NULL,                 Imu_Prepare,        Imu_Run,        Imu_Check },
+  { "imu fifo",      Fifo_Setup, Fifo_Teardown,  Fifo_Prepare,       Fifo_Run,       Fifo_Check },
+  { "imu wom poll",  Wom_Setup, Wom_Teardown,    Wom_Prepare,        Wom_Run,        Wom_Check },
+  { "rtc time",      NULL, NULL,                 Rtc_Prepare,        Rtc_Run,        Rtc_Check },
+  { "rtc discipline",Clock_Setup, NULL,           Clock_Prepare,     Clock_Run,      Clock_Check },
+  { "exio pin",      NULL, NULL,                 Exio_Prepare,       Exio_Run,       Exio_Check },
+  { "exio batch x4", NULL, NULL,                 Exio_Prepare,       Exio_Batch_Run, Exio_Batch_Check },
+};
+
+/********************************************************** Runner **********************************************************/
+typedef struct {
+  const char *Scenario;
+  const char *Workload;
+  uint32_t    Ops;
+  uint32_t    Failed_checks;
+  uint32_t    Transfers;
+  uint32_t    Bus_errors;
+  double      Avg_us;
+  int64_t     P50_us;
+  int64_t     P99_us;
+  int64_t     Max_us;
+  double      Host_ns;
+} Sim_Result_t;
+
+static int64_t Host_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static Sim_Result_t Run_Workload(const Sim_Scenario_t *sc, const Sim_Workload_t *wl, uint32_t Iterations)
+{
+  Sim_Result_t r = {};
+  std::vector<int64_t> lat;
+  lat.reserve(Iterations);
+  Sim_Bus_Stats_t before, after;
+  int64_t host = 0;
+
+  if (wl->Setup)
+    wl->Setup();
+  Sim_Bus_Clear_Faults();
+  Sim_Bus_Seed(0xC0FFEE);
+  Sim_Bus_Set_Fault(0, &sc->Fault);                             // Prepare and Check never touch the bus, only Run sees the faults
+  Sim_Bus_Get_Stats(&before);
+  for (uint32_t i = 0; i < Iterations; i++) {
+    wl->Prepare(i);
+    int64_t t0 = Sim_Time_Now();
+    int64_t h0 = Host_ns();
+    wl->Run(i);
+    host += Host_ns() - h0;
+    lat.push_back(Sim_Time_Now() - t0);
+    if (!wl->Check(i))
+      r.Failed_checks++;
+  }
+  Sim_Bus_Get_Stats(&after);
+  Sim_Bus_Clear_Faults();
+  if (wl->Teardown)
+    wl->Teardown();
+
+  std::sort(lat.begin(), lat.end());
+  int64_t sum = 0;
+  for (int64_t v : lat)
+    sum += v;
+  r.Scenario = sc->Name;
+  r.Workload = wl->Name;
+  r.Ops = Iterations;
+  r.Transfers = after.Transfers - before.Transfers;
+  r.Bus_errors = (after.Nacks - before.Nacks) + (after.Timeouts - before.Timeouts);
+  r.Avg_us = (double)sum / Iterations;
+  r.P50_us = lat[Iterations / 2];
+  r.P99_us = lat[(Iterations * 99) / 100];
+  r.Max_us = lat.back();
+  r.Host_ns = (double)host / Iterations;
+  return r;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t Iterations = argc > 1 ? (uint32_t)atoi(argv[1]) : 500;
+  const char *Only = argc > 2 ? argv[2] : NULL;
+  if (Iterations == 0)
+    Iterations = 1;
+
+  Sim_Bus_Attach(&Sim_Exio);
+  Sim_Bus_Attach(&Sim_Touch);
+  Sim_Bus_Attach(&Sim_Imu);
+  Sim_Bus_Attach(&Sim_Rtc);
+  Sim_Touch.Wire_Reset(&Sim_Exio, EXIO_PIN2);
+  Sim_Imu.Rate_dps[0] = 10.0f;
+  Sim_Imu.Wire_Int1(QMI8658_INT1_PIN);
+  Sim_Imu.Wire_Int2(QMI8658_INT2_PIN);
+
+  // Same order as Driver_Init() in main.cpp
+  I2C_Init();
+  EXIO_Batch_Begin();
+  TCA9554PWR_Init(0x00);
+  Set_EXIO(EXIO_PIN8, Low);
+  EXIO_Batch_Commit();
+  Touch_Init();
+  QMI8658_Init();
+  PCF85063_Init();
+  printf("sim: drivers up after %lld us of virtual time\n", (long long)Sim_Time_Now());
+
+  std::vector<Sim_Result_t> results;
+  for (const Sim_Scenario_t &sc : Scenarios) {
+    if (Only && strcmp(Only, sc.Name) != 0)
+      continue;
+    for (const Sim_Workload_t &wl : Workloads)
+      results.push_back(Run_Workload(&sc, &wl, Iterations));
+  }
+
+  if (Only == NULL || strcmp(Only, "firmware_bench") == 0) {
+    Sim_Bus_Clear_Faults();
+    I2C_Benchmark(Iterations);                                  // The on-target benchmark, unchanged, against the models
+  }
+
+  printf("\n%-14s %-14s %6s %6s %6s %9s %8s %8s %8s %9s %6s\n", "scenario", "workload", "ops", "xfers", "errs",
+         "avg us", "p50 us", "p99 us", "max us", "host ns", "bad");
+  uint32_t bad = 0;
+  for (const Sim_Result_t &r : results) {
+    printf("%-14s %-14s %6u %6u %6u %9.1f %8lld %8lld %8lld %9.0f %6u\n", r.Scenario, r.Workload, r.Ops, r.Transfers,
+           r.Bus_errors, r.Avg_us, (long long)r.P50_us, (long long)r.P99_us, (long long)r.Max_us, r.Host_ns, r.Failed_checks);
+    if (strcmp(r.Scenario, "clean") == 0)
+      bad += r.Failed_checks;
+  }
+  QMI8658_FIFO_Stats_t fifo;
+  QMI8658_FIFO_Get_Stats(&fifo);
+  printf("\nIMU FIFO (last run): %u batches, %u samples, max batch %u, %u overflows, %u irqs, ODR measured %.2f Hz vs %.2f Hz\n",
+         fifo.Batches, fifo.Samples, fifo.Max_batch, fifo.Overflows, fifo.Irqs, fifo.Odr_hz, Sim_Imu.Odr_hz());
+  printf("Expander writes: output %u, config %u. Touch reports %u, acknowledged %u. IMU samples %u.\n",
+         Sim_Exio.Writes[0x01], Sim_Exio.Writes[0x03], Sim_Touch.Reports, Sim_Touch.Reports_read, Sim_Imu.Samples);
+  System_Time_Stats_t clock;
+  System_Time_Get_Stats(&clock);
+  printf("System time: %u rollovers (%s), %u RTC reads, %u steps, interval %u s, offset last %d us max %d us, "
+         "frequency %.2f ppm vs %.2f ppm modelled.\n", clock.Edges, clock.Interrupt ? "interrupt" : "polled", clock.Reads,
+         clock.Steps, clock.Interval_s, clock.Last_offset_us, clock.Max_offset_us, clock.Freq_ppm, Sim_Rtc.Drift_ppm);
+  if (bad)
+    printf("sim: %u checks failed without fault injection\n", bad);
+  return bad ? 1 : 0;
+}
@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "Asset_Pack.h"
+#include "Asset_Flash.h"
+
+static const char *const     Flash_Labels[2] = {ASSET_FLASH_LABEL_A, ASSET_FLASH_LABEL_B};
+static esp_partition_mmap_handle_t Flash_Handle;                // Of the mapped slot, valid while Flash_Stats.Mapped >= 0
+static Asset_Flash_Stats_t   Flash_Stats = {-1};
+
+// The update in progress, Flash_Target >= 0
+static const esp_partition_t *Flash_Part = NULL;
+static int8_t                Flash_Target = -1;
+static uint32_t              Flash_Size;
+static uint32_t              Flash_Written;
+static uint32_t              Flash_Crc;
+
+static const esp_partition_t *Flash_Partition(uint8_t Slot)
+{
+  return esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)ASSET_FLASH_SUBTYPE,
+                                  Flash_Labels[Slot]);
+}
+
+static uint32_t Flash_Header_Crc(const Asset_Flash_Slot_t *h)
+{
+  return esp_rom_crc32_le(0, (const uint8_t *)h, offsetof(Asset_Flash_Slot_t, Header_crc));
+}
+
+/********************************************************** Mapping **********************************************************/
+// Called by Asset_Pack_Close(), once nothing points into the map
+static void Flash_Unmap(void)
+{
+  esp_partition_munmap(Flash_Handle);
+  Flash_Stats.Mapped = -1;
+  Flash_Stats.Generation = 0;
+}
+
+static esp_err_t Flash_Map(uint8_t Slot, const Asset_Flash_Slot_t *h)
+{
+  const esp_partition_t *part = Flash_Partition(Slot);
+  const void *base;
+  esp_partition_mmap_handle_t handle;
+  esp_err_t err = esp_partition_mmap(part, 0, ASSET_FLASH_PACK_OFFSET + h->Pack_size, ESP_PARTITION_MMAP_DATA,
+                                     &base, &handle);
+  if (err != ESP_OK) {
+    printf("Asset flash: cannot map %s (%s)\r\n", part->label, esp_err_to_name(err));
+    return err;
+  }
+  err = Asset_Pack_Open_Mapped((const uint8_t *)base + ASSET_FLASH_PACK_OFFSET, h->Pack_size, part->label,
+                               Flash_Unmap);
+  if (err != ESP_OK) {
+    esp_partition_munmap(handle);
+    return err;
+  }
+  Flash_Handle = handle;
+  Flash_Stats.Mapped = (int8_t)Slot;
+  Flash_Stats.Generation = h->Generation;
+  return ESP_OK;
+}
+
+/********************************************************** Updates **********************************************************/
+// The slot an update may write: never the mapped one, and otherwise not the newest committed one
+static int8_t Flash_Spare_Slot(void)
+{
+  if (Flash_Stats.Mapped >= 0)
+    return (int8_t)(1 - Flash_Stats.Mapped);
+  Asset_Flash_Slot_t a, b;
+  bool has_a = Asset_Flash_Read_Slot(0, &a), has_b = Asset_Flash_Read_Slot(1, &b);
+  return has_a && (!has_b || (int32_t)(a.Generation - b.Generation) > 0) ? 1 : 0;
+}
+
+static esp_err_t Flash_Fail(const char *What, esp_err_t Err)
+{
+  printf("Asset flash: update of %s %s (%s)\r\n", Flash_Part ? Flash_Part->label : "?", What, esp_err_to_name(Err));
+  Flash_Stats.Failures++;
+  Asset_Flash_Update_Abort();
+  return Err;
+}
+
+/********************************************************** API **********************************************************/
+bool Asset_Flash_Read_Slot(uint8_t Slot, Asset_Flash_Slot_t *Header)
+{
+  const esp_partition_t *part = Slot < 2 ? Flash_Partition(Slot) : NULL;
+  return part && esp_partition_read(part, 0, Header, sizeof(*Header)) == ESP_OK && Header->Magic == ASSET_FLASH_MAGIC &&
+         Header->Header_crc == Flash_Header_Crc(Header) && Header->Pack_size <= part->size - ASSET_FLASH_PACK_OFFSET;
+}
+
+esp_err_t Asset_Flash_Mount(void)
+{
+  Asset_Flash_Slot_t h[2];
+  bool ok[2] = {Asset_Flash_Read_Slot(0, &h[0]), Asset_Flash_Read_Slot(1, &h[1])};
+  if (!ok[0] && !ok[1]) {
+    printf("Asset flash: %s\r\n", Flash_Partition(0) || Flash_Partition(1) ? "no pack committed" : "no asset partitions");
+    return ESP_ERR_NOT_FOUND;
+  }
+  int64_t t0 = esp_timer_get_time();
+  uint8_t first = ok[0] && (!ok[1] || (int32_t)(h[0].Generation - h[1].Generation) > 0) ? 0 : 1;
+  esp_err_t err = ESP_ERR_NOT_FOUND;
+  for (uint8_t k = 0; k < 2 && err != ESP_OK; k++) {            // The newest, then the other if that one is damaged
+    uint8_t slot = k ? 1 - first : first;
+    if (!ok[slot])
+      continue;
+    if (Flash_Stats.Mapped == slot && Flash_Stats.Generation == h[slot].Generation)
+      return ESP_OK;
+    err = Flash_Map(slot, &h[slot]);
+    if (err == ESP_ERR_INVALID_STATE)
+      return err;                                               // Held assets keep the open pack in place
+    if (err != ESP_OK)
+      Flash_Stats.Failures++;
+  }
+  if (err != ESP_OK)
+    return err;
+  Flash_Stats.Mounts++;
+  Flash_Stats.Map_us = (uint32_t)(esp_timer_get_time() - t0);
+  printf("Asset flash: %s, generation %lu, %lu KB mapped in %lu us\r\n", Flash_Labels[Flash_Stats.Mapped],
+         Flash_Stats.Generation, h[Flash_Stats.Mapped].Pack_size / 1024, Flash_Stats.Map_us);
+  return ESP_OK;
+}
+
+esp_err_t Asset_Flash_Update_Begin(uint32_t Size)
+{
+  Asset_Flash_Update_Abort();
+  int8_t slot = Flash_Spare_Slot();
+  Flash_Part = Flash_Partition((uint8_t)slot);
+  if (Flash_Part == NULL) {
+    printf("Asset flash: no partition %s\r\n", Flash_Labels[slot]);
+    return ESP_ERR_NOT_FOUND;
+  }
+  if (Size < sizeof(Asset_Pack_Header_t) || Size > Flash_Part->size - ASSET_FLASH_PACK_OFFSET) {
+    printf("Asset flash: a pack of %lu KB does not fit %s (%lu KB)\r\n", Size / 1024, Flash_Part->label,
+           (Flash_Part->size - ASSET_FLASH_PACK_OFFSET) / 1024);
+    Flash_Part = NULL;
+    return ESP_ERR_INVALID_SIZE;
+  }
+  Flash_Target = slot;
+  Flash_Size = Size;
+  Flash_Written = 0;
+  Flash_Crc = 0;
+
+  // The header's sector first: from here on the slot is uncommitted, whatever happens to the rest
+  int64_t t0 = esp_timer_get_time();
+  uint32_t span = (ASSET_FLASH_PACK_OFFSET + Size + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE;
+  esp_err_t err = esp_partition_erase_range(Flash_Part, 0, ASSET_FLASH_PACK_OFFSET);
+  if (err == ESP_OK)
+    err = esp_partition_erase_range(Flash_Part, ASSET_FLASH_PACK_OFFSET, span - ASSET_FLASH_PACK_OFFSET);
+  if (err != ESP_OK)
+    return Flash_Fail("not erased", err);
+  Flash_Stats.Erase_us = (uint32_t)(esp_timer_get_time() - t0);
+  Flash_Stats.Write_us = 0;
+  printf("Asset flash: %s erased for %lu KB in %lu ms\r\n", Flash_Part->label, Size / 1024,
+         Flash_Stats.Erase_us / 1000);
+  return ESP_OK;
+}
+
+esp_err_t Asset_Flash_Update_Write(const void *Data, uint32_t Length)
+{
+  if (Flash_Target < 0)
+    return ESP_ERR_INVALID_STATE;
+  if (Length > Flash_Size - Flash_Written)
+    return Flash_Fail("overran its size", ESP_ERR_INVALID_SIZE);
+  int64_t t0 = esp_timer_get_time();
+  esp_err_t err = esp_partition_write(Flash_Part, ASSET_FLASH_PACK_OFFSET + Flash_Written, Data, Length);
+  if (err != ESP_OK)
+    return Flash_Fail("not written", err);
+  Flash_Crc = esp_rom_crc32_le(Flash_Crc, (const uint8_t *)Data, Length);
+  Flash_Written += Length;
+  Flash_Stats.Written += Length;
+  Flash_Stats.Write_us += (uint32_t)(esp_timer_get_time() - t0);
+  return ESP_OK;
+}
+
+esp_err_t Asset_Flash_Update_End(void)
+{
+  if (Flash_Target < 0)
+    return ESP_ERR_INVALID_STATE;
+  if (Flash_Written != Flash_Size)
+    return Flash_Fail("ended early", ESP_ERR_INVALID_SIZE);
+
+  // What the flash holds now, against what was sent, and the pack's own header
+  int64_t t0 = esp_timer_get_time();
+  uint8_t *buf = (uint8_t *)malloc(ASSET_FLASH_CHUNK);
+  if (buf == NULL)
+    return Flash_Fail("not checked", ESP_ERR_NO_MEM);
+  uint32_t crc = 0;
+  esp_err_t err = ESP_OK;
+  for (uint32_t done = 0; done < Flash_Size && err == ESP_OK; ) {
+    uint32_t n = Flash_Size - done < ASSET_FLASH_CHUNK ? Flash_Size - done : ASSET_FLASH_CHUNK;
+    err = esp_partition_read(Flash_Part, ASSET_FLASH_PACK_OFFSET + done, buf, n);
+    crc = esp_rom_crc32_le(crc, buf, n);
+    done += n;
+  }
+  Asset_Pack_Header_t pack;
+  if (err == ESP_OK)
+    err = esp_partition_read(Flash_Part, ASSET_FLASH_PACK_OFFSET, &pack, sizeof(pack));
+  free(buf);
+  if (err != ESP_OK)
+    return Flash_Fail("not read back", err);
+  if (crc != Flash_Crc)
+    return Flash_Fail("read back wrong", ESP_ERR_INVALID_CRC);
+  if (pack.Magic != ASSET_PACK_MAGIC || pack.Version != ASSET_PACK_VERSION || pack.File_size != Flash_Size)
+    return Flash_Fail("is not a pack of this version", ESP_ERR_INVALID_VERSION);
+  Flash_Stats.Verify_us = (uint32_t)(esp_timer_get_time() - t0);
+
+  // The commit: one header write into the erased sector
+  Asset_Flash_Slot_t other, h = {};
+  h.Magic = ASSET_FLASH_MAGIC;
+  h.Generation = (Asset_Flash_Read_Slot((uint8_t)(1 - Flash_Target), &other) ? other.Generation : 0) + 1;
+  h.Pack_size = Flash_Size;
+  h.Pack_crc = Flash_Crc;
+  h.Header_crc = Flash_Header_Crc(&h);
+  err = esp_partition_write(Flash_Part, 0, &h, sizeof(h));
+  Asset_Flash_Slot_t check;
+  if (err == ESP_OK && (!Asset_Flash_Read_Slot((uint8_t)Flash_Target, &check) || memcmp(&check, &h, sizeof(h))))
+    err = ESP_ERR_INVALID_CRC;
+  if (err != ESP_OK)
+    return Flash_Fail("not committed", err);
+  Flash_Stats.Updates++;
+  printf("Asset flash: %s committed, generation %lu, %lu KB written in %lu ms, checked in %lu ms\r\n",
+         Flash_Part->label, h.Generation, Flash_Size / 1024, Flash_Stats.Write_us / 1000, Flash_Stats.Verify_us / 1000);
+  Flash_Target = -1;
+  Flash_Part = NULL;
+  return ESP_OK;
+}
+
+void Asset_Flash_Update_Abort(void)
+{
+  Flash_Target = -1;
+  Flash_Part = NULL;
+}
+
+esp_err_t Asset_Flash_Update_From_File(const char *Path)
+{
+  FILE *f = fopen(Path, "rb");
+  if (f == NULL)
+    return ESP_ERR_NOT_FOUND;
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  uint8_t *buf = (uint8_t *)malloc(ASSET_FLASH_CHUNK);
+  esp_err_t err = buf == NULL ? ESP_ERR_NO_MEM : size < 0 ? ESP_FAIL : Asset_Flash_Update_Begin((uint32_t)size);
+  for (long done = 0; err == ESP_OK && done < size; ) {
+    size_t n = fread(buf, 1, size - done < ASSET_FLASH_CHUNK ? size - done : ASSET_FLASH_CHUNK, f);
+    if (n == 0) {
+      err = Flash_Fail("not read from the card", ESP_FAIL);
+      break;
+    }
+    err = Asset_Flash_Update_Write(buf, (uint32_t)n);
+    done += n;
+  }
+  if (err == ESP_OK)
+    err = Asset_Flash_Update_End();
+  free(buf);
+  fclose(f);
+  return err;
+}
+
+void Asset_Flash_Get_Stats(Asset_Flash_Stats_t *stats)
+{
+  *stats = Flash_Stats;
+}
+
+void Asset_Flash_Print(void)
+{
+  for (uint8_t slot = 0; slot < 2; slot++) {
+    const esp_partition_t *part = Flash_Partition(slot);
+    Asset_Flash_Slot_t h;
+    if (part == NULL) {
+      printf("Asset flash: no partition %s\r\n", Flash_Labels[slot]);
+    } else if (Asset_Flash_Read_Slot(slot, &h)) {
+      printf("Asset flash: %s at 0x%06lX, %lu KB, generation %lu, pack %lu KB, CRC %08lX%s\r\n", part->label,
+             part->address, part->size / 1024, h.Generation, h.Pack_size / 1024, h.Pack_crc,
+             Flash_Stats.Mapped == slot ? ", mapped" : "");
+    } else {
+      printf("Asset flash: %s at 0x%06lX, %lu KB, not committed\r\n", part->label, part->address, part->size / 1024);
+    }
+  }
+  const Asset_Flash_Stats_t *st = &Flash_Stats;
+  printf("Asset flash: %lu mounts, last %lu us; %lu updates, %llu KB written, last erased in %lu ms, written in "
+         "%lu ms, checked in %lu ms; %lu failures\r\n", st->Mounts, st->Map_us, st->Updates, st->Written / 1024,
+         st->Erase_us / 1000, st->Write_us / 1000, st->Verify_us / 1000, st->Failures);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/****************************************************** Asset partitions ******************************************************/
+// The asset pack of src/Asset_Pack.h kept in flash and mapped into the address space with esp_partition_mmap(),
+// rather than read from the card: images stored uncompressed draw straight from flash, fonts are read from it through
+// P:, and no PSRAM holds a copy of either. Assets no longer have to be compiled into the app, nor wait for the card.
+// Two data partitions (partitions_assets.csv), A/B like the app's OTA slots. Each is a slot header in its first
+// sector, then the pack (tools/asset_pack.py partition builds one for esptool). An update goes into the slot not in
+// use: erased, written as the data comes (Begin/Write/End, like esp_ota_*), read back, and only then committed by
+// writing its header with the next generation. A power cut or a bad pack leaves the previous one in use; the app is
+// not involved, and neither is otadata.
+// Flash is written with the caches off, which stalls the other core and can make the RGB panel drift; main.cpp
+// updates before LVGL starts drawing.
+#define ASSET_FLASH_SUBTYPE      0x40                     // Custom data subtype of both slots
+#define ASSET_FLASH_LABEL_A      "assets0"
+#define ASSET_FLASH_LABEL_B      "assets1"
+#define ASSET_FLASH_MAGIC        0x544C5341               // "ASLT"
+#define ASSET_FLASH_PACK_OFFSET  0x1000                   // The slot header's sector, then the pack
+#define ASSET_FLASH_CHUNK        4096                     // Bytes per read when updating from a file and checking
+#define ASSET_FLASH_UPDATE_PATH  "/sdcard/assets_update.pak" // main.cpp flashes it at boot, then renames it .done, or
+                                                          // .bad if that failed
+
+typedef struct {
+  uint32_t Magic;
+  uint32_t Generation;                                    // The committed slot with the highest one is mapped
+  uint32_t Pack_size;
+  uint32_t Pack_crc;                                      // CRC-32 of the pack, as zlib.crc32()
+  uint32_t Reserved[3];
+  uint32_t Header_crc;                                    // Of the fields above
+} Asset_Flash_Slot_t;
+
+typedef struct {
+  int8_t   Mapped;                                        // Slot in use, 0 or 1; -1: none
+  uint32_t Generation;                                    // Of that slot
+  uint32_t Mounts;
+  uint32_t Updates;                                       // Committed
+  uint32_t Failures;                                      // Flash errors, size or CRC mismatches, bad packs
+  uint64_t Written;
+  uint32_t Map_us;                                        // Last mount: mapping and checking the index
+  uint32_t Erase_us;                                      // Last update
+  uint32_t Write_us;
+  uint32_t Verify_us;
+} Asset_Flash_Stats_t;
+
+esp_err_t Asset_Flash_Mount(void);                        // After Lvgl_FS_Init(): maps the newest committed pack that
+                                                          // opens, through Asset_Pack_Open_Mapped(). ESP_ERR_NOT_FOUND:
+                                                          // no asset partitions or none committed.
+                                                          // ESP_ERR_INVALID_STATE: assets of the open pack are held
+esp_err_t Asset_Flash_Update_Begin(uint32_t Size);        // A pack of Size bytes into the slot not in use, erased here.
+                                                          // ESP_ERR_INVALID_SIZE: larger than the slot
+esp_err_t Asset_Flash_Update_Write(const void *Data, uint32_t Length); // The pack's bytes in order, any lengths
+esp_err_t Asset_Flash_Update_End(void);                   // Reads the slot back and commits it; mapped from the next
+                                                          // Asset_Flash_Mount(). ESP_ERR_INVALID_CRC: read back wrong
+void      Asset_Flash_Update_Abort(void);                 // The slot stays uncommitted
+esp_err_t Asset_Flash_Update_From_File(const char *Path); // Begin, Write and End from a pack file.
+                                                          // ESP_ERR_NOT_FOUND: no such file
+bool      Asset_Flash_Read_Slot(uint8_t Slot, Asset_Flash_Slot_t *Header); // false: no partition or not committed
+void      Asset_Flash_Get_Stats(Asset_Flash_Stats_t *stats);
+void      Asset_Flash_Print(void);
@@ -0,0 +1,490 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "SD_Cache.h"
+#include "Asset_Pack.h"
+
+#if LV_USE_LZ4_EXTERNAL
+  #include <lz4.h>
+#elif LV_USE_LZ4_INTERNAL
+  #include "src/libs/lz4/lz4.h"  // lib/lvgl is on the include path, see <demos/lv_demos.h>
+#endif
+
+typedef struct {
+  uint8_t       *Data;                                          // PSRAM, the unpacked blob, or the blob in a mapped
+                                                                // pack. NULL: not loaded
+  uint32_t       Used;                                          // Pack_Clock at the last lookup, for LRU
+  uint16_t       Refs;                                          // Images handed out and file handles open
+  lv_image_dsc_t Image;                                         // Points into Data, for images
+} Pack_Slot_t;
+
+typedef struct {
+  uint32_t Index;
+  uint32_t Pos;
+  bool     Card;                                                // Read from the pack file at the blob, not loaded
+} Pack_File_t;
+
+static SD_Cache_File_t     *Pack_File = NULL;                   // A pack on the card, or
+static const uint8_t       *Pack_Map = NULL;                    // one mapped into the address space
+static void               (*Pack_Unmap)(void) = NULL;
+static char                 Pack_Path[128];
+static Asset_Pack_Header_t  Pack_Header;
+static const Asset_Pack_Entry_t *Pack_Index = NULL;             // Followed by the names, one allocation, or in the map
+static const char          *Pack_Names = NULL;
+static Pack_Slot_t         *Pack_Slots = NULL;
+static uint32_t             Pack_Clock = 0;
+static Asset_Pack_Stats_t   Pack_Stats;
+static lv_fs_drv_t          Pack_Drv;
+
+static void *Pack_Alloc(size_t Size)
+{
+  void *p = heap_caps_malloc(Size, MALLOC_CAP_SPIRAM);
+  return p ? p : malloc(Size);
+}
+
+/********************************************************** Index **********************************************************/
+// Index of Name, -1 if it is not in the pack
+static int32_t Pack_Find(const char *Name)
+{
+  if (Pack_Index == NULL || Name == NULL)
+    return -1;
+  Pack_Stats.Lookups++;
+  int32_t lo = 0, hi = (int32_t)Pack_Header.Count - 1;
+  while (lo <= hi) {
+    int32_t mid = lo + (hi - lo) / 2;
+    int c = strcmp(Name, Pack_Names + Pack_Index[mid].Name);
+    if (c == 0)
+      return mid;
+    if (c < 0)
+      hi = mid - 1;
+    else
+      lo = mid + 1;
+  }
+  Pack_Stats.Not_found++;
+  return -1;
+}
+
+// Everything Pack_Find() and Pack_Load() rely on, so a damaged file is refused at open rather than read out of bounds
+static bool Pack_Check_Index(uint32_t Names_end)
+{
+  if (Pack_Header.Names_size == 0 || Pack_Names[Pack_Header.Names_size - 1] != '\0')
+    return false;
+  for (uint32_t i = 0; i < Pack_Header.Count; i++) {
+    const Asset_Pack_Entry_t *e = &Pack_Index[i];
+    if (e->Name >= Pack_Header.Names_size || e->Offset < Names_end || e->Offset > Pack_Header.File_size ||
+        e->Stored > Pack_Header.File_size - e->Offset || e->Compression > ASSET_PACK_LZ4 ||
+        (e->Compression == ASSET_PACK_STORED && e->Stored != e->Size))
+      return false;
+    if (e->Type == ASSET_PACK_TYPE_IMAGE && e->Size < sizeof(lv_image_header_t))
+      return false;
+    if (i > 0 && strcmp(Pack_Names + Pack_Index[i - 1].Name, Pack_Names + e->Name) >= 0)
+      return false;
+  }
+  return true;
+}
+
+/********************************************************** Cache **********************************************************/
+// Stored blobs of a mapped pack are used where they are: no copy, nothing to evict
+static bool Pack_In_Place(uint32_t i)
+{
+  return Pack_Map && Pack_Index[i].Compression == ASSET_PACK_STORED;
+}
+
+static void Pack_Evict(uint32_t i)
+{
+  Pack_Slot_t *s = &Pack_Slots[i];
+  if (Pack_Index[i].Type == ASSET_PACK_TYPE_IMAGE)
+    lv_image_cache_drop(&s->Image);                             // LVGL may have cached the image by its descriptor
+  if (!Pack_In_Place(i)) {
+    free(s->Data);
+    Pack_Stats.Resident -= Pack_Index[i].Size;
+    Pack_Stats.Evictions++;
+  }
+  s->Data = NULL;
+}
+
+// Evicts unheld assets, least recently used first, until Size more bytes fit
+static bool Pack_Make_Room(uint32_t Size)
+{
+  if (Size > ASSET_PACK_CACHE_SIZE)
+    return false;
+  while (Pack_Stats.Resident + Size > ASSET_PACK_CACHE_SIZE) {
+    int32_t lru = -1;
+    for (uint32_t i = 0; i < Pack_Header.Count; i++) {
+      const Pack_Slot_t *s = &Pack_Slots[i];
+      if (s->Data && s->Refs == 0 && !Pack_In_Place(i) && (lru < 0 || (int32_t)(s->Used - Pack_Slots[lru].Used) < 0))
+        lru = (int32_t)i;
+    }
+    if (lru < 0)
+      return false;
+    Pack_Evict((uint32_t)lru);
+  }
+  return true;
+}
+
+static bool Pack_Read(uint32_t Offset, void *Buf, uint32_t Length)
+{
+  SD_Cache_Seek(Pack_File, Offset);
+  Pack_Stats.Card_bytes += Length;
+  return SD_Cache_Read(Pack_File, Buf, Length) == (int32_t)Length;
+}
+
+// The descriptor of an image blob, pointing into it
+static bool Pack_Describe(Pack_Slot_t *s, const uint8_t *Data, uint32_t Size)
+{
+  memset(&s->Image, 0, sizeof(s->Image));
+  memcpy(&s->Image.header, Data, sizeof(lv_image_header_t));
+  s->Image.data = Data + sizeof(lv_image_header_t);
+  s->Image.data_size = Size - sizeof(lv_image_header_t);
+  return s->Image.header.magic == LV_IMAGE_HEADER_MAGIC;
+}
+
+// Makes entry i resident and counts it as used now
+static bool Pack_Load(uint32_t i)
+{
+  const Asset_Pack_Entry_t *e = &Pack_Index[i];
+  Pack_Slot_t *s = &Pack_Slots[i];
+  s->Used = ++Pack_Clock;
+  if (s->Data) {
+    Pack_Stats.Hits++;
+    return true;
+  }
+  const char *name = Pack_Names + e->Name;
+  if (Pack_In_Place(i)) {
+    uint8_t *blob = (uint8_t *)(Pack_Map + e->Offset);          // Only ever read through
+    if (e->Type == ASSET_PACK_TYPE_IMAGE && !Pack_Describe(s, blob, e->Size)) {
+      printf("Asset pack: cannot load %s\r\n", name);
+      Pack_Stats.Failures++;
+      return false;
+    }
+    s->Data = blob;
+    Pack_Stats.In_place++;
+    return true;
+  }
+  if (!Pack_Make_Room(e->Size)) {
+    printf("Asset pack: no room for %s (%lu bytes, %lu in use)\r\n", name, e->Size, Pack_Stats.Resident);
+    Pack_Stats.Failures++;
+    return false;
+  }
+  int64_t t0 = esp_timer_get_time();
+  uint8_t *data = (uint8_t *)Pack_Alloc(e->Size ? e->Size : 1);
+  bool ok = data != NULL;
+  if (ok && e->Compression == ASSET_PACK_STORED) {
+    ok = Pack_Read(e->Offset, data, e->Size);
+  } else if (ok) {
+#if LV_USE_LZ4
+    uint8_t *packed = Pack_Map ? NULL : (uint8_t *)Pack_Alloc(e->Stored ? e->Stored : 1);
+    const uint8_t *in = Pack_Map ? Pack_Map + e->Offset : packed;   // A mapped pack is unpacked straight from flash
+    ok = in && (Pack_Map || Pack_Read(e->Offset, packed, e->Stored)) &&
+         LZ4_decompress_safe((const char *)in, (char *)data, (int)e->Stored, (int)e->Size) == (int)e->Size;
+    free(packed);
+    Pack_Stats.Unpacked++;
+#else
+    printf("Asset pack: %s is LZ4 compressed, enable LV_USE_LZ4_INTERNAL in lv_conf.h or pack without --lz4\r\n",
+           name);
+    ok = false;
+#endif
+  }
+  if (ok && e->Type == ASSET_PACK_TYPE_IMAGE)
+    ok = Pack_Describe(s, data, e->Size);
+  if (!ok) {
+    printf("Asset pack: cannot load %s\r\n", name);
+    free(data);
+    Pack_Stats.Failures++;
+    return false;
+  }
+  s->Data = data;
+  Pack_Stats.Loads++;
+  Pack_Stats.Load_us += esp_timer_get_time() - t0;
+  Pack_Stats.Resident += e->Size;
+  if (Pack_Stats.Resident > Pack_Stats.Peak)
+    Pack_Stats.Peak = Pack_Stats.Resident;
+  return true;
+}
+
+/********************************************************** File system **********************************************************/
+// Any entry as a read-only file on ASSET_PACK_LETTER. lv_binfont_create() reads fonts this way, so it needs neither
+// LV_USE_FS_MEMFS nor a second copy of the blob. A stored blob of a pack on the card that is not resident is read
+// from the pack file through SD_Cache, so a reader that only wants part of it (src/Paged_Font.h) does not load it
+// all; a mapped pack's stored blobs are read straight out of flash, LZ4 ones from their unpacked copy in PSRAM.
+// An open file holds its entry, and the pack open, like an image handed out.
+static void *Pack_Fs_Open(lv_fs_drv_t *drv, const char *path, lv_fs_mode_t mode)
+{
+  if (mode & LV_FS_MODE_WR)
+    return NULL;
+  int32_t i = Pack_Find(path[0] == '/' ? path + 1 : path);
+  if (i < 0)
+    return NULL;
+  bool card = Pack_File && Pack_Index[i].Compression == ASSET_PACK_STORED && Pack_Slots[i].Data == NULL;
+  if (!card && !Pack_Load((uint32_t)i))
+    return NULL;
+  Pack_File_t *f = (Pack_File_t *)malloc(sizeof(Pack_File_t));
+  if (f == NULL)
+    return NULL;
+  f->Index = (uint32_t)i;
+  f->Pos = 0;
+  f->Card = card;
+  Pack_Slots[i].Refs++;
+  return f;
+}
+
+static lv_fs_res_t Pack_Fs_Close(lv_fs_drv_t *drv, void *file_p)
+{
+  Pack_File_t *f = (Pack_File_t *)file_p;
+  Pack_Slots[f->Index].Refs--;
+  free(f);
+  return LV_FS_RES_OK;
+}
+
+static lv_fs_res_t Pack_Fs_Read(lv_fs_drv_t *drv, void *file_p, void *buf, uint32_t btr, uint32_t *br)
+{
+  Pack_File_t *f = (Pack_File_t *)file_p;
+  uint32_t size = Pack_Index[f->Index].Size;
+  uint32_t n = f->Pos >= size ? 0 : (btr < size - f->Pos ? btr : size - f->Pos);
+  *br = 0;
+  if (f->Card && n && !Pack_Read(Pack_Index[f->Index].Offset + f->Pos, buf, n))
+    return LV_FS_RES_HW_ERR;
+  if (!f->Card)
+    memcpy(buf, Pack_Slots[f->Index].Data + f->Pos, n);
+  f->Pos += n;
+  *br = n;
+  return LV_FS_RES_OK;
+}
+
+static lv_fs_res_t Pack_Fs_Seek(lv_fs_drv_t *drv, void *file_p, uint32_t pos, lv_fs_whence_t whence)
+{
+  Pack_File_t *f = (Pack_File_t *)file_p;
+  if (whence == LV_FS_SEEK_CUR)
+    pos += f->Pos;
+  else if (whence == LV_FS_SEEK_END)
+    pos += Pack_Index[f->Index].Size;
+  f->Pos = pos;
+  return LV_FS_RES_OK;
+}
+
+static lv_fs_res_t Pack_Fs_Tell(lv_fs_drv_t *drv, void *file_p, uint32_t *pos_p)
+{
+  *pos_p = ((Pack_File_t *)file_p)->Pos;
+  return LV_FS_RES_OK;
+}
+
+/********************************************************** API **********************************************************/
+static bool Pack_Header_Ok(const Asset_Pack_Header_t *h, uint32_t Size)
+{
+  return h->Magic == ASSET_PACK_MAGIC && h->Version == ASSET_PACK_VERSION && h->File_size == Size &&
+         h->Count <= (h->File_size - sizeof(*h)) / sizeof(Asset_Pack_Entry_t) && h->Names_size <= h->File_size;
+}
+
+static void Pack_Register_Drv(void)
+{
+  if (Pack_Drv.letter)
+    return;
+  lv_fs_drv_init(&Pack_Drv);
+  Pack_Drv.letter = ASSET_PACK_LETTER;
+  Pack_Drv.cache_size = 0;
+  Pack_Drv.open_cb = Pack_Fs_Open;
+  Pack_Drv.close_cb = Pack_Fs_Close;
+  Pack_Drv.read_cb = Pack_Fs_Read;
+  Pack_Drv.seek_cb = Pack_Fs_Seek;
+  Pack_Drv.tell_cb = Pack_Fs_Tell;
+  lv_fs_drv_register(&Pack_Drv);
+}
+
+esp_err_t Asset_Pack_Open(const char *Path)
+{
+  Asset_Pack_Close();
+  if (Pack_File || Pack_Map)
+    return ESP_ERR_INVALID_STATE;
+  if (SD_Cache_Init() != ESP_OK)
+    return ESP_ERR_NO_MEM;
+  SD_Cache_File_t *f = SD_Cache_Open(Path);
+  if (f == NULL) {
+    printf("Asset pack: %s not found\r\n", Path);
+    return ESP_ERR_NOT_FOUND;
+  }
+  Pack_File = f;
+  snprintf(Pack_Path, sizeof(Pack_Path), "%s", Path);
+  Asset_Pack_Header_t *h = &Pack_Header;
+  if (!Pack_Read(0, h, sizeof(*h)) || !Pack_Header_Ok(h, SD_Cache_Size(f))) {
+    printf("Asset pack: %s is not a version %d pack\r\n", Path, ASSET_PACK_VERSION);
+    SD_Cache_Close(f);
+    Pack_File = NULL;
+    return ESP_ERR_INVALID_VERSION;
+  }
+
+  // The index and the names in one read; lookups never touch the card after this
+  uint32_t index_size = h->Count * sizeof(Asset_Pack_Entry_t);
+  uint32_t names_end = sizeof(*h) + index_size + h->Names_size;
+  Asset_Pack_Entry_t *index = (Asset_Pack_Entry_t *)Pack_Alloc(index_size + h->Names_size);
+  Pack_Index = index;
+  Pack_Slots = (Pack_Slot_t *)calloc(h->Count ? h->Count : 1, sizeof(Pack_Slot_t));
+  if (Pack_Index == NULL || Pack_Slots == NULL) {
+    printf("Asset pack: no memory for %lu entries\r\n", h->Count);
+    Asset_Pack_Close();
+    return ESP_ERR_NO_MEM;
+  }
+  Pack_Names = (const char *)Pack_Index + index_size;
+  if (names_end > h->File_size || !Pack_Read(sizeof(*h), index, index_size + h->Names_size) ||
+      !Pack_Check_Index(names_end)) {
+    printf("Asset pack: %s has a damaged index\r\n", Path);
+    Asset_Pack_Close();
+    return ESP_ERR_INVALID_CRC;
+  }
+  Pack_Register_Drv();
+  printf("Asset pack: %s, %lu assets, %lu KB\r\n", Path, h->Count, h->File_size / 1024);
+  return ESP_OK;
+}
+
+esp_err_t Asset_Pack_Open_Mapped(const void *Data, uint32_t Size, const char *Name, void (*Unmap)(void))
+{
+  Asset_Pack_Close();
+  if (Pack_File || Pack_Map)
+    return ESP_ERR_INVALID_STATE;
+  const Asset_Pack_Header_t *h = (const Asset_Pack_Header_t *)Data;
+  if (Size < sizeof(*h) || ((uintptr_t)Data & 3) || !Pack_Header_Ok(h, Size)) {
+    printf("Asset pack: %s is not a version %d pack\r\n", Name, ASSET_PACK_VERSION);
+    return ESP_ERR_INVALID_VERSION;
+  }
+  Pack_Map = (const uint8_t *)Data;
+  Pack_Header = *h;
+  snprintf(Pack_Path, sizeof(Pack_Path), "%s", Name);
+
+  // Index and names are used where they are mapped; only the slots are allocated
+  uint32_t index_size = h->Count * sizeof(Asset_Pack_Entry_t);
+  uint32_t names_end = sizeof(*h) + index_size + h->Names_size;
+  Pack_Index = (const Asset_Pack_Entry_t *)(Pack_Map + sizeof(*h));
+  Pack_Names = (const char *)Pack_Index + index_size;
+  Pack_Slots = (Pack_Slot_t *)calloc(h->Count ? h->Count : 1, sizeof(Pack_Slot_t));
+  if (Pack_Slots == NULL) {
+    printf("Asset pack: no memory for %lu entries\r\n", h->Count);
+    Asset_Pack_Close();
+    return ESP_ERR_NO_MEM;
+  }
+  if (names_end > h->File_size || !Pack_Check_Index(names_end)) {
+    printf("Asset pack: %s has a damaged index\r\n", Name);
+    Asset_Pack_Close();
+    return ESP_ERR_INVALID_CRC;
+  }
+  Pack_Unmap = Unmap;                                           // Only once open: a refused map stays the caller's
+  Pack_Register_Drv();
+  printf("Asset pack: %s, %lu assets, %lu KB, mapped\r\n", Name, h->Count, h->File_size / 1024);
+  return ESP_OK;
+}
+
+void Asset_Pack_Close(void)
+{
+  if (Pack_File == NULL && Pack_Map == NULL)
+    return;
+  for (uint32_t i = 0; Pack_Slots && i < Pack_Header.Count; i++) {
+    if (Pack_Slots[i].Refs) {
+      printf("Asset pack: %s is still in use, not closing\r\n", Pack_Names + Pack_Index[i].Name);
+      return;
+    }
+  }
+  for (uint32_t i = 0; Pack_Slots && i < Pack_Header.Count; i++) {
+    if (Pack_Slots[i].Data)
+      Pack_Evict(i);
+  }
+  free(Pack_Slots);
+  if (Pack_Map == NULL)
+    free((void *)Pack_Index);
+  Pack_Slots = NULL;
+  Pack_Index = NULL;
+  Pack_Names = NULL;
+  if (Pack_File)
+    SD_Cache_Close(Pack_File);
+  Pack_File = NULL;
+  Pack_Map = NULL;
+  if (Pack_Unmap)
+    Pack_Unmap();                                               // Nothing points into the map any more
+  Pack_Unmap = NULL;
+}
+
+uint32_t Asset_Pack_Count(void)
+{
+  return Pack_Index ? Pack_Header.Count : 0;
+}
+
+const lv_image_dsc_t *Asset_Pack_Image(const char *Name)
+{
+  int32_t i = Pack_Find(Name);
+  if (i < 0 || Pack_Index[i].Type != ASSET_PACK_TYPE_IMAGE || !Pack_Load((uint32_t)i))
+    return NULL;
+  Pack_Slots[i].Refs++;
+  return &Pack_Slots[i].Image;
+}
+
+bool Asset_Pack_Release(const lv_image_dsc_t *Image)
+{
+  if (Image == NULL || Pack_Slots == NULL)
+    return false;
+  const uint8_t *p = (const uint8_t *)Image;                    // Compared as addresses, no slot is formed from it
+  if (p < (const uint8_t *)Pack_Slots || p >= (const uint8_t *)(Pack_Slots + Pack_Header.Count))
+    return false;
+  Pack_Slot_t *s = &Pack_Slots[(p - (const uint8_t *)Pack_Slots) / sizeof(Pack_Slot_t)];
+  if (Image != &s->Image)
+    return false;
+  if (s->Refs)
+    s->Refs--;
+  return true;
+}
+
+bool Asset_Pack_Locate(const char *Name, const char **Path, uint32_t *Offset, uint32_t *Length)
+{
+  int32_t i = Pack_Find(Name);
+  if (i < 0)
+    return false;
+  *Path = Pack_Map ? NULL : Pack_Path;
+  *Offset = Pack_Index[i].Offset;
+  *Length = Pack_Slots[i].Data || Pack_Map ? 0 : Pack_Index[i].Stored;
+  return true;
+}
+
+const void *Asset_Pack_Mapped(const char *Name, uint32_t *Size)
+{
+  int32_t i = Pack_Find(Name);
+  if (i < 0 || !Pack_In_Place((uint32_t)i))
+    return NULL;
+  *Size = Pack_Index[i].Size;
+  return Pack_Map + Pack_Index[i].Offset;
+}
+
+lv_font_t *Asset_Pack_Font(const char *Name)
+{
+  char path[128];
+  snprintf(path, sizeof(path), "%c:%s", ASSET_PACK_LETTER, Name);
+  return Pack_Index ? lv_binfont_create(path) : NULL;       // Through Pack_Fs_Open(), from PSRAM or the map
+}
+
+void Asset_Pack_Get_Stats(Asset_Pack_Stats_t *stats)
+{
+  *stats = Pack_Stats;
+}
+
+void Asset_Pack_Print(void)
+{
+  static const char *Types[] = {"?", "image", "font", "raw"};
+  if (Pack_Index == NULL) {
+    printf("Asset pack: not open\r\n");
+    return;
+  }
+  printf("Asset pack: %s, %lu assets, %lu KB, blobs aligned to %u%s\r\n", Pack_Path, Pack_Header.Count,
+         Pack_Header.File_size / 1024, Pack_Header.Align, Pack_Map ? ", mapped" : "");
+  for (uint32_t i = 0; i < Pack_Header.Count; i++) {
+    const Asset_Pack_Entry_t *e = &Pack_Index[i];
+    const Pack_Slot_t *s = &Pack_Slots[i];
+    char info[24] = "";
+    if (e->Type == ASSET_PACK_TYPE_IMAGE && s->Data)
+      snprintf(info, sizeof(info), "%ux%u cf %02X", s->Image.header.w, s->Image.header.h, s->Image.header.cf);
+    printf("  %-40s %-5s %8lu %8lu%s %-14s%s\r\n", Pack_Names + e->Name, Types[e->Type <= 3 ? e->Type : 0], e->Size,
+           e->Stored, e->Compression == ASSET_PACK_LZ4 ? " lz4" : "    ", info,
+           s->Data ? (Pack_In_Place(i) ? " in place" : s->Refs ? " held" : " resident") : "");
+  }
+  const Asset_Pack_Stats_t *st = &Pack_Stats;
+  printf("Asset pack: %lu lookups (%lu not found), %lu hits, %lu in place, %lu loads (%lu unpacked) %llu KB in "
+         "%llu ms, %lu evictions, %lu failures, %lu/%d KB resident, peak %lu KB\r\n",
+         st->Lookups, st->Not_found, st->Hits, st->In_place, st->Loads, st->Unpacked, st->Card_bytes / 1024,
+         st->Load_us / 1000, st->Evictions, st->Failures, st->Resident / 1024, ASSET_PACK_CACHE_SIZE / 1024, st->Peak / 1024);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <lvgl.h>
+#include "esp_err.h"
+
+/****************************************************** Asset pack ******************************************************/
+// LVGL images and binary fonts in one file on the card, built on the host by tools/asset_pack.py. The pack starts
+// with an index sorted by name, read once by Asset_Pack_Open(); a lookup is a binary search in RAM, not an open() and
+// a directory scan on the card. Blobs are stored ready to use (LVGL image header and pixels in the display's color
+// format, binary fonts as lv_font_conv writes them), aligned, optionally LZ4 compressed. A looked-up asset is loaded
+// into PSRAM, unpacked there, and stays until the cache needs the room and nobody holds it. Blob reads go through
+// SD_Cache; a stored blob opened as a file on ASSET_PACK_LETTER is read from the card as the reader asks for it,
+// unless it is resident already. A pack mapped into the address space (src/Asset_Flash.h) is used in place instead:
+// its index, and every blob stored uncompressed, are read where they are mapped, so images draw straight from flash
+// and take no PSRAM; only its LZ4 blobs are unpacked into the cache. LVGL context only.
+#define ASSET_PACK_PATH          "/sdcard/assets.pak"
+#define ASSET_PACK_CACHE_SIZE    (2 * 1024 * 1024)        // PSRAM for unpacked assets, least recently used evicted first
+#define ASSET_PACK_LETTER        'P'                      // "P:fonts/roboto_24" reads that entry as a file
+#define ASSET_PACK_MAGIC         0x4B415041               // "APAK"
+#define ASSET_PACK_VERSION       1
+
+#define ASSET_PACK_TYPE_IMAGE    1                        // lv_image_header_t, then the pixel data
+#define ASSET_PACK_TYPE_FONT     2                        // lv_binfont_create() input
+#define ASSET_PACK_TYPE_RAW      3
+#define ASSET_PACK_STORED        0
+#define ASSET_PACK_LZ4           1                        // One LZ4 block; needs LV_USE_LZ4 in lv_conf.h
+
+// On the card, little-endian: the header, the index sorted by name (strcmp() order), the NUL-terminated names,
+// then the blobs, each starting on a multiple of Align
+typedef struct {
+  uint32_t Magic;
+  uint16_t Version;
+  uint16_t Align;
+  uint32_t Count;                                         // Index entries
+  uint32_t Names_size;
+  uint32_t Data_offset;                                   // First blob
+  uint32_t File_size;
+  uint32_t Reserved[2];
+} Asset_Pack_Header_t;
+
+typedef struct {
+  uint32_t Name;                                          // Offset into the names
+  uint32_t Offset;                                        // Of the blob in the file
+  uint32_t Stored;                                        // Bytes in the file
+  uint32_t Size;                                          // Bytes unpacked
+  uint8_t  Type;                                          // ASSET_PACK_TYPE_*
+  uint8_t  Compression;                                   // ASSET_PACK_STORED or ASSET_PACK_LZ4
+  uint16_t Reserved;
+  uint32_t Crc;                                           // CRC-32 of the unpacked blob, for tools/asset_pack.py verify
+} Asset_Pack_Entry_t;
+
+typedef struct {
+  uint32_t Lookups;
+  uint32_t Not_found;
+  uint32_t Hits;                                          // Already in PSRAM
+  uint32_t In_place;                                      // Used where a mapped pack has them, no copy
+  uint32_t Loads;                                         // Read from the card
+  uint32_t Unpacked;                                      // Of those, LZ4
+  uint32_t Evictions;
+  uint32_t Failures;                                      // Card errors, bad blobs, no room
+  uint64_t Card_bytes;
+  uint64_t Load_us;                                       // Reading and unpacking
+  uint32_t Resident;                                      // Bytes of PSRAM in use now
+  uint32_t Peak;
+} Asset_Pack_Stats_t;
+
+esp_err_t             Asset_Pack_Open(const char *Path);  // After Lvgl_FS_Init(). Full VFS path; replaces an open pack
+esp_err_t             Asset_Pack_Open_Mapped(const void *Data, uint32_t Size, const char *Name, void (*Unmap)(void));
+                                                          // A whole pack of Size bytes in the address space, which
+                                                          // must stay mapped until Unmap() is called from
+                                                          // Asset_Pack_Close(); not called if this fails.
+                                                          // Replaces an open pack
+void                  Asset_Pack_Close(void);             // Refused while an asset is held
+uint32_t              Asset_Pack_Count(void);
+const lv_image_dsc_t *Asset_Pack_Image(const char *Name); // NULL: not in the pack or not loadable. Held until released
+bool                  Asset_Pack_Release(const lv_image_dsc_t *Image);   // After the last object showing it is gone.
+                                                          // false: not an image of the pack
+bool                  Asset_Pack_Locate(const char *Name, const char **Path, uint32_t *Offset, uint32_t *Length);
+                                                          // Where the blob is in the pack file, for SD_Async to read
+                                                          // ahead. Length 0: resident already, Path NULL as well:
+                                                          // mapped, never read. false: not in the pack
+const void           *Asset_Pack_Mapped(const char *Name, uint32_t *Size);
+                                                          // A stored blob of a mapped pack where it is mapped, for
+                                                          // readers that hold it open on ASSET_PACK_LETTER. NULL:
+                                                          // not mapped, compressed or not in the pack
+lv_font_t            *Asset_Pack_Font(const char *Name);  // Parsed into LVGL's heap, lv_binfont_destroy() when done
+void                  Asset_Pack_Get_Stats(Asset_Pack_Stats_t *stats);
+void                  Asset_Pack_Print(void);             // Index and statistics
@@ -0,0 +1,117 @@
+#include <math.h>
+#include "esp_timer.h"
+#include "Auto_Rotate.h"
+#include "IMU_Fusion.h"
+
+static lv_timer_t *Rotate_Timer = NULL;
+static bool        Rotate_Enabled = true;
+static int         Rotate_Candidate = -1;                       // Orientation waiting out the debounce, -1: none
+static int64_t     Rotate_Candidate_us = 0;
+static int64_t     Rotate_Start_us = 0;                         // Switch in progress until the next refresh is done, 0: none
+static lv_display_rotation_t Rotate_From;
+static Auto_Rotate_Stats_t Rotate_Stats;
+
+/********************************************************** Switching **********************************************************/
+// lv_display_set_rotation() resizes the screens and layers, drops the pending invalidations (they are in the old
+// coordinates), invalidates the whole frame once and marks every layout dirty. The frame is then rendered in one pass
+// into the existing draw buffers and turned by the existing rotation buffer in Lvgl_Display_LCD.
+static void Rotate_Apply(lv_display_rotation_t rotation)
+{
+  lv_display_t *disp = display;
+  if (disp == NULL || lv_display_get_rotation(disp) == rotation)
+    return;
+  Rotate_From = lv_display_get_rotation(disp);
+  Rotate_Start_us = esp_timer_get_time();
+  lv_display_set_rotation(disp, rotation);
+  lv_obj_update_layout(lv_display_get_screen_active(disp));    // Now rather than in the refresh, to time it separately
+  Rotate_Stats.Last_layout_us = (uint32_t)(esp_timer_get_time() - Rotate_Start_us);
+}
+
+static void Rotate_Refr_Ready(lv_event_t *e)
+{
+  if (Rotate_Start_us == 0)
+    return;
+  uint32_t took = (uint32_t)(esp_timer_get_time() - Rotate_Start_us);
+  Rotate_Start_us = 0;
+  Rotate_Stats.Switches++;
+  Rotate_Stats.Last_us = took;
+  if (took > Rotate_Stats.Max_us)
+    Rotate_Stats.Max_us = took;
+  printf("Auto-rotate: %d -> %d deg in %lu us (layout %lu us)\r\n", Rotate_From * 90,
+         lv_display_get_rotation(display) * 90, took, Rotate_Stats.Last_layout_us);
+}
+
+/********************************************************** Detection **********************************************************/
+static float Rotate_Wrap(float deg)
+{
+  while (deg > 180.0f)
+    deg -= 360.0f;
+  while (deg < -180.0f)
+    deg += 360.0f;
+  return deg;
+}
+
+static void Rotate_Timer_Cb(lv_timer_t *timer)
+{
+  IMU_Attitude_t att;
+  if (!Rotate_Enabled || Rotate_Start_us != 0 || !IMU_Fusion_Get(&att))
+    return;
+
+  // Gravity as the accelerometer sees it at rest (pointing up), from the attitude so vibration is already filtered
+  const float *q = att.Q;
+  float g[3] = {2.0f * (q[1] * q[3] - q[0] * q[2]), 2.0f * (q[0] * q[1] + q[2] * q[3]),
+                q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3]};
+  float right = AUTO_ROTATE_RIGHT_SIGN * g[AUTO_ROTATE_RIGHT_AXIS];
+  float up = AUTO_ROTATE_UP_SIGN * g[AUTO_ROTATE_UP_AXIS];
+  if (right * right + up * up < AUTO_ROTATE_MIN_TILT_G * AUTO_ROTATE_MIN_TILT_G) {
+    Rotate_Candidate = -1;
+    return;
+  }
+
+  // 0 degrees: upright portrait. LVGL's 90 puts the panel's right edge at the bottom, which reads as -90 here.
+  float angle = atan2f(right, up) * 57.29578f;
+  int current = lv_display_get_rotation(display);
+  if (fabsf(Rotate_Wrap(angle + current * 90.0f)) < 45.0f + AUTO_ROTATE_HYSTERESIS_DEG) {
+    Rotate_Candidate = -1;                                      // Still within the current sector plus margin
+    return;
+  }
+  int candidate = ((int)lroundf(-angle / 90.0f) + 4) & 3;
+  if (!(AUTO_ROTATE_ALLOWED & (1 << candidate)) || candidate == current) {
+    Rotate_Candidate = -1;
+    return;
+  }
+
+  int64_t now = esp_timer_get_time();
+  if (candidate != Rotate_Candidate) {
+    Rotate_Candidate = candidate;
+    Rotate_Candidate_us = now;
+  } else if (now - Rotate_Candidate_us >= AUTO_ROTATE_DEBOUNCE_MS * 1000) {
+    Rotate_Candidate = -1;
+    Rotate_Apply((lv_display_rotation_t)candidate);
+  }
+}
+
+/********************************************************** Public API **********************************************************/
+void Auto_Rotate_Init(void)
+{
+  if (Rotate_Timer || display == NULL)
+    return;
+  lv_display_add_event_cb(display, Rotate_Refr_Ready, LV_EVENT_REFR_READY, NULL);
+  Rotate_Timer = lv_timer_create(Rotate_Timer_Cb, AUTO_ROTATE_PERIOD_MS, NULL);
+}
+
+void Auto_Rotate_Enable(bool Enable)
+{
+  Rotate_Enabled = Enable;
+  Rotate_Candidate = -1;
+}
+
+void Auto_Rotate_Set(lv_display_rotation_t Rotation)
+{
+  Rotate_Apply(Rotation);
+}
+
+void Auto_Rotate_Get_Stats(Auto_Rotate_Stats_t *stats)
+{
+  *stats = Rotate_Stats;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "LVGL_Driver.h"
+
+/****************************************************** IMU auto-rotation ******************************************************/
+// Follows the attitude from IMU_Fusion and turns the LVGL display to match. Detection and the switch itself run on
+// an lv_timer, i.e. in the LVGL context. The switch goes through lv_display_set_rotation(), keeps the draw and
+// rotation buffers and redraws the frame once. That is a full relayout of the active screen: on the host
+// (sim/bench/rotate_bench.cpp) it is 4 us of a 63 us switch for the UI in src/ui and 0.3 ms of 1 ms for 120 buttons in
+// a flex container, which a resized screen relays out anyway.
+#define AUTO_ROTATE_PERIOD_MS      50                     // Attitude sampling
+#define AUTO_ROTATE_DEBOUNCE_MS    300                    // A new orientation must hold this long before switching
+#define AUTO_ROTATE_HYSTERESIS_DEG 20                     // Extra tilt past the 45 degree sector edge before switching
+#define AUTO_ROTATE_MIN_TILT_G     0.5f                   // Gravity in the panel plane below this (lying flat): hold
+// Orientations the UI may take, bit per lv_display_rotation_t. The UI is laid out for 640x480, so landscape both ways
+#define AUTO_ROTATE_ALLOWED        ((1 << LV_DISPLAY_ROTATION_90) | (1 << LV_DISPLAY_ROTATION_270))
+
+// How the QMI8658 axes map onto the panel (native portrait, 480 wide): the sensor axis pointing to the panel's
+// right edge and the one pointing to its top edge, with sign.
+#define AUTO_ROTATE_RIGHT_AXIS     0
+#define AUTO_ROTATE_RIGHT_SIGN     (1.0f)
+#define AUTO_ROTATE_UP_AXIS        1
+#define AUTO_ROTATE_UP_SIGN        (1.0f)
+
+typedef struct {
+  uint32_t Switches;
+  uint32_t Last_layout_us;                                // Relayout part of the last switch
+  uint32_t Last_us;                                       // Last switch, from the decision to the end of the redraw
+  uint32_t Max_us;
+} Auto_Rotate_Stats_t;
+
+void Auto_Rotate_Init(void);                              // After Lvgl_Init() and IMU_Fusion_Init()
+void Auto_Rotate_Enable(bool Enable);
+void Auto_Rotate_Set(lv_display_rotation_t Rotation);     // Same switch, timed, for manual rotation. LVGL context only
+void Auto_Rotate_Get_Stats(Auto_Rotate_Stats_t *stats);
@@ -1,16 +1,238 @@
+#include <math.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
 #include "BAT_Driver.h"
 
 float BAT_analogVolts = 0;
 
+/********************************************************** Filter **********************************************************/
+// Generic single-cell LiPo open-circuit voltage at rest, mV -> percent
+static const struct { uint16_t Mv; uint8_t Soc; } BAT_Curve[] = {
+  {3300,   0}, {3500,   3}, {3600,   8}, {3680,  15}, {3720,  22}, {3760,  32}, {3790,  42}, {3820,  52},
+  {3860,  62}, {3910,  70}, {3980,  78}, {4060,  87}, {4120,  93}, {4170,  98}, {4200, 100},
+};
+
+uint8_t BAT_Soc_From_Mv(float Ocv_mv)
+{
+  const int n = sizeof(BAT_Curve) / sizeof(BAT_Curve[0]);
+  if (Ocv_mv <= BAT_Curve[0].Mv)
+    return 0;
+  for (int i = 1; i < n; i++) {
+    if (Ocv_mv < BAT_Curve[i].Mv) {
+      float t = (Ocv_mv - BAT_Curve[i - 1].Mv) / (BAT_Curve[i].Mv - BAT_Curve[i - 1].Mv);
+      return (uint8_t)(BAT_Curve[i - 1].Soc + t * (BAT_Curve[i].Soc - BAT_Curve[i - 1].Soc) + 0.5f);
+    }
+  }
+  return 100;
+}
+
+void BAT_Filter_Reset(BAT_Filter_t *f)
+{
+  memset(f, 0, sizeof(*f));
+}
+
+bool BAT_Filter_Push(BAT_Filter_t *f, float Battery_mv, float Dt_s, float Load_mA)
+{
+  float ocv = Battery_mv + Load_mA * BAT_RESISTANCE_MOHM / 1000.0f;   // Compensated per frame, so a load change
+  if (!f->Primed || fabsf(Battery_mv - f->Volts_mv) > BAT_STEP_MV) {  // does not drag through the low-pass
+    f->Volts_mv = Battery_mv;
+    f->Ocv_mv = ocv;
+    f->Primed = true;
+  } else {
+    float a = Dt_s / (BAT_FILTER_TAU_S + Dt_s);
+    f->Volts_mv += a * (Battery_mv - f->Volts_mv);
+    f->Ocv_mv += a * (ocv - f->Ocv_mv);
+  }
+  if (f->Published_mv != 0 && fabsf(f->Ocv_mv - f->Published_mv) < BAT_PUBLISH_MV)
+    return false;
+  f->Published_mv = f->Ocv_mv;
+  return true;
+}
+
+/********************************************************** Sampling **********************************************************/
+static adc_continuous_handle_t BAT_Adc = NULL;
+static adc_cali_handle_t       BAT_Cali = NULL;
+static adc_channel_t           BAT_Channel;
+static BAT_Filter_t            BAT_Filter;
+static uint16_t                BAT_Load_mA = BAT_LOAD_MA;
+static BAT_State_t             BAT_State;
+static uint32_t                BAT_Seq = 0;
+static BAT_Stats_t             BAT_Stats;
+static portMUX_TYPE            BAT_Lock = portMUX_INITIALIZER_UNLOCKED;
+
+static bool IRAM_ATTR BAT_Overflow_ISR(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *arg)
+{
+  BAT_Stats.Overflows++;
+  return false;
+}
+
+// Pin millivolts of a mean raw code. The curve is applied between the two codes either side of the mean, so the
+// resolution that oversampling gained is kept.
+static float BAT_Calibrate(float Raw)
+{
+  int lo = (int)Raw, mv_lo = 0, mv_hi = 0;
+  if (!BAT_Cali)
+    return Raw * 3100.0f / 4095.0f;                             // Uncalibrated: nominal 12 dB full scale
+  adc_cali_raw_to_voltage(BAT_Cali, lo, &mv_lo);
+  adc_cali_raw_to_voltage(BAT_Cali, lo + 1, &mv_hi);
+  return mv_lo + (Raw - lo) * (mv_hi - mv_lo);
+}
+
+static void BAT_Feed(float Battery_mv, float Noise_mv, uint32_t Samples, float Dt_s)
+{
+  uint16_t load = BAT_Load_mA;
+  bool publish = BAT_Filter_Push(&BAT_Filter, Battery_mv, Dt_s, load);
+  portENTER_CRITICAL(&BAT_Lock);
+  BAT_Stats.Frames++;
+  BAT_Stats.Samples += Samples;
+  BAT_Stats.Noise_mv = Noise_mv;
+  BAT_State.Volts = BAT_Filter.Volts_mv / 1000.0f;
+  if (publish) {
+    BAT_State.Ocv_volts = BAT_Filter.Ocv_mv / 1000.0f;
+    BAT_State.Soc = BAT_Soc_From_Mv(BAT_Filter.Ocv_mv);
+    BAT_State.Load_mA = load;
+    BAT_Seq++;
+    BAT_Stats.Publishes++;
+  }
+  portEXIT_CRITICAL(&BAT_Lock);
+  BAT_analogVolts = BAT_State.Volts;
+}
+
+// Blocks in adc_continuous_read() until the DMA has filled a frame
+static void BAT_Task(void *arg)
+{
+  static uint8_t frame[BAT_FRAME_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES];
+  const float scale = BAT_DIVIDER / Measurement_offset;
+  int64_t last = esp_timer_get_time();
+  while (1) {
+    uint32_t sum = 0, n = 0;
+    uint64_t sum2 = 0;
+    if (BAT_Adc) {
+      uint32_t bytes = 0;
+      const uint32_t timeout_ms = 2 * 1000 * BAT_FRAME_SAMPLES / BAT_SAMPLE_HZ;
+      if (adc_continuous_read(BAT_Adc, frame, sizeof(frame), &bytes, timeout_ms) != ESP_OK)
+        continue;
+      for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= bytes; i += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t *p = (const adc_digi_output_data_t *)&frame[i];
+        if (p->type2.channel != BAT_Channel)
+          continue;
+        sum += p->type2.data;
+        sum2 += p->type2.data * p->type2.data;
+        n++;
+      }
+    } else {
+      vTaskDelay(pdMS_TO_TICKS(1000 * BAT_FRAME_SAMPLES / BAT_SAMPLE_HZ));
+      for (; n < BAT_FALLBACK_SAMPLES; n++) {
+        uint32_t mv = analogReadMilliVolts(BAT_ADC_PIN);
+        sum += mv;
+        sum2 += (uint64_t)mv * mv;
+      }
+    }
+    if (n == 0)
+      continue;
+    int64_t now = esp_timer_get_time();
+    float mean = (float)sum / n;
+    float var = (float)sum2 / n - mean * mean;
+    float pin_mv = BAT_Adc ? BAT_Calibrate(mean) : mean;
+    float lsb_mv = BAT_Adc ? pin_mv / (mean > 1 ? mean : 1) : 1.0f;
+    BAT_Feed(pin_mv * scale, sqrtf(var > 0 ? var : 0) * lsb_mv * scale, n, (now - last) / 1e6f);
+    last = now;
+  }
+}
+
+static esp_err_t BAT_Continuous_Init(void)
+{
+  adc_unit_t unit;
+  esp_err_t ret = adc_continuous_io_to_channel(BAT_ADC_PIN, &unit, &BAT_Channel);
+  if (ret != ESP_OK || unit != ADC_UNIT_1)                      // ADC2 is shared with Wi-Fi
+    return ret != ESP_OK ? ret : ESP_ERR_NOT_SUPPORTED;
+
+  adc_continuous_handle_cfg_t handle_cfg = {};
+  handle_cfg.max_store_buf_size = 4 * BAT_FRAME_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES;
+  handle_cfg.conv_frame_size = BAT_FRAME_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES;
+  ret = adc_continuous_new_handle(&handle_cfg, &BAT_Adc);
+  if (ret != ESP_OK)
+    return ret;
+
+  adc_digi_pattern_config_t pattern = {};
+  pattern.atten = ADC_ATTEN_DB_12;
+  pattern.channel = BAT_Channel;
+  pattern.unit = ADC_UNIT_1;
+  pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+  adc_continuous_config_t cfg = {};
+  cfg.pattern_num = 1;
+  cfg.adc_pattern = &pattern;
+  cfg.sample_freq_hz = BAT_SAMPLE_HZ;
+  cfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  cfg.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+  adc_continuous_evt_cbs_t cbs = {};
+  cbs.on_pool_ovf = BAT_Overflow_ISR;
+  if ((ret = adc_continuous_config(BAT_Adc, &cfg)) != ESP_OK ||
+      (ret = adc_continuous_register_event_callbacks(BAT_Adc, &cbs, NULL)) != ESP_OK ||
+      (ret = adc_continuous_start(BAT_Adc)) != ESP_OK) {
+    adc_continuous_deinit(BAT_Adc);
+    BAT_Adc = NULL;
+    return ret;
+  }
+
+  adc_cali_curve_fitting_config_t cali = {};
+  cali.unit_id = ADC_UNIT_1;
+  cali.atten = ADC_ATTEN_DB_12;
+  cali.bitwidth = ADC_BITWIDTH_12;
+  if (adc_cali_create_scheme_curve_fitting(&cali, &BAT_Cali) != ESP_OK) {
+    printf("BAT: no ADC calibration in eFuse, using the nominal scale\r\n");
+    BAT_Cali = NULL;
+  }
+  return ESP_OK;
+}
+
 void BAT_Init(void)
 {
-  //set the resolution to 12 bits (0-4095)
-  analogReadResolution(12);
+  BAT_Filter_Reset(&BAT_Filter);
+  esp_err_t ret = BAT_Continuous_Init();
+  BAT_Stats.Continuous = ret == ESP_OK;
+  if (ret != ESP_OK) {
+    printf("BAT: continuous ADC failed (%s), averaging one-shot reads\r\n", esp_err_to_name(ret));
+    analogReadResolution(12);
+  }
+  if (xTaskCreatePinnedToCore(BAT_Task, "Battery", BAT_TASK_STACK, NULL, BAT_TASK_PRIORITY, NULL,
+                              BAT_TASK_CORE) != pdPASS)
+    printf("BAT: task creation failed\r\n");
 }
+
 float BAT_Get_Volts(void)
 {
-  int Volts = analogReadMilliVolts(BAT_ADC_PIN); // millivolts
-  BAT_analogVolts = (float)(Volts * 3.0 / 1000.0) / Measurement_offset;
-  // printf("BAT voltage : %.2f V\r\n", BAT_analogVolts);
   return BAT_analogVolts;
-}
\ No newline at end of file
+}
+
+uint8_t BAT_Get_Soc(void)
+{
+  portENTER_CRITICAL(&BAT_Lock);
+  uint8_t soc = BAT_State.Soc;
+  portEXIT_CRITICAL(&BAT_Lock);
+  return soc;
+}
+
+uint32_t BAT_Get_State(BAT_State_t *state)
+{
+  portENTER_CRITICAL(&BAT_Lock);
+  *state = BAT_State;
+  uint32_t seq = BAT_Seq;
+  portEXIT_CRITICAL(&BAT_Lock);
+  return seq;
+}
+
+void BAT_Set_Load_mA(uint16_t mA)
+{
+  BAT_Load_mA = mA;
+}
+
+void BAT_Get_Stats(BAT_Stats_t *stats)
+{
+  portENTER_CRITICAL(&BAT_Lock);
+  *stats = BAT_Stats;
+  portEXIT_CRITICAL(&BAT_Lock);
+}
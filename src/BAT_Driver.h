@@ -1,10 +1,62 @@
 #pragma once
-#include <Arduino.h> 
+#include <Arduino.h>
 
+/****************************************************** Battery monitor ******************************************************/
+// The ADC samples the battery divider continuously into DMA frames, so sampling costs no CPU time. A low-priority
+// task wakes once per frame and filters in two stages:
+//   - the frame mean, a decimation by BAT_FRAME_SAMPLES;
+//   - a single-pole low-pass with time constant BAT_FILTER_TAU_S.
+// The filtered voltage is load compensated (V + I x R) to estimate the open-circuit voltage, and a LiPo OCV curve
+// turns that into a state of charge. A new state is published only when the open-circuit estimate has moved by
+// BAT_PUBLISH_MV. Readers that compare BAT_Get_State()'s sequence number update only on real changes.
 #define BAT_ADC_PIN   4
 #define Measurement_offset 0.992857
+#define BAT_DIVIDER              3.0f                     // Battery volts per volt at BAT_ADC_PIN
+#define BAT_SAMPLE_HZ            1000                     // ADC conversion rate, >= 611 on the S3
+#define BAT_FRAME_SAMPLES        256                      // Conversions per DMA frame: ~4 task wake-ups/s
+#define BAT_FILTER_TAU_S         4.0f                     // Low-pass time constant after decimation
+#define BAT_STEP_MV              150                      // A frame this far from the filter is a real step (charger)
+#define BAT_PUBLISH_MV           10                       // Publish when the OCV estimate moves this far
+#define BAT_RESISTANCE_MOHM      180                      // Cell, protection and wiring, for load compensation
+#define BAT_LOAD_MA              250                      // Until BAT_Set_Load_mA() is called: awake, full backlight
+#define BAT_FALLBACK_SAMPLES     16                       // One-shot reads averaged when continuous mode is unavailable
+#define BAT_TASK_CORE            0
+#define BAT_TASK_PRIORITY        1
+#define BAT_TASK_STACK           3072
 
-extern float BAT_analogVolts;
+typedef struct {
+  float    Volts;                                         // Filtered voltage at the battery terminals
+  float    Ocv_volts;                                     // Open-circuit estimate: Volts + load x resistance
+  uint8_t  Soc;                                           // State of charge, percent, from Ocv_volts
+  uint16_t Load_mA;                                       // Load the estimate was compensated for
+} BAT_State_t;
 
-void BAT_Init(void);
-float BAT_Get_Volts(void);
\ No newline at end of file
+typedef struct {
+  bool     Continuous;                                    // false: the task averages one-shot reads instead
+  uint32_t Frames;                                        // Filtered
+  uint32_t Samples;
+  uint32_t Overflows;                                     // DMA frames lost because the task fell behind
+  uint32_t Publishes;
+  float    Noise_mv;                                      // Standard deviation of the last frame's samples, battery mV
+} BAT_Stats_t;
+
+// Filter core, no RTOS or ADC dependencies (also used by the host bench in sim/bench)
+typedef struct {
+  bool     Primed;
+  float    Volts_mv;
+  float    Ocv_mv;
+  float    Published_mv;                                  // Ocv_mv when last published
+} BAT_Filter_t;
+
+void    BAT_Filter_Reset(BAT_Filter_t *f);
+bool    BAT_Filter_Push(BAT_Filter_t *f, float Battery_mv, float Dt_s, float Load_mA);  // true: publish
+uint8_t BAT_Soc_From_Mv(float Ocv_mv);
+
+extern float BAT_analogVolts;                             // BAT_Get_Volts(), for existing users
+
+void     BAT_Init(void);
+float    BAT_Get_Volts(void);                             // Filtered terminal voltage, never touches the ADC
+uint8_t  BAT_Get_Soc(void);
+uint32_t BAT_Get_State(BAT_State_t *state);               // Changes only when a new state is published, 0: none yet
+void     BAT_Set_Load_mA(uint16_t mA);                    // Estimated current draw, any task
+void     BAT_Get_Stats(BAT_Stats_t *stats);
@@ -0,0 +1,428 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "Compressed_Image.h"
+
+#if LV_USE_LZ4_EXTERNAL
+  #include <lz4.h>
+#elif LV_USE_LZ4_INTERNAL
+  #include "src/libs/lz4/lz4.h"  // lib/lvgl is on the include path, see <demos/lv_demos.h>
+#endif
+
+#define CIMG_HEADER_SIZE  12                                    // lv_image_compressed_t, private to lv_bin_decoder
+
+typedef struct {
+  uint8_t        Method;
+  uint32_t       Stored;                                        // Stream bytes, header excluded
+  uint32_t       Raw;
+  const uint8_t *Data;
+  uint32_t       Row_bytes;                                     // First plane
+  uint8_t        Block;                                         // RLE pixel size
+} Cimg_Header_t;
+
+typedef struct {
+  Compressed_Image_Rows_t Rows;
+  lv_draw_buf_t          *Row_buf;                              // The row handed to the draw
+} Cimg_Lines_t;
+
+static Compressed_Image_Stats_t Cimg_Stats;
+
+/********************************************************** Format **********************************************************/
+static bool Cimg_Parse(const lv_image_dsc_t *Image, Cimg_Header_t *h)
+{
+  if (Image == NULL || Image->header.magic != LV_IMAGE_HEADER_MAGIC ||
+      !(Image->header.flags & LV_IMAGE_FLAGS_COMPRESSED) || Image->data == NULL || Image->data_size < CIMG_HEADER_SIZE)
+    return false;
+  lv_color_format_t cf = (lv_color_format_t)Image->header.cf;
+  uint32_t bpp = lv_color_format_get_bpp(cf);
+  if (bpp < 8 || LV_COLOR_FORMAT_IS_INDEXED(cf))                // Palettes and packed alpha stay with lv_bin_decoder
+    return false;
+  uint32_t word[3];
+  memcpy(word, Image->data, sizeof(word));
+  h->Method = word[0] & 0x0F;
+  h->Stored = word[1];
+  h->Raw = word[2];
+  h->Data = Image->data + CIMG_HEADER_SIZE;
+  h->Row_bytes = Image->header.w * bpp / 8;
+  h->Block = cf == LV_COLOR_FORMAT_RGB565A8 ? 2 : bpp / 8;      // As lv_bin_decoder unpacks RLE
+  uint32_t raw = h->Row_bytes * Image->header.h;
+  if (cf == LV_COLOR_FORMAT_RGB565A8)
+    raw += (uint32_t)Image->header.w * Image->header.h;
+  return (h->Method == LV_IMAGE_COMPRESS_RLE || h->Method == LV_IMAGE_COMPRESS_LZ4) &&
+         h->Stored == Image->data_size - CIMG_HEADER_SIZE && h->Raw == raw &&
+         (Image->header.stride == 0 || Image->header.stride == h->Row_bytes);
+}
+
+static bool Cimg_Rle_Next(Compressed_Image_Rle_t *r)
+{
+  if (r->In >= r->End)
+    return false;
+  uint8_t ctrl = *r->In++;
+  uint32_t n = (ctrl & 0x80) ? (ctrl & 0x7F) * r->Block : r->Block;
+  if (n > (uint32_t)(r->End - r->In))
+    return false;
+  r->Copy = ctrl & 0x80;
+  r->Run = r->In;
+  r->In += n;
+  r->Left = r->Copy ? n : ctrl * r->Block;
+  r->Phase = 0;
+  return true;
+}
+
+// Count bytes of the stream into Out, or past them when Out is NULL
+static bool Cimg_Rle_Read(Compressed_Image_Rle_t *r, uint8_t *Out, uint32_t Count)
+{
+  while (Count > 0) {
+    if (r->Left == 0) {
+      if (!Cimg_Rle_Next(r))
+        return false;
+      continue;
+    }
+    uint32_t n = Count < r->Left ? Count : r->Left;
+    if (r->Copy) {
+      if (Out)
+        memcpy(Out, r->Run, n);
+      r->Run += n;
+    } else if (Out && r->Block == 1) {
+      memset(Out, r->Run[0], n);
+    } else {
+      uint8_t p = r->Phase;
+      for (uint32_t i = 0; Out && i < n; i++) {
+        Out[i] = r->Run[p];
+        if (++p == r->Block)
+          p = 0;
+      }
+      r->Phase = (r->Phase + n) % r->Block;
+    }
+    r->Left -= n;
+    Count -= n;
+    if (Out)
+      Out += n;
+  }
+  return true;
+}
+
+/********************************************************** LVGL decoder **********************************************************/
+static lv_result_t Cimg_Info_Cb(lv_image_decoder_t *decoder, const void *src, lv_image_header_t *header)
+{
+  Cimg_Header_t h;
+  if (lv_image_src_get_type(src) != LV_IMAGE_SRC_VARIABLE || !Cimg_Parse((const lv_image_dsc_t *)src, &h))
+    return LV_RESULT_INVALID;
+  *header = ((const lv_image_dsc_t *)src)->header;
+  header->flags &= ~LV_IMAGE_FLAGS_COMPRESSED;                 // What the draw gets is not
+  header->stride = h.Row_bytes;
+  return LV_RESULT_OK;
+}
+
+static lv_result_t Cimg_Open_Lines(lv_image_decoder_dsc_t *dsc, const Cimg_Header_t *h)
+{
+  const lv_image_dsc_t *image = (const lv_image_dsc_t *)dsc->src;
+  Cimg_Lines_t *l = (Cimg_Lines_t *)calloc(1, sizeof(Cimg_Lines_t));
+  if (l == NULL || Compressed_Image_Rows_Open(&l->Rows, image) != ESP_OK ||
+      (l->Row_buf = lv_draw_buf_create(image->header.w, 1, (lv_color_format_t)image->header.cf, h->Row_bytes)) == NULL) {
+    free(l);
+    Cimg_Stats.Failures++;
+    return LV_RESULT_INVALID;
+  }
+  dsc->user_data = l;
+  dsc->decoded = NULL;                                          // Rows through Cimg_Get_Area_Cb()
+  Cimg_Stats.Line_draws++;
+  return LV_RESULT_OK;
+}
+
+static lv_result_t Cimg_Open_Cb(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc)
+{
+  const lv_image_dsc_t *image = (const lv_image_dsc_t *)dsc->src;
+  Cimg_Header_t h;
+  if (!Cimg_Parse(image, &h))
+    return LV_RESULT_INVALID;
+  bool cache = !dsc->args.no_cache && h.Raw <= COMPRESSED_IMAGE_CACHE_MAX;
+  if (!cache && h.Method == LV_IMAGE_COMPRESS_RLE)
+    return Cimg_Open_Lines(dsc, &h);
+
+  int64_t start = esp_timer_get_time();
+  lv_draw_buf_t *buf = lv_draw_buf_create(image->header.w, image->header.h, (lv_color_format_t)image->header.cf,
+                                          h.Row_bytes);
+  if (buf == NULL || Compressed_Image_Unpack(image, buf->data, buf->data_size) != ESP_OK) {
+    if (buf)
+      lv_draw_buf_destroy(buf);
+    Cimg_Stats.Failures++;
+    return LV_RESULT_INVALID;
+  }
+  uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+  Cimg_Stats.Decode_us += us;
+  lv_draw_buf_t *adjusted = lv_image_decoder_post_process(dsc, buf);
+  if (adjusted != buf)
+    lv_draw_buf_destroy(buf);
+  if (adjusted == NULL)
+    return LV_RESULT_INVALID;
+  dsc->decoded = adjusted;
+  dsc->time_to_open = us / 1000;
+  if (!cache)
+    return LV_RESULT_OK;                                        // Freed by Cimg_Close_Cb() after the draw
+#if LV_CACHE_DEF_SIZE > 0
+  lv_image_cache_data_t search_key;
+  search_key.src_type = dsc->src_type;
+  search_key.src = dsc->src;
+  search_key.slot.size = adjusted->data_size;
+  dsc->cache_entry = lv_image_decoder_add_to_cache(decoder, &search_key, adjusted, NULL);
+  if (dsc->cache_entry == NULL) {
+    lv_draw_buf_destroy(adjusted);
+    return LV_RESULT_INVALID;
+  }
+#endif
+  return LV_RESULT_OK;
+}
+
+// One full-width row per call, from the top of the clipped area down, as lv_bin_decoder's
+static lv_result_t Cimg_Get_Area_Cb(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc,
+                                    const lv_area_t *full_area, lv_area_t *decoded_area)
+{
+  Cimg_Lines_t *l = (Cimg_Lines_t *)dsc->user_data;
+  if (l == NULL)
+    return LV_RESULT_INVALID;
+  if (decoded_area->y1 == LV_COORD_MIN) {
+    decoded_area->x1 = 0;
+    decoded_area->x2 = dsc->header.w - 1;
+    decoded_area->y1 = decoded_area->y2 = full_area->y1;
+  } else {
+    decoded_area->y1++;
+    decoded_area->y2++;
+  }
+  if (decoded_area->y1 > full_area->y2)
+    return LV_RESULT_INVALID;
+  int64_t start = esp_timer_get_time();
+  const uint8_t *color = l->Rows.Color.In, *alpha = l->Rows.Alpha.In;
+  if (Compressed_Image_Row(&l->Rows, decoded_area->y1, l->Row_buf->data) != ESP_OK) {
+    Cimg_Stats.Failures++;
+    return LV_RESULT_INVALID;
+  }
+  Cimg_Stats.Rows++;
+  Cimg_Stats.Raw_bytes += l->Row_buf->data_size;
+  if (l->Rows.Color.In >= color && l->Rows.Alpha.In >= alpha)   // Else restarted from the top
+    Cimg_Stats.Stored_bytes += (l->Rows.Color.In - color) + (l->Rows.Alpha.In - alpha);
+  Cimg_Stats.Decode_us += esp_timer_get_time() - start;
+  dsc->decoded = l->Row_buf;
+  return LV_RESULT_OK;
+}
+
+static void Cimg_Close_Cb(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc)
+{
+  Cimg_Lines_t *l = (Cimg_Lines_t *)dsc->user_data;
+  if (l) {
+    lv_draw_buf_destroy(l->Row_buf);
+    free(l);
+    dsc->user_data = NULL;
+    dsc->decoded = NULL;
+    return;
+  }
+  if (dsc->cache_entry) {
+    lv_cache_release(dsc->cache, dsc->cache_entry, NULL);      // The cache frees it, Cimg_Cache_Free_Cb()
+    return;
+  }
+  lv_draw_buf_destroy((lv_draw_buf_t *)dsc->decoded);
+}
+
+static void Cimg_Cache_Free_Cb(lv_image_cache_data_t *entry, void *user_data)
+{
+  lv_draw_buf_destroy((lv_draw_buf_t *)entry->decoded);
+}
+
+/********************************************************** API **********************************************************/
+esp_err_t Compressed_Image_Init(void)
+{
+  lv_image_decoder_t *dec = lv_image_decoder_create();
+  if (dec == NULL)
+    return ESP_ERR_NO_MEM;
+  lv_image_decoder_set_info_cb(dec, Cimg_Info_Cb);
+  lv_image_decoder_set_open_cb(dec, Cimg_Open_Cb);
+  lv_image_decoder_set_get_area_cb(dec, Cimg_Get_Area_Cb);
+  lv_image_decoder_set_close_cb(dec, Cimg_Close_Cb);
+  lv_image_decoder_set_cache_free_cb(dec, (lv_cache_free_cb_t)Cimg_Cache_Free_Cb);
+  printf("Compressed images: decoder registered, RLE %s, LZ4 %s\r\n", LV_USE_RLE ? "on" : "off",
+         LV_USE_LZ4 ? "on" : "off");
+  return ESP_OK;
+}
+
+bool Compressed_Image_Is(const lv_image_dsc_t *Image)
+{
+  Cimg_Header_t h;
+  return Cimg_Parse(Image, &h);
+}
+
+uint32_t Compressed_Image_Size(const lv_image_dsc_t *Image)
+{
+  Cimg_Header_t h;
+  return Cimg_Parse(Image, &h) ? h.Raw : 0;
+}
+
+esp_err_t Compressed_Image_Unpack(const lv_image_dsc_t *Image, uint8_t *Out, uint32_t Size)
+{
+  Cimg_Header_t h;
+  if (!Cimg_Parse(Image, &h) || Out == NULL)
+    return ESP_ERR_INVALID_ARG;
+  if (Size < h.Raw)
+    return ESP_ERR_INVALID_SIZE;
+  bool ok = false;
+  if (h.Method == LV_IMAGE_COMPRESS_RLE) {
+#if LV_USE_RLE
+    ok = lv_rle_decompress(h.Data, h.Stored, Out, h.Raw, h.Block) == h.Raw;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+  } else {
+#if LV_USE_LZ4
+    ok = LZ4_decompress_safe((const char *)h.Data, (char *)Out, (int)h.Stored, (int)h.Raw) == (int)h.Raw;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+  }
+  if (ok) {
+    Cimg_Stats.Unpacks++;
+    Cimg_Stats.Raw_bytes += h.Raw;
+    Cimg_Stats.Stored_bytes += h.Stored + CIMG_HEADER_SIZE;
+  }
+  return ok ? ESP_OK : ESP_ERR_INVALID_CRC;
+}
+
+esp_err_t Compressed_Image_Rows_Open(Compressed_Image_Rows_t *Rows, const lv_image_dsc_t *Image)
+{
+  Cimg_Header_t h;
+  if (Rows == NULL || !Cimg_Parse(Image, &h))
+    return ESP_ERR_INVALID_ARG;
+  if (h.Method != LV_IMAGE_COMPRESS_RLE)
+    return ESP_ERR_NOT_SUPPORTED;
+  memset(Rows, 0, sizeof(*Rows));
+  Rows->Image = Image;
+  Rows->Row_bytes = h.Row_bytes;
+  Rows->Color_start.In = h.Data;
+  Rows->Color_start.End = h.Data + h.Stored;
+  Rows->Color_start.Block = h.Block;
+  Rows->Alpha_start = Rows->Color_start;
+  if (Image->header.cf == LV_COLOR_FORMAT_RGB565A8 &&
+      !Cimg_Rle_Read(&Rows->Alpha_start, NULL, h.Row_bytes * Image->header.h))
+    return ESP_ERR_INVALID_CRC;
+  Rows->Color = Rows->Color_start;
+  Rows->Alpha = Rows->Alpha_start;
+  return ESP_OK;
+}
+
+esp_err_t Compressed_Image_Row(Compressed_Image_Rows_t *Rows, uint16_t Row, uint8_t *Out)
+{
+  if (Rows == NULL || Rows->Image == NULL || Row >= Rows->Image->header.h)
+    return ESP_ERR_INVALID_ARG;
+  bool alpha = Rows->Image->header.cf == LV_COLOR_FORMAT_RGB565A8;
+  uint32_t w = Rows->Image->header.w;
+  if (Row < Rows->Next) {
+    Rows->Color = Rows->Color_start;
+    Rows->Alpha = Rows->Alpha_start;
+    Rows->Next = 0;
+  }
+  uint32_t skip = Row - Rows->Next;
+  bool ok = Cimg_Rle_Read(&Rows->Color, NULL, skip * Rows->Row_bytes) &&
+            Cimg_Rle_Read(&Rows->Color, Out, Rows->Row_bytes);
+  if (alpha)
+    ok = ok && Cimg_Rle_Read(&Rows->Alpha, NULL, skip * w) && Cimg_Rle_Read(&Rows->Alpha, Out + Rows->Row_bytes, w);
+  if (!ok) {
+    Rows->Next = Rows->Image->header.h;                         // Restart next time rather than read on
+    return ESP_ERR_INVALID_CRC;
+  }
+  Rows->Next = Row + 1;
+  return ESP_OK;
+}
+
+esp_err_t Compressed_Image_Measure(const lv_image_dsc_t *Image, Compressed_Image_Report_t *Report)
+{
+  Cimg_Header_t h;
+  if (!Cimg_Parse(Image, &h) || Report == NULL)
+    return ESP_ERR_INVALID_ARG;
+  memset(Report, 0, sizeof(*Report));
+  Report->Method = h.Method;
+  Report->Raw = h.Raw;
+  Report->Stored = h.Stored + CIMG_HEADER_SIZE;
+  uint8_t *out = (uint8_t *)malloc(h.Raw);
+  uint8_t *copy = (uint8_t *)malloc(h.Raw);
+  if (out == NULL || copy == NULL) {
+    free(out);
+    free(copy);
+    return ESP_ERR_NO_MEM;
+  }
+  Compressed_Image_Stats_t saved = Cimg_Stats;                  // Benchmark runs are not draws
+  esp_err_t err = ESP_OK;
+  Report->Unpack_us = Report->Rows_us = Report->Copy_us = UINT32_MAX;
+  for (int i = 0; i < COMPRESSED_IMAGE_BENCH_REPEATS && err == ESP_OK; i++) {
+    int64_t t0 = esp_timer_get_time();
+    err = Compressed_Image_Unpack(Image, out, h.Raw);
+    int64_t t1 = esp_timer_get_time();
+    memcpy(copy, out, h.Raw);
+    int64_t t2 = esp_timer_get_time();
+    if (t1 - t0 < Report->Unpack_us)
+      Report->Unpack_us = (uint32_t)(t1 - t0);
+    if (t2 - t1 < Report->Copy_us)
+      Report->Copy_us = (uint32_t)(t2 - t1);
+  }
+  Compressed_Image_Rows_t rows;
+  if (err == ESP_OK && h.Method == LV_IMAGE_COMPRESS_RLE && Compressed_Image_Rows_Open(&rows, Image) == ESP_OK) {
+    uint32_t w = Image->header.w;
+    bool alpha = Image->header.cf == LV_COLOR_FORMAT_RGB565A8;
+    for (int i = 0; i < COMPRESSED_IMAGE_BENCH_REPEATS && err == ESP_OK; i++) {
+      int64_t t0 = esp_timer_get_time();
+      for (uint16_t y = 0; y < Image->header.h && err == ESP_OK; y++)
+        err = Compressed_Image_Row(&rows, y, copy);
+      int64_t us = esp_timer_get_time() - t0;
+      if (us < Report->Rows_us)
+        Report->Rows_us = (uint32_t)us;
+    }
+    // The rows must match the whole image, the last one as a sample
+    uint16_t y = Image->header.h - 1;
+    if (err == ESP_OK && (memcmp(copy, out + y * rows.Row_bytes, rows.Row_bytes) ||
+                          (alpha && memcmp(copy + rows.Row_bytes, out + rows.Row_bytes * Image->header.h + y * w, w))))
+      err = ESP_ERR_INVALID_CRC;
+  } else {
+    Report->Rows_us = 0;
+  }
+  Cimg_Stats = saved;
+  free(out);
+  free(copy);
+  return err;
+}
+
+void Compressed_Image_Bench(const lv_image_dsc_t *const Images[], const char *const Names[], int Count)
+{
+  uint32_t raw = 0, stored = 0, unpack = 0, copy = 0;
+  for (int i = 0; i < Count; i++) {
+    Compressed_Image_Report_t r;
+    char name[16];
+    snprintf(name, sizeof(name), "image %d", i);
+    const char *n = Names && Names[i] ? Names[i] : name;
+    esp_err_t err = Compressed_Image_Measure(Images[i], &r);
+    if (err != ESP_OK) {
+      printf("Image bench: %-40s %s\r\n", n, err == ESP_ERR_INVALID_ARG ? "not compressed" : esp_err_to_name(err));
+      continue;
+    }
+    printf("Image bench: %-40s %3ux%-3u %s %6lu -> %6lu bytes, saves %6lu; unpack %5lu us, by rows %5lu us, "
+           "copy %4lu us\r\n", n, Images[i]->header.w, Images[i]->header.h,
+           r.Method == LV_IMAGE_COMPRESS_RLE ? "RLE" : "LZ4", r.Raw, r.Stored, r.Raw - r.Stored, r.Unpack_us,
+           r.Rows_us, r.Copy_us);
+    raw += r.Raw;
+    stored += r.Stored;
+    unpack += r.Unpack_us;
+    copy += r.Copy_us;
+  }
+  printf("Image bench: %lu bytes in flash for %lu, saves %lu; %lu us to unpack all, %lu us more than copying them\r\n",
+         stored, raw, raw - stored, unpack, unpack > copy ? unpack - copy : 0);
+}
+
+void Compressed_Image_Get_Stats(Compressed_Image_Stats_t *stats)
+{
+  *stats = Cimg_Stats;
+}
+
+void Compressed_Image_Print_Stats(void)
+{
+  Compressed_Image_Stats_t s = Cimg_Stats;
+  printf("Compressed images: %lu unpacked whole, %lu line-by-line draws (%lu rows), %lu failures, "
+         "%llu bytes from %llu in flash, %llu us\r\n", s.Unpacks, s.Line_draws, s.Rows, s.Failures, s.Raw_bytes,
+         s.Stored_bytes, s.Decode_us);
+}
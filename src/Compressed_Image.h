@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <lvgl.h>
+#include "esp_err.h"
+
+/****************************************************** Compressed images ******************************************************/
+// Images compressed in flash by tools/image_compress.py (LV_IMAGE_FLAGS_COMPRESSED, an lv_image_compressed_t header
+// and one RLE stream or LZ4 block) as LVGL images: an image decoder for such lv_image_dsc_t variables, tried before
+// lv_bin_decoder, which needs LV_BIN_DECODER_RAM_LOAD for them and always unpacks the whole image.
+//   - up to COMPRESSED_IMAGE_CACHE_MAX decoded bytes, the image is unpacked once into a draw buffer that goes into
+//     lv_image_cache, so drawing it again costs what an uncompressed image does;
+//   - larger RLE images, and any opened with no_cache, are unpacked line by line as the draw asks for them: nothing
+//     is kept between draws but the row being drawn. An LZ4 block refers back to what it already unpacked, so those
+//     are unpacked whole for the draw and freed after it.
+// RLE needs LV_USE_RLE and LZ4 LV_USE_LZ4_INTERNAL, both on in lv_conf.h; the tool keeps an uncompressed copy of
+// each image for builds without them. Compressed_Image_Bench() reports flash saved against decode time per image.
+#define COMPRESSED_IMAGE_CACHE_MAX   (64 * 1024)          // Decoded bytes; larger RLE images are drawn line by line
+#define COMPRESSED_IMAGE_BENCH_REPEATS 20                 // Unpacks timed per image, best kept
+#define COMPRESSED_IMAGE_BENCH_AUTOSTART 0                // 1: main.cpp benches the UI's icons at boot
+
+typedef struct {
+  uint8_t        Method;                                  // LV_IMAGE_COMPRESS_RLE or _LZ4
+  uint32_t       Raw;                                     // Decoded bytes
+  uint32_t       Stored;                                  // Bytes in flash, header included
+  uint32_t       Unpack_us;                               // Whole image, into RAM
+  uint32_t       Rows_us;                                 // Row by row, RLE only
+  uint32_t       Copy_us;                                 // Raw bytes copied: what the uncompressed image costs to read
+} Compressed_Image_Report_t;
+
+typedef struct {
+  uint32_t Unpacks;                                       // Whole images, for lv_image_cache or a single draw
+  uint32_t Line_draws;                                    // Draws unpacked line by line
+  uint32_t Rows;
+  uint32_t Failures;                                      // Damaged data, no memory, method not built in
+  uint64_t Raw_bytes;                                     // Decoded by both ways
+  uint64_t Stored_bytes;                                  // Read from flash by both ways
+  uint64_t Decode_us;
+} Compressed_Image_Stats_t;
+
+// A line by line reader, for the decoder and the benchmarks. Rows come out as LVGL lays out a one-row draw buffer:
+// Width pixels, then the row's alpha for RGB565A8.
+typedef struct {
+  const uint8_t *In;                                      // Next control byte
+  const uint8_t *End;
+  const uint8_t *Run;                                     // Next byte to copy, or the repeated pixel
+  uint32_t       Left;                                    // Bytes left in the current run
+  uint8_t        Block;                                   // Bytes per pixel of the stream
+  uint8_t        Phase;                                   // Next byte's offset in the repeated pixel
+  bool           Copy;
+} Compressed_Image_Rle_t;
+
+typedef struct {
+  const lv_image_dsc_t  *Image;
+  Compressed_Image_Rle_t Color;                           // Row Next of the first plane
+  Compressed_Image_Rle_t Alpha;                           // Row Next of the alpha plane, RGB565A8
+  Compressed_Image_Rle_t Color_start;                     // Both at row 0, to restart from
+  Compressed_Image_Rle_t Alpha_start;
+  uint32_t               Row_bytes;                       // Of the first plane
+  uint16_t               Next;
+} Compressed_Image_Rows_t;
+
+esp_err_t Compressed_Image_Init(void);                    // After Lvgl_Init(): registers the decoder
+bool      Compressed_Image_Is(const lv_image_dsc_t *Image); // Compressed by the tool, in a format it handles
+uint32_t  Compressed_Image_Size(const lv_image_dsc_t *Image); // Decoded bytes, 0 if not Compressed_Image_Is()
+esp_err_t Compressed_Image_Unpack(const lv_image_dsc_t *Image, uint8_t *Out, uint32_t Size);
+                                                          // Whole image, Size from Compressed_Image_Size().
+                                                          // ESP_ERR_NOT_SUPPORTED: method not built in
+esp_err_t Compressed_Image_Rows_Open(Compressed_Image_Rows_t *Rows, const lv_image_dsc_t *Image);
+                                                          // ESP_ERR_NOT_SUPPORTED: not RLE
+esp_err_t Compressed_Image_Row(Compressed_Image_Rows_t *Rows, uint16_t Row, uint8_t *Out);
+                                                          // Any row; the next one is the cheapest, an earlier one
+                                                          // restarts from the top
+esp_err_t Compressed_Image_Measure(const lv_image_dsc_t *Image, Compressed_Image_Report_t *Report);
+void      Compressed_Image_Bench(const lv_image_dsc_t *const Images[], const char *const Names[], int Count);
+                                                          // One line per image and a total, e.g. for the UI's icons
+void      Compressed_Image_Get_Stats(Compressed_Image_Stats_t *stats);
+void      Compressed_Image_Print_Stats(void);
@@ -0,0 +1,532 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "Data_Logger.h"
+#include "SD_Index.h"
+#include "Gyro_QMI8658.h"
+#include "Power_Manager.h"
+
+/********************************************************** Block packing **********************************************************/
+static uint32_t Logger_Crc_Table[256];
+
+uint32_t Logger_Crc32(uint32_t Crc, const uint8_t *Data, uint32_t Length)
+{
+  if (Logger_Crc_Table[1] == 0) {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++)
+        c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+      Logger_Crc_Table[i] = c;
+    }
+  }
+  Crc = ~Crc;
+  while (Length--)
+    Crc = Logger_Crc_Table[(Crc ^ *Data++) & 0xFF] ^ (Crc >> 8);
+  return ~Crc;
+}
+
+void Logger_Pack_Begin(Logger_Packer_t *p, uint8_t *Block)
+{
+  p->Block = Block;
+  p->Used = sizeof(Logger_Block_Header_t);
+  p->Chunks = 0;
+  p->Imu_chunk = 0;
+}
+
+static void *Logger_Pack_Open(Logger_Packer_t *p, uint8_t Type, uint16_t Length)
+{
+  if (p->Used + sizeof(Logger_Chunk_Header_t) + Length > LOGGER_BLOCK_SIZE)
+    return NULL;
+  Logger_Chunk_Header_t ch = {Type, 0, Length};
+  memcpy(p->Block + p->Used, &ch, sizeof(ch));
+  void *payload = p->Block + p->Used + sizeof(ch);
+  p->Used += sizeof(ch) + Length;
+  p->Chunks++;
+  return payload;
+}
+
+bool Logger_Pack_Chunk(Logger_Packer_t *p, uint8_t Type, const void *Payload, uint16_t Length)
+{
+  void *dst = Logger_Pack_Open(p, Type, Length);
+  if (dst == NULL)
+    return false;
+  memcpy(dst, Payload, Length);
+  p->Imu_chunk = 0;                                             // Keep the chunks in time order
+  return true;
+}
+
+// Samples go into the open IMU chunk as 14-byte records with the time as a delta. A gap that does not fit in the
+// delta, or any other chunk in between, opens a new IMU chunk with a full timestamp.
+bool Logger_Pack_Imu(Logger_Packer_t *p, const IMU_Sample_t *s)
+{
+  uint32_t dt = s->Time_us - p->Imu_last_us;
+  Logger_Chunk_Header_t ch;
+  Logger_Imu_Header_t ih;
+  if (p->Imu_chunk) {
+    memcpy(&ch, p->Block + p->Imu_chunk, sizeof(ch));
+    memcpy(&ih, p->Block + p->Imu_chunk + sizeof(ch), sizeof(ih));
+  }
+  if (p->Imu_chunk == 0 || dt > 0xFFFF || ih.Count == 0xFFFF) {
+    if (p->Used + sizeof(ch) + sizeof(ih) + sizeof(Logger_Imu_Record_t) > LOGGER_BLOCK_SIZE)
+      return false;
+    ih = {s->Time_us, 0, 0};
+    uint32_t at = p->Used;
+    Logger_Pack_Open(p, LOGGER_CHUNK_IMU, sizeof(ih));
+    memcpy(&ch, p->Block + at, sizeof(ch));
+    p->Imu_chunk = at;
+    dt = 0;
+  } else if (p->Used + sizeof(Logger_Imu_Record_t) > LOGGER_BLOCK_SIZE) {
+    return false;
+  }
+
+  Logger_Imu_Record_t rec;
+  rec.Dt_us = (uint16_t)dt;
+  memcpy(rec.Acc, s->Acc, sizeof(rec.Acc));
+  memcpy(rec.Gyr, s->Gyr, sizeof(rec.Gyr));
+  memcpy(p->Block + p->Used, &rec, sizeof(rec));
+  p->Used += sizeof(rec);
+  ch.Length += sizeof(rec);
+  ih.Count++;
+  memcpy(p->Block + p->Imu_chunk, &ch, sizeof(ch));
+  memcpy(p->Block + p->Imu_chunk + sizeof(ch), &ih, sizeof(ih));
+  p->Imu_last_us = s->Time_us;
+  return true;
+}
+
+void Logger_Pack_End(Logger_Packer_t *p, uint32_t Seq)
+{
+  const uint32_t body = sizeof(Logger_Block_Header_t);
+  Logger_Block_Header_t h;
+  h.Magic = LOGGER_MAGIC;
+  h.Seq = Seq;
+  h.Used = (uint16_t)p->Used;
+  h.Chunks = p->Chunks;
+  h.Crc = Logger_Crc32(0, p->Block + body, p->Used - body);
+  memcpy(p->Block, &h, sizeof(h));
+  memset(p->Block + p->Used, 0, LOGGER_BLOCK_SIZE - p->Used);
+}
+
+/********************************************************** Write task **********************************************************/
+// Blocks travel as buffer indices: Logger_Free holds the empty ones, Logger_Full the ones waiting for the card.
+typedef struct {
+  uint8_t  Buffer;
+  uint8_t  Command;                                             // LOGGER_CMD_*
+  uint16_t Part;
+} Logger_Item_t;
+
+#define LOGGER_CMD_WRITE     0
+#define LOGGER_CMD_NEW_FILE  1                                  // Open file Part, then write the block
+#define LOGGER_CMD_CLOSE     2                                  // No block
+
+static uint8_t          *Logger_Buf[LOGGER_BUFFERS];
+static QueueHandle_t     Logger_Free = NULL;
+static QueueHandle_t     Logger_Full = NULL;
+static QueueHandle_t     Logger_Events = NULL;
+static SemaphoreHandle_t Logger_Closed = NULL;
+static TaskHandle_t      Logger_Pack_Handle = NULL;
+static TaskHandle_t      Logger_Write_Handle = NULL;
+static uint16_t          Logger_Capture = 0;
+static volatile bool     Logger_Running = false;
+static volatile bool     Logger_Stop_Request = false;
+static Data_Logger_Stats_t Logger_Stats;
+static portMUX_TYPE      Logger_Lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void Logger_Path(char *path, size_t size, uint16_t capture, uint16_t part)
+{
+  snprintf(path, size, LOGGER_DIR "/cap%04u_%03u.bin", capture, part);
+}
+
+static void Logger_Write_Task(void *parameter)
+{
+  int fd = -1;
+  uint32_t unsynced = 0;
+  Logger_Item_t item;
+  char path[48];
+
+  while (1) {
+    xQueueReceive(Logger_Full, &item, portMAX_DELAY);
+    if (item.Command == LOGGER_CMD_CLOSE) {
+      if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+        fd = -1;
+        SD_Index_Note(path);                                    // Final size into the directory index
+      }
+      xSemaphoreGive(Logger_Closed);
+      continue;
+    }
+    if (item.Command == LOGGER_CMD_NEW_FILE) {
+      if (fd >= 0) {
+        close(fd);
+        SD_Index_Note(path);
+      }
+      Logger_Path(path, sizeof(path), Logger_Capture, item.Part);
+      fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0)
+        printf("Logger: cannot create %s\r\n", path);
+      else
+        SD_Index_Note(path);
+      unsynced = 0;
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    bool ok = fd >= 0 && write(fd, Logger_Buf[item.Buffer], LOGGER_BLOCK_SIZE) == LOGGER_BLOCK_SIZE;
+    if (ok && ++unsynced >= LOGGER_SYNC_BLOCKS) {
+      fsync(fd);
+      unsynced = 0;
+    }
+    uint32_t took = (uint32_t)(esp_timer_get_time() - t0);
+    portENTER_CRITICAL(&Logger_Lock);
+    if (ok) {
+      Logger_Stats.Blocks++;
+      Logger_Stats.Bytes += LOGGER_BLOCK_SIZE;
+    } else {
+      Logger_Stats.Write_errors++;
+    }
+    Logger_Stats.Part = item.Part;
+    Logger_Stats.Last_write_us = took;
+    if (took > Logger_Stats.Max_write_us)
+      Logger_Stats.Max_write_us = took;
+    portEXIT_CRITICAL(&Logger_Lock);
+    xQueueSend(Logger_Free, &item.Buffer, 0);
+  }
+}
+
+/********************************************************** Pack task **********************************************************/
+typedef struct {
+  uint8_t  Type;                                                // LOGGER_CHUNK_BATTERY or LOGGER_CHUNK_RTC
+  union {
+    Logger_Battery_t Battery;
+    Logger_Rtc_t     Rtc;
+  };
+} Logger_Event_t;
+
+static Logger_Datetime_t Logger_Last_Rtc;
+static volatile uint32_t Logger_Lost_Events = 0;
+
+static void Logger_Pack_Info(Logger_Packer_t *p, uint16_t part)
+{
+  QMI8658_FIFO_Stats_t fifo;
+  QMI8658_FIFO_Get_Stats(&fifo);
+  Logger_Info_t info = {};
+  info.Version = LOGGER_VERSION;
+  info.Part = part;
+  info.Time_us = esp_timer_get_time();
+  info.Imu_hz = fifo.Odr_hz;
+  info.Acc_scale = IMU_Stream_Acc_Scale();
+  info.Gyr_scale = IMU_Stream_Gyr_Scale();
+  info.Rtc = Logger_Last_Rtc;
+  Logger_Pack_Chunk(p, LOGGER_CHUNK_INFO, &info, sizeof(info));
+}
+
+// State of the capture in progress, owned by the pack task
+static Logger_Packer_t Pack;
+static uint8_t  Pack_buffer;                                    // Index of Pack.Block in Logger_Buf
+static uint32_t Pack_seq;
+static uint32_t Pack_file_blocks;
+static uint16_t Pack_part;
+static uint8_t  Pack_command;                                   // For the next block handed over
+
+static bool Logger_Acquire(void)
+{
+  if (Pack.Block)
+    return true;
+  if (xQueueReceive(Logger_Free, &Pack_buffer, 0) != pdTRUE)
+    return false;
+  Logger_Pack_Begin(&Pack, Logger_Buf[Pack_buffer]);
+  if (Pack_command == LOGGER_CMD_NEW_FILE)
+    Logger_Pack_Info(&Pack, Pack_part);
+  return true;
+}
+
+static void Logger_Submit(void)
+{
+  Logger_Pack_End(&Pack, Pack_seq++);
+  Logger_Item_t item = {Pack_buffer, Pack_command, Pack_part};
+  xQueueSend(Logger_Full, &item, 0);                            // Never full, it has room for every buffer
+  Pack.Block = NULL;
+  Pack_command = LOGGER_CMD_WRITE;
+  if (++Pack_file_blocks >= (uint32_t)LOGGER_FILE_MAX_MB * 1024 * 1024 / LOGGER_BLOCK_SIZE) {
+    Pack_file_blocks = 0;
+    Pack_part++;
+    Pack_command = LOGGER_CMD_NEW_FILE;
+  }
+}
+
+static void Logger_Pack_Task(void *parameter)
+{
+  static IMU_Sample_t batch[64];
+  IMU_Reader_t reader;
+  uint32_t reader_dropped = 0, write_errors = 0;
+  uint32_t lost_imu = 0, lost_events = 0, lost_blocks = 0;      // Not yet reported in a LOSS chunk
+  bool active = false;
+
+  while (1) {
+    vTaskDelay(pdMS_TO_TICKS(LOGGER_PACK_PERIOD_MS));
+    if (!active) {
+      if (!Logger_Running)
+        continue;
+      IMU_Reader_Attach(&reader);                               // A new capture starts from the newest sample
+      reader_dropped = lost_imu = lost_events = lost_blocks = 0;
+      write_errors = 0;
+      Pack.Block = NULL;
+      Pack_seq = Pack_file_blocks = 0;
+      Pack_part = 0;
+      Pack_command = LOGGER_CMD_NEW_FILE;
+      active = true;
+    }
+
+    // Losses the other tasks saw since the last pass
+    uint32_t e = __atomic_exchange_n(&Logger_Lost_Events, 0, __ATOMIC_RELAXED);
+    lost_events += e;
+    portENTER_CRITICAL(&Logger_Lock);
+    lost_blocks += Logger_Stats.Write_errors - write_errors;
+    write_errors = Logger_Stats.Write_errors;
+    Logger_Stats.Lost_events += e;
+    portEXIT_CRITICAL(&Logger_Lock);
+
+    bool stopping = Logger_Stop_Request;
+    uint32_t got;
+    do {
+      if (Logger_Acquire() && (lost_imu || lost_events || lost_blocks)) {
+        Logger_Loss_t loss = {(uint32_t)esp_timer_get_time(), lost_imu, lost_events, lost_blocks};
+        if (Logger_Pack_Chunk(&Pack, LOGGER_CHUNK_LOSS, &loss, sizeof(loss)))
+          lost_imu = lost_events = lost_blocks = 0;
+      }
+      Logger_Event_t ev;
+      while (Pack.Block && xQueuePeek(Logger_Events, &ev, 0) == pdTRUE) {
+        bool packed = ev.Type == LOGGER_CHUNK_BATTERY ? Logger_Pack_Chunk(&Pack, ev.Type, &ev.Battery, sizeof(ev.Battery))
+                                                      : Logger_Pack_Chunk(&Pack, ev.Type, &ev.Rtc, sizeof(ev.Rtc));
+        if (!packed)
+          break;
+        xQueueReceive(Logger_Events, &ev, 0);
+      }
+
+      got = IMU_Reader_Read(&reader, batch, sizeof(batch) / sizeof(batch[0]));
+      lost_imu += reader.Dropped - reader_dropped;
+      uint32_t skipped = reader.Dropped - reader_dropped, i = 0;
+      reader_dropped = reader.Dropped;
+      while (i < got) {
+        if (!Logger_Acquire()) {                                // Both buffers are with the card: drop, never wait
+          lost_imu += got - i;
+          break;
+        }
+        if (Logger_Pack_Imu(&Pack, &batch[i]))
+          i++;
+        else
+          Logger_Submit();                                      // Block full, go on in the other buffer
+      }
+      portENTER_CRITICAL(&Logger_Lock);
+      Logger_Stats.Imu_samples += i;
+      Logger_Stats.Lost_imu += skipped + got - i;
+      portEXIT_CRITICAL(&Logger_Lock);
+    } while (got == sizeof(batch) / sizeof(batch[0]));
+
+    if (stopping) {
+      if (Pack.Block && Pack.Used > sizeof(Logger_Block_Header_t))
+        Logger_Submit();
+      else if (Pack.Block)
+        xQueueSend(Logger_Free, &Pack_buffer, 0);
+      Pack.Block = NULL;
+      Logger_Item_t close_item = {0, LOGGER_CMD_CLOSE, Pack_part};
+      xQueueSend(Logger_Full, &close_item, portMAX_DELAY);
+      xQueueReset(Logger_Events);
+      active = false;
+      Logger_Stop_Request = false;
+      Logger_Running = false;
+      Power_Manager_Release();
+    }
+  }
+}
+
+/********************************************************** Public API **********************************************************/
+static bool Logger_Setup(void)
+{
+  if (Logger_Pack_Handle)
+    return true;
+  for (int i = 0; i < LOGGER_BUFFERS; i++) {
+    // Internal DMA-capable RAM: the SDMMC driver sends these straight to the card as one multi-sector write.
+    // From PSRAM it would go sector by sector through a bounce buffer.
+    Logger_Buf[i] = (uint8_t *)heap_caps_malloc(LOGGER_BLOCK_SIZE, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    if (Logger_Buf[i] == NULL) {
+      printf("Logger: cannot allocate %d x %d bytes of DMA memory\r\n", LOGGER_BUFFERS, LOGGER_BLOCK_SIZE);
+      return false;
+    }
+  }
+  Logger_Free = xQueueCreate(LOGGER_BUFFERS, sizeof(uint8_t));
+  Logger_Full = xQueueCreate(LOGGER_BUFFERS + 1, sizeof(Logger_Item_t));
+  Logger_Events = xQueueCreate(LOGGER_EVENT_QUEUE, sizeof(Logger_Event_t));
+  Logger_Closed = xSemaphoreCreateBinary();
+  if (!Logger_Free || !Logger_Full || !Logger_Events || !Logger_Closed)
+    return false;
+  for (uint8_t i = 0; i < LOGGER_BUFFERS; i++)
+    xQueueSend(Logger_Free, &i, 0);
+  if (xTaskCreatePinnedToCore(Logger_Write_Task, "Logger write", LOGGER_TASK_STACK, NULL, LOGGER_WRITE_PRIORITY,
+                              &Logger_Write_Handle, LOGGER_WRITE_CORE) != pdPASS ||
+      xTaskCreatePinnedToCore(Logger_Pack_Task, "Logger pack", LOGGER_TASK_STACK, NULL, LOGGER_PACK_PRIORITY,
+                              &Logger_Pack_Handle, LOGGER_PACK_CORE) != pdPASS) {
+    printf("Logger task creation failed\r\n");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Start a capture in LOGGER_DIR/capNNNN_000.bin, NNNN being the first unused number.
+ * @return ESP_ERR_INVALID_STATE if a capture is running, ESP_FAIL if the buffers, tasks or directory are unavailable
+ */
+esp_err_t Data_Logger_Start(void)
+{
+  if (Logger_Running)
+    return ESP_ERR_INVALID_STATE;
+  if (!Logger_Setup())
+    return ESP_FAIL;
+  mkdir(LOGGER_DIR, 0755);
+  struct stat st;
+  char path[48];
+  for (Logger_Capture = 0; Logger_Capture < 10000; Logger_Capture++) {
+    Logger_Path(path, sizeof(path), Logger_Capture, 0);
+    if (stat(path, &st) != 0)
+      break;
+  }
+  if (Logger_Capture == 10000) {
+    printf("Logger: no free capture number in %s\r\n", LOGGER_DIR);
+    return ESP_FAIL;
+  }
+  portENTER_CRITICAL(&Logger_Lock);
+  memset(&Logger_Stats, 0, sizeof(Logger_Stats));
+  portEXIT_CRITICAL(&Logger_Lock);
+  Power_Manager_Hold();                                         // Sleep would stop the FIFO under the capture
+  Logger_Running = true;
+  printf("Logger: capturing to %s\r\n", path);
+  return ESP_OK;
+}
+
+void Data_Logger_Stop(void)
+{
+  if (!Logger_Running || Logger_Stop_Request)
+    return;
+  xSemaphoreTake(Logger_Closed, 0);
+  Logger_Stop_Request = true;
+  // The pack task flushes within one period, then the card gets the last blocks
+  if (xSemaphoreTake(Logger_Closed, pdMS_TO_TICKS(5000)) != pdTRUE)
+    printf("Logger: file not closed after 5 s\r\n");
+}
+
+bool Data_Logger_Running(void)
+{
+  return Logger_Running;
+}
+
+static void Logger_Post(const Logger_Event_t *ev)
+{
+  if (xQueueSend(Logger_Events, ev, 0) != pdTRUE)
+    __atomic_add_fetch(&Logger_Lost_Events, 1, __ATOMIC_RELAXED);
+}
+
+void Data_Logger_Battery(float Volts)
+{
+  static uint32_t last_ms = 0;
+  if (!Logger_Running)
+    return;
+  uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+  if (last_ms && now_ms - last_ms < LOGGER_BATTERY_PERIOD_MS)
+    return;
+  last_ms = now_ms;
+  Logger_Event_t ev = {};
+  ev.Type = LOGGER_CHUNK_BATTERY;
+  ev.Battery.Time_us = (uint32_t)esp_timer_get_time();
+  ev.Battery.Millivolts = (uint16_t)(Volts * 1000.0f + 0.5f);
+  Logger_Post(&ev);
+}
+
+void Data_Logger_Rtc(const datetime_t *Time, uint32_t Us)
+{
+  Logger_Datetime_t t = {Time->year, Time->month, Time->day, Time->hour, Time->minute, Time->second, 0};
+  if (memcmp(&t, &Logger_Last_Rtc, sizeof(t)) == 0)
+    return;
+  Logger_Last_Rtc = t;                                          // Also the start time in the next INFO chunk
+  if (!Logger_Running)
+    return;
+  Logger_Event_t ev = {};
+  ev.Type = LOGGER_CHUNK_RTC;
+  ev.Rtc.Time_us = (uint32_t)(esp_timer_get_time() - Us);
+  ev.Rtc.Time = t;
+  Logger_Post(&ev);
+}
+
+void Data_Logger_Get_Stats(Data_Logger_Stats_t *stats)
+{
+  portENTER_CRITICAL(&Logger_Lock);
+  *stats = Logger_Stats;
+  portEXIT_CRITICAL(&Logger_Lock);
+  stats->Running = Logger_Running;
+}
+
+/********************************************************** Benchmark **********************************************************/
+/**
+ * Write LOGGER_BLOCK_SIZE blocks from a DMA buffer to LOGGER_DIR/bench.bin for Seconds, the way the write task does,
+ * and compare the sustained rate with what logging the IMU at its current rate needs.
+ */
+esp_err_t Data_Logger_Bench(uint32_t Seconds)
+{
+  if (Logger_Running)
+    return ESP_ERR_INVALID_STATE;
+  if (!Logger_Setup())
+    return ESP_FAIL;
+  mkdir(LOGGER_DIR, 0755);
+  const char *path = LOGGER_DIR "/bench.bin";
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    printf("Logger bench: cannot create %s\r\n", path);
+    return ESP_FAIL;
+  }
+  uint8_t buf;
+  xQueueReceive(Logger_Free, &buf, portMAX_DELAY);
+  for (uint32_t i = 0; i < LOGGER_BLOCK_SIZE; i++)
+    Logger_Buf[buf][i] = (uint8_t)(i * 31);
+
+  uint32_t blocks = 0, max_us = 0, over_10ms = 0;
+  uint32_t unsynced = 0;
+  bool ok = true;
+  int64_t start = esp_timer_get_time(), end = start + (int64_t)Seconds * 1000000;
+  while (ok && esp_timer_get_time() < end) {
+    int64_t t0 = esp_timer_get_time();
+    ok = write(fd, Logger_Buf[buf], LOGGER_BLOCK_SIZE) == LOGGER_BLOCK_SIZE;
+    if (ok && ++unsynced >= LOGGER_SYNC_BLOCKS) {
+      fsync(fd);
+      unsynced = 0;
+    }
+    uint32_t took = (uint32_t)(esp_timer_get_time() - t0);
+    if (took > max_us)
+      max_us = took;
+    if (took > 10000)
+      over_10ms++;
+    blocks++;
+  }
+  fsync(fd);
+  double secs = (esp_timer_get_time() - start) / 1e6;
+  close(fd);
+  unlink(path);
+  xQueueSend(Logger_Free, &buf, 0);
+
+  QMI8658_FIFO_Stats_t fifo;
+  QMI8658_FIFO_Get_Stats(&fifo);
+  double rate = blocks * (double)LOGGER_BLOCK_SIZE / secs;
+  double needed = fifo.Odr_hz * sizeof(Logger_Imu_Record_t);
+  printf("Logger bench: %lu x %d B in %.1f s, %.0f KB/s sustained, max %lu us/block, %lu blocks over 10 ms\r\n",
+         blocks, LOGGER_BLOCK_SIZE, secs, rate / 1024, max_us, over_10ms);
+  if (needed > 0)
+    printf("Logger bench: IMU at %.1f Hz needs %.1f KB/s, %.0fx headroom; the %d-block buffer rides out %lu ms stalls\r\n",
+           fifo.Odr_hz, needed / 1024, rate / needed, LOGGER_BUFFERS,
+           (uint32_t)((LOGGER_BUFFERS - 1) * LOGGER_BLOCK_SIZE / needed * 1000 + IMU_STREAM_DEPTH * 1000 / fifo.Odr_hz));
+  return ok ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "IMU_Stream.h"
+#include "RTC_PCF85063.h"
+
+/****************************************************** Data logger ******************************************************/
+// Records the IMU stream, battery voltage and RTC time on the SD card in a block-structured binary format that
+// tools/imu_log_decode.py reads. A pack task turns samples into chunks inside fixed-size blocks and hands full blocks
+// to a low-priority write task, so one buffer is filled while the other is written.
+// The sampling side never waits for the card:
+//   - the IMU stream is read through the logger's own cursor, so a late logger shows up as skipped samples;
+//   - battery and RTC records go through a queue that is never waited on;
+//   - when no block buffer is free, samples are counted and dropped.
+// Every loss is written into the log as a LOSS chunk.
+#define LOGGER_BLOCK_SIZE        16384                   // Bytes per write: whole sectors, DMA-capable buffers
+#define LOGGER_BUFFERS           2                       // One packing, the other being written
+#define LOGGER_DIR               "/sdcard/log"
+#define LOGGER_FILE_MAX_MB       1024                    // A capture continues in a new file past this (FAT32: 4 GB max)
+#define LOGGER_SYNC_BLOCKS       64                      // fsync every 1 MB: bounds what a power cut can lose
+#define LOGGER_PACK_PERIOD_MS    50
+#define LOGGER_EVENT_QUEUE       16                      // Battery/RTC records waiting for the pack task
+#define LOGGER_BATTERY_PERIOD_MS 1000                    // Data_Logger_Battery() calls closer than this are ignored
+#define LOGGER_PACK_CORE         1
+#define LOGGER_PACK_PRIORITY     2
+#define LOGGER_WRITE_CORE        0
+#define LOGGER_WRITE_PRIORITY    1                       // Below every task that samples
+#define LOGGER_TASK_STACK        4096
+#ifndef LOGGER_AUTOSTART
+#define LOGGER_AUTOSTART         0                       // Start a capture from setup() when the card is present
+#endif
+
+// Layout, all little endian. A block is a header and chunks; the bytes after Used are zero.
+#define LOGGER_MAGIC             0x424C4D49              // "IMLB"
+#define LOGGER_VERSION           1
+#define LOGGER_CHUNK_INFO        1                       // First chunk of every file
+#define LOGGER_CHUNK_IMU         2
+#define LOGGER_CHUNK_BATTERY     3
+#define LOGGER_CHUNK_RTC         4
+#define LOGGER_CHUNK_LOSS        5
+
+typedef struct __attribute__((packed)) {
+  uint32_t Magic;
+  uint32_t Seq;                                           // Blocks since the capture started
+  uint16_t Used;                                          // Header included
+  uint16_t Chunks;
+  uint32_t Crc;                                           // CRC-32 (zlib) of bytes 16..Used
+} Logger_Block_Header_t;
+
+typedef struct __attribute__((packed)) {
+  uint8_t  Type;                                          // LOGGER_CHUNK_*
+  uint8_t  Reserved;
+  uint16_t Length;                                        // Payload bytes that follow
+} Logger_Chunk_Header_t;
+
+typedef struct __attribute__((packed)) {
+  uint16_t Year;
+  uint8_t  Month;
+  uint8_t  Day;
+  uint8_t  Hour;
+  uint8_t  Minute;
+  uint8_t  Second;
+  uint8_t  Reserved;
+} Logger_Datetime_t;
+
+typedef struct __attribute__((packed)) {
+  uint8_t  Version;
+  uint8_t  Reserved;
+  uint16_t Part;                                          // File number within the capture
+  uint64_t Time_us;                                       // esp_timer time at the start of the file, to unwrap Time_us
+  float    Imu_hz;                                        // Measured FIFO rate
+  float    Acc_scale;                                     // g per count
+  float    Gyr_scale;                                     // dps per count
+  Logger_Datetime_t Rtc;                                  // Wall time as last read from the RTC
+} Logger_Info_t;
+
+// IMU chunk: this header, then Count samples. Time_us of sample n is Time_us plus the Dt_us of samples 1..n.
+typedef struct __attribute__((packed)) {
+  uint32_t Time_us;                                       // Low 32 bits of esp_timer time of the first sample
+  uint16_t Count;
+  uint16_t Reserved;
+} Logger_Imu_Header_t;
+
+typedef struct __attribute__((packed)) {
+  uint16_t Dt_us;                                         // Since the previous sample in the chunk, 0 for the first
+  int16_t  Acc[3];
+  int16_t  Gyr[3];
+} Logger_Imu_Record_t;
+
+typedef struct __attribute__((packed)) {
+  uint32_t Time_us;
+  uint16_t Millivolts;
+  uint16_t Reserved;
+} Logger_Battery_t;
+
+typedef struct __attribute__((packed)) {
+  uint32_t Time_us;                                       // When Time began, as far as the caller knew
+  Logger_Datetime_t Time;
+} Logger_Rtc_t;
+
+typedef struct __attribute__((packed)) {
+  uint32_t Time_us;
+  uint32_t Imu_samples;                                   // Lost since the previous LOSS chunk
+  uint32_t Events;
+  uint32_t Blocks;                                        // Blocks that failed to write
+} Logger_Loss_t;
+
+// Block packing, no RTOS dependencies (also used by the host bench in sim/bench)
+typedef struct {
+  uint8_t *Block;                                         // LOGGER_BLOCK_SIZE bytes
+  uint32_t Used;
+  uint16_t Chunks;
+  uint32_t Imu_chunk;                                     // Offset of the open IMU chunk, 0: none
+  uint32_t Imu_last_us;
+} Logger_Packer_t;
+
+void     Logger_Pack_Begin(Logger_Packer_t *p, uint8_t *Block);
+bool     Logger_Pack_Imu(Logger_Packer_t *p, const IMU_Sample_t *s);              // false: block full
+bool     Logger_Pack_Chunk(Logger_Packer_t *p, uint8_t Type, const void *Payload, uint16_t Length);
+void     Logger_Pack_End(Logger_Packer_t *p, uint32_t Seq);                        // Header, CRC, zero fill
+uint32_t Logger_Crc32(uint32_t Crc, const uint8_t *Data, uint32_t Length);
+
+typedef struct {
+  bool     Running;
+  uint16_t Part;                                          // Current file within the capture
+  uint32_t Blocks;                                        // Written
+  uint64_t Bytes;
+  uint32_t Imu_samples;                                   // Logged
+  uint32_t Lost_imu;                                      // Skipped by the stream or dropped for want of a buffer
+  uint32_t Lost_events;
+  uint32_t Write_errors;                                  // Blocks that did not make it to the card
+  uint32_t Max_write_us;
+  uint32_t Last_write_us;
+} Data_Logger_Stats_t;
+
+esp_err_t Data_Logger_Start(void);                        // After SD_Init() and QMI8658_FIFO_Init(). Holds the device
+                                                          // awake until the capture ends, see Power_Manager_Hold()
+void      Data_Logger_Stop(void);                         // Writes what is packed and closes the file
+bool      Data_Logger_Running(void);
+void      Data_Logger_Battery(float Volts);               // Any task, never blocks
+void      Data_Logger_Rtc(const datetime_t *Time, uint32_t Us = 0);  // Any task, never blocks. Logged when the second
+                                                                     // changes. Us: how far into that second it is
+void      Data_Logger_Get_Stats(Data_Logger_Stats_t *stats);
+esp_err_t Data_Logger_Bench(uint32_t Seconds);            // Sustained block write rate of the card, while not logging
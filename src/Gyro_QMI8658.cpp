@@ -1,4 +1,6 @@
+#include <Arduino.h>
 #include "Gyro_QMI8658.h"
+#include "IMU_Stream.h"
 
 IMUdata Accel;
 IMUdata Gyro;
@@ -12,8 +14,12 @@ sensor_state_t sensor_state = sensor_default;
 lpf_t acc_lpf;
 
 float accelScales, gyroScales;
-uint8_t readings[12];
-uint32_t reading_timestamp_us; // timestamp in arduino micros() time
+static QMI8658_Raw_t readings;              // newest register block, converted to float only when asked for
+static int64_t reading_timestamp_us = 0;    // esp_timer time of that block, 0 before the first read
+static portMUX_TYPE readings_lock = portMUX_INITIALIZER_UNLOCKED;
+static_assert(sizeof(QMI8658_Raw_t) == QMI8658_GZ_H - QMI8658_TIMESTAMP_L + 1, "QMI8658_Raw_t must mirror the register block");
+
+static void QMI8658_CTRL9_Init(void);
 
 /**
  * Inialize Wire and send default configs
@@ -23,6 +29,8 @@ void QMI8658_Init(void)
 {
     uint8_t buf[1];
     Device_addr = QMI8658_L_SLAVE_ADDRESS;     
+    I2C_Add_Device(Device_addr, QMI8658_I2C_Frequency);
+    QMI8658_CTRL9_Init();
     I2C_Read(Device_addr, QMI8658_REVISION_ID, buf, 1);
     printf("QMI8658 Device ID: %x\r\n",buf[0]);    // Get chip id
     setState(sensor_running);             
@@ -61,7 +69,8 @@ void QMI8658_Init(void)
 
 void QMI8658_Loop(void)
 {
-  getAccelerometer();
+  getAccelerometer();                   // polls the block when it is stale; while the FIFO runs the drain keeps it current
+  getGyroscope();                       // same block, no second read
 }
 
 /**
@@ -81,22 +90,103 @@ void QMI8658_transmit(uint8_t addr, uint8_t data)
  */
 uint8_t QMI8658_receive(uint8_t addr)
 {
-    uint8_t retval;
+    uint8_t retval = 0;
     I2C_Read(Device_addr, addr, &retval, 1);
     return retval;
 }
 
+/********************************************************** CTRL9 commands **********************************************************/
+// CmdDone is signalled on INT1 when QMI8658_INT1_PIN is wired: the caller sleeps on a semaphore instead of polling.
+// Without it STATUSINT is polled once per tick, which leaves the bus to everyone else while a command runs.
+static SemaphoreHandle_t ctrl9_done = NULL;
+static SemaphoreHandle_t ctrl9_lock = NULL;     // one command sequence at a time, commands share the CAL registers
+
+static void IRAM_ATTR QMI8658_INT1_ISR(void)
+{
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(ctrl9_done, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void QMI8658_CTRL9_Init(void)
+{
+    if (ctrl9_lock == NULL)
+        ctrl9_lock = xSemaphoreCreateMutex();
+    if (QMI8658_INT1_PIN < 0)
+        return;
+    if (ctrl9_done == NULL)
+        ctrl9_done = xSemaphoreCreateBinary();
+    // CTRL8 bit 7 clear: handshake on INT1, CTRL1 INT1_EN: drive the pin
+    QMI8658_transmit(QMI8658_CTRL8, QMI8658_receive(QMI8658_CTRL8) & ~QMI8658_CTRL8_HANDSHAKE_STATUSINT);
+    QMI8658_transmit(QMI8658_CTRL1, QMI8658_receive(QMI8658_CTRL1) | QMI8658_CTRL1_INT1_EN);
+    pinMode(QMI8658_INT1_PIN, INPUT);
+    attachInterrupt(QMI8658_INT1_PIN, QMI8658_INT1_ISR, RISING);
+}
+
+static bool QMI8658_CTRL9_Wait_Done(void)
+{
+    if (ctrl9_done)
+    {
+        if (xSemaphoreTake(ctrl9_done, pdMS_TO_TICKS(QMI8658_COMM_TIMEOUT)) == pdTRUE)
+            return true;
+        return (QMI8658_receive(QMI8658_STATUSINT) & QMI8658_STATUSINT_CMD_DONE) != 0;  // missed edge
+    }
+    int64_t start = esp_timer_get_time();
+    while ((QMI8658_receive(QMI8658_STATUSINT) & QMI8658_STATUSINT_CMD_DONE) == 0)
+    {
+        if (esp_timer_get_time() - start > QMI8658_COMM_TIMEOUT * 1000)
+            return false;
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+static bool QMI8658_CTRL9_Execute(const QMI8658_CTRL9_Step_t *step)
+{
+    if (step->Cal_len && I2C_Write(Device_addr, QMI8658_CAL1_L, step->Cal, step->Cal_len) != ESP_OK)
+        return false;
+    if (ctrl9_done)
+        xSemaphoreTake(ctrl9_done, 0);          // drop a stale completion
+    if (I2C_Write(Device_addr, QMI8658_CTRL9, &step->Command, 1) != ESP_OK)
+        return false;
+    bool done = QMI8658_CTRL9_Wait_Done();
+    // acknowledge even after a timeout, otherwise CmdDone stays set and the next command looks finished immediately
+    uint8_t ack = QMI8658_CTRL_CMD_ACK;
+    I2C_Write(Device_addr, QMI8658_CTRL9, &ack, 1);
+    return done;
+}
+
 /**
- * Writes data to CTRL9 (command register) and waits for ACK.
- * @param command the command to be executed
+ * Run CTRL9 commands back to back, stopping at the first one that fails.
+ * @param steps commands, each with the CAL1_L.. payload written before it
+ * @param count number of steps
+ * @return false if a write failed or CmdDone did not come within QMI8658_COMM_TIMEOUT
  */
-void QMI8658_CTRL9_Write(uint8_t command)
+bool QMI8658_CTRL9_Sequence(const QMI8658_CTRL9_Step_t *steps, size_t count)
 {
-    // transmit command
-    QMI8658_transmit(QMI8658_CTRL9, command);
+    if (ctrl9_lock == NULL)
+        return false;
+    bool ok = true;
+    xSemaphoreTake(ctrl9_lock, portMAX_DELAY);
+    for (size_t i = 0; i < count && ok; i++)
+    {
+        ok = QMI8658_CTRL9_Execute(&steps[i]);
+        if (!ok)
+            printf("QMI8658 CTRL9 command 0x%02x (step %u of %u) failed\r\n", steps[i].Command, (unsigned)(i + 1), (unsigned)count);
+    }
+    xSemaphoreGive(ctrl9_lock);
+    return ok;
+}
 
-    // wait for command to be done
-    while (((QMI8658_receive(QMI8658_STATUSINT)) & 0x80) == 0x00);
+/**
+ * Issue one CTRL9 command without payload and wait for it.
+ * @param command the command to be executed
+ * @return false if CmdDone did not come within QMI8658_COMM_TIMEOUT
+ */
+bool QMI8658_CTRL9_Write(uint8_t command)
+{
+    QMI8658_CTRL9_Step_t step = {command, 0, {0}};
+    return QMI8658_CTRL9_Sequence(&step, 1);
 }
 
 /**
@@ -247,12 +337,14 @@ void setState(sensor_state_t state)
         // disable AttitudeEngine Motion On Demand
         QMI8658_transmit(QMI8658_CTRL6, 0x00);
 
-        // disable internal AHB clock gating:
-        QMI8658_transmit(QMI8658_CAL1_L, 0x01);
-        QMI8658_CTRL9_Write(0x12);
-        // re-enable clock gating
-        QMI8658_transmit(QMI8658_CAL1_L, 0x00);
-        QMI8658_CTRL9_Write(0x12);
+        {
+            // disable internal AHB clock gating, then re-enable it
+            static const QMI8658_CTRL9_Step_t gating[] = {
+                {QMI8658_CTRL_CMD_AHB_CLOCK_GATING, 1, {0x01}},
+                {QMI8658_CTRL_CMD_AHB_CLOCK_GATING, 1, {0x00}},
+            };
+            QMI8658_CTRL9_Sequence(gating, sizeof(gating) / sizeof(gating[0]));
+        }
         break;
     default:
         break;
@@ -261,29 +353,429 @@ void setState(sensor_state_t state)
 }
 
 
-void getAccelerometer(void)
+/**
+ * Read timestamp, temperature, accelerometer and gyro in one auto-incremented block read (0x30..0x40).
+ * Both sensors come from the same transfer, so they always belong to the same sample.
+ */
+void QMI8658_sensor_update()
+{
+    QMI8658_Raw_t raw;
+    int64_t now = esp_timer_get_time();
+    if (I2C_Read(Device_addr, QMI8658_TIMESTAMP_L, (uint8_t *)&raw, sizeof(raw)) != ESP_OK)
+        return;                                 // keep the previous sample rather than publish garbage
+    portENTER_CRITICAL(&readings_lock);
+    readings = raw;
+    reading_timestamp_us = now;
+    portEXIT_CRITICAL(&readings_lock);
+}
+
+/**
+ * Refresh the block if it is older than QMI8658_REFRESH_DELAY. While the FIFO runs, the drain keeps it current.
+ */
+void QMI8658_update_if_needed()
 {
+    if (QMI8658_FIFO_Running() || QMI8658_WoM_Active())
+        return;
+    if (reading_timestamp_us == 0 || esp_timer_get_time() - reading_timestamp_us >= QMI8658_REFRESH_DELAY)
+        QMI8658_sensor_update();
+}
 
-    uint8_t buf[6];
-    I2C_Read(Device_addr, QMI8658_AX_L, buf, 6);
-    Accel.x = (float)((int16_t)((buf[1]<<8) | (buf[0])));
-    Accel.y = (float)((int16_t)((buf[3]<<8) | (buf[2])));
-    Accel.z = (float)((int16_t)((buf[5]<<8) | (buf[4])));
-    Accel.x = Accel.x * accelScales;
-    Accel.y = Accel.y * accelScales;
-    Accel.z = Accel.z * accelScales;
+/**
+ * Copy of the newest raw block, without touching the bus.
+ * @param raw destination
+ * @return esp_timer time the block was read, 0 if nothing has been read yet
+ */
+int64_t QMI8658_Get_Raw(QMI8658_Raw_t *raw)
+{
+    portENTER_CRITICAL(&readings_lock);
+    *raw = readings;
+    int64_t time_us = reading_timestamp_us;
+    portEXIT_CRITICAL(&readings_lock);
+    return time_us;
+}
 
+/**
+ * Raw accelerometer and gyro values, buf[0..2] acc x/y/z, buf[3..5] gyro x/y/z.
+ */
+void getRawReadings(int16_t* buf)
+{
+    QMI8658_Raw_t raw;
+    QMI8658_update_if_needed();
+    QMI8658_Get_Raw(&raw);
+    for (int axis = 0; axis < 3; axis++)
+    {
+        buf[axis] = raw.Acc[axis];
+        buf[axis + 3] = raw.Gyr[axis];
+    }
+}
+
+float getAccX() { int16_t buf[6]; getRawReadings(buf); return buf[0] * accelScales; }
+float getAccY() { int16_t buf[6]; getRawReadings(buf); return buf[1] * accelScales; }
+float getAccZ() { int16_t buf[6]; getRawReadings(buf); return buf[2] * accelScales; }
+float getGyroX() { int16_t buf[6]; getRawReadings(buf); return buf[3] * gyroScales; }
+float getGyroY() { int16_t buf[6]; getRawReadings(buf); return buf[4] * gyroScales; }
+float getGyroZ() { int16_t buf[6]; getRawReadings(buf); return buf[5] * gyroScales; }
+
+/**
+ * Chip temperature of the newest block, in degrees C.
+ */
+float getTemperature()
+{
+    QMI8658_Raw_t raw;
+    QMI8658_update_if_needed();
+    QMI8658_Get_Raw(&raw);
+    return raw.Temp / 256.0f;
+}
+
+void getAccelerometer(void)
+{
+    int16_t buf[6];
+    getRawReadings(buf);
+    Accel.x = buf[0] * accelScales;
+    Accel.y = buf[1] * accelScales;
+    Accel.z = buf[2] * accelScales;
 }
 void getGyroscope(void)
 {
-    uint8_t buf[6];
-    I2C_Read(Device_addr, QMI8658_GX_L, buf, 6);
-    Gyro.x = (float)((int16_t)((buf[1]<<8) | (buf[0])));
-    Gyro.y = (float)((int16_t)((buf[3]<<8) | (buf[2])));
-    Gyro.z = (float)((int16_t)((buf[5]<<8) | (buf[4])));
-    Gyro.x = Gyro.x * gyroScales;
-    Gyro.y = Gyro.y * gyroScales;
-    Gyro.z = Gyro.z * gyroScales;
+    int16_t buf[6];
+    getRawReadings(buf);                        // same block as getAccelerometer() within QMI8658_REFRESH_DELAY
+    Gyro.x = buf[3] * gyroScales;
+    Gyro.y = buf[4] * gyroScales;
+    Gyro.z = buf[5] * gyroScales;
+}
+
+/********************************************************** FIFO acquisition **********************************************************/
+// ODR in 6-axis mode for each acc_odr_t/gyro_odr_t code, the "8000" setting really runs at 7174.4 Hz
+static const float QMI8658_6DOF_ODR_Hz[9] = {7174.4f, 3587.2f, 1793.6f, 896.8f, 448.4f, 224.2f, 112.1f, 56.05f, 28.025f};
+
+static TaskHandle_t fifo_task = NULL;
+static SemaphoreHandle_t fifo_lock = NULL;      // a drain runs whole, so QMI8658_FIFO_Stop() never lands inside one
+static volatile bool fifo_running = false;
+static volatile uint32_t fifo_irq_us = 0;       // time the watermark was signalled, 0 when not pending
+static uint8_t fifo_ctrl = 0;
+static float fifo_period_us = 0;                // nominal, then measured
+static uint32_t fifo_poll_ms = 1;
+static int64_t fifo_ref_us = 0;                 // reference point for the ODR measurement
+static int64_t fifo_aux_us = 0;                 // last read of TIMESTAMP and TEMP, 0: at the next drain
+static uint32_t fifo_ref_index = 0;
+static QMI8658_FIFO_Stats_t fifo_stats;
+static portMUX_TYPE fifo_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void IRAM_ATTR QMI8658_INT2_ISR(void)
+{
+    fifo_irq_us = (uint32_t)esp_timer_get_time() | 1;  // never 0
+    BaseType_t woken = pdFALSE;
+    if (fifo_task)
+        vTaskNotifyGiveFromISR(fifo_task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void QMI8658_FIFO_Task(void *parameter)
+{
+    while (1)
+    {
+        // woken by the watermark interrupt, the timeout is the polling fallback (and a safety net if an edge is missed)
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(QMI8658_INT2_PIN >= 0 ? fifo_poll_ms * 2 : fifo_poll_ms));
+        if (fifo_running)
+            QMI8658_FIFO_Drain();
+    }
+}
+
+/**
+ * Switch acquisition to the FIFO: both sensors at odr, stream mode, watermark at QMI8658_FIFO_WATERMARK samples.
+ * Samples are published to IMU_Stream with per-sample timestamps and the polled getters follow the newest one.
+ * @param odr output data rate for accelerometer and gyro
+ * @return false if the stream buffer could not be allocated
+ */
+bool QMI8658_FIFO_Init(acc_odr_t odr)
+{
+    if (odr > acc_odr_norm_30 || !IMU_Stream_Init())
+        return false;
+    if (fifo_lock == NULL)
+        fifo_lock = xSemaphoreCreateMutex();
+    QMI8658_FIFO_Stop();
+
+    setAccODR(odr);
+    setGyroODR((gyro_odr_t)odr);
+    IMU_Stream_Set_Scale(accelScales, gyroScales);
+    fifo_period_us = 1e6f / QMI8658_6DOF_ODR_Hz[odr];
+    fifo_poll_ms = (uint32_t)(fifo_period_us * QMI8658_FIFO_WATERMARK / 1000);
+    if (fifo_poll_ms == 0)
+        fifo_poll_ms = 1;
+    fifo_ref_us = 0;
+    fifo_aux_us = 0;
+    portENTER_CRITICAL(&fifo_stats_lock);
+    memset(&fifo_stats, 0, sizeof(fifo_stats));
+    portEXIT_CRITICAL(&fifo_stats_lock);
+
+    fifo_ctrl = QMI8658_FIFO_MODE_STREAM | QMI8658_FIFO_SIZE_128;
+    QMI8658_transmit(QMI8658_FIFO_WTM_TH, QMI8658_FIFO_WATERMARK);
+    QMI8658_transmit(QMI8658_FIFO_CTRL, fifo_ctrl);
+    QMI8658_CTRL9_Write(QMI8658_CTRL_CMD_RST_FIFO);
+
+    if (QMI8658_INT2_PIN >= 0)
+    {
+        QMI8658_transmit(QMI8658_CTRL1, QMI8658_receive(QMI8658_CTRL1) | QMI8658_CTRL1_INT2_EN);
+        pinMode(QMI8658_INT2_PIN, INPUT);
+        attachInterrupt(QMI8658_INT2_PIN, QMI8658_INT2_ISR, RISING);
+    }
+    fifo_irq_us = 0;
+    fifo_running = true;
+    if (fifo_task == NULL &&
+        xTaskCreatePinnedToCore(QMI8658_FIFO_Task, "QMI8658 FIFO task", QMI8658_FIFO_TASK_STACK, NULL,
+                                QMI8658_FIFO_TASK_PRIORITY, &fifo_task, QMI8658_FIFO_TASK_CORE) != pdPASS)
+        printf("QMI8658 FIFO task creation failed, QMI8658_FIFO_Drain() must be called by the owner\r\n");
+    return true;
+}
+
+/**
+ * Back to register polling. The task stays parked until the next QMI8658_FIFO_Init().
+ * Waits for a drain in progress: it would rewrite FIFO_CTRL and turn the FIFO back on after us.
+ */
+void QMI8658_FIFO_Stop(void)
+{
+    if (!fifo_running)
+        return;
+    xSemaphoreTake(fifo_lock, portMAX_DELAY);
+    fifo_running = false;
+    if (QMI8658_INT2_PIN >= 0)
+    {
+        detachInterrupt(QMI8658_INT2_PIN);
+        QMI8658_transmit(QMI8658_CTRL1, QMI8658_receive(QMI8658_CTRL1) & ~QMI8658_CTRL1_INT2_EN);
+    }
+    QMI8658_transmit(QMI8658_FIFO_CTRL, 0x00);  // bypass
+    xSemaphoreGive(fifo_lock);
+}
+
+bool QMI8658_FIFO_Running(void)
+{
+    return fifo_running;
+}
+
+/**
+ * Read everything the FIFO holds in one burst and publish it. Called by the FIFO task.
+ * Runs under fifo_lock, so QMI8658_FIFO_Stop() (and with it QMI8658_WoM_Enable()) waits for it to finish.
+ * @return number of samples read
+ */
+static uint16_t QMI8658_FIFO_Drain_Locked(void);
+
+uint16_t QMI8658_FIFO_Drain(void)
+{
+    if (!fifo_running)
+        return 0;
+    xSemaphoreTake(fifo_lock, portMAX_DELAY);
+    uint16_t n = QMI8658_FIFO_Drain_Locked();   // checks fifo_running again: a Stop may have got the lock first
+    xSemaphoreGive(fifo_lock);
+    return n;
+}
+
+static uint16_t QMI8658_FIFO_Drain_Locked(void)
+{
+    static uint8_t fifo_buf[QMI8658_FIFO_SAMPLES * QMI8658_FIFO_FRAME];
+    static IMU_Sample_t batch[QMI8658_FIFO_SAMPLES];
+    uint8_t level[2];
+
+    if (!fifo_running)
+        return 0;
+    uint32_t irq_us = fifo_irq_us;
+    fifo_irq_us = 0;
+
+    int64_t read_us = esp_timer_get_time();
+    uint16_t n = 0;
+    if (QMI8658_CTRL9_Write(QMI8658_CTRL_CMD_REQ_FIFO) &&     // outside read mode FIFO_DATA returns zeros
+        I2C_Read(Device_addr, QMI8658_FIFO_SMPL_CNT, level, 2) == ESP_OK)
+    {
+        uint32_t bytes = ((((uint32_t)level[1] & 0x03) << 8) | level[0]) * 2;
+        n = bytes / QMI8658_FIFO_FRAME;
+        if (n > QMI8658_FIFO_SAMPLES)
+            n = QMI8658_FIFO_SAMPLES;
+        if (n && I2C_Read(Device_addr, QMI8658_FIFO_DATA, fifo_buf, n * QMI8658_FIFO_FRAME) != ESP_OK)
+            n = 0;
+    }
+    QMI8658_transmit(QMI8658_FIFO_CTRL, fifo_ctrl);    // leave FIFO read mode
+    if (n == 0)
+        return 0;
+    bool lost = level[1] & (QMI8658_FIFO_STATUS_FULL | QMI8658_FIFO_STATUS_OVFL);
+
+    // Timestamps: the watermark interrupt fires as sample WATERMARK-1 lands. Without it, the newest sample
+    // is on average half a period older than the level read.
+    int64_t anchor_us;
+    uint16_t anchor = n - 1;
+    if (irq_us && n >= QMI8658_FIFO_WATERMARK)
+    {
+        anchor_us = read_us - (int32_t)((uint32_t)read_us - irq_us);   // widen the 32-bit ISR time
+        anchor = QMI8658_FIFO_WATERMARK - 1;
+    }
+    else
+        anchor_us = read_us - (int64_t)(fifo_period_us / 2);
+
+    // Measure the real ODR over at least a second; lost samples break the count, so restart then
+    uint32_t anchor_index = fifo_stats.Samples + anchor;
+    if (fifo_ref_us == 0 || lost)
+    {
+        fifo_ref_us = anchor_us;
+        fifo_ref_index = anchor_index;
+    }
+    else if (anchor_index - fifo_ref_index >= (uint32_t)(1e6f / fifo_period_us))
+        fifo_period_us = (float)(anchor_us - fifo_ref_us) / (anchor_index - fifo_ref_index);
+
+    for (uint16_t i = 0; i < n; i++)
+    {
+        const uint8_t *f = &fifo_buf[i * QMI8658_FIFO_FRAME];
+        batch[i].Time_us = (uint32_t)(anchor_us + (int64_t)(((int32_t)i - anchor) * fifo_period_us));
+        for (int axis = 0; axis < 3; axis++)
+        {
+            batch[i].Acc[axis] = (int16_t)((f[axis * 2 + 1] << 8) | f[axis * 2]);
+            batch[i].Gyr[axis] = (int16_t)((f[axis * 2 + 7] << 8) | f[axis * 2 + 6]);
+        }
+    }
+    IMU_Stream_Publish(batch, n);
+
+    // The FIFO holds acc and gyro only: the sample counter and the temperature come from their registers
+    uint8_t aux[QMI8658_AX_L - QMI8658_TIMESTAMP_L];
+    bool aux_read = (fifo_aux_us == 0 || read_us - fifo_aux_us >= QMI8658_FIFO_AUX_MS * 1000LL) &&
+                    I2C_Read(Device_addr, QMI8658_TIMESTAMP_L, aux, sizeof(aux)) == ESP_OK;
+    if (aux_read)
+        fifo_aux_us = read_us;
+
+    const IMU_Sample_t *last = &batch[n - 1];       // the polled getters follow the newest sample
+    portENTER_CRITICAL(&readings_lock);
+    memcpy(readings.Acc, last->Acc, sizeof(readings.Acc));
+    memcpy(readings.Gyr, last->Gyr, sizeof(readings.Gyr));
+    if (aux_read)
+        memcpy(&readings, aux, sizeof(aux));        // Timestamp and Temp lead the block
+    reading_timestamp_us = anchor_us + (int64_t)(((int32_t)(n - 1) - anchor) * fifo_period_us);
+    portEXIT_CRITICAL(&readings_lock);
+    Accel.x = last->Acc[0] * accelScales;           // the exported globals, as QMI8658_Loop() sets them
+    Accel.y = last->Acc[1] * accelScales;
+    Accel.z = last->Acc[2] * accelScales;
+    Gyro.x = last->Gyr[0] * gyroScales;
+    Gyro.y = last->Gyr[1] * gyroScales;
+    Gyro.z = last->Gyr[2] * gyroScales;
+
+    portENTER_CRITICAL(&fifo_stats_lock);
+    fifo_stats.Batches++;
+    fifo_stats.Samples += n;
+    if (lost)
+        fifo_stats.Overflows++;
+    if (n > fifo_stats.Max_batch)
+        fifo_stats.Max_batch = n;
+    if (irq_us)
+        fifo_stats.Irqs++;
+    fifo_stats.Odr_hz = 1e6f / fifo_period_us;
+    portEXIT_CRITICAL(&fifo_stats_lock);
+    return n;
+}
+
+void QMI8658_FIFO_Get_Stats(QMI8658_FIFO_Stats_t *stats)
+{
+    portENTER_CRITICAL(&fifo_stats_lock);
+    *stats = fifo_stats;
+    portEXIT_CRITICAL(&fifo_stats_lock);
+}
+
+/********************************************************** Wake on Motion **********************************************************/
+static volatile bool wom_active = false;
+static volatile bool wom_irq = false;
+static bool wom_fifo = false;                   // FIFO to restart when the engine is turned off
+static acc_odr_t wom_acc_odr;
+
+static void IRAM_ATTR QMI8658_WoM_ISR(void)
+{
+    wom_irq = true;
+}
+
+/**
+ * Power everything down except the accelerometer, in low-power mode, and arm the Wake on Motion engine on it.
+ * Acquisition (FIFO included) stops until QMI8658_WoM_Disable().
+ * @param Threshold_mg change between two samples on any axis that counts as motion, 1..255
+ * @return false if the engine could not be configured, acquisition is then restored
+ */
+bool QMI8658_WoM_Enable(uint8_t Threshold_mg)
+{
+    if (wom_active)
+        return true;
+    if (Threshold_mg == 0)
+        return false;
+    wom_fifo = QMI8658_FIFO_Running();
+    QMI8658_FIFO_Stop();
+    wom_acc_odr = acc_odr;
+
+    QMI8658_transmit(QMI8658_CTRL7, 0x00);      // sensors off while the engine is configured
+    setAccODR(QMI8658_WOM_ODR);
+    // always on INT2: INT1 may carry the CTRL9 handshake
+    QMI8658_CTRL9_Step_t step = {QMI8658_CTRL_CMD_WRITE_WOM_SETTING, 2,
+                                 {Threshold_mg, QMI8658_WOM_CAL1H_INT2 | (QMI8658_WOM_BLANKING & 0x3F)}};
+    if (!QMI8658_CTRL9_Sequence(&step, 1))
+    {
+        printf("QMI8658 Wake on Motion setup failed\r\n");
+        setAccODR(wom_acc_odr);
+        setState(sensor_state);
+        if (wom_fifo)
+            QMI8658_FIFO_Init(wom_acc_odr);
+        return false;
+    }
+    QMI8658_receive(QMI8658_STATUS1);           // drop a stale event
+    wom_irq = false;
+    if (QMI8658_INT2_PIN >= 0)
+    {
+        QMI8658_transmit(QMI8658_CTRL1, QMI8658_receive(QMI8658_CTRL1) | QMI8658_CTRL1_INT2_EN);
+        pinMode(QMI8658_INT2_PIN, INPUT);
+        attachInterrupt(QMI8658_INT2_PIN, QMI8658_WoM_ISR, CHANGE);  // the engine toggles the pin on every event
+    }
+    QMI8658_transmit(QMI8658_CTRL7, 0x01);      // accelerometer only
+    wom_active = true;
+    return true;
+}
+
+/**
+ * Turn the engine off and go back to the acquisition that ran before QMI8658_WoM_Enable().
+ * @return false if a command or the FIFO restart failed
+ */
+bool QMI8658_WoM_Disable(void)
+{
+    if (!wom_active)
+        return true;
+    wom_active = false;
+    if (QMI8658_INT2_PIN >= 0)
+    {
+        detachInterrupt(QMI8658_INT2_PIN);
+        QMI8658_transmit(QMI8658_CTRL1, QMI8658_receive(QMI8658_CTRL1) & ~QMI8658_CTRL1_INT2_EN);
+    }
+    QMI8658_transmit(QMI8658_CTRL7, 0x00);
+    QMI8658_CTRL9_Step_t step = {QMI8658_CTRL_CMD_WRITE_WOM_SETTING, 2, {0x00, 0x00}};  // threshold 0: engine off
+    bool ok = QMI8658_CTRL9_Sequence(&step, 1);
+    wom_irq = false;
+
+    setAccODR(wom_acc_odr);
+    setState(sensor_state);                     // sensors back on as they were
+    if (wom_fifo)
+        ok = QMI8658_FIFO_Init(wom_acc_odr) && ok;
+    return ok;
+}
+
+bool QMI8658_WoM_Active(void)
+{
+    return wom_active;
+}
+
+/**
+ * Whether motion was seen since the last call. With INT2 wired this only reads the flag the interrupt set,
+ * otherwise it costs one STATUS1 read (which clears the event).
+ */
+bool QMI8658_WoM_Poll(void)
+{
+    if (!wom_active)
+        return false;
+    if (QMI8658_INT2_PIN >= 0)
+    {
+        if (!wom_irq)
+            return false;
+        wom_irq = false;
+        QMI8658_receive(QMI8658_STATUS1);
+        return true;
+    }
+    return (QMI8658_receive(QMI8658_STATUS1) & QMI8658_STATUS1_WOM) != 0;
 }
 
 
@@ -5,6 +5,7 @@
 //device address
 #define QMI8658_L_SLAVE_ADDRESS                 (0x6B)
 #define QMI8658_H_SLAVE_ADDRESS                 (0x6A)
+#define QMI8658_I2C_Frequency                   I2C_FM_PLUS_Frequency
 
 #define QMI8658_WHO_AM_I 0x00 // devide identifier
 #define QMI8658_REVISION_ID 0x01
@@ -27,10 +28,20 @@
 #define QMI8658_CAL4_L  0x11  // calibration 4 register, lower bits
 #define QMI8658_CAL4_H  0x12  // calibration 4 register, higher bits
 
+#define QMI8658_TIMESTAMP_L 0x30 // sample counter, 24 bits, followed by TEMP, AX..AZ and GX..GZ
 #define QMI8658_TEMP_L 0x33 // lower bits of temperature data
 #define QMI8658_TEMP_H 0x34 // upper bits of temperature data
 
+#define QMI8658_FIFO_WTM_TH   0x13 // FIFO watermark, in samples
+#define QMI8658_FIFO_CTRL     0x14 // FIFO mode and size, writing it also leaves FIFO read mode
+#define QMI8658_FIFO_SMPL_CNT 0x15 // FIFO level LSB, in 16-bit words
+#define QMI8658_FIFO_STATUS   0x16 // FIFO flags, level MSB in bits 1:0
+#define QMI8658_FIFO_DATA     0x49 // FIFO read port, does not auto-increment
+
 #define QMI8658_STATUSINT 0x2D // status + interrupt register
+#define QMI8658_STATUSINT_CMD_DONE 0x80 // CTRL9 command finished, cleared by QMI8658_CTRL_CMD_ACK
+#define QMI8658_STATUS1 0x2F // motion engine events, cleared on read
+#define QMI8658_STATUS1_WOM 0x04 // Wake on Motion
 
 #define QMI8658_AX_L 0x35 // lower bits of x-axis acceleration
 #define QMI8658_AX_H 0x36 // upper bits of x-axis acceleration
@@ -66,6 +77,44 @@
 
 // control clock gating (necessary to use data locking)
 #define QMI8658_CTRL_CMD_AHB_CLOCK_GATING 0x12
+#define QMI8658_CTRL_CMD_ACK              0x00 // clears CmdDone after a command
+#define QMI8658_CTRL_CMD_RST_FIFO         0x04
+#define QMI8658_CTRL_CMD_REQ_FIFO         0x05 // enter FIFO read mode
+#define QMI8658_CTRL_CMD_WRITE_WOM_SETTING 0x08 // CAL1_L threshold in mg, CAL1_H interrupt pin and blanking
+
+#define QMI8658_FIFO_MODE_STREAM   0x02 // oldest samples are overwritten when full
+#define QMI8658_FIFO_SIZE_128      0x0C
+#define QMI8658_FIFO_STATUS_FULL   0x80
+#define QMI8658_FIFO_STATUS_OVFL   0x20
+#define QMI8658_CTRL1_INT2_EN      0x10
+#define QMI8658_CTRL1_INT1_EN      0x08
+#define QMI8658_CTRL8_HANDSHAKE_STATUSINT 0x80 // CTRL9 handshake on STATUSINT only, clear to signal it on INT1
+
+// CTRL9 completion is taken from INT1 when it is wired, otherwise STATUSINT is polled once per tick
+#ifndef QMI8658_INT1_PIN
+#define QMI8658_INT1_PIN           (-1) // GPIO wired to the QMI8658 INT1, -1 if not routed
+#endif
+
+// FIFO acquisition: the chip buffers samples at the full ODR and a task drains them in burst reads
+// into the IMU_Stream ring. The watermark is signalled on INT2; without it the task polls at the watermark period.
+#ifndef QMI8658_INT2_PIN
+#define QMI8658_INT2_PIN           (-1) // GPIO wired to the QMI8658 INT2, -1 if not routed
+#endif
+#define QMI8658_FIFO_ODR           acc_odr_norm_1000 // 8 kHz also works, but 7174 x 12 bytes/s takes ~80% of the 1 MHz bus
+#define QMI8658_FIFO_SAMPLES       128  // must match QMI8658_FIFO_SIZE_128
+#define QMI8658_FIFO_WATERMARK     64   // half the FIFO, leaves a full watermark period of slack for the drain
+#define QMI8658_FIFO_FRAME         12   // accel + gyro, 6 bytes each
+#define QMI8658_FIFO_TASK_CORE     0
+#define QMI8658_FIFO_TASK_PRIORITY 3
+#define QMI8658_FIFO_TASK_STACK    3072
+#define QMI8658_FIFO_AUX_MS        1000 // the FIFO has no timestamp or temperature, the drain reads them this often
+
+// Wake on Motion: only the accelerometer runs, in low-power mode, and the chip flags a change above the threshold
+// between two samples on any axis. The event is signalled on INT2 when it is wired, STATUS1 is polled otherwise.
+#define QMI8658_WOM_ODR            acc_odr_lp_21 // ~21 Hz, the engine adds at most ~50 ms to the wake latency
+#define QMI8658_WOM_THRESHOLD_MG   60
+#define QMI8658_WOM_BLANKING       4    // samples ignored after arming while the low-power accelerometer settles
+#define QMI8658_WOM_CAL1H_INT2     0x80 // CAL1_H[7:6]: event on INT2, initial level low
 
 
 typedef enum {
@@ -136,11 +185,35 @@ typedef struct __IMUdata {
 extern IMUdata Accel;
 extern IMUdata Gyro;
 
+// Registers QMI8658_TIMESTAMP_L..QMI8658_GZ_H as read in one block. Little endian, like the ESP32.
+typedef struct __attribute__((packed)) {
+    uint8_t Timestamp[3];   // chip sample counter
+    int16_t Temp;           // 1/256 degC
+    int16_t Acc[3];         // x, y, z in accelScales units
+    int16_t Gyr[3];         // x, y, z in gyroScales units
+} QMI8658_Raw_t;
+
+typedef struct {
+    uint8_t Command;        // QMI8658_CTRL_CMD_*
+    uint8_t Cal_len;        // bytes of Cal written to CAL1_L.. before the command, 0 for none
+    uint8_t Cal[8];
+} QMI8658_CTRL9_Step_t;
+
+typedef struct {
+    uint32_t Batches;
+    uint32_t Samples;
+    uint32_t Overflows;     // drains that found the FIFO full, samples were lost on the chip
+    uint32_t Max_batch;
+    uint32_t Irqs;
+    float    Odr_hz;        // measured, the nominal rates are only approximate
+} QMI8658_FIFO_Stats_t;
+
 void QMI8658_Init(void);
 void QMI8658_Loop(void);
 void QMI8658_transmit(uint8_t addr, uint8_t data);
 uint8_t QMI8658_receive(uint8_t addr);
-void QMI8658_CTRL9_Write(uint8_t command);
+bool QMI8658_CTRL9_Write(uint8_t command);
+bool QMI8658_CTRL9_Sequence(const QMI8658_CTRL9_Step_t *steps, size_t count);
 void QMI8658_sensor_update();
 void QMI8658_update_if_needed();
 void setAccODR(acc_odr_t odr);
@@ -150,6 +223,7 @@ void setGyroScale(gyro_scale_t scale);
 void setAccLPF(lpf_t lpf);
 void setGyroLPF(lpf_t lpf);
 void setState(sensor_state_t state);
+int64_t QMI8658_Get_Raw(QMI8658_Raw_t *raw);
 void getRawReadings(int16_t* buf);
 float getAccX();
 float getAccY();
@@ -157,5 +231,17 @@ float getAccZ();
 float getGyroX();
 float getGyroY();
 float getGyroZ();
+float getTemperature();
 void getAccelerometer(void);
-void getGyroscope(void);
\ No newline at end of file
+void getGyroscope(void);
+
+bool QMI8658_FIFO_Init(acc_odr_t odr = QMI8658_FIFO_ODR);
+void QMI8658_FIFO_Stop(void);
+bool QMI8658_FIFO_Running(void);
+uint16_t QMI8658_FIFO_Drain(void);
+void QMI8658_FIFO_Get_Stats(QMI8658_FIFO_Stats_t *stats);
+
+bool QMI8658_WoM_Enable(uint8_t Threshold_mg = QMI8658_WOM_THRESHOLD_MG);
+bool QMI8658_WoM_Disable(void);
+bool QMI8658_WoM_Active(void);
+bool QMI8658_WoM_Poll(void);
\ No newline at end of file
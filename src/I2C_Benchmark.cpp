@@ -0,0 +1,96 @@
+#include "I2C_Benchmark.h"
+#include "Touch_GT911.h"
+#include "Gyro_QMI8658.h"
+#include "RTC_PCF85063.h"
+#include "TCA9554PWR.h"
+
+// The register blocks the drivers actually read in normal operation
+static const I2C_Bench_Target_t I2C_Default_Targets[] = {
+  { "GT911 touch report",   GT911_ADDR,              ESP_LCD_TOUCH_GT911_READ_DATA_REG, 2, 1 + GT911_LCD_TOUCH_MAX_POINTS * 8 },
+  { "QMI8658 accel+gyro",   QMI8658_L_SLAVE_ADDRESS, QMI8658_AX_L,                      1, 12 },
+  { "PCF85063 time",        PCF85063_ADDRESS,        RTC_SECOND_ADDR,                   1, 7 },
+  { "TCA9554 output",       TCA9554_ADDRESS,         TCA9554_OUTPUT_REG,                1, 1 },
+};
+
+#define I2C_BENCH_MAX_LENGTH    64
+#define I2C_BENCH_PIPELINE      4                         // Transactions kept in flight in the asynchronous run
+
+/********************************************************** Runs **********************************************************/
+static void I2C_Bench_Fill(I2C_Transaction_t *trans, const I2C_Bench_Target_t *target, uint8_t *buf)
+{
+  *trans = {};
+  trans->Driver_addr = target->Driver_addr;
+  trans->Reg_addr = target->Reg_addr;
+  trans->Reg_bytes = target->Reg_bytes;
+  trans->Read = true;
+  trans->Data = buf;
+  trans->Length = target->Length;
+  trans->Priority = I2C_PRIO_BACKGROUND;
+}
+
+static void I2C_Bench_Report(const char *Mode, const I2C_Bench_Target_t *target, uint16_t Iterations, uint16_t Errors, int64_t Elapsed_us)
+{
+  uint32_t Bytes = (uint32_t)(Iterations - Errors) * target->Length;
+  printf("%-20s %-6s %5u trans %3u err %8.1f us/trans %8.1f KB/s\r\n", target->Name, Mode, Iterations, Errors,
+         (double)Elapsed_us / Iterations, Bytes * 1000000.0 / 1024.0 / (double)Elapsed_us);
+}
+
+static void I2C_Bench_Sync(const I2C_Bench_Target_t *target, uint16_t Iterations)
+{
+  uint8_t buf[I2C_BENCH_MAX_LENGTH];
+  I2C_Transaction_t trans;
+  uint16_t Errors = 0;
+  int64_t Start_us = esp_timer_get_time();
+  for (uint16_t i = 0; i < Iterations; i++) {
+    I2C_Bench_Fill(&trans, target, buf);
+    if (I2C_Transfer(&trans) != ESP_OK)
+      Errors++;
+  }
+  I2C_Bench_Report("sync", target, Iterations, Errors, esp_timer_get_time() - Start_us);
+}
+
+// Keeps I2C_BENCH_PIPELINE transactions queued so the bus task never idles between them. A transaction that
+// I2C_Submit() refused never completes, so its slot is counted as an error instead of waited on.
+static void I2C_Bench_Async(const I2C_Bench_Target_t *target, uint16_t Iterations)
+{
+  static uint8_t buf[I2C_BENCH_PIPELINE][I2C_BENCH_MAX_LENGTH];
+  static I2C_Transaction_t trans[I2C_BENCH_PIPELINE];
+  bool Queued[I2C_BENCH_PIPELINE];
+  uint16_t Errors = 0, Issued = 0, Done = 0;
+  int64_t Start_us = esp_timer_get_time();
+  for (; Issued < I2C_BENCH_PIPELINE && Issued < Iterations; Issued++) {
+    I2C_Bench_Fill(&trans[Issued], target, buf[Issued]);
+    Queued[Issued] = I2C_Submit(&trans[Issued]) == ESP_OK;
+  }
+  while (Done < Iterations) {
+    uint8_t slot = Done % I2C_BENCH_PIPELINE;
+    if (!Queued[slot] || I2C_Wait(&trans[slot], portMAX_DELAY) != ESP_OK)
+      Errors++;
+    Done++;
+    if (Issued < Iterations) {
+      I2C_Bench_Fill(&trans[slot], target, buf[slot]);
+      Queued[slot] = I2C_Submit(&trans[slot]) == ESP_OK;
+      Issued++;
+    }
+  }
+  I2C_Bench_Report("async", target, Iterations, Errors, esp_timer_get_time() - Start_us);
+}
+
+/********************************************************** Public API **********************************************************/
+void I2C_Benchmark_Targets(const I2C_Bench_Target_t *targets, uint8_t count, uint16_t Iterations)
+{
+  printf("/********** I2C bus benchmark **********/\r\n");
+  I2C_Reset_Stats();
+  for (uint8_t i = 0; i < count; i++) {
+    if (targets[i].Length > I2C_BENCH_MAX_LENGTH)
+      continue;
+    I2C_Bench_Sync(&targets[i], Iterations);
+    I2C_Bench_Async(&targets[i], Iterations);
+  }
+  I2C_Print_Stats();
+  printf("/******* I2C bus benchmark Over ********/\r\n\r\n");
+}
+void I2C_Benchmark(uint16_t Iterations)
+{
+  I2C_Benchmark_Targets(I2C_Default_Targets, sizeof(I2C_Default_Targets) / sizeof(I2C_Default_Targets[0]), Iterations);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "I2C_Driver.h"
+
+#define I2C_BENCH_ITERATIONS    200                       // Transactions per device and mode
+
+typedef struct {
+  const char *Name;
+  uint8_t     Driver_addr;
+  uint16_t    Reg_addr;
+  uint8_t     Reg_bytes;
+  uint32_t    Length;
+} I2C_Bench_Target_t;
+
+void I2C_Benchmark(uint16_t Iterations = I2C_BENCH_ITERATIONS);                                           // Runs the default device set below
+void I2C_Benchmark_Targets(const I2C_Bench_Target_t *targets, uint8_t count, uint16_t Iterations);
@@ -1,34 +1,220 @@
-#include "I2C_Driver.h"                    
+#include "I2C_Driver.h"
+#include "I2C_Trace.h"
 
+static QueueHandle_t     I2C_Queue[I2C_PRIO_COUNT] = {NULL};
+static SemaphoreHandle_t I2C_Pending = NULL;                    // Counts transactions waiting in any queue
+static TaskHandle_t      I2C_Task = NULL;
+static const I2C_Transport_t *I2C_Transport = NULL;
+
+static I2C_Stats_t I2C_Stats[I2C_MAX_DEVICES];
+static portMUX_TYPE I2C_Stats_Lock = portMUX_INITIALIZER_UNLOCKED;
+
+/********************************************************** Bus access (owner task only) **********************************************************/
+static esp_err_t I2C_Execute(I2C_Transaction_t *trans)
+{
+  uint8_t Reg_buf[2];
+  size_t  Reg_len = 0;
+  if (trans->Reg_bytes == 2)
+    Reg_buf[Reg_len++] = (uint8_t)(trans->Reg_addr >> 8);
+  Reg_buf[Reg_len++] = (uint8_t)trans->Reg_addr;
+
+  if (trans->Read)
+    return I2C_Transport->Read(trans->Driver_addr, Reg_buf, Reg_len, trans->Data, trans->Length);
+  return I2C_Transport->Write(trans->Driver_addr, Reg_buf, Reg_len, trans->Data, trans->Length);
+}
+
+static void I2C_Account(const I2C_Transaction_t *trans, int64_t Start_us, int64_t End_us)
+{
+  uint32_t Wait_us = (uint32_t)(Start_us - trans->Queued_us);
+  portENTER_CRITICAL(&I2C_Stats_Lock);
+  I2C_Stats_t *stats = NULL;
+  for (int i = 0; i < I2C_MAX_DEVICES; i++) {
+    if (I2C_Stats[i].Driver_addr == trans->Driver_addr || I2C_Stats[i].Driver_addr == 0) {
+      stats = &I2C_Stats[i];
+      break;
+    }
+  }
+  if (stats) {
+    stats->Driver_addr = trans->Driver_addr;
+    stats->Transactions++;
+    if (trans->Result != ESP_OK)
+      stats->Errors++;
+    else
+      stats->Bytes += trans->Length;
+    stats->Busy_us += End_us - Start_us;
+    stats->Wait_us += Wait_us;
+    if (Wait_us > stats->Max_wait_us)
+      stats->Max_wait_us = Wait_us;
+  }
+  portEXIT_CRITICAL(&I2C_Stats_Lock);
+}
+
+// Runs the transfer and signals the submitter. The descriptor must not be touched after Done is given:
+// synchronous callers keep it on their stack and return as soon as they wake up. A callback is read before that and
+// runs last, so it may free or resubmit the descriptor; I2C_Transfer() refuses transactions that have one.
+static void I2C_Complete(I2C_Transaction_t *trans)
+{
+  int64_t Start_us = esp_timer_get_time();
+  esp_err_t Result = I2C_Execute(trans);
+  int64_t End_us = esp_timer_get_time();
+  trans->Result = Result;
+  I2C_Account(trans, Start_us, End_us);
+  I2C_TRACE_RECORD(trans, Start_us, End_us);
+  if (Result != ESP_OK)
+    printf("The I2C transmission fails. - addr 0x%02x reg 0x%04x %s: %s\r\n", trans->Driver_addr, trans->Reg_addr,
+           trans->Read ? "read" : "write", esp_err_to_name(Result));
+  I2C_Callback_t Callback = trans->Callback;
+  xSemaphoreGive(trans->Done);
+  if (Callback)
+    Callback(trans);
+}
+
+static void I2C_Bus_Task(void *parameter)
+{
+  I2C_Transaction_t *trans;
+  while (1) {
+    xSemaphoreTake(I2C_Pending, portMAX_DELAY);
+    for (int p = 0; p < I2C_PRIO_COUNT; p++) {                  // Highest class first, so touch reads overtake queued sensor polls
+      if (xQueueReceive(I2C_Queue[p], &trans, 0) == pdTRUE) {
+        I2C_Complete(trans);
+        break;
+      }
+    }
+  }
+}
+
+/********************************************************** Public API **********************************************************/
 void I2C_Init(void) {
-  Wire.begin( I2C_SDA_PIN, I2C_SCL_PIN, I2C_Frequency);                       
+  if (I2C_Transport == NULL)
+    I2C_Transport = I2C_Default_Transport();
+  if (I2C_Transport->Init() != ESP_OK) {
+    printf("I2C bus initialization failed! (%s)\r\n", I2C_Transport->Name);
+    I2C_Transport = NULL;
+    return;
+  }
+
+  for (int p = 0; p < I2C_PRIO_COUNT; p++)
+    I2C_Queue[p] = xQueueCreate(I2C_QUEUE_LEN, sizeof(I2C_Transaction_t *));
+  I2C_Pending = xSemaphoreCreateCounting(I2C_PRIO_COUNT * I2C_QUEUE_LEN, 0);
+  xTaskCreatePinnedToCore(I2C_Bus_Task, "I2C bus task", I2C_TASK_STACK, NULL, I2C_TASK_PRIORITY, &I2C_Task, I2C_TASK_CORE);
+}
+
+void I2C_Set_Transport(const I2C_Transport_t *transport)
+{
+  I2C_Transport = transport;
 }
-// 寄存器地址为 8 位的
-bool I2C_Read(uint8_t Driver_addr, uint8_t Reg_addr, uint8_t *Reg_data, uint32_t Length)
+
+void I2C_Add_Device(uint8_t Driver_addr, uint32_t Speed_hz)
 {
-  Wire.beginTransmission(Driver_addr);
-  Wire.write(Reg_addr); 
-  if ( Wire.endTransmission(true)){
-    printf("The I2C transmission fails. - I2C Read\r\n");
-    return -1;
+  if (Speed_hz > I2C_MAX_Frequency)
+    Speed_hz = I2C_MAX_Frequency;
+  if (I2C_Transport)
+    I2C_Transport->Set_Speed(Driver_addr, Speed_hz);
+}
+
+esp_err_t I2C_Submit(I2C_Transaction_t *trans)
+{
+  if (trans == NULL || trans->Priority >= I2C_PRIO_COUNT)
+    return ESP_ERR_INVALID_ARG;
+  trans->Done = xSemaphoreCreateBinaryStatic(&trans->Done_buf);
+  trans->Result = ESP_ERR_NOT_FINISHED;
+  trans->Queued_us = esp_timer_get_time();
+
+  if (I2C_Transport == NULL) {
+    trans->Result = ESP_ERR_INVALID_STATE;
+    return ESP_ERR_INVALID_STATE;
+  }
+  // Before the bus task exists, or when a completion callback issues a nested transfer, run it in place
+  if (I2C_Task == NULL || xTaskGetCurrentTaskHandle() == I2C_Task) {
+    I2C_Complete(trans);
+    return ESP_OK;
   }
-  Wire.requestFrom(Driver_addr, Length);
-  for (int i = 0; i < Length; i++) {
-    *Reg_data++ = Wire.read();
+  if (xQueueSend(I2C_Queue[trans->Priority], &trans, pdMS_TO_TICKS(I2C_TIMEOUT_MS)) != pdTRUE) {
+    printf("I2C queue full, transaction dropped. - addr 0x%02x\r\n", trans->Driver_addr);
+    trans->Result = ESP_ERR_TIMEOUT;
+    return ESP_ERR_TIMEOUT;
   }
-  return 0;
+  xSemaphoreGive(I2C_Pending);
+  return ESP_OK;
+}
+
+esp_err_t I2C_Wait(I2C_Transaction_t *trans, uint32_t Timeout_ms)
+{
+  if (xSemaphoreTake(trans->Done, pdMS_TO_TICKS(Timeout_ms)) != pdTRUE)
+    return ESP_ERR_TIMEOUT;
+  return trans->Result;
+}
+
+esp_err_t I2C_Transfer(I2C_Transaction_t *trans)
+{
+  if (trans != NULL && trans->Callback != NULL)                 // It would run on a stack frame already returned
+    return ESP_ERR_INVALID_ARG;
+  esp_err_t ret = I2C_Submit(trans);
+  if (ret != ESP_OK)
+    return ret;
+  // Every transfer is bounded by I2C_TIMEOUT_MS in the driver, so waiting forever here cannot hang;
+  // returning early would leave the bus task writing into a dead stack frame.
+  return I2C_Wait(trans, portMAX_DELAY);
 }
-bool I2C_Write(uint8_t Driver_addr, uint8_t Reg_addr, const uint8_t *Reg_data, uint32_t Length)
+
+esp_err_t I2C_Read(uint8_t Driver_addr, uint8_t Reg_addr, uint8_t *Reg_data, uint32_t Length)
 {
-  Wire.beginTransmission(Driver_addr);
-  Wire.write(Reg_addr);       
-  for (int i = 0; i < Length; i++) {
-    Wire.write(*Reg_data++);
+  I2C_Transaction_t trans = {};
+  trans.Driver_addr = Driver_addr;
+  trans.Reg_addr = Reg_addr;
+  trans.Reg_bytes = 1;
+  trans.Read = true;
+  trans.Data = Reg_data;
+  trans.Length = Length;
+  trans.Priority = I2C_PRIO_NORMAL;
+  return I2C_Transfer(&trans);
+}
+esp_err_t I2C_Write(uint8_t Driver_addr, uint8_t Reg_addr, const uint8_t *Reg_data, uint32_t Length)
+{
+  I2C_Transaction_t trans = {};
+  trans.Driver_addr = Driver_addr;
+  trans.Reg_addr = Reg_addr;
+  trans.Reg_bytes = 1;
+  trans.Read = false;
+  trans.Data = (uint8_t *)Reg_data;                     // Only read from for writes
+  trans.Length = Length;
+  trans.Priority = I2C_PRIO_NORMAL;
+  return I2C_Transfer(&trans);
+}
+
+/********************************************************** Statistics **********************************************************/
+bool I2C_Get_Stats(uint8_t Driver_addr, I2C_Stats_t *stats)
+{
+  bool found = false;
+  portENTER_CRITICAL(&I2C_Stats_Lock);
+  for (int i = 0; i < I2C_MAX_DEVICES; i++) {
+    if (I2C_Stats[i].Driver_addr == Driver_addr) {
+      *stats = I2C_Stats[i];
+      found = true;
+      break;
+    }
   }
-  if ( Wire.endTransmission(true))
-  {
-    printf("The I2C transmission fails. - I2C Write\r\n");
-    return -1;
+  portEXIT_CRITICAL(&I2C_Stats_Lock);
+  return found;
+}
+void I2C_Reset_Stats(void)
+{
+  portENTER_CRITICAL(&I2C_Stats_Lock);
+  memset(I2C_Stats, 0, sizeof(I2C_Stats));
+  portEXIT_CRITICAL(&I2C_Stats_Lock);
+}
+void I2C_Print_Stats(void)
+{
+  I2C_Stats_t snapshot[I2C_MAX_DEVICES];
+  portENTER_CRITICAL(&I2C_Stats_Lock);
+  memcpy(snapshot, I2C_Stats, sizeof(snapshot));
+  portEXIT_CRITICAL(&I2C_Stats_Lock);
+
+  printf("/********** I2C bus statistics **********/\r\n");
+  for (int i = 0; i < I2C_MAX_DEVICES && snapshot[i].Driver_addr; i++) {
+    I2C_Stats_t *s = &snapshot[i];
+    printf("0x%02x: %lu trans, %lu err, %lu bytes, busy %llu us, avg wait %llu us, max wait %lu us\r\n",
+           s->Driver_addr, s->Transactions, s->Errors, s->Bytes, s->Busy_us,
+           s->Transactions ? s->Wait_us / s->Transactions : 0, s->Max_wait_us);
   }
-  return 0;
-}
\ No newline at end of file
+}
@@ -1,10 +1,76 @@
 #pragma once
-#include <Wire.h> 
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "I2C_Transport.h"
 
 #define I2C_SCL_PIN       7
 #define I2C_SDA_PIN       15
-#define I2C_Frequency     800000
+#define I2C_PORT          I2C_NUM_0
+#define I2C_Frequency     800000                          // Default SCL rate for devices that do not register their own
+#define I2C_FM_PLUS_Frequency  1000000                    // Fast-mode Plus, for devices that support it (GT911, QMI8658)
+#define I2C_MAX_Frequency      1000000                    // Upper bound the bus pull-ups can sustain, per-device requests are clamped to it
+
+/****************************************************** Bus manager ******************************************************/
+// All transfers go through a single owner task, so the LVGL loop (core 1) and Driver_Loop (core 0) never drive the bus concurrently.
+#define I2C_TASK_CORE         0
+#define I2C_TASK_PRIORITY     4                           // Above Driver_Loop (3) so queued work is drained promptly
+#define I2C_TASK_STACK        3072
+#define I2C_QUEUE_LEN         8                           // Per priority class
+#define I2C_TIMEOUT_MS        50                          // Per-transfer timeout handed to the i2c_master driver
+#define I2C_MAX_DEVICES       8                           // Size of the per-device statistics table
+
+typedef enum {
+  I2C_PRIO_TOUCH = 0,                                     // Serviced before anything else queued (GT911 reads)
+  I2C_PRIO_NORMAL,                                        // Sensor polls, RTC, IO expander
+  I2C_PRIO_BACKGROUND,                                    // Bulk transfers that can wait
+  I2C_PRIO_COUNT
+} I2C_Priority_t;
+
+typedef struct I2C_Transaction I2C_Transaction_t;
+typedef void (*I2C_Callback_t)(I2C_Transaction_t *trans);
+
+struct I2C_Transaction {
+  uint8_t           Driver_addr;
+  uint16_t          Reg_addr;
+  uint8_t           Reg_bytes;                            // 1 for 8-bit register addresses, 2 for the GT911's 16-bit ones
+  bool              Read;
+  uint8_t          *Data;                                 // Read destination or write source, must stay valid until completion
+  uint32_t          Length;
+  I2C_Priority_t    Priority;
+  I2C_Callback_t    Callback;                             // Runs on the bus task once the transfer is done, may be NULL.
+                                                          // Runs after Done is given and owns the descriptor from then:
+                                                          // free or reuse it there, not after I2C_Wait()
+  void             *User_data;
+  volatile esp_err_t Result;                              // ESP_ERR_NOT_FINISHED while queued or in flight
+  int64_t           Queued_us;
+  SemaphoreHandle_t Done;                                 // Given on completion, see I2C_Wait()
+  StaticSemaphore_t Done_buf;
+};
+
+typedef struct {
+  uint8_t  Driver_addr;
+  uint32_t Transactions;
+  uint32_t Errors;
+  uint32_t Bytes;
+  uint64_t Busy_us;                                       // Time the bus spent on this device
+  uint64_t Wait_us;                                       // Total time transactions sat in the queue
+  uint32_t Max_wait_us;
+} I2C_Stats_t;
 
 void I2C_Init(void);
-bool I2C_Read(uint8_t Driver_addr, uint8_t Reg_addr, uint8_t *Reg_data, uint32_t Length);
-bool I2C_Write(uint8_t Driver_addr, uint8_t Reg_addr, const uint8_t *Reg_data, uint32_t Length);
\ No newline at end of file
+void I2C_Set_Transport(const I2C_Transport_t *transport);  // Call before I2C_Init to replace the default backend
+void I2C_Add_Device(uint8_t Driver_addr, uint32_t Speed_hz);  // Optional, unregistered devices run at I2C_Frequency
+// 寄存器地址为 8 位的
+esp_err_t I2C_Read(uint8_t Driver_addr, uint8_t Reg_addr, uint8_t *Reg_data, uint32_t Length);
+esp_err_t I2C_Write(uint8_t Driver_addr, uint8_t Reg_addr, const uint8_t *Reg_data, uint32_t Length);
+
+esp_err_t I2C_Submit(I2C_Transaction_t *trans);           // Queue a transaction and return immediately
+esp_err_t I2C_Wait(I2C_Transaction_t *trans, uint32_t Timeout_ms);  // Block until a submitted transaction completes
+esp_err_t I2C_Transfer(I2C_Transaction_t *trans);         // Submit + wait
+
+bool I2C_Get_Stats(uint8_t Driver_addr, I2C_Stats_t *stats);
+void I2C_Reset_Stats(void);
+void I2C_Print_Stats(void);
@@ -0,0 +1,114 @@
+#include "I2C_Driver.h"
+#include "driver/i2c_master.h"
+
+static i2c_master_bus_handle_t I2C_Bus = NULL;
+
+typedef struct {
+  uint8_t                 Driver_addr;
+  uint32_t                Speed_hz;                             // Requested SCL rate
+  uint32_t                Handle_speed_hz;                      // Rate the current handle was created with
+  i2c_master_dev_handle_t Handle;
+} I2C_Device_t;
+static I2C_Device_t I2C_Devices[I2C_MAX_DEVICES];
+static portMUX_TYPE I2C_Devices_Lock = portMUX_INITIALIZER_UNLOCKED;
+
+static I2C_Device_t *I2C_Find_Device(uint8_t Driver_addr)          // Returns the slot for Driver_addr, claiming a free one if needed
+{
+  for (int i = 0; i < I2C_MAX_DEVICES; i++) {
+    if (I2C_Devices[i].Driver_addr == Driver_addr)
+      return &I2C_Devices[i];
+    if (I2C_Devices[i].Driver_addr == 0) {
+      I2C_Devices[i].Driver_addr = Driver_addr;
+      I2C_Devices[i].Speed_hz = I2C_Frequency;
+      return &I2C_Devices[i];
+    }
+  }
+  return NULL;
+}
+
+static i2c_master_dev_handle_t I2C_Get_Handle(uint8_t Driver_addr)
+{
+  portENTER_CRITICAL(&I2C_Devices_Lock);
+  I2C_Device_t *dev = I2C_Find_Device(Driver_addr);
+  portEXIT_CRITICAL(&I2C_Devices_Lock);
+  if (dev == NULL)
+    return NULL;
+  if (dev->Handle && dev->Handle_speed_hz != dev->Speed_hz) {   // Speed changed by I2C_Add_Device()
+    i2c_master_bus_rm_device(dev->Handle);
+    dev->Handle = NULL;
+  }
+  if (dev->Handle == NULL) {
+    i2c_device_config_t dev_cfg = {};
+    dev_cfg.dev_addr_length = I2C_ADDR_BIT_LEN_7;
+    dev_cfg.device_address = Driver_addr;
+    dev_cfg.scl_speed_hz = dev->Speed_hz;
+    if (i2c_master_bus_add_device(I2C_Bus, &dev_cfg, &dev->Handle) != ESP_OK)
+      return NULL;
+    dev->Handle_speed_hz = dev->Speed_hz;
+  }
+  return dev->Handle;
+}
+
+/********************************************************** Transport **********************************************************/
+static esp_err_t I2C_Master_Init(void)
+{
+  i2c_master_bus_config_t bus_cfg = {};
+  bus_cfg.i2c_port = I2C_PORT;
+  bus_cfg.sda_io_num = (gpio_num_t)I2C_SDA_PIN;
+  bus_cfg.scl_io_num = (gpio_num_t)I2C_SCL_PIN;
+  bus_cfg.clk_source = I2C_CLK_SRC_DEFAULT;
+  bus_cfg.glitch_ignore_cnt = 7;
+  bus_cfg.flags.enable_internal_pullup = true;
+  return i2c_new_master_bus(&bus_cfg, &I2C_Bus);
+}
+
+static void I2C_Master_Set_Speed(uint8_t Driver_addr, uint32_t Speed_hz)
+{
+  portENTER_CRITICAL(&I2C_Devices_Lock);
+  I2C_Device_t *dev = I2C_Find_Device(Driver_addr);
+  if (dev)
+    dev->Speed_hz = Speed_hz;                                   // The handle is (re)created by the bus task on next use
+  portEXIT_CRITICAL(&I2C_Devices_Lock);
+  if (dev == NULL)
+    printf("I2C device table full, 0x%02x runs at the default speed\r\n", Driver_addr);
+}
+
+// Reads land directly in the caller's buffer and writes are sent from it, so nothing is copied byte by byte.
+static esp_err_t I2C_Master_Read(uint8_t Driver_addr, const uint8_t *Reg, size_t Reg_len, uint8_t *Data, size_t Length)
+{
+  i2c_master_dev_handle_t handle = I2C_Get_Handle(Driver_addr);
+  if (handle == NULL)
+    return ESP_ERR_NO_MEM;
+  esp_err_t ret = i2c_master_transmit_receive(handle, Reg, Reg_len, Data, Length, I2C_TIMEOUT_MS);
+  if (ret == ESP_ERR_TIMEOUT)
+    i2c_master_bus_reset(I2C_Bus);                              // Release a slave that is holding SDA low
+  return ret;
+}
+
+static esp_err_t I2C_Master_Write(uint8_t Driver_addr, const uint8_t *Reg, size_t Reg_len, const uint8_t *Data, size_t Length)
+{
+  i2c_master_dev_handle_t handle = I2C_Get_Handle(Driver_addr);
+  if (handle == NULL)
+    return ESP_ERR_NO_MEM;
+  i2c_master_transmit_multi_buffer_info_t bufs[2] = {
+    { .write_buffer = (uint8_t *)Reg,  .buffer_size = Reg_len },
+    { .write_buffer = (uint8_t *)Data, .buffer_size = Length },
+  };
+  esp_err_t ret = i2c_master_multi_buffer_transmit(handle, bufs, Length ? 2 : 1, I2C_TIMEOUT_MS);
+  if (ret == ESP_ERR_TIMEOUT)
+    i2c_master_bus_reset(I2C_Bus);
+  return ret;
+}
+
+static const I2C_Transport_t I2C_Master_Transport = {
+  "i2c_master",
+  I2C_Master_Init,
+  I2C_Master_Set_Speed,
+  I2C_Master_Read,
+  I2C_Master_Write,
+};
+
+const I2C_Transport_t *I2C_Default_Transport(void)
+{
+  return &I2C_Master_Transport;
+}
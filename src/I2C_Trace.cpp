@@ -0,0 +1,148 @@
+#include "I2C_Trace.h"
+
+#if I2C_TRACE_ENABLE
+
+#include <Arduino.h>
+#include "I2C_Driver.h"
+
+// Only the bus task writes records, so the ring needs no lock. Dumps pause recording while they copy; what the bus
+// does meanwhile is counted as lost and reported in the next dump's Dropped.
+static I2C_Trace_Record_t I2C_Trace_Ring[I2C_TRACE_DEPTH];
+static volatile uint32_t  I2C_Trace_Head = 0;                   // Total records ever written
+static volatile uint32_t  I2C_Trace_Base = 0;                   // Head value at the last clear
+static volatile bool      I2C_Trace_Paused = false;
+static volatile uint32_t  I2C_Trace_Lost = 0;                   // Transactions not recorded while paused, since the clear
+
+static uint16_t I2C_Trace_Saturate(int64_t us)
+{
+  return us > 0xFFFF ? 0xFFFF : (us < 0 ? 0 : (uint16_t)us);
+}
+
+void I2C_Trace_Record(const struct I2C_Transaction *trans, int64_t Start_us, int64_t End_us)
+{
+  if (I2C_Trace_Paused) {
+    I2C_Trace_Lost = I2C_Trace_Lost + 1;
+    return;
+  }
+  I2C_Trace_Record_t *rec = &I2C_Trace_Ring[I2C_Trace_Head & (I2C_TRACE_DEPTH - 1)];
+  rec->Start_us = (uint32_t)Start_us;
+  rec->Duration_us = I2C_Trace_Saturate(End_us - Start_us);
+  rec->Wait_us = I2C_Trace_Saturate(Start_us - trans->Queued_us);
+  rec->Reg_addr = trans->Reg_addr;
+  rec->Length = trans->Length > 0xFFFF ? 0xFFFF : trans->Length;
+  rec->Driver_addr = (trans->Driver_addr & 0x7F) | (trans->Read ? 0x80 : 0x00);
+  switch (trans->Result) {
+    case ESP_OK:          rec->Result = I2C_TRACE_RESULT_OK; break;
+    case ESP_ERR_TIMEOUT: rec->Result = I2C_TRACE_RESULT_TIMEOUT; break;
+    case ESP_FAIL:        rec->Result = I2C_TRACE_RESULT_FAIL; break;
+    default:              rec->Result = I2C_TRACE_RESULT_OTHER; break;
+  }
+  rec->Priority = trans->Priority;
+  rec->Reserved = 0;
+  I2C_Trace_Head = I2C_Trace_Head + 1;
+}
+
+void I2C_Trace_Clear(void)
+{
+  I2C_Trace_Base = I2C_Trace_Head;
+  I2C_Trace_Lost = 0;
+}
+uint32_t I2C_Trace_Count(void)
+{
+  uint32_t count = I2C_Trace_Head - I2C_Trace_Base;
+  return count > I2C_TRACE_DEPTH ? I2C_TRACE_DEPTH : count;
+}
+
+/********************************************************** Occupancy **********************************************************/
+void I2C_Trace_Print_Occupancy(void)
+{
+  struct { uint8_t Addr; uint32_t Count; uint32_t Errors; uint64_t Busy_us; uint32_t Max_wait_us; } dev[I2C_MAX_DEVICES] = {};
+  I2C_Trace_Paused = true;
+  uint32_t count = I2C_Trace_Count();
+  uint32_t first = I2C_Trace_Head - count;
+  uint32_t Window_start = 0, Window_end = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    const I2C_Trace_Record_t *rec = &I2C_Trace_Ring[(first + i) & (I2C_TRACE_DEPTH - 1)];
+    if (i == 0)
+      Window_start = rec->Start_us;
+    Window_end = rec->Start_us + rec->Duration_us;
+    for (int d = 0; d < I2C_MAX_DEVICES; d++) {
+      if (dev[d].Count == 0 || dev[d].Addr == (rec->Driver_addr & 0x7F)) {
+        dev[d].Addr = rec->Driver_addr & 0x7F;
+        dev[d].Count++;
+        dev[d].Errors += rec->Result != I2C_TRACE_RESULT_OK;
+        dev[d].Busy_us += rec->Duration_us;
+        if (rec->Wait_us > dev[d].Max_wait_us)
+          dev[d].Max_wait_us = rec->Wait_us;
+        break;
+      }
+    }
+  }
+  I2C_Trace_Paused = false;
+
+  uint32_t Window_us = Window_end - Window_start;                 // Wraps correctly on the 32-bit timestamp
+  printf("/********** I2C bus occupancy (%lu trans over %lu us) **********/\r\n", count, Window_us);
+  uint64_t Total_busy = 0;
+  for (int d = 0; d < I2C_MAX_DEVICES && dev[d].Count; d++) {
+    Total_busy += dev[d].Busy_us;
+    printf("0x%02x: %5lu trans %3lu err busy %8llu us (%5.1f%%) max wait %lu us\r\n", dev[d].Addr, dev[d].Count, dev[d].Errors,
+           dev[d].Busy_us, Window_us ? dev[d].Busy_us * 100.0 / Window_us : 0.0, dev[d].Max_wait_us);
+  }
+  printf("bus: %5.1f%% busy\r\n", Window_us ? Total_busy * 100.0 / Window_us : 0.0);
+}
+
+/********************************************************** Dumps **********************************************************/
+static void I2C_Trace_Make_Header(I2C_Trace_Header_t *header, uint32_t count)
+{
+  uint32_t total = I2C_Trace_Head - I2C_Trace_Base;
+  header->Magic = I2C_TRACE_MAGIC;
+  header->Version = I2C_TRACE_VERSION;
+  header->Record_size = sizeof(I2C_Trace_Record_t);
+  header->Reserved = 0;
+  header->Count = count;
+  header->Dropped = total - count + I2C_Trace_Lost;               // Overwritten, and not recorded during earlier dumps
+}
+
+void I2C_Trace_Dump_Serial(void)
+{
+  I2C_Trace_Header_t header;
+  I2C_Trace_Paused = true;
+  uint32_t count = I2C_Trace_Count();
+  uint32_t first = I2C_Trace_Head - count;
+  I2C_Trace_Make_Header(&header, count);
+  Serial.write((const uint8_t *)&header, sizeof(header));
+  for (uint32_t i = 0; i < count; i++)
+    Serial.write((const uint8_t *)&I2C_Trace_Ring[(first + i) & (I2C_TRACE_DEPTH - 1)], sizeof(I2C_Trace_Record_t));
+  Serial.flush();
+  I2C_Trace_Paused = false;
+}
+
+esp_err_t I2C_Trace_Dump_File(const char *Path)
+{
+  FILE *f = fopen(Path, "wb");
+  if (f == NULL) {
+    printf("I2C trace: cannot open %s\r\n", Path);
+    return ESP_FAIL;
+  }
+  I2C_Trace_Header_t header;
+  I2C_Trace_Paused = true;
+  uint32_t count = I2C_Trace_Count();
+  uint32_t first = I2C_Trace_Head - count;
+  I2C_Trace_Make_Header(&header, count);
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+  // The ring may wrap inside the window, so write it as at most two contiguous runs
+  uint32_t start = first & (I2C_TRACE_DEPTH - 1);
+  uint32_t run = count < I2C_TRACE_DEPTH - start ? count : I2C_TRACE_DEPTH - start;
+  ok = ok && fwrite(&I2C_Trace_Ring[start], sizeof(I2C_Trace_Record_t), run, f) == run;
+  ok = ok && fwrite(&I2C_Trace_Ring[0], sizeof(I2C_Trace_Record_t), count - run, f) == count - run;
+  I2C_Trace_Paused = false;
+  fclose(f);
+  if (!ok) {
+    printf("I2C trace: write to %s failed\r\n", Path);
+    return ESP_FAIL;
+  }
+  printf("I2C trace: %lu records written to %s\r\n", count, Path);
+  return ESP_OK;
+}
+
+#endif
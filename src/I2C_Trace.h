@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+
+/****************************************************** I2C transaction tracer ******************************************************/
+// Build with -D I2C_TRACE_ENABLE=1 to record every transaction the bus task executes.
+// When it is 0 (default) the hook below expands to nothing and the API collapses to empty inline stubs.
+#ifndef I2C_TRACE_ENABLE
+#define I2C_TRACE_ENABLE    0
+#endif
+
+#define I2C_TRACE_DEPTH     1024                          // Records kept in the ring buffer, must be a power of two
+#define I2C_TRACE_MAGIC     0x54433249                    // "I2CT" little endian, starts every dump
+#define I2C_TRACE_VERSION   1
+
+#define I2C_TRACE_RESULT_OK       0
+#define I2C_TRACE_RESULT_TIMEOUT  1
+#define I2C_TRACE_RESULT_FAIL     2                       // NACK or bus error
+#define I2C_TRACE_RESULT_OTHER    3
+
+// 16 bytes per transaction, dumped as-is (little endian). tools/i2c_trace_decode.py reads this layout.
+typedef struct __attribute__((packed)) {
+  uint32_t Start_us;                                      // Low 32 bits of esp_timer_get_time() when the transfer started
+  uint16_t Duration_us;                                   // Saturates at 65535
+  uint16_t Wait_us;                                       // Time spent queued, saturates at 65535
+  uint16_t Reg_addr;
+  uint16_t Length;
+  uint8_t  Driver_addr;                                   // 7-bit address, bit 7 set for reads
+  uint8_t  Result;                                        // I2C_TRACE_RESULT_*
+  uint8_t  Priority;
+  uint8_t  Reserved;
+} I2C_Trace_Record_t;
+
+typedef struct __attribute__((packed)) {
+  uint32_t Magic;
+  uint8_t  Version;
+  uint8_t  Record_size;
+  uint16_t Reserved;
+  uint32_t Count;                                         // Records that follow
+  uint32_t Dropped;                                       // Records overwritten before this dump, or not recorded
+                                                          // while an earlier dump paused the tracer
+} I2C_Trace_Header_t;
+
+#if I2C_TRACE_ENABLE
+
+struct I2C_Transaction;
+void I2C_Trace_Record(const struct I2C_Transaction *trans, int64_t Start_us, int64_t End_us);
+#define I2C_TRACE_RECORD(trans, start_us, end_us)   I2C_Trace_Record((trans), (start_us), (end_us))
+
+void I2C_Trace_Clear(void);
+uint32_t I2C_Trace_Count(void);
+void I2C_Trace_Print_Occupancy(void);                     // Per-device share of bus time over the traced window
+void I2C_Trace_Dump_Serial(void);                         // Binary dump (header + records) on the USB serial port
+esp_err_t I2C_Trace_Dump_File(const char *Path);          // Same format to a file, e.g. "/sdcard/i2c.trc"
+
+#else
+
+#define I2C_TRACE_RECORD(trans, start_us, end_us)   do { } while (0)
+
+static inline void I2C_Trace_Clear(void) {}
+static inline uint32_t I2C_Trace_Count(void) { return 0; }
+static inline void I2C_Trace_Print_Occupancy(void) {}
+static inline void I2C_Trace_Dump_Serial(void) {}
+static inline esp_err_t I2C_Trace_Dump_File(const char *Path) { (void)Path; return ESP_ERR_NOT_SUPPORTED; }
+
+#endif
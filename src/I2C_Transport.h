@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/****************************************************** I2C transport ******************************************************/
+// The bytes-on-the-wire layer under the bus task. The firmware uses the i2c_master backend in I2C_Master_Transport.cpp;
+// the host simulator under sim/ provides register-level device models behind the same interface.
+// Read/Write are only ever called from the bus task, Set_Speed may be called from any task.
+typedef struct {
+  const char *Name;
+  esp_err_t (*Init)(void);
+  void      (*Set_Speed)(uint8_t Driver_addr, uint32_t Speed_hz);
+  esp_err_t (*Read)(uint8_t Driver_addr, const uint8_t *Reg, size_t Reg_len, uint8_t *Data, size_t Length);
+  esp_err_t (*Write)(uint8_t Driver_addr, const uint8_t *Reg, size_t Reg_len, const uint8_t *Data, size_t Length);
+} I2C_Transport_t;
+
+const I2C_Transport_t *I2C_Default_Transport(void);      // Provided by whichever backend is linked in
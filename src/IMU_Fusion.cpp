@@ -0,0 +1,239 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "IMU_Fusion.h"
+#include "IMU_Stream.h"
+#include "Seqlock.h"
+
+#define IMU_FUSION_DEG2RAD  0.017453292f
+#define IMU_FUSION_RAD2DEG  57.29578f
+
+/********************************************************** Filter core **********************************************************/
+static inline float Fusion_Inv_Sqrt(float x)
+{
+  return 1.0f / sqrtf(x);                                       // sqrt.s and div.s are single instructions on the S3 FPU
+}
+
+static void Fusion_Normalize(float Q[4])
+{
+  float n = Fusion_Inv_Sqrt(Q[0] * Q[0] + Q[1] * Q[1] + Q[2] * Q[2] + Q[3] * Q[3]);
+  Q[0] *= n;
+  Q[1] *= n;
+  Q[2] *= n;
+  Q[3] *= n;
+}
+
+// Unit accelerometer vector in a, false when it should not be trusted (free fall, shocks, strong linear acceleration)
+static bool Fusion_Acc_Direction(const float Acc_g[3], float a[3])
+{
+  float norm2 = Acc_g[0] * Acc_g[0] + Acc_g[1] * Acc_g[1] + Acc_g[2] * Acc_g[2];
+  if (norm2 < (1.0f - IMU_FUSION_ACC_GATE) * (1.0f - IMU_FUSION_ACC_GATE) ||
+      norm2 > (1.0f + IMU_FUSION_ACC_GATE) * (1.0f + IMU_FUSION_ACC_GATE))
+    return false;
+  float n = Fusion_Inv_Sqrt(norm2);
+  a[0] = Acc_g[0] * n;
+  a[1] = Acc_g[1] * n;
+  a[2] = Acc_g[2] * n;
+  return true;
+}
+
+void IMU_Fusion_Reset(IMU_Fusion_t *f)
+{
+  memset(f, 0, sizeof(*f));
+  f->Q[0] = 1.0f;
+  f->Beta = IMU_FUSION_BETA;
+  f->Kp = IMU_FUSION_KP;
+  f->Ki = IMU_FUSION_KI;
+}
+
+void IMU_Fusion_Align(IMU_Fusion_t *f, const float Acc_g[3])
+{
+  float roll = atan2f(Acc_g[1], Acc_g[2]) * 0.5f;
+  float pitch = atan2f(-Acc_g[0], sqrtf(Acc_g[1] * Acc_g[1] + Acc_g[2] * Acc_g[2])) * 0.5f;
+  float cr = cosf(roll), sr = sinf(roll), cp = cosf(pitch), sp = sinf(pitch);
+  f->Q[0] = cr * cp;
+  f->Q[1] = sr * cp;
+  f->Q[2] = cr * sp;
+  f->Q[3] = -sr * sp;
+  f->Integral[0] = f->Integral[1] = f->Integral[2] = 0;
+}
+
+// Madgwick, "An efficient orientation filter for inertial and inertial/magnetic sensor arrays" (2010), IMU variant:
+// integrate the gyro rate and step down the gradient of the gravity error by Beta.
+void IMU_Fusion_Update_Madgwick(IMU_Fusion_t *f, const float Gyr_dps[3], const float Acc_g[3], float Dt_s)
+{
+  float q0 = f->Q[0], q1 = f->Q[1], q2 = f->Q[2], q3 = f->Q[3];
+  float gx = Gyr_dps[0] * IMU_FUSION_DEG2RAD, gy = Gyr_dps[1] * IMU_FUSION_DEG2RAD, gz = Gyr_dps[2] * IMU_FUSION_DEG2RAD;
+  float a[3];
+
+  float qd0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+  float qd1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+  float qd2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+  float qd3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+  if (Fusion_Acc_Direction(Acc_g, a)) {
+    float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+    float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+    float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+    float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+    float s0 = _4q0 * q2q2 + _2q2 * a[0] + _4q0 * q1q1 - _2q1 * a[1];
+    float s1 = _4q1 * q3q3 - _2q3 * a[0] + 4.0f * q0q0 * q1 - _2q0 * a[1] - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * a[2];
+    float s2 = 4.0f * q0q0 * q2 + _2q0 * a[0] + _4q2 * q3q3 - _2q3 * a[1] - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * a[2];
+    float s3 = 4.0f * q1q1 * q3 - _2q1 * a[0] + 4.0f * q2q2 * q3 - _2q2 * a[1];
+    float s2sum = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+    if (s2sum > 0) {                                            // Zero exactly when already aligned
+      float n = f->Beta * Fusion_Inv_Sqrt(s2sum);
+      qd0 -= n * s0;
+      qd1 -= n * s1;
+      qd2 -= n * s2;
+      qd3 -= n * s3;
+    }
+  }
+
+  f->Q[0] = q0 + qd0 * Dt_s;
+  f->Q[1] = q1 + qd1 * Dt_s;
+  f->Q[2] = q2 + qd2 * Dt_s;
+  f->Q[3] = q3 + qd3 * Dt_s;
+  Fusion_Normalize(f->Q);
+}
+
+// Mahony, "Nonlinear complementary filters on the special orthogonal group" (2008): the cross product between measured
+// and estimated gravity is fed back into the gyro rate through a PI controller, the integral soaks up the gyro bias.
+void IMU_Fusion_Update_Mahony(IMU_Fusion_t *f, const float Gyr_dps[3], const float Acc_g[3], float Dt_s)
+{
+  float q0 = f->Q[0], q1 = f->Q[1], q2 = f->Q[2], q3 = f->Q[3];
+  float gx = Gyr_dps[0] * IMU_FUSION_DEG2RAD, gy = Gyr_dps[1] * IMU_FUSION_DEG2RAD, gz = Gyr_dps[2] * IMU_FUSION_DEG2RAD;
+  float a[3];
+
+  if (Fusion_Acc_Direction(Acc_g, a)) {
+    float vx = q1 * q3 - q0 * q2;                               // Half the estimated gravity direction
+    float vy = q0 * q1 + q2 * q3;
+    float vz = q0 * q0 - 0.5f + q3 * q3;
+    float ex = a[1] * vz - a[2] * vy;
+    float ey = a[2] * vx - a[0] * vz;
+    float ez = a[0] * vy - a[1] * vx;
+    if (f->Ki > 0) {
+      f->Integral[0] += 2.0f * f->Ki * ex * Dt_s;
+      f->Integral[1] += 2.0f * f->Ki * ey * Dt_s;
+      f->Integral[2] += 2.0f * f->Ki * ez * Dt_s;
+    }
+    gx += 2.0f * f->Kp * ex;
+    gy += 2.0f * f->Kp * ey;
+    gz += 2.0f * f->Kp * ez;
+  }
+  gx += f->Integral[0];
+  gy += f->Integral[1];
+  gz += f->Integral[2];
+
+  gx *= 0.5f * Dt_s;
+  gy *= 0.5f * Dt_s;
+  gz *= 0.5f * Dt_s;
+  f->Q[0] = q0 + (-q1 * gx - q2 * gy - q3 * gz);
+  f->Q[1] = q1 + (q0 * gx + q2 * gz - q3 * gy);
+  f->Q[2] = q2 + (q0 * gy - q1 * gz + q3 * gx);
+  f->Q[3] = q3 + (q0 * gz + q1 * gy - q2 * gx);
+  Fusion_Normalize(f->Q);
+}
+
+void IMU_Fusion_Update(IMU_Fusion_t *f, const float Gyr_dps[3], const float Acc_g[3], float Dt_s)
+{
+#if IMU_FUSION_MAHONY
+  IMU_Fusion_Update_Mahony(f, Gyr_dps, Acc_g, Dt_s);
+#else
+  IMU_Fusion_Update_Madgwick(f, Gyr_dps, Acc_g, Dt_s);
+#endif
+}
+
+// Z-Y-X (yaw, pitch, roll) Tait-Bryan angles in degrees
+void IMU_Fusion_Euler(const float Q[4], float *Roll, float *Pitch, float *Yaw)
+{
+  float sp = 2.0f * (Q[0] * Q[2] - Q[3] * Q[1]);
+  sp = sp > 1.0f ? 1.0f : (sp < -1.0f ? -1.0f : sp);
+  *Roll = atan2f(2.0f * (Q[0] * Q[1] + Q[2] * Q[3]), 1.0f - 2.0f * (Q[1] * Q[1] + Q[2] * Q[2])) * IMU_FUSION_RAD2DEG;
+  *Pitch = asinf(sp) * IMU_FUSION_RAD2DEG;
+  *Yaw = atan2f(2.0f * (Q[0] * Q[3] + Q[1] * Q[2]), 1.0f - 2.0f * (Q[2] * Q[2] + Q[3] * Q[3])) * IMU_FUSION_RAD2DEG;
+}
+
+/********************************************************** Publishing **********************************************************/
+// Two slots behind a seqlock (src/Seqlock.h): the task fills one while readers copy the other.
+static IMU_Attitude_t Fusion_Slot[2];
+static Seqlock_t      Fusion_Lock = {0};
+
+static void Fusion_Publish(const IMU_Fusion_t *f, uint32_t Time_us, uint32_t Samples)
+{
+  IMU_Attitude_t *att = &Fusion_Slot[Seqlock_Write_Slot(&Fusion_Lock)];
+  att->Time_us = Time_us;
+  att->Samples = Samples;
+  memcpy(att->Q, f->Q, sizeof(att->Q));
+  IMU_Fusion_Euler(f->Q, &att->Roll, &att->Pitch, &att->Yaw);
+  Seqlock_Publish(&Fusion_Lock);
+}
+
+bool IMU_Fusion_Get(IMU_Attitude_t *att)
+{
+  return Seqlock_Read(&Fusion_Lock, Fusion_Slot, sizeof(IMU_Attitude_t), att);
+}
+
+/********************************************************** Fusion task **********************************************************/
+static TaskHandle_t Fusion_Task = NULL;
+
+static void IMU_Fusion_Task(void *parameter)
+{
+  static IMU_Sample_t batch[64];
+  IMU_Reader_t reader;
+  IMU_Fusion_t filter;
+  uint32_t last_us = 0, dropped = 0, samples = 0;
+  bool aligned = false;
+
+  IMU_Reader_Attach(&reader);
+  IMU_Fusion_Reset(&filter);
+  while (1) {
+    vTaskDelay(pdMS_TO_TICKS(IMU_FUSION_PERIOD_MS));
+    float acc_scale = IMU_Stream_Acc_Scale(), gyr_scale = IMU_Stream_Gyr_Scale();
+    uint32_t n, fused = 0;
+    while ((n = IMU_Reader_Read(&reader, batch, sizeof(batch) / sizeof(batch[0]))) > 0) {
+      if (reader.Dropped != dropped) {                          // Fell behind the ring, the gap is unknown
+        dropped = reader.Dropped;
+        aligned = false;
+      }
+      for (uint32_t i = 0; i < n; i++) {
+        const IMU_Sample_t *s = &batch[i];
+        float acc[3] = {s->Acc[0] * acc_scale, s->Acc[1] * acc_scale, s->Acc[2] * acc_scale};
+        float gyr[3] = {s->Gyr[0] * gyr_scale, s->Gyr[1] * gyr_scale, s->Gyr[2] * gyr_scale};
+        uint32_t dt_us = s->Time_us - last_us;
+        last_us = s->Time_us;
+        if (!aligned || dt_us == 0 || dt_us > IMU_FUSION_MAX_GAP_US) {
+          IMU_Fusion_Align(&filter, acc);
+          aligned = true;
+          continue;
+        }
+        IMU_Fusion_Update(&filter, gyr, acc, dt_us * 1e-6f);
+        fused++;
+      }
+    }
+    if (fused) {
+      samples += fused;
+      Fusion_Publish(&filter, last_us, samples);
+    }
+  }
+}
+
+/**
+ * Start fusing IMU_Stream. Needs the stream, i.e. QMI8658_FIFO_Init() first.
+ * @return false if the task could not be created
+ */
+bool IMU_Fusion_Init(void)
+{
+  if (Fusion_Task)
+    return true;
+  if (xTaskCreatePinnedToCore(IMU_Fusion_Task, "IMU fusion task", IMU_FUSION_TASK_STACK, NULL,
+                              IMU_FUSION_TASK_PRIORITY, &Fusion_Task, IMU_FUSION_TASK_CORE) != pdPASS) {
+    printf("IMU fusion task creation failed\r\n");
+    Fusion_Task = NULL;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************** Attitude estimation ******************************************************/
+// A task runs every sample of IMU_Stream through a Madgwick or Mahony filter and publishes the attitude through a
+// seqlock (src/Seqlock.h). Readers (UI, logger) never block the filter and never see a half-written result.
+// Single precision throughout: the S3 has a hardware FPU, fixed point would only add scaling work.
+#define IMU_FUSION_MAHONY       1                         // 1: Mahony PI filter, 0: Madgwick gradient descent (see sim/bench)
+#define IMU_FUSION_BETA         0.05f                     // Madgwick gain, ~sqrt(3/4) x gyro error in rad/s
+#define IMU_FUSION_KP           1.0f                      // Mahony proportional gain
+#define IMU_FUSION_KI           0.02f                     // Mahony integral gain, learns the gyro bias
+#define IMU_FUSION_ACC_GATE     0.15f                     // Ignore the accelerometer when |a| is further than this from 1 g
+#define IMU_FUSION_MAX_GAP_US   50000                     // Longer gaps (lost samples, FIFO restarts) realign from gravity
+#define IMU_FUSION_PERIOD_MS    10                        // Task wake-up interval, every sample since the last one is used
+#define IMU_FUSION_TASK_CORE    1                         // Away from the I2C and FIFO tasks on core 0
+#define IMU_FUSION_TASK_PRIORITY 2                        // Above the LVGL loop, the work per wake-up is small
+#define IMU_FUSION_TASK_STACK   3072
+
+typedef struct {
+  float Q[4];                                             // w, x, y, z: sensor frame to earth frame
+  float Integral[3];                                      // Mahony gyro bias estimate, rad/s
+  float Beta;
+  float Kp;
+  float Ki;
+} IMU_Fusion_t;
+
+typedef struct {
+  uint32_t Time_us;                                       // IMU_Sample_t time of the newest fused sample
+  uint32_t Samples;                                       // Fused since IMU_Fusion_Init()
+  float    Q[4];                                          // w, x, y, z
+  float    Roll;                                          // Degrees, about x
+  float    Pitch;                                         // Degrees, about y
+  float    Yaw;                                           // Degrees, about z. Gyro only, drifts slowly
+} IMU_Attitude_t;
+
+// Filter core, no RTOS dependencies (also used by the host bench in sim/bench)
+void IMU_Fusion_Reset(IMU_Fusion_t *f);                   // Identity attitude, default gains
+void IMU_Fusion_Align(IMU_Fusion_t *f, const float Acc_g[3]);  // Roll and pitch straight from gravity, yaw 0
+void IMU_Fusion_Update_Madgwick(IMU_Fusion_t *f, const float Gyr_dps[3], const float Acc_g[3], float Dt_s);
+void IMU_Fusion_Update_Mahony(IMU_Fusion_t *f, const float Gyr_dps[3], const float Acc_g[3], float Dt_s);
+void IMU_Fusion_Update(IMU_Fusion_t *f, const float Gyr_dps[3], const float Acc_g[3], float Dt_s);  // Per IMU_FUSION_MAHONY
+void IMU_Fusion_Euler(const float Q[4], float *Roll, float *Pitch, float *Yaw);
+
+// Background fusion of IMU_Stream
+bool IMU_Fusion_Init(void);
+bool IMU_Fusion_Get(IMU_Attitude_t *att);                 // Newest attitude, false until the first one is published
+                                                          // (or if publishes keep overtaking the copy)
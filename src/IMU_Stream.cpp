@@ -0,0 +1,122 @@
+#include <string.h>
+#include <stdio.h>
+#include "IMU_Stream.h"
+#include "esp_heap_caps.h"
+
+#define IMU_STREAM_MASK (IMU_STREAM_DEPTH - 1)
+static_assert((IMU_STREAM_DEPTH & IMU_STREAM_MASK) == 0, "IMU_STREAM_DEPTH must be a power of two");
+
+static IMU_Sample_t *IMU_Ring = NULL;
+static uint32_t      IMU_Head = 0;                              // Written with release ordering, only by the writer
+static uint32_t      IMU_Claim = 0;                             // Head the batch being copied in will end at, stored
+                                                                // before its first slot is touched
+static float         IMU_Acc_scale = 0;
+static float         IMU_Gyr_scale = 0;
+
+bool IMU_Stream_Init(void)
+{
+  if (IMU_Ring)
+    return true;
+#if IMU_STREAM_PSRAM
+  IMU_Ring = (IMU_Sample_t *)heap_caps_malloc(IMU_STREAM_DEPTH * sizeof(IMU_Sample_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#endif
+  if (IMU_Ring == NULL)
+    IMU_Ring = (IMU_Sample_t *)heap_caps_malloc(IMU_STREAM_DEPTH * sizeof(IMU_Sample_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (IMU_Ring == NULL) {
+    printf("IMU stream: ring allocation failed\r\n");
+    return false;
+  }
+  return true;
+}
+
+void IMU_Stream_Set_Scale(float Acc_scale, float Gyr_scale)
+{
+  IMU_Acc_scale = Acc_scale;
+  IMU_Gyr_scale = Gyr_scale;
+}
+float IMU_Stream_Acc_Scale(void)
+{
+  return IMU_Acc_scale;
+}
+float IMU_Stream_Gyr_Scale(void)
+{
+  return IMU_Gyr_scale;
+}
+
+void IMU_Stream_Publish(const IMU_Sample_t *samples, uint32_t count)
+{
+  if (IMU_Ring == NULL)
+    return;
+  uint32_t head = IMU_Head;
+  if (count > IMU_STREAM_DEPTH) {                               // Only the newest DEPTH samples can ever be read
+    samples += count - IMU_STREAM_DEPTH;
+    head += count - IMU_STREAM_DEPTH;
+    count = IMU_STREAM_DEPTH;
+  }
+  __atomic_store_n(&IMU_Claim, head + count, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);                      // Claim visible before any slot is overwritten
+  uint32_t first = head & IMU_STREAM_MASK;
+  uint32_t part = IMU_STREAM_DEPTH - first;
+  if (part > count)
+    part = count;
+  memcpy(&IMU_Ring[first], samples, part * sizeof(IMU_Sample_t));
+  memcpy(&IMU_Ring[0], samples + part, (count - part) * sizeof(IMU_Sample_t));
+  __atomic_store_n(&IMU_Head, head + count, __ATOMIC_RELEASE);
+}
+
+uint32_t IMU_Stream_Head(void)
+{
+  return __atomic_load_n(&IMU_Head, __ATOMIC_ACQUIRE);
+}
+
+void IMU_Reader_Attach(IMU_Reader_t *reader)
+{
+  reader->Tail = IMU_Stream_Head();
+  reader->Dropped = 0;
+}
+
+uint32_t IMU_Reader_Available(const IMU_Reader_t *reader)
+{
+  uint32_t behind = IMU_Stream_Head() - reader->Tail;
+  return behind > IMU_STREAM_DEPTH ? IMU_STREAM_DEPTH : behind;
+}
+
+// Copies first and validates afterwards against the writer's claim, not its head: a batch is claimed before it is
+// copied in, so anything older than claim - DEPTH after our copy may have been overwritten, or be half written,
+// and is discarded and counted as dropped.
+uint32_t IMU_Reader_Read(IMU_Reader_t *reader, IMU_Sample_t *out, uint32_t max)
+{
+  if (IMU_Ring == NULL || max == 0)
+    return 0;
+  uint32_t head = IMU_Stream_Head();
+  if (head - reader->Tail > IMU_STREAM_DEPTH) {
+    reader->Dropped += head - reader->Tail - IMU_STREAM_DEPTH;
+    reader->Tail = head - IMU_STREAM_DEPTH;
+  }
+  uint32_t count = head - reader->Tail;
+  if (count > max)
+    count = max;
+  uint32_t first = reader->Tail & IMU_STREAM_MASK;
+  uint32_t part = IMU_STREAM_DEPTH - first;
+  if (part > count)
+    part = count;
+  memcpy(out, &IMU_Ring[first], part * sizeof(IMU_Sample_t));
+  memcpy(out + part, &IMU_Ring[0], (count - part) * sizeof(IMU_Sample_t));
+
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);                      // Our copy done before the claim is looked at
+  uint32_t after = __atomic_load_n(&IMU_Claim, __ATOMIC_RELAXED);
+  if (after - reader->Tail > IMU_STREAM_DEPTH) {
+    uint32_t stale = after - reader->Tail - IMU_STREAM_DEPTH;   // Slots the writer reused, or is reusing, while we copied
+    if (stale >= count) {
+      reader->Dropped += stale;
+      reader->Tail += stale;
+      return 0;
+    }
+    memmove(out, out + stale, (count - stale) * sizeof(IMU_Sample_t));
+    reader->Dropped += stale;
+    reader->Tail += stale;
+    count -= stale;
+  }
+  reader->Tail += count;
+  return count;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************** IMU sample stream ******************************************************/
+// Broadcast ring filled by the QMI8658 FIFO task. One writer, any number of readers, no locks:
+// every reader owns its cursor, and a reader that falls more than IMU_STREAM_DEPTH behind skips ahead and counts the loss.
+#define IMU_STREAM_DEPTH      2048                        // Samples, power of two. 2 s at 1 kHz
+#define IMU_STREAM_PSRAM      1                           // Allocate the ring in PSRAM (32 KB), internal RAM otherwise
+
+typedef struct {
+  uint32_t Time_us;                                       // Low 32 bits of esp_timer time, reconstructed from the batch timestamp
+  int16_t  Acc[3];                                        // Raw counts, multiply by IMU_Stream_Acc_Scale() for g
+  int16_t  Gyr[3];                                        // Raw counts, multiply by IMU_Stream_Gyr_Scale() for dps
+} IMU_Sample_t;
+
+typedef struct {
+  uint32_t Tail;                                          // Next sample index to read
+  uint32_t Dropped;                                       // Samples overwritten before this reader got to them
+} IMU_Reader_t;
+
+bool     IMU_Stream_Init(void);
+void     IMU_Stream_Set_Scale(float Acc_scale, float Gyr_scale);
+float    IMU_Stream_Acc_Scale(void);
+float    IMU_Stream_Gyr_Scale(void);
+void     IMU_Stream_Publish(const IMU_Sample_t *samples, uint32_t count);   // Writer side, one task only
+uint32_t IMU_Stream_Head(void);                                              // Total samples published
+
+void     IMU_Reader_Attach(IMU_Reader_t *reader);                            // Starts at the newest sample
+uint32_t IMU_Reader_Available(const IMU_Reader_t *reader);
+uint32_t IMU_Reader_Read(IMU_Reader_t *reader, IMU_Sample_t *out, uint32_t max);  // Copies up to max samples, oldest first
@@ -0,0 +1,335 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "Icon_Image.h"
+#include "Compressed_Image.h"
+#include "src/draw/sw/blend/lv_draw_sw_blend_to_rgb565.h"  // lib/lvgl is on the include path, see <demos/lv_demos.h>
+#include "Icon_Blend.h"
+
+#define ICON_PALETTE_ENTRY  4                                   // lv_color32_t
+
+static Icon_Image_Stats_t Icon_Stats;
+
+/********************************************************** Format **********************************************************/
+// Palette entries and index bytes of an indexed variable image, or false if it is not one
+static bool Icon_Parse(const lv_image_dsc_t *Image, uint32_t *Colors, uint32_t *Stride)
+{
+  if (Image == NULL || Image->header.magic != LV_IMAGE_HEADER_MAGIC || Image->data == NULL ||
+      (Image->header.flags & LV_IMAGE_FLAGS_COMPRESSED) || !LV_COLOR_FORMAT_IS_INDEXED(Image->header.cf))
+    return false;
+  lv_color_format_t cf = (lv_color_format_t)Image->header.cf;
+  *Colors = LV_COLOR_INDEXED_PALETTE_SIZE(cf);
+  *Stride = Image->header.stride ? Image->header.stride : (Image->header.w * lv_color_format_get_bpp(cf) + 7) / 8;
+  return Image->data_size >= *Colors * ICON_PALETTE_ENTRY + *Stride * Image->header.h;
+}
+
+/********************************************************** LVGL decoder **********************************************************/
+static lv_result_t Icon_Info_Cb(lv_image_decoder_t *decoder, const void *src, lv_image_header_t *header)
+{
+  if (lv_image_src_get_type(src) != LV_IMAGE_SRC_VARIABLE || !Icon_Image_Is((const lv_image_dsc_t *)src))
+    return LV_RESULT_INVALID;
+  *header = ((const lv_image_dsc_t *)src)->header;
+  header->cf = LV_COLOR_FORMAT_A8;                              // What the draw gets
+  header->stride = header->w;
+  return LV_RESULT_OK;
+}
+
+static lv_result_t Icon_Open_Cb(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc)
+{
+  const lv_image_dsc_t *image = (const lv_image_dsc_t *)dsc->src;
+  if (!Icon_Image_Is(image))
+    return LV_RESULT_INVALID;
+  lv_draw_buf_t *buf = lv_draw_buf_create(image->header.w, image->header.h, LV_COLOR_FORMAT_A8, image->header.w);
+  if (buf == NULL || Icon_Image_Expand(image, buf->data, buf->header.stride) != ESP_OK) {
+    if (buf)
+      lv_draw_buf_destroy(buf);
+    Icon_Stats.Failures++;
+    return LV_RESULT_INVALID;
+  }
+  lv_draw_buf_t *adjusted = lv_image_decoder_post_process(dsc, buf);
+  if (adjusted != buf)
+    lv_draw_buf_destroy(buf);
+  if (adjusted == NULL)
+    return LV_RESULT_INVALID;
+  dsc->decoded = adjusted;
+  if (dsc->args.no_cache)
+    return LV_RESULT_OK;                                        // Freed by Icon_Close_Cb() after the draw
+#if LV_CACHE_DEF_SIZE > 0
+  lv_image_cache_data_t search_key;
+  search_key.src_type = dsc->src_type;
+  search_key.src = dsc->src;
+  search_key.slot.size = adjusted->data_size;
+  dsc->cache_entry = lv_image_decoder_add_to_cache(decoder, &search_key, adjusted, NULL);
+  if (dsc->cache_entry == NULL) {
+    lv_draw_buf_destroy(adjusted);
+    return LV_RESULT_INVALID;
+  }
+#endif
+  return LV_RESULT_OK;
+}
+
+static void Icon_Close_Cb(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc)
+{
+  if (dsc->cache_entry) {
+    lv_cache_release(dsc->cache, dsc->cache_entry, NULL);      // The cache frees it, Icon_Cache_Free_Cb()
+    return;
+  }
+  lv_draw_buf_destroy((lv_draw_buf_t *)dsc->decoded);
+}
+
+static void Icon_Cache_Free_Cb(lv_image_cache_data_t *entry, void *user_data)
+{
+  lv_draw_buf_destroy((lv_draw_buf_t *)entry->decoded);
+}
+
+/********************************************************** API **********************************************************/
+esp_err_t Icon_Image_Init(void)
+{
+  lv_image_decoder_t *dec = lv_image_decoder_create();
+  if (dec == NULL)
+    return ESP_ERR_NO_MEM;
+  lv_image_decoder_set_info_cb(dec, Icon_Info_Cb);
+  lv_image_decoder_set_open_cb(dec, Icon_Open_Cb);
+  lv_image_decoder_set_close_cb(dec, Icon_Close_Cb);
+  lv_image_decoder_set_cache_free_cb(dec, (lv_cache_free_cb_t)Icon_Cache_Free_Cb);
+  printf("Icon images: indexed icon decoder registered, A8 blend kernel under layer opacity %s\r\n",
+         LV_USE_DRAW_SW_ASM == LV_DRAW_SW_ASM_CUSTOM ? "on" : "off, see include/Icon_Blend.h");
+  return ESP_OK;
+}
+
+bool Icon_Image_Is(const lv_image_dsc_t *Image)
+{
+  uint32_t colors, stride;
+  if (!Icon_Parse(Image, &colors, &stride))
+    return false;
+  const uint8_t *first = NULL;                                  // B, G, R of the first visible entry
+  for (uint32_t i = 0; i < colors; i++) {
+    const uint8_t *entry = Image->data + i * ICON_PALETTE_ENTRY;
+    if (entry[3] == 0)
+      continue;
+    if (first == NULL)
+      first = entry;
+    else if (memcmp(entry, first, 3))
+      return false;                                             // A picture, lv_bin_decoder's
+  }
+  return true;
+}
+
+esp_err_t Icon_Image_Expand(const lv_image_dsc_t *Image, uint8_t *Out, uint32_t Stride)
+{
+  uint32_t colors, in_stride;
+  if (!Icon_Parse(Image, &colors, &in_stride) || Out == NULL || Stride < Image->header.w)
+    return ESP_ERR_INVALID_ARG;
+  int64_t start = esp_timer_get_time();
+  uint8_t alpha[256];
+  for (uint32_t i = 0; i < colors; i++)
+    alpha[i] = Image->data[i * ICON_PALETTE_ENTRY + 3];
+  uint32_t bpp = lv_color_format_get_bpp((lv_color_format_t)Image->header.cf);
+  uint32_t per_byte = 8 / bpp, mask = (1u << bpp) - 1;
+  uint32_t w = Image->header.w;
+  const uint8_t *in = Image->data + colors * ICON_PALETTE_ENTRY;
+  for (uint32_t y = 0; y < Image->header.h; y++, in += in_stride, Out += Stride) {
+    uint8_t *out = Out;
+    for (uint32_t x = 0; x < w; x += per_byte) {                // First pixel in the high bits, as LVGL packs them
+      uint8_t byte = in[x / per_byte];
+      uint32_t n = w - x < per_byte ? w - x : per_byte;
+      for (uint32_t i = 0; i < n; i++)
+        *out++ = alpha[(byte >> (8 - bpp * (i + 1))) & mask];
+    }
+  }
+  Icon_Stats.Expands++;
+  Icon_Stats.Pixels += w * Image->header.h;
+  Icon_Stats.Expand_us += esp_timer_get_time() - start;
+  return ESP_OK;
+}
+
+void Icon_Image_Set_Color(lv_obj_t *Obj, lv_color_t Color)
+{
+  // Full recolour opacity as well: the RGB565A8 images a build without tools/image_compress.py's icons falls back to
+  // come out in the same colour, A8 ones ignore it
+  lv_obj_set_style_bg_image_recolor(Obj, Color, LV_PART_MAIN | LV_STATE_DEFAULT);
+  lv_obj_set_style_bg_image_recolor_opa(Obj, LV_OPA_COVER, LV_PART_MAIN | LV_STATE_DEFAULT);
+  if (lv_obj_check_type(Obj, &lv_image_class)) {
+    lv_obj_set_style_image_recolor(Obj, Color, LV_PART_MAIN | LV_STATE_DEFAULT);
+    lv_obj_set_style_image_recolor_opa(Obj, LV_OPA_COVER, LV_PART_MAIN | LV_STATE_DEFAULT);
+  }
+}
+
+/********************************************************** Benchmark **********************************************************/
+static void Icon_Keep_Best(uint32_t *Best, int64_t Start)
+{
+  uint32_t us = (uint32_t)(esp_timer_get_time() - Start);
+  if (us < *Best)
+    *Best = us;
+}
+
+esp_err_t Icon_Image_Measure(const lv_image_dsc_t *Icon, Icon_Image_Report_t *Report)
+{
+  if (Icon == NULL || Report == NULL || Icon->header.cf != LV_COLOR_FORMAT_A8)
+    return ESP_ERR_INVALID_ARG;
+  uint32_t w = Icon->header.w, h = Icon->header.h, n = w * h;
+  uint32_t i4_stride = (w + 1) / 2;
+  uint8_t *a8 = (uint8_t *)malloc(n);
+  uint8_t *rgb565a8 = (uint8_t *)malloc(n * 3);
+  uint32_t *argb8888 = (uint32_t *)malloc(n * 4);
+  uint8_t *i4 = (uint8_t *)calloc(1, 16 * ICON_PALETTE_ENTRY + i4_stride * h);
+  uint16_t *bg = (uint16_t *)malloc(n * 2);
+  uint16_t *dest = (uint16_t *)malloc(n * 2);
+  uint16_t *check = (uint16_t *)malloc(n * 2);
+  esp_err_t err = a8 && rgb565a8 && argb8888 && i4 && bg && dest && check ? ESP_OK : ESP_ERR_NO_MEM;
+  if (err == ESP_OK) {
+    if (Compressed_Image_Is(Icon))
+      err = Compressed_Image_Unpack(Icon, a8, n);
+    else if (Icon->data_size >= n && (Icon->header.stride == 0 || Icon->header.stride == w))
+      memcpy(a8, Icon->data, n);
+    else
+      err = ESP_ERR_INVALID_SIZE;
+  }
+  Icon_Image_Stats_t saved = Icon_Stats;
+  if (err == ESP_OK) {
+    // The same icon in the other formats, in the UI's colour on the buttons' grey
+    lv_color_t color = lv_color_hex(ICON_IMAGE_UI_COLOR);
+    uint16_t c16 = lv_color_to_u16(color);
+    lv_image_dsc_t indexed = {};
+    indexed.header.magic = LV_IMAGE_HEADER_MAGIC;
+    indexed.header.cf = LV_COLOR_FORMAT_I4;
+    indexed.header.w = w;
+    indexed.header.h = h;
+    indexed.header.stride = i4_stride;
+    indexed.data_size = 16 * ICON_PALETTE_ENTRY + i4_stride * h;
+    indexed.data = i4;
+    for (uint32_t l = 0; l < 16; l++) {
+      i4[l * ICON_PALETTE_ENTRY] = color.blue;
+      i4[l * ICON_PALETTE_ENTRY + 1] = color.green;
+      i4[l * ICON_PALETTE_ENTRY + 2] = color.red;
+      i4[l * ICON_PALETTE_ENTRY + 3] = l * 17;
+    }
+    for (uint32_t p = 0; p < n; p++) {
+      memcpy(rgb565a8 + p * 2, &c16, 2);
+      rgb565a8[n * 2 + p] = a8[p];
+      argb8888[p] = (uint32_t)a8[p] << 24 | (uint32_t)color.red << 16 | (uint32_t)color.green << 8 | color.blue;
+      i4[16 * ICON_PALETTE_ENTRY + (p / w) * i4_stride + (p % w) / 2] |= ((a8[p] + 8) / 17) << ((p % w) & 1 ? 0 : 4);
+      bg[p] = lv_color_to_u16(lv_color_hex(0x5D5D5D));
+    }
+
+    _lv_draw_sw_blend_image_dsc_t image = {};
+    image.dest_buf = dest;
+    image.dest_w = w;
+    image.dest_h = h;
+    image.dest_stride = w * 2;
+    image.opa = LV_OPA_COVER;
+    image.blend_mode = LV_BLEND_MODE_NORMAL;
+    _lv_draw_sw_blend_fill_dsc_t fill = {};
+    fill.dest_buf = dest;
+    fill.dest_w = w;
+    fill.dest_h = h;
+    fill.dest_stride = w * 2;
+    fill.mask_buf = a8;
+    fill.mask_stride = w;
+    fill.color = color;
+    fill.opa = LV_OPA_COVER;
+
+    // The kernels must give what LVGL's blend gives, hooked or not
+    memcpy(dest, bg, n * 2);
+    lv_draw_sw_blend_color_to_rgb565(&fill);
+    memcpy(check, dest, n * 2);
+    memcpy(dest, bg, n * 2);
+    Icon_Blend_Mask_To_RGB565(&fill);
+    if (memcmp(check, dest, n * 2))
+      err = ESP_ERR_INVALID_CRC;
+    // And the I4 copy must expand to the mask, within a level
+    const uint8_t *levels = (const uint8_t *)check;
+    if (err == ESP_OK && (err = Icon_Image_Expand(&indexed, (uint8_t *)check, w)) == ESP_OK)
+      for (uint32_t p = 0; p < n && err == ESP_OK; p++)
+        if (abs((int)levels[p] - a8[p]) > 8)
+          err = ESP_ERR_INVALID_CRC;
+
+    Report->Rgb565a8_us = Report->Argb8888_us = Report->A8_us = UINT32_MAX;
+    Report->Kernel_us = Report->Kernel_opa_us = Report->Expand_us = UINT32_MAX;
+    for (int r = 0; r < ICON_IMAGE_BENCH_REPEATS && err == ESP_OK; r++) {
+      memcpy(dest, bg, n * 2);
+      image.src_buf = rgb565a8;
+      image.src_stride = w * 2;
+      image.src_color_format = LV_COLOR_FORMAT_RGB565;
+      image.mask_buf = rgb565a8 + n * 2;
+      image.mask_stride = w;
+      int64_t t = esp_timer_get_time();
+      lv_draw_sw_blend_image_to_rgb565(&image);
+      Icon_Keep_Best(&Report->Rgb565a8_us, t);
+
+      memcpy(dest, bg, n * 2);
+      image.src_buf = argb8888;
+      image.src_stride = w * 4;
+      image.src_color_format = LV_COLOR_FORMAT_ARGB8888;
+      image.mask_buf = NULL;
+      t = esp_timer_get_time();
+      lv_draw_sw_blend_image_to_rgb565(&image);
+      Icon_Keep_Best(&Report->Argb8888_us, t);
+
+      memcpy(dest, bg, n * 2);
+      fill.opa = LV_OPA_COVER;
+      t = esp_timer_get_time();
+      lv_draw_sw_blend_color_to_rgb565(&fill);
+      Icon_Keep_Best(&Report->A8_us, t);
+
+      memcpy(dest, bg, n * 2);
+      t = esp_timer_get_time();
+      Icon_Blend_Mask_To_RGB565(&fill);
+      Icon_Keep_Best(&Report->Kernel_us, t);
+
+      memcpy(dest, bg, n * 2);
+      fill.opa = LV_OPA_50;
+      t = esp_timer_get_time();
+      Icon_Blend_Mask_Opa_To_RGB565(&fill);
+      Icon_Keep_Best(&Report->Kernel_opa_us, t);
+
+      t = esp_timer_get_time();
+      err = Icon_Image_Expand(&indexed, (uint8_t *)check, w);
+      Icon_Keep_Best(&Report->Expand_us, t);
+    }
+  }
+  Icon_Stats = saved;
+  free(a8);
+  free(rgb565a8);
+  free(argb8888);
+  free(i4);
+  free(bg);
+  free(dest);
+  free(check);
+  return err;
+}
+
+void Icon_Image_Bench(const lv_image_dsc_t *const Icons[], const char *const Names[], int Count)
+{
+  printf("Icon bench: A8 blend kernel of include/Icon_Blend.h under layer opacity %s in LVGL\r\n",
+         LV_USE_DRAW_SW_ASM == LV_DRAW_SW_ASM_CUSTOM ? "hooked" : "not hooked, only called directly here");
+  for (int i = 0; i < Count; i++) {
+    Icon_Image_Report_t r;
+    char name[16];
+    snprintf(name, sizeof(name), "icon %d", i);
+    const char *n = Names && Names[i] ? Names[i] : name;
+    esp_err_t err = Icon_Image_Measure(Icons[i], &r);
+    if (err != ESP_OK) {
+      printf("Icon bench: %-16s %s\r\n", n, err == ESP_ERR_INVALID_ARG ? "not an A8 icon" : esp_err_to_name(err));
+      continue;
+    }
+    uint32_t w = Icons[i]->header.w, h = Icons[i]->header.h, px = w * h;
+    printf("Icon bench: %-16s %3ux%-3u bytes RGB565A8 %5lu, ARGB8888 %5lu, A8 %5lu, I4 %5lu; blend us RGB565A8 %4lu, "
+           "ARGB8888 %4lu, A8 %4lu, kernel %4lu, at 50%% %4lu; I4 to A8 %4lu us\r\n", n, w, h, px * 3, px * 4, px,
+           (w + 1) / 2 * h + 16 * ICON_PALETTE_ENTRY, r.Rgb565a8_us, r.Argb8888_us, r.A8_us, r.Kernel_us,
+           r.Kernel_opa_us, r.Expand_us);
+  }
+}
+
+void Icon_Image_Get_Stats(Icon_Image_Stats_t *stats)
+{
+  *stats = Icon_Stats;
+}
+
+void Icon_Image_Print_Stats(void)
+{
+  Icon_Image_Stats_t s = Icon_Stats;
+  printf("Icon images: %lu indexed icons expanded to A8 (%llu pixels, %llu us), %lu failures\r\n", s.Expands, s.Pixels,
+         s.Expand_us, s.Failures);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <lvgl.h>
+#include "esp_err.h"
+
+/****************************************************** Icon images ******************************************************/
+// Single-colour icons as alpha masks recoloured when drawn, instead of full-colour RGB565A8 images: 1 byte per pixel
+// for A8, half a byte or less for I4/I2/I1, against 3. tools/image_compress.py --icon converts SquareLine's exports.
+//   - A8 icons need nothing here: LVGL's software renderer draws them as the widget's image_recolor (bg_image_recolor
+//     for a background image) through the mask, under a layer opacity with the kernel lv_conf.h hooks in from
+//     include/Icon_Blend.h.
+//   - Indexed icons whose palette is one colour at several alpha levels are expanded here to A8, once, through the
+//     palette's alpha, and the A8 mask goes into lv_image_cache. lv_bin_decoder makes ARGB8888 of them instead, 4 bytes
+//     per pixel recoloured pixel by pixel on every draw. The palette's colour is not used, the widget's recolour is.
+// Icon_Image_Set_Color() gives a widget the colour its icons were exported in.
+#define ICON_IMAGE_UI_COLOR      0xE3E3E3                 // SquareLine's icons in src/ui, *_E3E3E3_*.png
+#define ICON_IMAGE_BENCH_REPEATS 200                      // Blends timed per icon and format, best kept
+#define ICON_IMAGE_BENCH_AUTOSTART 0                      // 1: main.cpp benches the UI's icons at boot
+
+typedef struct {
+  uint32_t Rgb565a8_us;                                   // One blend of the icon into RGB565, as exported
+  uint32_t Argb8888_us;                                   // What lv_bin_decoder makes of an indexed icon
+  uint32_t A8_us;                                         // Through LVGL's blend, at full opacity: LVGL's own loop
+  uint32_t Kernel_us;                                     // include/Icon_Blend.h called directly
+  uint32_t Kernel_opa_us;                                 // The same at half opacity
+  uint32_t Expand_us;                                     // I4 to A8, once per cache entry
+} Icon_Image_Report_t;
+
+typedef struct {
+  uint32_t Expands;                                       // Indexed icons expanded to A8
+  uint32_t Failures;                                      // No memory
+  uint64_t Pixels;
+  uint64_t Expand_us;
+} Icon_Image_Stats_t;
+
+esp_err_t Icon_Image_Init(void);                          // After Lvgl_Init(): registers the indexed icon decoder
+bool      Icon_Image_Is(const lv_image_dsc_t *Image);     // Indexed, palette of one colour, drawn as A8 here
+esp_err_t Icon_Image_Expand(const lv_image_dsc_t *Image, uint8_t *Out, uint32_t Stride);
+                                                          // Indexed image to A8 rows of Stride bytes, through the
+                                                          // palette's alpha; any palette
+void      Icon_Image_Set_Color(lv_obj_t *Obj, lv_color_t Color); // Recolour of its main part's background image,
+                                                          // and of the image itself for lv_image widgets
+esp_err_t Icon_Image_Measure(const lv_image_dsc_t *Icon, Icon_Image_Report_t *Report);
+                                                          // An A8 icon, compressed or not. LVGL context
+void      Icon_Image_Bench(const lv_image_dsc_t *const Icons[], const char *const Names[], int Count);
+                                                          // One line per icon: bytes and blend time per format
+void      Icon_Image_Get_Stats(Icon_Image_Stats_t *stats);
+void      Icon_Image_Print_Stats(void);
@@ -0,0 +1,583 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "SD_Cache.h"
+#include "JPEG_Decoder.h"
+#include "src/libs/tjpgd/tjpgd.h"  // lib/lvgl is on the include path, see <demos/lv_demos.h>
+
+// Where one share of a decode reads the stream and stores pixels; TJpgDec's device pointer
+typedef struct {
+  SD_Cache_File_t *File;
+  uint16_t        *Pixels;
+  uint16_t         Width;
+} Jpeg_Io_t;
+
+typedef struct {
+  JDEC          Jd;                                             // The caller's, with the tables
+  Jpeg_Io_t     Io;
+  JDEC          Task_jd;                                        // The task's: the caller's tables, its own buffers
+  Jpeg_Io_t     Task_io;                                        // Its own file handle for a restart split
+  uint8_t      *Task_buf;
+  uint8_t       Split;                                          // JPEG_DECODER_SINGLE...
+  uint16_t      Mcu_w;                                          // Pixels
+  uint16_t      Mcu_h;
+  uint32_t      Mcus_x;                                         // MCUs per row
+  uint32_t      Mcus;
+  uint32_t      Mcu_size;                                       // Bytes of the Y, Cb and Cr blocks of one MCU
+  uint32_t      Scan;                                           // File offset of the entropy-coded data
+  uint32_t      Half;                                           // Restart split: first MCU of the task's half
+  jd_yuv_t     *Rows;                                           // Pipeline: JPEG_DECODER_ROWS rows of MCUs, a ring
+  volatile bool Abort;                                          // Pipeline: the caller failed, the task stops
+  JRESULT       Task_result;
+  uint32_t      Task_us;
+} Jpeg_Decode_t;
+
+static const char *Jpeg_Split_Names[] = {"single", "restart", "pipeline"};
+
+static TaskHandle_t         Jpeg_Task = NULL;                   // NULL: callers run the task's share themselves
+static SemaphoreHandle_t    Jpeg_Lock = NULL;                   // Held by the decode that has the task
+static SemaphoreHandle_t    Jpeg_Start = NULL;
+static SemaphoreHandle_t    Jpeg_Done = NULL;
+static SemaphoreHandle_t    Jpeg_Rows_full = NULL;              // Pipeline: rows loaded, for the task
+static SemaphoreHandle_t    Jpeg_Rows_free = NULL;              // Pipeline: rows stored, for the caller
+static SemaphoreHandle_t    Jpeg_Stats_lock = NULL;
+static Jpeg_Decode_t       *Jpeg_Job = NULL;
+static JPEG_Decoder_Stats_t Jpeg_Stats;
+
+/********************************************************** TJpgDec **********************************************************/
+static size_t Jpeg_Input(JDEC *jd, uint8_t *Buf, size_t Length)
+{
+  SD_Cache_File_t *f = ((Jpeg_Io_t *)jd->device)->File;
+  if (Buf == NULL) {                                            // Skip a segment
+    SD_Cache_Seek(f, SD_Cache_Tell(f) + Length);
+    return Length;
+  }
+  int32_t n = SD_Cache_Read(f, Buf, Length);
+  return n > 0 ? (size_t)n : 0;
+}
+
+// One MCU, clipped at the right and bottom edges, as B, G, R bytes per pixel (LVGL's RGB888 order)
+static int Jpeg_Output(JDEC *jd, void *Bitmap, JRECT *Rect)
+{
+  const Jpeg_Io_t *io = (const Jpeg_Io_t *)jd->device;
+  const uint8_t *s = (const uint8_t *)Bitmap;
+  for (uint32_t y = Rect->top; y <= Rect->bottom; y++) {
+    uint16_t *d = io->Pixels + y * io->Width + Rect->left;
+    for (uint32_t x = Rect->left; x <= Rect->right; x++, s += 3)
+      *d++ = (uint16_t)((s[2] & 0xF8) << 8 | (s[1] & 0xFC) << 3 | s[0] >> 3);
+  }
+  return 1;
+}
+
+// MCUs [First, End), with the stream at the start of restart interval Restart when there are intervals
+static JRESULT Jpeg_Mcus(const Jpeg_Decode_t *d, JDEC *jd, uint32_t First, uint32_t End, uint16_t Restart)
+{
+  uint16_t rst = 0, rsc = Restart;
+  jd->dcv[0] = jd->dcv[1] = jd->dcv[2] = 0;
+  for (uint32_t m = First; m < End; m++) {
+    JRESULT rc = JDR_OK;
+    if (jd->nrst && rst++ == jd->nrst) {
+      rc = jd_restart(jd, rsc++);
+      rst = 1;
+    }
+    if (rc == JDR_OK)
+      rc = jd_mcu_load(jd);
+    if (rc == JDR_OK)
+      rc = jd_mcu_output(jd, Jpeg_Output, (m % d->Mcus_x) * d->Mcu_w, (m / d->Mcus_x) * d->Mcu_h);
+    if (rc != JDR_OK)
+      return rc;
+  }
+  return JDR_OK;
+}
+
+/********************************************************** Task's share **********************************************************/
+// File offset just past restart marker Count (1: the first) of the entropy-coded data at Offset. -1: not there
+static int32_t Jpeg_Find_Restart(SD_Cache_File_t *f, uint32_t Offset, uint32_t Count, uint8_t *Buf)
+{
+  bool ff = false;
+  SD_Cache_Seek(f, Offset);
+  while (1) {
+    int32_t n = SD_Cache_Read(f, Buf, JD_SZBUF);
+    if (n <= 0)
+      return -1;
+    for (int32_t i = 0; i < n; i++) {
+      uint8_t b = Buf[i];
+      if (ff && b >= 0xD0 && b <= 0xD7 && --Count == 0)
+        return (int32_t)(Offset + i + 1);
+      if (ff && b == 0xD9)                                      // End of image
+        return -1;
+      ff = b == 0xFF;                                           // 0xFF 0x00 is a stuffed byte, 0xFF 0xFF fill
+    }
+    Offset += n;
+  }
+}
+
+// Restart split: the second half, from the interval the task looks up in the file itself
+static JRESULT Jpeg_Second_Half(Jpeg_Decode_t *d)
+{
+  JDEC *jd = &d->Task_jd;
+  uint32_t k = d->Half / jd->nrst;                              // Intervals before the half, markers to skip
+  int32_t at = Jpeg_Find_Restart(d->Task_io.File, d->Scan, k, jd->inbuf);
+  if (at < 0)
+    return JDR_FMT1;
+  SD_Cache_Seek(d->Task_io.File, (uint32_t)at);
+  jd->dctr = 0;                                                 // Refills from there on the first bit wanted
+  jd->dptr = jd->inbuf;
+  jd->dbit = 0;
+#if JD_FASTDECODE >= 1
+  jd->wreg = 0;
+  jd->marker = 0;
+#endif
+  return Jpeg_Mcus(d, jd, d->Half, d->Mcus, (uint16_t)k);
+}
+
+// Pipeline: converts row Row, loaded by the caller, and stores it
+static void Jpeg_Store_Row(Jpeg_Decode_t *d, uint32_t Row)
+{
+  int64_t t0 = esp_timer_get_time();
+  JDEC *jd = &d->Task_jd;
+  uint32_t mcu = d->Mcu_size / sizeof(jd_yuv_t);
+  jd_yuv_t *row = d->Rows + (Row % JPEG_DECODER_ROWS) * d->Mcus_x * mcu;
+  for (uint32_t x = 0; x < d->Mcus_x; x++) {
+    jd->mcubuf = row + x * mcu;
+    jd_mcu_output(jd, Jpeg_Output, x * d->Mcu_w, Row * d->Mcu_h);
+  }
+  d->Task_us += esp_timer_get_time() - t0;
+}
+
+static void Jpeg_Task_Share(Jpeg_Decode_t *d)
+{
+  if (d->Split == JPEG_DECODER_RESTART) {
+    int64_t t0 = esp_timer_get_time();
+    d->Task_result = Jpeg_Second_Half(d);
+    d->Task_us += esp_timer_get_time() - t0;
+    return;
+  }
+  for (uint32_t r = 0; r < d->Mcus / d->Mcus_x; r++) {
+    xSemaphoreTake(Jpeg_Rows_full, portMAX_DELAY);
+    if (d->Abort)
+      break;
+    Jpeg_Store_Row(d, r);
+    xSemaphoreGive(Jpeg_Rows_free);
+  }
+}
+
+static void Jpeg_Task_Fn(void *parameter)
+{
+  while (1) {
+    xSemaphoreTake(Jpeg_Start, portMAX_DELAY);
+    Jpeg_Task_Share(Jpeg_Job);
+    xSemaphoreGive(Jpeg_Done);
+  }
+}
+
+/********************************************************** Caller's share **********************************************************/
+// Pipeline: loads every row into the ring, the task (or the caller after each row) stores them. Adds the time spent
+// waiting for a free row to Wait_us
+static JRESULT Jpeg_Load_Rows(Jpeg_Decode_t *d, int64_t *Wait_us)
+{
+  JDEC *jd = &d->Jd;
+  uint32_t mcu = d->Mcu_size / sizeof(jd_yuv_t);
+  uint16_t rst = 0, rsc = 0;
+  jd->dcv[0] = jd->dcv[1] = jd->dcv[2] = 0;
+  for (uint32_t r = 0; r < d->Mcus / d->Mcus_x; r++) {
+    jd_yuv_t *row = d->Rows + (r % JPEG_DECODER_ROWS) * d->Mcus_x * mcu;
+    if (Jpeg_Task) {
+      int64_t t0 = esp_timer_get_time();
+      xSemaphoreTake(Jpeg_Rows_free, portMAX_DELAY);
+      *Wait_us += esp_timer_get_time() - t0;
+    }
+    for (uint32_t x = 0; x < d->Mcus_x; x++) {
+      JRESULT rc = JDR_OK;
+      if (jd->nrst && rst++ == jd->nrst) {
+        rc = jd_restart(jd, rsc++);
+        rst = 1;
+      }
+      jd->mcubuf = row + x * mcu;
+      if (rc == JDR_OK)
+        rc = jd_mcu_load(jd);
+      if (rc != JDR_OK)
+        return rc;
+    }
+    if (Jpeg_Task)
+      xSemaphoreGive(Jpeg_Rows_full);
+    else
+      Jpeg_Store_Row(d, r);
+  }
+  return JDR_OK;
+}
+
+// The task's buffers: the stream buffer, RGB output of one MCU (TJpgDec lets it spill into the MCU buffer that
+// follows in its own pool, so it gets its full size here) and, for a restart split, an MCU buffer
+static bool Jpeg_Setup_Task(Jpeg_Decode_t *d, const char *Path)
+{
+  JDEC *jd = &d->Task_jd;
+  uint32_t work = d->Mcu_w * d->Mcu_h * 3 < 256 ? 256 : d->Mcu_w * d->Mcu_h * 3;
+  *jd = d->Jd;
+  d->Task_buf = (uint8_t *)malloc(JD_SZBUF + work + d->Mcu_size);
+  if (d->Task_buf == NULL)
+    return false;
+  jd->inbuf = d->Task_buf;
+  jd->workbuf = d->Task_buf + JD_SZBUF;
+  jd->mcubuf = (jd_yuv_t *)(d->Task_buf + JD_SZBUF + work);
+  jd->pool = NULL;
+  jd->sz_pool = 0;
+  d->Task_io = d->Io;
+  d->Task_io.File = NULL;
+  jd->device = &d->Task_io;
+  if (d->Split == JPEG_DECODER_RESTART) {
+    d->Task_io.File = SD_Cache_Open(Path);
+    return d->Task_io.File != NULL;
+  }
+  size_t rows = (size_t)JPEG_DECODER_ROWS * d->Mcus_x * d->Mcu_size;
+  d->Rows = (jd_yuv_t *)heap_caps_malloc(rows, MALLOC_CAP_INTERNAL);
+  if (d->Rows == NULL)
+    d->Rows = (jd_yuv_t *)heap_caps_malloc(rows, MALLOC_CAP_SPIRAM);
+  return d->Rows != NULL;
+}
+
+static esp_err_t Jpeg_Open(Jpeg_Decode_t *d, const char *Path, void *Pool)
+{
+  d->Io.File = SD_Cache_Open(Path);
+  if (d->Io.File == NULL)
+    return ESP_ERR_NOT_FOUND;
+  JRESULT rc = jd_prepare(&d->Jd, Jpeg_Input, Pool, JPEG_DECODER_POOL, &d->Io);
+  if (rc == JDR_FMT3)
+    return ESP_ERR_NOT_SUPPORTED;
+  if (rc != JDR_OK)
+    return rc == JDR_MEM1 || rc == JDR_MEM2 ? ESP_ERR_NO_MEM : ESP_FAIL;
+  if ((uint32_t)d->Jd.width * d->Jd.height > JPEG_DECODER_MAX_PIXELS)
+    return ESP_ERR_NOT_SUPPORTED;
+  d->Mcu_w = d->Jd.msx * 8;
+  d->Mcu_h = d->Jd.msy * 8;
+  d->Mcus_x = (d->Jd.width + d->Mcu_w - 1) / d->Mcu_w;
+  d->Mcus = d->Mcus_x * ((d->Jd.height + d->Mcu_h - 1) / d->Mcu_h);
+  d->Mcu_size = (d->Jd.msx * d->Jd.msy + 2) * 64 * sizeof(jd_yuv_t);
+  d->Scan = SD_Cache_Tell(d->Io.File) - d->Jd.dctr;            // Read into TJpgDec's buffer, not decoded yet
+  return ESP_OK;
+}
+
+// Restart intervals on both sides of the middle, else rows to pipeline, else nothing to share
+static uint8_t Jpeg_Choose_Split(Jpeg_Decode_t *d)
+{
+  uint32_t intervals = d->Jd.nrst ? (d->Mcus + d->Jd.nrst - 1) / d->Jd.nrst : 0;
+  if (intervals >= 2) {
+    d->Half = intervals / 2 * d->Jd.nrst;
+    return JPEG_DECODER_RESTART;
+  }
+  return d->Mcus / d->Mcus_x >= 2 ? JPEG_DECODER_PIPELINE : JPEG_DECODER_SINGLE;
+}
+
+// The whole decode into d->Io.Pixels. Adds the caller's waits for the task to Wait_us
+static JRESULT Jpeg_Run(Jpeg_Decode_t *d, int64_t *Wait_us)
+{
+  if (d->Split == JPEG_DECODER_SINGLE)
+    return Jpeg_Mcus(d, &d->Jd, 0, d->Mcus, 0);
+  if (Jpeg_Task) {
+    while (xSemaphoreTake(Jpeg_Rows_full, 0) == pdTRUE)         // Left over by an aborted pipeline
+      ;
+    while (xSemaphoreTake(Jpeg_Rows_free, 0) == pdTRUE)
+      ;
+    for (int i = 0; i < JPEG_DECODER_ROWS; i++)
+      xSemaphoreGive(Jpeg_Rows_free);
+    Jpeg_Job = d;
+    xSemaphoreGive(Jpeg_Start);
+  }
+  JRESULT rc;
+  if (d->Split == JPEG_DECODER_RESTART) {
+    rc = Jpeg_Mcus(d, &d->Jd, 0, d->Half, 0);
+  } else {
+    rc = Jpeg_Load_Rows(d, Wait_us);
+    if (rc != JDR_OK && Jpeg_Task) {
+      d->Abort = true;
+      xSemaphoreGive(Jpeg_Rows_full);
+    }
+  }
+  if (Jpeg_Task) {
+    int64_t t0 = esp_timer_get_time();
+    xSemaphoreTake(Jpeg_Done, portMAX_DELAY);
+    *Wait_us += esp_timer_get_time() - t0;
+  } else if (d->Split == JPEG_DECODER_RESTART) {
+    Jpeg_Task_Share(d);
+  }
+  if (rc == JDR_OK && d->Split == JPEG_DECODER_RESTART)
+    rc = d->Task_result;
+  return rc;
+}
+
+/********************************************************** LVGL decoder **********************************************************/
+// VFS path of an LVGL source this decoder takes: a .jpg or .jpeg file on JPEG_DECODER_LETTER
+static bool Jpeg_Source(const void *Src, char *Path, size_t Size)
+{
+  if (lv_image_src_get_type(Src) != LV_IMAGE_SRC_FILE)
+    return false;
+  const char *s = (const char *)Src;
+  const char *ext = lv_fs_get_ext(s);
+  if (s[0] != JPEG_DECODER_LETTER || s[1] != ':' || (strcasecmp(ext, "jpg") && strcasecmp(ext, "jpeg")))
+    return false;
+  return snprintf(Path, Size, "%s%s%s", JPEG_DECODER_ROOT, s[2] == '/' ? "" : "/", s + 2) < (int)Size;
+}
+
+static void Jpeg_Free_Buf(lv_draw_buf_t *Buf)
+{
+  if (lv_draw_buf_has_flag(Buf, LV_IMAGE_FLAGS_ALLOCATED)) {   // Copied by lv_image_decoder_post_process()
+    lv_draw_buf_destroy(Buf);
+    return;
+  }
+  heap_caps_free(Buf->unaligned_data);
+  free(Buf);
+}
+
+static lv_result_t Jpeg_Info_Cb(lv_image_decoder_t *decoder, const void *src, lv_image_header_t *header)
+{
+  char path[JPEG_DECODER_PATH_MAX];
+  if (!Jpeg_Source(src, path, sizeof(path)))
+    return LV_RESULT_INVALID;
+  Jpeg_Decode_t *d = (Jpeg_Decode_t *)calloc(1, sizeof(Jpeg_Decode_t));
+  void *pool = malloc(JPEG_DECODER_POOL);
+  bool ok = d && pool && Jpeg_Open(d, path, pool) == ESP_OK;
+  if (ok) {
+    header->cf = LV_COLOR_FORMAT_RGB565;
+    header->w = d->Jd.width;
+    header->h = d->Jd.height;
+    header->stride = d->Jd.width * 2;
+  }
+  if (d && d->Io.File)
+    SD_Cache_Close(d->Io.File);
+  free(pool);
+  free(d);
+  return ok ? LV_RESULT_OK : LV_RESULT_INVALID;
+}
+
+static lv_result_t Jpeg_Open_Cb(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc)
+{
+  char path[JPEG_DECODER_PATH_MAX];
+  JPEG_Decoder_Image_t image;
+  if (!Jpeg_Source(dsc->src, path, sizeof(path)) || JPEG_Decoder_Decode(path, true, &image) != ESP_OK)
+    return LV_RESULT_INVALID;
+  uint32_t stride = image.Width * 2;
+  lv_draw_buf_t *buf = (lv_draw_buf_t *)malloc(sizeof(lv_draw_buf_t));
+  if (buf == NULL || lv_draw_buf_init(buf, image.Width, image.Height, LV_COLOR_FORMAT_RGB565, stride, image.Pixels,
+                                      stride * image.Height) != LV_RESULT_OK) {
+    free(buf);
+    heap_caps_free(image.Pixels);
+    return LV_RESULT_INVALID;
+  }
+  lv_draw_buf_t *adjusted = lv_image_decoder_post_process(dsc, buf);
+  if (adjusted != buf)
+    Jpeg_Free_Buf(buf);
+  if (adjusted == NULL)
+    return LV_RESULT_INVALID;
+  dsc->decoded = adjusted;
+  dsc->time_to_open = image.Decode_us / 1000;
+  if (dsc->args.no_cache)
+    return LV_RESULT_OK;
+#if LV_CACHE_DEF_SIZE > 0
+  lv_image_cache_data_t search_key;
+  search_key.src_type = dsc->src_type;
+  search_key.src = dsc->src;
+  search_key.slot.size = adjusted->data_size;
+  dsc->cache_entry = lv_image_decoder_add_to_cache(decoder, &search_key, adjusted, NULL);
+  if (dsc->cache_entry == NULL) {
+    Jpeg_Free_Buf(adjusted);
+    return LV_RESULT_INVALID;
+  }
+#endif
+  return LV_RESULT_OK;
+}
+
+static void Jpeg_Close_Cb(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc)
+{
+#if LV_CACHE_DEF_SIZE > 0
+  if (!dsc->args.no_cache) {
+    lv_cache_release(dsc->cache, dsc->cache_entry, NULL);      // The cache frees it, Jpeg_Cache_Free_Cb()
+    return;
+  }
+#endif
+  Jpeg_Free_Buf((lv_draw_buf_t *)dsc->decoded);
+}
+
+static void Jpeg_Cache_Free_Cb(lv_image_cache_data_t *entry, void *user_data)
+{
+  Jpeg_Free_Buf((lv_draw_buf_t *)entry->decoded);
+  if (entry->src_type == LV_IMAGE_SRC_FILE)
+    lv_free((void *)entry->src);                                // Duplicated by lv_image_decoder_add_to_cache()
+}
+
+/********************************************************** API **********************************************************/
+esp_err_t JPEG_Decoder_Init(void)
+{
+  if (Jpeg_Lock)
+    return ESP_OK;
+  if (SD_Cache_Init() != ESP_OK)
+    return ESP_ERR_NO_MEM;
+  Jpeg_Start = xSemaphoreCreateBinary();
+  Jpeg_Done = xSemaphoreCreateBinary();
+  Jpeg_Rows_full = xSemaphoreCreateCounting(JPEG_DECODER_ROWS, 0);
+  Jpeg_Rows_free = xSemaphoreCreateCounting(JPEG_DECODER_ROWS, JPEG_DECODER_ROWS);
+  Jpeg_Stats_lock = xSemaphoreCreateMutex();
+  Jpeg_Lock = xSemaphoreCreateMutex();
+  if (!Jpeg_Start || !Jpeg_Done || !Jpeg_Rows_full || !Jpeg_Rows_free || !Jpeg_Stats_lock || !Jpeg_Lock) {
+    printf("JPEG decoder: no memory\r\n");
+    return ESP_ERR_NO_MEM;
+  }
+  if (xTaskCreatePinnedToCore(Jpeg_Task_Fn, "JPEG decoder", JPEG_DECODER_TASK_STACK, NULL, JPEG_DECODER_TASK_PRIORITY,
+                              &Jpeg_Task, JPEG_DECODER_TASK_CORE) != pdPASS) {
+    Jpeg_Task = NULL;
+    printf("JPEG decoder: no task, decoding on one core\r\n");
+  }
+  lv_image_decoder_t *dec = lv_image_decoder_create();
+  lv_image_decoder_set_info_cb(dec, Jpeg_Info_Cb);
+  lv_image_decoder_set_open_cb(dec, Jpeg_Open_Cb);
+  lv_image_decoder_set_close_cb(dec, Jpeg_Close_Cb);
+  lv_image_decoder_set_cache_free_cb(dec, (lv_cache_free_cb_t)Jpeg_Cache_Free_Cb);
+#if LV_CACHE_DEF_SIZE > 0 && LV_CACHE_DEF_SIZE < JPEG_DECODER_CACHE_SIZE
+  lv_image_cache_resize(JPEG_DECODER_CACHE_SIZE, false);
+#endif
+  return ESP_OK;
+}
+
+esp_err_t JPEG_Decoder_Decode(const char *Path, bool Two_cores, JPEG_Decoder_Image_t *Image)
+{
+  memset(Image, 0, sizeof(*Image));
+  int64_t t0 = esp_timer_get_time(), wait_us = 0;
+  Jpeg_Decode_t *d = (Jpeg_Decode_t *)calloc(1, sizeof(Jpeg_Decode_t));
+  void *pool = malloc(JPEG_DECODER_POOL);
+  esp_err_t err = d && pool ? Jpeg_Open(d, Path, pool) : ESP_ERR_NO_MEM;
+  if (err == ESP_OK) {
+    d->Io.Width = d->Jd.width;
+    d->Io.Pixels = (uint16_t *)heap_caps_malloc((size_t)d->Jd.width * d->Jd.height * 2, MALLOC_CAP_SPIRAM);
+    if (d->Io.Pixels == NULL)
+      err = ESP_ERR_NO_MEM;
+  }
+  bool shared = err == ESP_OK && Two_cores && Jpeg_Lock && xSemaphoreTake(Jpeg_Lock, 0) == pdTRUE;
+  if (shared) {
+    d->Split = Jpeg_Choose_Split(d);
+    if (d->Split != JPEG_DECODER_SINGLE && !Jpeg_Setup_Task(d, Path))
+      d->Split = JPEG_DECODER_SINGLE;                           // Short of memory: one core
+  }
+  if (err == ESP_OK) {
+    int64_t t1 = esp_timer_get_time();
+    JRESULT rc = Jpeg_Run(d, &wait_us);
+    int64_t busy = esp_timer_get_time() - t1 - wait_us - (Jpeg_Task ? 0 : d->Task_us);
+    if (rc != JDR_OK) {
+      printf("JPEG decoder: %s is damaged (%d)\r\n", Path, rc);
+      err = ESP_FAIL;
+    }
+    Image->Caller_us = (uint32_t)(t1 - t0 + busy);
+  }
+  if (shared)
+    xSemaphoreGive(Jpeg_Lock);
+  if (err == ESP_OK) {
+    Image->Pixels = d->Io.Pixels;
+    Image->Width = d->Jd.width;
+    Image->Height = d->Jd.height;
+    Image->Split = d->Split;
+    Image->Worker_us = d->Task_us;
+  } else if (d) {
+    heap_caps_free(d->Io.Pixels);
+  }
+  if (d && d->Io.File)
+    SD_Cache_Close(d->Io.File);
+  if (d && d->Task_io.File)
+    SD_Cache_Close(d->Task_io.File);
+  if (d) {
+    free(d->Task_buf);
+    heap_caps_free(d->Rows);
+  }
+  free(pool);
+  free(d);
+  Image->Decode_us = (uint32_t)(esp_timer_get_time() - t0);
+
+  if (Jpeg_Stats_lock)
+    xSemaphoreTake(Jpeg_Stats_lock, portMAX_DELAY);
+  if (err == ESP_OK) {
+    JPEG_Decoder_Stats_t *st = &Jpeg_Stats;
+    st->Decodes++;
+    st->Single += Image->Split == JPEG_DECODER_SINGLE;
+    st->Restart += Image->Split == JPEG_DECODER_RESTART;
+    st->Pipeline += Image->Split == JPEG_DECODER_PIPELINE;
+    st->Pixels += (uint32_t)Image->Width * Image->Height;
+    st->Decode_us += Image->Decode_us;
+    st->Worker_us += Image->Worker_us;
+    if (Image->Decode_us > st->Max_us)
+      st->Max_us = Image->Decode_us;
+  } else {
+    Jpeg_Stats.Failures++;
+  }
+  if (Jpeg_Stats_lock)
+    xSemaphoreGive(Jpeg_Stats_lock);
+  return err;
+}
+
+void JPEG_Decoder_Bench(const char *Dir)
+{
+  DIR *dir = opendir(Dir);
+  if (dir == NULL) {
+    printf("JPEG bench: cannot open %s\r\n", Dir);
+    return;
+  }
+  size_t root = strlen(JPEG_DECODER_ROOT);
+  bool drive = strncmp(Dir, JPEG_DECODER_ROOT, root) == 0;     // Else lv_image_cache cannot reach it
+  struct dirent *e;
+  while ((e = readdir(dir)) != NULL) {
+    const char *ext = strrchr(e->d_name, '.');
+    char path[JPEG_DECODER_PATH_MAX], src[JPEG_DECODER_PATH_MAX];
+    if (ext == NULL || (strcasecmp(ext, ".jpg") && strcasecmp(ext, ".jpeg")) ||
+        snprintf(path, sizeof(path), "%s/%s", Dir, e->d_name) >= (int)sizeof(path))
+      continue;
+    JPEG_Decoder_Image_t one = {}, two = {};                    // Pixels NULL unless a decode filled them
+    SD_Cache_Drop();                                            // Both from the card
+    esp_err_t err = JPEG_Decoder_Decode(path, false, &one);
+    heap_caps_free(one.Pixels);
+    if (err == ESP_OK) {
+      SD_Cache_Drop();
+      err = JPEG_Decoder_Decode(path, true, &two);
+      heap_caps_free(two.Pixels);
+    }
+    if (err != ESP_OK) {
+      printf("JPEG bench: %s: %s\r\n", e->d_name, esp_err_to_name(err));
+      continue;
+    }
+    printf("JPEG bench: %-24s %4ux%-4u one core %5lu ms, two cores %5lu ms %-8s (caller %lu ms, task %lu ms)\r\n",
+           e->d_name, two.Width, two.Height, one.Decode_us / 1000, two.Decode_us / 1000, Jpeg_Split_Names[two.Split],
+           two.Caller_us / 1000, two.Worker_us / 1000);
+    if (!drive)
+      continue;
+    snprintf(src, sizeof(src), "%c:%s", JPEG_DECODER_LETTER, path + root);
+    lv_image_cache_drop(src);
+    uint32_t ms[2];
+    for (int i = 0; i < 2; i++) {
+      lv_image_decoder_dsc_t dsc;
+      int64_t t0 = esp_timer_get_time();
+      if (lv_image_decoder_open(&dsc, src, NULL) == LV_RESULT_OK)
+        lv_image_decoder_close(&dsc);
+      ms[i] = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+    }
+    printf("JPEG bench: %-24s through lv_image_cache %5lu ms, again %5lu ms\r\n", e->d_name, ms[0], ms[1]);
+  }
+  closedir(dir);
+  JPEG_Decoder_Print_Stats();
+}
+
+void JPEG_Decoder_Get_Stats(JPEG_Decoder_Stats_t *stats)
+{
+  *stats = Jpeg_Stats;
+}
+
+void JPEG_Decoder_Print_Stats(void)
+{
+  const JPEG_Decoder_Stats_t *st = &Jpeg_Stats;
+  printf("JPEG decoder: %lu decodes (%lu single, %lu restart split, %lu pipelined), %lu failures, %llu Kpixels, "
+         "mean %lu ms, max %lu ms, %llu ms on the task%s\r\n",
+         st->Decodes, st->Single, st->Restart, st->Pipeline, st->Failures, st->Pixels / 1000,
+         st->Decodes ? (uint32_t)(st->Decode_us / st->Decodes / 1000) : 0, st->Max_us / 1000, st->Worker_us / 1000,
+         Jpeg_Task ? "" : " (run by the callers)");
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <lvgl.h>
+#include "esp_err.h"
+
+/****************************************************** JPEG decoder ******************************************************/
+// Baseline JPEG photos on the card, camera snapshots copied over for instance, as LVGL images: an image decoder for
+// "S:....jpg" and "S:....jpeg" sources, tried before LVGL's own. The file streams through SD_Cache into the TJpgDec
+// core bundled with LVGL, and each MCU is converted straight into an RGB565 image in PSRAM. That image goes into
+// lv_image_cache, so showing the photo again costs nothing until the cache evicts it. A task on the other core takes
+// part of every decode:
+//   - photos with restart markers are cut at the restart interval nearest the middle; the task finds that interval in
+//     the file and decodes the second half while the caller decodes the first;
+//   - photos without are pipelined by MCU row: the caller does the Huffman decoding and the IDCT of a row, the task
+//     converts the row before it to RGB565 and stores it.
+// Without the task (host builds) the caller runs the task's share itself, after its own. Progressive JPEGs and
+// photos over JPEG_DECODER_MAX_PIXELS are refused and left to other decoders.
+#define JPEG_DECODER_LETTER      'S'                      // LVGL_FS_LETTER
+#define JPEG_DECODER_ROOT        "/sdcard"                // LVGL_FS_ROOT
+#define JPEG_DECODER_PATH_MAX    96
+#define JPEG_DECODER_POOL        4096                     // TJpgDec tables and stream buffer, as lv_tjpgd sizes it
+#define JPEG_DECODER_ROWS        2                        // MCU rows between the cores when pipelining, internal RAM:
+                                                          // 30 KB each for a 640-pixel wide 4:2:0 photo
+#define JPEG_DECODER_MAX_PIXELS  (1280 * 960)             // 2.4 MB of PSRAM decoded
+#define JPEG_DECODER_CACHE_SIZE  (3 * 1024 * 1024)        // lv_image_cache grown to this at least: five 480x640 photos
+#define JPEG_DECODER_TASK_CORE   0                        // LVGL runs on the other one
+#define JPEG_DECODER_TASK_PRIORITY 2                      // Above SD_Cache's read-ahead, which it waits on
+#define JPEG_DECODER_TASK_STACK  3072
+
+#define JPEG_DECODER_SINGLE      0                        // How a decode was shared between the cores
+#define JPEG_DECODER_RESTART     1
+#define JPEG_DECODER_PIPELINE    2
+
+typedef struct {
+  uint16_t *Pixels;                                       // Width x Height RGB565, PSRAM; heap_caps_free() when done
+  uint16_t  Width;
+  uint16_t  Height;
+  uint8_t   Split;                                        // JPEG_DECODER_SINGLE...
+  uint32_t  Decode_us;                                    // Whole call, card reads included
+  uint32_t  Caller_us;                                    // Busy in the caller's share, waits excluded
+  uint32_t  Worker_us;                                    // Busy in the task's share
+} JPEG_Decoder_Image_t;
+
+typedef struct {
+  uint32_t Decodes;
+  uint32_t Failures;                                      // Missing, unsupported or damaged files, no memory
+  uint32_t Single;                                        // Decodes by split
+  uint32_t Restart;
+  uint32_t Pipeline;
+  uint64_t Pixels;
+  uint64_t Decode_us;
+  uint64_t Worker_us;
+  uint32_t Max_us;
+} JPEG_Decoder_Stats_t;
+
+esp_err_t JPEG_Decoder_Init(void);                        // After Lvgl_FS_Init(): registers the decoder, starts the task
+esp_err_t JPEG_Decoder_Decode(const char *Path, bool Two_cores, JPEG_Decoder_Image_t *Image);
+                                                          // Full VFS path, any task. One decode at a time shares the
+                                                          // task; others run on their caller's core alone.
+                                                          // ESP_ERR_NOT_SUPPORTED: progressive or too large
+void      JPEG_Decoder_Bench(const char *Dir);            // LVGL context. Decodes every photo in Dir, e.g. "/sdcard/dcim",
+                                                          // on one core, on two, and through lv_image_cache twice
+void      JPEG_Decoder_Get_Stats(JPEG_Decoder_Stats_t *stats);
+void      JPEG_Decoder_Print_Stats(void);
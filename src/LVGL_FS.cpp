@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include "esp_timer.h"
+#include "LVGL_FS.h"
+
+static void Lvgl_FS_Path(char *Full, size_t Size, const char *Path)
+{
+  snprintf(Full, Size, "%s%s%s", LVGL_FS_ROOT, Path[0] == '/' ? "" : "/", Path);
+}
+
+/********************************************************** Cached driver **********************************************************/
+static void *Lvgl_FS_Open(lv_fs_drv_t *drv, const char *path, lv_fs_mode_t mode)
+{
+  char full[256];
+  if (mode & LV_FS_MODE_WR)
+    return NULL;
+  Lvgl_FS_Path(full, sizeof(full), path);
+  return SD_Cache_Open(full);
+}
+
+static lv_fs_res_t Lvgl_FS_Close(lv_fs_drv_t *drv, void *file_p)
+{
+  SD_Cache_Close((SD_Cache_File_t *)file_p);
+  return LV_FS_RES_OK;
+}
+
+static lv_fs_res_t Lvgl_FS_Read(lv_fs_drv_t *drv, void *file_p, void *buf, uint32_t btr, uint32_t *br)
+{
+  int32_t n = SD_Cache_Read((SD_Cache_File_t *)file_p, buf, btr);
+  *br = n < 0 ? 0 : (uint32_t)n;
+  return n < 0 ? LV_FS_RES_HW_ERR : LV_FS_RES_OK;
+}
+
+static lv_fs_res_t Lvgl_FS_Seek(lv_fs_drv_t *drv, void *file_p, uint32_t pos, lv_fs_whence_t whence)
+{
+  SD_Cache_File_t *f = (SD_Cache_File_t *)file_p;
+  if (whence == LV_FS_SEEK_CUR)
+    pos += SD_Cache_Tell(f);
+  else if (whence == LV_FS_SEEK_END)
+    pos += SD_Cache_Size(f);
+  SD_Cache_Seek(f, pos);
+  return LV_FS_RES_OK;
+}
+
+static lv_fs_res_t Lvgl_FS_Tell(lv_fs_drv_t *drv, void *file_p, uint32_t *pos_p)
+{
+  *pos_p = SD_Cache_Tell((SD_Cache_File_t *)file_p);
+  return LV_FS_RES_OK;
+}
+
+// Directories straight from VFS; LVGL marks subdirectories with a leading '/'
+static void *Lvgl_FS_Dir_Open(lv_fs_drv_t *drv, const char *path)
+{
+  char full[256];
+  Lvgl_FS_Path(full, sizeof(full), path);
+  return opendir(full);
+}
+
+static lv_fs_res_t Lvgl_FS_Dir_Read(lv_fs_drv_t *drv, void *rddir_p, char *fn, uint32_t fn_len)
+{
+  struct dirent *e;
+  do {
+    e = readdir((DIR *)rddir_p);
+  } while (e && (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0));
+  if (e == NULL)
+    fn[0] = '\0';
+  else
+    snprintf(fn, fn_len, "%s%s", e->d_type == DT_DIR ? "/" : "", e->d_name);
+  return LV_FS_RES_OK;
+}
+
+static lv_fs_res_t Lvgl_FS_Dir_Close(lv_fs_drv_t *drv, void *rddir_p)
+{
+  closedir((DIR *)rddir_p);
+  return LV_FS_RES_OK;
+}
+
+static lv_fs_drv_t Lvgl_FS_Drv;
+
+void Lvgl_FS_Init(void)
+{
+  if (Lvgl_FS_Drv.letter)
+    return;
+  if (SD_Cache_Init() != ESP_OK)
+    return;
+  lv_fs_drv_init(&Lvgl_FS_Drv);
+  Lvgl_FS_Drv.letter = LVGL_FS_LETTER;
+  Lvgl_FS_Drv.cache_size = 0;
+  Lvgl_FS_Drv.open_cb = Lvgl_FS_Open;
+  Lvgl_FS_Drv.close_cb = Lvgl_FS_Close;
+  Lvgl_FS_Drv.read_cb = Lvgl_FS_Read;
+  Lvgl_FS_Drv.seek_cb = Lvgl_FS_Seek;
+  Lvgl_FS_Drv.tell_cb = Lvgl_FS_Tell;
+  Lvgl_FS_Drv.dir_open_cb = Lvgl_FS_Dir_Open;
+  Lvgl_FS_Drv.dir_read_cb = Lvgl_FS_Dir_Read;
+  Lvgl_FS_Drv.dir_close_cb = Lvgl_FS_Dir_Close;
+  lv_fs_drv_register(&Lvgl_FS_Drv);
+}
+
+/********************************************************** Bench **********************************************************/
+// The uncached comparison: every lv_fs_read is a read() through VFS and FATFS, which is what the STDIO driver of
+// lv_conf.h did before S: replaced it
+static void *Lvgl_FS_Raw_Open(lv_fs_drv_t *drv, const char *path, lv_fs_mode_t mode)
+{
+  char full[256];
+  Lvgl_FS_Path(full, sizeof(full), path);
+  int fd = open(full, O_RDONLY);
+  return fd < 0 ? NULL : (void *)(intptr_t)(fd + 1);
+}
+
+static lv_fs_res_t Lvgl_FS_Raw_Close(lv_fs_drv_t *drv, void *file_p)
+{
+  close((int)(intptr_t)file_p - 1);
+  return LV_FS_RES_OK;
+}
+
+static lv_fs_res_t Lvgl_FS_Raw_Read(lv_fs_drv_t *drv, void *file_p, void *buf, uint32_t btr, uint32_t *br)
+{
+  ssize_t n = read((int)(intptr_t)file_p - 1, buf, btr);
+  *br = n < 0 ? 0 : (uint32_t)n;
+  return n < 0 ? LV_FS_RES_HW_ERR : LV_FS_RES_OK;
+}
+
+static lv_fs_res_t Lvgl_FS_Raw_Seek(lv_fs_drv_t *drv, void *file_p, uint32_t pos, lv_fs_whence_t whence)
+{
+  int w = whence == LV_FS_SEEK_CUR ? SEEK_CUR : whence == LV_FS_SEEK_END ? SEEK_END : SEEK_SET;
+  return lseek((int)(intptr_t)file_p - 1, pos, w) < 0 ? LV_FS_RES_HW_ERR : LV_FS_RES_OK;
+}
+
+static lv_fs_res_t Lvgl_FS_Raw_Tell(lv_fs_drv_t *drv, void *file_p, uint32_t *pos_p)
+{
+  *pos_p = (uint32_t)lseek((int)(intptr_t)file_p - 1, 0, SEEK_CUR);
+  return LV_FS_RES_OK;
+}
+
+static lv_fs_drv_t Lvgl_FS_Raw_Drv;
+
+// Loads Path as whatever it is: a binary font has a "head" section first, an LVGL image starts with its magic.
+// Returns the load time in microseconds, 0 for other files and failures.
+static uint32_t Lvgl_FS_Bench_Load(const char *Path, bool *Is_font)
+{
+  uint8_t head[12];
+  lv_fs_file_t f;
+  uint32_t br = 0;
+  if (lv_fs_open(&f, Path, LV_FS_MODE_RD) != LV_FS_RES_OK)
+    return 0;
+  lv_fs_read(&f, head, sizeof(head), &br);
+  lv_fs_close(&f);
+  if (br < sizeof(head))
+    return 0;
+  *Is_font = memcmp(head + 4, "head", 4) == 0;
+  if (!*Is_font && head[0] != LV_IMAGE_HEADER_MAGIC)
+    return 0;
+
+  int64_t t0 = esp_timer_get_time();
+  if (*Is_font) {
+    lv_font_t *font = lv_binfont_create(Path);
+    if (font == NULL)
+      return 0;
+    t0 = esp_timer_get_time() - t0;
+    lv_binfont_destroy(font);
+    return (uint32_t)t0;
+  }
+  lv_image_cache_drop(Path);                                    // Decode from the file, not from LVGL's image cache
+  lv_image_decoder_dsc_t dsc;
+  if (lv_image_decoder_open(&dsc, Path, NULL) != LV_RESULT_OK)
+    return 0;
+  t0 = esp_timer_get_time() - t0;
+  lv_image_decoder_close(&dsc);
+  lv_image_cache_drop(Path);
+  return (uint32_t)t0;
+}
+
+void Lvgl_FS_Bench(const char *Dir)
+{
+  if (Lvgl_FS_Drv.letter == 0) {
+    printf("LVGL FS bench: Lvgl_FS_Init() has not run\r\n");
+    return;
+  }
+  if (Lvgl_FS_Raw_Drv.letter == 0) {
+    lv_fs_drv_init(&Lvgl_FS_Raw_Drv);
+    Lvgl_FS_Raw_Drv.letter = LVGL_FS_RAW_LETTER;
+    Lvgl_FS_Raw_Drv.open_cb = Lvgl_FS_Raw_Open;
+    Lvgl_FS_Raw_Drv.close_cb = Lvgl_FS_Raw_Close;
+    Lvgl_FS_Raw_Drv.read_cb = Lvgl_FS_Raw_Read;
+    Lvgl_FS_Raw_Drv.seek_cb = Lvgl_FS_Raw_Seek;
+    Lvgl_FS_Raw_Drv.tell_cb = Lvgl_FS_Raw_Tell;
+    lv_fs_drv_register(&Lvgl_FS_Raw_Drv);
+  }
+
+  char dir[128], name[128], path[272];
+  snprintf(dir, sizeof(dir), "%c:%s", LVGL_FS_LETTER, Dir);
+  lv_fs_dir_t d;
+  if (lv_fs_dir_open(&d, dir) != LV_FS_RES_OK) {
+    printf("LVGL FS bench: cannot open %s\r\n", dir);
+    return;
+  }
+  SD_Cache_Reset_Stats();
+  uint64_t total[3] = {0, 0, 0};
+  uint32_t files = 0;
+  printf("LVGL FS bench: %-32s %10s %10s %10s\r\n", Dir, "uncached", "cold", "warm");
+  while (lv_fs_dir_read(&d, name, sizeof(name)) == LV_FS_RES_OK && name[0]) {
+    if (name[0] == '/')
+      continue;
+    bool font = false;
+    uint32_t us[3];
+    snprintf(path, sizeof(path), "%c:%s/%s", LVGL_FS_RAW_LETTER, Dir, name);
+    us[0] = Lvgl_FS_Bench_Load(path, &font);
+    if (us[0] == 0)
+      continue;
+    path[0] = LVGL_FS_LETTER;
+    SD_Cache_Drop();
+    us[1] = Lvgl_FS_Bench_Load(path, &font);
+    us[2] = Lvgl_FS_Bench_Load(path, &font);
+    printf("LVGL FS bench: %-26s %-5s %8lu us %8lu us %8lu us\r\n", name, font ? "font" : "image", us[0], us[1],
+           us[2]);
+    for (int i = 0; i < 3; i++)
+      total[i] += us[i];
+    files++;
+  }
+  lv_fs_dir_close(&d);
+  if (files == 0) {
+    printf("LVGL FS bench: no LVGL images or binary fonts in %s\r\n", Dir);
+    return;
+  }
+  printf("LVGL FS bench: %lu files, uncached %llu ms, cached cold %llu ms (%.1fx), warm %llu ms (%.1fx)\r\n", files,
+         total[0] / 1000, total[1] / 1000, (double)total[0] / (total[1] ? total[1] : 1), total[2] / 1000,
+         (double)total[0] / (total[2] ? total[2] : 1));
+  SD_Cache_Print_Stats();
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "LVGL_Driver.h"
+#include "SD_Cache.h"
+
+/****************************************************** LVGL file system ******************************************************/
+// LVGL drive letter for the SD card, read through SD_Cache: "S:/img/logo.bin" is /sdcard/img/logo.bin. Read-only;
+// files are written with POSIX or SD_MMC calls. The lv_fs single-buffer cache stays off, the block cache replaces it.
+// LV_USE_FS_STDIO is off in lv_conf.h, so every LVGL read from the card goes through the cache.
+#define LVGL_FS_LETTER           'S'
+#define LVGL_FS_ROOT             "/sdcard"
+#define LVGL_FS_RAW_LETTER       'R'                      // Uncached, one VFS read per lv_fs_read: Lvgl_FS_Bench() only
+
+void Lvgl_FS_Init(void);                                  // After lv_init() and SD_Init()
+void Lvgl_FS_Bench(const char *Dir);                      // Loads every LVGL image and binary font in Dir, e.g.
+                                                          // "/bench", uncached, cached cold and cached warm
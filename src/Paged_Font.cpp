@@ -0,0 +1,780 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "SD_Cache.h"
+#include "Asset_Pack.h"
+#include "Paged_Font.h"
+
+// The file as lv_font_conv writes it and lib/lvgl/src/font/lv_binfont_loader.c reads it: tables "head", "cmap",
+// "loca", "glyf" and optionally "kern", each a 32-bit length (label included) and a 4-character label
+typedef struct {
+  uint32_t version;
+  uint16_t tables_count;
+  uint16_t font_size;
+  uint16_t ascent;
+  int16_t  descent;
+  uint16_t typo_ascent;
+  int16_t  typo_descent;
+  uint16_t typo_line_gap;
+  int16_t  min_y;
+  int16_t  max_y;
+  uint16_t default_advance_width;
+  uint16_t kerning_scale;
+  uint8_t  index_to_loc_format;                                 // 0: 16-bit offsets, 1: 32-bit
+  uint8_t  glyph_id_format;                                     // Of kerning pairs, 0: 8-bit, 1: 16-bit
+  uint8_t  advance_width_format;                                // 0: whole pixels
+  uint8_t  bits_per_pixel;
+  uint8_t  xy_bits;
+  uint8_t  wh_bits;
+  uint8_t  advance_width_bits;                                  // 0: every glyph has default_advance_width
+  uint8_t  compression_id;                                      // lv_font_fmt_txt_bitmap_format_t
+  uint8_t  subpixels_mode;
+  uint8_t  padding;
+  int16_t  underline_position;
+  uint16_t underline_thickness;
+} Paged_Head_t;
+
+typedef struct {
+  uint32_t data_offset;                                         // From the start of the cmap table
+  uint32_t range_start;
+  uint16_t range_length;
+  uint16_t glyph_id_start;
+  uint16_t data_entries_count;
+  uint8_t  format_type;                                         // lv_font_fmt_txt_cmap_type_t
+  uint8_t  padding;
+} Paged_Cmap_t;
+
+typedef struct Paged_Font Paged_Font_t;
+typedef struct Paged_Glyph Paged_Glyph_t;
+
+// A bitmap in the cache, as the font file has it (bpp bits per pixel, or compressed), the bytes right after
+struct Paged_Glyph {
+  Paged_Glyph_t *Newer;                                         // LRU list, most recent at Paged_Newest
+  Paged_Glyph_t *Older;
+  Paged_Glyph_t *Next;                                          // Hash chain
+  Paged_Font_t  *Font;
+  uint32_t       Gid;
+  uint32_t       Size;
+};
+
+struct Paged_Font {
+  lv_font_t             Font;                                   // First: LVGL hands this pointer back
+  lv_font_fmt_txt_dsc_t Dsc;                                    // What lv_binfont_create() builds, without bitmaps
+  lv_fs_file_t          File;                                   // Open for the font's life
+  const uint8_t        *Map;                                    // The file in a mapped pack, or NULL
+  uint32_t              Size;                                   // Of the file
+  Paged_Head_t          Head;
+  uint32_t              Glyphs;
+  uint32_t              Glyf_start;
+  uint32_t              Glyf_length;
+  const uint16_t       *Loca16;                                 // Glyph offsets in the glyf table, one of the two
+  const uint32_t       *Loca32;
+  uint32_t             *Known;                                  // A bit per glyph: descriptor read
+  uint8_t               Nbits;                                  // Glyph header bits, before the bitmap
+  uint32_t              Kern_mapping;                           // Entries of each kerning class mapping
+  uint32_t              Index_bytes;
+  uint32_t              Cached;                                 // Of its bitmaps in the cache
+  uint32_t              Glyphs_cached;
+  char                  Path[64];
+  Paged_Font_t         *Next_font;
+};
+
+static Paged_Glyph_t      *Paged_Buckets[PAGED_FONT_BUCKETS];
+static Paged_Glyph_t      *Paged_Newest = NULL;
+static Paged_Glyph_t      *Paged_Oldest = NULL;
+static Paged_Font_t       *Paged_Fonts = NULL;
+static Paged_Font_Stats_t  Paged_Stats;
+
+static void *Paged_Alloc(size_t Size)
+{
+  void *p = heap_caps_malloc(Size, MALLOC_CAP_SPIRAM);
+  return p ? p : malloc(Size);
+}
+
+/********************************************************** Reading **********************************************************/
+static bool Paged_Read(Paged_Font_t *pf, uint32_t Offset, void *Buf, uint32_t Length)
+{
+  if (Offset > pf->Size || Length > pf->Size - Offset)
+    return false;
+  Paged_Stats.Read_bytes += Length;
+  if (pf->Map) {
+    memcpy(Buf, pf->Map + Offset, Length);
+    return true;
+  }
+  uint32_t br = 0;
+  return lv_fs_seek(&pf->File, Offset, LV_FS_SEEK_SET) == LV_FS_RES_OK &&
+         lv_fs_read(&pf->File, Buf, Length, &br) == LV_FS_RES_OK && br == Length;
+}
+
+// Length bytes at Offset, resident: where they are mapped when aligned for their type, else read into an allocation
+static const void *Paged_Table(Paged_Font_t *pf, uint32_t Offset, uint32_t Length, uint32_t Align)
+{
+  if (Offset > pf->Size || Length > pf->Size - Offset)
+    return NULL;
+  if (pf->Map && ((uintptr_t)(pf->Map + Offset) & (Align - 1)) == 0)
+    return pf->Map + Offset;
+  void *p = Paged_Alloc(Length ? Length : 1);
+  if (p == NULL || !Paged_Read(pf, Offset, p, Length)) {
+    free(p);
+    return NULL;
+  }
+  pf->Index_bytes += Length;
+  return p;
+}
+
+static void Paged_Free_Table(Paged_Font_t *pf, const void *p)
+{
+  if (p && !(pf->Map && (const uint8_t *)p >= pf->Map && (const uint8_t *)p < pf->Map + pf->Size))
+    free((void *)p);
+}
+
+// The length of the table at Offset, -1 if its label is not there
+static int32_t Paged_Label(Paged_Font_t *pf, uint32_t Offset, const char *Label)
+{
+  uint8_t head[8];
+  uint32_t length;
+  if (!Paged_Read(pf, Offset, head, sizeof(head)) || memcmp(head + 4, Label, 4) != 0)
+    return -1;
+  memcpy(&length, head, sizeof(length));
+  return length >= sizeof(head) && length <= pf->Size - Offset ? (int32_t)length : -1;
+}
+
+static uint32_t Paged_Offset(const Paged_Font_t *pf, uint32_t Gid)
+{
+  if (Gid >= pf->Glyphs)
+    return pf->Glyf_length;
+  return pf->Loca32 ? pf->Loca32[Gid] : pf->Loca16[Gid];
+}
+
+/********************************************************** Glyph index **********************************************************/
+static int Paged_Compare_U16(const void *a, const void *b)
+{
+  return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+
+// get_glyph_dsc_id() of lv_font_fmt_txt.c, on the same tables: 0 when the font has no glyph for Letter
+static uint32_t Paged_Glyph_Id(const Paged_Font_t *pf, uint32_t Letter)
+{
+  if (Letter == '\0')
+    return 0;
+  for (uint16_t i = 0; i < pf->Dsc.cmap_num; i++) {
+    const lv_font_fmt_txt_cmap_t *c = &pf->Dsc.cmaps[i];
+    uint32_t rcp = Letter - c->range_start;
+    if (rcp >= c->range_length)
+      continue;
+    if (c->type == LV_FONT_FMT_TXT_CMAP_FORMAT0_TINY)
+      return c->glyph_id_start + rcp;
+    if (c->type == LV_FONT_FMT_TXT_CMAP_FORMAT0_FULL)
+      return c->glyph_id_start + ((const uint8_t *)c->glyph_id_ofs_list)[rcp];
+    uint16_t key = (uint16_t)rcp;
+    const uint16_t *p = (const uint16_t *)bsearch(&key, c->unicode_list, c->list_length, sizeof(uint16_t),
+                                                  Paged_Compare_U16);
+    if (p == NULL)
+      return 0;
+    uint32_t ofs = (uint32_t)(p - c->unicode_list);
+    if (c->type == LV_FONT_FMT_TXT_CMAP_SPARSE_TINY)
+      return c->glyph_id_start + ofs;
+    return c->glyph_id_start + ((const uint16_t *)c->glyph_id_ofs_list)[ofs];
+  }
+  return 0;
+}
+
+static uint32_t Paged_Bits_Get(const uint8_t *In, uint32_t *Pos, uint8_t Count)
+{
+  uint32_t v = 0;
+  for (uint8_t i = 0; i < Count; i++, (*Pos)++)
+    v = (v << 1) | ((In[*Pos >> 3] >> (7 - (*Pos & 7))) & 1);
+  return v;
+}
+
+static int32_t Paged_Bits_Signed(const uint8_t *In, uint32_t *Pos, uint8_t Count)
+{
+  uint32_t v = Paged_Bits_Get(In, Pos, Count);
+  if (Count && (v & (1u << (Count - 1))))
+    v |= ~0u << Count;
+  return (int32_t)v;
+}
+
+// Reads the header of glyph Gid into its descriptor the first time it is asked for, as load_glyph() does for all
+static bool Paged_Describe(Paged_Font_t *pf, uint32_t Gid)
+{
+  if (Gid >= pf->Glyphs)                                        // A character map pointing past the glyphs
+    return false;
+  if (pf->Known[Gid >> 5] & (1u << (Gid & 31)))
+    return true;
+  const Paged_Head_t *h = &pf->Head;
+  uint8_t head[8] = {0};
+  uint32_t offset = Paged_Offset(pf, Gid);
+  uint32_t length = (pf->Nbits + 7) / 8;
+  if (length > pf->Glyf_length - offset)
+    length = pf->Glyf_length - offset;
+  if (!Paged_Read(pf, pf->Glyf_start + offset, head, length)) {
+    Paged_Stats.Failures++;
+    return false;
+  }
+  lv_font_fmt_txt_glyph_dsc_t *g = (lv_font_fmt_txt_glyph_dsc_t *)&pf->Dsc.glyph_dsc[Gid];
+  uint32_t pos = 0;
+  uint32_t adv_w = h->advance_width_bits ? Paged_Bits_Get(head, &pos, h->advance_width_bits) : h->default_advance_width;
+  g->adv_w = h->advance_width_format == 0 ? adv_w * 16 : adv_w;
+  g->ofs_x = (int8_t)Paged_Bits_Signed(head, &pos, h->xy_bits);
+  g->ofs_y = (int8_t)Paged_Bits_Signed(head, &pos, h->xy_bits);
+  g->box_w = (uint8_t)Paged_Bits_Get(head, &pos, h->wh_bits);
+  g->box_h = (uint8_t)Paged_Bits_Get(head, &pos, h->wh_bits);
+  g->bitmap_index = 0;                                          // glyph_bitmap is pointed at the bitmap to draw
+  pf->Known[Gid >> 5] |= 1u << (Gid & 31);
+  Paged_Stats.Described++;
+  return true;
+}
+
+/********************************************************** Cache **********************************************************/
+static uint32_t Paged_Bucket(const Paged_Font_t *pf, uint32_t Gid)
+{
+  return ((Gid * 2654435761u) ^ (uint32_t)((uintptr_t)pf >> 4)) & (PAGED_FONT_BUCKETS - 1);
+}
+
+static void Paged_Unlink(Paged_Glyph_t *g)
+{
+  if (g->Newer)
+    g->Newer->Older = g->Older;
+  else
+    Paged_Newest = g->Older;
+  if (g->Older)
+    g->Older->Newer = g->Newer;
+  else
+    Paged_Oldest = g->Newer;
+}
+
+static void Paged_Push(Paged_Glyph_t *g)
+{
+  g->Newer = NULL;
+  g->Older = Paged_Newest;
+  if (Paged_Newest)
+    Paged_Newest->Newer = g;
+  Paged_Newest = g;
+  if (Paged_Oldest == NULL)
+    Paged_Oldest = g;
+}
+
+static void Paged_Evict(Paged_Glyph_t *g)
+{
+  Paged_Glyph_t **p = &Paged_Buckets[Paged_Bucket(g->Font, g->Gid)];
+  while (*p != g)
+    p = &(*p)->Next;
+  *p = g->Next;
+  Paged_Unlink(g);
+  uint32_t size = sizeof(Paged_Glyph_t) + g->Size;
+  g->Font->Cached -= size;
+  g->Font->Glyphs_cached--;
+  Paged_Stats.Resident -= size;
+  free(g);
+}
+
+// The bitmap of glyph Gid as the file has it, from the cache or read into it now; in place in a mapped pack when
+// the glyph header ends on a byte boundary
+static const uint8_t *Paged_Bitmap(Paged_Font_t *pf, uint32_t Gid)
+{
+  uint32_t offset = Paged_Offset(pf, Gid) + pf->Nbits / 8;
+  uint32_t end = Paged_Offset(pf, Gid + 1);
+  if (end <= offset) {
+    Paged_Stats.Failures++;
+    return NULL;
+  }
+  if (pf->Map && pf->Nbits % 8 == 0) {
+    Paged_Stats.In_place++;
+    return pf->Map + pf->Glyf_start + offset;
+  }
+  Paged_Glyph_t *g = Paged_Buckets[Paged_Bucket(pf, Gid)];
+  while (g && !(g->Font == pf && g->Gid == Gid))
+    g = g->Next;
+  if (g) {
+    Paged_Unlink(g);
+    Paged_Push(g);
+    Paged_Stats.Hits++;
+    return (const uint8_t *)(g + 1);
+  }
+
+  uint32_t length = end - offset;
+  uint32_t size = sizeof(Paged_Glyph_t) + length;
+  if (size > PAGED_FONT_CACHE_SIZE) {
+    Paged_Stats.Failures++;
+    return NULL;
+  }
+  while (Paged_Stats.Resident + size > PAGED_FONT_CACHE_SIZE) {
+    Paged_Evict(Paged_Oldest);
+    Paged_Stats.Evictions++;
+  }
+  int64_t t0 = esp_timer_get_time();
+  g = (Paged_Glyph_t *)Paged_Alloc(size);
+  uint8_t *bits = (uint8_t *)(g + 1);
+  if (g == NULL || !Paged_Read(pf, pf->Glyf_start + offset, bits, length)) {
+    free(g);
+    Paged_Stats.Failures++;
+    return NULL;
+  }
+  uint8_t shift = pf->Nbits % 8;
+  if (shift) {                                                  // The bitmap starts inside the header's last byte
+    for (uint32_t i = 0; i + 1 < length; i++)
+      bits[i] = (uint8_t)((bits[i] << shift) | (bits[i + 1] >> (8 - shift)));
+    bits[length - 1] = (uint8_t)(bits[length - 1] << shift);
+  }
+  g->Font = pf;
+  g->Gid = Gid;
+  g->Size = length;
+  uint32_t b = Paged_Bucket(pf, Gid);
+  g->Next = Paged_Buckets[b];
+  Paged_Buckets[b] = g;
+  Paged_Push(g);
+  pf->Cached += size;
+  pf->Glyphs_cached++;
+  Paged_Stats.Misses++;
+  Paged_Stats.Read_us += esp_timer_get_time() - t0;
+  Paged_Stats.Resident += size;
+  if (Paged_Stats.Resident > Paged_Stats.Peak)
+    Paged_Stats.Peak = Paged_Stats.Resident;
+  return bits;
+}
+
+/********************************************************** LVGL callbacks **********************************************************/
+static bool Paged_Glyph_Dsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc_out, uint32_t letter, uint32_t letter_next)
+{
+  Paged_Font_t *pf = (Paged_Font_t *)font;
+  uint32_t gid = Paged_Glyph_Id(pf, letter == '\t' ? ' ' : letter);
+  if (gid == 0 || !Paged_Describe(pf, gid))
+    return false;
+  return lv_font_get_glyph_dsc_fmt_txt(font, dsc_out, letter, letter_next);   // Kerning needs none of letter_next
+}
+
+static const void *Paged_Glyph_Bitmap(lv_font_glyph_dsc_t *g_dsc, uint32_t letter, lv_draw_buf_t *draw_buf)
+{
+  Paged_Font_t *pf = (Paged_Font_t *)g_dsc->resolved_font;
+  uint32_t gid = Paged_Glyph_Id(pf, letter == '\t' ? ' ' : letter);
+  if (gid == 0 || !Paged_Describe(pf, gid))
+    return NULL;
+  const lv_font_fmt_txt_glyph_dsc_t *g = &pf->Dsc.glyph_dsc[gid];
+  if (g->box_w * g->box_h == 0)
+    return NULL;
+  const uint8_t *bits = Paged_Bitmap(pf, gid);
+  if (bits == NULL)
+    return NULL;
+  pf->Dsc.glyph_bitmap = bits;                                  // At bitmap_index 0: LVGL unpacks it to A8
+  return lv_font_get_bitmap_fmt_txt(g_dsc, letter, draw_buf);
+}
+
+/********************************************************** Loading **********************************************************/
+static bool Paged_Load_Cmaps(Paged_Font_t *pf, uint32_t Start)
+{
+  uint32_t count;
+  if (!Paged_Read(pf, Start + 8, &count, sizeof(count)) || count == 0 || count > 511)     // cmap_num has 9 bits
+    return false;
+  lv_font_fmt_txt_cmap_t *cmaps = (lv_font_fmt_txt_cmap_t *)Paged_Alloc(count * sizeof(lv_font_fmt_txt_cmap_t));
+  Paged_Cmap_t *tables = (Paged_Cmap_t *)malloc(count * sizeof(Paged_Cmap_t));
+  bool ok = cmaps && tables && Paged_Read(pf, Start + 12, tables, count * sizeof(Paged_Cmap_t));
+  if (cmaps) {
+    memset(cmaps, 0, count * sizeof(lv_font_fmt_txt_cmap_t));
+    pf->Dsc.cmaps = cmaps;
+    pf->Dsc.cmap_num = (uint16_t)count;
+    pf->Index_bytes += count * sizeof(lv_font_fmt_txt_cmap_t);
+  }
+  for (uint32_t i = 0; ok && i < count; i++) {
+    const Paged_Cmap_t *t = &tables[i];
+    lv_font_fmt_txt_cmap_t *c = &cmaps[i];
+    uint32_t data = Start + t->data_offset;
+    c->range_start = t->range_start;
+    c->range_length = t->range_length;
+    c->glyph_id_start = t->glyph_id_start;
+    c->type = (lv_font_fmt_txt_cmap_type_t)t->format_type;
+    switch (t->format_type) {
+    case LV_FONT_FMT_TXT_CMAP_FORMAT0_FULL:
+      c->list_length = c->range_length;
+      c->glyph_id_ofs_list = Paged_Table(pf, data, t->data_entries_count, 1);
+      ok = c->glyph_id_ofs_list && t->data_entries_count >= c->range_length;
+      break;
+    case LV_FONT_FMT_TXT_CMAP_FORMAT0_TINY:
+      break;
+    case LV_FONT_FMT_TXT_CMAP_SPARSE_FULL:
+    case LV_FONT_FMT_TXT_CMAP_SPARSE_TINY:
+      c->list_length = t->data_entries_count;
+      c->unicode_list = (const uint16_t *)Paged_Table(pf, data, 2 * c->list_length, 2);
+      ok = c->unicode_list != NULL;
+      if (ok && t->format_type == LV_FONT_FMT_TXT_CMAP_SPARSE_FULL) {
+        c->glyph_id_ofs_list = Paged_Table(pf, data + 2 * c->list_length, 2 * c->list_length, 2);
+        ok = c->glyph_id_ofs_list != NULL;
+      }
+      break;
+    default:
+      ok = false;
+    }
+  }
+  free(tables);
+  return ok;
+}
+
+static bool Paged_Load_Kern(Paged_Font_t *pf, uint32_t Start)
+{
+  uint8_t format;
+  if (!Paged_Read(pf, Start + 8, &format, 1))
+    return false;
+  uint32_t at = Start + 12;
+  if (format == 0) {                                            // Sorted pairs
+    lv_font_fmt_txt_kern_pair_t *k = (lv_font_fmt_txt_kern_pair_t *)Paged_Alloc(sizeof(lv_font_fmt_txt_kern_pair_t));
+    uint32_t pairs;
+    if (k == NULL)
+      return false;
+    memset(k, 0, sizeof(*k));
+    pf->Dsc.kern_dsc = k;
+    pf->Dsc.kern_classes = 0;
+    pf->Index_bytes += sizeof(*k);
+    if (!Paged_Read(pf, at, &pairs, sizeof(pairs)))
+      return false;
+    uint32_t id_size = pf->Head.glyph_id_format == 0 ? 1 : 2;
+    k->glyph_ids_size = pf->Head.glyph_id_format;
+    k->pair_cnt = pairs;
+    k->glyph_ids = Paged_Table(pf, at + 4, 2 * id_size * pairs, id_size);
+    k->values = (const int8_t *)Paged_Table(pf, at + 4 + 2 * id_size * pairs, pairs, 1);
+    return k->glyph_ids && k->values;
+  }
+  if (format == 3) {                                            // Classes
+    lv_font_fmt_txt_kern_classes_t *k =
+      (lv_font_fmt_txt_kern_classes_t *)Paged_Alloc(sizeof(lv_font_fmt_txt_kern_classes_t));
+    uint8_t head[4];                                            // Mapping length, rows and columns
+    if (k == NULL)
+      return false;
+    memset(k, 0, sizeof(*k));
+    pf->Dsc.kern_dsc = k;
+    pf->Dsc.kern_classes = 1;
+    pf->Index_bytes += sizeof(*k);
+    if (!Paged_Read(pf, at, head, sizeof(head)))
+      return false;
+    uint32_t length = head[0] | (uint32_t)head[1] << 8;
+    k->left_class_cnt = head[2];
+    k->right_class_cnt = head[3];
+    pf->Kern_mapping = length;
+    at += sizeof(head);
+    k->left_class_mapping = (const uint8_t *)Paged_Table(pf, at, length, 1);
+    k->right_class_mapping = (const uint8_t *)Paged_Table(pf, at + length, length, 1);
+    k->class_pair_values = (const int8_t *)Paged_Table(pf, at + 2 * length, head[2] * head[3], 1);
+    return k->left_class_mapping && k->right_class_mapping && k->class_pair_values;
+  }
+  return false;
+}
+
+static bool Paged_Load(Paged_Font_t *pf)
+{
+  Paged_Head_t *h = &pf->Head;
+  int32_t head_length = Paged_Label(pf, 0, "head");
+  if (head_length < (int32_t)(8 + sizeof(*h)) || !Paged_Read(pf, 8, h, sizeof(*h)))
+    return false;
+  if (h->bits_per_pixel == 0 || h->bits_per_pixel > 8 || h->advance_width_bits + 2 * h->xy_bits + 2 * h->wh_bits > 64)
+    return false;
+  pf->Nbits = h->advance_width_bits + 2 * h->xy_bits + 2 * h->wh_bits;
+#if !LV_USE_FONT_COMPRESSED
+  if (h->compression_id != LV_FONT_FMT_TXT_PLAIN) {
+    printf("Paged font: %s is compressed, enable LV_USE_FONT_COMPRESSED in lv_conf.h or convert with --no-compress\r\n",
+           pf->Path);
+    return false;
+  }
+#endif
+  pf->Font.base_line = -h->descent;
+  pf->Font.line_height = h->ascent - h->descent;
+  pf->Font.subpx = h->subpixels_mode;
+  pf->Font.underline_position = (int8_t)h->underline_position;
+  pf->Font.underline_thickness = (int8_t)h->underline_thickness;
+  pf->Dsc.bpp = h->bits_per_pixel;
+  pf->Dsc.kern_scale = h->kerning_scale;
+  pf->Dsc.bitmap_format = h->compression_id;
+
+  uint32_t cmaps_start = (uint32_t)head_length;
+  int32_t cmaps_length = Paged_Label(pf, cmaps_start, "cmap");
+  if (cmaps_length < 12 || !Paged_Load_Cmaps(pf, cmaps_start))
+    return false;
+
+  uint32_t loca_start = cmaps_start + cmaps_length;
+  int32_t loca_length = Paged_Label(pf, loca_start, "loca");
+  uint32_t count;
+  if (loca_length < 12 || !Paged_Read(pf, loca_start + 8, &count, sizeof(count)) || count == 0 || count > 0xFFFF)
+    return false;
+  pf->Glyphs = count;
+  if (h->index_to_loc_format == 0)
+    pf->Loca16 = (const uint16_t *)Paged_Table(pf, loca_start + 12, 2 * count, 2);
+  else if (h->index_to_loc_format == 1)
+    pf->Loca32 = (const uint32_t *)Paged_Table(pf, loca_start + 12, 4 * count, 4);
+  if (pf->Loca16 == NULL && pf->Loca32 == NULL)
+    return false;
+
+  pf->Glyf_start = loca_start + loca_length;
+  int32_t glyf_length = Paged_Label(pf, pf->Glyf_start, "glyf");
+  if (glyf_length < 8)
+    return false;
+  pf->Glyf_length = (uint32_t)glyf_length;
+  uint32_t previous = 0;
+  for (uint32_t i = 0; i <= count; i++) {                       // Sizes are taken from the next offset
+    uint32_t offset = Paged_Offset(pf, i);
+    if (offset < previous || offset > pf->Glyf_length)
+      return false;
+    previous = offset;
+  }
+
+  lv_font_fmt_txt_glyph_dsc_t *glyph_dsc =
+    (lv_font_fmt_txt_glyph_dsc_t *)Paged_Alloc(count * sizeof(lv_font_fmt_txt_glyph_dsc_t));
+  pf->Known = (uint32_t *)Paged_Alloc((count + 31) / 32 * 4);
+  if (glyph_dsc == NULL || pf->Known == NULL) {
+    free(glyph_dsc);
+    return false;
+  }
+  memset(glyph_dsc, 0, count * sizeof(lv_font_fmt_txt_glyph_dsc_t));
+  memset(pf->Known, 0, (count + 31) / 32 * 4);
+  pf->Known[0] = 1;                                             // Glyph 0 is no glyph, all zero
+  pf->Dsc.glyph_dsc = glyph_dsc;
+  pf->Index_bytes += count * sizeof(lv_font_fmt_txt_glyph_dsc_t) + (count + 31) / 32 * 4;
+
+  if (h->tables_count < 4) {
+    pf->Dsc.kern_scale = 0;
+    return true;
+  }
+  uint32_t kern_start = pf->Glyf_start + pf->Glyf_length;
+  return Paged_Label(pf, kern_start, "kern") >= 12 && Paged_Load_Kern(pf, kern_start);
+}
+
+static void Paged_Release(Paged_Font_t *pf)
+{
+  for (Paged_Glyph_t *g = Paged_Oldest, *newer; g; g = newer) {
+    newer = g->Newer;
+    if (g->Font == pf)
+      Paged_Evict(g);
+  }
+  lv_font_fmt_txt_dsc_t *d = &pf->Dsc;
+  for (uint16_t i = 0; d->cmaps && i < d->cmap_num; i++) {
+    Paged_Free_Table(pf, d->cmaps[i].unicode_list);
+    Paged_Free_Table(pf, d->cmaps[i].glyph_id_ofs_list);
+  }
+  free((void *)d->cmaps);
+  if (d->kern_dsc && d->kern_classes == 0) {
+    const lv_font_fmt_txt_kern_pair_t *k = (const lv_font_fmt_txt_kern_pair_t *)d->kern_dsc;
+    Paged_Free_Table(pf, k->glyph_ids);
+    Paged_Free_Table(pf, k->values);
+  } else if (d->kern_dsc) {
+    const lv_font_fmt_txt_kern_classes_t *k = (const lv_font_fmt_txt_kern_classes_t *)d->kern_dsc;
+    Paged_Free_Table(pf, k->left_class_mapping);
+    Paged_Free_Table(pf, k->right_class_mapping);
+    Paged_Free_Table(pf, k->class_pair_values);
+  }
+  free((void *)d->kern_dsc);
+  free((void *)d->glyph_dsc);
+  free(pf->Known);
+  Paged_Free_Table(pf, pf->Loca16);
+  Paged_Free_Table(pf, pf->Loca32);
+  lv_fs_close(&pf->File);
+  free(pf);
+}
+
+/********************************************************** API **********************************************************/
+lv_font_t *Paged_Font_Create(const char *Path)
+{
+  Paged_Font_t *pf = (Paged_Font_t *)malloc(sizeof(Paged_Font_t));
+  if (pf == NULL)
+    return NULL;
+  memset(pf, 0, sizeof(*pf));
+  snprintf(pf->Path, sizeof(pf->Path), "%s", Path);
+  if (lv_fs_open(&pf->File, Path, LV_FS_MODE_RD) != LV_FS_RES_OK) {   // Holds a pack entry, mapped or not
+    printf("Paged font: cannot open %s\r\n", Path);
+    free(pf);
+    return NULL;
+  }
+  if (Path[0] == ASSET_PACK_LETTER && Path[1] == ':')
+    pf->Map = (const uint8_t *)Asset_Pack_Mapped(Path[2] == '/' ? Path + 3 : Path + 2, &pf->Size);
+  if (pf->Map == NULL) {
+    lv_fs_seek(&pf->File, 0, LV_FS_SEEK_END);
+    lv_fs_tell(&pf->File, &pf->Size);
+  }
+  pf->Index_bytes = sizeof(Paged_Font_t);
+  pf->Font.get_glyph_dsc = Paged_Glyph_Dsc;
+  pf->Font.get_glyph_bitmap = Paged_Glyph_Bitmap;
+  pf->Font.dsc = &pf->Dsc;
+  if (!Paged_Load(pf)) {
+    printf("Paged font: %s is not a binary font, or damaged\r\n", Path);
+    Paged_Release(pf);
+    return NULL;
+  }
+  pf->Next_font = Paged_Fonts;
+  Paged_Fonts = pf;
+  Paged_Stats.Fonts++;
+  Paged_Stats.Index_bytes += pf->Index_bytes;
+  return &pf->Font;
+}
+
+bool Paged_Font_Is(const lv_font_t *Font)
+{
+  return Font && Font->get_glyph_dsc == Paged_Glyph_Dsc;
+}
+
+void Paged_Font_Destroy(lv_font_t *Font)
+{
+  if (!Paged_Font_Is(Font))
+    return;
+  Paged_Font_t *pf = (Paged_Font_t *)Font;
+  Paged_Font_t **p = &Paged_Fonts;
+  while (*p && *p != pf)
+    p = &(*p)->Next_font;
+  if (*p)
+    *p = pf->Next_font;
+  Paged_Stats.Fonts--;
+  Paged_Stats.Index_bytes -= pf->Index_bytes;
+  Paged_Release(pf);
+}
+
+void Paged_Font_Get_Stats(Paged_Font_Stats_t *stats)
+{
+  *stats = Paged_Stats;
+}
+
+void Paged_Font_Print(void)
+{
+  for (const Paged_Font_t *pf = Paged_Fonts; pf; pf = pf->Next_font) {
+    uint32_t known = 0;
+    for (uint32_t i = 0; i < (pf->Glyphs + 31) / 32; i++)
+      known += __builtin_popcount(pf->Known[i]);
+    printf("Paged font: %-32s %5lu glyphs, %3lu px, %lu bpp, %5lu KB file%s, %lu KB index, %lu described, "
+           "%lu cached in %lu KB\r\n", pf->Path, pf->Glyphs, (uint32_t)pf->Font.line_height, (uint32_t)pf->Dsc.bpp,
+           pf->Size / 1024, pf->Map ? " mapped" : "", pf->Index_bytes / 1024, known - 1, pf->Glyphs_cached,
+           pf->Cached / 1024);
+  }
+  const Paged_Font_Stats_t *st = &Paged_Stats;
+  uint32_t lookups = st->Hits + st->Misses;
+  printf("Paged font: %lu fonts, %lu KB index; %lu described, %lu hits %lu misses (%lu%% hit), %lu in place, "
+         "%llu KB read, %llu ms, %lu evictions, %lu failures, %lu/%d KB cached, peak %lu KB\r\n",
+         st->Fonts, st->Index_bytes / 1024, st->Described, st->Hits, st->Misses,
+         lookups ? st->Hits * 100 / lookups : 0, st->In_place, st->Read_bytes / 1024, st->Read_us / 1000,
+         st->Evictions, st->Failures, st->Resident / 1024, PAGED_FONT_CACHE_SIZE / 1024, st->Peak / 1024);
+}
+
+/********************************************************** Bench **********************************************************/
+// What lv_binfont_create() allocated for Full, the font the paged one was loaded from
+static uint32_t Paged_Full_Bytes(const lv_font_t *Full, const Paged_Font_t *pf)
+{
+  const lv_font_fmt_txt_dsc_t *d = (const lv_font_fmt_txt_dsc_t *)Full->dsc;
+  uint32_t bytes = sizeof(lv_font_t) + sizeof(lv_font_fmt_txt_dsc_t) + d->cmap_num * sizeof(lv_font_fmt_txt_cmap_t) +
+                   pf->Glyphs * sizeof(lv_font_fmt_txt_glyph_dsc_t);
+  for (uint16_t i = 0; i < d->cmap_num; i++) {
+    const lv_font_fmt_txt_cmap_t *c = &d->cmaps[i];
+    if (c->type == LV_FONT_FMT_TXT_CMAP_FORMAT0_FULL)
+      bytes += c->list_length;
+    else if (c->type == LV_FONT_FMT_TXT_CMAP_SPARSE_TINY)
+      bytes += 2 * c->list_length;
+    else if (c->type == LV_FONT_FMT_TXT_CMAP_SPARSE_FULL)
+      bytes += 4 * c->list_length;
+  }
+  for (uint32_t i = 1; i < pf->Glyphs; i++) {                   // As load_glyph() sizes glyph_bitmap
+    if (d->glyph_dsc[i].box_w * d->glyph_dsc[i].box_h != 0)
+      bytes += Paged_Offset(pf, i + 1) - Paged_Offset(pf, i) - pf->Nbits / 8;
+  }
+  if (d->kern_dsc && d->kern_classes == 0) {
+    const lv_font_fmt_txt_kern_pair_t *k = (const lv_font_fmt_txt_kern_pair_t *)d->kern_dsc;
+    bytes += sizeof(*k) + k->pair_cnt * (k->glyph_ids_size ? 5 : 3);
+  } else if (d->kern_dsc) {
+    const lv_font_fmt_txt_kern_classes_t *k = (const lv_font_fmt_txt_kern_classes_t *)d->kern_dsc;
+    bytes += sizeof(*k) + 2 * pf->Kern_mapping + k->left_class_cnt * k->right_class_cnt;
+  }
+  return bytes;
+}
+
+// Descriptor and bitmap of every character of Text, as lv_draw_label asks for them
+static uint32_t Paged_Draw_Text(const lv_font_t *Font, const char *Text, lv_draw_buf_t *Buf)
+{
+  int64_t t0 = esp_timer_get_time();
+  uint32_t i = 0;
+  uint32_t letter = _lv_text_encoded_next(Text, &i);
+  while (letter) {
+    uint32_t next = _lv_text_encoded_next(Text, &i);
+    lv_font_glyph_dsc_t g;
+    if (lv_font_get_glyph_dsc(Font, &g, letter, next) && g.box_w * g.box_h != 0)
+      lv_font_get_glyph_bitmap(&g, letter, Buf);
+    letter = next;
+  }
+  return (uint32_t)(esp_timer_get_time() - t0);
+}
+
+// Characters whose descriptor or A8 bitmap differ between the two fonts
+static uint32_t Paged_Compare(const lv_font_t *Full, const lv_font_t *Paged, const char *Text, lv_draw_buf_t *A,
+                              lv_draw_buf_t *B, uint32_t *Characters)
+{
+  uint32_t bad = 0, i = 0;
+  uint32_t letter = _lv_text_encoded_next(Text, &i);
+  *Characters = 0;
+  while (letter) {
+    uint32_t next = _lv_text_encoded_next(Text, &i);
+    lv_font_glyph_dsc_t a, b;
+    bool found_a = lv_font_get_glyph_dsc(Full, &a, letter, next);
+    bool found_b = lv_font_get_glyph_dsc(Paged, &b, letter, next);
+    bool same = found_a == found_b && a.adv_w == b.adv_w && a.box_w == b.box_w && a.box_h == b.box_h &&
+                a.ofs_x == b.ofs_x && a.ofs_y == b.ofs_y && a.format == b.format;
+    if (same && found_a && a.box_w * a.box_h != 0) {
+      memset(A->data, 0, A->data_size);
+      memset(B->data, 0, B->data_size);
+      const void *pa = lv_font_get_glyph_bitmap(&a, letter, A);
+      const void *pb = lv_font_get_glyph_bitmap(&b, letter, B);
+      uint32_t stride = lv_draw_buf_width_to_stride(a.box_w, LV_COLOR_FORMAT_A8);
+      same = (pa == NULL) == (pb == NULL) && memcmp(A->data, B->data, stride * a.box_h) == 0;
+    }
+    bad += !same;
+    (*Characters)++;
+    letter = next;
+  }
+  return bad;
+}
+
+esp_err_t Paged_Font_Measure(const char *Path, const char *Text, Paged_Font_Report_t *Report)
+{
+  memset(Report, 0, sizeof(*Report));
+  SD_Cache_Drop();                                              // Each load from the card, not from the other's blocks
+  int64_t t0 = esp_timer_get_time();
+  lv_font_t *full = lv_binfont_create(Path);
+  Report->Full_load_us = (uint32_t)(esp_timer_get_time() - t0);
+  SD_Cache_Drop();
+  t0 = esp_timer_get_time();
+  lv_font_t *paged = Paged_Font_Create(Path);
+  Report->Paged_load_us = (uint32_t)(esp_timer_get_time() - t0);
+  lv_draw_buf_t *a = lv_draw_buf_create(255, 255, LV_COLOR_FORMAT_A8, LV_STRIDE_AUTO);   // Glyphs are up to 255 px
+  lv_draw_buf_t *b = lv_draw_buf_create(255, 255, LV_COLOR_FORMAT_A8, LV_STRIDE_AUTO);
+  esp_err_t err = full == NULL || paged == NULL ? ESP_FAIL : a == NULL || b == NULL ? ESP_ERR_NO_MEM : ESP_OK;
+  if (err == ESP_OK) {
+    const Paged_Font_t *pf = (const Paged_Font_t *)paged;
+    Report->Glyphs = pf->Glyphs;
+    Report->File_bytes = pf->Size;
+    Report->Index_bytes = pf->Index_bytes;
+    Report->Full_text_us = Paged_Draw_Text(full, Text, a);
+    SD_Cache_Drop();
+    Report->Cold_text_us = Paged_Draw_Text(paged, Text, a);
+    Report->Warm_text_us = Paged_Draw_Text(paged, Text, a);
+    Report->Cache_bytes = pf->Cached;
+    Report->Mismatches = Paged_Compare(full, paged, Text, a, b, &Report->Characters);
+    Report->Full_bytes = Paged_Full_Bytes(full, pf);
+  }
+  if (a)
+    lv_draw_buf_destroy(a);
+  if (b)
+    lv_draw_buf_destroy(b);
+  Paged_Font_Destroy(paged);
+  lv_binfont_destroy(full);
+  return err;
+}
+
+void Paged_Font_Bench(const char *const Paths[], int Count, const char *Text)
+{
+  for (int i = 0; i < Count; i++) {
+    Paged_Font_Report_t r;
+    esp_err_t err = Paged_Font_Measure(Paths[i], Text, &r);
+    if (err != ESP_OK) {
+      printf("Paged font: %s: %s\r\n", Paths[i], esp_err_to_name(err));
+      continue;
+    }
+    printf("Paged font: %s, %lu glyphs, %lu KB file: full %lu KB of RAM loaded in %lu ms, paged %lu KB (%lu%%) in "
+           "%lu ms\r\n", Paths[i], r.Glyphs, r.File_bytes / 1024, r.Full_bytes / 1024, r.Full_load_us / 1000,
+           r.Index_bytes / 1024, r.Full_bytes ? r.Index_bytes * 100 / r.Full_bytes : 0, r.Paged_load_us / 1000);
+    printf("Paged font: %lu characters: full %lu us, paged cold %lu us, warm %lu us, %lu bytes cached%s\r\n",
+           r.Characters, r.Full_text_us, r.Cold_text_us, r.Warm_text_us, r.Cache_bytes,
+           r.Mismatches ? ", MISMATCHES" : "");
+  }
+  Paged_Font_Print();
+}
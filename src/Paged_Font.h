@@ -0,0 +1,72 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <lvgl.h>
+#include "esp_err.h"
+
+/****************************************************** Paged fonts ******************************************************/
+// Binary fonts (lv_font_conv --format bin) drawn without loading them: lv_binfont_create() reads every glyph bitmap
+// into RAM, a megabyte for a 16 px CJK set, where this keeps only the glyph index resident and reads bitmaps from
+// the file when a glyph is drawn.
+//   - resident: the character maps, kerning, the glyph offsets and, filled in on first use, the 8-byte descriptor of
+//     each glyph, about 12-16 bytes per glyph. Opening a font reads nothing else.
+//   - bitmaps go into one cache shared by every paged font, PAGED_FONT_CACHE_SIZE bytes of PSRAM, least recently
+//     used evicted first. A glyph's descriptor and bitmap are handed to LVGL's own lv_font_fmt_txt code, so glyphs
+//     come out as lv_binfont_create() draws them, kerning and compressed bitmaps included.
+// Paths are LVGL's: "S:/fonts/cjk_16.bin" reads the card through SD_Cache, "P:fonts/cjk_16" an asset pack entry. An
+// entry of a pack on the card is read from it at the glyph's offset; in a mapped pack (src/Asset_Flash.h) the
+// tables are used where they are mapped, and so are the bitmaps when they start on a byte boundary. Pack such fonts
+// without LZ4 (tools/asset_pack.py --store): a compressed entry is unpacked whole into the pack's cache.
+// The file stays open until Paged_Font_Destroy(). LVGL context only.
+#define PAGED_FONT_CACHE_SIZE    (256 * 1024)             // PSRAM for glyph bitmaps of all paged fonts
+#define PAGED_FONT_BUCKETS       1024                     // Hash buckets of the cache, a power of two
+#define PAGED_FONT_BENCH_PATH    "S:/fonts/bench.bin"     // Paged_Font_Bench() from main.cpp
+#define PAGED_FONT_BENCH_TEXT    "Temperature 23.5 \xC2\xB0" "C Gr\xC3\xB6\xC3\x9F" "e " \
+                                 "\xE6\xB8\xA9\xE5\xBA\xA6\xE6\xB9\xBF\xE5\xBA\xA6\xE8\xAE\xBE\xE7\xBD\xAE" \
+                                 "\xE7\x94\xB5\xE6\xB1\xA0 \xE6\x9D\xB1\xE4\xBA\xAC"
+                                                          // Accented Latin, then CJK: temperature, humidity,
+                                                          // settings, battery, Tokyo
+#define PAGED_FONT_BENCH_AUTOSTART 0                      // 1: main.cpp benches PAGED_FONT_BENCH_PATH at boot
+
+typedef struct {
+  uint32_t Glyphs;
+  uint32_t File_bytes;
+  uint32_t Full_bytes;                                    // RAM lv_binfont_create() takes: descriptors, bitmaps,
+                                                          // character maps, kerning
+  uint32_t Index_bytes;                                   // RAM the paged font takes, whatever is drawn
+  uint32_t Cache_bytes;                                   // Bitmaps the text left in the cache
+  uint32_t Full_load_us;
+  uint32_t Paged_load_us;
+  uint32_t Characters;                                    // In the text
+  uint32_t Full_text_us;                                  // Descriptor and bitmap of each character of the text
+  uint32_t Cold_text_us;                                  // The same paged, read from storage
+  uint32_t Warm_text_us;                                  // Again, from the cache
+  uint32_t Mismatches;                                    // Characters drawn differently by the two, 0
+} Paged_Font_Report_t;
+
+typedef struct {
+  uint32_t Fonts;                                         // Open now
+  uint32_t Described;                                     // Glyph descriptors read on first use
+  uint32_t Hits;                                          // Bitmaps found in the cache
+  uint32_t Misses;                                        // Bitmaps read from storage
+  uint32_t In_place;                                      // Bitmaps drawn from a mapped pack, no copy
+  uint32_t Evictions;
+  uint32_t Failures;                                      // Read errors, damaged glyphs, no room
+  uint64_t Read_bytes;
+  uint64_t Read_us;
+  uint32_t Index_bytes;                                   // Resident index of the fonts open
+  uint32_t Resident;                                      // Bytes of the cache in use now
+  uint32_t Peak;
+} Paged_Font_Stats_t;
+
+lv_font_t *Paged_Font_Create(const char *Path);           // After Lvgl_FS_Init() and Asset_Pack_Open(). NULL: not a
+                                                          // binary font, damaged, or no memory
+void       Paged_Font_Destroy(lv_font_t *Font);           // Once nothing shows it; drops its glyphs from the cache
+bool       Paged_Font_Is(const lv_font_t *Font);
+esp_err_t  Paged_Font_Measure(const char *Path, const char *Text, Paged_Font_Report_t *Report);
+                                                          // Loads Path both ways and draws Text's glyphs with each
+void       Paged_Font_Bench(const char *const Paths[], int Count, const char *Text);
+                                                          // One line per font: load time and RAM against
+                                                          // lv_binfont_create()
+void       Paged_Font_Get_Stats(Paged_Font_Stats_t *stats);
+void       Paged_Font_Print(void);                        // Fonts open and statistics
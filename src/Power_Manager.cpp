@@ -0,0 +1,198 @@
+#include <math.h>
+#include "esp_timer.h"
+#include "Power_Manager.h"
+#include "LVGL_Driver.h"
+#include "Gyro_QMI8658.h"
+#include "IMU_Stream.h"
+#include "BAT_Driver.h"
+
+static lv_timer_t   *Power_Timer = NULL;
+static bool          Power_Enabled = true;
+static Power_State_t Power_State = POWER_ACTIVE;
+static int64_t       Power_Since_us = 0;                        // Entry time of the current state
+static int64_t       Power_Wake_us = 0;                         // Wake in progress until the next refresh is done, 0: none
+static volatile uint32_t Power_Holds = 0;                      // Power_Manager_Hold() not yet released
+static IMU_Reader_t  Power_Reader;
+static Power_Stats_t Power_Stats;
+static portMUX_TYPE  Power_Lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void Power_Set_State(Power_State_t state)
+{
+  static const uint16_t load_mA[POWER_STATE_COUNT] = {POWER_LOAD_ACTIVE_MA, POWER_LOAD_DIM_MA, POWER_LOAD_SLEEP_MA};
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&Power_Lock);
+  Power_Stats.Time_us[Power_State] += now - Power_Since_us;
+  Power_Stats.Entries[state]++;
+  Power_State = state;
+  Power_Since_us = now;
+  portEXIT_CRITICAL(&Power_Lock);
+  BAT_Set_Load_mA(load_mA[state]);
+}
+
+static uint8_t Power_Dim_Level(void)
+{
+  return LCD_Backlight < POWER_DIM_BACKLIGHT ? LCD_Backlight : POWER_DIM_BACKLIGHT;
+}
+
+/********************************************************** Sleep and wake **********************************************************/
+// Rendering stops with invalidation off (nothing queues up while asleep) and the refresh timer paused. The frame
+// buffer keeps the last frame, so the panel only needs its pixel clock back and one full redraw to be current.
+static void Power_Sleep(void)
+{
+  Set_Backlight(0);
+  lv_display_enable_invalidation(display, false);
+  lv_timer_pause(lv_display_get_refr_timer(display));
+  esp_lcd_rgb_panel_set_pclk(panel_handle, POWER_SLEEP_PCLK_HZ);
+  if (indev) {
+    lv_timer_set_period(lv_indev_get_read_timer(indev), POWER_SLEEP_TOUCH_MS);
+  }
+  if (!QMI8658_WoM_Enable())
+    printf("Power: no Wake on Motion, touch wakes only\r\n");
+  lv_timer_set_period(Power_Timer, POWER_SLEEP_PERIOD_MS);
+  Power_Set_State(POWER_SLEEP);
+}
+
+static void Power_Wake(bool by_touch)
+{
+  Power_Wake_us = esp_timer_get_time();
+  esp_lcd_rgb_panel_set_pclk(panel_handle, ESP_PANEL_LCD_RGB_TIMING_FREQ_HZ);
+  if (indev) {
+    lv_timer_set_period(lv_indev_get_read_timer(indev), LV_DEF_REFR_PERIOD);  // Nothing else changes it
+    if (by_touch)
+      lv_indev_wait_release(indev);                             // The waking touch must not click what is under it
+  }
+  lv_display_enable_invalidation(display, true);
+  lv_obj_invalidate(lv_display_get_layer_sys(display));
+  lv_timer_resume(lv_display_get_refr_timer(display));
+  lv_refr_now(display);                                         // Current content before the backlight comes on
+  Set_Backlight(LCD_Backlight);
+
+  QMI8658_WoM_Disable();                                        // Back to FIFO acquisition, after the user sees the UI
+  IMU_Reader_Attach(&Power_Reader);
+  lv_display_trigger_activity(display);
+  lv_timer_set_period(Power_Timer, POWER_ACTIVE_PERIOD_MS);
+  Power_Set_State(POWER_ACTIVE);
+}
+
+static void Power_Refr_Ready(lv_event_t *e)
+{
+  if (Power_Wake_us == 0)
+    return;
+  uint32_t took = (uint32_t)(esp_timer_get_time() - Power_Wake_us);
+  Power_Wake_us = 0;
+  Power_Stats.Last_wake_us = took;
+  if (took > Power_Stats.Max_wake_us)
+    Power_Stats.Max_wake_us = took;
+}
+
+/********************************************************** Activity **********************************************************/
+// Awake, motion comes from the IMU stream the FIFO already fills: any rotation or non-gravity acceleration above the
+// thresholds since the last check counts as user activity, just like a touch.
+static bool Power_Motion(void)
+{
+  static IMU_Sample_t batch[64];
+  float acc = IMU_Stream_Acc_Scale(), gyr = IMU_Stream_Gyr_Scale();
+  float dps2 = POWER_MOTION_DPS * POWER_MOTION_DPS;
+  bool moved = false;
+  uint32_t got;
+  while ((got = IMU_Reader_Read(&Power_Reader, batch, sizeof(batch) / sizeof(batch[0]))) > 0) {
+    for (uint32_t i = 0; i < got && !moved; i++) {
+      const IMU_Sample_t *s = &batch[i];
+      float gx = s->Gyr[0] * gyr, gy = s->Gyr[1] * gyr, gz = s->Gyr[2] * gyr;
+      float ax = s->Acc[0] * acc, ay = s->Acc[1] * acc, az = s->Acc[2] * acc;
+      moved = gx * gx + gy * gy + gz * gz > dps2 || fabsf(sqrtf(ax * ax + ay * ay + az * az) - 1.0f) > POWER_MOTION_G;
+    }
+  }
+  return moved;
+}
+
+static void Power_Timer_Cb(lv_timer_t *timer)
+{
+  bool held = __atomic_load_n(&Power_Holds, __ATOMIC_RELAXED) != 0;
+  if (Power_State == POWER_SLEEP) {
+    if (held) {
+      Power_Stats.Hold_wakes++;
+      Power_Wake(false);
+    } else if (lv_display_get_inactive_time(display) < POWER_SLEEP_AFTER_MS) {
+      Power_Stats.Touch_wakes++;                                // A touch was read (or reported) since going to sleep
+      Power_Wake(true);
+    } else if (QMI8658_WoM_Poll()) {
+      Power_Stats.Motion_wakes++;
+      Power_Wake(false);
+    }
+    return;
+  }
+
+  if (Power_Motion())
+    lv_display_trigger_activity(display);
+  if (!Power_Enabled)
+    return;
+  uint32_t idle = lv_display_get_inactive_time(display);
+  if (idle >= POWER_SLEEP_AFTER_MS && !held) {
+    Power_Sleep();
+  } else if (idle >= POWER_DIM_AFTER_MS) {
+    if (Power_State != POWER_DIM) {
+      Set_Backlight(Power_Dim_Level());
+      Power_Set_State(POWER_DIM);
+    }
+  } else if (Power_State == POWER_DIM) {
+    Set_Backlight(LCD_Backlight);
+    Power_Set_State(POWER_ACTIVE);
+  }
+}
+
+/********************************************************** Public API **********************************************************/
+void Power_Manager_Init(void)
+{
+  if (Power_Timer || display == NULL)
+    return;
+  Power_Since_us = esp_timer_get_time();
+  Power_Stats.Entries[POWER_ACTIVE] = 1;
+  IMU_Reader_Attach(&Power_Reader);
+  lv_display_add_event_cb(display, Power_Refr_Ready, LV_EVENT_REFR_READY, NULL);
+  Power_Timer = lv_timer_create(Power_Timer_Cb, POWER_ACTIVE_PERIOD_MS, NULL);
+}
+
+void Power_Manager_Enable(bool Enable)
+{
+  Power_Enabled = Enable;
+  if (Enable)
+    return;
+  if (Power_State == POWER_SLEEP)
+    Power_Wake(false);
+  else if (Power_State == POWER_DIM) {
+    Set_Backlight(LCD_Backlight);
+    Power_Set_State(POWER_ACTIVE);
+  }
+}
+
+void Power_Manager_Activity(void)
+{
+  lv_display_trigger_activity(display);
+  if (Power_Timer)
+    Power_Timer_Cb(Power_Timer);                                // React now rather than on the next check
+}
+
+void Power_Manager_Hold(void)
+{
+  __atomic_add_fetch(&Power_Holds, 1, __ATOMIC_RELAXED);
+}
+
+void Power_Manager_Release(void)
+{
+  __atomic_sub_fetch(&Power_Holds, 1, __ATOMIC_RELAXED);
+}
+
+Power_State_t Power_Manager_State(void)
+{
+  return Power_State;
+}
+
+void Power_Manager_Get_Stats(Power_Stats_t *stats)
+{
+  portENTER_CRITICAL(&Power_Lock);
+  *stats = Power_Stats;
+  stats->State = Power_State;
+  stats->Time_us[Power_State] += esp_timer_get_time() - Power_Since_us;
+  portEXIT_CRITICAL(&Power_Lock);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************** Power management ******************************************************/
+// No touch and no motion for a while first dims the backlight, then puts the device to sleep: LVGL stops rendering,
+// the backlight goes off, the RGB panel is scanned out at a fraction of its pixel clock and the QMI8658 drops to its
+// Wake on Motion engine alone. Motion or a touch wakes it. Runs on an lv_timer, i.e. in the LVGL context.
+// Sleep stops the IMU FIFO and display refresh, so whatever needs either while it runs (a capture, the vibration
+// analyzer, the SD bench) holds the device awake: Power_Manager_Hold() to Power_Manager_Release(), from any task. A
+// hold taken while asleep wakes the device within POWER_SLEEP_PERIOD_MS; held, it still dims.
+#define POWER_DIM_AFTER_MS         30000
+#define POWER_SLEEP_AFTER_MS       60000
+#define POWER_DIM_BACKLIGHT        15                     // Percent, never brighter than LCD_Backlight
+#define POWER_SLEEP_PCLK_HZ        (3 * 1000 * 1000)      // ~8 frames/s of scan-out instead of ~32
+#define POWER_ACTIVE_PERIOD_MS     200                    // Inactivity check, also how often the IMU stream is looked at
+#define POWER_SLEEP_PERIOD_MS      50                     // Wake check. Wake latency: this + one WoM sample + one frame
+#define POWER_SLEEP_TOUCH_MS       100                    // Touch polling while asleep
+#define POWER_MOTION_DPS           8.0f                   // Awake: rotation faster than this counts as activity
+#define POWER_MOTION_G             0.05f                  // Awake: |a| further than this from 1 g counts as activity
+#define POWER_LOAD_ACTIVE_MA       250                    // Estimated battery current per state, for the battery
+#define POWER_LOAD_DIM_MA          140                    // monitor's load compensation (BAT_Set_Load_mA)
+#define POWER_LOAD_SLEEP_MA        70
+
+typedef enum {
+  POWER_ACTIVE = 0,
+  POWER_DIM,
+  POWER_SLEEP,
+  POWER_STATE_COUNT,
+} Power_State_t;
+
+typedef struct {
+  Power_State_t State;
+  uint64_t Time_us[POWER_STATE_COUNT];                    // Total time spent in each state, the current one included
+  uint32_t Entries[POWER_STATE_COUNT];
+  uint32_t Motion_wakes;
+  uint32_t Touch_wakes;
+  uint32_t Hold_wakes;                                    // Woken by Power_Manager_Hold()
+  uint32_t Last_wake_us;                                  // From detecting the wake event to the first frame after it
+  uint32_t Max_wake_us;
+} Power_Stats_t;
+
+void Power_Manager_Init(void);                            // After Lvgl_Init(), Backlight_Init() and QMI8658_FIFO_Init()
+void Power_Manager_Enable(bool Enable);                   // false: wake up and stay awake. LVGL context only
+void Power_Manager_Activity(void);                        // Input LVGL does not see (buttons, serial). LVGL context only
+void Power_Manager_Hold(void);                            // No sleep until the matching Power_Manager_Release(). Any task
+void Power_Manager_Release(void);
+Power_State_t Power_Manager_State(void);
+void Power_Manager_Get_Stats(Power_Stats_t *stats);
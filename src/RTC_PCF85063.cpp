@@ -80,7 +80,7 @@ function:	Set Time And Date
 parameter:
 Info:		
 ******************************************************************************/
-void PCF85063_Set_All(datetime_t time)
+esp_err_t PCF85063_Set_All(datetime_t time)
 {
 	uint8_t buf[7] = {decToBcd(time.second),
 					  decToBcd(time.minute),
@@ -92,6 +92,7 @@ void PCF85063_Set_All(datetime_t time)
 	esp_err_t ret = I2C_Write(PCF85063_ADDRESS, RTC_SECOND_ADDR, buf, sizeof(buf));
 	if(ret != ESP_OK)
 		printf("PCF85063 : Failed to set the date and time\r\n");
+	return ret;
 }
 
 /******************************************************************************
@@ -105,15 +106,25 @@ void PCF85063_Read_Time(datetime_t *time)
 	esp_err_t ret = I2C_Read(PCF85063_ADDRESS, RTC_SECOND_ADDR, buf, sizeof(buf));
 	if(ret != ESP_OK)
 		printf("PCF85063 : Time read failure\r\n");
-	else{
-		time->second = bcdToDec(buf[0] & 0x7F);
-		time->minute = bcdToDec(buf[1] & 0x7F);
-		time->hour = bcdToDec(buf[2] & 0x3F);
-		time->day = bcdToDec(buf[3] & 0x3F);
-		time->dotw = bcdToDec(buf[4] & 0x07);
-		time->month = bcdToDec(buf[5] & 0x1F);
-		time->year = bcdToDec(buf[6]) + YEAR_OFFSET;
-	}
+	else
+		PCF85063_Decode_Time(buf, time);
+}
+
+/******************************************************************************
+function:	Decode the time and date registers
+parameter:
+			regs: RTC_SECOND_ADDR .. RTC_YEAR_ADDR as read from the chip
+Info:		
+******************************************************************************/
+void PCF85063_Decode_Time(const uint8_t *regs, datetime_t *time)
+{
+	time->second = bcdToDec(regs[0] & 0x7F);
+	time->minute = bcdToDec(regs[1] & 0x7F);
+	time->hour = bcdToDec(regs[2] & 0x3F);
+	time->day = bcdToDec(regs[3] & 0x3F);
+	time->dotw = bcdToDec(regs[4] & 0x07);
+	time->month = bcdToDec(regs[5] & 0x1F);
+	time->year = bcdToDec(regs[6]) + YEAR_OFFSET;
 }
 
 /******************************************************************************
@@ -130,6 +141,36 @@ void PCF85063_Enable_Alarm()
 		printf("PCF85063 : Failed to enable Alarm Flag and Clear Alarm Flag \r\n");
 }
 
+/******************************************************************************
+function:	Minute / half minute interrupt
+parameter:
+			mode: RTC_CTRL_2_MI, RTC_CTRL_2_HMI, both, or 0 to disable
+Info:		INT pulses low for 1/64 s as the seconds register rolls over to 00
+			(and 30 with HMI), so the falling edge marks a second boundary.
+			Pulse mode (TI_TP) also applies to the countdown timer interrupt.
+			The alarm enable and flag are left as they are.
+******************************************************************************/
+esp_err_t PCF85063_Set_Minute_Interrupt(uint8_t mode)
+{
+	uint8_t Value = 0;
+	esp_err_t ret = I2C_Read(PCF85063_ADDRESS, RTC_CTRL_2_ADDR, &Value, 1);
+	if(ret != ESP_OK)
+		return ret;
+	Value = (Value & ~(RTC_CTRL_2_MI | RTC_CTRL_2_HMI | RTC_CTRL_2_TF)) | RTC_CTRL_2_AF | (mode & (RTC_CTRL_2_MI | RTC_CTRL_2_HMI));
+	ret = I2C_Write(PCF85063_ADDRESS, RTC_CTRL_2_ADDR, &Value, 1);	// AF written as 1 is left unchanged, TF as 0 is cleared
+	if(ret != ESP_OK)
+		return ret;
+	uint8_t Mode = 0;
+	ret = I2C_Read(PCF85063_ADDRESS, RTC_TIMER_MODE, &Mode, 1);
+	if(ret == ESP_OK && !(Mode & RTC_TIMER_MODE_TI_TP)) {
+		Mode |= RTC_TIMER_MODE_TI_TP;
+		ret = I2C_Write(PCF85063_ADDRESS, RTC_TIMER_MODE, &Mode, 1);
+	}
+	if(ret != ESP_OK)
+		printf("PCF85063 : Failed to set the minute interrupt\r\n");
+	return ret;
+}
+
 /******************************************************************************
 function:	Get Alarm flag
 parameter:			
@@ -60,6 +60,10 @@
 
 #define RTC_TIMER_FLAG		(0x08)
 
+#ifndef PCF85063_INT_PIN
+#define PCF85063_INT_PIN    (-1) // GPIO wired to the PCF85063 INT (open drain, active low), -1 if not routed
+#endif
+
 typedef struct {
     uint16_t year;
     uint8_t month;
@@ -79,9 +83,11 @@ void PCF85063_Reset(void);
 
 void PCF85063_Set_Time(datetime_t time);
 void PCF85063_Set_Date(datetime_t date);
-void PCF85063_Set_All(datetime_t time);
+esp_err_t PCF85063_Set_All(datetime_t time);
 
 void PCF85063_Read_Time(datetime_t *time);
+void PCF85063_Decode_Time(const uint8_t *regs, datetime_t *time);	// regs: the 7 registers from RTC_SECOND_ADDR
+esp_err_t PCF85063_Set_Minute_Interrupt(uint8_t mode);			// RTC_CTRL_2_MI, RTC_CTRL_2_HMI or 0, as pulses on INT
 
 
 void PCF85063_Enable_Alarm(void);
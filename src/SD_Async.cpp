@@ -0,0 +1,464 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "SD_Cache.h"
+#include "Asset_Pack.h"
+#include "SD_Async.h"
+
+#define ASYNC_FREE     0
+#define ASYNC_QUEUED   1
+#define ASYNC_RUNNING  2
+#define ASYNC_DONE     3                                        // Waiting for the timer to run the callback
+
+#define ASYNC_READ     0
+#define ASYNC_IMAGE    1
+#define ASYNC_HINT     2
+
+#define ASYNC_LOADS    0                                        // Queue classes, served in this order
+#define ASYNC_HINTS    1
+#define ASYNC_CLASSES  2
+
+typedef struct {
+  SD_Async_Id_t     Id;
+  uint8_t           State;                                      // ASYNC_FREE...
+  uint8_t           Kind;                                       // ASYNC_READ...
+  bool              Cancelled;
+  char              Path[SD_ASYNC_PATH_MAX];                    // VFS path of the file read
+  char              Entry[SD_ASYNC_PATH_MAX];                   // Pack entry of "P:" paths, "" for files
+  uint32_t          Offset;                                     // Range of a pack entry; files are read whole
+  uint32_t          Length;
+  SD_Async_Cb_t     Cb;
+  void             *User;
+  int64_t           Queued_us;
+  SD_Async_Status_t Status;
+  uint8_t          *Data;                                       // Async_Image_t for images
+  uint32_t          Data_length;
+} Async_Request_t;
+
+// An image read from a file: its descriptor, then the file. SD_Async_Release() frees both
+typedef struct {
+  lv_image_dsc_t Image;
+  uint8_t        File[];
+} Async_Image_t;
+
+static Async_Request_t   Async_Requests[SD_ASYNC_REQUESTS];
+static uint32_t          Async_Serial = 0;                      // Of the last Id handed out
+static QueueHandle_t     Async_Queue[ASYNC_CLASSES] = {NULL};   // Request numbers
+static QueueHandle_t     Async_Done = NULL;
+static SemaphoreHandle_t Async_Pending = NULL;                  // Counts requests waiting in either queue
+static SemaphoreHandle_t Async_Lock = NULL;                     // Request states, Cancelled, statistics
+static TaskHandle_t      Async_Task = NULL;                     // NULL: the timer serves requests itself
+static lv_timer_t       *Async_Timer = NULL;
+static SD_Async_Stats_t  Async_Stats;
+
+static void *Async_Alloc(size_t Size)
+{
+  void *p = heap_caps_malloc(Size, MALLOC_CAP_SPIRAM);
+  return p ? p : malloc(Size);
+}
+
+static bool Async_Is_Cancelled(Async_Request_t *r)
+{
+  xSemaphoreTake(Async_Lock, portMAX_DELAY);
+  bool c = r->Cancelled;
+  xSemaphoreGive(Async_Lock);
+  return c;
+}
+
+/********************************************************** I/O task **********************************************************/
+static void Async_Serve(uint8_t i);
+
+// Loads queued behind a hint go first, so a hint delays a load by one chunk at most
+static void Async_Serve_Loads(void)
+{
+  uint8_t i;
+  while (xQueueReceive(Async_Queue[ASYNC_LOADS], &i, 0) == pdTRUE)
+    Async_Serve(i);                                             // Its Async_Pending count is left to the task loop
+}
+
+// The range into SD_Cache, chunk by chunk
+static SD_Async_Status_t Async_Fetch(Async_Request_t *r, SD_Cache_File_t *f, uint32_t Offset, uint32_t Length)
+{
+  for (uint32_t done = 0; done < Length; ) {
+    if (Async_Is_Cancelled(r))
+      return SD_ASYNC_OK;
+    uint32_t n = Length - done < SD_ASYNC_CHUNK ? Length - done : SD_ASYNC_CHUNK;
+    if (!SD_Cache_Prefetch(f, Offset + done, n))
+      return SD_ASYNC_FAILED;
+    done += n;
+    if (r->Kind == ASYNC_HINT)
+      Async_Serve_Loads();
+  }
+  return SD_ASYNC_OK;
+}
+
+// The whole file into PSRAM; images get their descriptor in front of it
+static SD_Async_Status_t Async_Load(Async_Request_t *r, SD_Cache_File_t *f)
+{
+  uint32_t size = SD_Cache_Size(f);
+  uint32_t head = r->Kind == ASYNC_IMAGE ? sizeof(Async_Image_t) : 0;
+  if (r->Kind == ASYNC_IMAGE && size < sizeof(lv_image_header_t))
+    return SD_ASYNC_FAILED;
+  uint8_t *data = (uint8_t *)Async_Alloc(head + (size ? size : 1));
+  if (data == NULL)
+    return SD_ASYNC_NO_MEM;
+  for (uint32_t done = 0; done < size; ) {
+    uint32_t n = size - done < SD_ASYNC_CHUNK ? size - done : SD_ASYNC_CHUNK;
+    if (Async_Is_Cancelled(r) || SD_Cache_Read(f, data + head + done, n) != (int32_t)n) {
+      free(data);
+      return Async_Is_Cancelled(r) ? SD_ASYNC_OK : SD_ASYNC_FAILED;
+    }
+    done += n;
+  }
+  if (r->Kind == ASYNC_IMAGE) {
+    Async_Image_t *img = (Async_Image_t *)data;
+    memset(&img->Image, 0, sizeof(img->Image));
+    memcpy(&img->Image.header, img->File, sizeof(lv_image_header_t));
+    img->Image.data = img->File + sizeof(lv_image_header_t);
+    img->Image.data_size = size - sizeof(lv_image_header_t);
+    if (img->Image.header.magic != LV_IMAGE_HEADER_MAGIC) {
+      free(data);
+      return SD_ASYNC_FAILED;
+    }
+  }
+  r->Data = data;
+  r->Data_length = size;
+  return SD_ASYNC_OK;
+}
+
+static void Async_Serve(uint8_t i)
+{
+  Async_Request_t *r = &Async_Requests[i];
+  bool hint = r->Kind == ASYNC_HINT;                            // A hint's slot is reused once it is freed below
+  xSemaphoreTake(Async_Lock, portMAX_DELAY);
+  bool cancelled = r->Cancelled;
+  r->State = ASYNC_RUNNING;
+  xSemaphoreGive(Async_Lock);
+
+  int64_t t0 = esp_timer_get_time();
+  SD_Cache_Stats_t before, after;
+  SD_Cache_Get_Stats(&before);
+  SD_Async_Status_t status = SD_ASYNC_OK;
+  if (!cancelled) {
+    SD_Cache_File_t *f = SD_Cache_Open(r->Path);
+    if (f == NULL)
+      status = SD_ASYNC_NOT_FOUND;
+    else if (r->Entry[0] || hint)
+      status = Async_Fetch(r, f, r->Offset, r->Entry[0] ? r->Length : SD_Cache_Size(f));
+    else
+      status = Async_Load(r, f);
+    if (f)
+      SD_Cache_Close(f);
+  }
+  SD_Cache_Get_Stats(&after);
+
+  xSemaphoreTake(Async_Lock, portMAX_DELAY);
+  Async_Stats.Busy_us += esp_timer_get_time() - t0;
+  Async_Stats.Card_bytes += after.Card_bytes - before.Card_bytes;
+  r->Status = status;
+  r->State = hint ? ASYNC_FREE : ASYNC_DONE;                    // Nobody to tell about a hint
+  xSemaphoreGive(Async_Lock);
+  if (!hint)
+    xQueueSend(Async_Done, &i, portMAX_DELAY);
+}
+
+// One request, loads first. false: none was waiting
+static bool Async_Serve_Next(TickType_t Wait)
+{
+  if (xSemaphoreTake(Async_Pending, Wait) != pdTRUE)
+    return false;
+  uint8_t i;
+  for (int c = 0; c < ASYNC_CLASSES; c++) {
+    if (xQueueReceive(Async_Queue[c], &i, 0) == pdTRUE) {
+      Async_Serve(i);
+      break;
+    }
+  }
+  return true;                                                  // A load served early by a hint leaves a count behind
+}
+
+static void Async_Io_Task(void *parameter)
+{
+  while (1)
+    Async_Serve_Next(portMAX_DELAY);
+}
+
+/********************************************************** Completions (LVGL context) **********************************************************/
+static void Async_Finish(Async_Request_t *r)
+{
+  SD_Async_Result_t res = {r->Id, r->Status, NULL, 0, NULL, r->User};
+  SD_Async_Cb_t cb = r->Cb;
+  xSemaphoreTake(Async_Lock, portMAX_DELAY);
+  bool cancelled = r->Cancelled;
+  r->State = ASYNC_FREE;                                        // Free before the callback, which may queue another
+  xSemaphoreGive(Async_Lock);
+  if (cancelled) {
+    free(r->Data);
+    r->Data = NULL;
+    return;
+  }
+  if (r->Kind == ASYNC_IMAGE && r->Entry[0] && res.Status == SD_ASYNC_OK) {
+    res.Image = Asset_Pack_Image(r->Entry);                     // Its blocks are in SD_Cache now: copy and unpack
+    if (res.Image == NULL)
+      res.Status = SD_ASYNC_FAILED;
+  } else if (r->Kind == ASYNC_IMAGE && r->Data) {
+    res.Image = &((Async_Image_t *)r->Data)->Image;
+  } else {
+    res.Data = r->Data;
+    res.Length = r->Data_length;
+  }
+  r->Data = NULL;
+  uint32_t latency = (uint32_t)(esp_timer_get_time() - r->Queued_us);
+  if (latency > Async_Stats.Max_latency_us)
+    Async_Stats.Max_latency_us = latency;
+  if (res.Status != SD_ASYNC_OK) {
+    Async_Stats.Failed++;
+    printf("SD async: %s%s: %s\r\n", r->Entry[0] ? "pack entry " : "", r->Entry[0] ? r->Entry : r->Path,
+           res.Status == SD_ASYNC_NOT_FOUND ? "not found" : res.Status == SD_ASYNC_NO_MEM ? "no memory" : "failed");
+  }
+  if (cb)
+    cb(&res);
+  else if (res.Image)
+    SD_Async_Release(res.Image);
+  else
+    free(res.Data);
+}
+
+static void Async_Timer_Cb(lv_timer_t *t)
+{
+  if (Async_Task == NULL)
+    Async_Serve_Next(0);
+  int64_t t0 = esp_timer_get_time();
+  uint8_t i;
+  while (xQueueReceive(Async_Done, &i, 0) == pdTRUE)
+    Async_Finish(&Async_Requests[i]);
+  uint32_t took = (uint32_t)(esp_timer_get_time() - t0);
+  if (took > Async_Stats.Max_dispatch_us)
+    Async_Stats.Max_dispatch_us = took;
+}
+
+/********************************************************** Requests **********************************************************/
+// "S:/a.bin" and "/sdcard/a.bin" to the VFS path, "P:name" to its range in the pack, with no path if the pack is
+// mapped from flash. false: not a path we read
+static bool Async_Resolve(Async_Request_t *r, const char *Path)
+{
+  r->Entry[0] = '\0';
+  r->Offset = 0;
+  r->Length = 0;
+  if (Path[0] == ASSET_PACK_LETTER && Path[1] == ':') {
+    const char *pack;
+    snprintf(r->Entry, sizeof(r->Entry), "%s", Path + 2 + (Path[2] == '/'));
+    if (!Asset_Pack_Locate(r->Entry, &pack, &r->Offset, &r->Length))
+      return false;
+    snprintf(r->Path, sizeof(r->Path), "%s", pack ? pack : "");
+    return true;
+  }
+  if (Path[0] == SD_ASYNC_LETTER && Path[1] == ':')
+    return snprintf(r->Path, sizeof(r->Path), "%s%s%s", SD_ASYNC_ROOT, Path[2] == '/' ? "" : "/", Path + 2) <
+           (int)sizeof(r->Path);
+  return Path[0] == '/' && snprintf(r->Path, sizeof(r->Path), "%s", Path) < (int)sizeof(r->Path);
+}
+
+// A free request, claimed; NULL when all are in use
+static Async_Request_t *Async_Claim(void)
+{
+  Async_Request_t *r = NULL;
+  xSemaphoreTake(Async_Lock, portMAX_DELAY);
+  for (int i = 0; i < SD_ASYNC_REQUESTS && r == NULL; i++) {
+    if (Async_Requests[i].State == ASYNC_FREE)
+      r = &Async_Requests[i];
+  }
+  if (r) {
+    Async_Serial++;
+    r->Id = Async_Serial * SD_ASYNC_REQUESTS + (uint32_t)(r - Async_Requests);
+    r->State = ASYNC_QUEUED;
+    r->Cancelled = false;
+    r->Data = NULL;
+    r->Data_length = 0;
+    r->Status = SD_ASYNC_OK;
+  } else {
+    Async_Stats.Rejected++;
+  }
+  xSemaphoreGive(Async_Lock);
+  return r;
+}
+
+static void Async_Unclaim(Async_Request_t *r)
+{
+  xSemaphoreTake(Async_Lock, portMAX_DELAY);
+  r->State = ASYNC_FREE;
+  xSemaphoreGive(Async_Lock);
+}
+
+static bool Async_Queue_Request(Async_Request_t *r, int Class)
+{
+  uint8_t i = (uint8_t)(r - Async_Requests);
+  r->Queued_us = esp_timer_get_time();
+  if (xQueueSend(Async_Queue[Class], &i, 0) != pdTRUE) {        // Cannot happen: a queue holds every request
+    Async_Unclaim(r);
+    return false;
+  }
+  xSemaphoreGive(Async_Pending);
+  return true;
+}
+
+static SD_Async_Id_t Async_Request(const char *Path, uint8_t Kind, SD_Async_Cb_t Cb, void *User)
+{
+  if (Async_Lock == NULL || Path == NULL)
+    return 0;
+  Async_Request_t *r = Async_Claim();
+  if (r == NULL) {
+    printf("SD async: %d requests in flight, %s refused\r\n", SD_ASYNC_REQUESTS, Path);
+    return 0;
+  }
+  r->Kind = Kind;
+  r->Cb = Cb;
+  r->User = User;
+  bool found = Async_Resolve(r, Path);
+  if (!found || r->Path[0] == '\0') {                           // Reported through the callback like any load; an
+    if (!found) {                                               // entry of a mapped pack has nothing to read
+      snprintf(r->Path, sizeof(r->Path), "%s", Path);
+      r->Entry[0] = '\0';
+    }
+    r->Status = found ? SD_ASYNC_OK : SD_ASYNC_NOT_FOUND;
+    r->State = ASYNC_DONE;
+    r->Queued_us = esp_timer_get_time();
+    uint8_t i = (uint8_t)(r - Async_Requests);
+    xQueueSend(Async_Done, &i, 0);
+  } else if (!Async_Queue_Request(r, ASYNC_LOADS)) {
+    return 0;
+  }
+  Async_Stats.Loads++;
+  return r->Id;
+}
+
+/********************************************************** API **********************************************************/
+esp_err_t SD_Async_Init(void)
+{
+  if (Async_Lock)
+    return ESP_OK;
+  if (SD_Cache_Init() != ESP_OK)
+    return ESP_ERR_NO_MEM;
+  for (int c = 0; c < ASYNC_CLASSES; c++)
+    Async_Queue[c] = xQueueCreate(SD_ASYNC_REQUESTS, sizeof(uint8_t));
+  Async_Done = xQueueCreate(SD_ASYNC_REQUESTS, sizeof(uint8_t));
+  Async_Pending = xSemaphoreCreateCounting(ASYNC_CLASSES * SD_ASYNC_REQUESTS, 0);
+  Async_Lock = xSemaphoreCreateMutex();
+  if (Async_Queue[ASYNC_LOADS] == NULL || Async_Queue[ASYNC_HINTS] == NULL || Async_Done == NULL ||
+      Async_Pending == NULL || Async_Lock == NULL) {
+    printf("SD async: cannot allocate the queues\r\n");
+    Async_Lock = NULL;
+    return ESP_ERR_NO_MEM;
+  }
+  Async_Timer = lv_timer_create(Async_Timer_Cb, SD_ASYNC_POLL_MS, NULL);
+  if (xTaskCreatePinnedToCore(Async_Io_Task, "SD async", SD_ASYNC_TASK_STACK, NULL, SD_ASYNC_TASK_PRIORITY,
+                              &Async_Task, SD_ASYNC_TASK_CORE) != pdPASS)
+    Async_Task = NULL;
+  return ESP_OK;
+}
+
+SD_Async_Id_t SD_Async_Read(const char *Path, SD_Async_Cb_t Cb, void *User)
+{
+  return Async_Request(Path, ASYNC_READ, Cb, User);
+}
+
+SD_Async_Id_t SD_Async_Image(const char *Path, SD_Async_Cb_t Cb, void *User)
+{
+  return Async_Request(Path, ASYNC_IMAGE, Cb, User);
+}
+
+bool SD_Async_Cancel(SD_Async_Id_t Id)
+{
+  if (Async_Lock == NULL || Id == 0)
+    return false;
+  Async_Request_t *r = &Async_Requests[Id % SD_ASYNC_REQUESTS];
+  xSemaphoreTake(Async_Lock, portMAX_DELAY);
+  bool ok = r->Id == Id && r->State != ASYNC_FREE && r->Kind != ASYNC_HINT && !r->Cancelled;
+  if (ok) {
+    r->Cancelled = true;                                        // The task stops at the next chunk, the timer frees
+    Async_Stats.Cancelled++;
+  }
+  xSemaphoreGive(Async_Lock);
+  return ok;
+}
+
+void SD_Async_Prefetch(const char *Path)
+{
+  if (Async_Lock == NULL || Path == NULL)
+    return;
+  Async_Request_t *r = Async_Claim();
+  if (r == NULL)
+    return;
+  r->Kind = ASYNC_HINT;
+  r->Cb = NULL;
+  r->User = NULL;
+  bool skip = !Async_Resolve(r, Path) || (r->Entry[0] && r->Length == 0);   // Unknown, or a resident pack entry
+  xSemaphoreTake(Async_Lock, portMAX_DELAY);
+  for (int i = 0; i < SD_ASYNC_REQUESTS && !skip; i++) {
+    const Async_Request_t *q = &Async_Requests[i];
+    skip = q != r && q->Kind == ASYNC_HINT && q->State == ASYNC_QUEUED && q->Offset == r->Offset &&
+           strcmp(q->Path, r->Path) == 0;
+  }
+  xSemaphoreGive(Async_Lock);
+  if (skip) {
+    Async_Stats.Hints_skipped++;
+    Async_Unclaim(r);
+    return;
+  }
+  if (Async_Queue_Request(r, ASYNC_HINTS))
+    Async_Stats.Hints++;
+}
+
+void SD_Async_Prefetch_List(const char *const *Paths)
+{
+  for (; Paths && *Paths; Paths++)
+    SD_Async_Prefetch(*Paths);
+}
+
+static void Async_Press_Cb(lv_event_t *e)
+{
+  SD_Async_Prefetch_List((const char *const *)lv_event_get_user_data(e));
+}
+
+void SD_Async_Hint_On_Press(lv_obj_t *Obj, const char *const *Paths)
+{
+  lv_obj_add_event_cb(Obj, Async_Press_Cb, LV_EVENT_PRESSED, (void *)Paths);
+}
+
+void SD_Async_Free(uint8_t *Data)
+{
+  free(Data);
+}
+
+void SD_Async_Release(const lv_image_dsc_t *Image)
+{
+  if (Image == NULL || Asset_Pack_Release(Image))
+    return;
+  lv_image_cache_drop(Image);                                   // LVGL may have cached it by its descriptor
+  free((Async_Image_t *)Image);
+}
+
+void SD_Async_Get_Stats(SD_Async_Stats_t *stats)
+{
+  if (Async_Lock)
+    xSemaphoreTake(Async_Lock, portMAX_DELAY);
+  *stats = Async_Stats;
+  if (Async_Lock)
+    xSemaphoreGive(Async_Lock);
+}
+
+void SD_Async_Print_Stats(void)
+{
+  SD_Async_Stats_t s;
+  SD_Async_Get_Stats(&s);
+  printf("SD async: %lu loads (%lu cancelled, %lu failed, %lu refused), %lu hints (%lu skipped), %llu KB in %llu ms\r\n",
+         s.Loads, s.Cancelled, s.Failed, s.Rejected, s.Hints, s.Hints_skipped, s.Card_bytes / 1024, s.Busy_us / 1000);
+  printf("SD async: longest wait for a load %lu ms, longest completion run in the LVGL context %lu us\r\n",
+         s.Max_latency_us / 1000, s.Max_dispatch_us);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <lvgl.h>
+#include "esp_err.h"
+
+/****************************************************** Asynchronous file I/O ******************************************************/
+// Card reads off the LVGL thread. Requests are served by one task on core 0, through SD_Cache; when one is done its
+// callback runs in the LVGL context, from an lv_timer, where it may create and change objects. The screen keeps
+// rendering while the card is read.
+// Paths: "S:/img/a.bin" (LVGL_FS_LETTER), "P:icons/home" (an asset pack entry; done at once when the pack is mapped
+// from flash), or a VFS path under /sdcard.
+// Prefetch hints are read at the lowest priority into SD_Cache, nothing is handed back: a screen's init function that
+// then loads those files synchronously (lv_image_set_src("S:..."), Asset_Pack_Image()) copies from PSRAM instead of
+// waiting for the card. Hints beyond the cache's size (SD_CACHE_BLOCKS blocks) evict each other.
+// All functions are for the LVGL context, like the rest of LVGL.
+#define SD_ASYNC_REQUESTS        16                       // Loads and hints queued or in flight
+#define SD_ASYNC_CHUNK           16384                    // Read between cancellation checks, one SD_Cache block
+#define SD_ASYNC_POLL_MS         10                       // Completion timer period
+#define SD_ASYNC_PATH_MAX        96
+#define SD_ASYNC_LETTER          'S'                      // LVGL_FS_LETTER, read under SD_ASYNC_ROOT
+#define SD_ASYNC_ROOT            "/sdcard"                // LVGL_FS_ROOT
+#define SD_ASYNC_TASK_CORE       0
+#define SD_ASYNC_TASK_PRIORITY   1                        // With SD_Cache's read-ahead, below everything that samples
+#define SD_ASYNC_TASK_STACK      4096
+
+typedef uint32_t SD_Async_Id_t;                           // 0: no request
+
+typedef enum {
+  SD_ASYNC_OK = 0,
+  SD_ASYNC_NOT_FOUND,
+  SD_ASYNC_NO_MEM,
+  SD_ASYNC_FAILED,                                        // Card error, or not an LVGL image
+} SD_Async_Status_t;
+
+typedef struct {
+  SD_Async_Id_t         Id;
+  SD_Async_Status_t     Status;
+  uint8_t              *Data;                             // SD_Async_Read(): the file, PSRAM, SD_Async_Free() when done
+  uint32_t              Length;
+  const lv_image_dsc_t *Image;                            // SD_Async_Image(): SD_Async_Release() when no object shows it
+  void                 *User;
+} SD_Async_Result_t;
+
+typedef void (*SD_Async_Cb_t)(const SD_Async_Result_t *Result);   // LVGL context. Result is valid during the call
+
+typedef struct {
+  uint32_t Loads;                                         // Reads and images requested
+  uint32_t Hints;
+  uint32_t Hints_skipped;                                 // Resident already, or queued twice
+  uint32_t Rejected;                                      // No free request slot
+  uint32_t Cancelled;
+  uint32_t Failed;
+  uint64_t Card_bytes;                                    // Read by the task, hints included
+  uint64_t Busy_us;                                       // Task time on requests
+  uint32_t Max_latency_us;                                // Load requested to callback run
+  uint32_t Max_dispatch_us;                               // Longest completion run in the LVGL context, callbacks
+                                                          // included
+} SD_Async_Stats_t;
+
+esp_err_t     SD_Async_Init(void);                        // After Lvgl_FS_Init(). Without a task, the timer serves
+                                                          // one request per run itself
+SD_Async_Id_t SD_Async_Read(const char *Path, SD_Async_Cb_t Cb, void *User);    // The whole file into PSRAM
+SD_Async_Id_t SD_Async_Image(const char *Path, SD_Async_Cb_t Cb, void *User);   // An LVGL image file or pack entry
+bool          SD_Async_Cancel(SD_Async_Id_t Id);          // true: the callback will not run. false: it has, or no Id
+void          SD_Async_Prefetch(const char *Path);
+void          SD_Async_Prefetch_List(const char *const *Paths);     // NULL-terminated, e.g. a screen's assets
+void          SD_Async_Hint_On_Press(lv_obj_t *Obj, const char *const *Paths);
+                                                          // Prefetch Paths (static) when Obj is pressed: the button
+                                                          // whose CLICKED event calls _ui_screen_change()
+void          SD_Async_Free(uint8_t *Data);
+void          SD_Async_Release(const lv_image_dsc_t *Image);
+void          SD_Async_Get_Stats(SD_Async_Stats_t *stats);
+void          SD_Async_Print_Stats(void);
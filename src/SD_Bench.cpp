@@ -0,0 +1,348 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <lvgl.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "SD_Bench.h"
+#include "Power_Manager.h"
+
+static const char *Bench_Positions[3] = {"first", "middle", "last"};
+
+/********************************************************** Helpers **********************************************************/
+static uint32_t Bench_Rng = 1;
+
+static uint32_t Bench_Random(void)                              // xorshift32: the same offsets on every run
+{
+  Bench_Rng ^= Bench_Rng << 13;
+  Bench_Rng ^= Bench_Rng >> 17;
+  Bench_Rng ^= Bench_Rng << 5;
+  return Bench_Rng;
+}
+
+static float Bench_Kbps(uint64_t Bytes, int64_t Us)
+{
+  return Us > 0 ? (float)(Bytes * 1000000.0 / 1024.0 / Us) : 0.0f;
+}
+
+static int Bench_Compare(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static void Bench_Percentiles(uint32_t *Us, uint32_t Count, SD_Bench_Latency_t *l)
+{
+  memset(l, 0, sizeof(*l));
+  if (Count == 0)
+    return;
+  qsort(Us, Count, sizeof(Us[0]), Bench_Compare);
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < Count; i++)
+    sum += Us[i];
+  l->Count = Count;
+  l->Min_us = Us[0];
+  l->P50_us = Us[(Count - 1) * 50 / 100];
+  l->P90_us = Us[(Count - 1) * 90 / 100];
+  l->P99_us = Us[(Count - 1) * 99 / 100];
+  l->Max_us = Us[Count - 1];
+  l->Mean_us = (uint32_t)(sum / Count);
+}
+
+/********************************************************** Runs **********************************************************/
+// Block x 1024 bytes, at most SD_BENCH_FILE_SIZE: the 512-byte runs would take minutes otherwise
+static uint32_t Bench_Run_Bytes(uint32_t Block)
+{
+  return Block * 1024 < SD_BENCH_FILE_SIZE ? Block * 1024 : SD_BENCH_FILE_SIZE;
+}
+
+static int64_t Bench_Write(const char *Path, uint8_t *Buf, uint32_t Block, uint32_t Bytes, uint32_t *Errors)
+{
+  int64_t t0 = esp_timer_get_time();
+  int fd = open(Path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    (*Errors)++;
+    return 0;
+  }
+  for (uint32_t done = 0; done < Bytes; done += Block) {
+    if (write(fd, Buf, Block) != (ssize_t)Block)
+      (*Errors)++;
+  }
+  if (fsync(fd) != 0)
+    (*Errors)++;
+  close(fd);
+  return esp_timer_get_time() - t0;
+}
+
+static int64_t Bench_Read(const char *Path, uint8_t *Buf, uint32_t Block, uint32_t Bytes, uint32_t *Errors)
+{
+  int64_t t0 = esp_timer_get_time();
+  int fd = open(Path, O_RDONLY);
+  if (fd < 0) {
+    (*Errors)++;
+    return 0;
+  }
+  for (uint32_t done = 0; done < Bytes; done += Block) {
+    if (read(fd, Buf, Block) != (ssize_t)Block)
+      (*Errors)++;
+  }
+  close(fd);
+  return esp_timer_get_time() - t0;
+}
+
+// SD_BENCH_RANDOM_OPS aligned reads anywhere in the file; fills Us with each one's latency
+static int64_t Bench_Random_Reads(const char *Path, uint8_t *Buf, uint32_t *Us, uint32_t *Errors)
+{
+  int fd = open(Path, O_RDONLY);
+  if (fd < 0) {
+    (*Errors)++;
+    return 0;
+  }
+  uint32_t slots = SD_BENCH_FILE_SIZE / SD_BENCH_RANDOM_SIZE;
+  int64_t start = esp_timer_get_time();
+  for (uint32_t i = 0; i < SD_BENCH_RANDOM_OPS; i++) {
+    off_t at = (off_t)(Bench_Random() % slots) * SD_BENCH_RANDOM_SIZE;
+    int64_t t0 = esp_timer_get_time();
+    if (pread(fd, Buf, SD_BENCH_RANDOM_SIZE, at) != SD_BENCH_RANDOM_SIZE)
+      (*Errors)++;
+    Us[i] = (uint32_t)(esp_timer_get_time() - t0);
+  }
+  int64_t took = esp_timer_get_time() - start;
+  close(fd);
+  return took;
+}
+
+static void Bench_File_Name(char *Path, size_t Size, const char *Dir, uint32_t i)
+{
+  snprintf(Path, Size, "%s/files/f%04lu.bin", Dir, (unsigned long)i);
+}
+
+static uint32_t Bench_Open(const char *Dir, uint32_t i, uint32_t *Errors)
+{
+  char path[160];
+  Bench_File_Name(path, sizeof(path), Dir, i);
+  int64_t t0 = esp_timer_get_time();
+  for (int k = 0; k < SD_BENCH_OPEN_REPEAT; k++) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+      (*Errors)++;
+    else
+      fclose(f);
+  }
+  return (uint32_t)((esp_timer_get_time() - t0) / SD_BENCH_OPEN_REPEAT);
+}
+
+// openNextFile(): readdir(), then the VFS stat() and fopen() of the entry by its path, each of which has FATFS look
+// the name up from the start of the directory. Next_file false: readdir() alone.
+static uint32_t Bench_List(const char *Dir, bool Next_file, uint32_t *Errors)
+{
+  char dir[128], path[400];
+  snprintf(dir, sizeof(dir), "%s/files", Dir);
+  int64_t t0 = esp_timer_get_time();
+  DIR *d = opendir(dir);
+  if (d == NULL) {
+    (*Errors)++;
+    return 0;
+  }
+  uint32_t n = 0;
+  struct dirent *e;
+  while ((e = readdir(d)) != NULL) {
+    if (e->d_name[0] == '.')
+      continue;
+    n++;
+    if (!Next_file)
+      continue;
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+    FILE *f = stat(path, &st) == 0 ? fopen(path, "rb") : NULL;
+    if (f == NULL)
+      (*Errors)++;
+    else
+      fclose(f);
+  }
+  closedir(d);
+  if (n != SD_BENCH_FILES)
+    (*Errors)++;
+  return (uint32_t)(esp_timer_get_time() - t0);
+}
+
+/********************************************************** Output **********************************************************/
+static void Bench_Print_Latency(const char *Load, float Iops, const SD_Bench_Latency_t *l)
+{
+  printf("SD bench: random %5d B reads, %-6s %7.1f IOPS  p50 %6lu  p90 %6lu  p99 %6lu  max %6lu  mean %6lu us\r\n",
+         SD_BENCH_RANDOM_SIZE, Load, Iops, l->P50_us, l->P90_us, l->P99_us, l->Max_us, l->Mean_us);
+  printf(SD_BENCH_JSON_TAG "{\"test\":\"random_read\",\"size\":%d,\"load\":\"%s\",\"ops\":%lu,\"iops\":%.1f,"
+         "\"min_us\":%lu,\"p50_us\":%lu,\"p90_us\":%lu,\"p99_us\":%lu,\"max_us\":%lu,\"mean_us\":%lu}\r\n",
+         SD_BENCH_RANDOM_SIZE, Load, l->Count, Iops, l->Min_us, l->P50_us, l->P90_us, l->P99_us, l->Max_us,
+         l->Mean_us);
+}
+
+static void Bench_Print(const SD_Bench_Results_t *r)
+{
+  for (int i = 0; i < SD_BENCH_SIZES; i++) {
+    printf("SD bench: sequential %5lu B blocks   write %8.1f KB/s   read %8.1f KB/s\r\n", r->Block[i],
+           r->Write_kbps[i], r->Read_kbps[i]);
+    printf(SD_BENCH_JSON_TAG "{\"test\":\"sequential\",\"block\":%lu,\"bytes\":%lu,\"write_kbps\":%.1f,"
+           "\"read_kbps\":%.1f}\r\n", r->Block[i], Bench_Run_Bytes(r->Block[i]), r->Write_kbps[i], r->Read_kbps[i]);
+  }
+  printf("SD bench: sequential %5d B blocks into PSRAM          read %8.1f KB/s\r\n", SD_BENCH_MAX_BLOCK,
+         r->Read_psram_kbps);
+  printf(SD_BENCH_JSON_TAG "{\"test\":\"sequential_psram\",\"block\":%d,\"read_kbps\":%.1f}\r\n", SD_BENCH_MAX_BLOCK,
+         r->Read_psram_kbps);
+  Bench_Print_Latency("idle", r->Random_iops, &r->Random);
+  if (r->Loaded_iops > 0)
+    Bench_Print_Latency("render", r->Loaded_iops, &r->Loaded);
+  for (int i = 0; i < 3; i++) {
+    printf("SD bench: fopen() of the %-6s of %d files %8lu us\r\n", Bench_Positions[i], SD_BENCH_FILES, r->Open_us[i]);
+    printf(SD_BENCH_JSON_TAG "{\"test\":\"open\",\"position\":\"%s\",\"files\":%d,\"us\":%lu}\r\n",
+           Bench_Positions[i], SD_BENCH_FILES, r->Open_us[i]);
+  }
+  printf("SD bench: listing %d files   openNextFile() pattern %8lu us   readdir() %8lu us\r\n", SD_BENCH_FILES,
+         r->List_next_file_us, r->List_readdir_us);
+  printf(SD_BENCH_JSON_TAG "{\"test\":\"list\",\"method\":\"open_next_file\",\"files\":%d,\"us\":%lu}\r\n",
+         SD_BENCH_FILES, r->List_next_file_us);
+  printf(SD_BENCH_JSON_TAG "{\"test\":\"list\",\"method\":\"readdir\",\"files\":%d,\"us\":%lu}\r\n", SD_BENCH_FILES,
+         r->List_readdir_us);
+  printf(SD_BENCH_JSON_TAG "{\"test\":\"summary\",\"errors\":%lu}\r\n", r->Errors);
+}
+
+/********************************************************** API **********************************************************/
+esp_err_t SD_Bench_Run(const char *Dir, void (*Load)(bool On), SD_Bench_Results_t *Results)
+{
+  SD_Bench_Results_t *r = Results;
+  char seq[128], files[128], path[160];
+  memset(r, 0, sizeof(*r));
+  snprintf(seq, sizeof(seq), "%s/seq.bin", Dir);
+  snprintf(files, sizeof(files), "%s/files", Dir);
+  if ((mkdir(Dir, 0755) != 0 && errno != EEXIST) || (mkdir(files, 0755) != 0 && errno != EEXIST)) {
+    printf("SD bench: cannot create %s\r\n", files);
+    return ESP_ERR_NOT_FOUND;
+  }
+  uint8_t *buf = (uint8_t *)heap_caps_malloc(SD_BENCH_MAX_BLOCK, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+  uint8_t *psram = (uint8_t *)heap_caps_malloc(SD_BENCH_MAX_BLOCK, MALLOC_CAP_SPIRAM);
+  uint32_t *us = (uint32_t *)malloc(SD_BENCH_RANDOM_OPS * sizeof(uint32_t));
+  if (buf == NULL || us == NULL) {
+    printf("SD bench: no memory for a %d-byte DMA buffer\r\n", SD_BENCH_MAX_BLOCK);
+    free(buf);
+    free(psram);
+    free(us);
+    return ESP_ERR_NO_MEM;
+  }
+  for (uint32_t i = 0; i < SD_BENCH_MAX_BLOCK; i++)
+    buf[i] = (uint8_t)(i * 7 + (i >> 8));
+  printf("SD bench: %s, sequential runs up to %d KB, %d random reads, %d files\r\n", Dir, SD_BENCH_FILE_SIZE / 1024,
+         SD_BENCH_RANDOM_OPS, SD_BENCH_FILES);
+
+  // Sequential: the largest block last, so the file is left at SD_BENCH_FILE_SIZE for the random reads
+  for (int i = 0; i < SD_BENCH_SIZES; i++) {
+    uint32_t block = SD_BENCH_MIN_BLOCK << i, bytes = Bench_Run_Bytes(block);
+    r->Block[i] = block;
+    r->Write_kbps[i] = Bench_Kbps(bytes, Bench_Write(seq, buf, block, bytes, &r->Errors));
+  }
+  for (int i = 0; i < SD_BENCH_SIZES; i++) {
+    uint32_t bytes = Bench_Run_Bytes(r->Block[i]);
+    r->Read_kbps[i] = Bench_Kbps(bytes, Bench_Read(seq, buf, r->Block[i], bytes, &r->Errors));
+  }
+  if (psram)
+    r->Read_psram_kbps = Bench_Kbps(SD_BENCH_FILE_SIZE,
+                                    Bench_Read(seq, psram, SD_BENCH_MAX_BLOCK, SD_BENCH_FILE_SIZE, &r->Errors));
+
+  // Random reads, idle and loaded
+  Bench_Rng = 1;
+  int64_t took = Bench_Random_Reads(seq, buf, us, &r->Errors);
+  r->Random_iops = took > 0 ? SD_BENCH_RANDOM_OPS * 1000000.0f / took : 0;
+  Bench_Percentiles(us, SD_BENCH_RANDOM_OPS, &r->Random);
+  if (Load) {
+    Bench_Rng = 1;
+    Load(true);
+    took = Bench_Random_Reads(seq, buf, us, &r->Errors);
+    Load(false);
+    r->Loaded_iops = took > 0 ? SD_BENCH_RANDOM_OPS * 1000000.0f / took : 0;
+    Bench_Percentiles(us, SD_BENCH_RANDOM_OPS, &r->Loaded);
+  }
+
+  // Opening and listing
+  for (uint32_t i = 0; i < SD_BENCH_FILES; i++) {
+    Bench_File_Name(path, sizeof(path), Dir, i);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || write(fd, buf, 1) != 1)
+      r->Errors++;
+    if (fd >= 0)
+      close(fd);
+  }
+  r->Open_us[0] = Bench_Open(Dir, 0, &r->Errors);
+  r->Open_us[1] = Bench_Open(Dir, SD_BENCH_FILES / 2, &r->Errors);
+  r->Open_us[2] = Bench_Open(Dir, SD_BENCH_FILES - 1, &r->Errors);
+  r->List_next_file_us = Bench_List(Dir, true, &r->Errors);
+  r->List_readdir_us = Bench_List(Dir, false, &r->Errors);
+
+  for (uint32_t i = 0; i < SD_BENCH_FILES; i++) {
+    Bench_File_Name(path, sizeof(path), Dir, i);
+    unlink(path);
+  }
+  rmdir(files);
+  unlink(seq);
+  rmdir(Dir);
+  free(buf);
+  free(psram);
+  free(us);
+  Bench_Print(r);
+  return r->Errors ? ESP_FAIL : ESP_OK;
+}
+
+/********************************************************** Device task **********************************************************/
+// The loaded run: LVGL redraws the whole screen every frame, so the flush DMA and the renderer compete with the card.
+// The timer lives for one run and deletes itself once the task is done, in LVGL context.
+static volatile bool   Bench_Loaded = false;
+static volatile bool   Bench_Finished = false;
+static lv_timer_t     *Bench_Timer = NULL;
+static char            Bench_Dir[96];
+static SD_Bench_Results_t Bench_Results;                        // ~200 bytes, kept off the task's stack
+
+static void Bench_Render_Cb(lv_timer_t *t)
+{
+  if (Bench_Finished) {
+    lv_timer_delete(t);
+    Bench_Timer = NULL;
+    return;
+  }
+  if (Bench_Loaded)
+    lv_obj_invalidate(lv_screen_active());
+}
+
+static void Bench_Load(bool On)
+{
+  Bench_Loaded = On;
+}
+
+static void Bench_Task(void *parameter)
+{
+  SD_Bench_Run(Bench_Dir, Bench_Load, &Bench_Results);
+  Bench_Finished = true;
+  Power_Manager_Release();
+  vTaskDelete(NULL);
+}
+
+esp_err_t SD_Bench_Start(const char *Dir)
+{
+  snprintf(Bench_Dir, sizeof(Bench_Dir), "%s", Dir);
+  Power_Manager_Hold();                                         // The loaded run needs the display refreshing
+  Bench_Finished = false;
+  if (Bench_Timer == NULL)
+    Bench_Timer = lv_timer_create(Bench_Render_Cb, SD_BENCH_RENDER_MS, NULL);
+  if (xTaskCreatePinnedToCore(Bench_Task, "SD bench", SD_BENCH_TASK_STACK, NULL, SD_BENCH_TASK_PRIORITY, NULL,
+                              SD_BENCH_TASK_CORE) != pdPASS) {
+    printf("SD bench: cannot start its task\r\n");
+    Bench_Finished = true;
+    Power_Manager_Release();
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/****************************************************** SD card benchmark ******************************************************/
+// Throughput and latency of the card as the firmware sees it: POSIX calls through VFS, FATFS and the SDMMC host in
+// 1-bit mode. Measures:
+//   - sequential writes and reads at block sizes from 512 B to 64 KB (fsync() included in the write time), and 64 KB
+//     reads into PSRAM, which the SDMMC host cannot DMA to;
+//   - random 4 KB reads: IOPS and latency percentiles, idle and while LVGL redraws the whole screen every frame;
+//   - fopen() of the first, middle and last file of a directory, and listing that directory the way openNextFile()
+//     does (stat() and open() per entry) against readdir() alone.
+// Each result is printed as a table row and as one JSON line starting with SD_BENCH_JSON_TAG, for scripts. Works in
+// Dir, which it creates, and removes everything it wrote. The measuring core only uses POSIX files and esp_timer;
+// sim/bench/sdcard_bench.cpp runs it on the host over files whose reads and writes cost what the card model of the
+// other benches says, so the device run checks that model.
+#define SD_BENCH_DIR             "/sdcard/bench"
+#define SD_BENCH_FILE_SIZE       (4 * 1024 * 1024)        // Sequential runs move Block x 1024 bytes, at most this
+#define SD_BENCH_SIZES           8                        // 512 B, 1 KB ... 64 KB
+#define SD_BENCH_MIN_BLOCK       512
+#define SD_BENCH_MAX_BLOCK       (SD_BENCH_MIN_BLOCK << (SD_BENCH_SIZES - 1))
+#define SD_BENCH_RANDOM_SIZE     4096
+#define SD_BENCH_RANDOM_OPS      400
+#define SD_BENCH_FILES           200                      // In the directory of the open and list runs
+#define SD_BENCH_OPEN_REPEAT     20                       // fopen() calls averaged per position
+#define SD_BENCH_JSON_TAG        "SDBENCH "
+#define SD_BENCH_RENDER_MS       5                        // Redraw period during the loaded run, Lvgl_Loop()'s
+#define SD_BENCH_TASK_CORE       0
+#define SD_BENCH_TASK_PRIORITY   1
+#define SD_BENCH_TASK_STACK      6144
+#ifndef SD_BENCH_AUTOSTART
+#define SD_BENCH_AUTOSTART       0                        // Run SD_Bench_Start() from setup()
+#endif
+
+typedef struct {
+  uint32_t Count;
+  uint32_t Min_us;
+  uint32_t P50_us;
+  uint32_t P90_us;
+  uint32_t P99_us;
+  uint32_t Max_us;
+  uint32_t Mean_us;
+} SD_Bench_Latency_t;
+
+typedef struct {
+  uint32_t           Block[SD_BENCH_SIZES];
+  float              Write_kbps[SD_BENCH_SIZES];
+  float              Read_kbps[SD_BENCH_SIZES];
+  float              Read_psram_kbps;                     // SD_BENCH_MAX_BLOCK reads into PSRAM
+  float              Random_iops;
+  SD_Bench_Latency_t Random;
+  float              Loaded_iops;                         // 0: no load given
+  SD_Bench_Latency_t Loaded;
+  uint32_t           Open_us[3];                          // fopen() and fclose() of the first, middle and last file
+  uint32_t           List_next_file_us;                   // Whole directory, readdir(), stat() and open() per entry
+  uint32_t           List_readdir_us;                     // Whole directory, readdir() alone
+  uint32_t           Errors;                              // Short or failed calls
+} SD_Bench_Results_t;
+
+esp_err_t SD_Bench_Run(const char *Dir, void (*Load)(bool On), SD_Bench_Results_t *Results);
+                                                          // Blocks for a minute or so. Load is turned on around the
+                                                          // loaded latency run; NULL skips that run
+esp_err_t SD_Bench_Start(const char *Dir);                // LVGL context, after SD_Init(): SD_Bench_Run() in its own
+                                                          // task, the loaded run with the screen redrawn every frame.
+                                                          // The device does not sleep until it is done
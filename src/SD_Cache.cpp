@@ -0,0 +1,467 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "SD_Cache.h"
+
+#define CACHE_EMPTY    0
+#define CACHE_LOADING  1
+#define CACHE_READY    2
+
+typedef struct {
+  uint32_t     Key;                                             // Of the file, see Cache_Key()
+  uint32_t     Index;                                           // Block number within the file
+  uint32_t     Length;                                          // Valid bytes, short for the last block
+  uint32_t     Used;                                            // Cache_Clock at the last access, for LRU
+  uint8_t      State;                                           // CACHE_*
+  bool         Prefetched;                                      // Fetched ahead and not read yet
+  TaskHandle_t Waiter;                                          // Notified when a load finishes
+  uint8_t     *Data;                                            // PSRAM
+} Cache_Block_t;
+
+struct SD_Cache_File {
+  int      Fd;
+  uint32_t Key;
+  uint32_t Size;
+  uint32_t Pos;
+  uint32_t Last_index;                                          // Block of the previous read
+  uint32_t Ahead_index;                                         // Read-ahead requested up to here
+  uint8_t  Sequential;                                          // Consecutive reads that moved forward by <= 1 block
+  uint8_t  Pending;                                             // Read-ahead requests still queued for this file
+  bool     Closing;
+  SD_Cache_File_Stats_t Stats;
+};
+
+typedef struct {
+  SD_Cache_File_t *File;
+  uint32_t         Index;
+} Cache_Request_t;
+
+static Cache_Block_t     Cache_Blocks[SD_CACHE_BLOCKS];
+static uint8_t          *Cache_Staging = NULL;                  // Internal DMA memory, see Cache_Load()
+static uint32_t          Cache_Clock = 0;
+static SemaphoreHandle_t Cache_Lock = NULL;                     // Block table and file state
+static SemaphoreHandle_t Cache_Io_Lock = NULL;                  // Cache_Staging
+static QueueHandle_t     Cache_Requests = NULL;
+static TaskHandle_t      Cache_Task = NULL;                     // NULL: read-ahead runs inline
+static SD_Cache_Stats_t  Cache_Stats;
+static SD_Cache_File_Stats_t Cache_File_Stats[SD_CACHE_FILE_STATS];
+
+// FNV-1a of the path, size and modification time: a rewritten file gets new blocks
+static uint32_t Cache_Key(const char *Path, const struct stat *st)
+{
+  uint32_t h = 2166136261u;
+  for (const char *p = Path; *p; p++)
+    h = (h ^ (uint8_t)*p) * 16777619u;
+  uint32_t extra[2] = {(uint32_t)st->st_size, (uint32_t)st->st_mtime};
+  for (int i = 0; i < 8; i++)
+    h = (h ^ ((uint8_t *)extra)[i]) * 16777619u;
+  return h;
+}
+
+/********************************************************** Block table **********************************************************/
+// All of these run with Cache_Lock held
+static Cache_Block_t *Cache_Find(uint32_t Key, uint32_t Index)
+{
+  for (int i = 0; i < SD_CACHE_BLOCKS; i++) {
+    Cache_Block_t *b = &Cache_Blocks[i];
+    if (b->State != CACHE_EMPTY && b->Key == Key && b->Index == Index)
+      return b;
+  }
+  return NULL;
+}
+
+// Least recently used block that nobody is loading; an empty one first
+static Cache_Block_t *Cache_Victim(void)
+{
+  Cache_Block_t *victim = NULL;
+  for (int i = 0; i < SD_CACHE_BLOCKS; i++) {
+    Cache_Block_t *b = &Cache_Blocks[i];
+    if (b->State == CACHE_EMPTY)
+      return b;
+    if (b->State == CACHE_READY && (victim == NULL || (int32_t)(b->Used - victim->Used) < 0))
+      victim = b;
+  }
+  if (victim) {
+    Cache_Stats.Evictions++;
+    if (victim->Prefetched)
+      Cache_Stats.Readahead_unused++;
+    victim->State = CACHE_EMPTY;
+  }
+  return victim;
+}
+
+// Reads block Index of f into b, which the caller has marked CACHE_LOADING. Called with Cache_Lock held, drops it
+// for the card access. The SDMMC host cannot DMA into PSRAM and would fall back to one sector per command, so the
+// block is read into internal memory in one transfer and copied over.
+static bool Cache_Load(SD_Cache_File_t *f, Cache_Block_t *b, uint32_t Index)
+{
+  uint32_t offset = Index * SD_CACHE_BLOCK_SIZE;
+  uint32_t length = f->Size - offset < SD_CACHE_BLOCK_SIZE ? f->Size - offset : SD_CACHE_BLOCK_SIZE;
+  xSemaphoreGive(Cache_Lock);
+
+  xSemaphoreTake(Cache_Io_Lock, portMAX_DELAY);
+  int64_t t0 = esp_timer_get_time();
+  ssize_t got = pread(f->Fd, Cache_Staging, length, offset);
+  uint32_t took = (uint32_t)(esp_timer_get_time() - t0);
+  if (got == (ssize_t)length)
+    memcpy(b->Data, Cache_Staging, length);
+  xSemaphoreGive(Cache_Io_Lock);
+
+  xSemaphoreTake(Cache_Lock, portMAX_DELAY);
+  Cache_Stats.Card_reads++;
+  Cache_Stats.Card_us += took;
+  bool ok = got == (ssize_t)length;
+  if (ok) {
+    Cache_Stats.Card_bytes += length;
+    b->Length = length;
+    b->State = CACHE_READY;
+  } else {
+    printf("SD cache: read of %lu bytes at %lu failed\r\n", length, offset);
+    b->State = CACHE_EMPTY;
+  }
+  b->Used = ++Cache_Clock;
+  if (b->Waiter) {
+    xTaskNotifyGive(b->Waiter);
+    b->Waiter = NULL;
+  }
+  return ok;
+}
+
+static void Cache_File_Free(SD_Cache_File_t *f);
+
+// One read-ahead request, with Cache_Lock held
+static void Cache_Prefetch(SD_Cache_File_t *f, uint32_t Index)
+{
+  if (!f->Closing && Cache_Find(f->Key, Index) == NULL) {
+    Cache_Block_t *b = Cache_Victim();
+    if (b) {
+      b->Key = f->Key;
+      b->Index = Index;
+      b->State = CACHE_LOADING;
+      b->Prefetched = true;
+      b->Waiter = NULL;
+      Cache_Stats.Readahead_fetches++;
+      Cache_Load(f, b, Index);
+    }
+  }
+  if (--f->Pending == 0 && f->Closing)
+    Cache_File_Free(f);
+}
+
+static void Cache_Readahead_Task(void *parameter)
+{
+  Cache_Request_t req;
+  while (1) {
+    xQueueReceive(Cache_Requests, &req, portMAX_DELAY);
+    xSemaphoreTake(Cache_Lock, portMAX_DELAY);
+    Cache_Prefetch(req.File, req.Index);
+    xSemaphoreGive(Cache_Lock);
+  }
+}
+
+// After a read that continued the previous one, keep SD_CACHE_READAHEAD blocks requested beyond it
+static void Cache_Readahead(SD_Cache_File_t *f, uint32_t Index)
+{
+  uint32_t blocks = (f->Size + SD_CACHE_BLOCK_SIZE - 1) / SD_CACHE_BLOCK_SIZE;
+  uint32_t want = Index + SD_CACHE_READAHEAD < blocks - 1 ? Index + SD_CACHE_READAHEAD : blocks - 1;
+  uint32_t next = f->Ahead_index > Index ? f->Ahead_index + 1 : Index + 1;
+  for (; next <= want; next++) {
+    Cache_Request_t req = {f, next};
+    f->Pending++;
+    if (Cache_Task == NULL)
+      Cache_Prefetch(f, next);
+    else if (xQueueSend(Cache_Requests, &req, 0) != pdTRUE) {
+      f->Pending--;
+      break;
+    }
+    f->Ahead_index = next;
+  }
+}
+
+/********************************************************** Files **********************************************************/
+static SD_Cache_File_Stats_t *Cache_File_Stats_Slot(const char *Path)
+{
+  size_t len = strlen(Path), max = sizeof(Cache_File_Stats[0].Path) - 1;
+  const char *name = len > max ? Path + len - max : Path;
+  SD_Cache_File_Stats_t *slot = &Cache_File_Stats[SD_CACHE_FILE_STATS - 1];
+  for (int i = 0; i < SD_CACHE_FILE_STATS; i++) {
+    if (strcmp(Cache_File_Stats[i].Path, name) == 0) {
+      slot = &Cache_File_Stats[i];
+      break;
+    }
+  }
+  SD_Cache_File_Stats_t s = *slot;                              // Most recent first
+  memmove(&Cache_File_Stats[1], &Cache_File_Stats[0], (slot - Cache_File_Stats) * sizeof(s));
+  if (strcmp(s.Path, name) != 0) {
+    memset(&s, 0, sizeof(s));
+    strcpy(s.Path, name);
+  }
+  Cache_File_Stats[0] = s;
+  return &Cache_File_Stats[0];
+}
+
+static void Cache_File_Free(SD_Cache_File_t *f)
+{
+  close(f->Fd);
+  free(f);
+}
+
+SD_Cache_File_t *SD_Cache_Open(const char *Path)
+{
+  if (Cache_Lock == NULL)
+    return NULL;
+  int fd = open(Path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  SD_Cache_File_t *f = (SD_Cache_File_t *)calloc(1, sizeof(SD_Cache_File_t));
+  if (f == NULL || fstat(fd, &st) != 0) {
+    free(f);
+    close(fd);
+    return NULL;
+  }
+  f->Fd = fd;
+  f->Key = Cache_Key(Path, &st);
+  f->Size = (uint32_t)st.st_size;
+  f->Last_index = UINT32_MAX;
+  size_t len = strlen(Path), max = sizeof(f->Stats.Path) - 1;
+  strcpy(f->Stats.Path, len > max ? Path + len - max : Path);
+  f->Stats.Opens = 1;
+  return f;
+}
+
+int32_t SD_Cache_Read(SD_Cache_File_t *f, void *Buf, uint32_t Length)
+{
+  uint8_t *dst = (uint8_t *)Buf;
+  uint32_t done = 0;
+  if (f->Pos >= f->Size)
+    return 0;
+  if (Length > f->Size - f->Pos)
+    Length = f->Size - f->Pos;
+
+  xSemaphoreTake(Cache_Lock, portMAX_DELAY);
+  uint32_t first = f->Pos / SD_CACHE_BLOCK_SIZE;
+  if (f->Last_index != UINT32_MAX && first >= f->Last_index && first <= f->Last_index + 1) {
+    if (f->Sequential < 255)
+      f->Sequential++;
+  } else {
+    f->Sequential = 0;
+    f->Ahead_index = 0;
+  }
+  while (done < Length) {
+    uint32_t index = f->Pos / SD_CACHE_BLOCK_SIZE;
+    uint32_t at = f->Pos % SD_CACHE_BLOCK_SIZE;
+    Cache_Block_t *b = Cache_Find(f->Key, index);
+    if (b && b->State == CACHE_LOADING) {                       // The task is on it
+      Cache_Stats.Readahead_waits++;
+      if (b->Waiter == NULL) {
+        b->Waiter = xTaskGetCurrentTaskHandle();
+        xSemaphoreGive(Cache_Lock);
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+      } else {
+        xSemaphoreGive(Cache_Lock);
+        vTaskDelay(1);
+      }
+      xSemaphoreTake(Cache_Lock, portMAX_DELAY);
+      continue;                                                 // Look again: loaded, or failed and gone
+    }
+    if (b) {
+      Cache_Stats.Hits++;
+      f->Stats.Hits++;
+      if (b->Prefetched) {
+        Cache_Stats.Readahead_hits++;
+        f->Stats.Readahead_hits++;
+        b->Prefetched = false;
+      }
+    } else {
+      b = Cache_Victim();
+      if (b == NULL) {                                          // Every block is loading: wait for one
+        xSemaphoreGive(Cache_Lock);
+        vTaskDelay(1);
+        xSemaphoreTake(Cache_Lock, portMAX_DELAY);
+        continue;
+      }
+      b->Key = f->Key;
+      b->Index = index;
+      b->State = CACHE_LOADING;
+      b->Prefetched = false;
+      b->Waiter = NULL;
+      Cache_Stats.Misses++;
+      f->Stats.Misses++;
+      if (!Cache_Load(f, b, index))
+        break;
+    }
+    uint32_t n = b->Length - at < Length - done ? b->Length - at : Length - done;
+    memcpy(dst + done, b->Data + at, n);
+    b->Used = ++Cache_Clock;
+    done += n;
+    f->Pos += n;
+  }
+  f->Last_index = (f->Pos - (done ? 1 : 0)) / SD_CACHE_BLOCK_SIZE;
+  f->Stats.Reads++;
+  f->Stats.Bytes += done;
+  if (f->Sequential && done == Length)
+    Cache_Readahead(f, f->Last_index);
+  xSemaphoreGive(Cache_Lock);
+  return done == Length ? (int32_t)done : -1;
+}
+
+void SD_Cache_Seek(SD_Cache_File_t *f, uint32_t Pos)
+{
+  f->Pos = Pos;
+}
+
+uint32_t SD_Cache_Tell(SD_Cache_File_t *f)
+{
+  return f->Pos;
+}
+
+uint32_t SD_Cache_Size(SD_Cache_File_t *f)
+{
+  return f->Size;
+}
+
+// For readers that know what they will want before they want it (SD_Async hints): the blocks are loaded here, in the
+// caller's task, and left for the reads that follow. Blocks another task is loading already are not waited for.
+bool SD_Cache_Prefetch(SD_Cache_File_t *f, uint32_t Offset, uint32_t Length)
+{
+  if (Offset >= f->Size || Length == 0)
+    return true;
+  if (Length > f->Size - Offset)
+    Length = f->Size - Offset;
+  bool ok = true;
+  xSemaphoreTake(Cache_Lock, portMAX_DELAY);
+  for (uint32_t i = Offset / SD_CACHE_BLOCK_SIZE; ok && i <= (Offset + Length - 1) / SD_CACHE_BLOCK_SIZE; i++) {
+    Cache_Block_t *b = Cache_Find(f->Key, i);
+    if (b) {
+      if (b->State == CACHE_READY)
+        b->Used = ++Cache_Clock;
+      continue;
+    }
+    b = Cache_Victim();
+    if (b == NULL)                                              // Every block is loading
+      break;
+    b->Key = f->Key;
+    b->Index = i;
+    b->State = CACHE_LOADING;
+    b->Prefetched = true;
+    b->Waiter = NULL;
+    Cache_Stats.Readahead_fetches++;
+    ok = Cache_Load(f, b, i);
+  }
+  xSemaphoreGive(Cache_Lock);
+  return ok;
+}
+
+// Read-ahead still queued for the file holds its descriptor; the last request frees it
+void SD_Cache_Close(SD_Cache_File_t *f)
+{
+  xSemaphoreTake(Cache_Lock, portMAX_DELAY);
+  SD_Cache_File_Stats_t *s = Cache_File_Stats_Slot(f->Stats.Path);
+  s->Opens += f->Stats.Opens;
+  s->Reads += f->Stats.Reads;
+  s->Bytes += f->Stats.Bytes;
+  s->Hits += f->Stats.Hits;
+  s->Misses += f->Stats.Misses;
+  s->Readahead_hits += f->Stats.Readahead_hits;
+  f->Closing = true;
+  if (f->Pending == 0)
+    Cache_File_Free(f);
+  xSemaphoreGive(Cache_Lock);
+}
+
+/********************************************************** Setup **********************************************************/
+esp_err_t SD_Cache_Init(void)
+{
+  if (Cache_Lock)
+    return ESP_OK;
+  uint8_t *pool = (uint8_t *)heap_caps_malloc((size_t)SD_CACHE_BLOCKS * SD_CACHE_BLOCK_SIZE, MALLOC_CAP_SPIRAM);
+  Cache_Staging = (uint8_t *)heap_caps_malloc(SD_CACHE_BLOCK_SIZE, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+  Cache_Lock = xSemaphoreCreateMutex();
+  Cache_Io_Lock = xSemaphoreCreateMutex();
+  Cache_Requests = xQueueCreate(SD_CACHE_QUEUE, sizeof(Cache_Request_t));
+  if (pool == NULL || Cache_Staging == NULL || Cache_Lock == NULL || Cache_Io_Lock == NULL || Cache_Requests == NULL) {
+    printf("SD cache: cannot allocate %d x %d bytes\r\n", SD_CACHE_BLOCKS, SD_CACHE_BLOCK_SIZE);
+    return ESP_ERR_NO_MEM;
+  }
+  for (int i = 0; i < SD_CACHE_BLOCKS; i++)
+    Cache_Blocks[i].Data = pool + (size_t)i * SD_CACHE_BLOCK_SIZE;
+  if (xTaskCreatePinnedToCore(Cache_Readahead_Task, "SD read-ahead", SD_CACHE_TASK_STACK, NULL,
+                              SD_CACHE_TASK_PRIORITY, &Cache_Task, SD_CACHE_TASK_CORE) != pdPASS)
+    Cache_Task = NULL;
+  return ESP_OK;
+}
+
+void SD_Cache_Drop(void)
+{
+  if (Cache_Lock == NULL)
+    return;
+  xSemaphoreTake(Cache_Lock, portMAX_DELAY);
+  for (int i = 0; i < SD_CACHE_BLOCKS; i++) {
+    if (Cache_Blocks[i].State == CACHE_READY)
+      Cache_Blocks[i].State = CACHE_EMPTY;
+  }
+  xSemaphoreGive(Cache_Lock);
+}
+
+void SD_Cache_Get_Stats(SD_Cache_Stats_t *stats)
+{
+  if (Cache_Lock)
+    xSemaphoreTake(Cache_Lock, portMAX_DELAY);
+  *stats = Cache_Stats;
+  if (Cache_Lock)
+    xSemaphoreGive(Cache_Lock);
+}
+
+uint8_t SD_Cache_Get_File_Stats(SD_Cache_File_Stats_t *stats, uint8_t Max)
+{
+  uint8_t n = 0;
+  if (Cache_Lock)
+    xSemaphoreTake(Cache_Lock, portMAX_DELAY);
+  for (int i = 0; i < SD_CACHE_FILE_STATS && n < Max; i++) {
+    if (Cache_File_Stats[i].Path[0])
+      stats[n++] = Cache_File_Stats[i];
+  }
+  if (Cache_Lock)
+    xSemaphoreGive(Cache_Lock);
+  return n;
+}
+
+void SD_Cache_Reset_Stats(void)
+{
+  if (Cache_Lock)
+    xSemaphoreTake(Cache_Lock, portMAX_DELAY);
+  memset(&Cache_Stats, 0, sizeof(Cache_Stats));
+  memset(Cache_File_Stats, 0, sizeof(Cache_File_Stats));
+  if (Cache_Lock)
+    xSemaphoreGive(Cache_Lock);
+}
+
+void SD_Cache_Print_Stats(void)
+{
+  SD_Cache_Stats_t s;
+  SD_Cache_Get_Stats(&s);
+  uint32_t accesses = s.Hits + s.Misses;
+  printf("SD cache: %lu block accesses, %.1f%% hits (%lu read ahead, %lu waited), %lu misses, %lu evictions\r\n",
+         accesses, accesses ? 100.0 * s.Hits / accesses : 0.0, s.Readahead_hits, s.Readahead_waits, s.Misses,
+         s.Evictions);
+  printf("SD cache: %lu card reads, %llu KB in %llu ms; %lu fetched ahead, %lu of them never read\r\n",
+         s.Card_reads, s.Card_bytes / 1024, s.Card_us / 1000, s.Readahead_fetches, s.Readahead_unused);
+  SD_Cache_File_Stats_t files[SD_CACHE_FILE_STATS];
+  uint8_t n = SD_Cache_Get_File_Stats(files, SD_CACHE_FILE_STATS);
+  for (uint8_t i = 0; i < n; i++) {
+    const SD_Cache_File_Stats_t *f = &files[i];
+    uint32_t a = f->Hits + f->Misses;
+    printf("  %-40s %4lu opens %7lu reads %8llu B  %5.1f%% hits, %lu ahead\r\n", f->Path, f->Opens, f->Reads,
+           f->Bytes, a ? 100.0 * f->Hits / a : 0.0, f->Readahead_hits);
+  }
+}
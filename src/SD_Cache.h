@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/****************************************************** SD block cache ******************************************************/
+// Read-only block cache between file readers (the LVGL file system driver in LVGL_FS.cpp) and the card. Files are read
+// in aligned blocks into PSRAM, so the many small reads of image and font loaders cost a memcpy instead of a trip
+// through VFS, FATFS and SDMMC each. Blocks are evicted least recently used first. Blocks are keyed by path, size and
+// modification time, so a file that is closed and opened again still hits, and a rewritten file does not.
+// A reader that moves through a file sequentially gets the next blocks fetched by a background task while it works
+// on the current one.
+#define SD_CACHE_BLOCK_SIZE      16384                    // 4-32 KB: a power of two, whole sectors
+#define SD_CACHE_BLOCKS          48                       // 768 KB of PSRAM
+#define SD_CACHE_READAHEAD       2                        // Blocks fetched ahead of a sequential reader
+#define SD_CACHE_QUEUE           8                        // Read-ahead requests waiting for the task
+#define SD_CACHE_FILE_STATS      16                       // Files whose statistics are kept, least recent replaced
+#define SD_CACHE_TASK_CORE       0
+#define SD_CACHE_TASK_PRIORITY   1                        // Below everything that samples, like the logger's writer
+#define SD_CACHE_TASK_STACK      3072
+
+typedef struct SD_Cache_File SD_Cache_File_t;
+
+typedef struct {
+  uint32_t Hits;                                          // Block accesses served from PSRAM
+  uint32_t Misses;                                        // Block accesses that read the card in the caller
+  uint32_t Readahead_hits;                                // Hits on blocks the task fetched (waits included)
+  uint32_t Readahead_waits;                               // Hits that had to wait for the task to finish the block
+  uint32_t Readahead_fetches;
+  uint32_t Readahead_unused;                              // Fetched ahead, evicted before anyone read them
+  uint32_t Evictions;
+  uint32_t Card_reads;                                    // pread() calls, caller and task
+  uint64_t Card_bytes;
+  uint64_t Card_us;                                       // Time inside pread(), caller and task
+} SD_Cache_Stats_t;
+
+typedef struct {
+  char     Path[48];                                      // Tail of the path when longer
+  uint32_t Opens;
+  uint32_t Reads;                                         // SD_Cache_Read() calls
+  uint64_t Bytes;
+  uint32_t Hits;
+  uint32_t Misses;
+  uint32_t Readahead_hits;
+} SD_Cache_File_Stats_t;
+
+esp_err_t         SD_Cache_Init(void);                    // After SD_Init(). Allocates the blocks
+SD_Cache_File_t  *SD_Cache_Open(const char *Path);        // Full VFS path, e.g. /sdcard/img/a.bin. NULL: not found
+int32_t           SD_Cache_Read(SD_Cache_File_t *f, void *Buf, uint32_t Length);  // Bytes read, -1: card error
+void              SD_Cache_Seek(SD_Cache_File_t *f, uint32_t Pos);
+uint32_t          SD_Cache_Tell(SD_Cache_File_t *f);
+uint32_t          SD_Cache_Size(SD_Cache_File_t *f);
+bool              SD_Cache_Prefetch(SD_Cache_File_t *f, uint32_t Offset, uint32_t Length);
+                                                          // Loads the blocks of a range, no copy; they count as read
+                                                          // ahead. false: card error
+void              SD_Cache_Close(SD_Cache_File_t *f);
+void              SD_Cache_Drop(void);                    // Forget every block not in use (benchmarks)
+void              SD_Cache_Get_Stats(SD_Cache_Stats_t *stats);
+uint8_t           SD_Cache_Get_File_Stats(SD_Cache_File_Stats_t *stats, uint8_t Max);  // Most recent first
+void              SD_Cache_Reset_Stats(void);
+void              SD_Cache_Print_Stats(void);
@@ -1,4 +1,5 @@
 #include "SD_Card.h"
+#include "SD_Index.h"
 
 bool SDCard_Flag;
 bool SDCard_Finish;
@@ -48,59 +49,46 @@ void SD_Init() {
     printf("Total space: %llu\n", totalBytes);
     printf("Used space: %llu\n", usedBytes);
     printf("Free space: %llu\n", totalBytes - usedBytes);
+    SD_Index_Init();
+    SD_Index_Drop();                                                  // A remount may be another card: check again
   }
 }
 bool File_Search(const char* directory, const char* fileName)    
 {
-  File Path = SD_MMC.open(directory);
-  if (!Path) {
+  if (SD_Index_Count(directory, NULL) < 0) {
     printf("Path: <%s> does not exist\r\n",directory);
     return false;
   }
-  File file = Path.openNextFile();
-  while (file) {
-    if (strcmp(file.name(), fileName) == 0) {                           
-      if (strcmp(directory, "/") == 0)
-        printf("File '%s%s' found in root directory.\r\n",directory,fileName);  
-      else
-        printf("File '%s/%s' found in root directory.\r\n",directory,fileName); 
-      Path.close();                                                     
-      return true;                                                     
-    }
-    file = Path.openNextFile();                                        
-  }
+  bool found = SD_Index_Stat(directory, fileName, NULL);              // Hash lookup in the directory index
   if (strcmp(directory, "/") == 0)
-    printf("File '%s%s' not found in root directory.\r\n",directory,fileName);           
+    printf("File '%s%s' %s in root directory.\r\n",directory,fileName,found ? "found" : "not found");
   else
-    printf("File '%s/%s' not found in root directory.\r\n",directory,fileName);          
-  Path.close();                                                         
-  return false;                                                         
+    printf("File '%s/%s' %s in root directory.\r\n",directory,fileName,found ? "found" : "not found");
+  return found;
 }
+// Files whose extension is fileExtension (".mp3" or "mp3", any case), in name order
 uint16_t Folder_retrieval(const char* directory, const char* fileExtension, char File_Name[][100],uint16_t maxFiles)    
 {
-  File Path = SD_MMC.open(directory);
-  if (!Path) {
+  if (SD_Index_Count(directory, NULL) < 0) {
     printf("Path: <%s> does not exist\r\n",directory);
-    return false;
+    return 0;
   }
   
   uint16_t fileCount = 0;
   char filePath[100];
-  File file = Path.openNextFile();
-  while (file && fileCount < maxFiles) {
-    if (!file.isDirectory() && strstr(file.name(), fileExtension)) {
-      strncpy(File_Name[fileCount], file.name(), sizeof(File_Name[fileCount])); 
-      if (strcmp(directory, "/") == 0) {                                      
-        snprintf(filePath, 100, "%s%s", directory, file.name());   
-      } else {                                                            
-        snprintf(filePath, 100, "%s/%s", directory, file.name());
-      }
-      printf("File found: %s\r\n", filePath);
-      fileCount++;
+  SD_Index_File_t file;
+  for (uint32_t k = 0; fileCount < maxFiles && SD_Index_List(directory, fileExtension, k, &file, 1) == 1; k++) {
+    if (file.Is_dir)
+      continue;
+    strncpy(File_Name[fileCount], file.Name, sizeof(File_Name[fileCount]));
+    if (strcmp(directory, "/") == 0) {                                      
+      snprintf(filePath, 100, "%s%s", directory, file.Name);   
+    } else {                                                            
+      snprintf(filePath, 100, "%s/%s", directory, file.Name);
     }
-    file = Path.openNextFile();                                      
+    printf("File found: %s\r\n", filePath);
+    fileCount++;
   }
-  Path.close();                                                         
   if (fileCount > 0) {
     printf("Retrieved %d mp3 files\r\n",fileCount);
     return fileCount;                                                 
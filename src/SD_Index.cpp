@@ -0,0 +1,564 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "ff.h"
+#include "SD_Index.h"
+
+/********************************************************** Index core **********************************************************/
+// qsort() has no context argument; the core runs under Index_Lock on the device and single-threaded on the host
+static const SD_Index_Dir_t *Sort_dir;
+
+static uint32_t Index_Hash(const char *Name)
+{
+  uint32_t h = 2166136261u;                                     // FNV-1a of the lower-case name
+  for (; *Name; Name++) {
+    char c = *Name;
+    h = (h ^ (uint8_t)(c >= 'A' && c <= 'Z' ? c + 32 : c)) * 16777619u;
+  }
+  return h;
+}
+
+static const char *Index_Name(const SD_Index_Dir_t *d, uint32_t i)
+{
+  return d->Names + d->Entries[i].Name;
+}
+
+static int Index_Sort_Name(const void *a, const void *b)
+{
+  return strcasecmp(Sort_dir->Names + ((const SD_Index_Entry_t *)a)->Name,
+                    Sort_dir->Names + ((const SD_Index_Entry_t *)b)->Name);
+}
+
+static int Index_Sort_Ext(const void *a, const void *b)
+{
+  uint32_t i = *(const uint32_t *)a, j = *(const uint32_t *)b;
+  int c = strcasecmp(Index_Name(Sort_dir, i) + Sort_dir->Entries[i].Ext,
+                     Index_Name(Sort_dir, j) + Sort_dir->Entries[j].Ext);
+  return c ? c : (i < j ? -1 : i > j);                          // Entries are already in name order
+}
+
+// The hash table and the extension order, from entries sorted by name
+static bool Index_Tables(SD_Index_Dir_t *d)
+{
+  free(d->Hash);
+  free(d->By_ext);
+  d->Hash_size = 16;
+  while (d->Hash_size < 2 * d->Count)
+    d->Hash_size <<= 1;
+  d->Hash = (uint32_t *)calloc(d->Hash_size, sizeof(uint32_t));
+  d->By_ext = (uint32_t *)malloc((d->Count ? d->Count : 1) * sizeof(uint32_t));
+  if (d->Hash == NULL || d->By_ext == NULL)
+    return false;
+  for (uint32_t i = 0; i < d->Count; i++) {
+    uint32_t slot = Index_Hash(Index_Name(d, i)) & (d->Hash_size - 1);
+    while (d->Hash[slot])
+      slot = (slot + 1) & (d->Hash_size - 1);
+    d->Hash[slot] = i + 1;
+    d->By_ext[i] = i;
+  }
+  Sort_dir = d;
+  qsort(d->By_ext, d->Count, sizeof(uint32_t), Index_Sort_Ext);
+  return true;
+}
+
+bool SD_Index_Build(SD_Index_Dir_t *d, SD_Index_Entry_t *Entries, uint32_t Count, char *Names, uint32_t Names_size)
+{
+  memset(d, 0, sizeof(*d));
+  d->Count = Count;
+  d->Entries = Entries;
+  d->Names = Names;
+  d->Names_size = Names_size;
+  for (uint32_t i = 0; i < Count; i++) {
+    const char *name = Names + Entries[i].Name;
+    const char *dot = strrchr(name, '.');
+    Entries[i].Ext = (uint16_t)(dot && dot != name ? dot + 1 - name : strlen(name));
+  }
+  Sort_dir = d;
+  qsort(Entries, Count, sizeof(SD_Index_Entry_t), Index_Sort_Name);
+  return Index_Tables(d);
+}
+
+void SD_Index_Free(SD_Index_Dir_t *d)
+{
+  free(d->Entries);
+  free(d->Names);
+  free(d->Hash);
+  free(d->By_ext);
+  memset(d, 0, sizeof(*d));
+}
+
+int32_t SD_Index_Find(const SD_Index_Dir_t *d, const char *Name)
+{
+  if (d->Hash == NULL)
+    return -1;
+  uint32_t slot = Index_Hash(Name) & (d->Hash_size - 1);
+  for (; d->Hash[slot]; slot = (slot + 1) & (d->Hash_size - 1)) {
+    uint32_t i = d->Hash[slot] - 1;
+    if (strcasecmp(Index_Name(d, i), Name) == 0)
+      return (int32_t)i;
+  }
+  return -1;
+}
+
+// Binary search of By_ext for the first entry whose extension is not below Ext (Upper: above Ext)
+static uint32_t Index_Ext_Bound(const SD_Index_Dir_t *d, const char *Ext, bool Upper)
+{
+  uint32_t lo = 0, hi = d->Count;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2, i = d->By_ext[mid];
+    int c = strcasecmp(Index_Name(d, i) + d->Entries[i].Ext, Ext);
+    if (c < 0 || (Upper && c == 0))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+uint32_t SD_Index_Find_Ext(const SD_Index_Dir_t *d, const char *Ext, uint32_t *First)
+{
+  if (Ext[0] == '.')
+    Ext++;
+  *First = Index_Ext_Bound(d, Ext, false);
+  return Index_Ext_Bound(d, Ext, true) - *First;
+}
+
+bool SD_Index_Put(SD_Index_Dir_t *d, const char *Name, const SD_Index_Entry_t *e)
+{
+  int32_t at = SD_Index_Find(d, Name);
+  if (at < 0 && e == NULL)
+    return true;
+  uint32_t count = d->Count - (at >= 0) + (e != NULL);
+  uint32_t names_size = d->Names_size + (e ? strlen(Name) + 1 : 0);
+  SD_Index_Entry_t *entries = (SD_Index_Entry_t *)malloc((count ? count : 1) * sizeof(SD_Index_Entry_t));
+  char *names = (char *)malloc(names_size ? names_size : 1);
+  if (entries == NULL || names == NULL) {
+    free(entries);
+    free(names);
+    return false;
+  }
+  uint32_t n = 0, pos = 0;
+  for (uint32_t i = 0; i < d->Count; i++) {
+    if ((int32_t)i == at)
+      continue;
+    size_t len = strlen(Index_Name(d, i)) + 1;
+    entries[n] = d->Entries[i];
+    entries[n++].Name = pos;
+    memcpy(names + pos, Index_Name(d, i), len);
+    pos += len;
+  }
+  if (e) {
+    entries[n] = *e;
+    entries[n++].Name = pos;
+    strcpy(names + pos, Name);
+    pos += strlen(Name) + 1;
+  }
+  SD_Index_Free(d);
+  return SD_Index_Build(d, entries, n, names, pos);
+}
+
+uint8_t *SD_Index_Serialize(const SD_Index_Dir_t *d, const SD_Index_Header_t *h, uint32_t *Length)
+{
+  SD_Index_Header_t head = *h;
+  head.Magic = SD_INDEX_MAGIC;
+  head.Version = SD_INDEX_VERSION;
+  head.Entry_size = sizeof(SD_Index_Entry_t);
+  head.Count = d->Count;
+  head.Names_size = d->Names_size;
+  *Length = sizeof(head) + d->Count * sizeof(SD_Index_Entry_t) + d->Names_size;
+  uint8_t *buf = (uint8_t *)malloc(*Length);
+  if (buf == NULL)
+    return NULL;
+  memcpy(buf, &head, sizeof(head));
+  memcpy(buf + sizeof(head), d->Entries, d->Count * sizeof(SD_Index_Entry_t));
+  memcpy(buf + sizeof(head) + d->Count * sizeof(SD_Index_Entry_t), d->Names, d->Names_size);
+  return buf;
+}
+
+// Checks everything the lookups rely on, so a damaged file is scanned over instead of read out of bounds
+bool SD_Index_Deserialize(SD_Index_Dir_t *d, const uint8_t *Buf, uint32_t Length, SD_Index_Header_t *h)
+{
+  memset(d, 0, sizeof(*d));
+  if (Length < sizeof(*h))
+    return false;
+  memcpy(h, Buf, sizeof(*h));
+  uint32_t entries_size = h->Count * sizeof(SD_Index_Entry_t);
+  if (h->Magic != SD_INDEX_MAGIC || h->Version != SD_INDEX_VERSION || h->Entry_size != sizeof(SD_Index_Entry_t) ||
+      h->Count > Length / sizeof(SD_Index_Entry_t) || Length != sizeof(*h) + entries_size + h->Names_size)
+    return false;
+  d->Count = h->Count;
+  d->Names_size = h->Names_size;
+  d->Entries = (SD_Index_Entry_t *)malloc(entries_size ? entries_size : 1);
+  d->Names = (char *)malloc(h->Names_size ? h->Names_size : 1);
+  bool ok = d->Entries && d->Names && (h->Count == 0 || (h->Names_size && Buf[Length - 1] == '\0'));
+  if (ok) {
+    memcpy(d->Entries, Buf + sizeof(*h), entries_size);
+    memcpy(d->Names, Buf + sizeof(*h) + entries_size, h->Names_size);
+  }
+  for (uint32_t i = 0; ok && i < d->Count; i++) {
+    const SD_Index_Entry_t *e = &d->Entries[i];
+    ok = e->Name < d->Names_size && e->Ext <= strlen(Index_Name(d, i)) &&
+         (i == 0 || strcasecmp(Index_Name(d, i - 1), Index_Name(d, i)) < 0);
+  }
+  if (!ok || !Index_Tables(d)) {
+    SD_Index_Free(d);
+    return false;
+  }
+  return true;
+}
+
+/********************************************************** Directories **********************************************************/
+typedef struct {
+  char           Path[SD_INDEX_PATH_MAX];                       // Card path, "" for the root
+  SD_Index_Dir_t Index;
+  uint32_t       Used;                                          // Index_Clock at the last use, for LRU
+  bool           Valid;
+} Index_Slot_t;
+
+static Index_Slot_t      Index_Slots[SD_INDEX_DIRS];
+static uint32_t          Index_Clock = 0;
+static SemaphoreHandle_t Index_Lock = NULL;                     // Slots, statistics and Index_Info
+static FILINFO           Index_Info;                            // ~270 bytes, kept off the callers' stacks
+static SD_Index_Stats_t  Index_Stats;
+
+// "/log", "log/", "/sdcard/log" -> "/log"; "/" and "/sdcard" -> ""
+static bool Index_Path(char *Out, const char *Dir)
+{
+  size_t root = strlen(SD_INDEX_ROOT);
+  if (strncmp(Dir, SD_INDEX_ROOT, root) == 0 && (Dir[root] == '/' || Dir[root] == '\0'))
+    Dir += root;
+  while (*Dir == '/')
+    Dir++;
+  size_t len = strlen(Dir);
+  while (len && Dir[len - 1] == '/')
+    len--;
+  if (len + 2 > SD_INDEX_PATH_MAX)
+    return false;
+  Out[0] = '\0';
+  if (len) {
+    Out[0] = '/';
+    memcpy(Out + 1, Dir, len);
+    Out[len + 1] = '\0';
+  }
+  return true;
+}
+
+static void Index_Fatfs_Path(char *Out, size_t Size, const char *Path, const char *Name)
+{
+  snprintf(Out, Size, "%s%s/%s", SD_INDEX_DRIVE, Path, Name);
+}
+
+static bool Index_Volume(uint32_t *Free, uint32_t *Total)
+{
+  FATFS *fs;
+  DWORD free_clusters;
+  if (f_getfree(SD_INDEX_DRIVE, &free_clusters, &fs) != FR_OK)
+    return false;
+  *Free = free_clusters;
+  *Total = fs->n_fatent - 2;
+  return true;
+}
+
+static void Index_Entry(SD_Index_Entry_t *e, const FILINFO *fno)
+{
+  memset(e, 0, sizeof(*e));
+  e->Size = (uint32_t)fno->fsize;
+  e->Mtime = (uint32_t)fno->fdate << 16 | fno->ftime;
+  e->Is_dir = (fno->fattrib & AM_DIR) != 0;
+}
+
+static bool Index_Scan(Index_Slot_t *s)
+{
+  char path[SD_INDEX_PATH_MAX + 8];
+  FF_DIR dir;
+  Index_Fatfs_Path(path, sizeof(path), s->Path, "");
+  if (f_opendir(&dir, path) != FR_OK)
+    return false;
+  int64_t t0 = esp_timer_get_time();
+  uint32_t count = 0, cap = 64, names_size = 0, names_cap = 2048;
+  SD_Index_Entry_t *entries = (SD_Index_Entry_t *)malloc(cap * sizeof(SD_Index_Entry_t));
+  char *names = (char *)malloc(names_cap);
+  bool ok = entries && names;
+  while (ok && f_readdir(&dir, &Index_Info) == FR_OK && Index_Info.fname[0]) {
+    if (strcasecmp(Index_Info.fname, SD_INDEX_FILE) == 0)
+      continue;
+    size_t len = strlen(Index_Info.fname) + 1;
+    if (count == cap) {
+      SD_Index_Entry_t *grown = (SD_Index_Entry_t *)realloc(entries, 2 * cap * sizeof(SD_Index_Entry_t));
+      ok = grown != NULL;
+      entries = grown ? grown : entries;
+      cap *= 2;
+    }
+    if (ok && names_size + len > names_cap) {
+      char *grown = (char *)realloc(names, 2 * names_cap + len);
+      ok = grown != NULL;
+      names = grown ? grown : names;
+      names_cap = 2 * names_cap + len;
+    }
+    if (!ok)
+      break;
+    Index_Entry(&entries[count], &Index_Info);
+    entries[count++].Name = names_size;
+    memcpy(names + names_size, Index_Info.fname, len);
+    names_size += len;
+  }
+  f_closedir(&dir);
+  if (!ok || !SD_Index_Build(&s->Index, entries, count, names, names_size)) {
+    if (ok)
+      SD_Index_Free(&s->Index);
+    else {
+      free(entries);
+      free(names);
+    }
+    printf("SD index: no memory for %s (%lu entries)\r\n", path, count);
+    return false;
+  }
+  Index_Stats.Scans++;
+  Index_Stats.Scanned += count;
+  Index_Stats.Scan_us += esp_timer_get_time() - t0;
+  return true;
+}
+
+static bool Index_Load(Index_Slot_t *s)
+{
+  char path[SD_INDEX_PATH_MAX + 16];
+  FIL f;
+  UINT n = 0;
+  uint32_t free_clusters, total;
+  Index_Fatfs_Path(path, sizeof(path), s->Path, SD_INDEX_FILE);
+  if (!Index_Volume(&free_clusters, &total) || f_open(&f, path, FA_READ) != FR_OK)
+    return false;
+  int64_t t0 = esp_timer_get_time();
+  uint32_t size = (uint32_t)f_size(&f);
+  uint8_t *buf = (uint8_t *)malloc(size ? size : 1);
+  bool ok = buf && f_read(&f, buf, size, &n) == FR_OK && n == size;
+  f_close(&f);
+  SD_Index_Header_t h;
+  ok = ok && SD_Index_Deserialize(&s->Index, buf, size, &h);
+  free(buf);
+  if (ok && (h.Free_clusters != free_clusters || h.Total_clusters != total)) {
+    SD_Index_Free(&s->Index);
+    Index_Stats.Stale++;
+    return false;
+  }
+  if (ok) {
+    Index_Stats.Loads++;
+    Index_Stats.Load_us += esp_timer_get_time() - t0;
+  }
+  return ok;
+}
+
+// Written twice: the free cluster count it records is only known once the file and its directory entry exist.
+// The second write changes bytes in place and allocates nothing.
+static void Index_Save(Index_Slot_t *s)
+{
+  char path[SD_INDEX_PATH_MAX + 16];
+  SD_Index_Header_t h;
+  FIL f;
+  UINT n = 0;
+  uint32_t length;
+  memset(&h, 0, sizeof(h));
+  uint8_t *buf = SD_Index_Serialize(&s->Index, &h, &length);
+  Index_Fatfs_Path(path, sizeof(path), s->Path, SD_INDEX_FILE);
+  bool ok = buf && f_open(&f, path, FA_WRITE | FA_CREATE_ALWAYS) == FR_OK;
+  if (ok) {
+    ok = f_write(&f, buf, length, &n) == FR_OK && n == length;
+    ok = f_close(&f) == FR_OK && ok;
+  }
+  if (buf)
+    memcpy(&h, buf, sizeof(h));                                 // As serialized, Count and sizes filled in
+  free(buf);
+  ok = ok && Index_Volume(&h.Free_clusters, &h.Total_clusters) && f_open(&f, path, FA_WRITE | FA_OPEN_EXISTING) == FR_OK;
+  if (ok) {
+    ok = f_write(&f, &h, sizeof(h), &n) == FR_OK && n == sizeof(h);
+    ok = f_close(&f) == FR_OK && ok;
+  }
+  if (ok)
+    Index_Stats.Saves++;
+  else
+    printf("SD index: cannot save %s, the directory is scanned again on the next mount\r\n", path);
+}
+
+static Index_Slot_t *Index_Find_Slot(const char *Path)
+{
+  for (int i = 0; i < SD_INDEX_DIRS; i++) {
+    if (Index_Slots[i].Valid && strcasecmp(Index_Slots[i].Path, Path) == 0)
+      return &Index_Slots[i];
+  }
+  return NULL;
+}
+
+// The RAM copy of Dir: as it is, from the saved index, or scanned. NULL: no such directory. Under Index_Lock.
+static Index_Slot_t *Index_Get(const char *Dir, bool Rescan)
+{
+  char path[SD_INDEX_PATH_MAX];
+  if (!Index_Path(path, Dir))
+    return NULL;
+  Index_Slot_t *s = Index_Find_Slot(path);
+  if (s == NULL) {
+    s = &Index_Slots[0];
+    for (int i = 0; i < SD_INDEX_DIRS && s->Valid; i++) {
+      if (!Index_Slots[i].Valid || (int32_t)(Index_Slots[i].Used - s->Used) < 0)
+        s = &Index_Slots[i];
+    }
+    if (s->Valid)
+      SD_Index_Free(&s->Index);
+    s->Valid = false;
+    strcpy(s->Path, path);
+  } else if (Rescan) {
+    SD_Index_Free(&s->Index);
+    s->Valid = false;
+  }
+  if (!s->Valid) {
+    if (Rescan || !Index_Load(s)) {
+      if (!Index_Scan(s))
+        return NULL;
+      Index_Save(s);
+    }
+    s->Valid = true;
+  }
+  s->Used = ++Index_Clock;
+  return s;
+}
+
+static void Index_File(const SD_Index_Dir_t *d, uint32_t i, SD_Index_File_t *File)
+{
+  const SD_Index_Entry_t *e = &d->Entries[i];
+  strncpy(File->Name, Index_Name(d, i), SD_INDEX_NAME_MAX - 1);
+  File->Name[SD_INDEX_NAME_MAX - 1] = '\0';
+  File->Size = e->Size;
+  File->Mtime = e->Mtime;
+  File->Is_dir = e->Is_dir;
+}
+
+/********************************************************** API **********************************************************/
+esp_err_t SD_Index_Init(void)
+{
+  if (Index_Lock)
+    return ESP_OK;
+  Index_Lock = xSemaphoreCreateMutex();
+  return Index_Lock ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+bool SD_Index_Stat(const char *Dir, const char *Name, SD_Index_File_t *File)
+{
+  if (Index_Lock == NULL)
+    return false;
+  xSemaphoreTake(Index_Lock, portMAX_DELAY);
+  Index_Stats.Lookups++;
+  Index_Slot_t *s = Index_Get(Dir, false);
+  int32_t i = s ? SD_Index_Find(&s->Index, Name) : -1;
+  if (i >= 0 && File)
+    Index_File(&s->Index, (uint32_t)i, File);
+  xSemaphoreGive(Index_Lock);
+  return i >= 0;
+}
+
+int32_t SD_Index_Count(const char *Dir, const char *Ext)
+{
+  if (Index_Lock == NULL)
+    return -1;
+  xSemaphoreTake(Index_Lock, portMAX_DELAY);
+  Index_Slot_t *s = Index_Get(Dir, false);
+  uint32_t first;
+  int32_t n = s == NULL ? -1 : Ext ? (int32_t)SD_Index_Find_Ext(&s->Index, Ext, &first) : (int32_t)s->Index.Count;
+  xSemaphoreGive(Index_Lock);
+  return n;
+}
+
+uint32_t SD_Index_List(const char *Dir, const char *Ext, uint32_t First, SD_Index_File_t *Files, uint32_t Max)
+{
+  if (Index_Lock == NULL)
+    return 0;
+  xSemaphoreTake(Index_Lock, portMAX_DELAY);
+  Index_Stats.Listings++;
+  Index_Slot_t *s = Index_Get(Dir, false);
+  uint32_t n = 0;
+  if (s) {
+    const SD_Index_Dir_t *d = &s->Index;
+    uint32_t start = 0, count = d->Count;
+    if (Ext)
+      count = SD_Index_Find_Ext(d, Ext, &start);
+    for (uint32_t k = First; k < count && n < Max; k++)
+      Index_File(d, Ext ? d->By_ext[start + k] : k, &Files[n++]);
+  }
+  xSemaphoreGive(Index_Lock);
+  return n;
+}
+
+void SD_Index_Note(const char *Path)
+{
+  char dir[SD_INDEX_PATH_MAX + 8], fatfs[SD_INDEX_PATH_MAX + SD_INDEX_NAME_MAX + 8];
+  const char *name = strrchr(Path, '/');
+  if (Index_Lock == NULL || name == NULL || (size_t)(name - Path) >= sizeof(dir))
+    return;
+  memcpy(dir, Path, name - Path);
+  dir[name - Path] = '\0';
+  name++;
+  xSemaphoreTake(Index_Lock, portMAX_DELAY);
+  char path[SD_INDEX_PATH_MAX];
+  Index_Slot_t *s = Index_Path(path, dir) ? Index_Find_Slot(path) : NULL;
+  if (s) {                                                      // Directories not in RAM are checked when next used
+    SD_Index_Entry_t e;
+    Index_Fatfs_Path(fatfs, sizeof(fatfs), s->Path, name);
+    bool exists = f_stat(fatfs, &Index_Info) == FR_OK;
+    if (exists)
+      Index_Entry(&e, &Index_Info);
+    if (!SD_Index_Put(&s->Index, name, exists ? &e : NULL)) {
+      SD_Index_Free(&s->Index);                                 // Out of memory: the next use scans again
+      s->Valid = false;
+    }
+    Index_Stats.Notes++;
+  }
+  xSemaphoreGive(Index_Lock);
+}
+
+esp_err_t SD_Index_Rebuild(const char *Dir)
+{
+  if (Index_Lock == NULL)
+    return ESP_ERR_INVALID_STATE;
+  xSemaphoreTake(Index_Lock, portMAX_DELAY);
+  Index_Slot_t *s = Index_Get(Dir, true);
+  xSemaphoreGive(Index_Lock);
+  return s ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+void SD_Index_Drop(void)
+{
+  if (Index_Lock == NULL)
+    return;
+  xSemaphoreTake(Index_Lock, portMAX_DELAY);
+  for (int i = 0; i < SD_INDEX_DIRS; i++) {
+    if (Index_Slots[i].Valid)
+      SD_Index_Free(&Index_Slots[i].Index);
+    Index_Slots[i].Valid = false;
+  }
+  xSemaphoreGive(Index_Lock);
+}
+
+void SD_Index_Get_Stats(SD_Index_Stats_t *stats)
+{
+  if (Index_Lock)
+    xSemaphoreTake(Index_Lock, portMAX_DELAY);
+  *stats = Index_Stats;
+  if (Index_Lock)
+    xSemaphoreGive(Index_Lock);
+}
+
+void SD_Index_Print_Stats(void)
+{
+  SD_Index_Stats_t st;
+  SD_Index_Get_Stats(&st);
+  printf("SD index: %lu scans (%lu entries, %llu ms), %lu loads (%llu ms), %lu stale, %lu saves, %lu lookups, "
+         "%lu listings, %lu notes\r\n", st.Scans, st.Scanned, st.Scan_us / 1000, st.Loads, st.Load_us / 1000, st.Stale,
+         st.Saves, st.Lookups, st.Listings, st.Notes);
+  for (int i = 0; i < SD_INDEX_DIRS; i++) {
+    if (Index_Slots[i].Valid)
+      printf("SD index: %-32s %lu entries\r\n", Index_Slots[i].Path[0] ? Index_Slots[i].Path : "/",
+             Index_Slots[i].Index.Count);
+  }
+}
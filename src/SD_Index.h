@@ -0,0 +1,103 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/****************************************************** SD directory index ******************************************************/
+// Names, sizes and modification times of the files in a directory, so that finding a file or listing the files of
+// one extension does not walk the directory on the card. A directory is read once, straight from its FAT entries
+// with f_readdir(): no open() and stat() per file, each of which scans the directory again from the start, which is
+// what makes openNextFile() loops slow. The index is kept in RAM and saved next to the files. On later mounts the
+// saved index is taken as it is while the volume's free and total cluster counts are what they were when it was
+// saved. Checking more would mean reading the directory, which is what the saved index avoids. So changes made
+// elsewhere (a PC) that take and free no cluster, or as many as they free, are missed, and File_Search() and the
+// listings return what the saved index holds:
+//   - renames, and moves between directories;
+//   - creating or deleting zero-length files;
+//   - a file growing or shrinking within its last cluster, or rewritten at the same cluster count, and time stamps;
+//   - any mix of deletes and writes whose clusters add up, e.g. a file replaced by another of the same cluster count.
+// SD_Index_Rebuild() rescans a directory after such changes. Files this firmware creates or writes are announced
+// with SD_Index_Note(), so its own changes are always seen. Names compare case-insensitively, like
+// FAT. Directories are card paths as SD_MMC takes them ("/log", "/" for the root); "/sdcard/log" works as well.
+#define SD_INDEX_FILE            ".sdindex"               // Saved index, in the directory it describes
+#define SD_INDEX_DIRS            8                        // Directories kept in RAM, least recently used replaced
+#define SD_INDEX_NAME_MAX        100                      // Names returned are cut to this, as File_Name[][100] was
+#define SD_INDEX_PATH_MAX        96                       // Directory paths
+#define SD_INDEX_DRIVE           "0:"                     // FATFS volume of SD_MMC, the only FAT mount here
+#define SD_INDEX_ROOT            "/sdcard"                // Its VFS mount point, see SD_Init()
+#define SD_INDEX_MAGIC           0x58444953               // "SIDX"
+#define SD_INDEX_VERSION         1
+
+typedef struct {
+  char     Name[SD_INDEX_NAME_MAX];
+  uint32_t Size;
+  uint32_t Mtime;                                         // FAT date << 16 | FAT time
+  bool     Is_dir;
+} SD_Index_File_t;
+
+typedef struct {
+  uint32_t Scans;                                         // Directories read from the card
+  uint32_t Scanned;                                       // Entries those held
+  uint64_t Scan_us;
+  uint32_t Loads;                                         // Saved indexes taken as they were
+  uint32_t Stale;                                         // Saved indexes the volume had changed under
+  uint64_t Load_us;
+  uint32_t Saves;
+  uint32_t Lookups;
+  uint32_t Listings;
+  uint32_t Notes;
+} SD_Index_Stats_t;
+
+esp_err_t SD_Index_Init(void);                            // After SD_Init(). Directories are indexed on first use
+bool      SD_Index_Stat(const char *Dir, const char *Name, SD_Index_File_t *File);  // O(1). File may be NULL
+int32_t   SD_Index_Count(const char *Dir, const char *Ext);   // Ext NULL: every entry. -1: no such directory
+uint32_t  SD_Index_List(const char *Dir, const char *Ext, uint32_t First, SD_Index_File_t *Files, uint32_t Max);
+                                                          // Files First.. of Count(), sorted by name; returns how many
+void      SD_Index_Note(const char *Path);                // A file was created, written or removed; any task
+esp_err_t SD_Index_Rebuild(const char *Dir);
+void      SD_Index_Drop(void);                            // Forget the RAM copies (benchmarks)
+void      SD_Index_Get_Stats(SD_Index_Stats_t *stats);
+void      SD_Index_Print_Stats(void);
+
+/****************************************************** Index core ******************************************************/
+// One directory's index; no FATFS or RTOS dependencies (also used by the host bench in sim/bench)
+typedef struct {
+  uint32_t Name;                                          // Offset into the names
+  uint32_t Size;
+  uint32_t Mtime;
+  uint16_t Ext;                                           // Offset of the extension in the name, after the dot;
+                                                          // the name's length if there is none
+  uint8_t  Is_dir;
+  uint8_t  Reserved;
+} SD_Index_Entry_t;
+
+typedef struct {
+  uint32_t          Count;
+  SD_Index_Entry_t *Entries;                              // Sorted by name
+  char             *Names;                                // NUL-terminated, one after the other
+  uint32_t          Names_size;
+  uint32_t         *Hash;                                 // Entry + 1 per slot, 0: empty. Open addressing
+  uint32_t          Hash_size;                            // Power of two, at least twice Count
+  uint32_t         *By_ext;                               // Entry numbers sorted by extension, then name
+} SD_Index_Dir_t;
+
+// On the card: this header, the entries, the names
+typedef struct {
+  uint32_t Magic;
+  uint16_t Version;
+  uint16_t Entry_size;
+  uint32_t Count;
+  uint32_t Names_size;
+  uint32_t Free_clusters;                                 // Of the volume after the save, the validity check
+  uint32_t Total_clusters;
+  uint32_t Reserved[2];
+} SD_Index_Header_t;
+
+// Takes Entries and Names (malloc()ed, Entries in any order, Name and Size and Mtime and Is_dir filled in)
+bool     SD_Index_Build(SD_Index_Dir_t *d, SD_Index_Entry_t *Entries, uint32_t Count, char *Names, uint32_t Names_size);
+void     SD_Index_Free(SD_Index_Dir_t *d);
+int32_t  SD_Index_Find(const SD_Index_Dir_t *d, const char *Name);   // Entry number, -1: not there
+uint32_t SD_Index_Find_Ext(const SD_Index_Dir_t *d, const char *Ext, uint32_t *First);  // Count; By_ext[First..]
+bool     SD_Index_Put(SD_Index_Dir_t *d, const char *Name, const SD_Index_Entry_t *e);  // e NULL: remove
+uint8_t *SD_Index_Serialize(const SD_Index_Dir_t *d, const SD_Index_Header_t *h, uint32_t *Length);  // malloc()ed
+bool     SD_Index_Deserialize(SD_Index_Dir_t *d, const uint8_t *Buf, uint32_t Length, SD_Index_Header_t *h);
@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/****************************************************** Seqlock ******************************************************/
+// Lock-free publishing of a value from one writer at a time to any number of readers, for results too large to store
+// atomically (attitude, clock model, spectra). Two slots and a sequence number:
+//   - the writer fills slot Seqlock_Write_Slot() while readers copy the other one, then Seqlock_Publish() bumps the
+//     sequence number, which flips the slots;
+//   - a reader copies slot seq & 1 and keeps the copy only if seq is still the same after it. Once the writer has
+//     published seq + 1 its next write goes into the slot being read, so any publish during the copy means retry.
+// A reader never blocks the writer and never returns a torn copy; it retries only when a publish lands during its
+// own copy. Slots are laid out contiguously, Size bytes each.
+#define SEQLOCK_TRIES     8                               // Copies a reader attempts before giving up
+
+typedef struct {
+  uint32_t Seq;                                           // Publishes so far, 0: nothing to read yet
+} Seqlock_t;
+
+// Writer side, one writer at a time (one task, or under a lock): the slot to fill now
+static inline uint32_t Seqlock_Write_Slot(Seqlock_t *Lock)
+{
+  // Orders the previous publish before the writes into the slot readers may still be copying
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  return (Lock->Seq + 1) & 1;
+}
+
+static inline void Seqlock_Publish(Seqlock_t *Lock)
+{
+  __atomic_store_n(&Lock->Seq, Lock->Seq + 1, __ATOMIC_RELEASE);
+}
+
+// Copies the newest published slot to Out. false: nothing published yet, or publishes kept overtaking the copy
+static inline bool Seqlock_Read(const Seqlock_t *Lock, const void *Slots, size_t Size, void *Out)
+{
+  for (int tries = 0; tries < SEQLOCK_TRIES; tries++) {
+    uint32_t seq = __atomic_load_n(&Lock->Seq, __ATOMIC_ACQUIRE);
+    if (seq == 0)
+      return false;
+    memcpy(Out, (const uint8_t *)Slots + (seq & 1) * Size, Size);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);                    // The copy is done before seq is looked at again
+    if (__atomic_load_n(&Lock->Seq, __ATOMIC_RELAXED) == seq)
+      return true;
+  }
+  return false;
+}
@@ -0,0 +1,369 @@
+#include <Arduino.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "System_Time.h"
+#include "Seqlock.h"
+
+/********************************************************** Calendar **********************************************************/
+// Days from civil and back (H. Hinnant's algorithms), proleptic Gregorian, no time zone
+int64_t System_Time_From_Datetime(const datetime_t *Time)
+{
+  int32_t y = Time->year - (Time->month <= 2);
+  int32_t era = (y >= 0 ? y : y - 399) / 400;
+  uint32_t yoe = (uint32_t)(y - era * 400);
+  uint32_t doy = (153 * (Time->month + (Time->month > 2 ? -3 : 9)) + 2) / 5 + Time->day - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  int64_t days = (int64_t)era * 146097 + doe - 719468;
+  return days * 86400 + Time->hour * 3600 + Time->minute * 60 + Time->second;
+}
+
+void System_Time_To_Datetime(int64_t Seconds, datetime_t *Time)
+{
+  int64_t days = Seconds >= 0 ? Seconds / 86400 : (Seconds - 86399) / 86400;
+  uint32_t sod = (uint32_t)(Seconds - days * 86400);
+  Time->dotw = (uint8_t)((days % 7 + 11) % 7);                  // 1970-01-01 was a Thursday
+  days += 719468;
+  int32_t era = (int32_t)((days >= 0 ? days : days - 146096) / 146097);
+  uint32_t doe = (uint32_t)(days - (int64_t)era * 146097);
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  uint32_t mp = (5 * doy + 2) / 153;
+  Time->day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+  Time->month = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+  Time->year = (uint16_t)(yoe + era * 400 + (Time->month <= 2));
+  Time->hour = sod / 3600;
+  Time->minute = sod / 60 % 60;
+  Time->second = sod % 60;
+}
+
+/********************************************************** Clock model **********************************************************/
+// Wall time = Wall_us + d + d * Ppb / 1e9, d being the esp_timer time since Base_us. Published like IMU_Fusion's
+// attitude, through a seqlock (src/Seqlock.h); Time_Lock keeps the writers one at a time.
+typedef struct {
+  int64_t Base_us;
+  int64_t Wall_us;
+  int32_t Ppb;
+} Time_Model_t;
+
+static Time_Model_t Time_Slot[2];
+static Seqlock_t    Time_Published = {0};                       // Seq 0: no model yet
+
+static int64_t Time_Eval(const Time_Model_t *m, int64_t Now_us)
+{
+  int64_t d = Now_us - m->Base_us;
+  return m->Wall_us + d + d * m->Ppb / 1000000000LL;
+}
+
+static void Time_Publish(const Time_Model_t *m)
+{
+  Time_Slot[Seqlock_Write_Slot(&Time_Published)] = *m;
+  Seqlock_Publish(&Time_Published);
+}
+
+static bool Time_Model(Time_Model_t *m)
+{
+  return Seqlock_Read(&Time_Published, Time_Slot, sizeof(Time_Model_t), m);
+}
+
+int64_t System_Time_us(void)
+{
+  Time_Model_t m;
+  if (!Time_Model(&m))
+    return 0;
+  return Time_Eval(&m, esp_timer_get_time());
+}
+
+bool System_Time_Get(datetime_t *Time, uint32_t *Us)
+{
+  int64_t now = System_Time_us();
+  if (now <= 0)
+    return false;
+  System_Time_To_Datetime(now / 1000000, Time);
+  if (Us)
+    *Us = (uint32_t)(now % 1000000);
+  return true;
+}
+
+/********************************************************** Discipline **********************************************************/
+static SemaphoreHandle_t   Time_Lock = NULL;                    // Model writers: the discipline and System_Time_Set()
+static SemaphoreHandle_t   Time_Wake = NULL;                    // Given by System_Time_Set() and the RTC interrupt
+static volatile int64_t    Time_Edge_us = 0;                    // esp_timer time of the last INT falling edge
+static volatile uint32_t   Time_Generation = 0;                 // Bumped by System_Time_Set(): drop measurements across it
+static System_Time_Stats_t Time_Stats;
+static portMUX_TYPE        Time_Stats_Lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Owned by the discipline
+static int32_t  Time_Freq_ppb = 0;
+static bool     Time_Freq_valid = false;
+static int64_t  Time_Prev_edge_us = 0;                          // Last fine measurement, 0: none
+static int64_t  Time_Prev_wall_us = 0;
+static uint32_t Time_Resolution_us = 500000;                    // Of the last measurement, 500 ms: boot read only
+static uint32_t Time_Error_us = 0;                              // Expected model error at the next measurement
+static uint32_t Time_Interval_s = SYSTIME_SYNC_MIN_S;
+static int64_t  Time_Next_us = 0;                               // Next measurement due
+
+static void IRAM_ATTR Time_Int_ISR(void)
+{
+  BaseType_t woken = pdFALSE;
+  Time_Edge_us = esp_timer_get_time();
+  xSemaphoreGiveFromISR(Time_Wake, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+static bool Time_Read_Rtc(datetime_t *Time, int64_t *Start_us, int64_t *End_us)
+{
+  uint8_t regs[7];
+  *Start_us = esp_timer_get_time();
+  esp_err_t ret = I2C_Read(PCF85063_ADDRESS, RTC_SECOND_ADDR, regs, sizeof(regs));
+  *End_us = esp_timer_get_time();
+  portENTER_CRITICAL(&Time_Stats_Lock);
+  Time_Stats.Reads++;
+  portEXIT_CRITICAL(&Time_Stats_Lock);
+  if (ret != ESP_OK)
+    return false;
+  PCF85063_Decode_Time(regs, Time);
+  return true;
+}
+
+// Reads the time until the seconds change: back to back for Window_us, then every SYSTIME_HUNT_COARSE_MS, for at
+// most 1.2 s. The RTC latches its registers somewhere inside each read, so the rollover lies between the start of the
+// last read showing the old second and the end of the first one showing the new second. A read the bus manager had
+// to retry widens that bracket, and the caller sees it in the resolution.
+static bool Time_Hunt(uint32_t Window_us, int64_t *Edge_us, int64_t *Wall_us, uint32_t *Resolution_us)
+{
+  datetime_t prev, cur;
+  int64_t prev_us = 0, cur_us, end_us, start = esp_timer_get_time();
+  bool have_prev = false;
+  while (esp_timer_get_time() - start < 1200000) {
+    if (!Time_Read_Rtc(&cur, &cur_us, &end_us)) {
+      if (Window_us)
+        return false;                                           // The rollover may have gone by unseen: next one
+      have_prev = false;
+      continue;
+    }
+    if (have_prev && cur.second != prev.second) {
+      *Edge_us = (prev_us + end_us) / 2;
+      *Resolution_us = (uint32_t)(end_us - prev_us) / 2;
+      *Wall_us = System_Time_From_Datetime(&cur) * 1000000;
+      return true;
+    }
+    prev = cur;
+    prev_us = cur_us;
+    have_prev = true;
+    if (cur_us - start >= Window_us)
+      vTaskDelay(pdMS_TO_TICKS(SYSTIME_HUNT_COARSE_MS));
+  }
+  return false;
+}
+
+// Applies one measurement. Returns false if it was dropped: taken across a System_Time_Set(), or too coarse to say
+// more than the model already does.
+static bool Time_Update(int64_t Edge_us, int64_t Wall_us, uint32_t Resolution_us, uint32_t Generation)
+{
+  xSemaphoreTake(Time_Lock, portMAX_DELAY);
+  Time_Model_t m;
+  Time_Model(&m);
+  int64_t now = esp_timer_get_time();
+  int64_t offset = Time_Eval(&m, Edge_us) - Wall_us;
+  bool fine = Resolution_us < SYSTIME_HUNT_MARGIN_US;
+  bool step = !Time_Stats.Synced || llabs(offset) > SYSTIME_STEP_US;
+  if (Generation != Time_Generation || (!fine && Time_Stats.Synced && llabs(offset) <= Resolution_us)) {
+    xSemaphoreGive(Time_Lock);
+    return false;
+  }
+
+  if (step) {
+    m.Base_us = Edge_us;                                        // Straight onto the measurement, may go backwards
+    m.Wall_us = Wall_us;
+    m.Ppb = Time_Freq_ppb;
+    Time_Interval_s = Time_Stats.Interrupt ? SYSTIME_INT_INTERVAL_S : SYSTIME_SYNC_MIN_S;
+  } else {
+    if (fine && Time_Prev_edge_us) {
+      // Both crystals over the whole interval: what the RTC counted against what esp_timer counted
+      int64_t esp = Edge_us - Time_Prev_edge_us, wall = Wall_us - Time_Prev_wall_us;
+      int32_t measured = (int32_t)((wall - esp) * 1000000000LL / esp);
+      Time_Freq_ppb = Time_Freq_valid ? Time_Freq_ppb + (measured - Time_Freq_ppb) / 4 : measured;
+      Time_Freq_valid = true;
+    }
+    // Continuous at now, then slewed so the offset is gone by the next measurement
+    int64_t ppb = Time_Freq_ppb - offset * 1000 / Time_Interval_s;
+    int64_t max = SYSTIME_SLEW_MAX_PPM * 1000;
+    m.Wall_us = Time_Eval(&m, now);
+    m.Base_us = now;
+    m.Ppb = (int32_t)(ppb > max ? max : ppb < -max ? -max : ppb);
+    if (Time_Stats.Interrupt)
+      ;                                                         // The RTC sets the pace
+    else if (llabs(offset) < SYSTIME_TIGHT_US && Time_Freq_valid && Time_Interval_s < SYSTIME_SYNC_MAX_S)
+      Time_Interval_s *= 2;
+    else if (llabs(offset) > 4 * SYSTIME_TIGHT_US && Time_Interval_s > SYSTIME_SYNC_MIN_S)
+      Time_Interval_s /= 2;
+  }
+  Time_Publish(&m);
+  Time_Prev_edge_us = fine ? Edge_us : 0;
+  Time_Prev_wall_us = Wall_us;
+  Time_Resolution_us = Resolution_us;
+  Time_Error_us = Resolution_us + (step ? 0 : (uint32_t)llabs(offset));
+  Time_Next_us = Edge_us + (int64_t)Time_Interval_s * 1000000 - 500000;
+  xSemaphoreGive(Time_Lock);
+
+  portENTER_CRITICAL(&Time_Stats_Lock);
+  if (step && Time_Stats.Synced)
+    Time_Stats.Steps++;
+  else if (!step && fine && Time_Freq_valid && llabs(offset) > llabs(Time_Stats.Max_offset_us))
+    Time_Stats.Max_offset_us = (int32_t)offset;
+  Time_Stats.Synced = true;
+  Time_Stats.Edges++;
+  Time_Stats.Last_offset_us = (int32_t)(offset > INT32_MAX ? INT32_MAX : offset < -INT32_MAX ? -INT32_MAX : offset);
+  Time_Stats.Interval_s = Time_Interval_s;
+  Time_Stats.Freq_ppm = Time_Freq_ppb / 1000.0f;
+  portEXIT_CRITICAL(&Time_Stats_Lock);
+  return true;
+}
+
+// INT pulses as the seconds roll over to 00 and 30: the ISR has the edge time, one read tells which second it began
+static bool Time_Discipline_Int(void)
+{
+  if (xSemaphoreTake(Time_Wake, pdMS_TO_TICKS((SYSTIME_INT_INTERVAL_S + 1) * 1000)) != pdTRUE) {
+    printf("System time: no RTC interrupt, measuring by polling\r\n");
+    detachInterrupt(PCF85063_INT_PIN);
+    portENTER_CRITICAL(&Time_Stats_Lock);
+    Time_Stats.Interrupt = false;
+    portEXIT_CRITICAL(&Time_Stats_Lock);
+    Time_Interval_s = SYSTIME_SYNC_MIN_S;
+    Time_Next_us = esp_timer_get_time();
+    return false;
+  }
+  int64_t edge = Time_Edge_us, start, end;
+  uint32_t generation = Time_Generation;
+  datetime_t t;
+  if (edge == 0 || !Time_Read_Rtc(&t, &start, &end) || end - edge > 500000)
+    return false;                                               // Not a pulse (a System_Time_Set() wake) or read too late
+  Time_Edge_us = 0;
+  return Time_Update(edge, System_Time_From_Datetime(&t) * 1000000, 50, generation);
+}
+
+/**
+ * One rollover measurement, sleeping until it is due. The discipline task calls this in a loop; without the task
+ * (host simulation) call it directly.
+ * @return false when nothing was measured: woken by System_Time_Set(), a failed read or no rollover found
+ */
+bool System_Time_Discipline(void)
+{
+  if (Time_Stats.Interrupt && Time_Stats.Synced)
+    return Time_Discipline_Int();
+
+  int64_t now = esp_timer_get_time();
+  uint32_t window = 0;
+  int64_t wake = now;
+  Time_Model_t m;
+  if (Time_Resolution_us < 100000 && Time_Model(&m)) {
+    // The first rollover after Time_Next_us according to the model, with a window around it that covers the model's
+    // expected error
+    int64_t due = Time_Next_us > now ? Time_Next_us : now;
+    int64_t wall = Time_Eval(&m, due);
+    int64_t to_edge = 1000000 - wall % 1000000;
+    int64_t edge = due + to_edge - to_edge * m.Ppb / 1000000000LL;
+    uint32_t margin = SYSTIME_HUNT_MARGIN_US + Time_Error_us;
+    if (margin > 400000)
+      margin = 400000;
+    wake = edge - margin;
+    window = 2 * margin;
+  }
+  if (wake > now + 1000) {
+    TickType_t ticks = (TickType_t)((wake - now) / 1000 / portTICK_PERIOD_MS);
+    if (ticks && xSemaphoreTake(Time_Wake, ticks) == pdTRUE)
+      return false;                                             // System_Time_Set(): start over from the new time
+  }
+
+  uint32_t generation = Time_Generation, resolution;
+  int64_t edge, wall, start = esp_timer_get_time();
+  bool found = Time_Hunt(window, &edge, &wall, &resolution);
+  if (!found || (edge - start < window && resolution >= SYSTIME_HUNT_MARGIN_US) ||
+      !Time_Update(edge, wall, resolution, generation)) {
+    Time_Next_us = esp_timer_get_time() + 1000000;              // Bus trouble: try again on the next rollover
+    return false;
+  }
+  return true;
+}
+
+/********************************************************** Public API **********************************************************/
+static TaskHandle_t Time_Task = NULL;
+
+static void System_Time_Task(void *parameter)
+{
+  while (1)
+    System_Time_Discipline();
+}
+
+/**
+ * Start the clock from one RTC read (to within a second) and the task that disciplines it.
+ * @return ESP_FAIL if the RTC cannot be read: System_Time_us() stays 0
+ */
+esp_err_t System_Time_Init(void)
+{
+  if (Time_Lock)
+    return ESP_OK;
+  datetime_t t;
+  int64_t start, end;
+  if (!Time_Read_Rtc(&t, &start, &end)) {
+    printf("System time: RTC not readable\r\n");
+    return ESP_FAIL;
+  }
+  Time_Lock = xSemaphoreCreateMutex();
+  Time_Wake = xSemaphoreCreateBinary();
+  Time_Model_t m = {start, System_Time_From_Datetime(&t) * 1000000 + 500000, 0};   // Middle of the second read
+  Time_Publish(&m);
+  Time_Next_us = start;
+
+  if (PCF85063_INT_PIN >= 0 && PCF85063_Set_Minute_Interrupt(RTC_CTRL_2_HMI) == ESP_OK) {
+    pinMode(PCF85063_INT_PIN, INPUT_PULLUP);                    // Open drain
+    attachInterrupt(PCF85063_INT_PIN, Time_Int_ISR, FALLING);
+    Time_Stats.Interrupt = true;
+  }
+  if (xTaskCreatePinnedToCore(System_Time_Task, "System time", SYSTIME_TASK_STACK, NULL, SYSTIME_TASK_PRIORITY,
+                              &Time_Task, SYSTIME_TASK_CORE) != pdPASS)
+    printf("System time: task creation failed, call System_Time_Discipline()\r\n");
+  return ESP_OK;
+}
+
+/**
+ * Set the RTC and step the clock. Writing the seconds restarts the RTC's prescaler, so the clock is exact from the
+ * write on; the next measurement follows within about a second.
+ */
+esp_err_t System_Time_Set(const datetime_t *Time)
+{
+  if (Time_Lock == NULL)
+    return ESP_ERR_INVALID_STATE;
+  datetime_t t = *Time;
+  int64_t seconds = System_Time_From_Datetime(&t);
+  System_Time_To_Datetime(seconds, &t);                         // Normalised, weekday filled in
+  xSemaphoreTake(Time_Lock, portMAX_DELAY);
+  Time_Generation++;
+  esp_err_t ret = PCF85063_Set_All(t);
+  int64_t now = esp_timer_get_time();
+  if (ret == ESP_OK) {
+    Time_Model_t m = {now, seconds * 1000000, Time_Freq_ppb};
+    Time_Publish(&m);
+  }
+  if (ret == ESP_OK) {
+    Time_Prev_edge_us = 0;
+    Time_Resolution_us = 0;
+    Time_Error_us = 0;
+    Time_Interval_s = SYSTIME_SYNC_MIN_S;
+    Time_Next_us = now;
+  }
+  xSemaphoreGive(Time_Lock);
+  if (ret == ESP_OK)
+    xSemaphoreGive(Time_Wake);
+  return ret;
+}
+
+void System_Time_Get_Stats(System_Time_Stats_t *stats)
+{
+  portENTER_CRITICAL(&Time_Stats_Lock);
+  *stats = Time_Stats;
+  portEXIT_CRITICAL(&Time_Stats_Lock);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "RTC_PCF85063.h"
+
+/****************************************************** System time ******************************************************/
+// Wall-clock time kept by esp_timer and disciplined against the PCF85063, so reading the time costs no I2C.
+// The RTC is read once at boot. After that a low-priority task measures when the RTC's seconds roll over:
+//   - with PCF85063_INT_PIN wired, from the half-minute interrupt pulse, one register read per 30 s;
+//   - without it, by reading the seconds back to back for a few milliseconds around the predicted rollover.
+// Each measurement corrects the offset by slewing and tracks the frequency difference between the esp_timer and
+// RTC crystals. Readers use a double-buffered clock model and never take a lock.
+// Times are microseconds since 1970-01-01 on the RTC's calendar (whatever zone the RTC was set to).
+#define SYSTIME_SYNC_MIN_S       2                        // First measurements, while the frequency is unknown
+#define SYSTIME_SYNC_MAX_S       64                       // Interval once tracking, without the interrupt
+#define SYSTIME_INT_INTERVAL_S   30                       // Half-minute interrupt
+#define SYSTIME_HUNT_MARGIN_US   2000                     // Polling starts this long before the predicted rollover
+#define SYSTIME_HUNT_COARSE_MS   10                       // Read interval while the rollover time is unknown (boot)
+#define SYSTIME_STEP_US          50000                    // Larger offsets are stepped, smaller ones slewed
+#define SYSTIME_TIGHT_US         250                      // Offset below which the interval is doubled
+#define SYSTIME_SLEW_MAX_PPM     500                      // Limit on the rate correction
+#define SYSTIME_TASK_CORE        0                        // With the other I2C users
+#define SYSTIME_TASK_PRIORITY    1
+#define SYSTIME_TASK_STACK       3072
+
+typedef struct {
+  bool     Synced;                                        // At least one rollover measured
+  bool     Interrupt;                                     // Measuring from the RTC interrupt
+  uint32_t Edges;                                         // Rollovers measured
+  uint32_t Steps;                                         // Times the clock was stepped instead of slewed
+  uint32_t Reads;                                         // RTC register reads since System_Time_Init()
+  uint32_t Interval_s;                                    // Current measurement interval
+  int32_t  Last_offset_us;                                // Clock minus RTC at the last rollover
+  int32_t  Max_offset_us;                                 // Largest |offset| since tracking started
+  float    Freq_ppm;                                      // esp_timer is this much slower than the RTC
+} System_Time_Stats_t;
+
+esp_err_t System_Time_Init(void);                         // After I2C_Init() and PCF85063_Init()
+int64_t   System_Time_us(void);                           // Any context, lock-free. 0 before System_Time_Init()
+bool      System_Time_Get(datetime_t *Time, uint32_t *Us);  // Us: microseconds into that second, may be NULL
+esp_err_t System_Time_Set(const datetime_t *Time);        // Sets the RTC and the clock, dotw is computed
+bool      System_Time_Discipline(void);                   // One measurement, when due. The task's loop body
+void      System_Time_Get_Stats(System_Time_Stats_t *stats);
+int64_t   System_Time_From_Datetime(const datetime_t *Time);          // Seconds since 1970-01-01
+void      System_Time_To_Datetime(int64_t Seconds, datetime_t *Time);
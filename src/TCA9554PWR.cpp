@@ -1,25 +1,60 @@
 #include "TCA9554PWR.h"
 
+/*****************************************************  Shadow registers   ****************************************************/
+// The expander is only ever driven from this file, so the output and config registers are mirrored here
+// and pin updates become a single write instead of a read-modify-write over I2C.
+static uint8_t EXIO_Output_Shadow = 0xFF;                       // Power-on value of the output register
+static uint8_t EXIO_Config_Shadow = 0xFF;                       // Power-on value of the config register (all inputs)
+static bool    EXIO_Output_Dirty = false;
+static bool    EXIO_Config_Dirty = false;
+static uint8_t EXIO_Batch_Depth = 0;
+static bool    EXIO_Deferred = false;
+static SemaphoreHandle_t EXIO_Lock = NULL;
+
+static void EXIO_Take(void)
+{
+  if (EXIO_Lock == NULL)                                        // First use is from setup(), before any other task runs
+    EXIO_Lock = xSemaphoreCreateRecursiveMutex();
+  xSemaphoreTakeRecursive(EXIO_Lock, portMAX_DELAY);
+}
+static void EXIO_Give(void)
+{
+  xSemaphoreGiveRecursive(EXIO_Lock);
+}
+// Writes whatever changed. Output goes first so pins switched to output mode come up at their new level.
+static uint8_t EXIO_Write_Dirty(void)
+{
+  uint8_t result = 0;
+  if (EXIO_Output_Dirty) {
+    result |= I2C_Write_EXIO(TCA9554_OUTPUT_REG, EXIO_Output_Shadow);
+    EXIO_Output_Dirty = false;
+  }
+  if (EXIO_Config_Dirty) {
+    result |= I2C_Write_EXIO(TCA9554_CONFIG_REG, EXIO_Config_Shadow);
+    EXIO_Config_Dirty = false;
+  }
+  return result;
+}
+// Called after every shadow change, holds the write back while a batch is open or deferred mode is on
+static uint8_t EXIO_Update(void)
+{
+  if (EXIO_Batch_Depth > 0 || EXIO_Deferred)
+    return 0;
+  return EXIO_Write_Dirty();
+}
+
 /*****************************************************  Operation register REG   ****************************************************/   
 uint8_t I2C_Read_EXIO(uint8_t REG)                             // Read the value of the TCA9554PWR register REG
 {
-  Wire.beginTransmission(TCA9554_ADDRESS);                
-  Wire.write(REG);                                        
-  uint8_t result = Wire.endTransmission();               
-  if (result != 0) {                                     
+  uint8_t bitsStatus = 0;
+  if (I2C_Read(TCA9554_ADDRESS, REG, &bitsStatus, 1) != ESP_OK) {
     printf("Data Transfer Failure !!!\r\n");
   }
-  Wire.requestFrom(TCA9554_ADDRESS, 1);                   
-  uint8_t bitsStatus = Wire.read();                        
   return bitsStatus;                                     
 }
 uint8_t I2C_Write_EXIO(uint8_t REG,uint8_t Data)              // Write Data to the REG register of the TCA9554PWR
 {
-  Wire.beginTransmission(TCA9554_ADDRESS);                
-  Wire.write(REG);                                        
-  Wire.write(Data);                                       
-  uint8_t result = Wire.endTransmission();                  
-  if (result != 0) {    
+  if (I2C_Write(TCA9554_ADDRESS, REG, &Data, 1) != ESP_OK) {
     printf("Data write failure!!!\r\n");
     return -1;
   }
@@ -28,16 +63,27 @@ uint8_t I2C_Write_EXIO(uint8_t REG,uint8_t Data)              // Write Data to t
 /********************************************************** Set EXIO mode **********************************************************/       
 void Mode_EXIO(uint8_t Pin,uint8_t State)                 // Set the mode of the TCA9554PWR Pin. The default is Output mode (output mode or input mode). State: 0= Output mode 1= input mode   
 {
-  uint8_t bitsStatus = I2C_Read_EXIO(TCA9554_CONFIG_REG);      
-  uint8_t Data = (0x01 << (Pin-1)) | bitsStatus;   
-  uint8_t result = I2C_Write_EXIO(TCA9554_CONFIG_REG,Data); 
+  if(Pin > 8 || Pin < 1)
+    return;
+  EXIO_Take();
+  uint8_t Data = State ? (EXIO_Config_Shadow | (0x01 << (Pin-1))) : (EXIO_Config_Shadow & ~(0x01 << (Pin-1)));
+  if (Data != EXIO_Config_Shadow) {
+    EXIO_Config_Shadow = Data;
+    EXIO_Config_Dirty = true;
+  }
+  uint8_t result = EXIO_Update();
+  EXIO_Give();
   if (result != 0) { 
     printf("I/O Configuration Failure !!!\r\n");
   }
 }
 void Mode_EXIOS(uint8_t PinState)                         // Set the mode of the 7 pins from the TCA9554PWR with PinState   
 {
-  uint8_t result = I2C_Write_EXIO(TCA9554_CONFIG_REG,PinState);  
+  EXIO_Take();
+  EXIO_Config_Shadow = PinState;
+  EXIO_Config_Dirty = true;
+  uint8_t result = EXIO_Update();
+  EXIO_Give();
   if (result != 0) {   
     printf("I/O Configuration Failure !!!\r\n");
   }
@@ -50,7 +96,11 @@ uint8_t Read_EXIO(uint8_t Pin)                            // Read the level of t
   return bitStatus;                                  
 }
 uint8_t Read_EXIOS(uint8_t REG = TCA9554_INPUT_REG)       // Read the level of all pins of TCA9554PWR, the default read input level state, want to get the current IO output state, pass the parameter TCA9554_OUTPUT_REG, such as Read_EXIOS(TCA9554_OUTPUT_REG);
-{
+{                  
+  if (REG == TCA9554_OUTPUT_REG)                          // Output and config are served from the shadow, including uncommitted changes
+    return EXIO_Output_Shadow;
+  if (REG == TCA9554_CONFIG_REG)
+    return EXIO_Config_Shadow;
   uint8_t inputBits = I2C_Read_EXIO(REG);                     
   return inputBits;     
 }
@@ -60,12 +110,17 @@ void Set_EXIO(uint8_t Pin,uint8_t State)                  // Sets the level stat
 {
   uint8_t Data;
   if(State < 2 && Pin < 9 && Pin > 0){  
-    uint8_t bitsStatus = Read_EXIOS(TCA9554_OUTPUT_REG);
+    EXIO_Take();
     if(State == 1)                                     
-      Data = (0x01 << (Pin-1)) | bitsStatus; 
-    else if(State == 0)                  
-      Data = (~(0x01 << (Pin-1))) & bitsStatus;      
-    uint8_t result = I2C_Write_EXIO(TCA9554_OUTPUT_REG,Data);  
+      Data = (0x01 << (Pin-1)) | EXIO_Output_Shadow;
+    else
+      Data = (~(0x01 << (Pin-1))) & EXIO_Output_Shadow;
+    if (Data != EXIO_Output_Shadow) {                     // Already at that level: nothing to send
+      EXIO_Output_Shadow = Data;
+      EXIO_Output_Dirty = true;
+    }
+    uint8_t result = EXIO_Update();
+    EXIO_Give();
     if (result != 0) {                         
       printf("Failed to set GPIO!!!\r\n");
     }
@@ -75,7 +130,11 @@ void Set_EXIO(uint8_t Pin,uint8_t State)                  // Sets the level stat
 }
 void Set_EXIOS(uint8_t PinState)                          // Set 7 pins to the PinState state such as :PinState=0x23, 0010 0011 state (the highest bit is not used)
 {
-  uint8_t result = I2C_Write_EXIO(TCA9554_OUTPUT_REG,PinState); 
+  EXIO_Take();
+  EXIO_Output_Shadow = PinState;
+  EXIO_Output_Dirty = true;
+  uint8_t result = EXIO_Update();
+  EXIO_Give();
   if (result != 0) {                  
     printf("Failed to set GPIO!!!\r\n");
   }
@@ -83,11 +142,54 @@ void Set_EXIOS(uint8_t PinState)                          // Set 7 pins to the P
 /********************************************************** Flip EXIO state **********************************************************/  
 void Set_Toggle(uint8_t Pin)                              // Flip the level of the TCA9554PWR Pin
 {
-    uint8_t bitsStatus = Read_EXIO(Pin);                 
+    if(Pin > 8 || Pin < 1)
+      return;
+    EXIO_Take();
+    uint8_t bitsStatus = (EXIO_Output_Shadow >> (Pin-1)) & 0x01;
     Set_EXIO(Pin,(bool)!bitsStatus); 
+    EXIO_Give();
+}
+/********************************************************** Batched updates **********************************************************/
+void EXIO_Batch_Begin(void)                               // Following Set_EXIO/Mode_EXIO calls only update the shadow, batches may nest
+{
+  EXIO_Take();                                            // Held until the matching commit, so other tasks cannot interleave
+  EXIO_Batch_Depth++;
+}
+void EXIO_Batch_Commit(void)                              // Ends a batch; the outermost commit sends everything in at most one write per register
+{
+  if (EXIO_Batch_Depth == 0)
+    return;
+  uint8_t result = 0;
+  if (--EXIO_Batch_Depth == 0 && !EXIO_Deferred)
+    result = EXIO_Write_Dirty();
+  EXIO_Give();
+  if (result != 0) {
+    printf("Failed to commit EXIO batch!!!\r\n");
+  }
+}
+void EXIO_Set_Deferred(bool Enable)                       // Deferred mode: changes stay in the shadow until EXIO_Flush(). Turning it off flushes
+{
+  EXIO_Take();
+  EXIO_Deferred = Enable;
+  EXIO_Give();
+  if (!Enable)
+    EXIO_Flush();
+}
+void EXIO_Flush(void)                                     // Sends pending shadow changes, cheap to call periodically when nothing changed
+{
+  EXIO_Take();
+  uint8_t result = (EXIO_Batch_Depth == 0) ? EXIO_Write_Dirty() : 0;
+  EXIO_Give();
+  if (result != 0) {
+    printf("Failed to flush EXIO!!!\r\n");
+  }
 }
 /********************************************************* TCA9554PWR Initializes the device ***********************************************************/  
 void TCA9554PWR_Init(uint8_t PinState)                  // Set the seven pins to PinState state, for example :PinState=0x23, 0010 0011 State  (Output mode or input mode) 0= Output mode 1= Input mode. The default value is output mode
-{                  
+{
+  EXIO_Take();
+  EXIO_Output_Shadow = I2C_Read_EXIO(TCA9554_OUTPUT_REG); // The only register read needed from here on
+  EXIO_Output_Dirty = false;
+  EXIO_Give();
   Mode_EXIOS(PinState);      
 }
@@ -2,6 +2,7 @@
 
 #include <stdio.h>
 #include "I2C_Driver.h"
+#include "freertos/semphr.h"
 
 /****************************************************** The macro defines the TCA9554PWR information ******************************************************/ 
 
@@ -26,7 +27,7 @@
 
 /*****************************************************  Operation register REG   ****************************************************/   
 uint8_t I2C_Read_EXIO(uint8_t REG);                              // Read the value of the TCA9554PWR register REG
-uint8_t I2C_Read_EXIO(uint8_t REG,uint8_t Data);                // Write Data to the REG register of the TCA9554PWR
+uint8_t I2C_Write_EXIO(uint8_t REG,uint8_t Data);               // Write Data to the REG register of the TCA9554PWR
 /********************************************************** Set EXIO mode **********************************************************/       
 void Mode_EXIO(uint8_t Pin,uint8_t State);                  // Set the mode of the TCA9554PWR Pin. The default is Output mode (output mode or input mode). State: 0= Output mode 1= input mode   
 void Mode_EXIOS(uint8_t PinState);                          // Set the mode of the 7 pins from the TCA9554PWR with PinState  
@@ -38,5 +39,10 @@ void Set_EXIO(uint8_t Pin,uint8_t State);                   // Sets the level st
 void Set_EXIOS(uint8_t PinState);                           // Set 7 pins to the PinState state such as :PinState=0x23, 0010 0011 state (the highest bit is not used)
 /********************************************************** Flip EXIO state **********************************************************/  
 void Set_Toggle(uint8_t Pin);                               // Flip the level of the TCA9554PWR Pin
+/********************************************************** Batched updates **********************************************************/
+void EXIO_Batch_Begin(void);                                // Following pin changes only update the shadow registers (batches may nest)
+void EXIO_Batch_Commit(void);                               // Send all changes made since EXIO_Batch_Begin in at most one write per register
+void EXIO_Set_Deferred(bool Enable);                        // Keep changes in the shadow until EXIO_Flush(), disabling flushes immediately
+void EXIO_Flush(void);                                      // Write pending shadow changes, if any
 /********************************************************* TCA9554PWR Initializes the device ***********************************************************/  
 void TCA9554PWR_Init(uint8_t PinState = 0x00);              // Set the seven pins to PinState state, for example :PinState=0x23, 0010 0011 State (the highest bit is not used) (Output mode or input mode) 0= Output mode 1= Input mode. The default value is output mode
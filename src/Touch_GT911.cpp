@@ -1,37 +1,33 @@
 #include "Touch_GT911.h"
 struct GT911_Touch touch_data = {0};
+// GT911 registers are 16 bit wide. Touch transfers use the highest bus priority so they overtake queued sensor polls.
 bool I2C_Read_Touch(uint8_t Driver_addr, uint16_t Reg_addr, uint8_t *Reg_data, uint32_t Length)
 {
-  Wire.beginTransmission(Driver_addr);
-  Wire.write((uint8_t)(Reg_addr >> 8)); 
-  Wire.write((uint8_t)Reg_addr);         
-  if ( Wire.endTransmission(true)){
-    printf("The I2C transmission fails. - I2C Read\r\n");
-    return false;
-  }
-  Wire.requestFrom(Driver_addr, Length);
-  for (int i = 0; i < Length; i++) {
-    *Reg_data++ = Wire.read();
-  }
-  return true;
+  I2C_Transaction_t trans = {};
+  trans.Driver_addr = Driver_addr;
+  trans.Reg_addr = Reg_addr;
+  trans.Reg_bytes = 2;
+  trans.Read = true;
+  trans.Data = Reg_data;
+  trans.Length = Length;
+  trans.Priority = I2C_PRIO_TOUCH;
+  return I2C_Transfer(&trans) == ESP_OK;
 }
 bool I2C_Write_Touch(uint8_t Driver_addr, uint16_t Reg_addr, const uint8_t *Reg_data, uint32_t Length)
 {
-  Wire.beginTransmission(Driver_addr);
-  Wire.write((uint8_t)(Reg_addr >> 8));
-  Wire.write((uint8_t)Reg_addr);        
-  for (int i = 0; i < Length; i++) {
-    Wire.write(*Reg_data++);
-  }
-  if ( Wire.endTransmission(true))
-  {
-    printf("The I2C transmission fails. - I2C Write\r\n");
-    return false;
-  }
-  return true;
+  I2C_Transaction_t trans = {};
+  trans.Driver_addr = Driver_addr;
+  trans.Reg_addr = Reg_addr;
+  trans.Reg_bytes = 2;
+  trans.Read = false;
+  trans.Data = (uint8_t *)Reg_data;
+  trans.Length = Length;
+  trans.Priority = I2C_PRIO_TOUCH;
+  return I2C_Transfer(&trans) == ESP_OK;
 }
 uint8_t Touch_Init(void) {
 
+  I2C_Add_Device(GT911_ADDR, GT911_I2C_Frequency);
   pinMode(GT911_INT_PIN, OUTPUT);                  
   GT911_Touch_Reset();
   GT911_Read_cfg();
@@ -7,6 +7,7 @@
 
 #define GT911_ADDR          0x5D
 #define GT911_INT_PIN       16
+#define GT911_I2C_Frequency I2C_FM_PLUS_Frequency
      
 #define Mirror_X       0                               
 #define Mirror_Y       0
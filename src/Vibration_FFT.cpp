@@ -0,0 +1,411 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "Vibration_FFT.h"
+#include "IMU_Stream.h"
+#include "Seqlock.h"
+#include "Power_Manager.h"
+
+#if defined(ESP_PLATFORM) && __has_include("esp_dsp.h")
+#include "esp_dsp.h"
+#define VIBRATION_ESP_DSP 1                                     // dsps_fft2r_fc32 resolves to the aes3 (SIMD) kernel on the S3
+#else
+#define VIBRATION_ESP_DSP 0
+#endif
+#define VIBRATION_FFT_ALIGN 16                                  // dsps_fft2r_fc32's aes3 kernel loads 16-byte vectors
+
+/********************************************************** FFT kernel **********************************************************/
+// A real FFT of n points is a complex FFT of n/2 points over (even, odd) pairs plus an O(n) split. The twiddle table
+// holds cos/-sin of 2*pi*k/n for k < n/2; the complex stage uses every other entry.
+static void Fft_Complex(float *d, uint32_t m, const float *tw)
+{
+  for (uint32_t i = 1, j = 0; i < m; i++) {                     // Bit reversal
+    uint32_t bit = m >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      float tr = d[2 * i], ti = d[2 * i + 1];
+      d[2 * i] = d[2 * j];
+      d[2 * i + 1] = d[2 * j + 1];
+      d[2 * j] = tr;
+      d[2 * j + 1] = ti;
+    }
+  }
+  for (uint32_t len = 2; len <= m; len <<= 1) {                 // Radix-2 butterflies
+    uint32_t half = len >> 1, step = 2 * m / len;
+    for (uint32_t i = 0; i < m; i += len) {
+      for (uint32_t k = 0; k < half; k++) {
+        float wr = tw[2 * k * step], wi = tw[2 * k * step + 1];
+        float *a = &d[2 * (i + k)], *b = &d[2 * (i + k + half)];
+        float tr = b[0] * wr - b[1] * wi, ti = b[0] * wi + b[1] * wr;
+        b[0] = a[0] - tr;
+        b[1] = a[1] - ti;
+        a[0] += tr;
+        a[1] += ti;
+      }
+    }
+  }
+}
+
+#if VIBRATION_ESP_DSP
+static bool Fft_Dsp_Ready = false;
+#endif
+
+void Vibration_Rfft(float *data, uint16_t n, const float *twiddle)
+{
+  uint32_t m = n / 2;
+#if VIBRATION_ESP_DSP
+  if (!Fft_Dsp_Ready)
+    Fft_Dsp_Ready = dsps_fft2r_init_fc32(NULL, CONFIG_DSP_MAX_FFT_SIZE) == ESP_OK;
+  if (Fft_Dsp_Ready) {
+    dsps_fft2r_fc32(data, m);
+    dsps_bit_rev_fc32(data, m);
+  } else
+#endif
+    Fft_Complex(data, m, twiddle);
+
+  // Split the half-length spectrum Z into the real signal's X[0..m]
+  float z0r = data[0], z0i = data[1];
+  data[0] = z0r + z0i;                                          // X[0]
+  data[1] = z0r - z0i;                                          // X[m], real, packed into the unused imaginary slot
+  for (uint32_t k = 1; k < m / 2; k++) {
+    float *zk = &data[2 * k], *zm = &data[2 * (m - k)];
+    float er = 0.5f * (zk[0] + zm[0]), ei = 0.5f * (zk[1] - zm[1]);  // (Z[k] + conj Z[m-k]) / 2
+    float or_ = 0.5f * (zk[1] + zm[1]), oi = -0.5f * (zk[0] - zm[0]); // (Z[k] - conj Z[m-k]) / 2i
+    float wr = twiddle[2 * k], wi = twiddle[2 * k + 1];
+    float tr = or_ * wr - oi * wi, ti = or_ * wi + oi * wr;
+    zk[0] = er + tr;
+    zk[1] = ei + ti;
+    zm[0] = er - tr;                                            // X[m-k] = conj(E - W O)
+    zm[1] = -(ei - ti);
+  }
+  if (m >= 2)
+    data[m + 1] = -data[m + 1];                                 // X[m/2] = conj Z[m/2]
+}
+
+const char *Vibration_Fft_Kernel(void)
+{
+#if VIBRATION_ESP_DSP
+  return "esp-dsp";
+#else
+  return "portable radix-2";
+#endif
+}
+
+/********************************************************** Analysis **********************************************************/
+void Vibration_Default_Config(Vibration_Config_t *config)
+{
+  memset(config, 0, sizeof(*config));
+  config->Fft_size = VIBRATION_FFT_SIZE;
+  config->Overlap_pct = VIBRATION_OVERLAP_PCT;
+  config->Axis = VIBRATION_AXIS_NORM;
+  static const Vibration_Band_t bands[] = {                     // Roughly: imbalance, misalignment/looseness, bearings
+    {2.0f, 10.0f}, {10.0f, 100.0f}, {100.0f, 450.0f},
+  };
+  config->Band_count = sizeof(bands) / sizeof(bands[0]);
+  memcpy(config->Bands, bands, sizeof(bands));
+}
+
+static bool Vibration_Size_Valid(uint16_t n)
+{
+  return n >= VIBRATION_FFT_MIN && n <= VIBRATION_FFT_MAX && (n & (n - 1)) == 0;
+}
+
+void Vibration_Analyzer_Free(Vibration_Analyzer_t *an)
+{
+  heap_caps_free(an->Window);
+  heap_caps_free(an->Work);
+  heap_caps_free(an->Twiddle);
+  free(an->Power);
+  an->Window = an->Work = an->Twiddle = an->Power = NULL;
+}
+
+bool Vibration_Analyzer_Init(Vibration_Analyzer_t *an, const Vibration_Config_t *config)
+{
+  memset(an, 0, sizeof(*an));
+  if (!Vibration_Size_Valid(config->Fft_size) || config->Overlap_pct > 75 || config->Band_count > VIBRATION_BANDS_MAX)
+    return false;
+  an->Config = *config;
+  uint16_t n = config->Fft_size;
+  uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+  an->Window = (float *)heap_caps_aligned_alloc(VIBRATION_FFT_ALIGN, n * sizeof(float), caps);
+  an->Work = (float *)heap_caps_aligned_alloc(VIBRATION_FFT_ALIGN, n * sizeof(float), caps);
+  an->Twiddle = (float *)heap_caps_aligned_alloc(VIBRATION_FFT_ALIGN, n * sizeof(float), caps);
+  an->Power = (float *)calloc(n / 2 + 1, sizeof(float));
+  if (!an->Window || !an->Work || !an->Twiddle || !an->Power) {
+    Vibration_Analyzer_Free(an);
+    return false;
+  }
+  for (uint16_t i = 0; i < n; i++) {
+    an->Window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / n);   // Periodic Hann
+    an->Window_sum += an->Window[i];
+    an->Window_sum2 += an->Window[i] * an->Window[i];
+  }
+  for (uint16_t k = 0; k < n / 2; k++) {
+    an->Twiddle[2 * k] = cosf(2.0f * (float)M_PI * k / n);
+    an->Twiddle[2 * k + 1] = -sinf(2.0f * (float)M_PI * k / n);
+  }
+  return true;
+}
+
+static void Vibration_Find_Peaks(const Vibration_Analyzer_t *an, Vibration_Result_t *out)
+{
+  memset(out->Peaks, 0, sizeof(out->Peaks));
+  uint16_t bins = out->Bins;
+  const float *a = out->Spectrum_g;
+  for (uint16_t k = 2; k + 1 < bins; k++) {                     // Bins 0-1 hold the DC leakage of the Hann window
+    if (a[k] <= a[k - 1] || a[k] < a[k + 1])
+      continue;
+    int slot = VIBRATION_PEAKS;
+    while (slot > 0 && a[k] > out->Peaks[slot - 1].Amplitude_g)
+      slot--;
+    if (slot == VIBRATION_PEAKS)
+      continue;
+    // Parabola through the three bins for the frequency and height between them
+    float denom = a[k - 1] - 2.0f * a[k] + a[k + 1];
+    float delta = denom != 0 ? 0.5f * (a[k - 1] - a[k + 1]) / denom : 0;
+    memmove(&out->Peaks[slot + 1], &out->Peaks[slot], (VIBRATION_PEAKS - 1 - slot) * sizeof(Vibration_Peak_t));
+    out->Peaks[slot].Hz = (k + delta) * out->Bin_hz;
+    out->Peaks[slot].Amplitude_g = a[k] - 0.25f * (a[k - 1] - a[k + 1]) * delta;
+  }
+}
+
+/**
+ * Analyze one frame and fold it into the averaged spectrum.
+ * @param frame Fft_size samples in g, oldest first
+ * @param Sample_hz sample rate of the frame
+ */
+void Vibration_Analyzer_Process(Vibration_Analyzer_t *an, const float *frame, float Sample_hz, Vibration_Result_t *out)
+{
+  uint16_t n = an->Config.Fft_size, bins = n / 2 + 1;
+  float *w = an->Work;
+
+  float mean = 0;
+  for (uint16_t i = 0; i < n; i++)
+    mean += frame[i];
+  mean /= n;
+  for (uint16_t i = 0; i < n; i++)
+    w[i] = (frame[i] - mean) * an->Window[i];
+  Vibration_Rfft(w, n, an->Twiddle);
+
+  float alpha = an->Frames ? VIBRATION_AVERAGING : 1.0f;
+  for (uint16_t k = 0; k < bins; k++) {
+    float p;
+    if (k == 0)
+      p = w[0] * w[0];
+    else if (k == n / 2)
+      p = w[1] * w[1];
+    else
+      p = w[2 * k] * w[2 * k] + w[2 * k + 1] * w[2 * k + 1];
+    an->Power[k] += alpha * (p - an->Power[k]);
+  }
+  an->Frames++;
+
+  // Amplitude of a sine centred on a bin: 2|X| / sum(w). Mean square of a band: 2 sum|X|^2 / (n sum(w^2))
+  float amp_scale = 2.0f / an->Window_sum, ms_scale = 2.0f / (n * an->Window_sum2);
+  out->Frames = an->Frames;
+  out->Sample_hz = Sample_hz;
+  out->Bin_hz = Sample_hz / n;
+  out->Bins = bins;
+  float total = 0;
+  for (uint16_t k = 0; k < bins; k++) {
+    out->Spectrum_g[k] = sqrtf(an->Power[k]) * amp_scale;
+    if (k)
+      total += an->Power[k];
+  }
+  out->Rms_g = sqrtf(total * ms_scale);
+  for (uint8_t b = 0; b < an->Config.Band_count; b++) {
+    uint32_t lo = (uint32_t)ceilf(an->Config.Bands[b].Low_hz / out->Bin_hz);
+    uint32_t hi = (uint32_t)ceilf(an->Config.Bands[b].High_hz / out->Bin_hz);
+    float sum = 0;
+    for (uint32_t k = lo < 1 ? 1 : lo; k < hi && k < bins; k++)
+      sum += an->Power[k];
+    out->Band_rms_g[b] = sqrtf(sum * ms_scale);
+  }
+  Vibration_Find_Peaks(an, out);
+}
+
+/********************************************************** Publishing **********************************************************/
+// Seqlock as IMU_Fusion (src/Seqlock.h): the task analyzes straight into the slot readers are not copying.
+static Vibration_Result_t *Vibration_Slot = NULL;              // Two results, PSRAM
+static Seqlock_t           Vibration_Published = {0};
+
+bool Vibration_Get(Vibration_Result_t *result)
+{
+  return Seqlock_Read(&Vibration_Published, Vibration_Slot, sizeof(Vibration_Result_t), result);
+}
+
+/********************************************************** Analysis task **********************************************************/
+static TaskHandle_t       Vibration_Task_Handle = NULL;
+static Vibration_Config_t Vibration_Pending;
+static volatile bool      Vibration_Reconfigure = false;
+static volatile bool      Vibration_Stopped = false;            // Vibration_Stop(), until the next Vibration_Init()
+static portMUX_TYPE       Vibration_Lock = portMUX_INITIALIZER_UNLOCKED;
+
+static float Vibration_Value(const IMU_Sample_t *s, Vibration_Axis_t axis, float scale)
+{
+  if (axis == VIBRATION_AXIS_NORM) {
+    float x = s->Acc[0] * scale, y = s->Acc[1] * scale, z = s->Acc[2] * scale;
+    return sqrtf(x * x + y * y + z * z) - 1.0f;
+  }
+  return s->Acc[axis] * scale;
+}
+
+static void Vibration_Task(void *parameter)
+{
+  static IMU_Sample_t batch[64];
+  float *history = (float *)heap_caps_malloc(VIBRATION_FFT_MAX * sizeof(float), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  float *frame = (float *)heap_caps_malloc(VIBRATION_FFT_MAX * sizeof(float), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  Vibration_Analyzer_t an = {};
+  IMU_Reader_t reader;
+  uint32_t head = 0, fresh = 0, dropped = 0, first_us = 0, last_us = 0, counted = 0;
+
+  if (history == NULL || frame == NULL) {
+    printf("Vibration: buffer allocation failed\r\n");
+    vTaskDelete(NULL);
+  }
+  IMU_Reader_Attach(&reader);
+  while (1) {
+    vTaskDelay(pdMS_TO_TICKS(VIBRATION_PERIOD_MS));
+    if (Vibration_Stopped) {                                    // A configuration waits for Vibration_Init()
+      Vibration_Analyzer_Free(&an);
+      continue;
+    }
+    if (Vibration_Reconfigure) {
+      Vibration_Config_t config;
+      portENTER_CRITICAL(&Vibration_Lock);
+      config = Vibration_Pending;
+      Vibration_Reconfigure = false;
+      portEXIT_CRITICAL(&Vibration_Lock);
+      Vibration_Analyzer_Free(&an);
+      if (!Vibration_Analyzer_Init(&an, &config))
+        printf("Vibration: configuration rejected (size %u)\r\n", config.Fft_size);
+      head = fresh = counted = 0;
+    }
+    if (an.Work == NULL)
+      continue;
+
+    uint16_t n = an.Config.Fft_size;
+    uint32_t hop = n - n * an.Config.Overlap_pct / 100;
+    float scale = IMU_Stream_Acc_Scale();
+    uint32_t got;
+    while ((got = IMU_Reader_Read(&reader, batch, sizeof(batch) / sizeof(batch[0]))) > 0) {
+      if (reader.Dropped != dropped) {                          // A gap in the signal, start the frame over
+        dropped = reader.Dropped;
+        head = fresh = counted = 0;
+      }
+      for (uint32_t i = 0; i < got; i++) {
+        if (counted && (uint32_t)(batch[i].Time_us - last_us) > VIBRATION_MAX_GAP_US)
+          head = fresh = counted = 0;                           // Acquisition paused (FIFO restart, sleep): same
+        history[head++ & (VIBRATION_FFT_MAX - 1)] = Vibration_Value(&batch[i], an.Config.Axis, scale);
+        if (counted++ == 0)
+          first_us = batch[i].Time_us;
+        last_us = batch[i].Time_us;
+        if (++fresh < hop || head < n)
+          continue;
+        fresh = 0;
+        for (uint16_t k = 0; k < n; k++)
+          frame[k] = history[(head - n + k) & (VIBRATION_FFT_MAX - 1)];
+        float rate = (last_us != first_us) ? 1e6f * (counted - 1) / (uint32_t)(last_us - first_us) : 0;
+        Vibration_Result_t *out = &Vibration_Slot[Seqlock_Write_Slot(&Vibration_Published)];
+        Vibration_Analyzer_Process(&an, frame, rate, out);
+        out->Time_us = last_us;
+        Seqlock_Publish(&Vibration_Published);
+      }
+    }
+  }
+}
+
+/**
+ * Start analyzing IMU_Stream. Needs the stream, i.e. QMI8658_FIFO_Init() first.
+ * @param config NULL for Vibration_Default_Config()
+ * @return false on a bad configuration or if the task or result buffers could not be created
+ */
+bool Vibration_Init(const Vibration_Config_t *config)
+{
+  if (Vibration_Task_Handle) {
+    if (!Vibration_Configure(config))
+      return false;
+    if (Vibration_Stopped) {
+      Power_Manager_Hold();
+      Vibration_Stopped = false;
+    }
+    return true;
+  }
+  if (Vibration_Slot == NULL)
+    Vibration_Slot = (Vibration_Result_t *)heap_caps_malloc(2 * sizeof(Vibration_Result_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (Vibration_Slot == NULL)
+    Vibration_Slot = (Vibration_Result_t *)heap_caps_malloc(2 * sizeof(Vibration_Result_t), MALLOC_CAP_8BIT);
+  if (Vibration_Slot == NULL || !Vibration_Configure(config))
+    return false;
+  if (xTaskCreatePinnedToCore(Vibration_Task, "Vibration task", VIBRATION_TASK_STACK, NULL, VIBRATION_TASK_PRIORITY,
+                              &Vibration_Task_Handle, VIBRATION_TASK_CORE) != pdPASS) {
+    printf("Vibration task creation failed\r\n");
+    Vibration_Task_Handle = NULL;
+    return false;
+  }
+  printf("Vibration: %u-point FFT, %u%% overlap, %s kernel\r\n", Vibration_Pending.Fft_size,
+         Vibration_Pending.Overlap_pct, Vibration_Fft_Kernel());
+  Power_Manager_Hold();                                         // Sleep would stop the samples it analyzes
+  return true;
+}
+
+/**
+ * Stop analyzing and let the device sleep again. The task frees its buffers and idles until Vibration_Init();
+ * Vibration_Get() keeps returning the last result.
+ */
+void Vibration_Stop(void)
+{
+  if (Vibration_Task_Handle == NULL || Vibration_Stopped)
+    return;
+  Vibration_Stopped = true;
+  Power_Manager_Release();
+}
+
+bool Vibration_Configure(const Vibration_Config_t *config)
+{
+  Vibration_Config_t c;
+  if (config == NULL)
+    Vibration_Default_Config(&c);
+  else
+    c = *config;
+  if (!Vibration_Size_Valid(c.Fft_size) || c.Overlap_pct > 75 || c.Band_count > VIBRATION_BANDS_MAX)
+    return false;
+  portENTER_CRITICAL(&Vibration_Lock);
+  Vibration_Pending = c;
+  Vibration_Reconfigure = true;
+  portEXIT_CRITICAL(&Vibration_Lock);
+  return true;
+}
+
+#if VIBRATION_CHART
+/**
+ * Show the averaged spectrum on a line or bar chart, 0..1000 = 0..Full_scale_g. Each chart point takes the
+ * largest bin it covers, so narrow peaks survive when there are fewer points than bins.
+ */
+void Vibration_Chart_Update(lv_obj_t *chart, lv_chart_series_t *series, float Full_scale_g)
+{
+  static Vibration_Result_t r;                                  // 4 KB, keep it off the LVGL task's stack
+  if (!Vibration_Get(&r) || Full_scale_g <= 0)
+    return;
+  uint32_t points = lv_chart_get_point_count(chart);
+  if (points == 0)
+    return;
+  lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_Y, 0, 1000);
+  for (uint32_t p = 0; p < points; p++) {
+    uint32_t lo = 1 + p * (r.Bins - 1) / points, hi = 1 + (p + 1) * (r.Bins - 1) / points;
+    float peak = 0;
+    for (uint32_t k = lo; k < hi || k == lo; k++)
+      if (k < r.Bins && r.Spectrum_g[k] > peak)
+        peak = r.Spectrum_g[k];
+    float v = peak / Full_scale_g * 1000.0f;
+    lv_chart_set_value_by_id(chart, series, p, (int32_t)(v > 1000.0f ? 1000.0f : v));
+  }
+  lv_chart_refresh(chart);
+}
+#endif
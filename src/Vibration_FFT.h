@@ -0,0 +1,94 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************** Vibration analysis ******************************************************/
+// Streaming spectrum of one accelerometer axis from IMU_Stream: Hann-windowed real FFTs with overlap, an exponentially
+// averaged power spectrum, peak frequencies, RMS per band and an amplitude spectrum for an lv_chart.
+// On the S3 the complex FFT runs on esp-dsp's SIMD kernel when the component is available, otherwise (and on the host)
+// on the portable radix-2 kernel in this file.
+#define VIBRATION_FFT_MIN       64
+#define VIBRATION_FFT_MAX       2048                      // Power of two
+#define VIBRATION_FFT_SIZE      512                       // Default, 0.57 s and 1.75 Hz bins at the 896.8 Hz FIFO rate
+#define VIBRATION_OVERLAP_PCT   50                        // Default frame overlap, 0..75
+#define VIBRATION_AVERAGING     0.3f                      // Weight of a new frame in the averaged spectrum, 1: none
+#define VIBRATION_PEAKS         4
+#define VIBRATION_BANDS_MAX     6
+#define VIBRATION_PERIOD_MS     20                        // Task wake-up interval
+#define VIBRATION_MAX_GAP_US    50000                     // Longer gaps between samples start the frame over
+#define VIBRATION_TASK_CORE     1
+#define VIBRATION_TASK_PRIORITY 2
+#define VIBRATION_TASK_STACK    4096
+#ifndef VIBRATION_AUTOSTART
+#define VIBRATION_AUTOSTART     0                         // Start the analysis from setup(); it keeps the device awake
+#endif
+#ifndef VIBRATION_CHART
+#define VIBRATION_CHART         1                         // Vibration_Chart_Update(), needs LVGL
+#endif
+
+typedef enum {
+  VIBRATION_AXIS_X = 0,
+  VIBRATION_AXIS_Y,
+  VIBRATION_AXIS_Z,
+  VIBRATION_AXIS_NORM,                                    // |a| - 1 g, independent of how the board is mounted
+} Vibration_Axis_t;
+
+typedef struct {
+  float Low_hz;
+  float High_hz;
+} Vibration_Band_t;
+
+typedef struct {
+  uint16_t         Fft_size;                              // VIBRATION_FFT_MIN..VIBRATION_FFT_MAX, power of two
+  uint8_t          Overlap_pct;
+  Vibration_Axis_t Axis;
+  uint8_t          Band_count;
+  Vibration_Band_t Bands[VIBRATION_BANDS_MAX];
+} Vibration_Config_t;
+
+typedef struct {
+  float Hz;                                               // Interpolated between bins
+  float Amplitude_g;                                      // Peak amplitude of the sine at that frequency
+} Vibration_Peak_t;
+
+typedef struct {
+  uint32_t         Frames;                                // FFTs since the last configuration change
+  uint32_t         Time_us;                               // IMU_Sample_t time of the newest sample in the frame
+  float            Sample_hz;                             // Measured from the sample timestamps
+  float            Bin_hz;
+  uint16_t         Bins;                                  // Fft_size / 2 + 1
+  float            Rms_g;                                 // Whole spectrum without DC
+  Vibration_Peak_t Peaks[VIBRATION_PEAKS];                // Strongest first, Hz 0 when unused
+  float            Band_rms_g[VIBRATION_BANDS_MAX];
+  float            Spectrum_g[VIBRATION_FFT_MAX / 2 + 1]; // Averaged amplitude per bin
+} Vibration_Result_t;
+
+// Analysis core, no RTOS dependencies (also used by the host bench in sim/bench)
+typedef struct {
+  Vibration_Config_t Config;
+  float   *Window;
+  float   *Work;                                          // Fft_size floats, the frame and then its spectrum
+  float   *Twiddle;                                       // cos/sin pairs for the real-FFT split
+  float   *Power;                                         // Averaged |X|^2, Fft_size / 2 + 1
+  float    Window_sum;
+  float    Window_sum2;
+  uint32_t Frames;
+} Vibration_Analyzer_t;
+
+void Vibration_Default_Config(Vibration_Config_t *config);
+bool Vibration_Analyzer_Init(Vibration_Analyzer_t *an, const Vibration_Config_t *config);
+void Vibration_Analyzer_Free(Vibration_Analyzer_t *an);
+void Vibration_Analyzer_Process(Vibration_Analyzer_t *an, const float *frame, float Sample_hz, Vibration_Result_t *out);
+void Vibration_Rfft(float *data, uint16_t n, const float *twiddle);  // In place, packed: re0, re(n/2), re1, im1, ...
+const char *Vibration_Fft_Kernel(void);
+
+// Background analysis of IMU_Stream
+bool Vibration_Init(const Vibration_Config_t *config);    // NULL for the defaults. No sleep until Vibration_Stop()
+void Vibration_Stop(void);                                // The task idles, the last result stays readable
+bool Vibration_Configure(const Vibration_Config_t *config);  // Applied by the task before its next frame
+bool Vibration_Get(Vibration_Result_t *result);           // Newest result, false until the first one
+
+#if VIBRATION_CHART
+#include <lvgl.h>
+void Vibration_Chart_Update(lv_obj_t *chart, lv_chart_series_t *series, float Full_scale_g);  // LVGL context only
+#endif
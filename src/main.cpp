@@ -1,20 +1,45 @@
 #include <Arduino.h>
+#include <errno.h>
+#include <unistd.h>
 #include "Gyro_QMI8658.h"
+#include "IMU_Fusion.h"
+#include "Vibration_FFT.h"
 #include "RTC_PCF85063.h"
+#include "System_Time.h"
 #include "SD_Card.h"
+#include "Data_Logger.h"
 #include "LVGL_Driver.h"
+#include "LVGL_FS.h"
+#include "Asset_Pack.h"
+#include "Asset_Flash.h"
+#include "Paged_Font.h"
+#include "SD_Async.h"
+#include "JPEG_Decoder.h"
+#include "Compressed_Image.h"
+#include "Icon_Image.h"
+#include "SD_Bench.h"
+#include "Auto_Rotate.h"
+#include "Power_Manager.h"
 #include "BAT_Driver.h"
 #include "ui/ui.h"
 
 void Driver_Init()
 {
   Flash_test();
-  BAT_Init();
+  BAT_Init();                                       // Sampled by the ADC's DMA and filtered from here on
   I2C_Init();
   PCF85063_Init();
+  System_Time_Init();                               // The RTC is read once here, System_Time_Get() after that
   QMI8658_Init();    
+  QMI8658_FIFO_Init();                              // Full-rate IMU samples go to IMU_Stream from here on
+  IMU_Fusion_Init();                                // Attitude from every one of those samples, see IMU_Fusion_Get()
+#if VIBRATION_AUTOSTART
+  Vibration_Init(NULL);                             // Spectrum of the same samples, see Vibration_Get(); stays awake
+#endif
+  EXIO_Batch_Begin();                               // Initial levels and pin modes in one write each
   TCA9554PWR_Init(0x00);
   Set_EXIO(EXIO_PIN8,Low);
+  EXIO_Batch_Commit();
   Backlight_Init();
 }
 void Driver_Loop(void *parameter)
@@ -22,8 +47,11 @@ void Driver_Loop(void *parameter)
   while(1)
   {
     QMI8658_Loop();
-    RTC_Loop();
-    BAT_Get_Volts();
+    uint32_t us = 0;
+    System_Time_Get(&datetime, &us);                // No I2C: the clock is disciplined against the RTC in the background
+    Data_Logger_Rtc(&datetime, us);                 // Both only queue a record while a capture is running
+    Data_Logger_Battery(BAT_Get_Volts());           // The filtered value, no ADC read
+    EXIO_Flush();                                   // No-op unless deferred EXIO mode left changes pending
     vTaskDelay(pdMS_TO_TICKS(100));
   }
 }
@@ -35,6 +63,15 @@ static void global_touch_event(lv_event_t * e) {
     printf("[Global Touch] x: %d, y: %d\n", pos.x, pos.y);
 }
 
+// FatFs will not rename onto an existing file, so the one a previous update left goes first. If the pack stays
+// where it is, it is flashed again at every boot.
+static void Asset_Update_Set_Aside(const char *Target)
+{
+  unlink(Target);
+  if (rename(ASSET_FLASH_UPDATE_PATH, Target) != 0)
+    printf("Asset update: %s not renamed to %s (%s)\r\n", ASSET_FLASH_UPDATE_PATH, Target, strerror(errno));
+}
+
 void setup()
 {
   delay(100);
@@ -42,9 +79,47 @@ void setup()
   Driver_Init();
   LCD_Init();                                     // If you later reinitialize the LCD, you must initialize the SD card again !!!!!!!!!!
   SD_Init(); // It must be initialized after the LCD, and if the LCD is reinitialized later, the SD also needs to be reinitialized
+#if LOGGER_AUTOSTART
+  Data_Logger_Start();                            // IMU, battery and RTC to /sdcard/log, see tools/imu_log_decode.py
+#endif
+  esp_err_t asset_err = Asset_Flash_Update_From_File(ASSET_FLASH_UPDATE_PATH); // A pack left on the card goes to flash
+  if (asset_err == ESP_OK)                        // Flashed, and not again at the next boot
+    Asset_Update_Set_Aside(ASSET_FLASH_UPDATE_PATH ".done");
+  else if (asset_err != ESP_ERR_NOT_FOUND)        // A bad one is set aside, not erased and rewritten at every boot
+    Asset_Update_Set_Aside(ASSET_FLASH_UPDATE_PATH ".bad");
   Lvgl_Init();
+  Lvgl_FS_Init();                                 // S: reads the card through the block cache
+  if (Asset_Flash_Mount() != ESP_OK)              // Images and fonts by name, see tools/asset_pack.py: mapped from
+    Asset_Pack_Open(ASSET_PACK_PATH);             // flash, or else read from the card; optional
+  SD_Async_Init();                                // Card reads off the LVGL thread, prefetch hints for screens
+  JPEG_Decoder_Init();                            // "S:....jpg" photos as images, decoded on both cores
+  Compressed_Image_Init();                        // UI images compressed by tools/image_compress.py
+  Icon_Image_Init();                              // Indexed icons drawn as A8 masks
 
   ui_init();   
+  Icon_Image_Set_Color(ui_Button1, lv_color_hex(ICON_IMAGE_UI_COLOR)); // A8 icons take their colour from the button
+  Icon_Image_Set_Color(ui_Button2, lv_color_hex(ICON_IMAGE_UI_COLOR));
+  Auto_Rotate_Init();                             // Follows the IMU attitude from here on
+  Power_Manager_Init();                           // Dims and sleeps when idle, wakes on motion or touch
+#if SD_BENCH_AUTOSTART
+  SD_Bench_Start(SD_BENCH_DIR);                   // Card throughput and latency on the console, SDBENCH lines
+#endif
+#if COMPRESSED_IMAGE_BENCH_AUTOSTART
+  static const lv_image_dsc_t *const icons[] = {&ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png,
+                                                &ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png};
+  static const char *const icon_names[] = {"home", "settings"};
+  Compressed_Image_Bench(icons, icon_names, 2);   // Flash saved against decode time, per icon
+#endif
+#if ICON_IMAGE_BENCH_AUTOSTART
+  static const lv_image_dsc_t *const a8_icons[] = {&ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png,
+                                                   &ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png};
+  static const char *const a8_names[] = {"home", "settings"};
+  Icon_Image_Bench(a8_icons, a8_names, 2);        // Bytes and blend time per icon format
+#endif
+#if PAGED_FONT_BENCH_AUTOSTART
+  static const char *const fonts[] = {PAGED_FONT_BENCH_PATH};
+  Paged_Font_Bench(fonts, 1, PAGED_FONT_BENCH_TEXT); // Load time and RAM, paged against lv_binfont_create()
+#endif
   
   // Debug touch areas after UI is fully initialized
   delay(100); // Give UI time to fully initialize
@@ -9,6 +9,82 @@
 #define LV_ATTRIBUTE_MEM_ALIGN
 #endif
 
+// Compressed by tools/image_compress.py: A8 LZ4, 3468 -> 214 bytes of flash.
+//   A8 icon of colour 0xE71C (RGB565): drawn in the widget's image_recolor or
+//   bg_image_recolor, see Icon_Image_Set_Color().
+//   The image as exported after #else is built with neither LV_USE_LZ4 nor LV_USE_DRAW_SW in lv_conf.h, and read back
+//   by the tool; run it again after exporting from SquareLine.
+
+#if LV_USE_LZ4
+const LV_ATTRIBUTE_MEM_ALIGN uint8_t ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data[] = {
+    // lv_image_compressed_t: LZ4, 202 bytes unpacking to 1156
+    0x02,0x00,0x00,0x00,0xCA,0x00,0x00,0x00,0x84,0x04,0x00,0x00,0x1F,0x00,0x01,0x00,0x84,0x2F,0x42,0x42,0x99,0x00,0x0C,0x4F,0xBD,0xFF,0xFF,0xBD,0x23,0x00,0x09,0x8F,
+    0x03,0xFC,0xFF,0xFF,0xFF,0xFF,0xFC,0x03,0x24,0x00,0x06,0x9F,0x42,0xFF,0xFF,0xFF,0xA6,0xA6,0xFF,0xFF,0xFF,0x6A,0x00,0x05,0x9F,0xBD,0xFF,0xFF,0xFF,0x30,0x00,0x00,
+    0x30,0xFF,0x6A,0x00,0x04,0x00,0x62,0x00,0x12,0xF7,0x5F,0x00,0x1F,0xF7,0x6A,0x00,0x02,0x01,0x62,0x00,0x02,0x21,0x00,0x2F,0x00,0x00,0x6A,0x00,0x01,0x03,0x62,0x00,
+    0x04,0x02,0x00,0x0D,0x6A,0x00,0x07,0x62,0x00,0x04,0x02,0x00,0x0B,0x6A,0x00,0x17,0x2A,0x62,0x00,0x04,0x02,0x00,0x44,0xA6,0xFF,0xFF,0x2A,0x0C,0x00,0x01,0x22,0x00,
+    0x00,0x07,0x00,0x0A,0x02,0x00,0x0F,0x22,0x00,0x68,0x13,0x31,0x01,0x00,0x01,0x91,0x00,0x0F,0x88,0x00,0x02,0x00,0xB8,0x01,0x00,0x02,0x00,0x0F,0x22,0x00,0x2B,0x4F,
+    0x31,0x00,0x00,0x31,0x44,0x00,0x0B,0x0F,0x22,0x00,0x90,0x10,0xB8,0x01,0x00,0x04,0xAA,0x00,0x00,0x0C,0x00,0x1C,0xB8,0x32,0x01,0x03,0x02,0x00,0x02,0xCC,0x00,0x03,
+    0x02,0x00,0x0A,0xFE,0x01,0x03,0x02,0x00,0x0F,0x22,0x00,0x05,0x0F,0x02,0x00,0x6B,0x50,0x00,0x00,0x00,0x00,0x00,
+};
+const lv_image_dsc_t ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png = {
+   .header.w = 34,
+   .header.h = 34,
+   .header.stride = 34,
+   .header.flags = LV_IMAGE_FLAGS_COMPRESSED,
+   .data_size = sizeof(ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data),
+   .header.cf = LV_COLOR_FORMAT_A8,
+   .header.magic = LV_IMAGE_HEADER_MAGIC,
+   .data = ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data};
+#elif LV_USE_DRAW_SW
+const LV_ATTRIBUTE_MEM_ALIGN uint8_t ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data[] = {
+    // A8 icon, 1156 bytes
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x42,0x42,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xBD,0xFF,0xFF,0xBD,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x03,0xFC,0xFF,0xFF,0xFF,0xFF,0xFC,
+    0x03,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x42,0xFF,0xFF,0xFF,0xA6,0xA6,
+    0xFF,0xFF,0xFF,0x42,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xBD,0xFF,0xFF,0xFF,0x30,
+    0x00,0x00,0x30,0xFF,0xFF,0xFF,0xBD,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x03,0xFC,0xFF,0xFF,0xF7,
+    0x00,0x00,0x00,0x00,0x00,0x00,0xF7,0xFF,0xFF,0xFC,0x03,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x42,0xFF,0xFF,0xFF,
+    0xA6,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xA6,0xFF,0xFF,0xFF,0x42,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xBD,0xFF,0xFF,
+    0xFF,0x30,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x30,0xFF,0xFF,0xFF,0xBD,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x03,0xFC,0xFF,
+    0xFF,0xF7,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xF7,0xFF,0xFF,0xFC,0x03,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2A,
+    0xFF,0xFF,0xA6,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xA6,0xFF,0xFF,0x2A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x2A,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0x2A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x2A,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0x2A,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x2A,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0x2A,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2A,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0x2A,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2A,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0x31,0x31,0x31,0x31,0x31,0x31,0x31,0x31,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,
+    0x2A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2A,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,
+    0xFF,0xFF,0x2A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2A,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x00,0x00,0x00,
+    0x00,0x00,0xFF,0xFF,0x2A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2A,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0x31,0x00,0x00,0x31,0xFF,0xFF,0x00,
+    0x00,0x00,0x00,0x00,0xFF,0xFF,0x2A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2A,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0x31,0x00,0x00,0x31,0xFF,
+    0xFF,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0x2A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2A,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0x31,0x00,0x00,
+    0x31,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0x2A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2A,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0x31,
+    0x00,0x00,0x31,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0x2A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2A,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0xFF,
+    0xFF,0x31,0x00,0x00,0x31,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0x2A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2A,0xFF,0xFF,0x00,0x00,0x00,0x00,
+    0x00,0xFF,0xFF,0x31,0x00,0x00,0x31,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0x2A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2A,0xFF,0xFF,0xB8,0xB8,
+    0xB8,0xB8,0xB8,0xFF,0xFF,0x31,0x00,0x00,0x31,0xFF,0xFF,0xB8,0xB8,0xB8,0xB8,0xB8,0xFF,0xFF,0x2A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2A,0xFF,0xFF,
+    0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x31,0x00,0x00,0x31,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x2A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2A,
+    0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x31,0x00,0x00,0x31,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x2A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,
+};
+const lv_image_dsc_t ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png = {
+   .header.w = 34,
+   .header.h = 34,
+   .header.stride = 34,
+   .data_size = sizeof(ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data),
+   .header.cf = LV_COLOR_FORMAT_A8,
+   .header.magic = LV_IMAGE_HEADER_MAGIC,
+   .data = ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data};
+#else
 // IMAGE DATA: assets/home_34dp_E3E3E3_FILL0_wght400_GRAD0_opsz40.png
 const LV_ATTRIBUTE_MEM_ALIGN uint8_t ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data[] = {
 0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
@@ -58,3 +134,4 @@ const lv_image_dsc_t ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png = {
    .header.magic = LV_IMAGE_HEADER_MAGIC,
    .data = ui_img_home_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data};
 
+#endif
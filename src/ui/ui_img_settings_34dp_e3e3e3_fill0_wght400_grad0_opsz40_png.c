@@ -9,6 +9,91 @@
 #define LV_ATTRIBUTE_MEM_ALIGN
 #endif
 
+// Compressed by tools/image_compress.py: A8 LZ4, 3468 -> 487 bytes of flash.
+//   A8 icon of colour 0xE71C (RGB565): drawn in the widget's image_recolor or
+//   bg_image_recolor, see Icon_Image_Set_Color().
+//   The image as exported after #else is built with neither LV_USE_LZ4 nor LV_USE_DRAW_SW in lv_conf.h, and read back
+//   by the tool; run it again after exporting from SquareLine.
+
+#if LV_USE_LZ4
+const LV_ATTRIBUTE_MEM_ALIGN uint8_t ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data[] = {
+    // lv_image_compressed_t: LZ4, 475 bytes unpacking to 1156
+    0x02,0x00,0x00,0x00,0xDB,0x01,0x00,0x00,0x84,0x04,0x00,0x00,0x1F,0x00,0x01,0x00,0x5F,0x21,0xA2,0xFF,0x01,0x00,0x1F,0xA3,0x7A,0x00,0x07,0x11,0xED,0x21,0x00,0x2F,
+    0xFF,0xEE,0x22,0x00,0x07,0x8F,0xFF,0xFF,0x6C,0x00,0x00,0x66,0xFF,0xFF,0x22,0x00,0x09,0x4F,0x2B,0x00,0x00,0x27,0x22,0x00,0x02,0x72,0xFF,0xCF,0x06,0x00,0x00,0x00,
+    0x87,0x1C,0x00,0x88,0xFF,0xFF,0x8F,0x00,0x00,0x00,0x06,0xCF,0x4B,0x00,0x60,0xCF,0xFF,0xFF,0xFF,0xF5,0x4C,0x85,0x00,0x00,0x60,0x00,0x00,0x08,0x00,0x60,0x4F,0xF5,
+    0xFF,0xFF,0xFF,0xCF,0x0E,0x00,0x01,0x02,0x00,0x10,0x0E,0x14,0x00,0x00,0x02,0x00,0x20,0xAE,0x04,0x10,0x00,0x20,0x01,0x98,0x0C,0x00,0x00,0x02,0x00,0x10,0x0E,0x0F,
+    0x00,0x00,0x02,0x00,0x90,0xF8,0xFF,0xFF,0x00,0x1B,0xE9,0xFF,0xFC,0x02,0x0D,0x00,0x01,0x02,0x00,0x81,0xFB,0xFF,0xEB,0x1C,0x00,0xFF,0xFF,0xF8,0x0D,0x00,0x60,0x00,
+    0x00,0x40,0xFF,0xFF,0x46,0x08,0x00,0x0C,0x02,0x00,0x42,0x46,0xFF,0xFF,0x40,0x14,0x00,0x42,0xFF,0xFF,0xFF,0x21,0x0A,0x00,0x60,0x00,0x00,0x75,0xE1,0xE3,0x7D,0x08,
+    0x00,0x00,0x02,0x00,0x13,0x21,0x98,0x00,0x70,0x00,0x00,0x60,0xFF,0xFF,0xFF,0x98,0x09,0x00,0x20,0x00,0x0D,0x7D,0x00,0x31,0xFF,0xFF,0x14,0x0D,0x00,0x51,0x95,0xFF,
+    0xFF,0xFF,0x5B,0x0A,0x00,0x70,0x00,0x00,0x09,0xFF,0xFF,0xFF,0xF4,0x09,0x00,0x00,0x1F,0x00,0x00,0x02,0x00,0x00,0x0C,0x00,0x40,0xF3,0xFF,0xFF,0xFE,0x03,0x01,0x03,
+    0x02,0x00,0x11,0xCB,0x16,0x00,0x10,0x6D,0x1E,0x00,0x00,0x02,0x00,0x11,0x84,0x2E,0x00,0x13,0xBC,0x1D,0x00,0x01,0x02,0x00,0x11,0x7F,0x22,0x00,0x10,0xD6,0x1E,0x00,
+    0x00,0x02,0x00,0x00,0x99,0x01,0x31,0xFF,0xFF,0x7F,0x1B,0x00,0x03,0x02,0x00,0x0F,0x22,0x00,0x0F,0x0F,0x66,0x00,0x02,0x13,0xC0,0x3F,0x00,0x03,0xAA,0x00,0x10,0xF3,
+    0x0A,0x00,0x00,0x62,0x00,0x00,0x02,0x00,0x00,0x0C,0x00,0x08,0xAA,0x00,0x00,0xEE,0x00,0x10,0x95,0x15,0x00,0x0E,0xEE,0x00,0x11,0x59,0x17,0x00,0x0F,0x32,0x01,0x10,
+    0x0F,0x76,0x01,0x08,0x12,0x3A,0x44,0x00,0x01,0xBA,0x01,0x27,0x1C,0xEB,0x21,0x01,0x93,0x06,0xFE,0xFF,0xE9,0x1B,0x00,0xFF,0xFF,0xF6,0x21,0x00,0x06,0xFE,0x01,0x20,
+    0xBE,0x07,0x13,0x00,0x20,0x07,0xBE,0xAE,0x00,0x00,0x02,0x00,0x10,0x0C,0x0F,0x00,0x01,0x02,0x00,0x0E,0x42,0x02,0x10,0x4D,0x42,0x02,0x11,0xCA,0x1D,0x00,0x02,0x02,
+    0x00,0x02,0x86,0x02,0x12,0x8E,0xE8,0x00,0x02,0xDA,0x00,0x28,0x07,0xD1,0x86,0x02,0x04,0x02,0x00,0x62,0xFF,0xFF,0x27,0x00,0x00,0x2B,0x28,0x00,0x0F,0x02,0x00,0x03,
+    0x6F,0xFF,0xFF,0x66,0x00,0x00,0x6C,0x22,0x00,0x09,0x10,0xEE,0x9F,0x00,0x02,0xB9,0x01,0x0F,0x02,0x00,0x04,0x10,0xA3,0x20,0x00,0x0F,0x96,0x03,0x0A,0x0F,0x02,0x00,
+    0x41,0x50,0x00,0x00,0x00,0x00,0x00,
+};
+const lv_image_dsc_t ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png = {
+   .header.w = 34,
+   .header.h = 34,
+   .header.stride = 34,
+   .header.flags = LV_IMAGE_FLAGS_COMPRESSED,
+   .data_size = sizeof(ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data),
+   .header.cf = LV_COLOR_FORMAT_A8,
+   .header.magic = LV_IMAGE_HEADER_MAGIC,
+   .data = ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data};
+#elif LV_USE_DRAW_SW
+const LV_ATTRIBUTE_MEM_ALIGN uint8_t ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data[] = {
+    // A8 icon, 1156 bytes
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xA2,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xA3,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xED,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xEE,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0x6C,0x00,0x00,0x66,0xFF,0xFF,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0x2B,0x00,0x00,0x27,0xFF,
+    0xFF,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xFF,0xCF,0x06,0x00,0x00,0x00,0x87,0xFF,0xFF,0x00,0x00,0x00,
+    0x00,0xFF,0xFF,0x8F,0x00,0x00,0x00,0x06,0xCF,0xFF,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xCF,0xFF,0xFF,0xFF,0xF5,0x4C,0xFF,0xFF,0xFF,0xFF,0x00,
+    0x00,0x00,0x00,0xFF,0xFF,0xFF,0xFF,0x4F,0xF5,0xFF,0xFF,0xFF,0xCF,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x0E,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xAE,
+    0x04,0x00,0x00,0x00,0x00,0x01,0x98,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x0E,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xF8,0xFF,0xFF,0x00,0x1B,0xE9,0xFF,0xFC,
+    0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xFB,0xFF,0xEB,0x1C,0x00,0xFF,0xFF,0xF8,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x40,0xFF,0xFF,0x46,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x46,0xFF,0xFF,0x40,0x00,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0xFF,0x21,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x75,0xE1,0xE3,0x7D,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x21,0xFF,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0x00,0x60,0xFF,0xFF,
+    0xFF,0x98,0x00,0x00,0x00,0x00,0x00,0x0D,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x14,0x00,0x00,0x00,0x00,0x00,0x95,0xFF,0xFF,0xFF,0x5B,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x09,0xFF,0xFF,0xFF,0xF4,0x00,0x00,0x00,0x00,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x00,0x00,0x00,0x00,0xF3,0xFF,0xFF,0xFE,0x06,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0xCB,0xFF,0xFF,0x00,0x00,0x00,0x6D,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x84,0x00,0x00,0x00,0xFF,0xFF,0xBC,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x7F,0xFF,0xFF,0x00,0x00,0x00,0xD6,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xEE,0x00,0x00,0x00,0xFF,0xFF,0x7F,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x7F,0xFF,0xFF,0x00,0x00,0x00,0xD6,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xEE,0x00,0x00,0x00,0xFF,0xFF,0x7F,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xCB,0xFF,0xFF,0x00,0x00,0x00,0x6D,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x84,0x00,0x00,0x00,0xFF,0xFF,0xC0,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x09,0xFF,0xFF,0xFF,0xF3,0x00,0x00,0x00,0x00,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x00,0x00,0x00,0x00,0xF3,
+    0xFF,0xFF,0xFE,0x06,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x60,0xFF,0xFF,0xFF,0x95,0x00,0x00,0x00,0x00,0x00,0x0D,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x14,0x00,0x00,0x00,
+    0x00,0x00,0x95,0xFF,0xFF,0xFF,0x59,0x00,0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0xFF,0x21,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x75,0xE1,0xE3,0x7D,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x21,0xFF,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0x00,0x40,0xFF,0xFF,0x46,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x46,0xFF,0xFF,0x3A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xF8,0xFF,0xFF,0x00,0x1C,0xEB,0xFF,0xFE,0x06,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x06,0xFE,0xFF,0xE9,0x1B,0x00,0xFF,0xFF,0xF6,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x0E,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xBE,0x07,0x00,
+    0x00,0x00,0x00,0x07,0xBE,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x0C,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xCF,0xFF,0xFF,0xFF,0xF5,0x4C,0xFF,0xFF,0xFF,
+    0xFF,0x00,0x00,0x00,0x00,0xFF,0xFF,0xFF,0xFF,0x4D,0xF5,0xFF,0xFF,0xFF,0xCA,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xFF,0xCF,0x06,0x00,0x00,0x00,
+    0x8E,0xFF,0xFF,0x00,0x00,0x00,0x00,0xFF,0xFF,0x95,0x00,0x00,0x00,0x07,0xD1,0xFF,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0xFF,0xFF,0x27,0x00,0x00,0x2B,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0xFF,0xFF,0x66,0x00,0x00,0x6C,0xFF,0xFF,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xEE,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xEE,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xA3,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xA3,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,
+};
+const lv_image_dsc_t ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png = {
+   .header.w = 34,
+   .header.h = 34,
+   .header.stride = 34,
+   .data_size = sizeof(ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data),
+   .header.cf = LV_COLOR_FORMAT_A8,
+   .header.magic = LV_IMAGE_HEADER_MAGIC,
+   .data = ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data};
+#else
 // IMAGE DATA: assets/settings_34dp_E3E3E3_FILL0_wght400_GRAD0_opsz40.png
 const LV_ATTRIBUTE_MEM_ALIGN uint8_t ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data[] = {
 0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
@@ -58,3 +143,4 @@ const lv_image_dsc_t ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png
    .header.magic = LV_IMAGE_HEADER_MAGIC,
    .data = ui_img_settings_34dp_e3e3e3_fill0_wght400_grad0_opsz40_png_data};
 
+#endif
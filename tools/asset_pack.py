@@ -0,0 +1,417 @@
+#!/usr/bin/env python3
+"""Build and check asset packs for the firmware's loader (src/Asset_Pack.cpp).
+
+A pack holds LVGL images and binary fonts under names; the firmware looks them
+up with Asset_Pack_Image("name") and Asset_Pack_Font("name"). Inputs:
+
+  - LVGL image files (.bin, uncompressed, as written by LVGLImage.py or the
+    online converter): stored as they are;
+  - LVGL image C files (SquareLine's ui_img_*.c and the like): the pixel array
+    and header are taken out, the name is the lv_image_dsc_t variable's;
+  - binary fonts (lv_font_conv --format bin);
+  - anything else is stored as a raw blob, readable as P:<name> through lv_fs.
+
+A directory is taken recursively; entries are named by their path inside it,
+without the extension ("icons/home"). NAME=PATH names a single file.
+
+    python tools/asset_pack.py build -o assets.pak assets/ src/ui/ui_img_*.c --lz4
+    python tools/asset_pack.py list assets.pak
+    python tools/asset_pack.py verify assets.pak
+    python tools/asset_pack.py partition assets.pak -o assets0.bin
+
+partition wraps a pack into an image of an asset slot of partitions_assets.csv
+(src/Asset_Flash.cpp): the slot header, then the pack from offset 0x1000.
+It prints the esptool command that writes it; list and verify take such
+images, or a slot read back with esptool read_flash, as well as packs. To
+update a board in the field instead, leave the pack on the card as
+assets_update.pak, or stream it through Asset_Flash_Update_Write().
+
+With --lz4 a blob is stored as one LZ4 block when that saves at least 1/8;
+the firmware then needs LV_USE_LZ4_INTERNAL in lv_conf.h. --store 'fonts/*'
+keeps matching entries uncompressed: fonts paged by Paged_Font_Create() are
+read glyph by glyph, which a compressed blob cannot be. Images must already
+be in the display's color format: this board runs LVGL at 16 bits, so
+RGB565 and RGB565A8.
+"""
+import argparse
+import fnmatch
+import os
+import re
+import struct
+import sys
+import zlib
+
+MAGIC = 0x4B415041
+VERSION = 1
+HEADER = struct.Struct("<IHHIIII8x")
+ENTRY = struct.Struct("<IIIIBBHI")
+IMAGE_HEADER = struct.Struct("<BBHHHHH")
+IMAGE_MAGIC = 0x19
+IMAGE_FLAG_COMPRESSED = 0x08
+SLOT = struct.Struct("<IIII12xI")                               # Asset_Flash_Slot_t
+SLOT_MAGIC = 0x544C5341
+SLOT_PACK_OFFSET = 0x1000
+SLOT_SUBTYPE = 0x40
+TYPE_IMAGE, TYPE_FONT, TYPE_RAW = 1, 2, 3
+TYPES = {TYPE_IMAGE: "image", TYPE_FONT: "font", TYPE_RAW: "raw"}
+STORED, LZ4 = 0, 1
+
+# lv_color_format_t with LV_COLOR_DEPTH 16: value and bits per pixel of the first plane
+COLOR_FORMATS = {
+    "L8": (0x06, 8), "I1": (0x07, 1), "I2": (0x08, 2), "I4": (0x09, 4), "I8": (0x0A, 8),
+    "A1": (0x0B, 1), "A2": (0x0C, 2), "A4": (0x0D, 4), "A8": (0x0E, 8),
+    "RGB888": (0x0F, 24), "ARGB8888": (0x10, 32), "XRGB8888": (0x11, 32),
+    "RGB565": (0x12, 16), "ARGB8565": (0x13, 24), "RGB565A8": (0x14, 16),
+    "NATIVE": (0x12, 16), "NATIVE_WITH_ALPHA": (0x14, 16),
+}
+
+
+# --------------------------------------------------------------------------------------------------------------------
+# LZ4 block format, https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+MIN_MATCH, MF_LIMIT, LAST_LITERALS = 4, 12, 5
+
+
+def _length(out, n):
+    while n >= 255:
+        out.append(255)
+        n -= 255
+    out.append(n)
+
+
+def _sequence(out, literals, offset, match):
+    lit = len(literals)
+    ml = match - MIN_MATCH if match else 0
+    out.append((min(lit, 15) << 4) | min(ml, 15))
+    if lit >= 15:
+        _length(out, lit - 15)
+    out += literals
+    if match:
+        out += struct.pack("<H", offset)
+        if ml >= 15:
+            _length(out, ml - 15)
+
+
+def lz4_compress(src):
+    """Greedy single-probe matcher, like LZ4's fast mode; output is a plain LZ4 block for LZ4_decompress_safe()."""
+    n = len(src)
+    out = bytearray()
+    table = {}
+    anchor = i = 0
+    misses = 0
+    while i < n - MF_LIMIT:
+        key = src[i:i + 4]
+        ref = table.get(key)
+        table[key] = i
+        if ref is None or i - ref > 65535:
+            misses += 1
+            i += 1 + (misses >> 6)                              # Skip faster through data that does not match
+            continue
+        misses = 0
+        match = MIN_MATCH
+        while i + match < n - LAST_LITERALS and src[ref + match] == src[i + match]:
+            match += 1
+        while i > anchor and ref > 0 and src[i - 1] == src[ref - 1]:
+            i -= 1
+            ref -= 1
+            match += 1
+        _sequence(out, src[anchor:i], i - ref, match)
+        i += match
+        anchor = i
+        if i - 2 < n - MF_LIMIT:
+            table[src[i - 2:i + 2]] = i - 2
+    _sequence(out, src[anchor:], 0, 0)
+    return bytes(out)
+
+
+def lz4_decompress(src, size):
+    out = bytearray()
+    i = 0
+    while i < len(src):
+        token = src[i]
+        i += 1
+        lit = token >> 4
+        if lit == 15:
+            while True:
+                lit += src[i]
+                i += 1
+                if src[i - 1] != 255:
+                    break
+        out += src[i:i + lit]
+        i += lit
+        if i >= len(src):
+            break
+        offset = src[i] | src[i + 1] << 8
+        i += 2
+        match = (token & 15) + MIN_MATCH
+        if match == 15 + MIN_MATCH:
+            while True:
+                match += src[i]
+                i += 1
+                if src[i - 1] != 255:
+                    break
+        if offset == 0 or offset > len(out):
+            raise ValueError("bad LZ4 offset")
+        for _ in range(match):                                  # Overlapping copies repeat the pattern
+            out.append(out[-offset])
+    if len(out) != size:
+        raise ValueError(f"LZ4 block unpacks to {len(out)} bytes, expected {size}")
+    return bytes(out)
+
+
+# --------------------------------------------------------------------------------------------------------------------
+def image_blob(cf_name, w, h, data, stride=0):
+    if cf_name not in COLOR_FORMATS:
+        raise ValueError(f"unknown color format {cf_name}")
+    cf, bpp = COLOR_FORMATS[cf_name]
+    stride = stride or (w * bpp + 7) // 8
+    return IMAGE_HEADER.pack(IMAGE_MAGIC, cf, 0, w, h, stride, 0) + data
+
+
+def parse_c_images(text, path):
+    """(name, blob) for every lv_image_dsc_t in an LVGL image C file."""
+    if "// Compressed by tools/image_compress.py" in text:
+        text = text[text.rindex("\n#else\n"):]                 # The image as exported, not the tool's branches
+    arrays = {m.group(1): bytes(int(b, 16) for b in re.findall(r"0x([0-9A-Fa-f]{2})", m.group(2)))
+              for m in re.finditer(r"uint8_t\s+(\w+)\s*\[\s*\]\s*=\s*\{(.*?)\};", text, re.S)}
+    images = []
+    for m in re.finditer(r"lv_image_dsc_t\s+(\w+)\s*=\s*\{(.*?)\};", text, re.S):
+        body = m.group(2)
+
+        def field(name):
+            f = re.search(r"\.header\." + name + r"\s*=\s*(\w+)", body)
+            return f.group(1) if f else None
+        data = re.search(r"\.data\s*=\s*(?:\(.*?\))?\s*&?(\w+)", body)
+        if not (field("w") and field("h") and field("cf") and data and data.group(1) in arrays):
+            raise ValueError(f"{path}: cannot read the descriptor of {m.group(1)}")
+        stride = field("stride")
+        images.append((m.group(1), image_blob(field("cf").replace("LV_COLOR_FORMAT_", ""), int(field("w"), 0),
+                                              int(field("h"), 0), arrays[data.group(1)],
+                                              int(stride, 0) if stride else 0)))
+    if not images:
+        raise ValueError(f"{path}: no lv_image_dsc_t found")
+    return images
+
+
+def classify(data, path):
+    if len(data) >= 8 and data[4:8] == b"head":
+        return TYPE_FONT
+    if path.endswith(".bin") and len(data) >= IMAGE_HEADER.size and data[0] == IMAGE_MAGIC:
+        if IMAGE_HEADER.unpack_from(data)[2] & IMAGE_FLAG_COMPRESSED:
+            raise ValueError(f"{path}: compressed LVGL image, convert it uncompressed and let the pack compress it")
+        return TYPE_IMAGE
+    return TYPE_RAW
+
+
+def collect(inputs):
+    """(name, type, blob) for every input; later inputs replace earlier ones of the same name."""
+    files = []
+    for spec in inputs:
+        name, _, path = spec.partition("=") if "=" in spec else (None, None, spec)
+        if os.path.isdir(path):
+            for root, _, names in sorted(os.walk(path)):
+                for f in sorted(names):
+                    full = os.path.join(root, f)
+                    files.append((os.path.splitext(os.path.relpath(full, path))[0].replace(os.sep, "/"), full))
+        else:
+            files.append((name, path))
+    assets = {}
+    for name, path in files:
+        if path.endswith(".c"):
+            with open(path, encoding="utf-8", errors="replace") as f:
+                for var, blob in parse_c_images(f.read(), path):
+                    assets[name or var] = (TYPE_IMAGE, blob)
+            continue
+        with open(path, "rb") as f:
+            data = f.read()
+        assets[name or os.path.splitext(os.path.basename(path))[0]] = (classify(data, path), data)
+    return assets
+
+
+def build(args):
+    assets = collect(args.inputs)
+    if not assets:
+        sys.exit("nothing to pack")
+    names = sorted(assets, key=lambda n: n.encode())            # strcmp() order for the firmware's binary search
+    name_table = bytearray()
+    name_offsets = []
+    for n in names:
+        name_offsets.append(len(name_table))
+        name_table += n.encode() + b"\0"
+    align = args.align
+    data_offset = HEADER.size + len(names) * ENTRY.size + len(name_table)
+    data_offset = (data_offset + align - 1) // align * align
+
+    entries, blobs = [], bytearray()
+    raw_total = stored_total = 0
+    for n, name_offset in zip(names, name_offsets):
+        kind, data = assets[n]
+        stored, compression = data, STORED
+        if args.lz4 and len(data) >= 64 and not any(fnmatch.fnmatchcase(n, p) for p in args.store):
+            packed = lz4_compress(data)
+            if len(packed) <= len(data) * 7 // 8:
+                if lz4_decompress(packed, len(data)) != data:
+                    sys.exit(f"{n}: LZ4 round trip failed")
+                stored, compression = packed, LZ4
+        blobs += b"\0" * (-len(blobs) % align)
+        entries.append(ENTRY.pack(name_offset, data_offset + len(blobs), len(stored), len(data), kind, compression, 0,
+                                  zlib.crc32(data)))
+        blobs += stored
+        raw_total += len(data)
+        stored_total += len(stored)
+        if args.verbose:
+            print(f"  {n:40} {TYPES[kind]:5} {len(data):9} {len(stored):9}{' lz4' if compression else ''}")
+
+    index = b"".join(entries) + name_table
+    head = HEADER.pack(MAGIC, VERSION, align, len(names), len(name_table), data_offset, data_offset + len(blobs))
+    pad = b"\0" * (data_offset - HEADER.size - len(index))
+    with open(args.output, "wb") as f:
+        f.write(head + index + pad + blobs)
+    print(f"{args.output}: {len(names)} assets, {raw_total / 1024:.1f} KB unpacked, "
+          f"{(data_offset + len(blobs)) / 1024:.1f} KB packed")
+
+
+def read_pack(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) >= SLOT.size and struct.unpack_from("<I", data)[0] == SLOT_MAGIC:
+        _, generation, size, crc, header_crc = SLOT.unpack_from(data)
+        if zlib.crc32(data[:SLOT.size - 4]) != header_crc:
+            sys.exit(f"{path}: damaged slot header")
+        data = data[SLOT_PACK_OFFSET:SLOT_PACK_OFFSET + size]
+        if zlib.crc32(data) != crc:
+            sys.exit(f"{path}: the pack in the slot fails its CRC")
+        print(f"{path}: asset slot, generation {generation}")
+    magic, version, align, count, names_size, data_offset, file_size = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION:
+        sys.exit(f"{path}: not a version {VERSION} asset pack")
+    if file_size != len(data):
+        sys.exit(f"{path}: {len(data)} bytes, the header says {file_size}")
+    names_at = HEADER.size + count * ENTRY.size
+    names = data[names_at:names_at + names_size]
+    entries = []
+    for i in range(count):
+        name, offset, stored, size, kind, compression, _, crc = ENTRY.unpack_from(data, HEADER.size + i * ENTRY.size)
+        entries.append((names[name:names.index(b"\0", name)].decode(), offset, stored, size, kind, compression, crc))
+    return data, align, entries
+
+
+def unpack(data, entry):
+    _, offset, stored, size, _, compression, _ = entry
+    blob = data[offset:offset + stored]
+    return lz4_decompress(blob, size) if compression == LZ4 else blob
+
+
+def list_pack(args):
+    data, align, entries = read_pack(args.pack)
+    for e in entries:
+        name, offset, stored, size, kind, compression, _ = e
+        info = ""
+        if kind == TYPE_IMAGE:
+            _, cf, _, w, h, stride, _ = IMAGE_HEADER.unpack_from(unpack(data, e))
+            info = f"{w}x{h} cf {cf:02X} stride {stride}"
+        print(f"{name:40} {TYPES.get(kind, '?'):5} {offset:9} {size:9} {stored:9}{' lz4' if compression else '    '} "
+              f"{info}")
+    print(f"{len(entries)} assets, blobs aligned to {align}, {len(data) / 1024:.1f} KB")
+
+
+def verify(args):
+    data, align, entries = read_pack(args.pack)
+    bad = 0
+    names = [e[0].encode() for e in entries]
+    if names != sorted(names):
+        print("index is not sorted")
+        bad += 1
+    for e in entries:
+        name, offset, stored, size, kind, compression, crc = e
+        try:
+            blob = unpack(data, e)
+            problem = None
+            if offset % align:
+                problem = "misaligned"
+            elif zlib.crc32(blob) != crc:
+                problem = "CRC mismatch"
+            elif kind == TYPE_IMAGE:
+                _, cf, _, w, h, stride, _ = IMAGE_HEADER.unpack_from(blob)
+                if blob[0] != IMAGE_MAGIC or len(blob) - IMAGE_HEADER.size < stride * h:
+                    problem = "bad image header"
+        except (ValueError, IndexError) as err:
+            problem = str(err)
+        if problem:
+            print(f"{name}: {problem}")
+            bad += 1
+    print(f"{len(entries)} assets, {bad} bad")
+    return 1 if bad else 0
+
+
+def partition_table(path):
+    """{label: (offset, size)} of the asset slots of a partition table."""
+    slots = {}
+    with open(path) as f:
+        for line in f:
+            fields = [x.strip() for x in line.split("#")[0].split(",")]
+            if len(fields) >= 5 and fields[1] == "data" and fields[2][:2].lower() == "0x" and \
+                    int(fields[2], 16) == SLOT_SUBTYPE:
+                slots[fields[0]] = (int(fields[3], 0), int(fields[4], 0))
+    return slots
+
+
+def partition(args):
+    with open(args.pack, "rb") as f:
+        pack = f.read()
+    magic, version, *_ = HEADER.unpack_from(pack)
+    if magic != MAGIC or version != VERSION:
+        sys.exit(f"{args.pack}: not a version {VERSION} asset pack")
+    slots = partition_table(args.table)
+    if args.label not in slots:
+        sys.exit(f"{args.table}: no asset slot {args.label}, only {', '.join(slots) or 'none'}")
+    offset, size = slots[args.label]
+    if SLOT_PACK_OFFSET + len(pack) > size:
+        sys.exit(f"{args.pack}: {len(pack) / 1024:.1f} KB, {args.label} holds {(size - SLOT_PACK_OFFSET) / 1024:.1f} KB")
+    head = SLOT.pack(SLOT_MAGIC, args.generation, len(pack), zlib.crc32(pack), 0)
+    head = head[:-4] + struct.pack("<I", zlib.crc32(head[:-4]))
+    with open(args.output, "wb") as f:
+        f.write(head + b"\xff" * (SLOT_PACK_OFFSET - len(head)) + pack)
+    print(f"{args.output}: {args.label}, generation {args.generation}, {len(pack) / 1024:.1f} KB of "
+          f"{(size - SLOT_PACK_OFFSET) / 1024:.0f} KB")
+    print(f"  esptool.py --chip esp32s3 write_flash 0x{offset:X} {args.output}")
+    for label, (other, _) in slots.items():
+        if label != args.label:
+            print(f"  {label} wins if it holds a higher generation; to uncommit it: "
+                  f"esptool.py --chip esp32s3 erase_region 0x{other:X} 0x1000")
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = p.add_subparsers(dest="command", required=True)
+    b = sub.add_parser("build", help="pack files and directories")
+    b.add_argument("inputs", nargs="+", help="files, directories or NAME=FILE")
+    b.add_argument("-o", "--output", required=True)
+    b.add_argument("--lz4", action="store_true", help="LZ4 compress blobs that shrink by 1/8 or more")
+    b.add_argument("--store", action="append", default=[], metavar="PATTERN",
+                   help="keep entries matching PATTERN uncompressed, e.g. 'fonts/*' for Paged_Font_Create()")
+    b.add_argument("--align", type=int, default=64, help="blob alignment in bytes (default 64)")
+    b.add_argument("-v", "--verbose", action="store_true")
+    for name in ("list", "verify"):
+        sub.add_parser(name).add_argument("pack")
+    t = sub.add_parser("partition", help="wrap a pack into an asset slot image for esptool")
+    t.add_argument("pack")
+    t.add_argument("-o", "--output", required=True)
+    t.add_argument("--label", default="assets0", help="slot to write (default assets0)")
+    t.add_argument("--generation", type=int, default=1, help="higher wins over the other slot (default 1)")
+    t.add_argument("--table", default=os.path.join(os.path.dirname(os.path.abspath(__file__)), "..",
+                                                   "partitions_assets.csv"))
+    args = p.parse_args()
+    if args.command == "build":
+        if args.align < 4 or args.align & (args.align - 1):
+            sys.exit("--align must be a power of two, at least 4")
+        build(args)
+    elif args.command == "list":
+        list_pack(args)
+    elif args.command == "partition":
+        partition(args)
+    else:
+        sys.exit(verify(args))
+
+
+if __name__ == "__main__":
+    main()
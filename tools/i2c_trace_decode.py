@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Decode I2C traces produced by I2C_Trace_Dump_Serial() / I2C_Trace_Dump_File().
+
+The input may be a trace file from the SD card or a raw capture of the serial
+port; anything before the "I2CT" magic (boot log, printf output) is skipped.
+
+    python tools/i2c_trace_decode.py i2c.trc            # per-transaction listing + summary
+    python tools/i2c_trace_decode.py i2c.trc --csv      # CSV, one row per transaction
+"""
+import argparse
+import struct
+import sys
+
+MAGIC = 0x54433249
+HEADER = struct.Struct("<IBBHII")
+RECORD = struct.Struct("<IHHHHBBBB")
+RESULTS = {0: "ok", 1: "timeout", 2: "fail", 3: "error"}
+PRIORITIES = {0: "touch", 1: "normal", 2: "background"}
+DEVICES = {0x5D: "GT911", 0x6B: "QMI8658", 0x6A: "QMI8658", 0x51: "PCF85063", 0x20: "TCA9554"}
+
+
+def find_dumps(data):
+    """Yield (header fields, records) for every dump found in the buffer."""
+    pos = 0
+    magic = struct.pack("<I", MAGIC)
+    while True:
+        pos = data.find(magic, pos)
+        if pos < 0 or pos + HEADER.size > len(data):
+            return
+        _, version, rec_size, _, count, dropped = HEADER.unpack_from(data, pos)
+        if rec_size != RECORD.size:
+            sys.exit(f"unsupported record size {rec_size} (trace version {version})")
+        body = pos + HEADER.size
+        records = []
+        for i in range(count):
+            off = body + i * RECORD.size
+            if off + RECORD.size > len(data):
+                print(f"warning: dump truncated after {i} of {count} records", file=sys.stderr)
+                break
+            records.append(RECORD.unpack_from(data, off))
+        yield version, dropped, records
+        pos = body + count * RECORD.size
+
+
+def describe(addr):
+    return DEVICES.get(addr, f"0x{addr:02x}")
+
+
+def print_listing(records):
+    t0 = records[0][0] if records else 0
+    print(f"{'t(us)':>10} {'dev':>9} {'op':>2} {'reg':>6} {'len':>4} {'wait':>6} {'dur':>6} {'prio':>10} result")
+    for start, dur, wait, reg, length, addr, result, prio, _ in records:
+        print(f"{(start - t0) & 0xFFFFFFFF:>10} {describe(addr & 0x7F):>9} {'R' if addr & 0x80 else 'W':>2} "
+              f"0x{reg:04x} {length:>4} {wait:>6} {dur:>6} {PRIORITIES.get(prio, prio):>10} {RESULTS.get(result, result)}")
+
+
+def print_csv(records):
+    print("start_us,device,addr,op,reg,length,wait_us,duration_us,priority,result")
+    for start, dur, wait, reg, length, addr, result, prio, _ in records:
+        print(f"{start},{describe(addr & 0x7F)},0x{addr & 0x7F:02x},{'R' if addr & 0x80 else 'W'},0x{reg:04x},"
+              f"{length},{wait},{dur},{PRIORITIES.get(prio, prio)},{RESULTS.get(result, result)}")
+
+
+def print_summary(records, dropped):
+    if not records:
+        print("empty trace")
+        return
+    first = records[0][0]
+    last = records[-1][0] + records[-1][1]
+    window = (last - first) & 0xFFFFFFFF
+    per_dev = {}
+    for start, dur, wait, reg, length, addr, result, prio, _ in records:
+        d = per_dev.setdefault(addr & 0x7F, [0, 0, 0, 0, 0])
+        d[0] += 1
+        d[1] += result != 0
+        d[2] += dur
+        d[3] = max(d[3], wait)
+        d[4] += length
+    print(f"\n{len(records)} transactions over {window} us, {dropped} dropped before the dump")
+    busy_total = 0
+    for addr, (n, err, busy, max_wait, nbytes) in sorted(per_dev.items()):
+        busy_total += busy
+        share = busy * 100.0 / window if window else 0.0
+        print(f"{describe(addr):>9}: {n:6} trans {err:4} err {nbytes:8} bytes busy {busy:9} us ({share:5.1f}%) max wait {max_wait} us")
+    print(f"      bus: {busy_total * 100.0 / window if window else 0.0:5.1f}% busy")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("trace", help="trace file or serial capture")
+    parser.add_argument("--csv", action="store_true", help="print CSV instead of a listing")
+    parser.add_argument("--summary", action="store_true", help="only print the per-device summary")
+    args = parser.parse_args()
+
+    with open(args.trace, "rb") as f:
+        data = f.read()
+    dumps = list(find_dumps(data))
+    if not dumps:
+        sys.exit("no I2C trace found in input")
+    for version, dropped, records in dumps:
+        if args.csv:
+            print_csv(records)
+            continue
+        if not args.summary:
+            print_listing(records)
+        print_summary(records, dropped)
+
+
+if __name__ == "__main__":
+    main()
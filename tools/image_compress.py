@@ -0,0 +1,300 @@
+#!/usr/bin/env python3
+"""Compress LVGL image C files in place for the firmware's image decoder (src/Compressed_Image.cpp).
+
+SquareLine exports its images (src/ui/ui_img_*.c) as plain pixel arrays, mostly
+runs of 0x00 and 0xFF for icons. Each file is rewritten with the image in LVGL's
+compressed form: LV_IMAGE_FLAGS_COMPRESSED, a 12-byte lv_image_compressed_t and
+the data as one RLE stream (lib/lvgl/src/libs/rle) or one LZ4 block. The
+original array stays in the file as the #else branch, built when lv_conf.h
+leaves LV_USE_RLE or LV_USE_LZ4 off, and is what a later run reads back: run the
+tool again after every SquareLine export.
+
+    python tools/image_compress.py src/ui/ui_img_*.c                 # smaller of RLE and LZ4
+    python tools/image_compress.py src/ui/ui_img_*.c --method rle    # RLE only, drawable line by line
+    python tools/image_compress.py src/ui/ui_img_*.c --icon a8       # single-colour icons as A8 masks
+    python tools/image_compress.py src/ui/ui_img_*.c --restore       # back to SquareLine's output
+    python tools/image_compress.py src/ui/ui_img_*.c --dry-run       # report only
+
+The report gives the flash each image saves; what it costs to decode is measured
+by sim/bench/image_bench.cpp on the host and Compressed_Image_Bench() on the
+board. Images that would not shrink by 1/8 are left uncompressed. RLE works in
+pixels (2 bytes for RGB565 and RGB565A8, whose alpha plane is taken 2 pixels at
+a time, as lv_bin_decoder does); LZ4 needs LV_USE_LZ4_INTERNAL.
+
+--icon converts single-colour images, SquareLine's Material icons for instance,
+before compressing them: a8 keeps the alpha plane alone, 1 byte per pixel
+against 3, and i1/i2/i4 quantise it into a palette of that many levels. Their
+colour is no longer in the image: the software renderer draws them as masks in
+the image_recolor (or bg_image_recolor) of the widget, see Icon_Image_Set_Color()
+in src/Icon_Image.h. A8 icons also get an uncompressed branch (#elif
+LV_USE_DRAW_SW); indexed ones are not compressed, src/Icon_Image.cpp expands
+them to A8 once into lv_image_cache.
+"""
+import argparse
+import os
+import re
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from asset_pack import COLOR_FORMATS, lz4_compress, lz4_decompress  # noqa: E402
+
+MARKER = "// Compressed by tools/image_compress.py"
+COMPRESSED_HEADER = struct.Struct("<III")                       # lv_image_compressed_t: method, sizes
+RLE, LZ4 = 1, 2                                                 # lv_image_compress_t
+GUARDS = {RLE: "LV_USE_RLE", LZ4: "LV_USE_LZ4"}
+NAMES = {RLE: "RLE", LZ4: "LZ4"}
+RLE_MAX = 127
+ICON_GUARD = "LV_USE_DRAW_SW"                                   # A8 masks, and Icon_Image's A8 from indexed
+ICON_MIN_ALPHA = 64                                             # Fainter edge pixels may be off colour
+
+
+def rle_block(cf_name):
+    cf, bpp = COLOR_FORMATS[cf_name]
+    return 2 if cf == COLOR_FORMATS["RGB565A8"][0] else (bpp + 7) // 8
+
+
+def rle_compress(data, blk):
+    """LVGL's RLE: a control byte, then one block repeated (bit 7 clear) or count blocks copied (bit 7 set)."""
+    tail = len(data) % blk
+    padded = data + b"\0" * (-len(data) % blk)
+    blocks = [padded[i:i + blk] for i in range(0, len(padded), blk)]
+    # lv_rle_decompress() cuts a partial last block short only on a copy, so that block never ends a repeat
+    last = len(blocks) - 1 if tail else len(blocks)
+    out = bytearray()
+
+    def literals(start, end):
+        while start < end:
+            n = min(end - start, RLE_MAX)
+            out.append(0x80 | n)
+            out.extend(b"".join(blocks[start:start + n]))
+            start += n
+
+    i = start = 0
+    while i < len(blocks):
+        run = 1
+        while i + run < last and run < RLE_MAX and blocks[i + run] == blocks[i]:
+            run += 1
+        if i < last and run >= (3 if blk == 1 else 2):
+            literals(start, i)
+            out.append(run)
+            out += blocks[i]
+            i += run
+            start = i
+        else:
+            i += 1
+    literals(start, len(blocks))
+    return bytes(out)
+
+
+def rle_decompress(src, blk, size):
+    out = bytearray()
+    i = 0
+    while i < len(src):
+        ctrl = src[i]
+        i += 1
+        if ctrl & 0x80:
+            n = (ctrl & 0x7F) * blk
+            out += src[i:i + n]
+            i += n
+        else:
+            out += src[i:i + blk] * ctrl
+            i += blk
+    if len(out) < size:
+        raise ValueError(f"RLE stream unpacks to {len(out)} bytes, expected {size}")
+    return bytes(out[:size])
+
+
+# --------------------------------------------------------------------------------------------------------------------
+def split(text, path):
+    """(head, original): the comment lines and includes before the first image, and SquareLine's image code."""
+    if MARKER in text:
+        m = re.search(r"^#else\n(.*)^#endif\n?\Z", text, re.S | re.M)
+        if not m:
+            raise ValueError(f"{path}: compressed by an older tool or edited, export it again")
+        head = text[:text.index("\n#if ") + 1]
+        head = "".join(line for line in head.splitlines(True) if not line.startswith(MARKER) and
+                       not line.startswith("//   "))
+        return head.rstrip("\n") + "\n\n", m.group(1)
+    m = re.search(r"^(?://\s*IMAGE DATA|const\b)", text, re.M)
+    if not m:
+        raise ValueError(f"{path}: no image data")
+    return text[:m.start()], text[m.start():]
+
+
+def parse(original, path):
+    """(variable, array, cf name, w, h, data) for the one image of a SquareLine image file."""
+    arrays = {m.group(1): bytes(int(b, 16) for b in re.findall(r"0x([0-9A-Fa-f]{2})", m.group(2)))
+              for m in re.finditer(r"uint8_t\s+(\w+)\s*\[\s*\]\s*=\s*\{(.*?)\};", original, re.S)}
+    images = list(re.finditer(r"lv_image_dsc_t\s+(\w+)\s*=\s*\{(.*?)\};", original, re.S))
+    if len(images) != 1:
+        raise ValueError(f"{path}: {len(images)} images, expected one")
+    body = images[0].group(2)
+
+    def field(name):
+        f = re.search(r"\.header\." + name + r"\s*=\s*(\w+)", body)
+        return f.group(1) if f else None
+    data = re.search(r"\.data\s*=\s*(?:\(.*?\))?\s*&?(\w+)", body)
+    if not (field("w") and field("h") and field("cf") and data and data.group(1) in arrays):
+        raise ValueError(f"{path}: cannot read the descriptor of {images[0].group(1)}")
+    if field("flags") or field("stride"):
+        raise ValueError(f"{path}: flags or stride set, not a plain SquareLine image")
+    cf = field("cf").replace("LV_COLOR_FORMAT_", "")
+    if cf not in COLOR_FORMATS or COLOR_FORMATS[cf][1] < 8:
+        raise ValueError(f"{path}: color format {cf} not handled")
+    w, h = int(field("w"), 0), int(field("h"), 0)
+    pixels = arrays[data.group(1)]
+    if len(pixels) != w * h * COLOR_FORMATS[cf][1] // 8 + (w * h if cf in ("RGB565A8", "NATIVE_WITH_ALPHA") else 0):
+        raise ValueError(f"{path}: {len(pixels)} bytes of data for {w}x{h} {cf}")
+    return images[0].group(1), data.group(1), cf, w, h, pixels
+
+
+def rgb565(c):
+    return c >> 11, (c >> 5) & 0x3F, c & 0x1F
+
+
+def icon(cf, w, h, pixels, fmt, path):
+    """(cf, data, colour) of a single-colour RGB565A8 image as an A8 mask, or indexed with a palette of alpha levels."""
+    if COLOR_FORMATS[cf][0] != COLOR_FORMATS["RGB565A8"][0]:
+        raise ValueError(f"{path}: --icon takes RGB565A8 images, not {cf}")
+    n = w * h
+    colors, alpha = struct.unpack_from(f"<{n}H", pixels), pixels[2 * n:]
+    weight = {}
+    for c, a in zip(colors, alpha):
+        weight[c] = weight.get(c, 0) + a
+    color = max(weight, key=weight.get) if any(alpha) else 0
+    r, g, b = rgb565(color)
+    for c, a in zip(colors, alpha):
+        cr, cg, cb = rgb565(c)
+        if a >= ICON_MIN_ALPHA and max(abs(cr - r), abs(cg - g) // 2, abs(cb - b)) > 1:
+            raise ValueError(f"{path}: 0x{c:04X} next to 0x{color:04X}, --icon takes single-colour images")
+    if fmt == "a8":
+        return "A8", bytes(alpha), color
+    bpp = int(fmt[1])
+    levels = (1 << bpp) - 1
+    # lv_color32_t entries, blue first; the colour is kept for lv_bin_decoder, Icon_Image only reads the alpha
+    rgb = ((b * 527 + 23) >> 6, (g * 259 + 33) >> 6, (r * 527 + 23) >> 6)
+    palette = b"".join(bytes(rgb + ((i * 255 + levels // 2) // levels,)) for i in range(levels + 1))
+    stride = (w * bpp + 7) // 8
+    data = bytearray(stride * h)
+    for i, a in enumerate(alpha):
+        y, x = divmod(i, w)
+        data[y * stride + x * bpp // 8] |= ((a * levels + 127) // 255) << (8 - bpp - x * bpp % 8)  # First pixel in the MSBs
+    return f"I{bpp}", palette + bytes(data), color
+
+
+def c_bytes(data, indent="    ", per_line=32):
+    return "\n".join(indent + ",".join(f"0x{b:02X}" for b in data[i:i + per_line]) + ","
+                     for i in range(0, len(data), per_line))
+
+
+def image_code(var, array, cf, w, h, comment, data, flags=None):
+    stride = (w * COLOR_FORMATS[cf][1] + 7) // 8
+    return (f"const LV_ATTRIBUTE_MEM_ALIGN uint8_t {array}[] = {{\n"
+            f"    // {comment}\n"
+            f"{c_bytes(data)}\n}};\n"
+            f"const lv_image_dsc_t {var} = {{\n"
+            f"   .header.w = {w},\n"
+            f"   .header.h = {h},\n"
+            f"   .header.stride = {stride},\n" +
+            (f"   .header.flags = {flags},\n" if flags else "") +
+            f"   .data_size = sizeof({array}),\n"
+            f"   .header.cf = LV_COLOR_FORMAT_{cf},\n"
+            f"   .header.magic = LV_IMAGE_HEADER_MAGIC,\n"
+            f"   .data = {array}}};\n")
+
+
+def compressed_code(var, array, cf, w, h, method, raw, packed):
+    return image_code(var, array, cf, w, h, f"lv_image_compressed_t: {NAMES[method]}, {len(packed)} bytes unpacking to "
+                      f"{len(raw)}", COMPRESSED_HEADER.pack(method, len(packed), len(raw)) + packed,
+                      "LV_IMAGE_FLAGS_COMPRESSED")
+
+
+def compress(raw, cf, method):
+    """(method, packed, sizes) with the smaller stream of those allowed, RLE on a tie; sizes by method tried."""
+    if method == "none":
+        return None, raw, {}
+    blk = rle_block(cf)
+    candidates = []
+    if method in ("rle", "best"):
+        packed = rle_compress(raw, blk)
+        if rle_decompress(packed, blk, len(raw)) != raw:
+            raise ValueError("RLE round trip failed")
+        candidates.append((len(packed), RLE, packed))
+    if method in ("lz4", "best"):
+        packed = lz4_compress(raw)
+        if lz4_decompress(packed, len(raw)) != raw:
+            raise ValueError("LZ4 round trip failed")
+        candidates.append((len(packed), LZ4, packed))
+    _, chosen, packed = min(candidates, key=lambda c: (c[0], c[1]))
+    return chosen, packed, {m: n + COMPRESSED_HEADER.size for n, m, _ in candidates}
+
+
+def process(path, args):
+    with open(path, encoding="utf-8", newline="") as f:
+        text = f.read()
+    head, original = split(text, path)
+    var, array, cf, w, h, raw = parse(original, path)
+    fmt, data, color = cf, raw, None
+    if args.icon and not args.restore:
+        fmt, data, color = icon(cf, w, h, raw, args.icon, path)
+    method, packed, sizes = compress(data, fmt, "none" if fmt[0] == "I" else args.method)
+    stored = len(packed) + (COMPRESSED_HEADER.size if method else 0)
+    if method and color is not None and stored > len(data) * 7 // 8:
+        method, packed, stored = None, data, len(data)                  # The icon alone then
+    keep = args.restore or stored > len(raw) * 7 // 8
+    kind = "-" if keep else " ".join(k for k in (fmt if color is not None else "", NAMES.get(method, "")) if k)
+    print(f"  {var:64} {w:4}x{h:<4} {cf:17} {len(raw):7} {sizes.get(RLE, '-'):>7} {sizes.get(LZ4, '-'):>7} "
+          f"{kind:>6} {0 if keep else len(raw) - stored:7}")
+    if keep:
+        out = head + original
+    else:
+        branches = []
+        if method:
+            branches.append((GUARDS[method], compressed_code(var, array, fmt, w, h, method, data, packed)))
+        if color is not None and fmt == "A8" or not method:
+            branches.append((ICON_GUARD, image_code(var, array, fmt, w, h, f"{fmt} icon, {len(data)} bytes", data)))
+        guards = " nor ".join(g for g, _ in branches)
+        note = ""
+        if color is not None:
+            note = (f"//   {fmt} icon of colour 0x{color:04X} (RGB565): drawn in the widget's image_recolor or\n"
+                    f"//   bg_image_recolor, see Icon_Image_Set_Color().\n")
+        out = (head.rstrip("\n") + "\n\n" +
+               f"{MARKER}: {kind}, {len(raw)} -> {stored} bytes of flash.\n" + note +
+               f"//   The image as exported after #else is built with {'neither ' if method and color else 'no '}{guards} "
+               f"in lv_conf.h, and read back\n"
+               f"//   by the tool; run it again after exporting from SquareLine.\n\n" +
+               "".join(f"#{'if' if i == 0 else 'elif'} {g}\n{code}" for i, (g, code) in enumerate(branches)) +
+               f"#else\n{original}{'' if original.endswith(chr(10)) else chr(10)}#endif\n")
+    if not args.dry_run and out != text:
+        with open(path, "w", encoding="utf-8", newline="") as f:
+            f.write(out)
+    return len(raw), len(raw) if keep else stored
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument("files", nargs="+", help="LVGL image C files, e.g. src/ui/ui_img_*.c")
+    p.add_argument("--method", choices=("best", "rle", "lz4", "none"), default="best",
+                   help="best: the smaller of RLE and LZ4 (default); rle keeps images drawable line by line; "
+                        "none: --icon alone")
+    p.add_argument("--icon", choices=("a8", "i1", "i2", "i4"),
+                   help="single-colour images as an A8 mask or indexed by alpha level, recoloured when drawn")
+    p.add_argument("--restore", action="store_true", help="write the uncompressed images back")
+    p.add_argument("-n", "--dry-run", action="store_true", help="report without writing")
+    args = p.parse_args()
+    print(f"  {'image':64} {'size':9} {'format':17} {'raw':>7} {'rle':>7} {'lz4':>7} {'':6} {'saved':>7}")
+    raw_total = stored_total = 0
+    for path in args.files:
+        try:
+            raw, stored = process(path, args)
+        except ValueError as err:
+            sys.exit(str(err))
+        raw_total += raw
+        stored_total += stored
+    print(f"{len(args.files)} images, {raw_total} bytes raw, {stored_total} in flash, "
+          f"{raw_total - stored_total} saved ({100 * (raw_total - stored_total) / max(raw_total, 1):.0f}%)")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+"""Decode captures written by the data logger (src/Data_Logger.cpp).
+
+A capture is one or more files cap<NNNN>_<PPP>.bin; pass all parts, in any
+order. Every block is checked (magic, sequence, CRC) and a bad block only costs
+its own contents. Sample times are unwrapped to 64-bit microseconds.
+
+    python tools/imu_log_decode.py cap0001_*.bin              # summary
+    python tools/imu_log_decode.py cap0001_*.bin --csv        # IMU samples in g and dps
+    python tools/imu_log_decode.py cap0001_*.bin --events     # battery, RTC and loss records
+"""
+import argparse
+import struct
+import sys
+import zlib
+
+MAGIC = 0x424C4D49
+VERSION = 1
+BLOCK_SIZE = 16384
+BLOCK = struct.Struct("<IIHHI")
+CHUNK = struct.Struct("<BBH")
+DATETIME = struct.Struct("<HBBBBBB")
+INFO = struct.Struct("<BBHQfff8s")
+IMU = struct.Struct("<IHH")
+RECORD = struct.Struct("<Hhhhhhh")
+BATTERY = struct.Struct("<IHH")
+RTC = struct.Struct("<I8s")
+LOSS = struct.Struct("<IIII")
+CHUNK_INFO, CHUNK_IMU, CHUNK_BATTERY, CHUNK_RTC, CHUNK_LOSS = 1, 2, 3, 4, 5
+
+
+def datetime_str(raw):
+    year, month, day, hour, minute, second, _ = DATETIME.unpack(raw)
+    return f"{year:04}-{month:02}-{day:02} {hour:02}:{minute:02}:{second:02}"
+
+
+class Clock:
+    """Unwraps the 32-bit esp_timer times of the chunks around the 64-bit time of the file's INFO chunk."""
+
+    def __init__(self):
+        self.ref = 0
+
+    def set(self, time_us):
+        self.ref = time_us
+
+    def unwrap(self, t32):
+        t = (self.ref & ~0xFFFFFFFF) | t32
+        if t < self.ref - (1 << 31):
+            t += 1 << 32
+        elif t > self.ref + (1 << 31):
+            t -= 1 << 32
+        self.ref = t
+        return t
+
+
+def part_number(path):
+    data = open(path, "rb").read(BLOCK.size + CHUNK.size + INFO.size)
+    if len(data) < BLOCK.size + CHUNK.size + INFO.size:
+        return 0
+    if CHUNK.unpack_from(data, BLOCK.size)[0] != CHUNK_INFO:
+        return 0
+    return INFO.unpack_from(data, BLOCK.size + CHUNK.size)[2]
+
+
+def read_blocks(paths, block_size, stats):
+    """Yield the payload of every good block, parts in capture order."""
+    expected = 0
+    for path in sorted(paths, key=part_number):
+        with open(path, "rb") as f:
+            while True:
+                block = f.read(block_size)
+                if len(block) < BLOCK.size:
+                    break
+                magic, seq, used, chunks, crc = BLOCK.unpack_from(block)
+                stats["blocks"] += 1
+                if magic != MAGIC or not BLOCK.size <= used <= len(block):
+                    stats["bad_blocks"] += 1
+                    print(f"warning: {path}: no block header at offset {f.tell() - len(block)}", file=sys.stderr)
+                    continue
+                if zlib.crc32(block[BLOCK.size:used]) != crc:
+                    stats["bad_blocks"] += 1
+                    print(f"warning: {path}: CRC error in block {seq}", file=sys.stderr)
+                    continue
+                if seq != expected:
+                    stats["missing_blocks"] += max(seq - expected, 0)
+                    print(f"warning: {path}: block {seq} follows block {expected - 1}", file=sys.stderr)
+                expected = seq + 1
+                yield block[BLOCK.size:used]
+
+
+def decode(paths, block_size, on_imu, on_event):
+    """Walk the chunks, calling on_imu(t_us, acc, gyr) per sample and on_event(kind, t_us, values) for the rest."""
+    stats = {"blocks": 0, "bad_blocks": 0, "missing_blocks": 0, "parts": 0}
+    clock = Clock()
+    for body in read_blocks(paths, block_size, stats):
+        off = 0
+        while off + CHUNK.size <= len(body):
+            kind, _, length = CHUNK.unpack_from(body, off)
+            off += CHUNK.size
+            payload = body[off:off + length]
+            off += length
+            if len(payload) < length:
+                print("warning: chunk runs past the end of its block", file=sys.stderr)
+                break
+            if kind == CHUNK_INFO:
+                version, _, part, time_us, imu_hz, acc_scale, gyr_scale, rtc = INFO.unpack_from(payload)
+                if version != VERSION:
+                    sys.exit(f"unsupported log version {version}")
+                clock.set(time_us)
+                stats["parts"] += 1
+                on_event("info", time_us, (part, imu_hz, acc_scale, gyr_scale, datetime_str(rtc)))
+            elif kind == CHUNK_IMU:
+                t32, count, _ = IMU.unpack_from(payload)
+                t = clock.unwrap(t32)
+                for i in range(count):
+                    dt, ax, ay, az, gx, gy, gz = RECORD.unpack_from(payload, IMU.size + i * RECORD.size)
+                    t += dt
+                    on_imu(t, (ax, ay, az), (gx, gy, gz))
+                clock.set(t)
+            elif kind == CHUNK_BATTERY:
+                t32, mv, _ = BATTERY.unpack_from(payload)
+                on_event("battery", clock.unwrap(t32), (mv,))
+            elif kind == CHUNK_RTC:
+                t32, rtc = RTC.unpack_from(payload)
+                on_event("rtc", clock.unwrap(t32), (datetime_str(rtc),))
+            elif kind == CHUNK_LOSS:
+                t32, imu, events, blocks = LOSS.unpack_from(payload)
+                on_event("loss", clock.unwrap(t32), (imu, events, blocks))
+    return stats
+
+
+def print_summary(paths, block_size):
+    info = []
+    imu = {"n": 0, "first": 0, "last": None, "gaps": 0, "max_dt": 0}
+    battery, rtc, loss = [], [], [0, 0, 0]
+
+    def on_imu(t, acc, gyr):
+        if imu["last"] is None:
+            imu["first"] = t
+        else:
+            dt = t - imu["last"]
+            imu["max_dt"] = max(imu["max_dt"], dt)
+            imu["gaps"] += dt * info[0][1] > 1.5e6
+        imu["last"] = t
+        imu["n"] += 1
+
+    def on_event(kind, t, values):
+        if kind == "info":
+            info.append(values)
+        elif kind == "battery":
+            battery.append(values[0])
+        elif kind == "rtc":
+            rtc.append(values[0])
+        elif kind == "loss":
+            loss[:] = [a + b for a, b in zip(loss, values)]
+            print(f"loss at {t / 1e6:.3f} s: {values[0]} IMU samples, {values[1]} events, {values[2]} blocks")
+
+    stats = decode(paths, block_size, on_imu, on_event)
+    if not info:
+        sys.exit("no INFO chunk found: not a logger capture")
+    _, imu_hz, acc_scale, gyr_scale, start = info[0]
+    print(f"{stats['parts']} file(s), {stats['blocks']} blocks, {stats['bad_blocks']} bad, "
+          f"{stats['missing_blocks']} missing")
+    print(f"started {start}, FIFO at {imu_hz:.1f} Hz, +-{acc_scale * 32768:.0f} g, +-{gyr_scale * 32768:.0f} dps")
+    if imu["n"] > 1:
+        span = (imu["last"] - imu["first"]) / 1e6
+        print(f"imu: {imu['n']} samples over {span:.1f} s, {(imu['n'] - 1) / span:.1f} Hz, "
+              f"{imu['gaps']} gaps, longest interval {imu['max_dt']} us")
+    print(f"lost: {loss[0]} IMU samples, {loss[1]} events, {loss[2]} blocks not written")
+    if battery:
+        print(f"battery: {battery[0]} mV -> {battery[-1]} mV, min {min(battery)} mV, {len(battery)} readings")
+    if rtc:
+        print(f"rtc: {rtc[0]} -> {rtc[-1]}")
+
+
+def print_csv(paths, block_size):
+    scale = [1.0, 1.0]
+    out = sys.stdout
+
+    def on_imu(t, acc, gyr):
+        a, g = scale
+        out.write(f"{t},{acc[0] * a:.5f},{acc[1] * a:.5f},{acc[2] * a:.5f},"
+                  f"{gyr[0] * g:.4f},{gyr[1] * g:.4f},{gyr[2] * g:.4f}\n")
+
+    def on_event(kind, t, values):
+        if kind == "info":
+            scale[:] = values[2:4]
+
+    out.write("time_us,ax_g,ay_g,az_g,gx_dps,gy_dps,gz_dps\n")
+    decode(paths, block_size, on_imu, on_event)
+
+
+def print_events(paths, block_size):
+    print("time_us,kind,values")
+
+    def on_event(kind, t, values):
+        print(f"{t},{kind}," + ",".join(str(v) for v in values))
+
+    decode(paths, block_size, lambda t, acc, gyr: None, on_event)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("files", nargs="+", help="capture files (all parts)")
+    parser.add_argument("--csv", action="store_true", help="print the IMU samples as CSV")
+    parser.add_argument("--events", action="store_true", help="print battery, RTC and loss records as CSV")
+    parser.add_argument("--block-size", type=int, default=BLOCK_SIZE, help="LOGGER_BLOCK_SIZE of the firmware")
+    args = parser.parse_args()
+
+    if args.csv:
+        print_csv(args.files, args.block_size)
+    elif args.events:
+        print_events(args.files, args.block_size)
+    else:
+        print_summary(args.files, args.block_size)
+
+
+if __name__ == "__main__":
+    main()